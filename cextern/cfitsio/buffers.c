@@ -9,6 +9,93 @@
 #include <stdlib.h>
 #include "fitsio2.h"
 
+#define IO_MAX_READAHEAD 64  /* max records loaded by one read-ahead read */
+
+/* number of I/O buffer records to allocate for each newly opened file.
+   Every buffer always holds exactly one IOBUFLEN-byte logical record,
+   so enlarging the pool does not alter the 2880-byte record semantics;
+   it only changes how many records are cached and how many of them can
+   be loaded from disk in a single read. */
+static int io_buffer_recs = NIOBUF;
+
+/*--------------------------------------------------------------------------*/
+long fits_set_io_buffer_size(long nbytes)
+/*
+  Set the total number of bytes of I/O buffer space to allocate for each
+  subsequently opened file; <= 0 restores the default (NIOBUF records).
+  When a file has more buffers than the default, sequential buffer misses
+  are served with a single multi-record disk read that is scattered into
+  the least recently used buffers.  Returns the number of bytes adopted.
+*/
+{
+    long nrec;
+
+    if (nbytes <= 0)
+        nrec = NIOBUF;
+    else
+    {
+        nrec = nbytes / IOBUFLEN;
+        if (nrec < NIOBUF)
+            nrec = NIOBUF;
+        else if (nrec > 100000)
+            nrec = 100000;
+    }
+
+    io_buffer_recs = (int) nrec;
+    return(nrec * IOBUFLEN);
+}
+/*--------------------------------------------------------------------------*/
+int ffiobf(FITSfile *Fptr)
+/*
+  allocate the pool of file I/O buffers, together with the bookkeeping
+  arrays which are carved out of the tail of the same allocation (so a
+  single free of iobuffer releases everything).  Returns 0 if OK, or
+  MEMORY_ALLOCATION if the buffers could not be allocated.
+*/
+{
+    int ii, nbufrec;
+
+    nbufrec = io_buffer_recs;
+    Fptr->iobuffer = (char *) calloc(nbufrec,
+                       IOBUFLEN + sizeof(long) + 2 * sizeof(int));
+
+    if ( !(Fptr->iobuffer) )
+        return(MEMORY_ALLOCATION);
+
+    Fptr->nbufrec = nbufrec;
+    Fptr->bufrecnum = (long *) (Fptr->iobuffer +
+                      ((size_t) nbufrec * IOBUFLEN));
+    Fptr->dirty = (int *) (Fptr->bufrecnum + nbufrec);
+    Fptr->ageindex = Fptr->dirty + nbufrec;
+
+    /* initialize the ageindex array (relative age of the I/O buffers) */
+    /* and initialize the bufrecnum array as being empty */
+    for (ii = 0; ii < nbufrec; ii++)
+    {
+        Fptr->ageindex[ii] = ii;
+        Fptr->bufrecnum[ii] = -1;
+    }
+
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static void ffyngbf(FITSfile *Fptr,  /* I - FITS file pointer            */
+           int nbuff)                /* I - buffer to promote            */
+/*
+  make the given buffer the youngest one in the age index
+*/
+{
+    int ibuff;
+
+    for (ibuff = 0; ibuff < Fptr->nbufrec; ibuff++)
+        if (Fptr->ageindex[ibuff] == nbuff)
+            break;
+
+    for (ibuff++; ibuff < Fptr->nbufrec; ibuff++)
+        Fptr->ageindex[ibuff - 1] = Fptr->ageindex[ibuff];
+
+    Fptr->ageindex[Fptr->nbufrec - 1] = nbuff;
+}
 /*--------------------------------------------------------------------------*/
 int ffmbyt(fitsfile *fptr,    /* I - FITS file pointer                */
            LONGLONG bytepos,     /* I - byte position in file to move to */
@@ -98,7 +185,7 @@ int ffpbyt(fitsfile *fptr,   /* I - FITS file pointer                    */
         (fptr->Fptr)->dirty[nbuff] = TRUE;       /* mark record as having been modified */
       }
 
-      for (ii = 0; ii < NIOBUF; ii++) /* flush any affected buffers to disk */
+      for (ii = 0; ii < (fptr->Fptr)->nbufrec; ii++) /* flush any affected buffers to disk */
       {
         if ((fptr->Fptr)->bufrecnum[ii] >= recstart
             && (fptr->Fptr)->bufrecnum[ii] <= recend )
@@ -307,7 +394,7 @@ int ffgbyt(fitsfile *fptr,    /* I - FITS file pointer             */
       recstart = (long) (filepos / IOBUFLEN);               /* starting record */
       recend = (long) ((filepos + nbytes - 1) / IOBUFLEN);  /* ending record   */
 
-      for (ii = 0; ii < NIOBUF; ii++) /* flush any affected buffers to disk */
+      for (ii = 0; ii < (fptr->Fptr)->nbufrec; ii++) /* flush any affected buffers to disk */
       {
         if ((fptr->Fptr)->dirty[ii] && 
             (fptr->Fptr)->bufrecnum[ii] >= recstart && (fptr->Fptr)->bufrecnum[ii] <= recend)
@@ -473,8 +560,9 @@ int ffldrc(fitsfile *fptr,        /* I - FITS file pointer             */
   pointers to make this the new current record for that file.
   Update ages of all the physical buffers.
 */
-    int ibuff, nbuff;
+    int ibuff, nbuff, nbuff2, ii, nload, maxload;
     LONGLONG rstart;
+    char *readbuff;
 
     /* check if record is already loaded in one of the buffers */
     /* search from youngest to oldest buffer for efficiency */
@@ -482,7 +570,7 @@ int ffldrc(fitsfile *fptr,        /* I - FITS file pointer             */
     if (fptr->HDUposition != (fptr->Fptr)->curhdu)
         ffmahd(fptr, (fptr->HDUposition) + 1, NULL, status);
 
-    for (ibuff = NIOBUF - 1; ibuff >= 0; ibuff--)
+    for (ibuff = (fptr->Fptr)->nbufrec - 1; ibuff >= 0; ibuff--)
     {
       nbuff = (fptr->Fptr)->ageindex[ibuff];
       if (record == (fptr->Fptr)->bufrecnum[nbuff]) {
@@ -517,9 +605,81 @@ int ffldrc(fitsfile *fptr,        /* I - FITS file pointer             */
     }
     else  /* not EOF, so read record from disk */
     {
+      nload = 1;
+      readbuff = 0;
+
+      /* When the file has more buffers than the default pool, serve a
+         sequential miss with one large disk read that gathers several
+         following records, then scatter them into the least recently
+         used buffers.  Read-ahead stops at the EOF and at the first
+         record that is already loaded in one of the buffers. */
+      if ((fptr->Fptr)->nbufrec > NIOBUF)
+      {
+        maxload = minvalue(IO_MAX_READAHEAD, (fptr->Fptr)->nbufrec / 4);
+
+        while (nload < maxload && rstart +
+               ((LONGLONG)(nload + 1)) * IOBUFLEN <= (fptr->Fptr)->filesize)
+        {
+          for (ii = 0; ii < (fptr->Fptr)->nbufrec; ii++)
+            if ((fptr->Fptr)->bufrecnum[ii] == record + nload)
+               break;
+
+          if (ii < (fptr->Fptr)->nbufrec)
+              break;   /* next record is already loaded */
+
+          nload++;
+        }
+
+        if (nload > 1)
+        {
+          readbuff = (char *) malloc((size_t) nload * IOBUFLEN);
+          if (!readbuff)
+              nload = 1;   /* fall back to loading a single record */
+        }
+      }
+
       if ((fptr->Fptr)->io_pos != rstart)
            ffseek(fptr->Fptr, rstart);
 
+      if (nload > 1)
+      {
+        ffread(fptr->Fptr, nload * IOBUFLEN, readbuff, status);
+        (fptr->Fptr)->io_pos = rstart + ((LONGLONG)nload) * IOBUFLEN;
+
+        if (*status > 0)
+        {
+            free(readbuff);
+            return(*status);
+        }
+
+        memcpy((fptr->Fptr)->iobuffer + ((size_t)nbuff * IOBUFLEN),
+               readbuff, IOBUFLEN);
+        (fptr->Fptr)->bufrecnum[nbuff] = record;
+
+        /* promote the requested record before recycling any buffers, */
+        /* so that it cannot itself be recycled by the loop below */
+        ffyngbf(fptr->Fptr, nbuff);
+
+        for (ii = 1; ii < nload && *status <= 0; ii++)
+        {
+          nbuff2 = (fptr->Fptr)->ageindex[0];  /* recycle oldest buffer */
+
+          if ((fptr->Fptr)->dirty[nbuff2])
+             ffbfwt(fptr->Fptr, nbuff2, status); /* write dirty buffer to disk */
+
+          memcpy((fptr->Fptr)->iobuffer + ((size_t)nbuff2 * IOBUFLEN),
+                 readbuff + ((size_t)ii * IOBUFLEN), IOBUFLEN);
+          (fptr->Fptr)->bufrecnum[nbuff2] = record + ii;
+          (fptr->Fptr)->dirty[nbuff2] = FALSE;
+          ffyngbf(fptr->Fptr, nbuff2);
+        }
+
+        free(readbuff);
+
+        (fptr->Fptr)->curbuf = nbuff; /* this is the current buffer for this file */
+        return(*status);    /* the age index has already been updated */
+      }
+
       ffread(fptr->Fptr, IOBUFLEN, (fptr->Fptr)->iobuffer + (nbuff * IOBUFLEN), status);
       (fptr->Fptr)->io_pos = rstart + IOBUFLEN;  /* set new IO position */
     }
@@ -533,16 +693,16 @@ updatebuf:
     if (ibuff < 0)
     { 
       /* find the current position of the buffer in the age index */
-      for (ibuff = 0; ibuff < NIOBUF; ibuff++)
+      for (ibuff = 0; ibuff < (fptr->Fptr)->nbufrec; ibuff++)
          if ((fptr->Fptr)->ageindex[ibuff] == nbuff)
             break;  
     }
 
     /* increment the age of all the buffers that were younger than it */
-    for (ibuff++; ibuff < NIOBUF; ibuff++)
+    for (ibuff++; ibuff < (fptr->Fptr)->nbufrec; ibuff++)
       (fptr->Fptr)->ageindex[ibuff - 1] = (fptr->Fptr)->ageindex[ibuff];
 
-    (fptr->Fptr)->ageindex[NIOBUF - 1] = nbuff; /* this is now the youngest buffer */
+    (fptr->Fptr)->ageindex[(fptr->Fptr)->nbufrec - 1] = nbuff; /* this is now the youngest buffer */
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -595,7 +755,7 @@ int ffflsh(fitsfile *fptr,        /* I - FITS file pointer           */
     if (fptr->HDUposition != (fptr->Fptr)->curhdu)
         ffmahd(fptr, (fptr->HDUposition) + 1, NULL, status);
 */
-    for (ii = 0; ii < NIOBUF; ii++)
+    for (ii = 0; ii < (fptr->Fptr)->nbufrec; ii++)
     {
 	/* flush modified buffer to disk */
         if ((fptr->Fptr)->bufrecnum[ii] >= 0 &&(fptr->Fptr)->dirty[ii])
@@ -619,7 +779,7 @@ int ffbfeof(fitsfile *fptr,        /* I - FITS file pointer           */
 */
     int ii;
 
-    for (ii = 0; ii < NIOBUF; ii++)
+    for (ii = 0; ii < (fptr->Fptr)->nbufrec; ii++)
     {
         if ( (LONGLONG) (fptr->Fptr)->bufrecnum[ii] * IOBUFLEN >= fptr->Fptr->filesize)
         {
@@ -683,7 +843,7 @@ int ffbfwt(FITSfile *Fptr,        /* I - FITS file pointer           */
       if (Fptr->io_pos != Fptr->filesize)
          ffseek(Fptr, Fptr->filesize);
 
-      ibuff = NIOBUF;  /* initialize to impossible value */
+      ibuff = Fptr->nbufrec;  /* initialize to impossible value */
       while(ibuff != nbuff) /* repeat until requested buffer is written */
       {
         minrec = (long) (Fptr->filesize / IOBUFLEN);
@@ -693,7 +853,7 @@ int ffbfwt(FITSfile *Fptr,        /* I - FITS file pointer           */
         irec = Fptr->bufrecnum[nbuff]; /* initially point to the requested buffer */
         ibuff = nbuff;
 
-        for (ii = 0; ii < NIOBUF; ii++)
+        for (ii = 0; ii < Fptr->nbufrec; ii++)
         {
           if (Fptr->bufrecnum[ii] >= minrec &&
             Fptr->bufrecnum[ii] < irec)
@@ -743,7 +903,7 @@ int ffgrsz( fitsfile *fptr, /* I - FITS file pionter                        */
 {
     int typecode, bytesperpixel;
 
-    /* There are NIOBUF internal buffers available each IOBUFLEN bytes long. */
+    /* There are nbufrec internal buffers available each IOBUFLEN bytes long. */
 
     if (fptr->HDUposition != (fptr->Fptr)->curhdu)
         ffmahd(fptr, (fptr->HDUposition) + 1, NULL, status);
@@ -756,11 +916,11 @@ int ffgrsz( fitsfile *fptr, /* I - FITS file pionter                        */
       /* image pixels are in column 2 of the 'table' */
       ffgtcl(fptr, 2, &typecode, NULL, NULL, status);
       bytesperpixel = typecode / 10;
-      *ndata = ((NIOBUF - 1) * IOBUFLEN) / bytesperpixel;
+      *ndata = (((fptr->Fptr)->nbufrec - 1) * IOBUFLEN) / bytesperpixel;
     }
     else   /* calc number of rows that fit in buffers */
     {
-      *ndata = (long) (((NIOBUF - 1) * IOBUFLEN) / maxvalue(1,
+      *ndata = (long) ((((fptr->Fptr)->nbufrec - 1) * IOBUFLEN) / maxvalue(1,
                (fptr->Fptr)->rowlength));
       *ndata = maxvalue(1, *ndata); 
     }
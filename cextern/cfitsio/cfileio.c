@@ -44,6 +44,30 @@ FITSfile *FptrTable[NMAXFILES];  /* this table of Fptr pointers is */
 int need_to_initialize = 1;    /* true if CFITSIO has not been initialized */
 int no_of_drivers = 0;         /* number of currently defined I/O drivers */
 
+#if defined(unix) || defined(__unix__)  || defined(__unix)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_HDUINDEX_STAT 1
+#endif
+
+#define MAX_HDUINDEX 10    /* max number of files with a cached HDU index */
+
+typedef struct    /* cached HDU offset index of a previously opened file */
+{
+    char filename[FLEN_FILENAME];  /* name of the disk file */
+    LONGLONG filesize;             /* size of the file when it was closed */
+    long modtime;                  /* modification time when closed, or 0 */
+    int maxhdu;                    /* highest HDU number that was visited */
+    LONGLONG *headstart;           /* the maxhdu + 2 known HDU offsets */
+    int age;                       /* age, for recycling old entries */
+} hduindexentry;
+
+static hduindexentry hduIndexTable[MAX_HDUINDEX];
+static int hduindexclock = 0;
+
+static void fits_save_hduindex(FITSfile *Fptr);
+static void fits_load_hduindex(fitsfile *fptr, char *infile);
+static void fits_drop_hduindex(char *filename);
 static int pixel_filter_helper(fitsfile **fptr, char *outfile,
 				char *expr,  int *status);
 static int find_quote(char **string);
@@ -109,72 +133,207 @@ int fitsio_init_lock(void)
     return(0);
 }
 /*--------------------------------------------------------------------------*/
-int ffomem(fitsfile **fptr,      /* O - FITS file pointer                   */ 
-           const char *name,     /* I - name of file to open                */
-           int mode,             /* I - 0 = open readonly; 1 = read/write   */
-           void **buffptr,       /* I - address of memory pointer           */
-           size_t *buffsize,     /* I - size of buffer, in bytes            */
-           size_t deltasize,     /* I - increment for future realloc's      */
-           void *(*mem_realloc)(void *p, size_t newsize), /* function       */
-           int *status)          /* IO - error status                       */
+static int fits_stat_hduindex(char *filename, long *modtime)
 /*
-  Open an existing FITS file in core memory.  This is a specialized version
-  of ffopen.
+  get the modification time of a disk file, for validating a cached HDU
+  index.  Returns non-zero if the time could not be determined.
+*/
+{
+#ifdef HAVE_HDUINDEX_STAT
+    struct stat sbuf;
+
+    if (stat(filename, &sbuf))
+        return(1);
+
+    *modtime = (long) sbuf.st_mtime;
+    return(0);
+#else
+    *modtime = 0;   /* no validation beyond the file size */
+    return(0);
+#endif
+}
+/*--------------------------------------------------------------------------*/
+static void fits_save_hduindex(FITSfile *Fptr)
+/*
+  remember the HDU offsets that were discovered while this file was
+  open, so that a later reopen of the unchanged file can move straight
+  to any already-known extension instead of reading every intervening
+  header.  Only plain disk files are indexed; the entry is validated
+  against the file size and modification time when it is consulted.
 */
 {
-    int ii, driver, handle, hdutyp, slen, movetotype, extvers, extnum;
-    char extname[FLEN_VALUE];
-    LONGLONG filesize;
     char urltype[MAX_PREFIX_LEN], infile[FLEN_FILENAME], outfile[FLEN_FILENAME];
     char extspec[FLEN_FILENAME], rowfilter[FLEN_FILENAME];
     char binspec[FLEN_FILENAME], colspec[FLEN_FILENAME];
-    char imagecolname[FLEN_VALUE], rowexpress[FLEN_FILENAME];
-    char *url, errmsg[FLEN_ERRMSG];
-    char *hdtype[3] = {"IMAGE", "TABLE", "BINTABLE"};
+    hduindexentry *entry;
+    LONGLONG *offsets;
+    long modtime;
+    int ii, oldest, tstatus = 0;
 
-    if (*status > 0)
-        return(*status);
+    if (Fptr->maxhdu < 1)
+        return;    /* single-HDU files aren't worth indexing */
 
-    *fptr = 0;                   /* initialize null file pointer */
+    if (driverTable[Fptr->driver].open != file_open)
+        return;    /* only plain disk files are indexed */
 
-    if (need_to_initialize)           /* this is called only once */
-    {
-        *status = fits_init_cfitsio();
+    if (ffiurl(Fptr->filename, urltype, infile, outfile, extspec,
+               rowfilter, binspec, colspec, &tstatus) > 0)
+        return;
 
-        if (*status > 0)
-            return(*status);
+    if (fits_stat_hduindex(infile, &modtime))
+        return;    /* cannot validate the file later, so don't index it */
+
+    offsets = (LONGLONG *) malloc((Fptr->maxhdu + 2) * sizeof(LONGLONG));
+    if (!offsets)
+        return;
+
+    for (ii = 0; ii <= Fptr->maxhdu + 1; ii++)
+        offsets[ii] = Fptr->headstart[ii];
+
+    FFLOCK;
+
+    /* reuse the entry for this file, else recycle the oldest entry */
+    entry = 0;
+    oldest = 0;
+    for (ii = 0; ii < MAX_HDUINDEX; ii++)
+    {
+        if (!strcmp(hduIndexTable[ii].filename, infile))
+        {
+            entry = &hduIndexTable[ii];
+            break;
+        }
+        if (hduIndexTable[ii].age < hduIndexTable[oldest].age)
+            oldest = ii;
     }
 
-    url = (char *) name;
-    while (*url == ' ')  /* ignore leading spaces in the file spec */
-        url++;
+    if (!entry)
+        entry = &hduIndexTable[oldest];
 
-        /* parse the input file specification */
-    fits_parse_input_url(url, urltype, infile, outfile, extspec,
-              rowfilter, binspec, colspec, status);
+    if (entry->headstart)
+        free(entry->headstart);
 
-    strcpy(urltype, "memkeep://");   /* URL type for pre-existing memory file */
+    strcpy(entry->filename, infile);
+    entry->filesize = Fptr->filesize;
+    entry->modtime = modtime;
+    entry->maxhdu = Fptr->maxhdu;
+    entry->headstart = offsets;
+    entry->age = ++hduindexclock;
 
-    *status = urltype2driver(urltype, &driver);
+    FFUNLOCK;
+}
+/*--------------------------------------------------------------------------*/
+static void fits_load_hduindex(fitsfile *fptr,  /* I - opened FITS file  */
+            char *infile)                       /* I - parsed file name  */
+/*
+  if the HDU offsets of this disk file were saved when it was last
+  closed, and the file has not changed since (same size and same
+  modification time), restore them so that ffmahd can move directly
+  to any previously visited extension.
+*/
+{
+    hduindexentry *entry;
+    LONGLONG *ptr;
+    long modtime;
+    int ii;
+    FITSfile *Fptr = fptr->Fptr;
 
-    if (*status > 0)
+    if (driverTable[Fptr->driver].open != file_open)
+        return;    /* only plain disk files are indexed */
+
+    if (fits_stat_hduindex(infile, &modtime))
+        return;
+
+    FFLOCK;
+
+    entry = 0;
+    for (ii = 0; ii < MAX_HDUINDEX; ii++)
     {
-        ffpmsg("could not find driver for pre-existing memory file: (ffomem)");
-        return(*status);
+        if (!strcmp(hduIndexTable[ii].filename, infile) &&
+            hduIndexTable[ii].filesize == Fptr->filesize &&
+            hduIndexTable[ii].modtime == modtime &&
+            hduIndexTable[ii].headstart)
+        {
+            entry = &hduIndexTable[ii];
+            break;
+        }
+    }
+
+    if (entry)
+    {
+        if (entry->maxhdu + 1 >= Fptr->MAXHDU)
+        {
+            /* enlarge the headstart array, as ffmahd would */
+            ptr = (LONGLONG *) realloc(Fptr->headstart,
+                            (entry->maxhdu + 1001) * sizeof(LONGLONG));
+            if (!ptr)
+            {
+                FFUNLOCK;
+                return;    /* keep the sequential behavior */
+            }
+            Fptr->MAXHDU = entry->maxhdu + 1000;
+            Fptr->headstart = ptr;
+        }
+
+        for (ii = 0; ii <= entry->maxhdu + 1; ii++)
+            Fptr->headstart[ii] = entry->headstart[ii];
+
+        Fptr->maxhdu = entry->maxhdu;
+        entry->age = ++hduindexclock;
     }
 
-    /* call driver routine to open the memory file */
-    FFLOCK;  /* lock this while searching for vacant handle */
-    *status =   mem_openmem( buffptr, buffsize,deltasize,
-                            mem_realloc,  &handle);
     FFUNLOCK;
+}
+/*--------------------------------------------------------------------------*/
+static void fits_drop_hduindex(char *filename)
+/*
+  discard any cached HDU index for a file that is being deleted
+*/
+{
+    char urltype[MAX_PREFIX_LEN], infile[FLEN_FILENAME], outfile[FLEN_FILENAME];
+    char extspec[FLEN_FILENAME], rowfilter[FLEN_FILENAME];
+    char binspec[FLEN_FILENAME], colspec[FLEN_FILENAME];
+    int ii, tstatus = 0;
 
-    if (*status > 0)
+    if (ffiurl(filename, urltype, infile, outfile, extspec,
+               rowfilter, binspec, colspec, &tstatus) > 0)
+        return;
+
+    FFLOCK;
+
+    for (ii = 0; ii < MAX_HDUINDEX; ii++)
     {
-         ffpmsg("failed to open pre-existing memory file: (ffomem)");
-         return(*status);
+        if (!strcmp(hduIndexTable[ii].filename, infile))
+        {
+            free(hduIndexTable[ii].headstart);
+            hduIndexTable[ii].headstart = 0;
+            hduIndexTable[ii].filename[0] = '\0';
+            break;
+        }
     }
 
+    FFUNLOCK;
+}
+/*--------------------------------------------------------------------------*/
+static int mem_open_from_handle(fitsfile **fptr, /* O - FITS file pointer    */
+           const char *url,      /* I - name of file that was opened        */
+           char *extspec,        /* I - extension specifier from the URL    */
+           int mode,             /* I - 0 = open readonly; 1 = read/write   */
+           int driver,           /* I - driver number of the opened file    */
+           int handle,           /* I - handle of the opened memory file    */
+           int *status)          /* IO - error status                       */
+/*
+  Build the fitsfile structure around an already-opened memory file
+  handle.  This does the work shared by ffomem and ffomemro once the
+  driver routine has opened the memory file.
+*/
+{
+    int hdutyp, slen, movetotype, extvers, extnum;
+    char extname[FLEN_VALUE];
+    LONGLONG filesize;
+    char errmsg[FLEN_ERRMSG];
+    char *hdtype[3] = {"IMAGE", "TABLE", "BINTABLE"};
+    char imagecolname[FLEN_VALUE], rowexpress[FLEN_FILENAME];
+
         /* get initial file size */
     *status = (*driverTable[driver].size)(handle, &filesize);
 
@@ -239,8 +398,8 @@ int ffomem(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* mem for file I/O buffers */
-    ((*fptr)->Fptr)->iobuffer = (char *) calloc(NIOBUF, IOBUFLEN);
+    /* mem for file I/O buffers and their bookkeeping arrays */
+    ffiobf((*fptr)->Fptr);
 
     if ( !(((*fptr)->Fptr)->iobuffer) )
     {
@@ -255,13 +414,6 @@ int ffomem(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* initialize the ageindex array (relative age of the I/O buffers) */
-    /* and initialize the bufrecnum array as being empty */
-    for (ii = 0; ii < NIOBUF; ii++)  {
-        ((*fptr)->Fptr)->ageindex[ii] = ii;
-        ((*fptr)->Fptr)->bufrecnum[ii] = -1;
-    }
-
         /* store the parameters describing the file */
     ((*fptr)->Fptr)->MAXHDU = 1000;              /* initial size of headstart */
     ((*fptr)->Fptr)->filehandle = handle;        /* file handle */
@@ -481,6 +633,139 @@ int ffopentest(int soname,       /* I - CFITSIO shared library version     */
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
+int ffomem(fitsfile **fptr,      /* O - FITS file pointer                   */ 
+           const char *name,     /* I - name of file to open                */
+           int mode,             /* I - 0 = open readonly; 1 = read/write   */
+           void **buffptr,       /* I - address of memory pointer           */
+           size_t *buffsize,     /* I - size of buffer, in bytes            */
+           size_t deltasize,     /* I - increment for future realloc's      */
+           void *(*mem_realloc)(void *p, size_t newsize), /* function       */
+           int *status)          /* IO - error status                       */
+/*
+  Open an existing FITS file in core memory.  This is a specialized version
+  of ffopen.
+*/
+{
+    int driver, handle;
+    char urltype[MAX_PREFIX_LEN], infile[FLEN_FILENAME], outfile[FLEN_FILENAME];
+    char extspec[FLEN_FILENAME], rowfilter[FLEN_FILENAME];
+    char binspec[FLEN_FILENAME], colspec[FLEN_FILENAME];
+    char *url;
+
+    if (*status > 0)
+        return(*status);
+
+    *fptr = 0;                   /* initialize null file pointer */
+
+    if (need_to_initialize)           /* this is called only once */
+    {
+        *status = fits_init_cfitsio();
+
+        if (*status > 0)
+            return(*status);
+    }
+
+    url = (char *) name;
+    while (*url == ' ')  /* ignore leading spaces in the file spec */
+        url++;
+
+        /* parse the input file specification */
+    fits_parse_input_url(url, urltype, infile, outfile, extspec,
+              rowfilter, binspec, colspec, status);
+
+    strcpy(urltype, "memkeep://");   /* URL type for pre-existing memory file */
+
+    *status = urltype2driver(urltype, &driver);
+
+    if (*status > 0)
+    {
+        ffpmsg("could not find driver for pre-existing memory file: (ffomem)");
+        return(*status);
+    }
+
+    /* call driver routine to open the memory file */
+    FFLOCK;  /* lock this while searching for vacant handle */
+    *status =   mem_openmem( buffptr, buffsize,deltasize,
+                            mem_realloc,  &handle);
+    FFUNLOCK;
+
+    if (*status > 0)
+    {
+         ffpmsg("failed to open pre-existing memory file: (ffomem)");
+         return(*status);
+    }
+
+    return( mem_open_from_handle(fptr, url, extspec, mode, driver,
+                                 handle, status) );
+}
+/*--------------------------------------------------------------------------*/
+int ffomemro(fitsfile **fptr,    /* O - FITS file pointer                   */
+           const char *name,     /* I - name of file to open                */
+           void *buffptr,        /* I - memory address of the FITS file     */
+           size_t buffsize,      /* I - size of the file, in bytes          */
+           int *status)          /* IO - error status                       */
+/*
+  Open an existing FITS file in core memory, read-only and without
+  copying it.  The buffer is borrowed from the caller: CFITSIO never
+  writes to it, never reallocates it, and does not free it when the
+  file is closed, so the caller must keep it allocated for the
+  lifetime of the fitsfile.  This is a specialized version of ffomem
+  for wrapping an external buffer (e.g. a memory-mapped file) with
+  zero copy.
+*/
+{
+    int driver, handle;
+    char urltype[MAX_PREFIX_LEN], infile[FLEN_FILENAME], outfile[FLEN_FILENAME];
+    char extspec[FLEN_FILENAME], rowfilter[FLEN_FILENAME];
+    char binspec[FLEN_FILENAME], colspec[FLEN_FILENAME];
+    char *url;
+
+    if (*status > 0)
+        return(*status);
+
+    *fptr = 0;                   /* initialize null file pointer */
+
+    if (need_to_initialize)           /* this is called only once */
+    {
+        *status = fits_init_cfitsio();
+
+        if (*status > 0)
+            return(*status);
+    }
+
+    url = (char *) name;
+    while (*url == ' ')  /* ignore leading spaces in the file spec */
+        url++;
+
+        /* parse the input file specification */
+    fits_parse_input_url(url, urltype, infile, outfile, extspec,
+              rowfilter, binspec, colspec, status);
+
+    strcpy(urltype, "memkeep://");   /* URL type for pre-existing memory file */
+
+    *status = urltype2driver(urltype, &driver);
+
+    if (*status > 0)
+    {
+        ffpmsg("could not find driver for pre-existing memory file: (ffomemro)");
+        return(*status);
+    }
+
+    /* call driver routine to borrow the memory file */
+    FFLOCK;  /* lock this while searching for vacant handle */
+    *status = mem_borrowmem(buffptr, buffsize, &handle);
+    FFUNLOCK;
+
+    if (*status > 0)
+    {
+         ffpmsg("failed to open pre-existing memory file: (ffomemro)");
+         return(*status);
+    }
+
+    return( mem_open_from_handle(fptr, url, extspec, READONLY, driver,
+                                 handle, status) );
+}
+/*--------------------------------------------------------------------------*/
 int ffopen(fitsfile **fptr,      /* O - FITS file pointer                   */ 
            const char *name,     /* I - full name of file to open           */
            int mode,             /* I - 0 = open readonly; 1 = read/write   */
@@ -490,7 +775,7 @@ int ffopen(fitsfile **fptr,      /* O - FITS file pointer                   */
 */
 {
     fitsfile *newptr;
-    int  ii, driver, hdutyp, hdunum, slen, writecopy, isopen;
+    int  driver, hdutyp, hdunum, slen, writecopy, isopen;
     LONGLONG filesize;
     long rownum, nrows, goodrows;
     int extnum, extvers, handle, movetotype, tstatus = 0, only_one = 0;
@@ -804,8 +1089,8 @@ int ffopen(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* mem for file I/O buffers */
-    ((*fptr)->Fptr)->iobuffer = (char *) calloc(NIOBUF, IOBUFLEN);
+    /* mem for file I/O buffers and their bookkeeping arrays */
+    ffiobf((*fptr)->Fptr);
 
     if ( !(((*fptr)->Fptr)->iobuffer) )
     {
@@ -820,13 +1105,6 @@ int ffopen(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* initialize the ageindex array (relative age of the I/O buffers) */
-    /* and initialize the bufrecnum array as being empty */
-    for (ii = 0; ii < NIOBUF; ii++)  {
-        ((*fptr)->Fptr)->ageindex[ii] = ii;
-        ((*fptr)->Fptr)->bufrecnum[ii] = -1;
-    }
-
         /* store the parameters describing the file */
     ((*fptr)->Fptr)->MAXHDU = 1000;              /* initial size of headstart */
     ((*fptr)->Fptr)->filehandle = handle;        /* file handle */
@@ -859,6 +1137,10 @@ int ffopen(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status);
     }
 
+    /* restore the HDU offset index saved when this file was last */
+    /* closed, if the file has not changed in the meantime         */
+    fits_load_hduindex(*fptr, infile);
+
     /* ------------------------------------------------------------- */
     /* At this point, the input file has been opened. If outfile was */
     /* specified, then we have opened a copy of the file, not the    */
@@ -3623,7 +3905,7 @@ int ffinit(fitsfile **fptr,      /* O - FITS file pointer                   */
   Create and initialize a new FITS file.
 */
 {
-    int ii, driver, slen, clobber = 0;
+    int driver, slen, clobber = 0;
     char *url;
     char urltype[MAX_PREFIX_LEN], outfile[FLEN_FILENAME];
     char tmplfile[FLEN_FILENAME], compspec[80];
@@ -3787,8 +4069,8 @@ int ffinit(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* mem for file I/O buffers */
-    ((*fptr)->Fptr)->iobuffer = (char *) calloc(NIOBUF, IOBUFLEN);
+    /* mem for file I/O buffers and their bookkeeping arrays */
+    ffiobf((*fptr)->Fptr);
 
     if ( !(((*fptr)->Fptr)->iobuffer) )
     {
@@ -3803,13 +4085,6 @@ int ffinit(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* initialize the ageindex array (relative age of the I/O buffers) */
-    /* and initialize the bufrecnum array as being empty */
-    for (ii = 0; ii < NIOBUF; ii++)  {
-        ((*fptr)->Fptr)->ageindex[ii] = ii;
-        ((*fptr)->Fptr)->bufrecnum[ii] = -1;
-    }
-
         /* store the parameters describing the file */
     ((*fptr)->Fptr)->MAXHDU = 1000;              /* initial size of headstart */
     ((*fptr)->Fptr)->filehandle = handle;        /* store the file pointer */
@@ -3852,7 +4127,7 @@ int ffimem(fitsfile **fptr,      /* O - FITS file pointer                   */
   Create and initialize a new FITS file in memory
 */
 {
-    int ii, driver, slen;
+    int driver, slen;
     char urltype[MAX_PREFIX_LEN];
     int handle;
 
@@ -3939,8 +4214,8 @@ int ffimem(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* mem for file I/O buffers */
-    ((*fptr)->Fptr)->iobuffer = (char *) calloc(NIOBUF, IOBUFLEN);
+    /* mem for file I/O buffers and their bookkeeping arrays */
+    ffiobf((*fptr)->Fptr);
 
     if ( !(((*fptr)->Fptr)->iobuffer) )
     {
@@ -3954,13 +4229,6 @@ int ffimem(fitsfile **fptr,      /* O - FITS file pointer                   */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* initialize the ageindex array (relative age of the I/O buffers) */
-    /* and initialize the bufrecnum array as being empty */
-    for (ii = 0; ii < NIOBUF; ii++)  {
-        ((*fptr)->Fptr)->ageindex[ii] = ii;
-        ((*fptr)->Fptr)->bufrecnum[ii] = -1;
-    }
-
         /* store the parameters describing the file */
     ((*fptr)->Fptr)->MAXHDU = 1000;              /* initial size of headstart */
     ((*fptr)->Fptr)->filehandle = handle;        /* file handle */
@@ -3979,12 +4247,39 @@ int ffimem(fitsfile **fptr,      /* O - FITS file pointer                   */
     return(*status); 
 }
 /*--------------------------------------------------------------------------*/
+int fits_set_all_threads(int nthreads) /* I - no. of threads for the        */
+                                       /*     threaded kernels; 1 disables  */
+                                       /*     threading and 0 means one     */
+                                       /*     thread per processor          */
+/*
+  set the number of threads used by every CFITSIO routine that supports
+  threading (checksums, histogram binning, hcompress, gzip, image
+  statistics) with a single call, so that an application can tune one
+  binary to the host it is running on.  The same setting can be applied
+  without code changes by defining the CFITSIO_NTHREADS environment
+  variable, which is read once when the library is initialized.
+  Returns the effective setting.
+*/
+{
+    int effective;
+
+    effective = fits_csum_set_threads(nthreads);
+    fits_hist_set_threads(nthreads);
+    fits_hcompress_set_threads(nthreads);
+    fits_hdecompress_set_threads(nthreads);
+    fits_gzip_set_threads(nthreads);
+    fits_img_stats_set_threads(nthreads);
+
+    return(effective);
+}
+/*--------------------------------------------------------------------------*/
 int fits_init_cfitsio(void)
 /*
   initialize anything that is required before using the CFITSIO routines
 */
 {
     int status;
+    char *nthreadsstr;
 
     union u_tag {
       short ival;
@@ -4714,7 +5009,78 @@ int fits_init_cfitsio(void)
         return(status);
     }
 
+#ifdef HAVE_MMAP_DRIVER
+    /* 25------------memory-mapped read-only disk file driver------------*/
+    status = fits_register_driver("mmapfile://",
+            mmap_init,
+            NULL,            /* no special shutdown needed */
+            NULL,            /* setoptions not needed */
+            NULL,            /* getoptions not needed */
+            NULL,            /* getversion not needed */
+            NULL,            /* checkfile not needed */
+            mmap_open,
+            NULL,            /* create function not allowed */
+            NULL,            /* no truncate function */
+            mmap_close,
+            file_remove,
+            mmap_size,
+            NULL,            /* flush function not required */
+            mmap_seek,
+            mmap_read,
+            mmap_write);
+
+    if (status)
+    {
+        ffpmsg("failed to register the mmapfile:// driver (init_cfitsio)");
+        FFUNLOCK;
+        return(status);
+    }
+#endif
+
+#ifdef HAVE_NET_SERVICES
+    /* 26------------http range-request driver with block cache---------*/
+    status = fits_register_driver("httprange://",
+            http_range_init,
+            NULL,            /* no special shutdown needed */
+            NULL,            /* setoptions not needed */
+            NULL,            /* getoptions not needed */
+            NULL,            /* getversion not needed */
+            NULL,            /* checkfile not needed */
+            http_range_open,
+            NULL,            /* create function not allowed */
+            NULL,            /* no truncate function */
+            http_range_close,
+            NULL,            /* remove function not allowed */
+            http_range_size,
+            NULL,            /* flush function not required */
+            http_range_seek,
+            http_range_read,
+            http_range_write);
+
+    if (status)
+    {
+        ffpmsg("failed to register the httprange:// driver (init_cfitsio)");
+        FFUNLOCK;
+        return(status);
+    }
+#endif
+
     /* reset flag.  Any other threads will now not need to call this routine */
+    /* apply the CFITSIO_NTHREADS environment override, if defined, so */
+    /* that a single binary can be tuned per host; 1 disables threading */
+    /* and 0 means one thread per processor */
+
+    nthreadsstr = getenv("CFITSIO_NTHREADS");
+    if (nthreadsstr)
+    {
+        char *endptr;
+        long nthreads;
+
+        nthreads = strtol(nthreadsstr, &endptr, 10);
+        if (endptr != nthreadsstr && *endptr == '\0' && nthreads >= 0)
+            fits_set_all_threads((int) nthreads);
+    }
+
     need_to_initialize = 0;
 
     FFUNLOCK;
@@ -6874,7 +7240,11 @@ int ffclos(fitsfile *fptr,      /* I - FITS file pointer */
             }
         }
 
+        fits_save_hduindex(fptr->Fptr);  /* remember the HDU offsets */
+
         fits_clear_Fptr( fptr->Fptr, status);  /* clear Fptr address */
+        free((fptr->Fptr)->keyindex);    /* free the keyword index */
+        free((fptr->Fptr)->colindex);    /* free the column name index */
         free((fptr->Fptr)->iobuffer);    /* free memory for I/O buffers */
         free((fptr->Fptr)->headstart);    /* free memory for headstart array */
         free((fptr->Fptr)->filename);     /* free memory for the filename */
@@ -6953,7 +7323,11 @@ int ffdelt(fitsfile *fptr,      /* I - FITS file pointer */
         free(basename);
     }
 
+    fits_drop_hduindex((fptr->Fptr)->filename);  /* forget the HDU offsets */
+
     fits_clear_Fptr( fptr->Fptr, status);  /* clear Fptr address */
+    free((fptr->Fptr)->keyindex);    /* free the keyword index */
+    free((fptr->Fptr)->colindex);    /* free the column name index */
     free((fptr->Fptr)->iobuffer);    /* free memory for I/O buffers */
     free((fptr->Fptr)->headstart);    /* free memory for headstart array */
     free((fptr->Fptr)->filename);     /* free memory for the filename */
@@ -7052,6 +7426,22 @@ int ffread( FITSfile *fptr,   /* I - FITS file pointer              */
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
+int fits_prefetch_hint( fitsfile *fptr, /* I - FITS file pointer            */
+            LONGLONG offset,  /* I - byte offset of the range in the file   */
+            long nbytes)      /* I - length of the range in bytes           */
+/*
+  low level routine to hint that a range of the file will be read soon,
+  so the read can be scheduled ahead of time.  Only the disk file driver
+  acts on the hint; for all other drivers this is a no-op.  The hint is
+  advisory only, so no errors are ever reported.
+*/
+{
+    if (driverTable[(fptr->Fptr)->driver].read == file_read)
+        file_prefetch((fptr->Fptr)->filehandle, offset, nbytes);
+
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
 int fftplt(fitsfile **fptr,      /* O - FITS file pointer                   */
            const char *filename, /* I - name of file to create              */
            const char *tempname, /* I - name of template file               */
@@ -8,6 +8,200 @@
 #include <string.h>
 #include <stdlib.h>
 #include "fitsio2.h"
+
+/*
+   The 32-bit 1's complement checksum is an end-around-carry sum, i.e.
+   addition modulo 2^32-1, which is commutative and associative: blocks
+   may be summed in any grouping and the folded partial sums combined
+   with the same carry fold.  ffcsum exploits this in two ways.  The
+   accumulation kernel sums four 16-bit values per 64-bit word, keeping
+   the hi and lo halves of the checksum in separate 32-bit lanes of two
+   64-bit accumulators (wide adds with the carries folded out when the
+   lanes could overflow), which the compiler can vectorize further.  And
+   when a thread count has been set with fits_csum_set_threads, the
+   blocks of each batch are spread over a small pool of worker threads
+   and the partial sums combined, following the scheme used in
+   fits_hcompress.c.  Reading the file itself remains sequential.
+*/
+
+#if !defined(_WIN32)
+#define HAVE_CSUM_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define CSUM_MAX_THREADS 16
+/* number of 2880-byte blocks read and summed per batch (per thread) */
+#define CSUM_BATCH_BLOCKS 64
+/* minimum blocks in a batch before spreading them over threads pays off */
+#define CSUM_THREAD_MIN_BLOCKS 16
+
+/* effective number of worker threads; 1 disables threading */
+static int csum_nthreads = 1;
+
+int fits_csum_set_threads(int nthreads)
+{
+/*
+   Set the number of threads used to accumulate the FITS checksum in
+   subsequent ffcsum calls: 1 disables threading and 0 means one thread
+   per processor.  Returns the effective setting.
+*/
+#ifdef HAVE_CSUM_THREADS
+    if (nthreads < 0) nthreads = 1;
+    if (nthreads == 0) {
+        long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (nproc > 0) ? (int) nproc : 1;
+    }
+    if (nthreads > CSUM_MAX_THREADS) nthreads = CSUM_MAX_THREADS;
+    csum_nthreads = nthreads;
+#else
+    csum_nthreads = 1;
+#endif
+    return(csum_nthreads);
+}
+
+/*------------------------------------------------------------------------*/
+static unsigned long csum_sum_blocks(const unsigned short *sbuf, long nblk,
+                                     unsigned long sum)
+/*
+   Accumulate nblk 2880-byte blocks (already in native short order) onto
+   the folded checksum sum, and return the new folded checksum.
+*/
+{
+    const unsigned long long lanemask = 0x0000FFFF0000FFFFULL;
+    unsigned long long shi, slo, acchi, acclo, w, hicarry, locarry;
+    const unsigned long long *wbuf;
+    long ii, nw, done, chunk;
+
+    shi = (sum >> 16);
+    slo = sum & 0xFFFF;
+
+    done = 0;
+    while (done < nblk)
+    {
+      /* each 32-bit lane gets one <= 0xFFFF addend per 64-bit word, so
+         the lanes cannot overflow within a 128-block chunk */
+      chunk = nblk - done;
+      if (chunk > 128) chunk = 128;
+
+      wbuf = (const unsigned long long *) (sbuf + done*1440);
+      nw = chunk*360;
+      acchi = 0;
+      acclo = 0;
+      for (ii = 0; ii < nw; ii++)
+      {
+        w = wbuf[ii];
+#if BYTESWAPPED
+        acchi += w & lanemask;
+        acclo += (w >> 16) & lanemask;
+#else
+        acchi += (w >> 16) & lanemask;
+        acclo += w & lanemask;
+#endif
+      }
+      shi += (acchi & 0xFFFFFFFFULL) + (acchi >> 32);
+      slo += (acclo & 0xFFFFFFFFULL) + (acclo >> 32);
+      done += chunk;
+    }
+
+    hicarry = shi >> 16;    /* fold carry bits in */
+    locarry = slo >> 16;
+
+    while (hicarry | locarry)
+    {
+      shi = (shi & 0xFFFF) + locarry;
+      slo = (slo & 0xFFFF) + hicarry;
+      hicarry = shi >> 16;
+      locarry = slo >> 16;
+    }
+
+    return((unsigned long) ((shi << 16) + slo));
+}
+/*------------------------------------------------------------------------*/
+#ifdef HAVE_CSUM_THREADS
+/* one range of blocks summed by a single thread */
+typedef struct {
+    const unsigned short *sbuf;
+    long nblk;
+    unsigned long partial;
+} csum_strip;
+
+static void *csum_strip_run(void *arg)
+{
+    csum_strip *s = (csum_strip *) arg;
+
+    s->partial = csum_sum_blocks(s->sbuf, s->nblk, 0UL);
+    return(NULL);
+}
+#endif /* HAVE_CSUM_THREADS */
+/*------------------------------------------------------------------------*/
+static void csum_batch(const unsigned short *sbuf, long nblk,
+                       unsigned long *sum)
+/*
+   Accumulate one batch of blocks onto *sum, spreading the blocks over
+   the worker threads when enough of them are available.
+*/
+{
+#ifdef HAVE_CSUM_THREADS
+    if (csum_nthreads > 1 && nblk >= CSUM_THREAD_MIN_BLOCKS)
+    {
+      pthread_t threads[CSUM_MAX_THREADS];
+      csum_strip strips[CSUM_MAX_THREADS];
+      unsigned long long shi, slo, hicarry, locarry;
+      long chunk;
+      int idx, nthreads;
+
+      nthreads = csum_nthreads;
+      chunk = (nblk + nthreads - 1) / nthreads;
+      for (idx = 0; idx < nthreads; idx++)
+      {
+        strips[idx].sbuf = sbuf + ((long) idx)*chunk*1440;
+        strips[idx].nblk = chunk;
+        if (((long) idx)*chunk + chunk > nblk)
+            strips[idx].nblk = nblk - ((long) idx)*chunk;
+        if (strips[idx].nblk < 0)
+            strips[idx].nblk = 0;
+        /* the last strip runs on this thread; if a worker cannot be
+           created its strip simply runs here too */
+        if (idx == nthreads - 1 ||
+                pthread_create(&threads[idx], NULL, csum_strip_run,
+                               &strips[idx]) != 0) {
+            threads[idx] = pthread_self();
+            csum_strip_run(&strips[idx]);
+        }
+      }
+      for (idx = 0; idx < nthreads; idx++)
+      {
+        if (!pthread_equal(threads[idx], pthread_self()))
+            pthread_join(threads[idx], NULL);
+      }
+
+      /* combine the folded partial sums with the same carry fold */
+      shi = (*sum >> 16);
+      slo = *sum & 0xFFFF;
+      for (idx = 0; idx < nthreads; idx++)
+      {
+        shi += (strips[idx].partial >> 16);
+        slo += (strips[idx].partial & 0xFFFF);
+      }
+
+      hicarry = shi >> 16;
+      locarry = slo >> 16;
+
+      while (hicarry | locarry)
+      {
+        shi = (shi & 0xFFFF) + locarry;
+        slo = (slo & 0xFFFF) + hicarry;
+        hicarry = shi >> 16;
+        locarry = slo >> 16;
+      }
+
+      *sum = (unsigned long) ((shi << 16) + slo);
+      return;
+    }
+#endif
+    *sum = csum_sum_blocks(sbuf, nblk, *sum);
+}
 /*------------------------------------------------------------------------*/
 int ffcsum(fitsfile *fptr,      /* I - FITS file pointer                  */
            long nrec,           /* I - number of 2880-byte blocks to sum  */
@@ -23,9 +217,14 @@ int ffcsum(fitsfile *fptr,      /* I - FITS file pointer                  */
     sampled evenly. 
 */
 {
-    long ii, jj;
-    unsigned short sbuf[1440];
-    unsigned long hi, lo, hicarry, locarry;
+    long jj, nblk, batch;
+    LONGLONG begpos;
+    union {
+        unsigned short sbuf[1440];
+        unsigned long long align8;  /* force the alignment the summing
+                                       kernel's 64-bit loads require */
+    } ubuf;
+    unsigned short *bigbuf;
 
     if (*status > 0)
         return(*status);
@@ -33,38 +232,57 @@ int ffcsum(fitsfile *fptr,      /* I - FITS file pointer                  */
     Sum the specified number of FITS 2880-byte records.  This assumes that
     the FITSIO file pointer points to the start of the records to be summed.
     Read each FITS block as 1440 short values (do byte swapping if needed).
+    The blocks are read in batches so that the accumulation kernel (and
+    the optional worker threads) can cover many blocks per call; if the
+    batch buffer cannot be allocated, fall back to one block at a time.
   */
-    for (jj = 0; jj < nrec; jj++)
+    batch = CSUM_BATCH_BLOCKS * (long) csum_nthreads;
+    if (batch > nrec)
+        batch = nrec;
+
+    begpos = (fptr->Fptr)->bytepos;
+
+    bigbuf = NULL;
+    if (batch > 1)
+        bigbuf = (unsigned short *) malloc(batch*1440*sizeof(short));
+
+    if (bigbuf)
     {
-      ffgbyt(fptr, 2880, sbuf, status);
+      for (jj = 0; jj < nrec; jj += nblk)
+      {
+        nblk = nrec - jj;
+        if (nblk > batch)
+            nblk = batch;
+
+        /* reads this large bypass the IO buffers and do not advance the
+           recorded byte position, so position each batch explicitly */
+        ffmbyt(fptr, begpos + ((LONGLONG) jj)*2880, REPORT_EOF, status);
+        ffgbyt(fptr, nblk*2880, bigbuf, status);
 
 #if BYTESWAPPED
 
-      ffswap2( (short *)sbuf, 1440); /* reverse order of bytes in each value */
+        ffswap2( (short *)bigbuf, nblk*1440); /* reverse order of bytes */
 
 #endif
 
-      hi = (*sum >> 16);
-      lo = *sum & 0xFFFF;
-
-      for (ii = 0; ii < 1440; ii += 2)
-      {
-        hi += sbuf[ii];
-        lo += sbuf[ii+1];
+        csum_batch(bigbuf, nblk, sum);
       }
+      free(bigbuf);
+    }
+    else
+    {
+      for (jj = 0; jj < nrec; jj++)
+      {
+        ffgbyt(fptr, 2880, ubuf.sbuf, status);
+
+#if BYTESWAPPED
 
-      hicarry = hi >> 16;    /* fold carry bits in */
-      locarry = lo >> 16;
+        ffswap2( (short *)ubuf.sbuf, 1440); /* reverse order of bytes in each value */
 
-      while (hicarry | locarry)
-      {
-        hi = (hi & 0xFFFF) + locarry;
-        lo = (lo & 0xFFFF) + hicarry;
-        hicarry = hi >> 16;
-        locarry = lo >> 16;
-      }
+#endif
 
-      *sum = (hi << 16) + lo;
+        *sum = csum_sum_blocks(ubuf.sbuf, 1, *sum);
+      }
     }
     return(*status);
 }
@@ -211,6 +211,43 @@ const unsigned long FAR * ZEXPORT get_crc_table()
     return (const unsigned long FAR *)crc_table;
 }
 
+/* =========================================================================
+ * On ARMv8 processors built with CRC extension support, the crc32
+ * instructions implement this same (reflected 0xedb88320) polynomial, so
+ * the whole computation reduces to one instruction per 8 bytes.  The x86
+ * SSE4.2 crc32 instruction uses the Castagnoli polynomial and therefore
+ * cannot be used here.
+ */
+#if defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_acle.h>
+#include <string.h>
+#define HAVE_CRC32_HW
+
+local unsigned long crc32_hw(unsigned long crc,
+                             const unsigned char FAR *buf, uInt len)
+{
+    unsigned int c = (unsigned int)crc ^ 0xffffffffUL;
+
+    while (len && ((ptrdiff_t)buf & 7)) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    while (len >= 8) {
+        unsigned long long w;
+
+        memcpy(&w, buf, 8);
+        c = __crc32d(c, w);
+        buf += 8;
+        len -= 8;
+    }
+    while (len) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    return (unsigned long)(c ^ 0xffffffffUL);
+}
+#endif /* __ARM_FEATURE_CRC32 */
+
 /* ========================================================================= */
 #define DO1 crc = crc_table[0][((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8)
 #define DO8 DO1; DO1; DO1; DO1; DO1; DO1; DO1; DO1
@@ -228,6 +265,10 @@ unsigned long ZEXPORT crc32(crc, buf, len)
         make_crc_table();
 #endif /* DYNAMIC_CRC_TABLE */
 
+#ifdef HAVE_CRC32_HW
+    return crc32_hw(crc, buf, len);
+#endif /* HAVE_CRC32_HW */
+
 #ifdef BYFOUR
     if (sizeof(void *) == sizeof(ptrdiff_t)) {
         u4 endian;
@@ -258,26 +299,80 @@ unsigned long ZEXPORT crc32(crc, buf, len)
             crc_table[1][(c >> 16) & 0xff] ^ crc_table[0][c >> 24]
 #define DOLIT32 DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4
 
+/* =========================================================================
+ * Tables of CRC-32s of all single-byte values followed by four to seven
+ * zero bytes, extending crc_table[0..3] so that eight data bytes can be
+ * folded per step instead of four.  They are derived from crc_table[0]
+ * on first use, with the same minimal first/empty flag protection as
+ * make_crc_table() above.
+ */
+local volatile int crc_slice8_empty = 1;
+local unsigned long FAR crc_slice8_table[4][256];
+
+local void make_crc_slice8_table()
+{
+    unsigned long c;
+    int n, k;
+    static volatile int first = 1;      /* flag to limit concurrent making */
+
+    if (first) {
+        first = 0;
+
+        for (n = 0; n < 256; n++) {
+            c = crc_table[3][n];
+            for (k = 0; k < 4; k++) {
+                c = crc_table[0][c & 0xff] ^ (c >> 8);
+                crc_slice8_table[k][n] = c;
+            }
+        }
+
+        crc_slice8_empty = 0;
+    }
+    else {      /* not first */
+        /* wait for the other guy to finish (not efficient, but rare) */
+        while (crc_slice8_empty)
+            ;
+    }
+}
+
+#define DOLIT8 c ^= buf4[0]; \
+        c2 = buf4[1]; \
+        buf4 += 2; \
+        c = crc_slice8_table[3][c & 0xff] ^ \
+            crc_slice8_table[2][(c >> 8) & 0xff] ^ \
+            crc_slice8_table[1][(c >> 16) & 0xff] ^ \
+            crc_slice8_table[0][c >> 24] ^ \
+            crc_table[3][c2 & 0xff] ^ crc_table[2][(c2 >> 8) & 0xff] ^ \
+            crc_table[1][(c2 >> 16) & 0xff] ^ crc_table[0][c2 >> 24]
+#define DOLIT64 DOLIT8; DOLIT8; DOLIT8; DOLIT8; DOLIT8; DOLIT8; DOLIT8; DOLIT8
+
 /* ========================================================================= */
 local unsigned long crc32_little(crc, buf, len)
     unsigned long crc;
     const unsigned char FAR *buf;
     unsigned len;
 {
-    register u4 c;
+    register u4 c, c2;
     register const u4 FAR *buf4;
 
+    if (crc_slice8_empty)
+        make_crc_slice8_table();
+
     c = (u4)crc;
     c = ~c;
-    while (len && ((ptrdiff_t)buf & 3)) {
+    while (len && ((ptrdiff_t)buf & 7)) {
         c = crc_table[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
         len--;
     }
 
     buf4 = (const u4 FAR *)(const void FAR *)buf;
-    while (len >= 32) {
-        DOLIT32;
-        len -= 32;
+    while (len >= 64) {
+        DOLIT64;
+        len -= 64;
+    }
+    while (len >= 8) {
+        DOLIT8;
+        len -= 8;
     }
     while (len >= 4) {
         DOLIT4;
@@ -6,6 +6,9 @@
 
 #include <string.h>
 #include <stdlib.h>
+#if defined(unix) || defined(__unix__)  || defined(__unix)
+#include <fcntl.h>       /* needed for the posix_fadvise read-ahead hint */
+#endif
 #include "fitsio2.h"
 
 #if defined(unix) || defined(__unix__)  || defined(__unix)
@@ -28,17 +31,44 @@
 #define IO_READ 1        /* last file I/O operation was a read */
 #define IO_WRITE 2       /* last file I/O operation was a write */
 
+#if defined(unix) || defined(__unix__)  || defined(__unix)
+#define HAVE_POSITIONED_IO  /* pread/pwrite are available */
+#include <unistd.h>
+#endif
+
 static char file_outfile[FLEN_FILENAME];
 
-typedef struct    /* structure containing disk file structure */ 
+/* when set, newly opened files are accessed with positioned pread/pwrite
+   calls on the raw descriptor, so each request is a single system call
+   and does not move a shared seek pointer */
+static int file_positioned = 0;
+
+typedef struct    /* structure containing disk file structure */
 {
     FILE *fileptr;
     LONGLONG currentpos;
     int last_io_op;
+    int positioned;  /* use positioned (pread/pwrite) I/O on this handle? */
 } diskdriver;
 
 static diskdriver handleTable[NMAXFILES]; /* allocate diskfile handle tables */
 
+/*--------------------------------------------------------------------------*/
+int fits_set_positioned_io(int flag)
+/*
+  Enable or disable positioned (pread/pwrite) I/O for subsequently opened
+  disk files.  Positioned requests carry their own file offset, so no
+  seek system calls are issued and concurrent readers of one file from
+  multiple threads do not serialize on a shared seek pointer.  Has no
+  effect on systems without pread.  Returns the adopted value.
+*/
+{
+#ifdef HAVE_POSITIONED_IO
+    file_positioned = (flag != 0);
+#endif
+    return(file_positioned);
+}
+
 /*--------------------------------------------------------------------------*/
 int file_init(void)
 {
@@ -150,6 +180,7 @@ int file_open(char *filename, int rwmode, int *handle)
     handleTable[*handle].fileptr = diskfile;
     handleTable[*handle].currentpos = 0;
     handleTable[*handle].last_io_op = IO_SEEK;
+    handleTable[*handle].positioned = file_positioned;
 
     return(status);
 }
@@ -429,6 +460,7 @@ int file_create(char *filename, int *handle)
     handleTable[ii].fileptr = diskfile;
     handleTable[ii].currentpos = 0;
     handleTable[ii].last_io_op = IO_SEEK;
+    handleTable[ii].positioned = file_positioned;
 
     return(0);
 }
@@ -576,6 +608,16 @@ int file_seek(int handle, LONGLONG offset)
 */
 {
 
+#ifdef HAVE_POSITIONED_IO
+    if (handleTable[handle].positioned)
+    {
+        /* positioned reads and writes carry their own file offset, */
+        /* so there is no seek pointer to move */
+        handleTable[handle].currentpos = offset;
+        return(0);
+    }
+#endif
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1400)
     
      /* Microsoft visual studio C++ */
@@ -608,12 +650,38 @@ int file_read(int hdl, void *buffer, long nbytes)
     long nread;
     char *cptr;
 
+#ifdef HAVE_POSITIONED_IO
+    if (handleTable[hdl].positioned)
+    {
+        /* single positioned system call; no seek pointer is involved */
+        nread = (long) pread(fileno(handleTable[hdl].fileptr), buffer,
+                (size_t) nbytes, (off_t) handleTable[hdl].currentpos);
+
+        if (nread == nbytes)
+        {
+            handleTable[hdl].currentpos += nbytes;
+            return(0);
+        }
+
+        if (nread == 1)
+        {
+            cptr = (char *) buffer;
+
+            /* some editors will add a single end-of-file character to a */
+            /* file.  Ignore it if the character is a zero, 10, or 32 */
+            if (*cptr == 0 || *cptr == 10 || *cptr == 32)
+                return(END_OF_FILE);
+        }
+        return(READ_ERROR);
+    }
+#endif
+
     if (handleTable[hdl].last_io_op == IO_WRITE)
     {
         if (file_seek(hdl, handleTable[hdl].currentpos))
             return(SEEK_ERROR);
     }
-  
+
     nread = (long) fread(buffer, 1, nbytes, handleTable[hdl].fileptr);
 
     if (nread == 1)
@@ -642,7 +710,21 @@ int file_write(int hdl, void *buffer, long nbytes)
   write bytes at the current position in the file
 */
 {
-    if (handleTable[hdl].last_io_op == IO_READ) 
+
+#ifdef HAVE_POSITIONED_IO
+    if (handleTable[hdl].positioned)
+    {
+        /* single positioned system call; no seek pointer is involved */
+        if ((long) pwrite(fileno(handleTable[hdl].fileptr), buffer,
+            (size_t) nbytes, (off_t) handleTable[hdl].currentpos) != nbytes)
+            return(WRITE_ERROR);
+
+        handleTable[hdl].currentpos += nbytes;
+        return(0);
+    }
+#endif
+
+    if (handleTable[hdl].last_io_op == IO_READ)
     {
         if (file_seek(hdl, handleTable[hdl].currentpos))
             return(SEEK_ERROR);
@@ -656,6 +738,21 @@ int file_write(int hdl, void *buffer, long nbytes)
     return(0);
 }
 /*--------------------------------------------------------------------------*/
+int file_prefetch(int hdl, LONGLONG offset, long nbytes)
+/*
+  hint that the given range of the file will be read soon, so the kernel
+  can schedule the disk read to overlap with other work.  This is purely
+  advisory: it never moves the file position and never reports an error.
+*/
+{
+#if defined(POSIX_FADV_WILLNEED)
+    if (handleTable[hdl].fileptr)
+        posix_fadvise(fileno(handleTable[hdl].fileptr), (off_t) offset,
+                      (off_t) nbytes, POSIX_FADV_WILLNEED);
+#endif
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
 int file_compress_open(char *filename, int rwmode, int *hdl)
 /*
   This routine opens the compressed diskfile by creating a new uncompressed
@@ -971,3 +1068,157 @@ int stream_write(int hdl, void *buffer, long nbytes)
 
 
 
+/****************************************************************************/
+/*                 memory-mapped read-only disk file driver                 */
+/*                                                                          */
+/*  The mmapfile:// driver maps the whole disk file into memory and serves  */
+/*  every read with a copy straight out of the kernel page cache, instead   */
+/*  of a read() system call per I/O buffer record.  Mapped files are       */
+/*  strictly read-only.                                                     */
+/****************************************************************************/
+
+#ifdef HAVE_MMAP_DRIVER
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct    /* structure containing mapped file structure */
+{
+    void *mapptr;          /* address of the mapping; 0 if slot is free */
+    LONGLONG mapsize;      /* length of the mapped file, in bytes */
+    LONGLONG currentpos;   /* current read position within the mapping */
+} mmapdriver;
+
+static mmapdriver mmapTable[NMAXFILES]; /* allocate mapped file handle table */
+
+/*--------------------------------------------------------------------------*/
+int mmap_init(void)
+{
+    int ii;
+
+    for (ii = 0; ii < NMAXFILES; ii++) /* initialize all empty slots in table */
+    {
+       mmapTable[ii].mapptr = 0;
+       mmapTable[ii].mapsize = 0;
+    }
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mmap_open(char *filename, int rwmode, int *handle)
+{
+    FILE *diskfile;
+    struct stat sbuf;
+    void *mapptr;
+    int ii, status;
+
+    if (rwmode != READONLY)     /* mapped files are strictly read-only */
+        return(READONLY_FILE);
+
+    *handle = -1;
+    for (ii = 0; ii < NMAXFILES; ii++)  /* find empty slot in table */
+    {
+        if (mmapTable[ii].mapptr == 0 && mmapTable[ii].mapsize == 0)
+        {
+            *handle = ii;
+            break;
+        }
+    }
+
+    if (*handle == -1)
+       return(TOO_MANY_FILES);    /* too many files opened */
+
+    /* open the file, with the usual ~user expansion and link handling */
+    status = file_openfile(filename, READONLY, &diskfile);
+    if (status)
+        return(status);
+
+    if (fstat(fileno(diskfile), &sbuf))
+    {
+        fclose(diskfile);
+        return(FILE_NOT_OPENED);
+    }
+
+    if (sbuf.st_size > 0)
+    {
+        mapptr = mmap(0, (size_t) sbuf.st_size, PROT_READ, MAP_SHARED,
+                      fileno(diskfile), 0);
+
+        if (mapptr == MAP_FAILED)
+        {
+            fclose(diskfile);
+            return(FILE_NOT_OPENED);
+        }
+    }
+    else
+        mapptr = 0;     /* can't map an empty file */
+
+    /* the mapping remains valid after the file descriptor is closed */
+    fclose(diskfile);
+
+    mmapTable[*handle].mapptr = mapptr;
+    mmapTable[*handle].mapsize = sbuf.st_size;
+    mmapTable[*handle].currentpos = 0;
+
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mmap_size(int handle, LONGLONG *filesize)
+/*
+  return the size of the mapped file in bytes
+*/
+{
+    *filesize = mmapTable[handle].mapsize;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mmap_close(int handle)
+/*
+  unmap the file and free the handle
+*/
+{
+    if (mmapTable[handle].mapptr)
+        munmap(mmapTable[handle].mapptr, (size_t) mmapTable[handle].mapsize);
+
+    mmapTable[handle].mapptr = 0;
+    mmapTable[handle].mapsize = 0;
+
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mmap_seek(int handle, LONGLONG offset)
+/*
+  seek to position relative to start of the file
+*/
+{
+    if (offset < 0 || offset > mmapTable[handle].mapsize)
+        return(SEEK_ERROR);
+
+    mmapTable[handle].currentpos = offset;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mmap_read(int handle, void *buffer, long nbytes)
+/*
+  copy bytes from the mapping at the current position; the data come
+  directly from the kernel page cache, with no read() system call
+*/
+{
+    if (mmapTable[handle].currentpos + nbytes > mmapTable[handle].mapsize)
+        return(END_OF_FILE);
+
+    memcpy(buffer, (char *) mmapTable[handle].mapptr +
+           mmapTable[handle].currentpos, nbytes);
+
+    mmapTable[handle].currentpos += nbytes;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mmap_write(int handle, void *buffer, long nbytes)
+/*
+  mapped files are read-only, so writing is always an error
+*/
+{
+    return(WRITE_ERROR);
+}
+
+#endif  /* HAVE_MMAP_DRIVER */
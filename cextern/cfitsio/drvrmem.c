@@ -37,6 +37,8 @@ typedef struct    /* structure containing mem file structure */
     LONGLONG currentpos;   /* current file position, relative to start */
     LONGLONG fitsfilesize; /* size of the FITS file (always <= *memsizeptr) */
     FILE *fileptr;      /* pointer to compressed output disk file */
+    int borrowed;        /* memory is borrowed from the caller and must */
+                         /* never be written to, reallocated, or freed */
 } memdriver;
 
 static memdriver memTable[NMAXFILES];  /* allocate mem file handle tables */
@@ -193,6 +195,46 @@ int mem_openmem(void **buffptr,   /* I - address of memory pointer          */
     memTable[ii].fitsfilesize = *buffsize;  /* size of FITS file (upper limit) */
     memTable[ii].currentpos = 0;            /* at beginning of the file */
     memTable[ii].mem_realloc = memrealloc;  /* memory realloc function */
+    memTable[ii].borrowed = 0;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+int mem_borrowmem(void *buffptr,  /* I - memory address of the FITS file    */
+                  size_t buffsize, /* I - size of the file, in bytes        */
+                  int *handle)
+/*
+  lowest level routine to open a pre-existing read-only memory file
+  without copying it.  The buffer is borrowed from the caller: the
+  driver never writes to it, never reallocates it, and does not free
+  it when the file is closed, so the caller must keep the buffer
+  allocated for the lifetime of the file.
+*/
+{
+    int ii;
+
+    *handle = -1;
+    for (ii = 0; ii < NMAXFILES; ii++)  /* find empty slot in handle table */
+    {
+        if (memTable[ii].memaddrptr == 0)
+        {
+            *handle = ii;
+            break;
+        }
+    }
+    if (*handle == -1)
+       return(TOO_MANY_FILES);    /* too many files opened */
+
+    /* store the address and size internally, so the caller does not */
+    /* have to keep the pointer variables themselves alive */
+    memTable[ii].memaddr = (char *) buffptr;
+    memTable[ii].memsize = buffsize;
+    memTable[ii].memaddrptr = &memTable[ii].memaddr;
+    memTable[ii].memsizeptr = &memTable[ii].memsize;
+    memTable[ii].deltasize = 0;
+    memTable[ii].fitsfilesize = buffsize;   /* size of FITS file (upper limit) */
+    memTable[ii].currentpos = 0;            /* at beginning of the file */
+    memTable[ii].mem_realloc = 0;           /* the file can never grow */
+    memTable[ii].borrowed = 1;
     return(0);
 }
 /*--------------------------------------------------------------------------*/
@@ -236,6 +278,7 @@ int mem_createmem(size_t msize, int *handle)
     memTable[ii].fitsfilesize = 0;
     memTable[ii].currentpos = 0;
     memTable[ii].mem_realloc = realloc;
+    memTable[ii].borrowed = 0;
     return(0);
 }
 /*--------------------------------------------------------------------------*/
@@ -246,6 +289,12 @@ int mem_truncate(int handle, LONGLONG filesize)
 {
     char *ptr;
 
+    if (memTable[handle].borrowed)
+    {
+        ffpmsg("cannot resize a borrowed read-only memory file (mem_truncate)");
+        return(WRITE_ERROR);
+    }
+
     /* call the memory reallocation function, if defined */
     if ( memTable[handle].mem_realloc )
     {    /* explicit LONGLONG->size_t cast */
@@ -1082,7 +1131,8 @@ int mem_close_free(int handle)
   close the file and free the memory.
 */
 {
-    free( *(memTable[handle].memaddrptr) );
+    if (!memTable[handle].borrowed)   /* borrowed memory belongs to caller */
+        free( *(memTable[handle].memaddrptr) );
 
     memTable[handle].memaddrptr = 0;
     memTable[handle].memaddr = 0;
@@ -1166,10 +1216,16 @@ int mem_write(int hdl, void *buffer, long nbytes)
     size_t newsize;
     char *ptr;
 
-    if ((size_t) (memTable[hdl].currentpos + nbytes) > 
+    if (memTable[hdl].borrowed)
+    {
+        ffpmsg("cannot write to a borrowed read-only memory file (mem_write)");
+        return(WRITE_ERROR);
+    }
+
+    if ((size_t) (memTable[hdl].currentpos + nbytes) >
          *(memTable[hdl].memsizeptr) )
     {
-               
+
         if (!(memTable[hdl].mem_realloc))
         {
             ffpmsg("realloc function not defined (mem_write)");
@@ -1178,15 +1234,20 @@ int mem_write(int hdl, void *buffer, long nbytes)
 
         /*
           Attempt to reallocate additional memory:
-          the memory buffer size is incremented by the larger of:
-             1 FITS block (2880 bytes) or
-             the defined 'deltasize' parameter
+          the memory buffer size is incremented by the largest of:
+             1 FITS block (2880 bytes),
+             the defined 'deltasize' parameter, or
+             the current allocation (i.e. the allocation is doubled),
+          so that writing a file in many small pieces costs a number of
+          reallocs that grows with the log of the file size, not linearly.
          */
 
         newsize = maxvalue( (size_t)
             (((memTable[hdl].currentpos + nbytes - 1) / 2880) + 1) * 2880,
             *(memTable[hdl].memsizeptr) + memTable[hdl].deltasize);
 
+        newsize = maxvalue(newsize, *(memTable[hdl].memsizeptr) * 2);
+
         /* call the realloc function */
         ptr = (memTable[hdl].mem_realloc)(
                                     *(memTable[hdl].memaddrptr),
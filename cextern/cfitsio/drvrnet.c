@@ -2738,4 +2738,485 @@ static int encode64(unsigned s_len, char *src, unsigned d_len, char *dst) {
 }
 
 
+
+/****************************************************************************/
+/*               HTTP range-request driver with a block cache               */
+/*                                                                          */
+/*  The httprange:// driver never downloads the whole remote file.  It      */
+/*  asks the server for its size and entity tag when the file is opened,    */
+/*  and then fetches only the blocks that are actually touched by reads,    */
+/*  using HTTP Range requests.  Large fetches are split into several        */
+/*  parallel range requests, each on its own connection.  Fetched blocks    */
+/*  are kept in a cache keyed by URL and entity tag which survives closing  */
+/*  the file, so reopening an unchanged file reuses the blocks already      */
+/*  downloaded.  The server must support byte ranges (e.g. any ordinary     */
+/*  web server); range-mapped files are read-only.                          */
+/****************************************************************************/
+
+#if !defined(_WIN32)
+#define HAVE_RANGE_THREADS
+#include <pthread.h>
+#endif
+
+#define RANGE_BLOCKSIZE 262144L  /* bytes fetched and cached per block */
+#define RANGE_MAXCACHE  10       /* remembered files, keyed by URL+ETag */
+#define RANGE_MAX_STREAMS 4      /* max parallel range requests per fetch */
+#define RANGE_MIN_PARALLEL 4     /* min blocks before a fetch is split */
+
+typedef struct     /* a remote file and its cache of fetched blocks */
+{
+    char url[MAXLEN];         /* URL, without the httprange:// prefix */
+    char etag[SHORTLEN];      /* entity tag reported by the server */
+    char connhost[SHORTLEN];  /* host to connect to (server or proxy) */
+    int  connport;            /* port to connect to */
+    char reqpath[MAXLEN];     /* path sent in the GET request line */
+    char hosthdr[SHORTLEN];   /* host name for the Host: header */
+    int  hostport;            /* port number for the Host: header */
+    LONGLONG filesize;        /* total size of the remote file */
+    long nblocks;             /* number of blocks covering the file */
+    char **blocks;            /* block buffers; 0 = not fetched yet */
+    int refcount;             /* number of open handles using this entry */
+    int age;                  /* age, for recycling closed entries */
+} rangecache;
+
+static rangecache rangeTable[RANGE_MAXCACHE];
+static int rangeclock = 0;
+
+typedef struct     /* an open handle into the range cache */
+{
+    rangecache *cache;        /* 0 if the handle is free */
+    LONGLONG currentpos;
+} rangehandle;
+
+static rangehandle rangeHandleTable[NMAXFILES];
+
+/*--------------------------------------------------------------------------*/
+static int range_request(rangecache *cache, LONGLONG offset, LONGLONG nbytes,
+        long firstblock, LONGLONG *totalsize, char *etag)
+/*
+  issue a single HTTP GET with a Range header on its own connection.
+  When firstblock >= 0 the response body is stored into the cache block
+  buffers starting at that block.  When firstblock is -1 only the
+  response headers are examined; this is used at open time, with a one
+  byte range, to learn the file size and entity tag of the remote file.
+*/
+{
+  FILE *httpfile;
+  char tmpstr[MAXLEN], recbuf[MAXLEN];
+  char *scratchstr;
+  int sock, status;
+  long block, len;
+  LONGLONG remaining, total;
+  float version;
+
+  sock = NET_TcpConnect(cache->connhost, cache->connport);
+  if (sock < 0) {
+    ffpmsg("Couldn't connect to host (range_request)");
+    ffpmsg(cache->connhost);
+    return (FILE_NOT_OPENED);
+  }
+
+  if (NULL == (httpfile = fdopen(sock, "r"))) {
+    ffpmsg("fdopen failed to convert socket to file (range_request)");
+    close(sock);
+    return (FILE_NOT_OPENED);
+  }
+
+  sprintf(tmpstr,
+     "GET %s HTTP/1.0\r\nUser-Agent: HEASARC/CFITSIO/%-8.3f\r\nHost: %s:%-d\r\nRange: bytes=%ld-%ld\r\n\r\n",
+      cache->reqpath, ffvers(&version), cache->hosthdr, cache->hostport,
+      (long) offset, (long) (offset + nbytes - 1));
+
+  status = NET_SendRaw(sock, tmpstr, strlen(tmpstr), NET_DEFAULT);
+  if (status != (int) strlen(tmpstr)) {
+    fclose(httpfile);
+    return (FILE_NOT_OPENED);
+  }
+
+  /* read the status line; a server without byte range support sends 200 */
+  if (!(fgets(recbuf, MAXLEN, httpfile))) {
+    ffpmsg("http response was short (range_request)");
+    fclose(httpfile);
+    return (FILE_NOT_OPENED);
+  }
+
+  status = 0;
+  sscanf(recbuf, "%s %d", tmpstr, &status);
+  if (status != 206) {
+    if (status == 200)
+      ffpmsg("Web server does not support byte ranges (range_request)");
+    fclose(httpfile);
+    return (FILE_NOT_OPENED);
+  }
+
+  /* read the rest of the header */
+  while (fgets(recbuf, MAXLEN, httpfile)) {
+    if (*recbuf == '\r') break;     /* a blank line ends the header */
+
+    if (!strncasecmp(recbuf, "Content-Range:", 14)) {
+      /* "Content-Range: bytes first-last/total" gives the file size */
+      scratchstr = strchr(recbuf, '/');
+      if (scratchstr && totalsize) {
+        total = 0;
+        for (scratchstr++; *scratchstr >= '0' && *scratchstr <= '9';
+             scratchstr++)
+            total = total * 10 + (*scratchstr - '0');
+        *totalsize = total;
+      }
+    }
+    else if (!strncasecmp(recbuf, "ETag:", 5) && etag) {
+      scratchstr = recbuf + 5;
+      while (*scratchstr == ' ') scratchstr++;
+      strncpy(etag, scratchstr, SHORTLEN - 1);
+      etag[SHORTLEN - 1] = '\0';
+      /* trim the trailing end of line characters */
+      scratchstr = etag + strlen(etag);
+      while (scratchstr > etag &&
+            (*(scratchstr-1) == '\r' || *(scratchstr-1) == '\n'))
+          *(--scratchstr) = '\0';
+    }
+  }
+
+  if (firstblock < 0) {   /* the headers were all that was wanted */
+    fclose(httpfile);
+    return (0);
+  }
+
+  /* store the body into the cache blocks, in order */
+  block = firstblock;
+  for (remaining = nbytes; remaining > 0; block++) {
+
+    len = (long) minvalue(remaining, RANGE_BLOCKSIZE);
+
+    if (!cache->blocks[block]) {
+        cache->blocks[block] = (char *) malloc(RANGE_BLOCKSIZE);
+        if (!cache->blocks[block]) {
+            fclose(httpfile);
+            return (MEMORY_ALLOCATION);
+        }
+    }
+
+    if ((long) fread(cache->blocks[block], 1, len, httpfile) != len) {
+        ffpmsg("error reading range response body (range_request)");
+        free(cache->blocks[block]);
+        cache->blocks[block] = 0;
+        fclose(httpfile);
+        return (READ_ERROR);
+    }
+
+    remaining -= len;
+  }
+
+  fclose(httpfile);
+  return (0);
+}
+
+#ifdef HAVE_RANGE_THREADS
+typedef struct     /* one share of a parallel range fetch */
+{
+    rangecache *cache;
+    long blo, bhi;     /* inclusive range of blocks to fetch */
+    int status;
+} rangefetch;
+
+static void *range_fetch_run(void *arg)
+/*
+  worker routine: fetch one run of blocks with a single range request
+*/
+{
+    rangefetch *job = (rangefetch *) arg;
+    LONGLONG offset, nbytes;
+
+    offset = (LONGLONG) job->blo * RANGE_BLOCKSIZE;
+    nbytes = minvalue((LONGLONG) (job->bhi + 1) * RANGE_BLOCKSIZE,
+                      job->cache->filesize) - offset;
+
+    job->status = range_request(job->cache, offset, nbytes, job->blo, 0, 0);
+    return (0);
+}
+#endif
+
+/*--------------------------------------------------------------------------*/
+static int range_fetch_blocks(rangecache *cache, long blo, long bhi)
+/*
+  fetch the (currently missing) blocks blo through bhi.  A large run is
+  split into up to RANGE_MAX_STREAMS parallel range requests, each
+  fetching a contiguous share of the blocks over its own connection.
+*/
+{
+  LONGLONG offset, nbytes;
+
+#ifdef HAVE_RANGE_THREADS
+  pthread_t threads[RANGE_MAX_STREAMS];
+  rangefetch jobs[RANGE_MAX_STREAMS];
+  long nrun, chunk, lo;
+  int nstream, ii, status;
+
+  nrun = bhi - blo + 1;
+  if (nrun >= RANGE_MIN_PARALLEL) {
+
+    nstream = RANGE_MAX_STREAMS;
+    if (nstream > nrun)
+        nstream = (int) nrun;
+
+    chunk = (nrun + nstream - 1) / nstream;
+    lo = blo;
+    for (ii = 0; ii < nstream; ii++) {
+        jobs[ii].cache = cache;
+        jobs[ii].blo = lo;
+        jobs[ii].bhi = minvalue(lo + chunk - 1, bhi);
+        jobs[ii].status = 0;
+        lo = jobs[ii].bhi + 1;
+    }
+
+    /* the last share is fetched on this thread */
+    for (ii = 0; ii < nstream - 1; ii++) {
+        if (pthread_create(&threads[ii], 0, range_fetch_run, &jobs[ii])) {
+            /* couldn't start a thread, so fetch this share serially */
+            threads[ii] = pthread_self();
+            range_fetch_run(&jobs[ii]);
+        }
+    }
+    range_fetch_run(&jobs[nstream - 1]);
+
+    status = jobs[nstream - 1].status;
+    for (ii = 0; ii < nstream - 1; ii++) {
+        if (!pthread_equal(threads[ii], pthread_self()))
+            pthread_join(threads[ii], 0);
+        if (jobs[ii].status)
+            status = jobs[ii].status;
+    }
+    return (status);
+  }
+#endif
+
+  offset = (LONGLONG) blo * RANGE_BLOCKSIZE;
+  nbytes = minvalue((LONGLONG) (bhi + 1) * RANGE_BLOCKSIZE,
+                    cache->filesize) - offset;
+
+  return (range_request(cache, offset, nbytes, blo, 0, 0));
+}
+/*--------------------------------------------------------------------------*/
+int http_range_init(void)
+{
+    int ii;
+
+    for (ii = 0; ii < NMAXFILES; ii++)
+        rangeHandleTable[ii].cache = 0;
+
+    return (0);
+}
+/*--------------------------------------------------------------------------*/
+int http_range_open(char *filename, int rwmode, int *handle)
+{
+  rangecache probe, *cache;
+  char turl[MAXLEN], errorstr[MAXLEN];
+  char proto[SHORTLEN], host[SHORTLEN], fn[MAXLEN];
+  char pproto[SHORTLEN], phost[SHORTLEN], pfn[MAXLEN];
+  char *proxy;
+  int port, pport, ii, oldest, status;
+  LONGLONG totalsize;
+
+  if (rwmode != READONLY)   /* remote range-mapped files are read-only */
+      return (READONLY_FILE);
+
+  *handle = -1;
+  for (ii = 0; ii < NMAXFILES; ii++)  /* find empty slot in table */
+  {
+      if (rangeHandleTable[ii].cache == 0)
+      {
+          *handle = ii;
+          break;
+      }
+  }
+
+  if (*handle == -1)
+      return (TOO_MANY_FILES);
+
+  if (strlen(filename) >= MAXLEN - 8)
+      return (URL_PARSE_ERROR);
+
+  /* parse the URL apart again */
+  strcpy(turl, "http://");
+  strcat(turl, filename);
+  if (NET_ParseUrl(turl, proto, host, &port, fn)) {
+    sprintf(errorstr, "URL Parse Error (http_range_open) %s", filename);
+    ffpmsg(errorstr);
+    return (URL_PARSE_ERROR);
+  }
+
+  memset(&probe, 0, sizeof(probe));
+  strcpy(probe.url, filename);
+  strcpy(probe.hosthdr, host);
+  probe.hostport = port;
+
+  /* we use a proxy if the http_proxy environment variable is set */
+  proxy = getenv("http_proxy");
+  if (proxy) {
+    if (NET_ParseUrl(proxy, pproto, phost, &pport, pfn)) {
+      sprintf(errorstr, "URL Parse Error (http_range_open) %s", proxy);
+      ffpmsg(errorstr);
+      return (URL_PARSE_ERROR);
+    }
+    strcpy(probe.connhost, phost);
+    probe.connport = pport;
+    sprintf(probe.reqpath, "http://%s:%-d%s", host, port, fn);
+  } else {
+    strcpy(probe.connhost, host);
+    probe.connport = port;
+    strcpy(probe.reqpath, fn);
+  }
+
+  /* ask the server for the file size and entity tag, with a 1 byte range */
+  totalsize = 0;
+  status = range_request(&probe, 0, 1, -1, &totalsize, probe.etag);
+  if (status)
+      return (status);
+
+  if (totalsize <= 0) {
+    ffpmsg("Server did not report the file size (http_range_open)");
+    return (FILE_NOT_OPENED);
+  }
+
+  /* is this file, unchanged, already in the cache? */
+  cache = 0;
+  for (ii = 0; ii < RANGE_MAXCACHE; ii++) {
+    if (rangeTable[ii].nblocks &&
+        !strcmp(rangeTable[ii].url, probe.url) &&
+        !strcmp(rangeTable[ii].etag, probe.etag) &&
+        rangeTable[ii].filesize == totalsize) {
+      cache = &rangeTable[ii];
+      break;
+    }
+  }
+
+  if (!cache) {
+    /* recycle the oldest entry that is not attached to an open handle */
+    oldest = -1;
+    for (ii = 0; ii < RANGE_MAXCACHE; ii++) {
+      if (rangeTable[ii].refcount == 0 &&
+         (oldest < 0 || rangeTable[ii].age < rangeTable[oldest].age))
+          oldest = ii;
+    }
+
+    if (oldest < 0)
+        return (TOO_MANY_FILES);
+
+    cache = &rangeTable[oldest];
+    if (cache->blocks) {
+      for (ii = 0; ii < cache->nblocks; ii++)
+          if (cache->blocks[ii])
+              free(cache->blocks[ii]);
+      free(cache->blocks);
+    }
+
+    probe.filesize = totalsize;
+    probe.nblocks = (long) ((totalsize - 1) / RANGE_BLOCKSIZE) + 1;
+    probe.blocks = (char **) calloc(probe.nblocks, sizeof(char *));
+    if (!probe.blocks)
+        return (MEMORY_ALLOCATION);
+
+    *cache = probe;
+  }
+
+  cache->refcount++;
+  cache->age = ++rangeclock;
+
+  rangeHandleTable[*handle].cache = cache;
+  rangeHandleTable[*handle].currentpos = 0;
+
+  return (0);
+}
+/*--------------------------------------------------------------------------*/
+int http_range_size(int handle, LONGLONG *filesize)
+/*
+  return the size of the remote file in bytes
+*/
+{
+    *filesize = rangeHandleTable[handle].cache->filesize;
+    return (0);
+}
+/*--------------------------------------------------------------------------*/
+int http_range_close(int handle)
+/*
+  detach the handle; the fetched blocks stay cached for a later reopen
+*/
+{
+    rangeHandleTable[handle].cache->refcount--;
+    rangeHandleTable[handle].cache = 0;
+    return (0);
+}
+/*--------------------------------------------------------------------------*/
+int http_range_seek(int handle, LONGLONG offset)
+/*
+  seek to position relative to the start of the file
+*/
+{
+    if (offset < 0 || offset > rangeHandleTable[handle].cache->filesize)
+        return (SEEK_ERROR);
+
+    rangeHandleTable[handle].currentpos = offset;
+    return (0);
+}
+/*--------------------------------------------------------------------------*/
+int http_range_read(int handle, void *buffer, long nbytes)
+/*
+  copy bytes from the block cache at the current position, first
+  fetching any missing blocks from the server with range requests
+*/
+{
+    rangecache *cache;
+    LONGLONG pos;
+    long blo, bhi, block, runlo, bufpos, len;
+    int status;
+    char *cptr;
+
+    cache = rangeHandleTable[handle].cache;
+    pos = rangeHandleTable[handle].currentpos;
+
+    if (pos + nbytes > cache->filesize)
+        return (END_OF_FILE);
+
+    /* fetch each contiguous run of missing blocks with one request */
+    blo = (long) (pos / RANGE_BLOCKSIZE);
+    bhi = (long) ((pos + nbytes - 1) / RANGE_BLOCKSIZE);
+
+    runlo = -1;
+    for (block = blo; block <= bhi + 1; block++) {
+        if (block <= bhi && !cache->blocks[block]) {
+            if (runlo < 0)
+                runlo = block;
+        } else if (runlo >= 0) {
+            status = range_fetch_blocks(cache, runlo, block - 1);
+            if (status)
+                return (status);
+            runlo = -1;
+        }
+    }
+
+    /* copy the bytes out of the blocks */
+    cptr = (char *) buffer;
+    for (block = blo; block <= bhi; block++) {
+        bufpos = (long) (pos - (LONGLONG) block * RANGE_BLOCKSIZE);
+        len = (long) minvalue(nbytes, RANGE_BLOCKSIZE - bufpos);
+        memcpy(cptr, cache->blocks[block] + bufpos, len);
+        cptr += len;
+        pos += len;
+        nbytes -= len;
+    }
+
+    rangeHandleTable[handle].currentpos = pos;
+    cache->age = ++rangeclock;
+    return (0);
+}
+/*--------------------------------------------------------------------------*/
+int http_range_write(int handle, void *buffer, long nbytes)
+/*
+  remote range-mapped files are read-only, so writing is always an error
+*/
+{
+    return (WRITE_ERROR);
+}
+
+
 #endif
@@ -24,9 +24,351 @@
 #include <fcntl.h>
 
 #if defined(unix) || defined(__unix__)  || defined(__unix)
-#include <unistd.h> 
+#include <unistd.h>
 #endif
 
+#if defined(__linux__) && !defined(HAVE_SYSV_SHMEM_ONLY)
+#define SMEM_POSIX 1            /* use POSIX shared memory objects */
+#endif
+
+#ifdef SMEM_POSIX
+
+#include <sys/mman.h>
+
+/*
+   POSIX shared memory implementation of the shmem:// driver.  A segment
+   created by one process (which typically materializes a decompressed HDU
+   into it) can be opened by name in any number of other processes; every
+   process maps the same physical pages, so opening the segment involves
+   no copy of the data and no re-decode.  The segment starts with a small
+   header carrying a reference count of attached processes; a segment
+   marked for removal is unlinked when the last process detaches, and
+   otherwise persists like its SysV predecessor did.  The original SysV
+   implementation below is retained for systems without POSIX shared
+   memory.
+*/
+
+typedef struct                  /* header stored at the start of a segment */
+ {      int     ID;             /* checkpoint, identifies a valid segment */
+        int     h;              /* segment number from the shmem://h<n> URL */
+        int     refcnt;         /* number of processes attached */
+        int     delete_pending; /* unlink when the last process detaches */
+        LONGLONG size;          /* number of valid data bytes stored */
+ } posix_shm_head;
+
+typedef struct                  /* per-process state of an open segment */
+ {      int     fd;             /* shm_open descriptor, SHARED_INVALID if free */
+        int     h;              /* segment number */
+        int     rwmode;         /* READONLY or READWRITE */
+        posix_shm_head *head;   /* mapped segment: header followed by data */
+        size_t  maplen;         /* length of the current mapping */
+        LONGLONG seekpos;       /* current read/write position */
+ } posix_shm_seg;
+
+static posix_shm_seg posix_shm_tab[SHARED_MAXSEG];
+static int posix_shm_initialized = 0;
+static int shared_create_mode = 0666;   /* permission flags for created objects */
+
+static void posix_shm_init_tab(void)
+ { int i;
+
+   if (posix_shm_initialized) return;
+   for (i = 0; i < SHARED_MAXSEG; i++) posix_shm_tab[i].fd = SHARED_INVALID;
+   posix_shm_initialized = 1;
+ }
+
+static void posix_shm_name(char *buf, int h)
+ { sprintf(buf, "/cfitsio.shm.%d", h);
+ }
+
+static int posix_shm_getslot(void)              /* free slot in the local table */
+ { int i;
+
+   posix_shm_init_tab();
+   for (i = 0; i < SHARED_MAXSEG; i++)
+     if (SHARED_INVALID == posix_shm_tab[i].fd) return(i);
+   return(-1);
+ }
+
+static posix_shm_seg *posix_shm_handle(int driverhandle) /* validate a handle */
+ { if ((driverhandle < 0) || (driverhandle >= SHARED_MAXSEG)) return(NULL);
+   if (!posix_shm_initialized) return(NULL);
+   if (SHARED_INVALID == posix_shm_tab[driverhandle].fd) return(NULL);
+   return(posix_shm_tab + driverhandle);
+ }
+
+static int posix_shm_lock(int fd)       /* exclusive lock on the segment header */
+ { flock_t flk;
+
+   flk.l_type = F_WRLCK;
+   flk.l_whence = 0;
+   flk.l_start = 0;
+   flk.l_len = sizeof(posix_shm_head);
+   return((fcntl(fd, F_SETLKW, &flk) >= 0) ? SHARED_OK : SHARED_IPCERR);
+ }
+
+static int posix_shm_unlock(int fd)
+ { flock_t flk;
+
+   flk.l_type = F_UNLCK;
+   flk.l_whence = 0;
+   flk.l_start = 0;
+   flk.l_len = sizeof(posix_shm_head);
+   return((fcntl(fd, F_SETLK, &flk) >= 0) ? SHARED_OK : SHARED_IPCERR);
+ }
+
+static int posix_shm_map(posix_shm_seg *seg, size_t len) /* (re)map a segment */
+ { void *p;
+
+   if (NULL != seg->head) munmap((void *)seg->head, seg->maplen);
+   p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+   if (MAP_FAILED == p)
+     { seg->head = NULL;
+       seg->maplen = 0;
+       return(SHARED_NOMEM);
+     }
+   seg->head = (posix_shm_head *)p;
+   seg->maplen = len;
+   return(SHARED_OK);
+ }
+
+/************************* CFITSIO DRIVER FUNCTIONS ***************************/
+
+int     smem_init(void)
+ { posix_shm_init_tab();
+   return(0);
+ }
+
+int     smem_shutdown(void)
+ { int i;
+
+   if (!posix_shm_initialized) return(0);
+   for (i = 0; i < SHARED_MAXSEG; i++)
+     if (SHARED_INVALID != posix_shm_tab[i].fd) smem_close(i);
+   return(0);
+ }
+
+void    shared_cleanup(void)            /* kept for API compatibility */
+ { smem_shutdown();
+ }
+
+int     smem_setoptions(int option)
+ { option = 0;
+   return(0);
+ }
+
+int     smem_getoptions(int *options)
+ { if (NULL == options) return(SHARED_NULPTR);
+   *options = 0;
+   return(0);
+ }
+
+int     smem_getversion(int *version)
+ { if (NULL == version) return(SHARED_NULPTR);
+   *version = 20;
+   return(0);
+ }
+
+int     smem_open(char *filename, int rwmode, int *driverhandle)
+ { int h, slot, nitems, fd;
+   char name[40];
+   struct stat st;
+   posix_shm_seg *seg;
+
+   if (NULL == filename) return(SHARED_NULPTR);
+   if (NULL == driverhandle) return(SHARED_NULPTR);
+   nitems = sscanf(filename, "h%d", &h);
+   if (1 != nitems) return(SHARED_BADARG);
+
+   if (-1 == (slot = posix_shm_getslot())) return(SHARED_TABFULL);
+
+   /* always open the object read/write so that the attach count in the
+      header can be maintained; data writes are still refused unless the
+      caller asked for READWRITE access */
+   posix_shm_name(name, h);
+   fd = shm_open(name, O_RDWR, shared_create_mode);
+   if (fd < 0) return(SHARED_NOFILE);
+
+   seg = posix_shm_tab + slot;
+   seg->fd = fd;
+   seg->h = h;
+   seg->rwmode = rwmode;
+   seg->head = NULL;
+   seg->maplen = 0;
+   seg->seekpos = 0;
+
+   if ((fstat(fd, &st) < 0) || ((size_t)st.st_size < sizeof(posix_shm_head))
+        || (SHARED_OK != posix_shm_map(seg, (size_t)st.st_size)))
+     { close(fd);
+       seg->fd = SHARED_INVALID;
+       return(SHARED_BADARG);
+     }
+
+   if ((DAL_SHM_SEGHEAD_ID != seg->head->ID) || (h != seg->head->h))
+     { munmap((void *)seg->head, seg->maplen);
+       close(fd);
+       seg->fd = SHARED_INVALID;
+       return(SHARED_BADARG);
+     }
+
+   posix_shm_lock(fd);
+   seg->head->refcnt++;
+   posix_shm_unlock(fd);
+
+   *driverhandle = slot;
+   return(0);
+ }
+
+int     smem_create(char *filename, int *driverhandle)
+ { int h, slot, nitems, fd;
+   char name[40];
+   size_t len;
+   posix_shm_seg *seg;
+
+   if (NULL == filename) return(SHARED_NULPTR);
+   if (NULL == driverhandle) return(SHARED_NULPTR);
+   nitems = sscanf(filename, "h%d", &h);
+   if (1 != nitems) return(SHARED_BADARG);
+
+   if (-1 == (slot = posix_shm_getslot())) return(SHARED_TABFULL);
+
+   posix_shm_name(name, h);
+   fd = shm_open(name, O_RDWR | O_CREAT, shared_create_mode);
+   if (fd < 0) return(SHARED_NOFILE);
+
+   /* start with one FITS block of zeroed data, like the SysV driver did */
+   len = sizeof(posix_shm_head) + 2880;
+   len = ((len + SHARED_GRANUL - 1) / SHARED_GRANUL) * SHARED_GRANUL;
+   if (ftruncate(fd, (off_t)len) < 0)
+     { close(fd);
+       shm_unlink(name);
+       return(SHARED_NOMEM);
+     }
+
+   seg = posix_shm_tab + slot;
+   seg->fd = fd;
+   seg->h = h;
+   seg->rwmode = READWRITE;
+   seg->head = NULL;
+   seg->maplen = 0;
+   seg->seekpos = 0;
+
+   if (SHARED_OK != posix_shm_map(seg, len))
+     { close(fd);
+       shm_unlink(name);
+       seg->fd = SHARED_INVALID;
+       return(SHARED_NOMEM);
+     }
+
+   seg->head->ID = DAL_SHM_SEGHEAD_ID;
+   seg->head->h = h;
+   seg->head->refcnt = 1;
+   seg->head->delete_pending = 0;
+   seg->head->size = 2880;
+
+   *driverhandle = slot;
+   return(0);
+ }
+
+int     smem_close(int driverhandle)
+ { int unlink_it = 0;
+   char name[40];
+   posix_shm_seg *seg;
+
+   if (NULL == (seg = posix_shm_handle(driverhandle))) return(SHARED_BADARG);
+
+   posix_shm_lock(seg->fd);
+   seg->head->refcnt--;
+   if ((seg->head->refcnt <= 0) && seg->head->delete_pending) unlink_it = 1;
+   posix_shm_unlock(seg->fd);
+
+   munmap((void *)seg->head, seg->maplen);
+   if (unlink_it)
+     { posix_shm_name(name, seg->h);
+       shm_unlink(name);
+     }
+   close(seg->fd);
+   seg->fd = SHARED_INVALID;
+   return(0);
+ }
+
+int     smem_remove(char *filename)
+ { int h, r;
+
+   if (NULL == filename) return(SHARED_NULPTR);
+   if (SHARED_OK != (r = smem_open(filename, READWRITE, &h))) return(r);
+
+   posix_shm_lock(posix_shm_tab[h].fd);
+   posix_shm_tab[h].head->delete_pending = 1;
+   posix_shm_unlock(posix_shm_tab[h].fd);
+
+   return(smem_close(h));       /* unlinks when the last process detaches */
+ }
+
+int     smem_size(int driverhandle, LONGLONG *size)
+ { posix_shm_seg *seg;
+
+   if (NULL == size) return(SHARED_NULPTR);
+   if (NULL == (seg = posix_shm_handle(driverhandle))) return(SHARED_INVALID);
+   *size = seg->head->size;
+   return(0);
+ }
+
+int     smem_flush(int driverhandle)
+ { if (NULL == posix_shm_handle(driverhandle)) return(SHARED_INVALID);
+   return(0);                   /* shared pages need no explicit flushing */
+ }
+
+int     smem_seek(int driverhandle, LONGLONG offset)
+ { posix_shm_seg *seg;
+
+   if (offset < 0) return(SHARED_BADARG);
+   if (NULL == (seg = posix_shm_handle(driverhandle))) return(SHARED_INVALID);
+   seg->seekpos = offset;
+   return(0);
+ }
+
+int     smem_read(int driverhandle, void *buffer, long nbytes)
+ { posix_shm_seg *seg;
+
+   if (NULL == buffer) return(SHARED_NULPTR);
+   if (NULL == (seg = posix_shm_handle(driverhandle))) return(SHARED_INVALID);
+   if (nbytes < 0) return(SHARED_BADARG);
+   if ((seg->seekpos + nbytes) > seg->head->size)
+     return(SHARED_BADARG);             /* read beyond EOF */
+
+   memcpy(buffer, ((char *)(seg->head + 1)) + seg->seekpos, nbytes);
+   seg->seekpos += nbytes;
+   return(0);
+ }
+
+int     smem_write(int driverhandle, void *buffer, long nbytes)
+ { size_t needed, newlen;
+   posix_shm_seg *seg;
+
+   if (NULL == buffer) return(SHARED_NULPTR);
+   if (NULL == (seg = posix_shm_handle(driverhandle))) return(SHARED_INVALID);
+   if (READWRITE != seg->rwmode) return(SHARED_INVALID);
+   if (nbytes < 0) return(SHARED_BADARG);
+
+   needed = sizeof(posix_shm_head) + (size_t)(seg->seekpos + nbytes);
+   if (needed > seg->maplen)            /* need to grow the segment */
+     { newlen = ((needed + SHARED_GRANUL - 1) / SHARED_GRANUL) * SHARED_GRANUL;
+       if (ftruncate(seg->fd, (off_t)newlen) < 0) return(SHARED_NOMEM);
+       if (SHARED_OK != posix_shm_map(seg, newlen)) return(SHARED_NOMEM);
+     }
+
+   memcpy(((char *)(seg->head + 1)) + seg->seekpos, buffer, nbytes);
+   seg->seekpos += nbytes;
+   if (seg->seekpos > seg->head->size)
+     { posix_shm_lock(seg->fd);
+       if (seg->seekpos > seg->head->size) seg->head->size = seg->seekpos;
+       posix_shm_unlock(seg->fd);
+     }
+   return(0);
+ }
+
+#else  /* SysV shared memory implementation */
 
 static int shared_kbase = 0;                    /* base for shared memory handles */
 static int shared_maxseg = 0;                   /* max number of shared memory blocks */
@@ -970,4 +1312,5 @@ int     smem_write(int driverhandle, void *buffer, long nbytes)
    shared_lt[driverhandle].seekpos += nbytes;
    return(0);
  }
+#endif                          /* SMEM_POSIX */
 #endif
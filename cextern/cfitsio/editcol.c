@@ -480,6 +480,48 @@ and gives a list of rows or row ranges separated by commas.
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
+#define movebuffsize 1000000
+static int ffmvblk(fitsfile *fptr,  /* I - FITS file pointer               */
+           LONGLONG frombyte, /* I - absolute position of block to move    */
+           LONGLONG tobyte,   /* I - new absolute position of the block    */
+           LONGLONG nbytes,   /* I - size of the block, in bytes           */
+           unsigned char *buffer, /* I - copy workspace                    */
+           long buffsize,     /* I - size of the workspace, in bytes       */
+           int *status)       /* IO - error status                         */
+/*
+  Move a block of bytes towards the beginning of the file, copying
+  through the supplied workspace in large chunks.  Because the block
+  only ever moves towards the head of the file, and each chunk is read
+  before it is written, no byte is overwritten before it has been moved.
+*/
+{
+    long ntomov;
+
+    if (*status > 0)
+        return(*status);
+
+    while (nbytes)
+    {
+        ntomov = (long) (minvalue(nbytes, buffsize));
+
+        ffmbyt(fptr, frombyte, REPORT_EOF, status);
+        ffgbyt(fptr, ntomov, buffer, status);  /* read the chunk */
+
+        ffmbyt(fptr, tobyte, IGNORE_EOF, status);
+        if (ffpbyt(fptr, ntomov, buffer, status) > 0) /* write the chunk */
+        {
+            ffpmsg("error while moving block of table rows (ffmvblk)");
+            return(*status);
+        }
+
+        frombyte += ntomov;
+        tobyte   += ntomov;
+        nbytes   -= ntomov;
+    }
+
+    return(*status);
+}
+/*--------------------------------------------------------------------------*/
 int ffdrws(fitsfile *fptr,  /* I - FITS file pointer                        */
            long *rownum,    /* I - list of rows to delete (1 = first)       */
            long nrows,      /* I - number of rows to delete                 */
@@ -488,7 +530,7 @@ int ffdrws(fitsfile *fptr,  /* I - FITS file pointer                        */
  delete the list of rows from the table (1 = first row of table).
 */
 {
-    LONGLONG naxis1, naxis2, insertpos, nextrowpos;
+    LONGLONG naxis1, naxis2, insertpos, nextrowpos, lastrow, nbytes;
     long ii, nextrow;
     char comm[FLEN_COMMENT];
     unsigned char *buffer;
@@ -539,7 +581,7 @@ int ffdrws(fitsfile *fptr,  /* I - FITS file pointer                        */
         return(*status = BAD_ROW_NUM);
     }
 
-    buffer = (unsigned char *) malloc( (size_t) naxis1);  /* buffer for one row */
+    buffer = (unsigned char *) malloc(movebuffsize);  /* copy workspace */
 
     if (!buffer)
     {
@@ -547,65 +589,45 @@ int ffdrws(fitsfile *fptr,  /* I - FITS file pointer                        */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* byte location to start of first row to delete, and the next row */
+    /* byte location where the surviving rows will be written */
     insertpos = (fptr->Fptr)->datastart + ((rownum[0] - 1) * naxis1);
-    nextrowpos = insertpos + naxis1;
-    nextrow = rownum[0] + 1;
+    nextrow = rownum[0] + 1;  /* first row after the first deleted row */
 
-    /* work through the list of rows to delete */
-    for (ii = 1; ii < nrows; nextrow++, nextrowpos += naxis1)
+    /* the surviving rows form contiguous runs lying between the deleted */
+    /* rows; relocate each run with a single large block move rather */
+    /* than copying the rows one at a time */
+    for (ii = 1; ii <= nrows; ii++)
     {
-        if (nextrow < rownum[ii])  
-        {   /* keep this row, so copy it to the new position */
-
-            ffmbyt(fptr, nextrowpos, REPORT_EOF, status);
-            ffgbyt(fptr, naxis1, buffer, status);  /* read the bytes */
+        if (ii < nrows)
+            lastrow = rownum[ii] - 1; /* run ends before next deleted row */
+        else
+            lastrow = naxis2;         /* final run ends at end of table */
 
-            ffmbyt(fptr, insertpos, IGNORE_EOF, status);
-            ffpbyt(fptr, naxis1, buffer, status);  /* write the bytes */
+        if (nextrow <= lastrow)
+        {
+            nbytes = (lastrow - nextrow + 1) * naxis1;
+            nextrowpos = (fptr->Fptr)->datastart + ((nextrow - 1) * naxis1);
 
-            if (*status > 0)
+            if (ffmvblk(fptr, nextrowpos, insertpos, nbytes, buffer,
+                movebuffsize, status) > 0)
             {
                 ffpmsg("error while copying good rows in table (ffdrws)");
                 free(buffer);
                 return(*status);
             }
-            insertpos += naxis1;
+            insertpos += nbytes;
         }
-        else
-        {   /* skip over this row since it is in the list */
-            ii++;
-        }
-    }
 
-    /* finished with all the rows to delete; copy remaining rows */
-    while(nextrow <= naxis2)
-    {
-        ffmbyt(fptr, nextrowpos, REPORT_EOF, status);
-        ffgbyt(fptr, naxis1, buffer, status);  /* read the bytes */
-
-        ffmbyt(fptr, insertpos, IGNORE_EOF, status);
-        ffpbyt(fptr, naxis1, buffer, status);  /* write the bytes */
-
-        if (*status > 0)
-        {
-            ffpmsg("failed to copy remaining rows in table (ffdrws)");
-            free(buffer);
-            return(*status);
-        }
-        insertpos  += naxis1;
-        nextrowpos += naxis1;
-        nextrow++; 
+        if (ii < nrows)
+            nextrow = (long) (rownum[ii] + 1);
     }
     free(buffer);
-    
-    /* now delete the empty rows at the end of the table */
+
+    /* now delete the empty rows at the end of the table; this also */
+    /* compacts the heap, which removes any orphaned data that was */
+    /* only pointed to by the rows that have been deleted */
     ffdrow(fptr, naxis2 - nrows + 1, nrows, status);
 
-    /* Update the heap data, if any.  This will remove any orphaned data */
-    /* that was only pointed to by the rows that have been deleted */
-    ffcmph(fptr, status);
-    
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -617,7 +639,7 @@ int ffdrwsll(fitsfile *fptr, /* I - FITS file pointer                        */
  delete the list of rows from the table (1 = first row of table).
 */
 {
-    LONGLONG insertpos, nextrowpos;
+    LONGLONG insertpos, nextrowpos, lastrow, nbytes;
     LONGLONG naxis1, naxis2, ii, nextrow;
     char comm[FLEN_COMMENT];
     unsigned char *buffer;
@@ -668,7 +690,7 @@ int ffdrwsll(fitsfile *fptr, /* I - FITS file pointer                        */
         return(*status = BAD_ROW_NUM);
     }
 
-    buffer = (unsigned char *) malloc( (size_t) naxis1);  /* buffer for one row */
+    buffer = (unsigned char *) malloc(movebuffsize);  /* copy workspace */
 
     if (!buffer)
     {
@@ -676,65 +698,45 @@ int ffdrwsll(fitsfile *fptr, /* I - FITS file pointer                        */
         return(*status = MEMORY_ALLOCATION);
     }
 
-    /* byte location to start of first row to delete, and the next row */
+    /* byte location where the surviving rows will be written */
     insertpos = (fptr->Fptr)->datastart + ((rownum[0] - 1) * naxis1);
-    nextrowpos = insertpos + naxis1;
-    nextrow = rownum[0] + 1;
+    nextrow = rownum[0] + 1;  /* first row after the first deleted row */
 
-    /* work through the list of rows to delete */
-    for (ii = 1; ii < nrows; nextrow++, nextrowpos += naxis1)
+    /* the surviving rows form contiguous runs lying between the deleted */
+    /* rows; relocate each run with a single large block move rather */
+    /* than copying the rows one at a time */
+    for (ii = 1; ii <= nrows; ii++)
     {
-        if (nextrow < rownum[ii])  
-        {   /* keep this row, so copy it to the new position */
-
-            ffmbyt(fptr, nextrowpos, REPORT_EOF, status);
-            ffgbyt(fptr, naxis1, buffer, status);  /* read the bytes */
+        if (ii < nrows)
+            lastrow = rownum[ii] - 1; /* run ends before next deleted row */
+        else
+            lastrow = naxis2;         /* final run ends at end of table */
 
-            ffmbyt(fptr, insertpos, IGNORE_EOF, status);
-            ffpbyt(fptr, naxis1, buffer, status);  /* write the bytes */
+        if (nextrow <= lastrow)
+        {
+            nbytes = (lastrow - nextrow + 1) * naxis1;
+            nextrowpos = (fptr->Fptr)->datastart + ((nextrow - 1) * naxis1);
 
-            if (*status > 0)
+            if (ffmvblk(fptr, nextrowpos, insertpos, nbytes, buffer,
+                movebuffsize, status) > 0)
             {
-                ffpmsg("error while copying good rows in table (ffdrws)");
+                ffpmsg("error while copying good rows in table (ffdrwsll)");
                 free(buffer);
                 return(*status);
             }
-            insertpos += naxis1;
-        }
-        else
-        {   /* skip over this row since it is in the list */
-            ii++;
+            insertpos += nbytes;
         }
-    }
-
-    /* finished with all the rows to delete; copy remaining rows */
-    while(nextrow <= naxis2)
-    {
-        ffmbyt(fptr, nextrowpos, REPORT_EOF, status);
-        ffgbyt(fptr, naxis1, buffer, status);  /* read the bytes */
-
-        ffmbyt(fptr, insertpos, IGNORE_EOF, status);
-        ffpbyt(fptr, naxis1, buffer, status);  /* write the bytes */
 
-        if (*status > 0)
-        {
-            ffpmsg("failed to copy remaining rows in table (ffdrws)");
-            free(buffer);
-            return(*status);
-        }
-        insertpos  += naxis1;
-        nextrowpos += naxis1;
-        nextrow++; 
+        if (ii < nrows)
+            nextrow = rownum[ii] + 1;
     }
     free(buffer);
-    
-    /* now delete the empty rows at the end of the table */
+
+    /* now delete the empty rows at the end of the table; this also */
+    /* compacts the heap, which removes any orphaned data that was */
+    /* only pointed to by the rows that have been deleted */
     ffdrow(fptr, naxis2 - nrows + 1, nrows, status);
 
-    /* Update the heap data, if any.  This will remove any orphaned data */
-    /* that was only pointed to by the rows that have been deleted */
-    ffcmph(fptr, status);
-    
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -5417,6 +5417,22 @@ static void Do_REG( Node *this )
 	 nelem = this->value.nelem;
 	 elem  = rows*nelem;
 
+	 if( nelem==1 && Xvector==1 && Yvector==1 ) {
+
+	    /* The common case of scalar X and Y columns: hand whole     */
+	    /* columns to the region code in one call so that it walks   */
+	    /* the shape list once instead of once per row.              */
+
+	    fits_in_region_array( rows, theX->value.data.dblptr,
+				  theY->value.data.dblptr,
+				  this->value.data.logptr,
+				  (SAORegion *)theRegion->value.data.ptr );
+	    while( rows-- )
+	       this->value.undef[rows] =
+		  ( theX->value.undef[rows] || theY->value.undef[rows] );
+	    rows = 0;
+	 }
+
 	 while( rows-- ) {
 	    while( nelem-- ) {
 	       elem--;
@@ -75,6 +75,32 @@ static int  load_column( int varNum, long fRow, long nRows,
 
 static int DEBUG_PIXFILTER;
 
+/*  Cache of compiled filtering expressions (see exprcache_store below)  */
+
+#define NEXPRCACHE 8
+
+typedef struct {
+     char        *expr;      /* expression text; NULL if entry is unused    */
+     int         hdutype;    /* type of HDU the expression was built for    */
+     int         datatype;   /* data type of the expression result          */
+     int         nCols;      /* number of columns referenced                */
+     iteratorCol *colData;   /* column bindings at compile time             */
+     DataInfo    *varData;   /* column signature: name, type and shape      */
+     Node        *Nodes;     /* the compiled parse tree                     */
+     int         nNodes;
+     int         resultNode;
+     long        age;        /* LRU counter for cache replacement           */
+} exprcache;
+
+static exprcache exprTable[NEXPRCACHE];
+static long exprclock;
+static int  exprblocked;     /* current expression must not be cached       */
+
+static int  exprcache_fetch( fitsfile *fptr, char *expr );
+static void exprcache_store( char *expr );
+static int  exprcache_checkcol( fitsfile *fptr, DataInfo *varInfo,
+                                iteratorCol *colIter, int *colnum );
+
 #define FREE(x) { if (x) free(x); else printf("invalid free(" #x ") at %s:%d\n", __FILE__, __LINE__); }
 
 /*---------------------------------------------------------------------------*/
@@ -820,7 +846,7 @@ int ffiprs( fitsfile *fptr,      /* I - Input FITS file                     */
 /*--------------------------------------------------------------------------*/
 {
    Node *result;
-   int  i,lexpr, tstatus = 0;
+   int  i,lexpr, reused = 0, tstatus = 0;
    int xaxis, bitpix;
    long xaxes[9];
    static iteratorCol dmyCol;
@@ -867,6 +893,15 @@ int ffiprs( fitsfile *fptr,      /* I - Input FITS file                     */
    } 
    
 
+   /*  Reuse a previously compiled copy of this expression, if one  */
+   /*  exists for a table with a matching column signature           */
+
+   exprblocked = 0;               /* may get set while parsing below */
+   if( expr[0] != '@' )
+      reused = exprcache_fetch( fptr, expr );
+
+   if( !reused ) {
+
    /*  Copy expression into parser... read from file if necessary  */
 
 
@@ -898,6 +933,8 @@ int ffiprs( fitsfile *fptr,      /* I - Input FITS file                     */
       ffpmsg("Blank expression");
       return( *status = PARSE_SYNTAX_ERR );
    }
+
+   }
    if( !gParse.nCols ) {
       dmyCol.fptr = fptr;         /* This allows iterator to know value of */
       gParse.colData = &dmyCol;   /* fptr when no columns are referenced   */
@@ -933,7 +970,11 @@ int ffiprs( fitsfile *fptr,      /* I - Input FITS file                     */
       break;
    }
    gParse.datatype = *datatype;
-   FREE(gParse.expr);
+   if( !reused ) {
+      FREE(gParse.expr);
+      if( !*status && expr[0] != '@' )
+         exprcache_store( expr );
+   }
 
    if( result->operation==CONST_OP ) *nelem = - *nelem;
    return(*status);
@@ -981,6 +1022,237 @@ void ffcprs( void )  /*  No parameters                                      */
    gParse.pixFilter = 0;
 }
 
+/*--------------------------------------------------------------------------*/
+static int exprcache_checkcol( fitsfile *fptr,     /* I - file to check     */
+                               DataInfo *varInfo,  /* I - cached signature  */
+                               iteratorCol *colIter, /* I - cached binding  */
+                               int      *colnum )  /* O - column number     */
+/*                                                                          */
+/* Check whether the indicated file contains a column matching the name,    */
+/* type and shape recorded in a cached expression, repeating the type       */
+/* mapping performed by find_column.  Returns 1 on a match, else 0.         */
+/*--------------------------------------------------------------------------*/
+{
+   int status = 0, istatus, typecode, datatype, type, naxis, i;
+   long repeat, width, naxes[MAXDIMS];
+   double tzero, tscale;
+   char temp[80];
+
+   if( fits_get_colnum( fptr, CASEINSEN, varInfo->name, colnum, &status ) )
+      return( 0 );
+   if( fits_get_coltype( fptr, *colnum, &typecode, &repeat, &width, &status ) )
+      return( 0 );
+
+   switch( typecode ) {
+   case TBIT:
+      type = BITSTR;   datatype = TBYTE;     break;
+   case TBYTE:
+   case TSHORT:
+   case TLONG:
+      sprintf(temp,"TZERO%d",*colnum);
+      istatus = 0;
+      if(fits_read_key(fptr,TDOUBLE,temp,&tzero,NULL,&istatus)) tzero = 0.0;
+      sprintf(temp,"TSCAL%d",*colnum);
+      istatus = 0;
+      if(fits_read_key(fptr,TDOUBLE,temp,&tscale,NULL,&istatus)) tscale = 1.0;
+      if (tscale == 1.0 && (tzero == 0.0 || tzero == 32768.0 )) {
+         type = LONG;     datatype = TLONG;
+      } else {
+         type = DOUBLE;   datatype = TDOUBLE;
+      }
+      break;
+   case TLONGLONG:
+   case TFLOAT:
+   case TDOUBLE:
+      type = DOUBLE;   datatype = TDOUBLE;   break;
+   case TLOGICAL:
+      type = BOOLEAN;  datatype = TLOGICAL;  break;
+   case TSTRING:
+      type = STRING;   datatype = TSTRING;
+      if( width >= MAX_STRLEN ) return( 0 );
+      if( gParse.hdutype == ASCII_TBL ) repeat = width;
+      break;
+   default:
+      return( 0 );
+   }
+
+   if( type != varInfo->type || datatype != colIter->datatype
+       || repeat != varInfo->nelem )
+      return( 0 );
+
+   if( repeat > 1 && typecode != TSTRING ) {
+      if( fits_read_tdim( fptr, *colnum, MAXDIMS, &naxis, naxes, &status ) )
+         return( 0 );
+   } else {
+      naxis = 1;
+      naxes[0] = 1;
+   }
+   if( naxis != varInfo->naxis ) return( 0 );
+   for( i = 0; i < naxis; i++ )
+      if( naxes[i] != varInfo->naxes[i] ) return( 0 );
+
+   return( 1 );
+}
+
+/*--------------------------------------------------------------------------*/
+static int exprcache_fetch( fitsfile *fptr,  /* I - file being filtered     */
+                            char     *expr ) /* I - expression text         */
+/*                                                                          */
+/* Look for a cached compiled copy of the given expression that fits the    */
+/* current table, and if one is found install fresh copies of its parse     */
+/* tree and column bindings into gParse, re-bound to the given file.        */
+/* Returns 1 when gParse has been populated from the cache, else 0.         */
+/*--------------------------------------------------------------------------*/
+{
+   exprcache *entry = NULL;
+   int i, col, *colnums = NULL;
+
+   for( i = 0; i < NEXPRCACHE; i++ )
+      if( exprTable[i].expr && !strcmp( exprTable[i].expr, expr ) ) {
+         entry = exprTable + i;
+         break;
+      }
+   if( !entry ) return( 0 );
+
+   if( gParse.compressed || gParse.hdutype != entry->hdutype
+       || (gParse.hdutype != ASCII_TBL && gParse.hdutype != BINARY_TBL) )
+      return( 0 );
+
+   /*  Re-validate the column signature against this table  */
+
+   if( entry->nCols ) {
+      colnums = (int*)malloc( entry->nCols*sizeof(int) );
+      if( !colnums ) return( 0 );
+      for( col = 0; col < entry->nCols; col++ )
+         if( !exprcache_checkcol( fptr, entry->varData+col,
+                                  entry->colData+col, colnums+col ) ) {
+            free( colnums );
+            return( 0 );
+         }
+   }
+
+   /*  Install fresh copies of the compiled tree and column bindings;  */
+   /*  ffcprs frees them, leaving the cached originals untouched       */
+
+   gParse.Nodes = (Node*)malloc( entry->nNodes*sizeof(Node) );
+   if( !gParse.Nodes ) {
+      if( colnums ) free( colnums );
+      return( 0 );
+   }
+   memcpy( gParse.Nodes, entry->Nodes, entry->nNodes*sizeof(Node) );
+   gParse.nNodes      = entry->nNodes;
+   gParse.nNodesAlloc = entry->nNodes;
+   gParse.resultNode  = entry->resultNode;
+
+   if( entry->nCols ) {
+      gParse.colData = (iteratorCol*)malloc( entry->nCols*sizeof(iteratorCol) );
+      gParse.varData = (DataInfo   *)malloc( entry->nCols*sizeof(DataInfo) );
+      if( !gParse.colData || !gParse.varData ) {
+         if( gParse.colData ) free( gParse.colData );
+         if( gParse.varData ) free( gParse.varData );
+         gParse.colData = NULL;
+         gParse.varData = NULL;
+         free( gParse.Nodes );
+         gParse.Nodes = NULL;
+         gParse.nNodes = gParse.nNodesAlloc = 0;
+         free( colnums );
+         return( 0 );
+      }
+      memcpy( gParse.varData, entry->varData, entry->nCols*sizeof(DataInfo) );
+      for( col = 0; col < entry->nCols; col++ ) {
+         fits_iter_set_by_num( gParse.colData+col, fptr, colnums[col],
+                               entry->colData[col].datatype, InputCol );
+         gParse.varData[col].data  = NULL;
+         gParse.varData[col].undef = NULL;
+      }
+      gParse.nCols = entry->nCols;
+      free( colnums );
+   }
+
+   entry->age = ++exprclock;
+   return( 1 );
+}
+
+/*--------------------------------------------------------------------------*/
+static void exprcache_store( char *expr )  /* I - expression text           */
+/*                                                                          */
+/* Save a copy of the expression just compiled by ffiprs for later reuse.   */
+/* The compiled tree depends only on the expression text and on the name,   */
+/* type and shape of the referenced columns, so it can be reused for any    */
+/* table with the same column signature; expressions whose tree captures    */
+/* the contents of the file itself (keyword values folded into constants,   */
+/* GTI or region tables loaded at parse time) are never cached.             */
+/*--------------------------------------------------------------------------*/
+{
+   exprcache *entry;
+   int i, node;
+
+   if( exprblocked || gParse.compressed )
+      return;
+   if( gParse.hdutype != ASCII_TBL && gParse.hdutype != BINARY_TBL )
+      return;
+
+   for( node = 0; node < gParse.nNodes; node++ )
+      if( gParse.Nodes[node].operation == (int)gtifilt_fct ||
+          gParse.Nodes[node].operation == (int)regfilt_fct )
+         return;
+
+   /*  Reuse the entry for this expression, else replace the oldest  */
+
+   entry = exprTable;
+   for( i = 0; i < NEXPRCACHE; i++ ) {
+      if( exprTable[i].expr && !strcmp( exprTable[i].expr, expr ) ) {
+         entry = exprTable + i;
+         break;
+      }
+      if( exprTable[i].age < entry->age ) entry = exprTable + i;
+   }
+
+   if( entry->expr ) {
+      free( entry->expr );
+      if( entry->nCols ) {
+         free( entry->colData );
+         free( entry->varData );
+      }
+      free( entry->Nodes );
+      memset( entry, 0, sizeof(exprcache) );
+   }
+
+   entry->expr = (char*)malloc( strlen(expr)+1 );
+   if( !entry->expr ) return;
+   strcpy( entry->expr, expr );
+
+   entry->Nodes = (Node*)malloc( gParse.nNodes*sizeof(Node) );
+   if( !entry->Nodes ) {
+      free( entry->expr );
+      entry->expr = NULL;
+      return;
+   }
+   memcpy( entry->Nodes, gParse.Nodes, gParse.nNodes*sizeof(Node) );
+
+   if( gParse.nCols ) {
+      entry->colData = (iteratorCol*)malloc( gParse.nCols*sizeof(iteratorCol) );
+      entry->varData = (DataInfo   *)malloc( gParse.nCols*sizeof(DataInfo) );
+      if( !entry->colData || !entry->varData ) {
+         if( entry->colData ) free( entry->colData );
+         if( entry->varData ) free( entry->varData );
+         free( entry->Nodes );
+         free( entry->expr );
+         memset( entry, 0, sizeof(exprcache) );
+         return;
+      }
+      memcpy( entry->colData, gParse.colData, gParse.nCols*sizeof(iteratorCol) );
+      memcpy( entry->varData, gParse.varData, gParse.nCols*sizeof(DataInfo) );
+   }
+
+   entry->nCols      = gParse.nCols;
+   entry->nNodes     = gParse.nNodes;
+   entry->resultNode = gParse.resultNode;
+   entry->hdutype    = gParse.hdutype;
+   entry->datatype   = gParse.datatype;
+   entry->age        = ++exprclock;
+}
+
 /*---------------------------------------------------------------------------*/
 int parse_data( long    totalrows,     /* I - Total rows to be processed     */
                 long    offset,        /* I - Number of rows skipped at start*/
@@ -2436,6 +2708,10 @@ static int find_keywd(char *keyname, void *itslval )
    int bval;
    long ival;
 
+   /*  the keyword value gets folded into the compiled tree as a  */
+   /*  constant, so the tree must not be reused for another file  */
+   exprblocked = 1;
+
    status = 0;
    fptr = gParse.def_fptr;
    if( fits_read_keyword( fptr, keyname, keyvalue, NULL, &status ) ) {
@@ -4199,6 +4199,80 @@ static void Do_BinOp_log( Node *this )
 	that2->value.data.lng = previous;
       }
       
+   } else if( this->value.nelem == 1 && vector1 <= 1 && vector2 <= 1 ) {
+
+      /*  Batched fast path for scalar columns: hoist the operation    */
+      /*  dispatch out of the row loop so that each operation runs as  */
+      /*  one tight loop over the whole chunk of rows                  */
+
+      char *a1=0, *a2=0;
+      char   *u1=0, *u2=0;
+
+      rows  = gParse.nRows;
+
+      Allocate_Ptrs( this );
+
+      if( vector1 ) {
+	 a1 = that1->value.data.logptr;
+	 u1 = that1->value.undef;
+      }
+      if( vector2 ) {
+	 a2 = that2->value.data.logptr;
+	 u2 = that2->value.undef;
+      }
+
+      if( !gParse.status ) {
+
+	 switch( this->operation ) {
+	 case OR:
+	    /*  Suppress UNDEFs as in the general loop below  */
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       if( !null1 && !null2 ) {
+		  this->value.data.logptr[elem] = (val1 || val2);
+	       } else if( (null1 && !null2 && val2)
+			  || ( !null1 && null2 && val1 ) ) {
+		  this->value.data.logptr[elem] = 1;
+		  this->value.undef[elem] = 0;
+	       }
+	    }
+	    break;
+	 case AND:
+	    /*  Suppress UNDEFs as in the general loop below  */
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       if( !null1 && !null2 ) {
+		  this->value.data.logptr[elem] = (val1 && val2);
+	       } else if( (null1 && !null2 && !val2)
+			  || ( !null1 && null2 && !val1 ) ) {
+		  this->value.data.logptr[elem] = 0;
+		  this->value.undef[elem] = 0;
+	       }
+	    }
+	    break;
+	 case EQ:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = ( (val1 && val2) || (!val1 && !val2) );
+	    }
+	    break;
+	 case NE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = ( (val1 && !val2) || (!val1 && val2) );
+	    }
+	    break;
+	 }
+      }
+
    } else {
       rows  = gParse.nRows;
       nelem = this->value.nelem;
@@ -4407,6 +4481,139 @@ static void Do_BinOp_lng( Node *this )
 	that2->value.undef    = (char *) undef; /* XXX evil, but no harm here */
       }
       
+   } else if( this->value.nelem == 1 && vector1 <= 1 && vector2 <= 1 ) {
+
+      /*  Batched fast path for scalar columns: hoist the operation    */
+      /*  dispatch out of the row loop so that each operation runs as  */
+      /*  one tight loop over the whole chunk of rows                  */
+
+      long *a1=0, *a2=0;
+      char *u1=0, *u2=0;
+
+      rows  = gParse.nRows;
+
+      Allocate_Ptrs( this );
+
+      if( vector1 ) {
+	 a1 = that1->value.data.lngptr;
+	 u1 = that1->value.undef;
+      }
+      if( vector2 ) {
+	 a2 = that2->value.data.lngptr;
+	 u2 = that2->value.undef;
+      }
+
+      if( !gParse.status ) {
+
+	 switch( this->operation ) {
+	 case '~':   /* Treat as == for LONGS */
+	 case EQ:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 == val2);
+	    }
+	    break;
+	 case NE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 != val2);
+	    }
+	    break;
+	 case GT:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 > val2);
+	    }
+	    break;
+	 case LT:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 < val2);
+	    }
+	    break;
+	 case LTE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 <= val2);
+	    }
+	    break;
+	 case GTE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 >= val2);
+	    }
+	    break;
+	 case '+':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.lngptr[elem] = (val1 + val2);
+	    }
+	    break;
+	 case '-':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.lngptr[elem] = (val1 - val2);
+	    }
+	    break;
+	 case '*':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.lngptr[elem] = (val1 * val2);
+	    }
+	    break;
+	 case '%':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       if( val2 ) this->value.data.lngptr[elem] = (val1 % val2);
+	       else {
+		  this->value.data.lngptr[elem] = 0;
+		  this->value.undef[elem] = 1;
+	       }
+	    }
+	    break;
+	 case '/':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       if( val2 ) this->value.data.lngptr[elem] = (val1 / val2);
+	       else {
+		  this->value.data.lngptr[elem] = 0;
+		  this->value.undef[elem] = 1;
+	       }
+	    }
+	    break;
+	 case POWER:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.lngptr[elem] = (long)pow((double)val1,(double)val2);
+	    }
+	    break;
+	 }
+      }
+
    } else {
 
       rows  = gParse.nRows;
@@ -4588,6 +4795,146 @@ static void Do_BinOp_dbl( Node *this )
 	that2->value.undef    = (char *) undef; /* XXX evil, but no harm here */
       }
       
+   } else if( this->value.nelem == 1 && vector1 <= 1 && vector2 <= 1 ) {
+
+      /*  Batched fast path for scalar columns: hoist the operation    */
+      /*  dispatch out of the row loop so that each operation runs as  */
+      /*  one tight loop over the whole chunk of rows                  */
+
+      double *a1=0, *a2=0;
+      char   *u1=0, *u2=0;
+
+      rows  = gParse.nRows;
+
+      Allocate_Ptrs( this );
+
+      if( vector1 ) {
+	 a1 = that1->value.data.dblptr;
+	 u1 = that1->value.undef;
+      }
+      if( vector2 ) {
+	 a2 = that2->value.data.dblptr;
+	 u2 = that2->value.undef;
+      }
+
+      if( !gParse.status ) {
+
+	 switch( this->operation ) {
+	 case '~':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = ( fabs(val1-val2) < APPROX );
+	    }
+	    break;
+	 case EQ:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 == val2);
+	    }
+	    break;
+	 case NE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 != val2);
+	    }
+	    break;
+	 case GT:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 > val2);
+	    }
+	    break;
+	 case LT:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 < val2);
+	    }
+	    break;
+	 case LTE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 <= val2);
+	    }
+	    break;
+	 case GTE:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.logptr[elem] = (val1 >= val2);
+	    }
+	    break;
+	 case '+':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.dblptr[elem] = (val1 + val2);
+	    }
+	    break;
+	 case '-':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.dblptr[elem] = (val1 - val2);
+	    }
+	    break;
+	 case '*':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.dblptr[elem] = (val1 * val2);
+	    }
+	    break;
+	 case '%':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       if( val2 ) this->value.data.dblptr[elem] = val1 - val2*((int)(val1/val2));
+	       else {
+		  this->value.data.dblptr[elem] = 0.0;
+		  this->value.undef[elem] = 1;
+	       }
+	    }
+	    break;
+	 case '/':
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       if( val2 ) this->value.data.dblptr[elem] = (val1 / val2);
+	       else {
+		  this->value.data.dblptr[elem] = 0.0;
+		  this->value.undef[elem] = 1;
+	       }
+	    }
+	    break;
+	 case POWER:
+	    for( elem = 0; elem < rows; elem++ ) {
+	    if( vector1 ) { val1 = a1[elem]; null1 = u1[elem]; }
+	    if( vector2 ) { val2 = a2[elem]; null2 = u2[elem]; }
+	    this->value.undef[elem] = (null1 || null2);
+	       this->value.data.dblptr[elem] = (double)pow(val1,val2);
+	    }
+	    break;
+	 }
+      }
+
    } else {
 
       rows  = gParse.nRows;
@@ -6913,6 +7260,22 @@ static void Do_REG( Node *this )
 	 nelem = this->value.nelem;
 	 elem  = rows*nelem;
 
+	 if( nelem==1 && Xvector==1 && Yvector==1 ) {
+
+	    /* The common case of scalar X and Y columns: hand whole     */
+	    /* columns to the region code in one call so that it walks   */
+	    /* the shape list once instead of once per row.              */
+
+	    fits_in_region_array( rows, theX->value.data.dblptr,
+				  theY->value.data.dblptr,
+				  this->value.data.logptr,
+				  (SAORegion *)theRegion->value.data.ptr );
+	    while( rows-- )
+	       this->value.undef[rows] =
+		  ( theX->value.undef[rows] || theY->value.undef[rows] );
+	    rows = 0;
+	 }
+
 	 while( rows-- ) {
 	    while( nelem-- ) {
 	       elem--;
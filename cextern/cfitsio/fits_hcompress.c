@@ -74,6 +74,258 @@ static void output_nnybble(char *outfile, int n, unsigned char array[]);
 
 #define output_huffman(outfile,c)	output_nbits(outfile,code[c],ncode[c])
 
+/*  #########################################################################
+Optional multi-threading of the H-transform and digitization stages.
+
+Each reduction level of the H-transform sweeps independent pairs of rows
+(the butterfly), then shuffles each row and each column; digitization
+divides every pixel independently.  All of these loops are partitioned
+into contiguous strips and spread over a small pool of worker threads,
+with a join between phases serving as the barrier.  The arithmetic is
+unchanged, so the compressed stream is identical to the serial result.
+The strip loops live in hc_strip_run, which is also used (over the full
+range) when threading is disabled or unavailable, and the encoding
+stage remains serial since it writes a single sequential bit stream.
+ ############################################################################  */
+
+#if !defined(_WIN32)
+#define HAVE_HCOMPRESS_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* maximum worker threads, and minimum number of pixels in a transform
+   level before spreading the strip loops across threads pays off; the
+   later, smaller levels always run serially */
+#define HCOMPRESS_MAX_THREADS 16
+#define HCOMPRESS_THREAD_MIN_PIXELS 262144
+
+/* effective number of worker threads; 1 disables threading */
+static int hcompress_nthreads = 1;
+
+/* one strip of a transform phase, processed by a single thread */
+typedef struct {
+    int phase;		/* which of the strip loops to run	*/
+    int istart, iend;	/* half-open strip bounds		*/
+    int *a;		/* image array (32-bit variants)	*/
+    LONGLONG *a64;	/* image array (64-bit variants)	*/
+    int ny;		/* full length of a row			*/
+    int nxtop, nytop;	/* active dimensions at this level	*/
+    int oddy;		/* odd row length at this level?	*/
+    int shift;
+    int mask, mask2, prnd, prnd2, nrnd2;
+    LONGLONG mask_ll, mask2_ll, prnd_ll, prnd2_ll, nrnd2_ll;
+    int *tmp;		/* shuffle scratch (32-bit variants)	*/
+    LONGLONG *tmp_ll;	/* shuffle scratch (64-bit variants)	*/
+    int scale, d;	/* digitization parameters		*/
+    LONGLONG scale_ll, d_ll;
+} hc_strip;
+
+enum {
+    HC_BUTTERFLY,   HC_ROWSHUFFLE,   HC_COLSHUFFLE,   HC_DIGITIZE,
+    HC_BUTTERFLY64, HC_ROWSHUFFLE64, HC_COLSHUFFLE64, HC_DIGITIZE64
+};
+
+int fits_hcompress_set_threads(int nthreads)
+{
+/*
+   Set the number of threads used for the H-transform and digitization
+   stages of subsequent fits_hcompress calls: 1 disables threading and
+   0 means one thread per processor.  Returns the effective setting.
+*/
+#ifdef HAVE_HCOMPRESS_THREADS
+    if (nthreads < 0) nthreads = 1;
+    if (nthreads == 0) {
+	long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = (nproc > 0) ? (int) nproc : 1;
+    }
+    if (nthreads > HCOMPRESS_MAX_THREADS) nthreads = HCOMPRESS_MAX_THREADS;
+    hcompress_nthreads = nthreads;
+#else
+    hcompress_nthreads = 1;
+#endif
+    return(hcompress_nthreads);
+}
+
+static void *hc_strip_run(void *arg)
+{
+hc_strip *s = (hc_strip *) arg;
+int i, j, s00, s10;
+int h0, hx, hy, hc;
+LONGLONG hh0, hhx, hhy, hhc;
+int ny = s->ny;
+int nytop = s->nytop, nxtop = s->nxtop, oddy = s->oddy, shift = s->shift;
+
+    switch (s->phase) {
+    case HC_BUTTERFLY: {
+	int *a = s->a;
+	int mask = s->mask, mask2 = s->mask2;
+	int prnd = s->prnd, prnd2 = s->prnd2, nrnd2 = s->nrnd2;
+
+	for (i = s->istart; i < s->iend; i += 2) {
+	    s00 = i*ny;				/* s00 is index of a[i,j]	*/
+	    s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
+	    for (j = 0; j<nytop-oddy; j += 2) {
+		/*
+		 * Divide h0,hx,hy,hc by 2 (1 the first time through).
+		 */
+		h0 = (a[s10+1] + a[s10] + a[s00+1] + a[s00]) >> shift;
+		hx = (a[s10+1] + a[s10] - a[s00+1] - a[s00]) >> shift;
+		hy = (a[s10+1] - a[s10] + a[s00+1] - a[s00]) >> shift;
+		hc = (a[s10+1] - a[s10] - a[s00+1] + a[s00]) >> shift;
+
+		/*
+		 * Throw away the 2 bottom bits of h0, bottom bit of hx,hy.
+		 * To get rounding to be same for positive and negative
+		 * numbers, nrnd2 = prnd2 - 1.
+		 */
+		a[s10+1] = hc;
+		a[s10  ] = ( (hx>=0) ? (hx+prnd)  :  hx        ) & mask ;
+		a[s00+1] = ( (hy>=0) ? (hy+prnd)  :  hy        ) & mask ;
+		a[s00  ] = ( (h0>=0) ? (h0+prnd2) : (h0+nrnd2) ) & mask2;
+		s00 += 2;
+		s10 += 2;
+	    }
+	    if (oddy) {
+		/*
+		 * do last element in row if row length is odd
+		 * s00+1, s10+1 are off edge
+		 */
+		h0 = (a[s10] + a[s00]) << (1-shift);
+		hx = (a[s10] - a[s00]) << (1-shift);
+		a[s10  ] = ( (hx>=0) ? (hx+prnd)  :  hx        ) & mask ;
+		a[s00  ] = ( (h0>=0) ? (h0+prnd2) : (h0+nrnd2) ) & mask2;
+	    }
+	}
+	break;
+    }
+    case HC_ROWSHUFFLE:
+	for (i = s->istart; i < s->iend; i++) {
+	    shuffle(&s->a[ny*i],nytop,1,s->tmp);
+	}
+	break;
+    case HC_COLSHUFFLE:
+	for (j = s->istart; j < s->iend; j++) {
+	    shuffle(&s->a[j],nxtop,ny,s->tmp);
+	}
+	break;
+    case HC_DIGITIZE: {
+	int *a = s->a;
+	int d = s->d, scale = s->scale;
+
+	for (i = s->istart; i < s->iend; i++) {
+	    a[i] = ((a[i]>0) ? (a[i]+d) : (a[i]-d))/scale;
+	}
+	break;
+    }
+    case HC_BUTTERFLY64: {
+	LONGLONG *a = s->a64;
+	LONGLONG mask = s->mask_ll, mask2 = s->mask2_ll;
+	LONGLONG prnd = s->prnd_ll, prnd2 = s->prnd2_ll, nrnd2 = s->nrnd2_ll;
+
+	for (i = s->istart; i < s->iend; i += 2) {
+	    s00 = i*ny;				/* s00 is index of a[i,j]	*/
+	    s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
+	    for (j = 0; j<nytop-oddy; j += 2) {
+		/*
+		 * Divide h0,hx,hy,hc by 2 (1 the first time through).
+		 */
+		hh0 = (a[s10+1] + a[s10] + a[s00+1] + a[s00]) >> shift;
+		hhx = (a[s10+1] + a[s10] - a[s00+1] - a[s00]) >> shift;
+		hhy = (a[s10+1] - a[s10] + a[s00+1] - a[s00]) >> shift;
+		hhc = (a[s10+1] - a[s10] - a[s00+1] + a[s00]) >> shift;
+
+		/*
+		 * Throw away the 2 bottom bits of h0, bottom bit of hx,hy.
+		 * To get rounding to be same for positive and negative
+		 * numbers, nrnd2 = prnd2 - 1.
+		 */
+		a[s10+1] = hhc;
+		a[s10  ] = ( (hhx>=0) ? (hhx+prnd)  :  hhx        ) & mask ;
+		a[s00+1] = ( (hhy>=0) ? (hhy+prnd)  :  hhy        ) & mask ;
+		a[s00  ] = ( (hh0>=0) ? (hh0+prnd2) : (hh0+nrnd2) ) & mask2;
+		s00 += 2;
+		s10 += 2;
+	    }
+	    if (oddy) {
+		/*
+		 * do last element in row if row length is odd
+		 * s00+1, s10+1 are off edge
+		 */
+		hh0 = (a[s10] + a[s00]) << (1-shift);
+		hhx = (a[s10] - a[s00]) << (1-shift);
+		a[s10  ] = ( (hhx>=0) ? (hhx+prnd)  :  hhx        ) & mask ;
+		a[s00  ] = ( (hh0>=0) ? (hh0+prnd2) : (hh0+nrnd2) ) & mask2;
+	    }
+	}
+	break;
+    }
+    case HC_ROWSHUFFLE64:
+	for (i = s->istart; i < s->iend; i++) {
+	    shuffle64(&s->a64[ny*i],nytop,1,s->tmp_ll);
+	}
+	break;
+    case HC_COLSHUFFLE64:
+	for (j = s->istart; j < s->iend; j++) {
+	    shuffle64(&s->a64[j],nxtop,ny,s->tmp_ll);
+	}
+	break;
+    case HC_DIGITIZE64: {
+	LONGLONG *a = s->a64;
+	LONGLONG d = s->d_ll, scale = s->scale_ll;
+
+	for (i = s->istart; i < s->iend; i++) {
+	    a[i] = ((a[i]>0) ? (a[i]+d) : (a[i]-d))/scale;
+	}
+	break;
+    }
+    }
+    return(NULL);
+}
+
+#ifdef HAVE_HCOMPRESS_THREADS
+/* spread one strip loop over the worker threads; strip bounds are cut
+   at a multiple of step so that butterfly row pairs stay together.
+   tmpbase, when given, provides tmpstride bytes of private shuffle
+   scratch per thread. */
+static void hc_run_strips(hc_strip *proto, int lo, int hi, int step,
+                          void *tmpbase, size_t tmpstride)
+{
+    pthread_t threads[HCOMPRESS_MAX_THREADS];
+    hc_strip strips[HCOMPRESS_MAX_THREADS];
+    int idx, nthreads, count, chunk;
+
+    count = (hi - lo + step - 1) / step;	/* number of strip units */
+    if (count < 1) return;
+    nthreads = hcompress_nthreads;
+    if (nthreads > count) nthreads = count;
+
+    chunk = (count + nthreads - 1) / nthreads;
+    for (idx = 0; idx < nthreads; idx++) {
+	strips[idx] = *proto;
+	strips[idx].istart = lo + idx*chunk*step;
+	strips[idx].iend = strips[idx].istart + chunk*step;
+	if (strips[idx].iend > hi) strips[idx].iend = hi;
+	if (tmpbase) {
+	    strips[idx].tmp = (int *) ((char *) tmpbase + idx*tmpstride);
+	    strips[idx].tmp_ll = (LONGLONG *) ((char *) tmpbase + idx*tmpstride);
+	}
+	/* the last strip runs on this thread; if a worker cannot be
+	   created its strip simply runs here too */
+	if (idx == nthreads - 1 ||
+	        pthread_create(&threads[idx], NULL, hc_strip_run,
+	                       &strips[idx]) != 0) {
+	    threads[idx] = pthread_self();
+	    hc_strip_run(&strips[idx]);
+	}
+    }
+    for (idx = 0; idx < nthreads; idx++) {
+	if (!pthread_equal(threads[idx], pthread_self()))
+	    pthread_join(threads[idx], NULL);
+    }
+}
+#endif /* HAVE_HCOMPRESS_THREADS */
+
 /* ---------------------------------------------------------------------- */
 int fits_hcompress(int *a, int ny, int nx, int scale, char *output, 
                   long *nbytes, int *status)
@@ -183,11 +435,16 @@ int fits_hcompress64(LONGLONG *a, int ny, int nx, int scale, char *output,
 /* ######################################################################### */
 static int htrans(int a[],int nx,int ny)
 {
-int nmax, log2n, h0, hx, hy, hc, nxtop, nytop, i, j, k;
+int nmax, log2n, h0, hy, nxtop, nytop, i, j, k;
 int oddx, oddy;
 int shift, mask, mask2, prnd, prnd2, nrnd2;
-int s10, s00;
+int s00;
 int *tmp;
+hc_strip strip;
+#ifdef HAVE_HCOMPRESS_THREADS
+char *ttmp = NULL;
+size_t tmpsize;
+#endif
 
 	/*
 	 * log2n is log2 of max(nx,ny) rounded up to next power of 2
@@ -205,6 +462,15 @@ int *tmp;
 	        ffpmsg("htrans: insufficient memory");
 		return(DATA_COMPRESSION_ERR);
 	}
+#ifdef HAVE_HCOMPRESS_THREADS
+	/*
+	 * private shuffle scratch for each worker thread; if the
+	 * allocation fails the strip loops below simply run serially
+	 */
+	tmpsize = ((nmax+1)/2)*sizeof(int);
+	if (hcompress_nthreads > 1)
+	    ttmp = (char *) malloc(hcompress_nthreads*tmpsize);
+#endif
 	/*
 	 * set up rounding and shifting masks
 	 */
@@ -225,49 +491,40 @@ int *tmp;
 	for (k = 0; k<log2n; k++) {
 		oddx = nxtop % 2;
 		oddy = nytop % 2;
-		for (i = 0; i<nxtop-oddx; i += 2) {
-			s00 = i*ny;				/* s00 is index of a[i,j]	*/
-			s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
-			for (j = 0; j<nytop-oddy; j += 2) {
-				/*
-				 * Divide h0,hx,hy,hc by 2 (1 the first time through).
-				 */
-				h0 = (a[s10+1] + a[s10] + a[s00+1] + a[s00]) >> shift;
-				hx = (a[s10+1] + a[s10] - a[s00+1] - a[s00]) >> shift;
-				hy = (a[s10+1] - a[s10] + a[s00+1] - a[s00]) >> shift;
-				hc = (a[s10+1] - a[s10] - a[s00+1] + a[s00]) >> shift;
-
-				/*
-				 * Throw away the 2 bottom bits of h0, bottom bit of hx,hy.
-				 * To get rounding to be same for positive and negative
-				 * numbers, nrnd2 = prnd2 - 1.
-				 */
-				a[s10+1] = hc;
-				a[s10  ] = ( (hx>=0) ? (hx+prnd)  :  hx        ) & mask ;
-				a[s00+1] = ( (hy>=0) ? (hy+prnd)  :  hy        ) & mask ;
-				a[s00  ] = ( (h0>=0) ? (h0+prnd2) : (h0+nrnd2) ) & mask2;
-				s00 += 2;
-				s10 += 2;
-			}
-			if (oddy) {
-				/*
-				 * do last element in row if row length is odd
-				 * s00+1, s10+1 are off edge
-				 */
-				h0 = (a[s10] + a[s00]) << (1-shift);
-				hx = (a[s10] - a[s00]) << (1-shift);
-				a[s10  ] = ( (hx>=0) ? (hx+prnd)  :  hx        ) & mask ;
-				a[s00  ] = ( (h0>=0) ? (h0+prnd2) : (h0+nrnd2) ) & mask2;
-				s00 += 1;
-				s10 += 1;
-			}
+		/*
+		 * the butterfly and shuffle loops live in hc_strip_run
+		 * so that they can also be spread over worker threads
+		 * for large levels
+		 */
+		strip.phase = HC_BUTTERFLY;
+		strip.a = a;
+		strip.ny = ny;
+		strip.nxtop = nxtop;
+		strip.nytop = nytop;
+		strip.oddy = oddy;
+		strip.shift = shift;
+		strip.mask = mask;
+		strip.mask2 = mask2;
+		strip.prnd = prnd;
+		strip.prnd2 = prnd2;
+		strip.nrnd2 = nrnd2;
+		strip.tmp = tmp;
+#ifdef HAVE_HCOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HCOMPRESS_THREAD_MIN_PIXELS) {
+			hc_run_strips(&strip, 0, nxtop-oddx, 2, NULL, 0);
+		} else
+#endif
+		{
+			strip.istart = 0;
+			strip.iend = nxtop-oddx;
+			hc_strip_run(&strip);
 		}
 		if (oddx) {
 			/*
 			 * do last row if column length is odd
 			 * s10, s10+1 are off edge
 			 */
-			s00 = i*ny;
+			s00 = (nxtop-oddx)*ny;
 			for (j = 0; j<nytop-oddy; j += 2) {
 				h0 = (a[s00+1] + a[s00]) << (1-shift);
 				hy = (a[s00+1] - a[s00]) << (1-shift);
@@ -287,11 +544,21 @@ int *tmp;
 		/*
 		 * now shuffle in each dimension to group coefficients by order
 		 */
-		for (i = 0; i<nxtop; i++) {
-			shuffle(&a[ny*i],nytop,1,tmp);
-		}
-		for (j = 0; j<nytop; j++) {
-			shuffle(&a[j],nxtop,ny,tmp);
+#ifdef HAVE_HCOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HCOMPRESS_THREAD_MIN_PIXELS) {
+			strip.phase = HC_ROWSHUFFLE;
+			hc_run_strips(&strip, 0, nxtop, 1, ttmp, tmpsize);
+			strip.phase = HC_COLSHUFFLE;
+			hc_run_strips(&strip, 0, nytop, 1, ttmp, tmpsize);
+		} else
+#endif
+		{
+			for (i = 0; i<nxtop; i++) {
+				shuffle(&a[ny*i],nytop,1,tmp);
+			}
+			for (j = 0; j<nytop; j++) {
+				shuffle(&a[j],nxtop,ny,tmp);
+			}
 		}
 		/*
 		 * image size reduced by 2 (round up if odd)
@@ -312,6 +579,9 @@ int *tmp;
 		nrnd2 = prnd2 - 1;
 	}
 	free(tmp);
+#ifdef HAVE_HCOMPRESS_THREADS
+	free(ttmp);
+#endif
 	return(0);
 }
 /* ######################################################################### */
@@ -321,9 +591,14 @@ static int htrans64(LONGLONG a[],int nx,int ny)
 int nmax, log2n, nxtop, nytop, i, j, k;
 int oddx, oddy;
 int shift;
-int s10, s00;
-LONGLONG h0, hx, hy, hc, prnd, prnd2, nrnd2, mask, mask2;
+int s00;
+LONGLONG h0, hy, prnd, prnd2, nrnd2, mask, mask2;
 LONGLONG *tmp;
+hc_strip strip;
+#ifdef HAVE_HCOMPRESS_THREADS
+char *ttmp = NULL;
+size_t tmpsize;
+#endif
 
 	/*
 	 * log2n is log2 of max(nx,ny) rounded up to next power of 2
@@ -341,6 +616,15 @@ LONGLONG *tmp;
 	        ffpmsg("htrans64: insufficient memory");
 		return(DATA_COMPRESSION_ERR);
 	}
+#ifdef HAVE_HCOMPRESS_THREADS
+	/*
+	 * private shuffle scratch for each worker thread; if the
+	 * allocation fails the strip loops below simply run serially
+	 */
+	tmpsize = ((nmax+1)/2)*sizeof(LONGLONG);
+	if (hcompress_nthreads > 1)
+	    ttmp = (char *) malloc(hcompress_nthreads*tmpsize);
+#endif
 	/*
 	 * set up rounding and shifting masks
 	 */
@@ -361,49 +645,40 @@ LONGLONG *tmp;
 	for (k = 0; k<log2n; k++) {
 		oddx = nxtop % 2;
 		oddy = nytop % 2;
-		for (i = 0; i<nxtop-oddx; i += 2) {
-			s00 = i*ny;				/* s00 is index of a[i,j]	*/
-			s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
-			for (j = 0; j<nytop-oddy; j += 2) {
-				/*
-				 * Divide h0,hx,hy,hc by 2 (1 the first time through).
-				 */
-				h0 = (a[s10+1] + a[s10] + a[s00+1] + a[s00]) >> shift;
-				hx = (a[s10+1] + a[s10] - a[s00+1] - a[s00]) >> shift;
-				hy = (a[s10+1] - a[s10] + a[s00+1] - a[s00]) >> shift;
-				hc = (a[s10+1] - a[s10] - a[s00+1] + a[s00]) >> shift;
-
-				/*
-				 * Throw away the 2 bottom bits of h0, bottom bit of hx,hy.
-				 * To get rounding to be same for positive and negative
-				 * numbers, nrnd2 = prnd2 - 1.
-				 */
-				a[s10+1] = hc;
-				a[s10  ] = ( (hx>=0) ? (hx+prnd)  :  hx        ) & mask ;
-				a[s00+1] = ( (hy>=0) ? (hy+prnd)  :  hy        ) & mask ;
-				a[s00  ] = ( (h0>=0) ? (h0+prnd2) : (h0+nrnd2) ) & mask2;
-				s00 += 2;
-				s10 += 2;
-			}
-			if (oddy) {
-				/*
-				 * do last element in row if row length is odd
-				 * s00+1, s10+1 are off edge
-				 */
-				h0 = (a[s10] + a[s00]) << (1-shift);
-				hx = (a[s10] - a[s00]) << (1-shift);
-				a[s10  ] = ( (hx>=0) ? (hx+prnd)  :  hx        ) & mask ;
-				a[s00  ] = ( (h0>=0) ? (h0+prnd2) : (h0+nrnd2) ) & mask2;
-				s00 += 1;
-				s10 += 1;
-			}
+		/*
+		 * the butterfly and shuffle loops live in hc_strip_run
+		 * so that they can also be spread over worker threads
+		 * for large levels
+		 */
+		strip.phase = HC_BUTTERFLY64;
+		strip.a64 = a;
+		strip.ny = ny;
+		strip.nxtop = nxtop;
+		strip.nytop = nytop;
+		strip.oddy = oddy;
+		strip.shift = shift;
+		strip.mask_ll = mask;
+		strip.mask2_ll = mask2;
+		strip.prnd_ll = prnd;
+		strip.prnd2_ll = prnd2;
+		strip.nrnd2_ll = nrnd2;
+		strip.tmp_ll = tmp;
+#ifdef HAVE_HCOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HCOMPRESS_THREAD_MIN_PIXELS) {
+			hc_run_strips(&strip, 0, nxtop-oddx, 2, NULL, 0);
+		} else
+#endif
+		{
+			strip.istart = 0;
+			strip.iend = nxtop-oddx;
+			hc_strip_run(&strip);
 		}
 		if (oddx) {
 			/*
 			 * do last row if column length is odd
 			 * s10, s10+1 are off edge
 			 */
-			s00 = i*ny;
+			s00 = (nxtop-oddx)*ny;
 			for (j = 0; j<nytop-oddy; j += 2) {
 				h0 = (a[s00+1] + a[s00]) << (1-shift);
 				hy = (a[s00+1] - a[s00]) << (1-shift);
@@ -423,11 +698,21 @@ LONGLONG *tmp;
 		/*
 		 * now shuffle in each dimension to group coefficients by order
 		 */
-		for (i = 0; i<nxtop; i++) {
-			shuffle64(&a[ny*i],nytop,1,tmp);
-		}
-		for (j = 0; j<nytop; j++) {
-			shuffle64(&a[j],nxtop,ny,tmp);
+#ifdef HAVE_HCOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HCOMPRESS_THREAD_MIN_PIXELS) {
+			strip.phase = HC_ROWSHUFFLE64;
+			hc_run_strips(&strip, 0, nxtop, 1, ttmp, tmpsize);
+			strip.phase = HC_COLSHUFFLE64;
+			hc_run_strips(&strip, 0, nytop, 1, ttmp, tmpsize);
+		} else
+#endif
+		{
+			for (i = 0; i<nxtop; i++) {
+				shuffle64(&a[ny*i],nytop,1,tmp);
+			}
+			for (j = 0; j<nytop; j++) {
+				shuffle64(&a[j],nxtop,ny,tmp);
+			}
 		}
 		/*
 		 * image size reduced by 2 (round up if odd)
@@ -448,6 +733,9 @@ LONGLONG *tmp;
 		nrnd2 = prnd2 - 1;
 	}
 	free(tmp);
+#ifdef HAVE_HCOMPRESS_THREADS
+	free(ttmp);
+#endif
 	return(0);
 }
 
@@ -553,7 +841,7 @@ LONGLONG *p1, *p2, *pt;
  */
 
 /* ######################################################################### */
-static void  
+static void
 digitize(int a[], int nx, int ny, int scale)
 {
 int d, *p;
@@ -563,11 +851,32 @@ int d, *p;
 	 */
 	if (scale <= 1) return;
 	d=(scale+1)/2-1;
+
+#ifdef HAVE_HCOMPRESS_THREADS
+	/* every pixel is divided independently, so large images are
+	   split across the worker threads */
+	if (hcompress_nthreads > 1 &&
+	        ((long) nx)*ny >= HCOMPRESS_THREAD_MIN_PIXELS) {
+	    hc_strip strip;
+
+	    strip.phase = HC_DIGITIZE;
+	    strip.a = a;
+	    strip.scale = scale;
+	    strip.d = d;
+	    strip.ny = 0;
+	    strip.nxtop = 0;
+	    strip.nytop = 0;
+	    strip.oddy = 0;
+	    strip.shift = 0;
+	    hc_run_strips(&strip, 0, nx*ny, 1, NULL, 0);
+	    return;
+	}
+#endif
 	for (p=a; p <= &a[nx*ny-1]; p++) *p = ((*p>0) ? (*p+d) : (*p-d))/scale;
 }
 
 /* ######################################################################### */
-static void  
+static void
 digitize64(LONGLONG a[], int nx, int ny, int scale)
 {
 LONGLONG d, *p, scale64;
@@ -579,6 +888,26 @@ LONGLONG d, *p, scale64;
 	d=(scale+1)/2-1;
 	scale64 = scale;  /* use a 64-bit int for efficiency in the big loop */
 
+#ifdef HAVE_HCOMPRESS_THREADS
+	/* every pixel is divided independently, so large images are
+	   split across the worker threads */
+	if (hcompress_nthreads > 1 &&
+	        ((long) nx)*ny >= HCOMPRESS_THREAD_MIN_PIXELS) {
+	    hc_strip strip;
+
+	    strip.phase = HC_DIGITIZE64;
+	    strip.a64 = a;
+	    strip.scale_ll = scale64;
+	    strip.d_ll = d;
+	    strip.ny = 0;
+	    strip.nxtop = 0;
+	    strip.nytop = 0;
+	    strip.oddy = 0;
+	    strip.shift = 0;
+	    hc_run_strips(&strip, 0, nx*ny, 1, NULL, 0);
+	    return;
+	}
+#endif
 	for (p=a; p <= &a[nx*ny-1]; p++) *p = ((*p>0) ? (*p+d) : (*p-d))/scale64;
 }
 /* ######################################################################### */
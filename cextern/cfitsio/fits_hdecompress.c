@@ -80,6 +80,310 @@ static void read_bdirect(unsigned char *infile, int a[], int n, int nqx, int nqy
 static void read_bdirect64(unsigned char *infile, LONGLONG a[], int n, int nqx, int nqy, unsigned char scratch[], int bit);
 static int  input_huffman(unsigned char *infile);
 
+/*  #########################################################################
+Optional multi-threading of the undigitization and inverse H-transform
+stages, mirroring the scheme used on the compression side in
+fits_hcompress.c.
+
+Each expansion level of the inverse transform unshuffles every row and
+every column, then runs the inverse butterfly over independent pairs of
+rows; undigitization multiplies every pixel independently.  These loops
+are partitioned into contiguous strips and spread over a small pool of
+worker threads, with a join between phases serving as the barrier.  The
+arithmetic is unchanged, so the decompressed image is identical to the
+serial result.  The strip loops live in hd_strip_run, which is also used
+(over the full range) when threading is disabled or unavailable.  The
+bit-plane decoding stage remains serial: it consumes a single sequential
+bit stream whose state cannot be partitioned, and it must fill the whole
+coefficient array before undigitization may begin.  The optional
+smoothing pass also stays serial since each coefficient adjustment reads
+neighboring zones.
+ ############################################################################  */
+
+#if !defined(_WIN32)
+#define HAVE_HDECOMPRESS_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* maximum worker threads, and minimum number of pixels in a transform
+   level before spreading the strip loops across threads pays off; the
+   earlier, smaller levels always run serially */
+#define HDECOMPRESS_MAX_THREADS 16
+#define HDECOMPRESS_THREAD_MIN_PIXELS 262144
+
+/* effective number of worker threads; 1 disables threading */
+static int hdecompress_nthreads = 1;
+
+/* one strip of an inverse-transform phase, processed by a single thread */
+typedef struct {
+    int phase;		/* which of the strip loops to run	*/
+    int istart, iend;	/* half-open strip bounds		*/
+    int *a;		/* image array (32-bit variants)	*/
+    LONGLONG *a64;	/* image array (64-bit variants)	*/
+    int ny;		/* full length of a row			*/
+    int nxtop, nytop;	/* active dimensions at this level	*/
+    int oddy;		/* odd row length at this level?	*/
+    int shift;
+    int bit0, bit1, mask0, mask1, prnd0, prnd1, nrnd0, nrnd1;
+    LONGLONG bit0_ll, bit1_ll, mask0_ll, mask1_ll,
+             prnd0_ll, prnd1_ll, nrnd0_ll, nrnd1_ll;
+    int *tmp;		/* unshuffle scratch (32-bit variants)	*/
+    LONGLONG *tmp_ll;	/* unshuffle scratch (64-bit variants)	*/
+    int scale;		/* undigitization parameters		*/
+    LONGLONG scale_ll;
+} hd_strip;
+
+enum {
+    HD_BUTTERFLY,   HD_ROWUNSHUFFLE,   HD_COLUNSHUFFLE,   HD_UNDIGITIZE,
+    HD_BUTTERFLY64, HD_ROWUNSHUFFLE64, HD_COLUNSHUFFLE64, HD_UNDIGITIZE64
+};
+
+int fits_hdecompress_set_threads(int nthreads)
+{
+/*
+   Set the number of threads used for the undigitization and inverse
+   H-transform stages of subsequent fits_hdecompress calls: 1 disables
+   threading and 0 means one thread per processor.  Returns the
+   effective setting.
+*/
+#ifdef HAVE_HDECOMPRESS_THREADS
+    if (nthreads < 0) nthreads = 1;
+    if (nthreads == 0) {
+	long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = (nproc > 0) ? (int) nproc : 1;
+    }
+    if (nthreads > HDECOMPRESS_MAX_THREADS) nthreads = HDECOMPRESS_MAX_THREADS;
+    hdecompress_nthreads = nthreads;
+#else
+    hdecompress_nthreads = 1;
+#endif
+    return(hdecompress_nthreads);
+}
+
+static void *hd_strip_run(void *arg)
+{
+hd_strip *s = (hd_strip *) arg;
+int i, j, s00, s10;
+int h0, hx, hy, hc, lowbit0, lowbit1;
+LONGLONG hh0, hhx, hhy, hhc, llowbit0, llowbit1;
+int ny = s->ny;
+int nytop = s->nytop, nxtop = s->nxtop, oddy = s->oddy, shift = s->shift;
+
+    switch (s->phase) {
+    case HD_BUTTERFLY: {
+	int *a = s->a;
+	int bit0 = s->bit0, bit1 = s->bit1;
+	int mask0 = s->mask0, mask1 = s->mask1;
+	int prnd0 = s->prnd0, prnd1 = s->prnd1;
+	int nrnd0 = s->nrnd0, nrnd1 = s->nrnd1;
+
+	for (i = s->istart; i < s->iend; i += 2) {
+	    s00 = ny*i;				/* s00 is index of a[i,j]	*/
+	    s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
+	    for (j = 0; j<nytop-oddy; j += 2) {
+		h0 = a[s00  ];
+		hx = a[s10  ];
+		hy = a[s00+1];
+		hc = a[s10+1];
+		/*
+		 * round hx and hy to multiple of bit1, hc to multiple of bit0
+		 * h0 is already a multiple of bit2
+		 */
+		hx = (hx + ((hx >= 0) ? prnd1 : nrnd1)) & mask1;
+		hy = (hy + ((hy >= 0) ? prnd1 : nrnd1)) & mask1;
+		hc = (hc + ((hc >= 0) ? prnd0 : nrnd0)) & mask0;
+		/*
+		 * propagate bit0 of hc to hx,hy
+		 */
+		lowbit0 = hc & bit0;
+		hx = (hx >= 0) ? (hx - lowbit0) : (hx + lowbit0);
+		hy = (hy >= 0) ? (hy - lowbit0) : (hy + lowbit0);
+		/*
+		 * Propagate bits 0 and 1 of hc,hx,hy to h0.
+		 * This could be simplified if we assume h0>0, but then
+		 * the inversion would not be lossless for images with
+		 * negative pixels.
+		 */
+		lowbit1 = (hc ^ hx ^ hy) & bit1;
+		h0 = (h0 >= 0)
+			? (h0 + lowbit0 - lowbit1)
+			: (h0 + ((lowbit0 == 0) ? lowbit1 : (lowbit0-lowbit1)));
+		/*
+		 * Divide sums by 2 (4 last time)
+		 */
+		a[s10+1] = (h0 + hx + hy + hc) >> shift;
+		a[s10  ] = (h0 + hx - hy - hc) >> shift;
+		a[s00+1] = (h0 - hx + hy - hc) >> shift;
+		a[s00  ] = (h0 - hx - hy + hc) >> shift;
+		s00 += 2;
+		s10 += 2;
+	    }
+	    if (oddy) {
+		/*
+		 * do last element in row if row length is odd
+		 * s00+1, s10+1 are off edge
+		 */
+		h0 = a[s00  ];
+		hx = a[s10  ];
+		hx = ((hx >= 0) ? (hx+prnd1) : (hx+nrnd1)) & mask1;
+		lowbit1 = hx & bit1;
+		h0 = (h0 >= 0) ? (h0 - lowbit1) : (h0 + lowbit1);
+		a[s10  ] = (h0 + hx) >> shift;
+		a[s00  ] = (h0 - hx) >> shift;
+	    }
+	}
+	break;
+    }
+    case HD_ROWUNSHUFFLE:
+	for (i = s->istart; i < s->iend; i++) {
+	    unshuffle(&s->a[ny*i],nytop,1,s->tmp);
+	}
+	break;
+    case HD_COLUNSHUFFLE:
+	for (j = s->istart; j < s->iend; j++) {
+	    unshuffle(&s->a[j],nxtop,ny,s->tmp);
+	}
+	break;
+    case HD_UNDIGITIZE: {
+	int *a = s->a;
+	int scale = s->scale;
+
+	for (i = s->istart; i < s->iend; i++) {
+	    a[i] = a[i]*scale;
+	}
+	break;
+    }
+    case HD_BUTTERFLY64: {
+	LONGLONG *a = s->a64;
+	LONGLONG bit0 = s->bit0_ll, bit1 = s->bit1_ll;
+	LONGLONG mask0 = s->mask0_ll, mask1 = s->mask1_ll;
+	LONGLONG prnd0 = s->prnd0_ll, prnd1 = s->prnd1_ll;
+	LONGLONG nrnd0 = s->nrnd0_ll, nrnd1 = s->nrnd1_ll;
+
+	for (i = s->istart; i < s->iend; i += 2) {
+	    s00 = ny*i;				/* s00 is index of a[i,j]	*/
+	    s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
+	    for (j = 0; j<nytop-oddy; j += 2) {
+		hh0 = a[s00  ];
+		hhx = a[s10  ];
+		hhy = a[s00+1];
+		hhc = a[s10+1];
+		/*
+		 * round hx and hy to multiple of bit1, hc to multiple of bit0
+		 * h0 is already a multiple of bit2
+		 */
+		hhx = (hhx + ((hhx >= 0) ? prnd1 : nrnd1)) & mask1;
+		hhy = (hhy + ((hhy >= 0) ? prnd1 : nrnd1)) & mask1;
+		hhc = (hhc + ((hhc >= 0) ? prnd0 : nrnd0)) & mask0;
+		/*
+		 * propagate bit0 of hc to hx,hy
+		 */
+		llowbit0 = hhc & bit0;
+		hhx = (hhx >= 0) ? (hhx - llowbit0) : (hhx + llowbit0);
+		hhy = (hhy >= 0) ? (hhy - llowbit0) : (hhy + llowbit0);
+		/*
+		 * Propagate bits 0 and 1 of hc,hx,hy to h0.
+		 * This could be simplified if we assume h0>0, but then
+		 * the inversion would not be lossless for images with
+		 * negative pixels.
+		 */
+		llowbit1 = (hhc ^ hhx ^ hhy) & bit1;
+		hh0 = (hh0 >= 0)
+			? (hh0 + llowbit0 - llowbit1)
+			: (hh0 + ((llowbit0 == 0) ? llowbit1 : (llowbit0-llowbit1)));
+		/*
+		 * Divide sums by 2 (4 last time)
+		 */
+		a[s10+1] = (hh0 + hhx + hhy + hhc) >> shift;
+		a[s10  ] = (hh0 + hhx - hhy - hhc) >> shift;
+		a[s00+1] = (hh0 - hhx + hhy - hhc) >> shift;
+		a[s00  ] = (hh0 - hhx - hhy + hhc) >> shift;
+		s00 += 2;
+		s10 += 2;
+	    }
+	    if (oddy) {
+		/*
+		 * do last element in row if row length is odd
+		 * s00+1, s10+1 are off edge
+		 */
+		hh0 = a[s00  ];
+		hhx = a[s10  ];
+		hhx = ((hhx >= 0) ? (hhx+prnd1) : (hhx+nrnd1)) & mask1;
+		llowbit1 = hhx & bit1;
+		hh0 = (hh0 >= 0) ? (hh0 - llowbit1) : (hh0 + llowbit1);
+		a[s10  ] = (hh0 + hhx) >> shift;
+		a[s00  ] = (hh0 - hhx) >> shift;
+	    }
+	}
+	break;
+    }
+    case HD_ROWUNSHUFFLE64:
+	for (i = s->istart; i < s->iend; i++) {
+	    unshuffle64(&s->a64[ny*i],nytop,1,s->tmp_ll);
+	}
+	break;
+    case HD_COLUNSHUFFLE64:
+	for (j = s->istart; j < s->iend; j++) {
+	    unshuffle64(&s->a64[j],nxtop,ny,s->tmp_ll);
+	}
+	break;
+    case HD_UNDIGITIZE64: {
+	LONGLONG *a = s->a64;
+	LONGLONG scale = s->scale_ll;
+
+	for (i = s->istart; i < s->iend; i++) {
+	    a[i] = a[i]*scale;
+	}
+	break;
+    }
+    }
+    return(NULL);
+}
+
+#ifdef HAVE_HDECOMPRESS_THREADS
+/* spread one strip loop over the worker threads; strip bounds are cut
+   at a multiple of step so that butterfly row pairs stay together.
+   tmpbase, when given, provides tmpstride bytes of private unshuffle
+   scratch per thread. */
+static void hd_run_strips(hd_strip *proto, int lo, int hi, int step,
+                          void *tmpbase, size_t tmpstride)
+{
+    pthread_t threads[HDECOMPRESS_MAX_THREADS];
+    hd_strip strips[HDECOMPRESS_MAX_THREADS];
+    int idx, nthreads, count, chunk;
+
+    count = (hi - lo + step - 1) / step;	/* number of strip units */
+    if (count < 1) return;
+    nthreads = hdecompress_nthreads;
+    if (nthreads > count) nthreads = count;
+
+    chunk = (count + nthreads - 1) / nthreads;
+    for (idx = 0; idx < nthreads; idx++) {
+	strips[idx] = *proto;
+	strips[idx].istart = lo + idx*chunk*step;
+	strips[idx].iend = strips[idx].istart + chunk*step;
+	if (strips[idx].iend > hi) strips[idx].iend = hi;
+	if (tmpbase) {
+	    strips[idx].tmp = (int *) ((char *) tmpbase + idx*tmpstride);
+	    strips[idx].tmp_ll = (LONGLONG *) ((char *) tmpbase + idx*tmpstride);
+	}
+	/* the last strip runs on this thread; if a worker cannot be
+	   created its strip simply runs here too */
+	if (idx == nthreads - 1 ||
+	        pthread_create(&threads[idx], NULL, hd_strip_run,
+	                       &strips[idx]) != 0) {
+	    threads[idx] = pthread_self();
+	    hd_strip_run(&strips[idx]);
+	}
+    }
+    for (idx = 0; idx < nthreads; idx++) {
+	if (!pthread_equal(threads[idx], pthread_self()))
+	    pthread_join(threads[idx], NULL);
+    }
+}
+#endif /* HAVE_HDECOMPRESS_THREADS */
+
 /* ---------------------------------------------------------------------- */
 int fits_hdecompress(unsigned char *input, int smooth, int *a, int *ny, int *nx, 
                      int *scale, int *status)
@@ -199,10 +503,15 @@ int nmax, log2n, i, j, k;
 int nxtop,nytop,nxf,nyf,c;
 int oddx,oddy;
 int shift, bit0, bit1, bit2, mask0, mask1, mask2,
-	prnd0, prnd1, prnd2, nrnd0, nrnd1, nrnd2, lowbit0, lowbit1;
-int h0, hx, hy, hc;
-int s10, s00;
+	prnd0, prnd1, prnd2, nrnd0, nrnd1, nrnd2, lowbit1;
+int h0, hy;
+int s00;
 int *tmp;
+hd_strip strip;
+#ifdef HAVE_HDECOMPRESS_THREADS
+char *ttmp = NULL;
+size_t tmpsize;
+#endif
 
 	/*
 	 * log2n is log2 of max(nx,ny) rounded up to next power of 2
@@ -214,12 +523,21 @@ int *tmp;
 	}
 	/*
 	 * get temporary storage for shuffling elements
-	 */  
+	 */
 	tmp = (int *) malloc(((nmax+1)/2)*sizeof(int));
 	if (tmp == (int *) NULL) {
 		ffpmsg("hinv: insufficient memory");
 		return(DATA_DECOMPRESSION_ERR);
 	}
+#ifdef HAVE_HDECOMPRESS_THREADS
+	/*
+	 * private unshuffle scratch for each worker thread; if the
+	 * allocation fails the strip loops below simply run serially
+	 */
+	tmpsize = ((nmax+1)/2)*sizeof(int);
+	if (hdecompress_nthreads > 1)
+	    ttmp = (char *) malloc(hdecompress_nthreads*tmpsize);
+#endif
 	/*
 	 * set up masks, rounding parameters
 	 */
@@ -268,13 +586,40 @@ int *tmp;
 			shift = 2;
 		}
 		/*
-		 * unshuffle in each dimension to interleave coefficients
+		 * unshuffle in each dimension to interleave coefficients;
+		 * the unshuffle and butterfly loops live in hd_strip_run
+		 * so that they can also be spread over worker threads
+		 * for large levels
 		 */
-		for (i = 0; i<nxtop; i++) {
-			unshuffle(&a[ny*i],nytop,1,tmp);
-		}
-		for (j = 0; j<nytop; j++) {
-			unshuffle(&a[j],nxtop,ny,tmp);
+		strip.a = a;
+		strip.ny = ny;
+		strip.nxtop = nxtop;
+		strip.nytop = nytop;
+		strip.shift = shift;
+		strip.bit0 = bit0;
+		strip.bit1 = bit1;
+		strip.mask0 = mask0;
+		strip.mask1 = mask1;
+		strip.prnd0 = prnd0;
+		strip.prnd1 = prnd1;
+		strip.nrnd0 = nrnd0;
+		strip.nrnd1 = nrnd1;
+		strip.tmp = tmp;
+#ifdef HAVE_HDECOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HDECOMPRESS_THREAD_MIN_PIXELS) {
+			strip.phase = HD_ROWUNSHUFFLE;
+			hd_run_strips(&strip, 0, nxtop, 1, ttmp, tmpsize);
+			strip.phase = HD_COLUNSHUFFLE;
+			hd_run_strips(&strip, 0, nytop, 1, ttmp, tmpsize);
+		} else
+#endif
+		{
+			for (i = 0; i<nxtop; i++) {
+				unshuffle(&a[ny*i],nytop,1,tmp);
+			}
+			for (j = 0; j<nytop; j++) {
+				unshuffle(&a[j],nxtop,ny,tmp);
+			}
 		}
 		/*
 		 * smooth by interpolating coefficients if SMOOTH != 0
@@ -282,67 +627,24 @@ int *tmp;
 		if (smooth) hsmooth(a,nxtop,nytop,ny,scale);
 		oddx = nxtop % 2;
 		oddy = nytop % 2;
-		for (i = 0; i<nxtop-oddx; i += 2) {
-			s00 = ny*i;				/* s00 is index of a[i,j]	*/
-			s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
-			for (j = 0; j<nytop-oddy; j += 2) {
-				h0 = a[s00  ];
-				hx = a[s10  ];
-				hy = a[s00+1];
-				hc = a[s10+1];
-				/*
-				 * round hx and hy to multiple of bit1, hc to multiple of bit0
-				 * h0 is already a multiple of bit2
-				 */
-				hx = (hx + ((hx >= 0) ? prnd1 : nrnd1)) & mask1;
-				hy = (hy + ((hy >= 0) ? prnd1 : nrnd1)) & mask1;
-				hc = (hc + ((hc >= 0) ? prnd0 : nrnd0)) & mask0;
-				/*
-				 * propagate bit0 of hc to hx,hy
-				 */
-				lowbit0 = hc & bit0;
-				hx = (hx >= 0) ? (hx - lowbit0) : (hx + lowbit0);
-				hy = (hy >= 0) ? (hy - lowbit0) : (hy + lowbit0);
-				/*
-				 * Propagate bits 0 and 1 of hc,hx,hy to h0.
-				 * This could be simplified if we assume h0>0, but then
-				 * the inversion would not be lossless for images with
-				 * negative pixels.
-				 */
-				lowbit1 = (hc ^ hx ^ hy) & bit1;
-				h0 = (h0 >= 0)
-					? (h0 + lowbit0 - lowbit1)
-					: (h0 + ((lowbit0 == 0) ? lowbit1 : (lowbit0-lowbit1)));
-				/*
-				 * Divide sums by 2 (4 last time)
-				 */
-				a[s10+1] = (h0 + hx + hy + hc) >> shift;
-				a[s10  ] = (h0 + hx - hy - hc) >> shift;
-				a[s00+1] = (h0 - hx + hy - hc) >> shift;
-				a[s00  ] = (h0 - hx - hy + hc) >> shift;
-				s00 += 2;
-				s10 += 2;
-			}
-			if (oddy) {
-				/*
-				 * do last element in row if row length is odd
-				 * s00+1, s10+1 are off edge
-				 */
-				h0 = a[s00  ];
-				hx = a[s10  ];
-				hx = ((hx >= 0) ? (hx+prnd1) : (hx+nrnd1)) & mask1;
-				lowbit1 = hx & bit1;
-				h0 = (h0 >= 0) ? (h0 - lowbit1) : (h0 + lowbit1);
-				a[s10  ] = (h0 + hx) >> shift;
-				a[s00  ] = (h0 - hx) >> shift;
-			}
+		strip.phase = HD_BUTTERFLY;
+		strip.oddy = oddy;
+#ifdef HAVE_HDECOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HDECOMPRESS_THREAD_MIN_PIXELS) {
+			hd_run_strips(&strip, 0, nxtop-oddx, 2, NULL, 0);
+		} else
+#endif
+		{
+			strip.istart = 0;
+			strip.iend = nxtop-oddx;
+			hd_strip_run(&strip);
 		}
 		if (oddx) {
 			/*
 			 * do last row if column length is odd
 			 * s10, s10+1 are off edge
 			 */
-			s00 = ny*i;
+			s00 = ny*(nxtop-oddx);
 			for (j = 0; j<nytop-oddy; j += 2) {
 				h0 = a[s00  ];
 				hy = a[s00+1];
@@ -376,10 +678,13 @@ int *tmp;
 		nrnd0 = prnd0 - 1;
 	}
 	free(tmp);
+#ifdef HAVE_HDECOMPRESS_THREADS
+	free(ttmp);
+#endif
 	return(0);
 }
 /*  ############################################################################  */
-static int 
+static int
 hinv64(LONGLONG a[], int nx, int ny, int smooth ,int scale)
 /*
 int smooth;    0 for no smoothing, else smooth during inversion 
@@ -391,10 +696,15 @@ int nxtop,nytop,nxf,nyf,c;
 int oddx,oddy;
 int shift;
 LONGLONG mask0, mask1, mask2, prnd0, prnd1, prnd2, bit0, bit1, bit2;
-LONGLONG  nrnd0, nrnd1, nrnd2, lowbit0, lowbit1;
-LONGLONG h0, hx, hy, hc;
-int s10, s00;
+LONGLONG  nrnd0, nrnd1, nrnd2, lowbit1;
+LONGLONG h0, hy;
+int s00;
 LONGLONG *tmp;
+hd_strip strip;
+#ifdef HAVE_HDECOMPRESS_THREADS
+char *ttmp = NULL;
+size_t tmpsize;
+#endif
 
 	/*
 	 * log2n is log2 of max(nx,ny) rounded up to next power of 2
@@ -406,12 +716,21 @@ LONGLONG *tmp;
 	}
 	/*
 	 * get temporary storage for shuffling elements
-	 */  
+	 */
 	tmp = (LONGLONG *) malloc(((nmax+1)/2)*sizeof(LONGLONG));
 	if (tmp == (LONGLONG *) NULL) {
 		ffpmsg("hinv64: insufficient memory");
 		return(DATA_DECOMPRESSION_ERR);
 	}
+#ifdef HAVE_HDECOMPRESS_THREADS
+	/*
+	 * private unshuffle scratch for each worker thread; if the
+	 * allocation fails the strip loops below simply run serially
+	 */
+	tmpsize = ((nmax+1)/2)*sizeof(LONGLONG);
+	if (hdecompress_nthreads > 1)
+	    ttmp = (char *) malloc(hdecompress_nthreads*tmpsize);
+#endif
 	/*
 	 * set up masks, rounding parameters
 	 */
@@ -460,13 +779,40 @@ LONGLONG *tmp;
 			shift = 2;
 		}
 		/*
-		 * unshuffle in each dimension to interleave coefficients
+		 * unshuffle in each dimension to interleave coefficients;
+		 * the unshuffle and butterfly loops live in hd_strip_run
+		 * so that they can also be spread over worker threads
+		 * for large levels
 		 */
-		for (i = 0; i<nxtop; i++) {
-			unshuffle64(&a[ny*i],nytop,1,tmp);
-		}
-		for (j = 0; j<nytop; j++) {
-			unshuffle64(&a[j],nxtop,ny,tmp);
+		strip.a64 = a;
+		strip.ny = ny;
+		strip.nxtop = nxtop;
+		strip.nytop = nytop;
+		strip.shift = shift;
+		strip.bit0_ll = bit0;
+		strip.bit1_ll = bit1;
+		strip.mask0_ll = mask0;
+		strip.mask1_ll = mask1;
+		strip.prnd0_ll = prnd0;
+		strip.prnd1_ll = prnd1;
+		strip.nrnd0_ll = nrnd0;
+		strip.nrnd1_ll = nrnd1;
+		strip.tmp_ll = tmp;
+#ifdef HAVE_HDECOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HDECOMPRESS_THREAD_MIN_PIXELS) {
+			strip.phase = HD_ROWUNSHUFFLE64;
+			hd_run_strips(&strip, 0, nxtop, 1, ttmp, tmpsize);
+			strip.phase = HD_COLUNSHUFFLE64;
+			hd_run_strips(&strip, 0, nytop, 1, ttmp, tmpsize);
+		} else
+#endif
+		{
+			for (i = 0; i<nxtop; i++) {
+				unshuffle64(&a[ny*i],nytop,1,tmp);
+			}
+			for (j = 0; j<nytop; j++) {
+				unshuffle64(&a[j],nxtop,ny,tmp);
+			}
 		}
 		/*
 		 * smooth by interpolating coefficients if SMOOTH != 0
@@ -474,67 +820,24 @@ LONGLONG *tmp;
 		if (smooth) hsmooth64(a,nxtop,nytop,ny,scale);
 		oddx = nxtop % 2;
 		oddy = nytop % 2;
-		for (i = 0; i<nxtop-oddx; i += 2) {
-			s00 = ny*i;				/* s00 is index of a[i,j]	*/
-			s10 = s00+ny;			/* s10 is index of a[i+1,j]	*/
-			for (j = 0; j<nytop-oddy; j += 2) {
-				h0 = a[s00  ];
-				hx = a[s10  ];
-				hy = a[s00+1];
-				hc = a[s10+1];
-				/*
-				 * round hx and hy to multiple of bit1, hc to multiple of bit0
-				 * h0 is already a multiple of bit2
-				 */
-				hx = (hx + ((hx >= 0) ? prnd1 : nrnd1)) & mask1;
-				hy = (hy + ((hy >= 0) ? prnd1 : nrnd1)) & mask1;
-				hc = (hc + ((hc >= 0) ? prnd0 : nrnd0)) & mask0;
-				/*
-				 * propagate bit0 of hc to hx,hy
-				 */
-				lowbit0 = hc & bit0;
-				hx = (hx >= 0) ? (hx - lowbit0) : (hx + lowbit0);
-				hy = (hy >= 0) ? (hy - lowbit0) : (hy + lowbit0);
-				/*
-				 * Propagate bits 0 and 1 of hc,hx,hy to h0.
-				 * This could be simplified if we assume h0>0, but then
-				 * the inversion would not be lossless for images with
-				 * negative pixels.
-				 */
-				lowbit1 = (hc ^ hx ^ hy) & bit1;
-				h0 = (h0 >= 0)
-					? (h0 + lowbit0 - lowbit1)
-					: (h0 + ((lowbit0 == 0) ? lowbit1 : (lowbit0-lowbit1)));
-				/*
-				 * Divide sums by 2 (4 last time)
-				 */
-				a[s10+1] = (h0 + hx + hy + hc) >> shift;
-				a[s10  ] = (h0 + hx - hy - hc) >> shift;
-				a[s00+1] = (h0 - hx + hy - hc) >> shift;
-				a[s00  ] = (h0 - hx - hy + hc) >> shift;
-				s00 += 2;
-				s10 += 2;
-			}
-			if (oddy) {
-				/*
-				 * do last element in row if row length is odd
-				 * s00+1, s10+1 are off edge
-				 */
-				h0 = a[s00  ];
-				hx = a[s10  ];
-				hx = ((hx >= 0) ? (hx+prnd1) : (hx+nrnd1)) & mask1;
-				lowbit1 = hx & bit1;
-				h0 = (h0 >= 0) ? (h0 - lowbit1) : (h0 + lowbit1);
-				a[s10  ] = (h0 + hx) >> shift;
-				a[s00  ] = (h0 - hx) >> shift;
-			}
+		strip.phase = HD_BUTTERFLY64;
+		strip.oddy = oddy;
+#ifdef HAVE_HDECOMPRESS_THREADS
+		if (ttmp && ((long) nxtop)*nytop >= HDECOMPRESS_THREAD_MIN_PIXELS) {
+			hd_run_strips(&strip, 0, nxtop-oddx, 2, NULL, 0);
+		} else
+#endif
+		{
+			strip.istart = 0;
+			strip.iend = nxtop-oddx;
+			hd_strip_run(&strip);
 		}
 		if (oddx) {
 			/*
 			 * do last row if column length is odd
 			 * s10, s10+1 are off edge
 			 */
-			s00 = ny*i;
+			s00 = ny*(nxtop-oddx);
 			for (j = 0; j<nytop-oddy; j += 2) {
 				h0 = a[s00  ];
 				hy = a[s00+1];
@@ -568,6 +871,9 @@ LONGLONG *tmp;
 		nrnd0 = prnd0 - 1;
 	}
 	free(tmp);
+#ifdef HAVE_HDECOMPRESS_THREADS
+	free(ttmp);
+#endif
 	return(0);
 }
 
@@ -1009,6 +1315,26 @@ int *p;
 	 * multiply by scale
 	 */
 	if (scale <= 1) return;
+
+#ifdef HAVE_HDECOMPRESS_THREADS
+	/* every pixel is multiplied independently, so large images are
+	   split across the worker threads */
+	if (hdecompress_nthreads > 1 &&
+	        ((long) nx)*ny >= HDECOMPRESS_THREAD_MIN_PIXELS) {
+	    hd_strip strip;
+
+	    strip.phase = HD_UNDIGITIZE;
+	    strip.a = a;
+	    strip.scale = scale;
+	    strip.ny = 0;
+	    strip.nxtop = 0;
+	    strip.nytop = 0;
+	    strip.oddy = 0;
+	    strip.shift = 0;
+	    hd_run_strips(&strip, 0, nx*ny, 1, NULL, 0);
+	    return;
+	}
+#endif
 	for (p=a; p <= &a[nx*ny-1]; p++) *p = (*p)*scale;
 }
 /*  ############################################################################  */
@@ -1022,7 +1348,26 @@ LONGLONG *p, scale64;
 	 */
 	if (scale <= 1) return;
 	scale64 = (LONGLONG) scale;   /* use a 64-bit int for efficiency in the big loop */
-	
+
+#ifdef HAVE_HDECOMPRESS_THREADS
+	/* every pixel is multiplied independently, so large images are
+	   split across the worker threads */
+	if (hdecompress_nthreads > 1 &&
+	        ((long) nx)*ny >= HDECOMPRESS_THREAD_MIN_PIXELS) {
+	    hd_strip strip;
+
+	    strip.phase = HD_UNDIGITIZE64;
+	    strip.a64 = a;
+	    strip.scale_ll = scale64;
+	    strip.ny = 0;
+	    strip.nxtop = 0;
+	    strip.nytop = 0;
+	    strip.oddy = 0;
+	    strip.shift = 0;
+	    hd_run_strips(&strip, 0, nx*ny, 1, NULL, 0);
+	    return;
+	}
+#endif
 	for (p=a; p <= &a[nx*ny-1]; p++) *p = (*p)*scale64;
 }
 
@@ -1210,9 +1210,11 @@ int ffmkey(fitsfile *fptr,    /* I - FITS file pointer  */
     fftrec(tcard, status);   */     /* test rest of keyword for legal chars   */
 
     /* move position of keyword to be over written */
-    ffmbyt(fptr, ((fptr->Fptr)->nextkey) - 80, REPORT_EOF, status); 
+    ffmbyt(fptr, ((fptr->Fptr)->nextkey) - 80, REPORT_EOF, status);
     ffpbyt(fptr, 80, tcard, status);   /* write the 80 byte card */
 
+    (fptr->Fptr)->keyindexvalid = 0;   /* keyword position index is stale */
+
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -3105,6 +3107,156 @@ int ffgcno( fitsfile *fptr,  /* I - FITS file pionter                       */
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
+typedef struct   /* one slot of the per-HDU column name index */
+{
+    char name[FLEN_VALUE];  /* uppercased column name, trailing blanks removed */
+    int colnum;             /* number of the column; 0 = empty slot */
+    int dup;                /* does the name match more than one column? */
+} colindexslot;
+
+static int ffcihs(const char *name, int nslots)
+/*
+  hash a column name into a slot number (FNV-1a hash)
+*/
+{
+    unsigned int hash = 2166136261U;
+
+    while (*name)
+    {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619U;
+    }
+    return ((int) (hash % (unsigned int) nslots));
+}
+/*--------------------------------------------------------------------------*/
+static int ffcibl(fitsfile *fptr)
+/*
+  build the column name index for the current HDU from the table
+  column structures.  Each TTYPEn value, with trailing blanks removed
+  and converted to upper case exactly as ffcmps does for a case
+  insensitive comparison, is entered into an open-addressing hash
+  table along with its column number.  Returns 0 if the index was
+  built, 1 if it could not be (searches then remain sequential).
+*/
+{
+    int nslots, slot, ii, jj;
+    char name[FLEN_VALUE];
+    tcolumn *colptr;
+    colindexslot *index;
+    FITSfile *Fptr = fptr->Fptr;
+
+    nslots = 2 * Fptr->tfield + 7;   /* keep the table at most half full */
+
+    if (Fptr->colindex && Fptr->colindexnslots < nslots)
+    {
+        free(Fptr->colindex);   /* existing table is too small */
+        Fptr->colindex = 0;
+    }
+
+    if (!Fptr->colindex)
+    {
+        Fptr->colindex = malloc(nslots * sizeof(colindexslot));
+        if (!Fptr->colindex)
+            return(1);
+        Fptr->colindexnslots = nslots;
+    }
+    else
+        nslots = Fptr->colindexnslots;  /* reuse the larger existing table */
+
+    index = (colindexslot *) Fptr->colindex;
+    memset(index, 0, nslots * sizeof(colindexslot));
+
+    colptr = Fptr->tableptr;
+    for (ii = 0; ii < Fptr->tfield; ii++, colptr++)
+    {
+        strncpy(name, colptr->ttype, FLEN_VALUE);
+        name[FLEN_VALUE - 1] = '\0';
+
+        for (jj = strlen(name) - 1; jj >= 0 && name[jj] == ' '; jj--)
+            name[jj] = '\0';    /* truncate trailing non-significant blanks */
+
+        if (!name[0])
+            continue;    /* columns without a name are not indexed */
+
+        ffupch(name);    /* convert to uppercase, as ffcmps does */
+
+        slot = ffcihs(name, nslots);
+        while (index[slot].colnum && strcmp(index[slot].name, name))
+            slot = (slot + 1) % nslots;   /* linear probing */
+
+        if (index[slot].colnum)
+            index[slot].dup = 1;  /* name matches more than one column */
+        else
+        {
+            strcpy(index[slot].name, name);
+            index[slot].colnum = ii + 1;
+        }
+    }
+
+    Fptr->colindexvalid = 1;
+    Fptr->colindexhdu = Fptr->curhdu;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static int ffcilu(fitsfile *fptr,  /* I - FITS file pointer              */
+           char *templt,           /* I - column name, without wildcards */
+           int *colnum)            /* O - number of the column;          */
+                                   /*     0 = no column has this name,   */
+                                   /*     -1 = index cannot answer, do a */
+                                   /*     sequential search instead      */
+/*
+  look up a column name in the per-HDU name index, building or
+  rebuilding the index first if the column structures have changed
+  since it was last built.  Names matching more than one column are
+  reported as unanswerable so that the sequential search can apply
+  its not-unique continuation protocol.
+*/
+{
+    char name[FLEN_VALUE];
+    colindexslot *index;
+    int slot, ii;
+    FITSfile *Fptr = fptr->Fptr;
+
+    *colnum = -1;
+
+    if (strlen(templt) >= FLEN_VALUE)
+        return(0);    /* too long to be a column name; fall back */
+
+    if (!Fptr->colindexvalid || Fptr->colindexhdu != Fptr->curhdu)
+    {
+        Fptr->colindexvalid = 0;
+        if (ffcibl(fptr))
+            return(0);    /* could not build an index */
+    }
+
+    strcpy(name, templt);
+    for (ii = strlen(name) - 1; ii >= 0 && name[ii] == ' '; ii--)
+        name[ii] = '\0';    /* truncate trailing non-significant blanks */
+
+    if (!name[0])
+        return(0);    /* blank template; fall back */
+
+    ffupch(name);    /* convert to uppercase, as ffcmps does */
+
+    index = (colindexslot *) Fptr->colindex;
+    slot = ffcihs(name, Fptr->colindexnslots);
+
+    while (index[slot].colnum)
+    {
+        if (!strcmp(index[slot].name, name))
+        {
+            if (!index[slot].dup)
+                *colnum = index[slot].colnum;   /* unique match */
+
+            return(0);  /* duplicates leave *colnum = -1 */
+        }
+        slot = (slot + 1) % Fptr->colindexnslots;
+    }
+
+    *colnum = 0;   /* no column has this name */
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
 int ffgcnn( fitsfile *fptr,  /* I - FITS file pointer                       */
             int  casesen,    /* I - case sensitive string comparison? 0=no  */
             char *templt,    /* I - input name of column (w/wildcards)      */
@@ -3122,6 +3274,7 @@ int ffgcnn( fitsfile *fptr,  /* I - FITS file pointer                       */
 {
     char errmsg[FLEN_ERRMSG];
     int tstatus, ii, founde, foundw, match, exact, unique;
+    int indexcol, skipscan = FALSE;
     long ivalue;
     tcolumn *colptr;
 
@@ -3155,6 +3308,29 @@ int ffgcnn( fitsfile *fptr,  /* I - FITS file pointer                       */
     foundw = FALSE;   /* initialize 'found wildcard match' flag */
     unique = FALSE;
 
+    if (tstatus == 0 && !casesen && !strchr(templt, '*') &&
+        !strchr(templt, '?') && !strchr(templt, '#'))
+    {
+        /* a fresh, case insensitive search for a name with no wildcards */
+        /* can be answered from the column name index in constant time   */
+        ffcilu(fptr, templt, &indexcol);
+
+        if (indexcol > 0)
+        {
+            colptr = (fptr->Fptr)->tableptr + (indexcol - 1);
+            strcpy(colname, colptr->ttype);
+            *colnum = indexcol;
+            (fptr->Fptr)->startcol = *colnum;  /* save pointer for next time */
+            return(*status);
+        }
+        else if (indexcol == 0)
+            skipscan = TRUE;   /* no match; go test for an integer template */
+
+        /* indexcol = -1: duplicate names etc; do the sequential search */
+    }
+
+    if (!skipscan)
+    {
     for (ii = (fptr->Fptr)->startcol; ii < (fptr->Fptr)->tfield; ii++, colptr++)
     {
         ffcmps(templt, colptr->ttype, casesen, &match, &exact);
@@ -3195,6 +3371,7 @@ int ffgcnn( fitsfile *fptr,  /* I - FITS file pointer                       */
             }
         }
     }
+    }
 
     /* OK, we've checked all the names now see if we got any matches */
     if (founde)
@@ -4229,9 +4406,12 @@ int ffrhdu(fitsfile *fptr,    /* I - FITS file pointer */
         /* Without this code, CFITSIO would repeatedly realloc  memory */
         /* to incrementally increase the size of the file by 2880 bytes */
         /* at a time, until it reached the final size */
- 
+
+        /* a read-only memory file can never grow, so don't try to */
+        /* preallocate it (the memory may be borrowed from the caller) */
         ffurlt(fptr, urltype, status);
-        if (!strcmp(urltype,"mem://") || !strcmp(urltype,"memkeep://"))
+        if ((fptr->Fptr)->writemode == READWRITE &&
+           (!strcmp(urltype,"mem://") || !strcmp(urltype,"memkeep://")))
         {
             fftrun(fptr, (fptr->Fptr)->headstart[ (fptr->Fptr)->curhdu + 1],
                status);
@@ -4378,8 +4558,7 @@ int ffpinit(fitsfile *fptr,      /* I - FITS file pointer */
 
         /* free the tile-compressed image cache, if it exists */
         if ((fptr->Fptr)->tilerow) {
-           ntilebins = 
-	    (((fptr->Fptr)->znaxis[0] - 1) / ((fptr->Fptr)->tilesize[0])) + 1;
+           ntilebins = (fptr->Fptr)->tilenslots;
 
            for (ii = 0; ii < ntilebins; ii++) {
              if ((fptr->Fptr)->tiledata[ii]) {
@@ -4396,6 +4575,7 @@ int ffpinit(fitsfile *fptr,      /* I - FITS file pointer */
 	    free((fptr->Fptr)->tiledatasize);
 	    free((fptr->Fptr)->tilenullarray);
 	    free((fptr->Fptr)->tiledata);
+	    free((fptr->Fptr)->tileage);
 	    free((fptr->Fptr)->tilerow);
 
 	    (fptr->Fptr)->tileanynull = 0;
@@ -4403,13 +4583,16 @@ int ffpinit(fitsfile *fptr,      /* I - FITS file pointer */
 	    (fptr->Fptr)->tiledatasize = 0;
 	    (fptr->Fptr)->tilenullarray = 0;
 	    (fptr->Fptr)->tiledata = 0;
+	    (fptr->Fptr)->tileage = 0;
 	    (fptr->Fptr)->tilerow = 0;
+	    (fptr->Fptr)->tilenslots = 0;
         }
 
         if ((fptr->Fptr)->tableptr)
            free((fptr->Fptr)->tableptr); /* free memory for the old CHDU */
 
         (fptr->Fptr)->tableptr = 0;     /* set a null table structure pointer */
+        (fptr->Fptr)->colindexvalid = 0; /* column name index is stale */
         (fptr->Fptr)->numrows = 0;
         (fptr->Fptr)->origrows = 0;
     }
@@ -4432,8 +4615,7 @@ int ffpinit(fitsfile *fptr,      /* I - FITS file pointer */
         /* free the tile-compressed image cache, if it exists */
         if ((fptr->Fptr)->tilerow) {
 
-           ntilebins = 
-	    (((fptr->Fptr)->znaxis[0] - 1) / ((fptr->Fptr)->tilesize[0])) + 1;
+           ntilebins = (fptr->Fptr)->tilenslots;
 
            for (ii = 0; ii < ntilebins; ii++) {
              if ((fptr->Fptr)->tiledata[ii]) {
@@ -4450,6 +4632,7 @@ int ffpinit(fitsfile *fptr,      /* I - FITS file pointer */
 	    free((fptr->Fptr)->tiledatasize);
 	    free((fptr->Fptr)->tilenullarray);
 	    free((fptr->Fptr)->tiledata);
+	    free((fptr->Fptr)->tileage);
 	    free((fptr->Fptr)->tilerow);
 
 	    (fptr->Fptr)->tileanynull = 0;
@@ -4457,12 +4640,16 @@ int ffpinit(fitsfile *fptr,      /* I - FITS file pointer */
 	    (fptr->Fptr)->tiledatasize = 0;
 	    (fptr->Fptr)->tilenullarray = 0;
 	    (fptr->Fptr)->tiledata = 0;
+	    (fptr->Fptr)->tileage = 0;
 	    (fptr->Fptr)->tilerow = 0;
+	    (fptr->Fptr)->tilenslots = 0;
         }
 
         if ((fptr->Fptr)->tableptr)
            free((fptr->Fptr)->tableptr); /* free memory for the old CHDU */
 
+        (fptr->Fptr)->colindexvalid = 0; /* column name index is stale */
+
         colptr = (tcolumn *) calloc(2, sizeof(tcolumn) ) ;
 
         if (!colptr)
@@ -4544,8 +4731,7 @@ int ffainit(fitsfile *fptr,      /* I - FITS file pointer */
      /* free the tile-compressed image cache, if it exists */
      if ((fptr->Fptr)->tilerow) {
 
-           ntilebins = 
-	    (((fptr->Fptr)->znaxis[0] - 1) / ((fptr->Fptr)->tilesize[0])) + 1;
+           ntilebins = (fptr->Fptr)->tilenslots;
 
            for (ii = 0; ii < ntilebins; ii++) {
              if ((fptr->Fptr)->tiledata[ii]) {
@@ -4562,6 +4748,7 @@ int ffainit(fitsfile *fptr,      /* I - FITS file pointer */
 	    free((fptr->Fptr)->tiledatasize);
 	    free((fptr->Fptr)->tilenullarray);
 	    free((fptr->Fptr)->tiledata);
+	    free((fptr->Fptr)->tileage);
 	    free((fptr->Fptr)->tilerow);
 
 	    (fptr->Fptr)->tileanynull = 0;
@@ -4569,12 +4756,16 @@ int ffainit(fitsfile *fptr,      /* I - FITS file pointer */
 	    (fptr->Fptr)->tiledatasize = 0;
 	    (fptr->Fptr)->tilenullarray = 0;
 	    (fptr->Fptr)->tiledata = 0;
+	    (fptr->Fptr)->tileage = 0;
 	    (fptr->Fptr)->tilerow = 0;
+	    (fptr->Fptr)->tilenslots = 0;
      }
 
     if ((fptr->Fptr)->tableptr)
        free((fptr->Fptr)->tableptr); /* free memory for the old CHDU */
 
+    (fptr->Fptr)->colindexvalid = 0;   /* column name index is stale */
+
     /* mem for column structures ; space is initialized = 0 */
     if (tfield > 0)
     {
@@ -4753,8 +4944,7 @@ int ffbinit(fitsfile *fptr,     /* I - FITS file pointer */
      /* free the tile-compressed image cache, if it exists */
      if ((fptr->Fptr)->tilerow) {
 
-           ntilebins = 
-	    (((fptr->Fptr)->znaxis[0] - 1) / ((fptr->Fptr)->tilesize[0])) + 1;
+           ntilebins = (fptr->Fptr)->tilenslots;
 
            for (ii = 0; ii < ntilebins; ii++) {
              if ((fptr->Fptr)->tiledata[ii]) {
@@ -4771,6 +4961,7 @@ int ffbinit(fitsfile *fptr,     /* I - FITS file pointer */
 	    free((fptr->Fptr)->tiledatasize);
 	    free((fptr->Fptr)->tilenullarray);
 	    free((fptr->Fptr)->tiledata);
+	    free((fptr->Fptr)->tileage);
 	    free((fptr->Fptr)->tilerow);
 
 	    (fptr->Fptr)->tileanynull = 0;
@@ -4778,12 +4969,16 @@ int ffbinit(fitsfile *fptr,     /* I - FITS file pointer */
 	    (fptr->Fptr)->tiledatasize = 0;
 	    (fptr->Fptr)->tilenullarray = 0;
 	    (fptr->Fptr)->tiledata = 0;
+	    (fptr->Fptr)->tileage = 0;
 	    (fptr->Fptr)->tilerow = 0;
+	    (fptr->Fptr)->tilenslots = 0;
      }
 
     if ((fptr->Fptr)->tableptr)
        free((fptr->Fptr)->tableptr); /* free memory for the old CHDU */
 
+    (fptr->Fptr)->colindexvalid = 0;   /* column name index is stale */
+
     /* mem for column structures ; space is initialized = 0  */
     if (tfield > 0)
     {
@@ -6399,12 +6594,12 @@ int ffchdu(fitsfile *fptr,      /* I - FITS file pointer */
         {
             free((fptr->Fptr)->tableptr);
            (fptr->Fptr)->tableptr = NULL;
+           (fptr->Fptr)->colindexvalid = 0;  /* column name index is stale */
 
           /* free the tile-compressed image cache, if it exists */
           if ((fptr->Fptr)->tilerow) {
 
-           ntilebins = 
-	    (((fptr->Fptr)->znaxis[0] - 1) / ((fptr->Fptr)->tilesize[0])) + 1;
+           ntilebins = (fptr->Fptr)->tilenslots;
 
            for (ii = 0; ii < ntilebins; ii++) {
              if ((fptr->Fptr)->tiledata[ii]) {
@@ -6421,6 +6616,7 @@ int ffchdu(fitsfile *fptr,      /* I - FITS file pointer */
 	    free((fptr->Fptr)->tiledatasize);
 	    free((fptr->Fptr)->tilenullarray);
 	    free((fptr->Fptr)->tiledata);
+	    free((fptr->Fptr)->tileage);
 	    free((fptr->Fptr)->tilerow);
 
 	    (fptr->Fptr)->tileanynull = 0;
@@ -6428,7 +6624,9 @@ int ffchdu(fitsfile *fptr,      /* I - FITS file pointer */
 	    (fptr->Fptr)->tiledatasize = 0;
 	    (fptr->Fptr)->tilenullarray = 0;
 	    (fptr->Fptr)->tiledata = 0;
+	    (fptr->Fptr)->tileage = 0;
 	    (fptr->Fptr)->tilerow = 0;
+	    (fptr->Fptr)->tilenslots = 0;
           }
         }
     }
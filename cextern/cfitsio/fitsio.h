@@ -177,8 +177,8 @@ SERVICES PROVIDED HEREUNDER."
 #include "longnam.h"
 #endif
  
-#define NIOBUF  40  /* number of IO buffers to create (default = 40) */
-          /* !! Significantly increasing NIOBUF may degrade performance !! */
+#define NIOBUF  40  /* default number of IO buffers to create per file */
+          /* a larger pool may be requested with fits_set_io_buffer_size */
 
 #define IOBUFLEN 2880    /* size in bytes of each IO buffer (DONT CHANGE!) */
 
@@ -416,11 +416,26 @@ typedef struct      /* structure used to store basic FITS file information */
     void **tiledata;        /* array of uncompressed tile of data, for row *tilerow */
     void **tilenullarray;   /* array of optional array of null value flags */
     int *tileanynull;       /* anynulls in the array of tile? */
-
+    int tilenslots;         /* number of slots in the decompressed tile cache */
+    int *tileage;           /* LRU age of each cached tile */
+    int tileclock;          /* monotonic counter used to assign the ages */
+
+    void *keyindex;         /* hash index of keyword positions in the header */
+    int keyindexvalid;      /* is the keyword index up to date? */
+    int keyindexhdu;        /* HDU number to which the keyword index applies */
+    int keyindexnslots;     /* number of slots in the keyword index */
+    LONGLONG keyindexhend;  /* value of headend when the index was built */
+
+    void *colindex;         /* hash index of column names for this HDU */
+    int colindexvalid;      /* is the column name index up to date? */
+    int colindexhdu;        /* HDU number to which the column index applies */
+    int colindexnslots;     /* number of slots in the column name index */
+
+    int nbufrec;            /* number of I/O buffers allocated for the file */
     char *iobuffer;         /* pointer to FITS file I/O buffers */
-    long bufrecnum[NIOBUF]; /* file record number of each of the buffers */
-    int dirty[NIOBUF];     /* has the corresponding buffer been modified? */
-    int ageindex[NIOBUF];  /* relative age of each buffer */  
+    long *bufrecnum;        /* file record number of each of the buffers */
+    int *dirty;            /* has the corresponding buffer been modified? */
+    int *ageindex;         /* relative age of each buffer */
 } FITSfile;
 
 typedef struct         /* structure used to store basic HDU information */
@@ -731,10 +746,13 @@ int ffrwrgll( char *rowlist, LONGLONG maxrows, int maxranges, int *numranges,
       LONGLONG *minrow, LONGLONG *maxrow, int *status);
 /*----------------  FITS file I/O routines -------------*/
 int fits_init_cfitsio(void);
+int fits_set_all_threads(int nthreads);
 int ffomem(fitsfile **fptr, const char *name, int mode, void **buffptr,
            size_t *buffsize, size_t deltasize,
            void *(*mem_realloc)(void *p, size_t newsize),
            int *status);
+int ffomemro(fitsfile **fptr, const char *name, void *buffptr,
+           size_t buffsize, int *status);
 int ffopen(fitsfile **fptr, const char *filename, int iomode, int *status);
 int ffopentest(int soname, fitsfile **fptr, const char *filename, int iomode, int *status);
 
@@ -806,6 +824,7 @@ int ffmbyt(fitsfile *fptr, LONGLONG bytpos, int ignore_err, int *status);
 int ffpky(fitsfile *fptr, int datatype, const char *keyname, void *value,
           const char *comm, int *status);
 int ffprec(fitsfile *fptr, const char *card, int *status);
+int ffprecn(fitsfile *fptr, const char *cards[], int ncards, int *status);
 int ffpcom(fitsfile *fptr, const char *comm, int *status);
 int ffpunt(fitsfile *fptr, const char *keyname, const char *unit, int *status);
 int ffphis(fitsfile *fptr, const char *history, int *status);
@@ -1104,6 +1123,7 @@ int ffrdef(fitsfile *fptr, int *status);
 int ffhdef(fitsfile *fptr, int morekeys, int *status);
 int ffpthp(fitsfile *fptr, long theap, int *status);
  
+int fits_csum_set_threads(int nthreads);
 int ffcsum(fitsfile *fptr, long nrec, unsigned long *sum, int *status);
 void ffesum(unsigned long sum, int complm, char *ascii);
 unsigned long ffdsum(char *ascii, int complm, unsigned long *sum);
@@ -1834,6 +1854,7 @@ int fits_rebin_wcs( fitsfile *fptr, int naxis, float *amin,  float *binsize,
 int fits_make_hist(fitsfile *fptr, fitsfile *histptr, int bitpix,int naxis,
      long *naxes,  int *colnum,  float *amin,  float *amax, float *binsize,
      float weight, int wtcolnum, int recip, char *selectrow, int *status);
+int fits_hist_set_threads(int nthreads);
 
 typedef struct
 {
@@ -1869,6 +1890,7 @@ int ffgtcm(fitsfile *gfptr, int cmopt, int *status);
 int ffgtvf(fitsfile *gfptr, long *firstfailed, int *status);
 int ffgtop(fitsfile *mfptr,int group,fitsfile **gfptr,int *status);
 int ffgtam(fitsfile *gfptr, fitsfile *mfptr, int hdupos, int *status);
+int ffgtams(fitsfile *gfptr, int nmember, int *hdupos, int *status);
 int ffgtnm(fitsfile *gfptr, long *nmembers, int *status);
 int ffgmng(fitsfile *mfptr, long *nmembers, int *status);
 int ffgmop(fitsfile *gfptr, long member, fitsfile **mfptr, int *status);
@@ -1882,6 +1904,7 @@ int ffgmrm(fitsfile *fptr, long member, int rmopt, int *status);
 
 int	fits_execute_template(fitsfile *ff, char *ngp_template, int *status);
 
+int fits_img_stats_set_threads(int nthreads);
 int fits_img_stats_short(short *array,long nx, long ny, int nullcheck,   
     short nullvalue,long *ngoodpix, short *minvalue, short *maxvalue, double *mean,  
     double *sigma, double *noise1, double *noise2, double *noise3, double *noise5, int *status);
@@ -1907,6 +1930,10 @@ int fits_set_dither_offset(fitsfile *fptr, int offset, int *status);
 int fits_set_lossy_int(fitsfile *fptr, int lossy_int, int *status);
 int fits_set_huge_hdu(fitsfile *fptr, int huge, int *status);
 int fits_set_compression_pref(fitsfile *infptr, fitsfile *outfptr, int *status);
+int fits_set_tile_cache_size(long nbytes);
+int fits_set_tile_prefetch(int ntiles);
+long fits_set_io_buffer_size(long nbytes);
+int fits_set_positioned_io(int flag);
 
 int fits_get_compression_type(fitsfile *fptr, int *ctype, int *status);
 int fits_get_tile_dim(fitsfile *fptr, int ndim, long *dims, int *status);
@@ -1926,11 +1953,13 @@ int fits_img_decompress_header(fitsfile *infptr, fitsfile *outfptr, int *status)
 int fits_img_decompress (fitsfile *infptr, fitsfile *outfptr, int *status);
 
 /* H-compress routines */
-int fits_hcompress(int *a, int nx, int ny, int scale, char *output, 
+int fits_hcompress_set_threads(int nthreads);
+int fits_hcompress(int *a, int nx, int ny, int scale, char *output,
     long *nbytes, int *status);
 int fits_hcompress64(LONGLONG *a, int nx, int ny, int scale, char *output, 
     long *nbytes, int *status);
-int fits_hdecompress(unsigned char *input, int smooth, int *a, int *nx, 
+int fits_hdecompress_set_threads(int nthreads);
+int fits_hdecompress(unsigned char *input, int smooth, int *a, int *nx,
        int *ny, int *scale, int *status);
 int fits_hdecompress64(unsigned char *input, int smooth, LONGLONG *a, int *nx, 
        int *ny, int *scale, int *status);
@@ -1941,6 +1970,7 @@ int fits_compress_table_best(fitsfile *infptr, fitsfile *outfptr, int *status);
 int fits_compress_table_rice(fitsfile *infptr, fitsfile *outfptr, int *status);
 int fits_uncompress_table(fitsfile *infptr, fitsfile *outfptr, int *status);
 int fits_gzip_datablocks(fitsfile *fptr, size_t *size, int *status);
+int fits_gzip_set_threads(int nthreads);
 
 /*  The following exclusion if __CINT__ is defined is needed for ROOT */
 #ifndef __CINT__
@@ -361,6 +361,7 @@ int ffgbytoff(fitsfile *fptr, long gsize, long ngroups, long offset,
            void *buffer, int *status);
 int ffpbytoff(fitsfile *fptr, long gsize, long ngroups, long offset,
            void *buffer, int *status);
+int ffiobf(FITSfile *Fptr);
 int ffldrc(fitsfile *fptr, long record, int err_mode, int *status);
 int ffwhbf(fitsfile *fptr, int *nbuff);
 int ffbfeof(fitsfile *fptr, int *status);
@@ -1075,8 +1076,25 @@ int file_flush(int driverhandle);
 int file_seek(int driverhandle, LONGLONG offset);
 int file_read (int driverhandle, void *buffer, long nbytes);
 int file_write(int driverhandle, void *buffer, long nbytes);
+int file_prefetch(int driverhandle, LONGLONG offset, long nbytes);
 int file_is_compressed(char *filename);
 
+/* memory-mapped read-only disk file driver */
+
+#if defined(unix) || defined(__unix__)  || defined(__unix)
+#define HAVE_MMAP_DRIVER 1
+
+int mmap_init(void);
+int mmap_open(char *filename, int rwmode, int *driverhandle);
+int mmap_size(int driverhandle, LONGLONG *filesize);
+int mmap_close(int driverhandle);
+int mmap_seek(int driverhandle, LONGLONG offset);
+int mmap_read(int driverhandle, void *buffer, long nbytes);
+int mmap_write(int driverhandle, void *buffer, long nbytes);
+#endif
+
+int fits_prefetch_hint(fitsfile *fptr, LONGLONG offset, long nbytes);
+
 /* stream driver I/O routines */
 
 int stream_open(char *filename, int rwmode, int *driverhandle);
@@ -1099,6 +1117,7 @@ int mem_create(char *filename, int *handle);
 int mem_create_comp(char *filename, int *handle);
 int mem_openmem(void **buffptr, size_t *buffsize, size_t deltasize,
                 void *(*memrealloc)(void *p, size_t newsize), int *handle);
+int mem_borrowmem(void *buffptr, size_t buffsize, int *handle);
 int mem_createmem(size_t memsize, int *handle);
 int stdin_checkfile(char *urltype, char *infile, char *outfile);
 int stdin_open(char *filename, int rwmode, int *handle);
@@ -1146,6 +1165,16 @@ int http_open(char *filename, int rwmode, int *driverhandle);
 int http_file_open(char *filename, int rwmode, int *driverhandle);
 int http_compress_open(char *filename, int rwmode, int *driverhandle);
 
+/* http range-request driver I/O routines */
+
+int http_range_init(void);
+int http_range_open(char *filename, int rwmode, int *driverhandle);
+int http_range_size(int driverhandle, LONGLONG *filesize);
+int http_range_close(int driverhandle);
+int http_range_seek(int driverhandle, LONGLONG offset);
+int http_range_read(int driverhandle, void *buffer, long nbytes);
+int http_range_write(int driverhandle, void *buffer, long nbytes);
+
 /* ftp driver I/O routines */
 
 int ftp_checkfile(char *urltype, char *infile, char *outfile);
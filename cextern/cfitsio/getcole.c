@@ -1085,7 +1085,8 @@ int fffi2r4(short *input,         /* I - array of values to be converted     */
   pixels are null, otherwise anynull will be returned with a value = 0;
 */
 {
-    long ii;
+    long ii, nnull = 0;
+    int isnull;
 
     if (nullcheck == 0)     /* no null checking required */
     {
@@ -1104,37 +1105,61 @@ int fffi2r4(short *input,         /* I - array of values to be converted     */
     }
     else        /* must check for null values */
     {
-        if (scale == 1. && zero == 0.)  /* no scaling */
-        {       
-            for (ii = 0; ii < ntodo; ii++)
+        /* The null tests are done in branchless form (the test result  */
+        /* selects one of the 2 output values) so that compilers can    */
+        /* vectorize the loops; anynull is updated after each loop ends */
+
+        if (nullcheck == 1)   /* substitute nullval for the null pixels */
+        {
+            if (scale == 1. && zero == 0.)  /* no scaling */
+            {       
+                for (ii = 0; ii < ntodo; ii++)
+                {
+                    isnull = (input[ii] == tnull);
+                    nnull += isnull;
+                    output[ii] = isnull ? nullval : (float) input[ii];
+                }
+            }
+            else                  /* must scale the data */
             {
-                if (input[ii] == tnull)
+                for (ii = 0; ii < ntodo; ii++)
                 {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
-                    else
-                        nullarray[ii] = 1;
+                    isnull = (input[ii] == tnull);
+                    nnull += isnull;
+                    output[ii] = isnull ? nullval :
+                                 (float) (input[ii] * scale + zero);
                 }
-                else
-                    output[ii] = (float) input[ii];
             }
+
+            if (nnull)
+                *anynull = 1;
         }
-        else                  /* must scale the data */
+        else                  /* set the nullarray flags for null pixels */
         {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
+            if (scale == 1. && zero == 0.)  /* no scaling */
+            {       
+                for (ii = 0; ii < ntodo; ii++)
                 {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
-                    else
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
                         nullarray[ii] = 1;
+                    }
+                    else
+                        output[ii] = (float) input[ii];
                 }
-                else
+            }
+            else                  /* must scale the data */
+            {
+                for (ii = 0; ii < ntodo; ii++)
                 {
-                    output[ii] = (float) (input[ii] * scale + zero);
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        nullarray[ii] = 1;
+                    }
+                    else
+                        output[ii] = (float) (input[ii] * scale + zero);
                 }
             }
         }
@@ -1169,7 +1194,8 @@ int fffi4r4(INT32BIT *input,      /* I - array of values to be converted     */
   pixels are null, otherwise anynull will be returned with a value = 0;
 */
 {
-    long ii;
+    long ii, nnull = 0;
+    int isnull;
 
     if (nullcheck == 0)     /* no null checking required */
     {
@@ -1188,37 +1214,61 @@ int fffi4r4(INT32BIT *input,      /* I - array of values to be converted     */
     }
     else        /* must check for null values */
     {
-        if (scale == 1. && zero == 0.)  /* no scaling */
-        {       
-            for (ii = 0; ii < ntodo; ii++)
+        /* The null tests are done in branchless form (the test result  */
+        /* selects one of the 2 output values) so that compilers can    */
+        /* vectorize the loops; anynull is updated after each loop ends */
+
+        if (nullcheck == 1)   /* substitute nullval for the null pixels */
+        {
+            if (scale == 1. && zero == 0.)  /* no scaling */
+            {       
+                for (ii = 0; ii < ntodo; ii++)
+                {
+                    isnull = (input[ii] == tnull);
+                    nnull += isnull;
+                    output[ii] = isnull ? nullval : (float) input[ii];
+                }
+            }
+            else                  /* must scale the data */
             {
-                if (input[ii] == tnull)
+                for (ii = 0; ii < ntodo; ii++)
                 {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
-                    else
-                        nullarray[ii] = 1;
+                    isnull = (input[ii] == tnull);
+                    nnull += isnull;
+                    output[ii] = isnull ? nullval :
+                                 (float) (input[ii] * scale + zero);
                 }
-                else
-                    output[ii] = (float) input[ii];
             }
+
+            if (nnull)
+                *anynull = 1;
         }
-        else                  /* must scale the data */
+        else                  /* set the nullarray flags for null pixels */
         {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
+            if (scale == 1. && zero == 0.)  /* no scaling */
+            {       
+                for (ii = 0; ii < ntodo; ii++)
                 {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
-                    else
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
                         nullarray[ii] = 1;
+                    }
+                    else
+                        output[ii] = (float) input[ii];
                 }
-                else
+            }
+            else                  /* must scale the data */
+            {
+                for (ii = 0; ii < ntodo; ii++)
                 {
-                    output[ii] = (float) (input[ii] * scale + zero);
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        nullarray[ii] = 1;
+                    }
+                    else
+                        output[ii] = (float) (input[ii] * scale + zero);
                 }
             }
         }
@@ -1034,7 +1034,8 @@ int fffi2i2(short *input,         /* I - array of values to be converted     */
   pixels are null, otherwise anynull will be returned with a value = 0;
 */
 {
-    long ii;
+    long ii, nnull = 0;
+    int isnull;
     double dvalue;
 
     if (nullcheck == 0)     /* no null checking required */
@@ -1068,18 +1069,34 @@ int fffi2i2(short *input,         /* I - array of values to be converted     */
     {
         if (scale == 1. && zero == 0.)  /* no scaling */
         {       
-            for (ii = 0; ii < ntodo; ii++)
+            /* The null test is done in branchless form (the test result */
+            /* selects one of the 2 output values) so that compilers can */
+            /* vectorize the loop; anynull is updated after the loop     */
+
+            if (nullcheck == 1)   /* substitute nullval for null pixels */
             {
-                if (input[ii] == tnull)
+                for (ii = 0; ii < ntodo; ii++)
                 {
+                    isnull = (input[ii] == tnull);
+                    nnull += isnull;
+                    output[ii] = isnull ? nullval : input[ii];
+                }
+
+                if (nnull)
                     *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
-                    else
+            }
+            else                  /* set the nullarray flags instead */
+            {
+                for (ii = 0; ii < ntodo; ii++)
+                {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
                         nullarray[ii] = 1;
+                    }
+                    else
+                        output[ii] = input[ii];
                 }
-                else
-                    output[ii] = input[ii];
             }
         }
         else                  /* must scale the data */
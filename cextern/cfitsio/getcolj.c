@@ -1147,7 +1147,8 @@ int fffi4i4(INT32BIT *input,      /* I - array of values to be converted     */
   is being done in place in the same array.
 */
 {
-    long ii;
+    long ii, nnull = 0;
+    int isnull;
     double dvalue;
 
     if (nullcheck == 0)     /* no null checking required */
@@ -1182,19 +1183,34 @@ int fffi4i4(INT32BIT *input,      /* I - array of values to be converted     */
     {
         if (scale == 1. && zero == 0.)  /* no scaling */
         {       
-            for (ii = ntodo - 1; ii >= 0; ii--)
+            /* The null test is done in branchless form (the test result */
+            /* selects one of the 2 output values) so that compilers can */
+            /* vectorize the loop; anynull is updated after the loop     */
+
+            if (nullcheck == 1)   /* substitute nullval for null pixels */
             {
-                if (input[ii] == tnull)
+                for (ii = ntodo - 1; ii >= 0; ii--)
                 {
+                    isnull = (input[ii] == tnull);
+                    nnull += isnull;
+                    output[ii] = isnull ? nullval : input[ii];
+                }
+
+                if (nnull)
                     *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
-                    else
+            }
+            else                  /* set the nullarray flags instead */
+            {
+                for (ii = ntodo - 1; ii >= 0; ii--)
+                {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
                         nullarray[ii] = 1;
+                    }
+                    else
+                        output[ii] = input[ii];
                 }
-                else
-                    output[ii] = input[ii];
-
             }
         }
         else                  /* must scale the data */
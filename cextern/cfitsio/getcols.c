@@ -649,7 +649,7 @@ int ffgcls2 ( fitsfile *fptr,   /* I - FITS file pointer                       *
     tcolumn *colptr;
 
     double cbuff[DBUFFSIZE / sizeof(double)]; /* align cbuff on word boundary */
-    char *buffer, *arrayptr;
+    char *buffer;
 
     if (*status > 0 || nelem == 0)  /* inherit input status value if > 0 */
         return(*status);
@@ -758,33 +758,21 @@ int ffgcls2 ( fitsfile *fptr,   /* I - FITS file pointer                       *
       else
          ffgbytoff(fptr, twidth, ntodo, incre - twidth, cbuff, status);
 
-      /* copy from the buffer into the user's array of strings */
-      /* work backwards from last char of last string to 1st char of 1st */
+      /* copy from the buffer into the user's array of strings; each
+         fixed-width string is copied as a block with memcpy after finding
+         the trimmed length, instead of copying one character at a time */
 
-      buffer = ((char *) cbuff) + (ntodo * twidth) - 1;
+      buffer = (char *) cbuff;
 
-      for (ii = (long) (next + ntodo - 1); ii >= next; ii--)
+      for (ii = (long) next; ii < next + ntodo; ii++, buffer += twidth)
       {
-         arrayptr = array[ii] + twidth - 1;
-
-         for (jj = twidth - 1; jj > 0; jj--)  /* ignore trailing blanks */
-         {
-            if (*buffer == ' ')
-            {
-              buffer--;
-              arrayptr--;
-            }
-            else
-              break;
-         }
-         *(arrayptr + 1) = 0;  /* write the string terminator */
-         
-         for (; jj >= 0; jj--)    /* copy the string itself */
+         for (jj = twidth; jj > 1; jj--)  /* ignore trailing blanks */
          {
-           *arrayptr = *buffer;
-           buffer--;
-           arrayptr--;
+            if (buffer[jj - 1] != ' ')
+               break;
          }
+         memcpy(array[ii], buffer, jj);  /* copy the string itself */
+         array[ii][jj] = 0;  /* write the string terminator */
 
          /* check if null value is defined, and if the   */
          /* column string is identical to the null string */
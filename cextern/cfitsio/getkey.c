@@ -457,6 +457,178 @@ int ffgrec( fitsfile *fptr,     /* I - FITS file pointer          */
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
+typedef struct   /* one slot of the per-HDU keyword position index */
+{
+    char name[9];   /* uppercased keyword name, null terminated */
+    int recnum;     /* record number of the keyword; 0 = empty slot */
+    int dup;        /* does the name occur more than once in the header? */
+} keyindexslot;
+
+static int ffkihs(const char *name, int nslots)
+/*
+  hash a keyword name into a slot number (FNV-1a hash)
+*/
+{
+    unsigned int hash = 2166136261U;
+
+    while (*name)
+    {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619U;
+    }
+    return ((int) (hash % (unsigned int) nslots));
+}
+/*--------------------------------------------------------------------------*/
+static int ffkibl(fitsfile *fptr,  /* I - FITS file pointer */
+           int *status)            /* IO - error status     */
+/*
+  build the keyword position index for the current header by reading
+  every card once.  Each card's name (as returned by ffgknm, so ESO
+  HIERARCH names are treated the same way as in the sequential search)
+  is entered into an open-addressing hash table along with its record
+  number; names longer than 8 characters cannot match an indexed
+  lookup and are skipped.  The current header position is preserved.
+*/
+{
+    int nkeys, nextkey, nslots, slot, ii, cardlen;
+    char card[FLEN_CARD], cardname[FLEN_KEYWORD];
+    keyindexslot *index;
+    FITSfile *Fptr = fptr->Fptr;
+
+    /* don't build an index while the header is still being scanned */
+    /* (ffpinit and ffbinit temporarily set headend to the file size  */
+    /* before the position of the END card is known)                  */
+    if (Fptr->headend >= Fptr->logfilesize)
+        return(*status);
+
+    if (ffghps(fptr, &nkeys, &nextkey, status) > 0)
+        return(*status);
+
+    nslots = 2 * nkeys + 7;   /* keep the table at most half full */
+
+    if (Fptr->keyindex && Fptr->keyindexnslots < nslots)
+    {
+        free(Fptr->keyindex);   /* existing table is too small */
+        Fptr->keyindex = 0;
+    }
+
+    if (!Fptr->keyindex)
+    {
+        Fptr->keyindex = malloc(nslots * sizeof(keyindexslot));
+        if (!Fptr->keyindex)
+            return(*status);    /* no index; searches remain sequential */
+        Fptr->keyindexnslots = nslots;
+    }
+    else
+        nslots = Fptr->keyindexnslots;  /* reuse the larger existing table */
+
+    index = (keyindexslot *) Fptr->keyindex;
+    memset(index, 0, nslots * sizeof(keyindexslot));
+
+    ffmaky(fptr, 1, status);   /* move to top of the header */
+
+    for (ii = 1; ii <= nkeys && *status <= 0; ii++)
+    {
+        ffgnky(fptr, card, status);             /* get next keyword */
+        ffgknm(card, cardname, &cardlen, status); /* get the keyword name */
+
+        if (cardlen < 1 || cardlen > 8)
+            continue;   /* blank and long names are not indexed */
+
+        for (slot = 0; slot < cardlen; slot++)
+        {
+            if (cardname[slot] > 96)
+               cardname[slot] = toupper(cardname[slot]); /* make upper case */
+        }
+
+        slot = ffkihs(cardname, nslots);
+        while (index[slot].recnum &&
+               FSTRNCMP(index[slot].name, cardname, 9))
+            slot = (slot + 1) % nslots;   /* linear probing */
+
+        if (index[slot].recnum)
+            index[slot].dup = 1;  /* name occurs more than once */
+        else
+        {
+            strcpy(index[slot].name, cardname);
+            index[slot].recnum = ii;
+        }
+    }
+
+    ffmaky(fptr, nextkey, status);  /* restore the header position */
+
+    if (*status <= 0)
+    {
+        Fptr->keyindexvalid = 1;
+        Fptr->keyindexhdu = Fptr->curhdu;
+        Fptr->keyindexhend = Fptr->headend;
+    }
+    return(*status);
+}
+/*--------------------------------------------------------------------------*/
+static int ffkilu(fitsfile *fptr,  /* I - FITS file pointer          */
+           char *keyname,          /* I - uppercased name, <= 8 chars */
+           int *recnum,            /* O - record number of the keyword;  */
+                                   /*     0 = keyword is not in the header, */
+                                   /*     -1 = index cannot answer, do a    */
+                                   /*     sequential search instead         */
+           int *status)            /* IO - error status              */
+/*
+  look up a keyword in the per-HDU position index, building or
+  rebuilding the index first if the header has been modified since it
+  was last built.  Names that occur more than once in the header are
+  reported as unanswerable, because the sequential search returns the
+  next match relative to the current header position, not the first.
+*/
+{
+    keyindexslot *index;
+    int slot;
+    FITSfile *Fptr = fptr->Fptr;
+
+    *recnum = -1;
+
+    if (*status > 0)
+        return(*status);
+
+    /* reset position to the correct HDU if necessary, so that the */
+    /* index validity test below compares against this handle's HDU */
+    /* (several fitsfile handles may share the same FITSfile)       */
+    if (fptr->HDUposition != (fptr->Fptr)->curhdu)
+    {
+        if (ffmahd(fptr, (fptr->HDUposition) + 1, NULL, status) > 0)
+            return(*status);
+    }
+
+    if (!Fptr->keyindexvalid || Fptr->keyindexhdu != Fptr->curhdu ||
+         Fptr->keyindexhend != Fptr->headend)
+    {
+        Fptr->keyindexvalid = 0;
+        if (ffkibl(fptr, status) > 0)
+            return(*status);
+    }
+
+    if (!Fptr->keyindex || !Fptr->keyindexvalid)
+        return(*status);    /* could not build an index */
+
+    index = (keyindexslot *) Fptr->keyindex;
+    slot = ffkihs(keyname, Fptr->keyindexnslots);
+
+    while (index[slot].recnum)
+    {
+        if (!FSTRNCMP(index[slot].name, keyname, 9))
+        {
+            if (!index[slot].dup)
+                *recnum = index[slot].recnum;   /* unique occurrence */
+
+            return(*status);  /* duplicates leave *recnum = -1 */
+        }
+        slot = (slot + 1) % Fptr->keyindexnslots;
+    }
+
+    *recnum = 0;   /* keyword is not present in the header */
+    return(*status);
+}
+/*--------------------------------------------------------------------------*/
 int ffgcrd( fitsfile *fptr,     /* I - FITS file pointer        */
             const char *name,         /* I - name of keyword to read  */
             char *card,         /* O - keyword card             */
@@ -474,7 +646,7 @@ int ffgcrd( fitsfile *fptr,     /* I - FITS file pointer        */
 */
 {
     int nkeys, nextkey, ntodo, namelen, namelen_limit, namelenminus1, cardlen;
-    int ii = 0, jj, kk, wild, match, exact, hier = 0;
+    int ii = 0, jj, kk, wild, match, exact, hier = 0, nrec;
     char keyname[FLEN_KEYWORD], cardname[FLEN_KEYWORD];
     char *ptr1, *ptr2, *gotstar;
 
@@ -548,6 +720,23 @@ int ffgcrd( fitsfile *fptr,     /* I - FITS file pointer        */
     else
         wild = 0;
 
+    if (!wild && !hier && namelen > 0 && namelen <= 8)
+    {
+        /* simple names are found through the keyword position index; */
+        /* a full search of the header gives the same single answer   */
+        ffkilu(fptr, keyname, &nrec, status);
+
+        if (*status > 0)
+            return(*status);
+
+        if (nrec > 0)
+            return( ffgrec(fptr, nrec, card, status) );
+        else if (nrec == 0)
+            return(*status = KEY_NO_EXIST);  /* keyword is not in header */
+
+        /* nrec = -1: fall through to the sequential search */
+    }
+
     ffghps(fptr, &nkeys, &nextkey, status); /* get no. keywords and position */
 
     namelenminus1 = maxvalue(namelen - 1, 1);
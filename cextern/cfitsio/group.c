@@ -1933,6 +1933,319 @@ int ffgtam(fitsfile *gfptr,   /* FITS file pointer to grouping table HDU     */
   return(*status);
 }
 
+/*---------------------------------------------------------------------------*/
+int ffgtams(fitsfile *gfptr,   /* FITS file pointer to grouping table HDU    */
+	    int       nmember, /* number of member HDUs to add               */
+	    int      *hdupos,  /* list of member HDU positions; the members
+				  must all reside in the same FITS file as
+				  the grouping table                         */
+	    int      *status)  /* return status code                        */
+
+/*
+  add a list of member HDUs to an existing grouping table in a single
+  batch. The member HDUs are identified by their HDU position within the
+  same FITS file as the grouping table (see the hdupos parameter of
+  ffgtam). The grouping table file is reopened only once, the grouping
+  table structure is examined only once, all the new rows are inserted
+  with a single operation, and the member description columns are written
+  in blocks, so attaching many members is far cheaper than calling ffgtam
+  once per member. Member HDUs residing in other FITS files must still be
+  attached individually with ffgtam.
+
+  Member HDUs that are already present in the grouping table (or that are
+  duplicated within the hdupos list) are skipped, and a status value of
+  HDU_ALREADY_MEMBER is returned after all the remaining members have
+  been processed.
+*/
+
+{
+  int xtensionCol,extnameCol,extverCol,positionCol,locationCol,uriCol;
+  int grptype  = 0;
+  int hdutype  = 0;
+  int iomode;
+  int found;
+  int i,j,nnew;
+
+  long groupExtver = 0;
+  long nmembers    = 0;
+  long ngroups     = 0;
+  long grpid       = 0;
+  long memberID    = 0;
+
+  char (*mbrHDUtype)[FLEN_VALUE] = NULL;
+  char (*mbrExtname)[FLEN_VALUE] = NULL;
+  long *mbrExtver  = NULL;
+  int  *mbrPosition = NULL;
+  char **tmpStrArr = NULL;
+
+  char *keys[] = {"GRPNAME","EXTVER","EXTNAME","TFIELDS","GCOUNT","EXTEND"};
+  char *tmpPtr[1];
+  char keyword[FLEN_KEYWORD];
+  char card[FLEN_CARD];
+  int  nkeys = 6;
+
+  unsigned char charNull[]  = {'\0'};
+
+  fitsfile *tmpfptr = NULL;
+
+  int parentStatus = 0;
+
+  if(*status != 0) return(*status);
+
+  do
+    {
+      /*
+	make sure the grouping table can be modified before proceeding
+      */
+
+      fits_file_mode(gfptr,&iomode,status);
+
+      if(iomode != READWRITE)
+	{
+	  ffpmsg("cannot modify grouping table (ffgtams)");
+	  *status = BAD_GROUP_ATTACH;
+	  continue;
+	}
+
+      if(nmember <= 0) continue;
+
+      /* reopen the grouping table's file once for all the members */
+
+      *status = fits_reopen_file(gfptr,&tmpfptr,status);
+
+      if(*status != 0) continue;
+
+      /* retrieve the grouping table's EXTVER value; since the members all
+	 reside in the same file as the grouping table the value remains
+	 positive for the subsequent GRPIDn matching */
+
+      *status = fits_read_key_lng(gfptr,"EXTVER",&groupExtver,card,status);
+
+      /* retrieve the grouping table column IDs and structure type once */
+
+      *status = ffgtgc(gfptr,&xtensionCol,&extnameCol,&extverCol,&positionCol,
+		       &locationCol,&uriCol,&grptype,status);
+
+      /* retrieve the number of group members */
+
+      *status = fits_get_num_members(gfptr,&nmembers,status);
+
+      if(*status != 0) continue;
+
+      /* allocate the description arrays for the new members */
+
+      mbrHDUtype  = malloc(nmember * sizeof(*mbrHDUtype));
+      mbrExtname  = malloc(nmember * sizeof(*mbrExtname));
+      mbrExtver   = malloc(nmember * sizeof(long));
+      mbrPosition = malloc(nmember * sizeof(int));
+      tmpStrArr   = malloc(nmember * sizeof(char *));
+
+      if(!mbrHDUtype || !mbrExtname || !mbrExtver || !mbrPosition ||
+	 !tmpStrArr)
+	{
+	  ffpmsg("memory allocation failed (ffgtams)");
+	  *status = MEMORY_ALLOCATION;
+	  continue;
+	}
+
+      /*
+	 gather the description of each member HDU, dropping any that are
+	 already present in the grouping table or duplicated in the list
+      */
+
+      for(i = 0, nnew = 0; i < nmember && *status == 0; ++i)
+	{
+	  *status = fits_movabs_hdu(tmpfptr,hdupos[i],&hdutype,status);
+
+	  if(*status != 0) continue;
+
+	  *status = fits_read_key_str(tmpfptr,"XTENSION",mbrHDUtype[nnew],
+				      card,status);
+
+	  if(*status == KEY_NO_EXIST)
+	    {
+	      strcpy(mbrHDUtype[nnew],"PRIMARY");
+	      *status = 0;
+	    }
+	  prepare_keyvalue(mbrHDUtype[nnew]);
+
+	  *status = fits_read_key_lng(tmpfptr,"EXTVER",mbrExtver+nnew,card,
+				      status);
+
+	  if(*status == KEY_NO_EXIST)
+	    {
+	      mbrExtver[nnew] = 1;
+	      *status         = 0;
+	    }
+
+	  *status = fits_read_key_str(tmpfptr,"EXTNAME",mbrExtname[nnew],
+				      card,status);
+
+	  if(*status == KEY_NO_EXIST)
+	    {
+	      mbrExtname[nnew][0] = 0;
+	      *status            = 0;
+	    }
+	  prepare_keyvalue(mbrExtname[nnew]);
+
+	  fits_get_hdu_num(tmpfptr,mbrPosition+nnew);
+
+	  /* is this HDU duplicated within the input list? */
+
+	  for(j = 0, found = 0; j < nnew && !found; ++j)
+	    if(mbrPosition[j] == mbrPosition[nnew]) found = 1;
+
+	  /* is this HDU already an entry in the grouping table? */
+
+	  if(!found)
+	    {
+	      *status = ffgmf(gfptr,mbrHDUtype[nnew],mbrExtname[nnew],
+			      mbrExtver[nnew],mbrPosition[nnew],NULL,
+			      &memberID,status);
+
+	      if(*status == MEMBER_NOT_FOUND) *status = 0;
+	      else if(*status == 0) found = 1;
+	    }
+
+	  if(found)
+	    {
+	      parentStatus = HDU_ALREADY_MEMBER;
+    ffpmsg("Specified HDU is already a member of the Grouping table (ffgtams)");
+	      continue;
+	    }
+
+	  ++nnew;
+	}
+
+      if(*status != 0 || nnew == 0) continue;
+
+      /* append all the new rows to the grouping table in one operation */
+
+      *status = fits_insert_rows(gfptr,nmembers,nnew,status);
+
+      if(*status != 0) continue;
+
+      /* write the member descriptions in column-sized blocks */
+
+      if(xtensionCol != 0)
+	{
+	  for(i = 0; i < nnew; ++i) tmpStrArr[i] = mbrHDUtype[i];
+	  fits_write_col_str(gfptr,xtensionCol,nmembers+1,1,nnew,tmpStrArr,
+			     status);
+	}
+
+      if(extnameCol  != 0)
+	{
+	  for(i = 0; i < nnew; ++i)
+	    {
+	      *tmpPtr = mbrExtname[i];
+
+	      if(strlen(mbrExtname[i]) != 0)
+		fits_write_col_str(gfptr,extnameCol,nmembers+1+i,1,1,tmpPtr,
+				   status);
+	      else
+		fits_write_col_byt(gfptr,extnameCol,nmembers+1+i,1,1,charNull,
+				   status);
+	    }
+	}
+
+      if(extverCol   != 0)
+	fits_write_col_lng(gfptr,extverCol,nmembers+1,1,nnew,mbrExtver,
+			   status);
+
+      if(positionCol != 0)
+	fits_write_col_int(gfptr,positionCol,nmembers+1,1,nnew,mbrPosition,
+			   status);
+
+      /* the members reside in the same file as the grouping table, so the
+	 location and URI columns are always null */
+
+      if(locationCol != 0)
+	for(i = 0; i < nnew; ++i)
+	  fits_write_col_byt(gfptr,locationCol,nmembers+1+i,1,1,charNull,
+			     status);
+
+      if(uriCol      != 0)
+	for(i = 0; i < nnew; ++i)
+	  fits_write_col_byt(gfptr,uriCol,nmembers+1+i,1,1,charNull,status);
+
+      if(*status != 0) continue;
+
+      /*
+	 add a GRPIDn keyword to each member HDU header to link it to the
+	 grouping table, if one does not already exist; no GRPLCn keyword
+	 is needed since the members reside in the grouping table's file
+      */
+
+      for(j = 0; j < nnew && *status == 0; ++j)
+	{
+	  *status = fits_movabs_hdu(tmpfptr,mbrPosition[j],&hdutype,status);
+
+	  *status = fits_get_num_groups(tmpfptr,&ngroups,status);
+
+	  for(i = 1, found = 0; i <= ngroups && !found && *status == 0; ++i)
+	    {
+	      sprintf(keyword,"GRPID%d",i);
+	      *status = fits_read_key_lng(tmpfptr,keyword,&grpid,card,status);
+
+	      if(grpid == groupExtver) found = 1;
+	    }
+
+	  if(found) continue;
+
+	  if(ngroups == 0)
+	    {
+	      /*
+		 no GRPIDn/GRPLCn keywords currently exist in header so try
+		 to position the header pointer to a desirable position
+	      */
+
+	      for(i = 0, *status = KEY_NO_EXIST, nkeys = 6;
+		                   i < nkeys && *status == KEY_NO_EXIST; ++i)
+		{
+		  *status = 0;
+		  *status = fits_read_card(tmpfptr,keys[i],card,status);
+		}
+
+	      /* all else fails: move write pointer to end of header */
+
+	      if(*status == KEY_NO_EXIST)
+		{
+		  *status = 0;
+		  fits_get_hdrspace(tmpfptr,&nkeys,&i,status);
+		  ffgrec(tmpfptr,nkeys,card,status);
+		}
+
+	      /* any other error status then abort */
+
+	      if(*status != 0) continue;
+	    }
+
+	  sprintf(keyword,"GRPID%d",(int)ngroups+1);
+	  fits_insert_key_lng(tmpfptr,keyword,groupExtver,
+			      "EXTVER of Group containing this HDU",status);
+	}
+
+    }while(0);
+
+  /* clean up */
+
+  if(tmpStrArr   != NULL) free(tmpStrArr);
+  if(mbrPosition != NULL) free(mbrPosition);
+  if(mbrExtver   != NULL) free(mbrExtver);
+  if(mbrExtname  != NULL) free(mbrExtname);
+  if(mbrHDUtype  != NULL) free(mbrHDUtype);
+
+  if(tmpfptr != NULL)
+    {
+      *status = fits_close_file(tmpfptr,status);
+    }
+
+  *status = 0 == *status ? parentStatus : *status;
+
+  return(*status);
+}
+
 /*---------------------------------------------------------------------------*/
 int ffgtnm(fitsfile *gfptr,    /* FITS file pointer to grouping table        */
 	   long     *nmembers, /* member count  of the groping table         */
@@ -27,6 +27,271 @@ typedef struct {  /*  Structure holding all the histogramming information   */
 
 } histType;
 
+/*  Multi-threaded histogram binning:  each worker thread accumulates a
+    private copy of the count array over its share of each chunk of event
+    rows, and the private arrays are folded into the output image after
+    the last chunk.  Threading is off by default (1 thread) and enabled
+    with fits_hist_set_threads; note that merging per-thread partial sums
+    can change the last-bit rounding of float and double histograms.  */
+
+#if !defined(_WIN32)
+#define HAVE_HISTO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define HISTO_MAX_THREADS 16
+#define HISTO_THREAD_MIN_ROWS 500000L
+
+static int histo_nthreads = 1;
+
+typedef struct {       /* one thread's share of a chunk of event rows  */
+    histType hd;       /* histogramming parameters; hd.hist addresses  */
+                       /* this thread's private count array            */
+    float *col1, *col2, *col3, *col4;  /* iterator column arrays       */
+    float *wtcol;                      /* weighting column, if any     */
+    char  *rowsel;     /* row selection flags for this chunk, or NULL  */
+    long  lo, hi;      /* inclusive range of rows to bin               */
+} histslice;
+
+static void ffhistbinslice(histslice *slice);
+
+int fits_hist_set_threads(int nthreads)
+/*
+   Set the number of threads used to accumulate the histogram counts in
+   subsequent fits_make_hist / ffhist calls: 1 disables threading and 0
+   means one thread per processor.  Returns the effective setting.
+*/
+{
+#ifdef HAVE_HISTO_THREADS
+    if (nthreads < 0) nthreads = 1;
+    if (nthreads == 0) {
+        long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (nproc > 0) ? (int) nproc : 1;
+    }
+    if (nthreads > HISTO_MAX_THREADS) nthreads = HISTO_MAX_THREADS;
+    histo_nthreads = nthreads;
+#else
+    histo_nthreads = 1;
+#endif
+    return(histo_nthreads);
+}
+
+#ifdef HAVE_HISTO_THREADS
+static void *ffhistbinrun(void *arg)
+{
+    ffhistbinslice( (histslice *) arg );
+    return(NULL);
+}
+#endif
+
+static void ffhistbinslice(histslice *slice)
+/*
+   Accumulate rows lo..hi of one chunk into the count array addressed by
+   slice->hd.hist.  For 1-D and 2-D histograms the bin index and weight
+   of every row are first computed into scratch arrays in a branchless
+   pass, and the counts are then accumulated in one tight loop per image
+   type; rejected rows get bin index 0 (the unused null pixel) and
+   weight 0, so no per-row branching is needed.  Higher dimensions, and
+   the case where the scratch arrays cannot be allocated, fall back to a
+   row-at-a-time loop identical to the original one.
+*/
+{
+    histType *hd = &slice->hd;
+    float *col1 = slice->col1, *col2 = slice->col2;
+    float *col3 = slice->col3, *col4 = slice->col4;
+    float *wtcol = slice->wtcol;
+    char  *rowsel = slice->rowsel;
+    long  incr2 = 0, incr3 = 0, incr4 = 0;
+    long  ii, kk, nn, ipix, iaxisbin;
+    float pix, axisbin;
+    long   *ipixbuf = NULL;
+    double *wtbuf = NULL;
+
+    nn = slice->hi - slice->lo + 1;
+    if (nn < 1)
+        return;
+
+    if (hd->haxis > 1)  incr2 = hd->haxis1;
+    if (hd->haxis > 2)  incr3 = incr2 * hd->haxis2;
+    if (hd->haxis > 3)  incr4 = incr3 * hd->haxis3;
+
+    if (hd->haxis <= 2)
+    {
+        ipixbuf = (long *)   malloc(nn * sizeof(long));
+        wtbuf   = (double *) malloc(nn * sizeof(double));
+    }
+
+    if (ipixbuf && wtbuf)
+    {
+      /* linear-binning fast path: compute all the bin indexes first */
+      for (kk = 0; kk < nn; kk++)
+      {
+        int ok;
+
+        ii = slice->lo + kk;
+        ok = rowsel ? (rowsel[ii - 1] != 0) : 1;
+        ok &= (col1[ii] != FLOATNULLVALUE);
+
+        pix = (col1[ii] - hd->amin1) / hd->binsize1;
+        ipix = (long) (pix + 1.); /* add 1 because the 1st pixel is the null value */
+
+        ok &= (ipix >= 1 && ipix <= hd->haxis1 && pix <= hd->maxbin1);
+
+        if (hd->haxis > 1)
+        {
+            ok &= (col2[ii] != FLOATNULLVALUE);
+
+            axisbin = (col2[ii] - hd->amin2) / hd->binsize2;
+            iaxisbin = (long) axisbin;
+
+            ok &= (axisbin >= 0. && iaxisbin < hd->haxis2
+                                 && axisbin <= hd->maxbin2);
+            ipix += iaxisbin * incr2;
+        }
+
+        ipixbuf[kk] = ok ? ipix : 0;
+        if (hd->weight != FLOATNULLVALUE)  /* constant weight factor */
+            wtbuf[kk] = ok ? hd->weight : 0.;
+        else if (hd->wtrecip)              /* reciprocal of the weight */
+            wtbuf[kk] = ok ? 1. / wtcol[ii] : 0.;
+        else                               /* weights given in a column */
+            wtbuf[kk] = ok ? wtcol[ii] : 0.;
+      }
+
+      /* then accumulate the counts in one tight loop per image type */
+      switch (hd->himagetype) {
+      case TINT:
+        for (kk = 0; kk < nn; kk++)
+            hd->hist.j[ipixbuf[kk]] += (int) wtbuf[kk];
+        break;
+      case TSHORT:
+        for (kk = 0; kk < nn; kk++)
+            hd->hist.i[ipixbuf[kk]] += (short) wtbuf[kk];
+        break;
+      case TFLOAT:
+        for (kk = 0; kk < nn; kk++)
+            hd->hist.r[ipixbuf[kk]] += (float) wtbuf[kk];
+        break;
+      case TDOUBLE:
+        for (kk = 0; kk < nn; kk++)
+            hd->hist.d[ipixbuf[kk]] += wtbuf[kk];
+        break;
+      case TBYTE:
+        for (kk = 0; kk < nn; kk++)
+            hd->hist.b[ipixbuf[kk]] += (char) wtbuf[kk];
+        break;
+      }
+
+      free(wtbuf);
+      free(ipixbuf);
+      return;
+    }
+
+    if (ipixbuf) free(ipixbuf);
+    if (wtbuf)   free(wtbuf);
+
+    /*  General row-at-a-time loop (3-D and 4-D histograms)  */
+    for (ii = slice->lo; ii <= slice->hi; ii++)
+    {
+        if (rowsel && !rowsel[ii - 1]) /* row excluded from the histogram */
+            continue;
+
+        if (col1[ii] == FLOATNULLVALUE)  /* test for null value */
+            continue;
+
+        pix = (col1[ii] - hd->amin1) / hd->binsize1;
+        ipix = (long) (pix + 1.); /* add 1 because the 1st pixel is the null value */
+
+	/* test if bin is within range */
+        if (ipix < 1 || ipix > hd->haxis1 || pix > hd->maxbin1)
+            continue;
+
+        if (hd->haxis > 1)
+        {
+          if (col2[ii] == FLOATNULLVALUE)
+              continue;
+
+          axisbin = (col2[ii] - hd->amin2) / hd->binsize2;
+          iaxisbin = (long) axisbin;
+
+          if (axisbin < 0. || iaxisbin >= hd->haxis2 || axisbin > hd->maxbin2)
+              continue;
+
+          ipix += (iaxisbin * incr2);
+
+          if (hd->haxis > 2)
+          {
+            if (col3[ii] == FLOATNULLVALUE)
+                continue;
+
+            axisbin = (col3[ii] - hd->amin3) / hd->binsize3;
+            iaxisbin = (long) axisbin;
+            if (axisbin < 0. || iaxisbin >= hd->haxis3 || axisbin > hd->maxbin3)
+                continue;
+
+            ipix += (iaxisbin * incr3);
+ 
+            if (hd->haxis > 3)
+            {
+              if (col4[ii] == FLOATNULLVALUE)
+                  continue;
+
+              axisbin = (col4[ii] - hd->amin4) / hd->binsize4;
+              iaxisbin = (long) axisbin;
+              if (axisbin < 0. || iaxisbin >= hd->haxis4 || axisbin > hd->maxbin4)
+                  continue;
+
+              ipix += (iaxisbin * incr4);
+
+            }  /* end of haxis > 3 case */
+          }    /* end of haxis > 2 case */
+        }      /* end of haxis > 1 case */
+
+        /* increment the histogram pixel */
+        if (hd->weight != FLOATNULLVALUE) /* constant weight factor */
+        {
+            if (hd->himagetype == TINT)
+              hd->hist.j[ipix] += (int) hd->weight;
+            else if (hd->himagetype == TSHORT)
+              hd->hist.i[ipix] += (short) hd->weight;
+            else if (hd->himagetype == TFLOAT)
+              hd->hist.r[ipix] += hd->weight;
+            else if (hd->himagetype == TDOUBLE)
+              hd->hist.d[ipix] += hd->weight;
+            else if (hd->himagetype == TBYTE)
+              hd->hist.b[ipix] += (char) hd->weight;
+        }
+        else if (hd->wtrecip) /* use reciprocal of the weight */
+        {
+            if (hd->himagetype == TINT)
+              hd->hist.j[ipix] += (int) (1./wtcol[ii]);
+            else if (hd->himagetype == TSHORT)
+              hd->hist.i[ipix] += (short) (1./wtcol[ii]);
+            else if (hd->himagetype == TFLOAT)
+              hd->hist.r[ipix] += (float) (1./wtcol[ii]);
+            else if (hd->himagetype == TDOUBLE)
+              hd->hist.d[ipix] += 1./wtcol[ii];
+            else if (hd->himagetype == TBYTE)
+              hd->hist.b[ipix] += (char) (1./wtcol[ii]);
+        }
+        else   /* no weights */
+        {
+            if (hd->himagetype == TINT)
+              hd->hist.j[ipix] += (int) wtcol[ii];
+            else if (hd->himagetype == TSHORT)
+              hd->hist.i[ipix] += (short) wtcol[ii];
+            else if (hd->himagetype == TFLOAT)
+              hd->hist.r[ipix] += wtcol[ii];
+            else if (hd->himagetype == TDOUBLE)
+              hd->hist.d[ipix] += wtcol[ii];
+            else if (hd->himagetype == TBYTE)
+              hd->hist.b[ipix] += (char) wtcol[ii];
+        }
+
+    }  /* end of loop over the rows */
+}
+
 /*--------------------------------------------------------------------------*/
 int ffbins(char *binspec,   /* I - binning specification */
                    int *imagetype,      /* O - image type, TINT or TSHORT */
@@ -2062,13 +2327,17 @@ int ffcalchist(long totalrows, long offset, long firstrow, long nrows,
    Interator work function that calculates values for the 2D histogram.
 */
 {
-    long ii, ipix, iaxisbin;
-    float pix, axisbin;
     static float *col1, *col2, *col3, *col4; /* static to preserve values */
     static float *wtcol;
-    static long incr2, incr3, incr4;
     static histType histData;
     static char *rowselect;
+#ifdef HAVE_HISTO_THREADS
+    long jj;
+    static void *privhist[HISTO_MAX_THREADS]; /* per-thread count arrays */
+    static long histnpix;        /* histogram elements, incl. null pixel */
+    static int  nworkers;
+    static int  elemsize;
+#endif
 
     /*  Initialization procedures: execute on the first call  */
     if (firstrow == 1)
@@ -2082,20 +2351,18 @@ int ffcalchist(long totalrows, long offset, long firstrow, long nrows,
 
       /* assign the input array pointers to local pointers */
       col1 = (float *) fits_iter_get_array(&colpars[0]);
+      col2 = col3 = col4 = 0;
       if (histData.haxis > 1)
       {
         col2 = (float *) fits_iter_get_array(&colpars[1]);
-        incr2 = histData.haxis1;
 
         if (histData.haxis > 2)
         {
           col3 = (float *) fits_iter_get_array(&colpars[2]);
-          incr3 = incr2 * histData.haxis2;
 
           if (histData.haxis > 3)
           {
             col4 = (float *) fits_iter_get_array(&colpars[3]);
-            incr4 = incr3 * histData.haxis3;
           }
         }
       }
@@ -2104,118 +2371,159 @@ int ffcalchist(long totalrows, long offset, long firstrow, long nrows,
       {
         wtcol = (float *) fits_iter_get_array(&colpars[histData.haxis]);
       }
-    }   /* end of Initialization procedures */
 
-    /*  Main loop: increment the histogram at position of each event */
-    for (ii = 1; ii <= nrows; ii++) 
-    {
-        if (rowselect)     /* if a row selector array is supplied... */
-        {
-           if (*rowselect)
-           {
-               rowselect++;   /* this row is included in the histogram */
-           }
-           else
-           {
-               rowselect++;   /* this row is excluded from the histogram */
-               continue;
-           }
+#ifdef HAVE_HISTO_THREADS
+      /* free any private arrays left over from an aborted iteration */
+      for (jj = 1; jj < HISTO_MAX_THREADS; jj++)
+      {
+        if (privhist[jj]) {
+          free(privhist[jj]);
+          privhist[jj] = NULL;
         }
+      }
 
-        if (col1[ii] == FLOATNULLVALUE)  /* test for null value */
-            continue;
-
-        pix = (col1[ii] - histData.amin1) / histData.binsize1;
-        ipix = (long) (pix + 1.); /* add 1 because the 1st pixel is the null value */
-
-	/* test if bin is within range */
-        if (ipix < 1 || ipix > histData.haxis1 || pix > histData.maxbin1)
-            continue;
+      /* decide whether to spread the binning over worker threads; the */
+      /* extra count arrays and the final merge only pay off when      */
+      /* binning a large number of rows                                */
+      nworkers = 1;
+      if (histo_nthreads > 1 && totalrows >= HISTO_THREAD_MIN_ROWS)
+      {
+        histnpix = histData.haxis1;
+        if (histData.haxis > 1) histnpix *= histData.haxis2;
+        if (histData.haxis > 2) histnpix *= histData.haxis3;
+        if (histData.haxis > 3) histnpix *= histData.haxis4;
+        histnpix += 1;               /* element 0 is the null pixel */
+
+        switch (histData.himagetype) {
+        case TBYTE:   elemsize = sizeof(char);    break;
+        case TSHORT:  elemsize = sizeof(short);   break;
+        case TINT:    elemsize = sizeof(int);     break;
+        case TFLOAT:  elemsize = sizeof(float);   break;
+        default:      elemsize = sizeof(double);  break;
+        }
 
-        if (histData.haxis > 1)
+        nworkers = histo_nthreads;
+        for (jj = 1; jj < nworkers; jj++)
         {
-          if (col2[ii] == FLOATNULLVALUE)
-              continue;
-
-          axisbin = (col2[ii] - histData.amin2) / histData.binsize2;
-          iaxisbin = (long) axisbin;
+          privhist[jj] = calloc(histnpix, elemsize);
+          if (!privhist[jj]) {     /* make do with fewer threads */
+            nworkers = jj;
+            break;
+          }
+        }
+      }
+#endif
+    }   /* end of Initialization procedures */
 
-          if (axisbin < 0. || iaxisbin >= histData.haxis2 || axisbin > histData.maxbin2)
-              continue;
+    /*  Main loop: bin the events of this chunk of rows  */
 
-          ipix += (iaxisbin * incr2);
+#ifdef HAVE_HISTO_THREADS
+    if (nworkers > 1)
+    {
+      pthread_t threads[HISTO_MAX_THREADS];
+      histslice slices[HISTO_MAX_THREADS];
+      long chunk = (nrows + nworkers - 1) / nworkers;
+      int idx;
 
-          if (histData.haxis > 2)
-          {
-            if (col3[ii] == FLOATNULLVALUE)
-                continue;
+      if (chunk < 1) chunk = 1;
 
-            axisbin = (col3[ii] - histData.amin3) / histData.binsize3;
-            iaxisbin = (long) axisbin;
-            if (axisbin < 0. || iaxisbin >= histData.haxis3 || axisbin > histData.maxbin3)
-                continue;
+      for (idx = 0; idx < nworkers; idx++)
+      {
+        slices[idx].hd = histData;
+        slices[idx].col1 = col1;
+        slices[idx].col2 = col2;
+        slices[idx].col3 = col3;
+        slices[idx].col4 = col4;
+        slices[idx].wtcol = wtcol;
+        slices[idx].rowsel = rowselect;
+        slices[idx].lo = 1 + idx * chunk;
+        slices[idx].hi = minvalue((idx + 1) * chunk, nrows);
+
+        /* all but the last slice accumulate into private arrays */
+        if (idx < nworkers - 1)
+        {
+          switch (histData.himagetype) {
+          case TBYTE:   slices[idx].hd.hist.b = (char *)  privhist[idx+1]; break;
+          case TSHORT:  slices[idx].hd.hist.i = (short *) privhist[idx+1]; break;
+          case TINT:    slices[idx].hd.hist.j = (int *)   privhist[idx+1]; break;
+          case TFLOAT:  slices[idx].hd.hist.r = (float *) privhist[idx+1]; break;
+          default:      slices[idx].hd.hist.d = (double *)privhist[idx+1]; break;
+          }
+        }
 
-            ipix += (iaxisbin * incr3);
- 
-            if (histData.haxis > 3)
-            {
-              if (col4[ii] == FLOATNULLVALUE)
-                  continue;
+        /* the last slice runs on this thread; if a worker cannot be */
+        /* created its slice simply runs here too                    */
+        if (idx == nworkers - 1 ||
+                pthread_create(&threads[idx], NULL, ffhistbinrun,
+                               &slices[idx]) != 0)
+        {
+          threads[idx] = pthread_self();
+          ffhistbinslice(&slices[idx]);
+        }
+      }
 
-              axisbin = (col4[ii] - histData.amin4) / histData.binsize4;
-              iaxisbin = (long) axisbin;
-              if (axisbin < 0. || iaxisbin >= histData.haxis4 || axisbin > histData.maxbin4)
-                  continue;
+      for (idx = 0; idx < nworkers; idx++)
+      {
+        if (!pthread_equal(threads[idx], pthread_self()))
+            pthread_join(threads[idx], NULL);
+      }
+    }
+    else
+#endif
+    {
+      histslice slice;
+
+      slice.hd = histData;
+      slice.col1 = col1;
+      slice.col2 = col2;
+      slice.col3 = col3;
+      slice.col4 = col4;
+      slice.wtcol = wtcol;
+      slice.rowsel = rowselect;
+      slice.lo = 1;
+      slice.hi = nrows;
+      ffhistbinslice(&slice);
+    }
 
-              ipix += (iaxisbin * incr4);
+    if (rowselect)
+        rowselect += nrows;      /* advance to the next chunk of flags */
 
-            }  /* end of haxis > 3 case */
-          }    /* end of haxis > 2 case */
-        }      /* end of haxis > 1 case */
+#ifdef HAVE_HISTO_THREADS
+    if (nworkers > 1 && firstrow - 1 + nrows >= totalrows)
+    {
+      /* last chunk: fold the private count arrays into the output */
+      long kk;
 
-        /* increment the histogram pixel */
-        if (histData.weight != FLOATNULLVALUE) /* constant weight factor */
-        {
-            if (histData.himagetype == TINT)
-              histData.hist.j[ipix] += (int) histData.weight;
-            else if (histData.himagetype == TSHORT)
-              histData.hist.i[ipix] += (short) histData.weight;
-            else if (histData.himagetype == TFLOAT)
-              histData.hist.r[ipix] += histData.weight;
-            else if (histData.himagetype == TDOUBLE)
-              histData.hist.d[ipix] += histData.weight;
-            else if (histData.himagetype == TBYTE)
-              histData.hist.b[ipix] += (char) histData.weight;
-        }
-        else if (histData.wtrecip) /* use reciprocal of the weight */
-        {
-            if (histData.himagetype == TINT)
-              histData.hist.j[ipix] += (int) (1./wtcol[ii]);
-            else if (histData.himagetype == TSHORT)
-              histData.hist.i[ipix] += (short) (1./wtcol[ii]);
-            else if (histData.himagetype == TFLOAT)
-              histData.hist.r[ipix] += (float) (1./wtcol[ii]);
-            else if (histData.himagetype == TDOUBLE)
-              histData.hist.d[ipix] += 1./wtcol[ii];
-            else if (histData.himagetype == TBYTE)
-              histData.hist.b[ipix] += (char) (1./wtcol[ii]);
-        }
-        else   /* no weights */
-        {
-            if (histData.himagetype == TINT)
-              histData.hist.j[ipix] += (int) wtcol[ii];
-            else if (histData.himagetype == TSHORT)
-              histData.hist.i[ipix] += (short) wtcol[ii];
-            else if (histData.himagetype == TFLOAT)
-              histData.hist.r[ipix] += wtcol[ii];
-            else if (histData.himagetype == TDOUBLE)
-              histData.hist.d[ipix] += wtcol[ii];
-            else if (histData.himagetype == TBYTE)
-              histData.hist.b[ipix] += (char) wtcol[ii];
+      for (jj = 1; jj < nworkers; jj++)
+      {
+        switch (histData.himagetype) {
+        case TBYTE:
+          for (kk = 0; kk < histnpix; kk++)
+              histData.hist.b[kk] += ((char *) privhist[jj])[kk];
+          break;
+        case TSHORT:
+          for (kk = 0; kk < histnpix; kk++)
+              histData.hist.i[kk] += ((short *) privhist[jj])[kk];
+          break;
+        case TINT:
+          for (kk = 0; kk < histnpix; kk++)
+              histData.hist.j[kk] += ((int *) privhist[jj])[kk];
+          break;
+        case TFLOAT:
+          for (kk = 0; kk < histnpix; kk++)
+              histData.hist.r[kk] += ((float *) privhist[jj])[kk];
+          break;
+        default:
+          for (kk = 0; kk < histnpix; kk++)
+              histData.hist.d[kk] += ((double *) privhist[jj])[kk];
+          break;
         }
-
-    }  /* end of main loop over all rows */
+        free(privhist[jj]);
+        privhist[jj] = NULL;
+      }
+      nworkers = 1;
+    }
+#endif
 
     return(0);
 }
-
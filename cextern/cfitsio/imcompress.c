@@ -22,7 +22,48 @@ float trans_ratio[999];
 
 float *fits_rand_value = 0;
 
-int imcomp_write_nocompress_tile(fitsfile *outfptr, long row, int datatype, 
+/* byte budget for the cache of decompressed tiles kept by
+   imcomp_decompress_tile; <= 0 means one cache slot per tile column,
+   which reproduces the historical memory footprint.  The cache itself
+   is fully associative with LRU replacement, keyed by the table row
+   (tile number) and datatype of each decompressed tile. */
+static long tile_cache_budget = 0;
+
+int fits_set_tile_cache_size(long nbytes)
+/*
+   Set the approximate number of bytes that may be used to cache
+   decompressed image tiles in each opened file.  The setting takes
+   effect the next time a tile-compressed image allocates its cache.
+   Returns the adopted value.
+*/
+{
+    if (nbytes < 0) nbytes = 0;
+    tile_cache_budget = nbytes;
+    return(0);
+}
+
+/* number of tiles beyond the one being decompressed whose compressed
+   bytes are hinted to the kernel for read-ahead, so the disk read of
+   the next tile can overlap with the decode of the current one */
+static int tile_prefetch_ntiles = 1;
+
+int fits_set_tile_prefetch(int ntiles)
+/*
+   Set the number of tiles to read ahead when decompressing tiles of a
+   compressed image; 0 disables the read-ahead hints.  Returns the
+   adopted value.
+*/
+{
+    if (ntiles < 0)
+        ntiles = 0;
+    else if (ntiles > 16)
+        ntiles = 16;
+
+    tile_prefetch_ntiles = ntiles;
+    return(tile_prefetch_ntiles);
+}
+
+int imcomp_write_nocompress_tile(fitsfile *outfptr, long row, int datatype,
     void *tiledata, long tilelen, int nullcheck, void *nullflagval, int *status);
 int imcomp_convert_tile_tshort(fitsfile *outfptr, void *tiledata, long tilelen,
     int nullcheck, void *nullflagval, int nullval, int zbitpix, double scale,
@@ -164,6 +205,17 @@ static int fits_unshuffle_4bytes(char *heap, LONGLONG length, int *status);
 static int fits_unshuffle_2bytes(char *heap, LONGLONG length, int *status);
 static int fits_gunzip_heap(fitsfile *infptr, fitsfile *outfptr, int *status);
 
+static void imcomp_card_log(char *card, const char *keyname, int value,
+    const char *comm, int *status);
+static void imcomp_card_lng(char *card, const char *keyname, LONGLONG value,
+    const char *comm, int *status);
+static void imcomp_card_str(char *card, const char *keyname, const char *value,
+    const char *comm, int *status);
+static void imcomp_card_flt(char *card, const char *keyname, float value,
+    int decim, const char *comm, int *status);
+static void imcomp_card_fixdbl(char *card, const char *keyname, double value,
+    int decim, const char *comm, int *status);
+
 /* only used for diagnoitic purposes */
 /* int fits_get_case(int *c1, int*c2, int*c3); */ 
 /*---------------------------------------------------------------------------*/
@@ -940,6 +992,56 @@ int fits_img_compress(fitsfile *infptr, /* pointer to image to be compressed */
     return (*status);
 }
 /*--------------------------------------------------------------------------*/
+static void imcomp_card_log(char *card, const char *keyname, int value,
+    const char *comm, int *status)
+/* format a logical-valued keyword record; same card text as ffpkyl */
+{
+    char valstring[FLEN_VALUE];
+
+    ffl2c(value, valstring, status);
+    ffmkky(keyname, valstring, comm, card, status);
+}
+/*--------------------------------------------------------------------------*/
+static void imcomp_card_lng(char *card, const char *keyname, LONGLONG value,
+    const char *comm, int *status)
+/* format an integer-valued keyword record; same card text as ffpkyj */
+{
+    char valstring[FLEN_VALUE];
+
+    ffi2c(value, valstring, status);
+    ffmkky(keyname, valstring, comm, card, status);
+}
+/*--------------------------------------------------------------------------*/
+static void imcomp_card_str(char *card, const char *keyname, const char *value,
+    const char *comm, int *status)
+/* format a string-valued keyword record; same card text as ffpkys */
+{
+    char valstring[FLEN_VALUE];
+
+    ffs2c(value, valstring, status);
+    ffmkky(keyname, valstring, comm, card, status);
+}
+/*--------------------------------------------------------------------------*/
+static void imcomp_card_flt(char *card, const char *keyname, float value,
+    int decim, const char *comm, int *status)
+/* format an exponential float keyword record; same card text as ffpkye */
+{
+    char valstring[FLEN_VALUE];
+
+    ffr2e(value, decim, valstring, status);
+    ffmkky(keyname, valstring, comm, card, status);
+}
+/*--------------------------------------------------------------------------*/
+static void imcomp_card_fixdbl(char *card, const char *keyname, double value,
+    int decim, const char *comm, int *status)
+/* format a fixed-format double keyword record; same card text as ffpkyg */
+{
+    char valstring[FLEN_VALUE];
+
+    ffd2f(value, decim, valstring, status);
+    ffmkky(keyname, valstring, comm, card, status);
+}
+/*--------------------------------------------------------------------------*/
 int imcomp_init_table(fitsfile *outfptr,
         int inbitpix,
         int naxis,
@@ -951,7 +1053,9 @@ int imcomp_init_table(fitsfile *outfptr,
 */
 {
     char keyname[FLEN_KEYWORD], zcmptype[12];
-    int ii,  remain,  ncols, bitpix;
+    char cards[32][FLEN_CARD];   /* the header cards, written in one batch */
+    const char *cardptrs[32];
+    int ii,  remain,  ncols, bitpix, ncards = 0;
     long nrows;
     char *ttype[] = {"COMPRESSED_DATA", "ZSCALE", "ZZERO"};
     char *tform[3];
@@ -1196,65 +1300,69 @@ int imcomp_init_table(fitsfile *outfptr,
     ffcrtb(outfptr, BINARY_TBL, nrows, ncols, ttype, 
                 tform, tunit, 0, status);
 
-    /* Add standard header keywords. */
-    ffpkyl (outfptr, "ZIMAGE", 1, 
-           "extension contains compressed image", status);  
+    /* Add standard header keywords.  The cards are accumulated in a local */
+    /* array and committed with a single batched write at the end, which */
+    /* avoids a separate seek-and-write cycle per keyword. */
+    imcomp_card_log (cards[ncards++], "ZIMAGE", 1,
+           "extension contains compressed image", status);
 
     if (writebitpix) {
         /*  write the keywords defining the datatype and dimensions of */
 	/*  the uncompressed image.  If not, these keywords will be */
         /*  copied later from the input uncompressed image  */
-	   
-        ffpkyj (outfptr, "ZBITPIX", bitpix,
+
+        imcomp_card_lng (cards[ncards++], "ZBITPIX", bitpix,
 			"data type of original image", status);
-        ffpkyj (outfptr, "ZNAXIS", naxis,
+        imcomp_card_lng (cards[ncards++], "ZNAXIS", naxis,
 			"dimension of original image", status);
 
         for (ii = 0;  ii < naxis;  ii++)
         {
             sprintf (keyname, "ZNAXIS%d", ii+1);
-            ffpkyj (outfptr, keyname, naxes[ii],
+            imcomp_card_lng (cards[ncards++], keyname, naxes[ii],
 			"length of original image axis", status);
         }
     }
-                      
+
     for (ii = 0;  ii < naxis;  ii++)
     {
         sprintf (keyname, "ZTILE%d", ii+1);
-        ffpkyj (outfptr, keyname, actual_tilesize[ii],
+        imcomp_card_lng (cards[ncards++], keyname, actual_tilesize[ii],
 			"size of tiles to be compressed", status);
     }
 
     if (bitpix < 0) {
        
 	if ((outfptr->Fptr)->request_quantize_level == NO_QUANTIZE) {
-	    ffpkys(outfptr, "ZQUANTIZ", "NONE", 
+	    imcomp_card_str(cards[ncards++], "ZQUANTIZ", "NONE",
 	      "Lossless compression without quantization", status);
 	} else {
-	    
+
 	    /* Unless dithering has been specifically turned off by setting */
 	    /* request_quantize_method = -1, use dithering by default */
 	    /* when quantizing floating point images. */
-	
-	    if ( (outfptr->Fptr)->request_quantize_method == 0) 
+
+	    if ( (outfptr->Fptr)->request_quantize_method == 0)
               (outfptr->Fptr)->request_quantize_method = SUBTRACTIVE_DITHER_1;
-       
+
 	    if ((outfptr->Fptr)->request_quantize_method == SUBTRACTIVE_DITHER_1) {
-	      ffpkys(outfptr, "ZQUANTIZ", "SUBTRACTIVE_DITHER_1", 
+	      imcomp_card_str(cards[ncards++], "ZQUANTIZ", "SUBTRACTIVE_DITHER_1",
 	        "Pixel Quantization Algorithm", status);
 
 	      /* also write the associated ZDITHER0 keyword with a default value */
 	      /* which may get updated later. */
-              ffpky(outfptr, TINT, "ZDITHER0", &((outfptr->Fptr)->request_dither_seed), 
+              imcomp_card_lng(cards[ncards++], "ZDITHER0",
+	       (LONGLONG) (outfptr->Fptr)->request_dither_seed,
 	       "dithering offset when quantizing floats", status);
- 
+
             } else if ((outfptr->Fptr)->request_quantize_method == SUBTRACTIVE_DITHER_2) {
-	      ffpkys(outfptr, "ZQUANTIZ", "SUBTRACTIVE_DITHER_2", 
+	      imcomp_card_str(cards[ncards++], "ZQUANTIZ", "SUBTRACTIVE_DITHER_2",
 	        "Pixel Quantization Algorithm", status);
 
 	      /* also write the associated ZDITHER0 keyword with a default value */
 	      /* which may get updated later. */
-              ffpky(outfptr, TINT, "ZDITHER0", &((outfptr->Fptr)->request_dither_seed), 
+              imcomp_card_lng(cards[ncards++], "ZDITHER0",
+	       (LONGLONG) (outfptr->Fptr)->request_dither_seed,
 	       "dithering offset when quantizing floats", status);
 
 	      if (!strcmp(zcmptype, "RICE_1"))  {
@@ -1266,50 +1374,52 @@ int imcomp_init_table(fitsfile *outfptr,
 	      }
 
             } else if ((outfptr->Fptr)->request_quantize_method == NO_DITHER) {
-	      ffpkys(outfptr, "ZQUANTIZ", "NO_DITHER", 
+	      imcomp_card_str(cards[ncards++], "ZQUANTIZ", "NO_DITHER",
 	        "No dithering during quantization", status);
 	    }
 
 	}
     }
 
-    ffpkys (outfptr, "ZCMPTYPE", zcmptype,
+    imcomp_card_str (cards[ncards++], "ZCMPTYPE", zcmptype,
 	          "compression algorithm", status);
 
     /* write any algorithm-specific keywords */
     if ((outfptr->Fptr)->request_compress_type == RICE_1)
     {
-        ffpkys (outfptr, "ZNAME1", "BLOCKSIZE",
+        imcomp_card_str (cards[ncards++], "ZNAME1", "BLOCKSIZE",
             "compression block size", status);
 
         /* for now at least, the block size is always 32 */
-        ffpkyj (outfptr, "ZVAL1", 32,
+        imcomp_card_lng (cards[ncards++], "ZVAL1", 32,
 			"pixels per block", status);
 
-        ffpkys (outfptr, "ZNAME2", "BYTEPIX",
+        imcomp_card_str (cards[ncards++], "ZNAME2", "BYTEPIX",
             "bytes per pixel (1, 2, 4, or 8)", status);
 
         if (bitpix == BYTE_IMG)
-            ffpkyj (outfptr, "ZVAL2", 1,
+            imcomp_card_lng (cards[ncards++], "ZVAL2", 1,
 			"bytes per pixel (1, 2, 4, or 8)", status);
         else if (bitpix == SHORT_IMG)
-            ffpkyj (outfptr, "ZVAL2", 2,
+            imcomp_card_lng (cards[ncards++], "ZVAL2", 2,
 			"bytes per pixel (1, 2, 4, or 8)", status);
-        else 
-            ffpkyj (outfptr, "ZVAL2", 4,
+        else
+            imcomp_card_lng (cards[ncards++], "ZVAL2", 4,
 			"bytes per pixel (1, 2, 4, or 8)", status);
 
     }
     else if ((outfptr->Fptr)->request_compress_type == HCOMPRESS_1)
     {
-        ffpkys (outfptr, "ZNAME1", "SCALE",
+        imcomp_card_str (cards[ncards++], "ZNAME1", "SCALE",
             "HCOMPRESS scale factor", status);
-        ffpkye (outfptr, "ZVAL1", (outfptr->Fptr)->request_hcomp_scale,
+        imcomp_card_flt (cards[ncards++], "ZVAL1",
+		(outfptr->Fptr)->request_hcomp_scale,
 		7, "HCOMPRESS scale factor", status);
 
-        ffpkys (outfptr, "ZNAME2", "SMOOTH",
+        imcomp_card_str (cards[ncards++], "ZNAME2", "SMOOTH",
             "HCOMPRESS smooth option", status);
-        ffpkyj (outfptr, "ZVAL2", (long) (outfptr->Fptr)->request_hcomp_smooth,
+        imcomp_card_lng (cards[ncards++], "ZVAL2",
+		(long) (outfptr->Fptr)->request_hcomp_smooth,
 			"HCOMPRESS smooth option", status);
     }
 
@@ -1317,25 +1427,31 @@ int imcomp_init_table(fitsfile *outfptr,
     if (inbitpix == USHORT_IMG)
     {
         strcpy(comm, "offset data range to that of unsigned short");
-        ffpkyg(outfptr, "BZERO", 32768., 0, comm, status);
+        imcomp_card_fixdbl(cards[ncards++], "BZERO", 32768., 0, comm, status);
         strcpy(comm, "default scaling factor");
-        ffpkyg(outfptr, "BSCALE", 1.0, 0, comm, status);
+        imcomp_card_fixdbl(cards[ncards++], "BSCALE", 1.0, 0, comm, status);
     }
     else if (inbitpix == SBYTE_IMG)
     {
         strcpy(comm, "offset data range to that of signed byte");
-        ffpkyg(outfptr, "BZERO", -128., 0, comm, status);
+        imcomp_card_fixdbl(cards[ncards++], "BZERO", -128., 0, comm, status);
         strcpy(comm, "default scaling factor");
-        ffpkyg(outfptr, "BSCALE", 1.0, 0, comm, status);
+        imcomp_card_fixdbl(cards[ncards++], "BSCALE", 1.0, 0, comm, status);
     }
     else if (inbitpix == ULONG_IMG)
     {
         strcpy(comm, "offset data range to that of unsigned long");
-        ffpkyg(outfptr, "BZERO", 2147483648., 0, comm, status);
+        imcomp_card_fixdbl(cards[ncards++], "BZERO", 2147483648., 0, comm, status);
         strcpy(comm, "default scaling factor");
-        ffpkyg(outfptr, "BSCALE", 1.0, 0, comm, status);
+        imcomp_card_fixdbl(cards[ncards++], "BSCALE", 1.0, 0, comm, status);
     }
 
+    /* commit all the cards to the header in a single write */
+    for (ii = 0; ii < ncards; ii++)
+        cardptrs[ii] = cards[ii];
+
+    ffprecn(outfptr, cardptrs, ncards, status);
+
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -1717,14 +1833,13 @@ int imcomp_compress_tile (fitsfile *outfptr,
     /* free the previously saved tile if the input tile is for the same row */
     if ((outfptr->Fptr)->tilerow) {  /* has the tile cache been allocated? */
 
-      /* calculate the column bin of the compressed tile */
-      tilecol = (row - 1) % ((long)(((outfptr->Fptr)->znaxis[0] - 1) / ((outfptr->Fptr)->tilesize[0])) + 1);
-      
-      if ((outfptr->Fptr)->tilerow[tilecol] == row) {
+      /* invalidate any cached copy of this tile, in whichever slot it is */
+      for (tilecol = 0; tilecol < (outfptr->Fptr)->tilenslots; tilecol++) {
+       if ((outfptr->Fptr)->tilerow[tilecol] == row) {
         if (((outfptr->Fptr)->tiledata)[tilecol]) {
             free(((outfptr->Fptr)->tiledata)[tilecol]);
         }
-	  
+
         if (((outfptr->Fptr)->tilenullarray)[tilecol]) {
             free(((outfptr->Fptr)->tilenullarray)[tilecol]);
         }
@@ -1735,6 +1850,8 @@ int imcomp_compress_tile (fitsfile *outfptr,
         (outfptr->Fptr)->tiledatasize[tilecol] = 0;
         (outfptr->Fptr)->tiletype[tilecol] = 0;
         (outfptr->Fptr)->tileanynull[tilecol] = 0;
+        (outfptr->Fptr)->tileage[tilecol] = 0;
+       }
       }
     }
 
@@ -5714,12 +5831,14 @@ int imcomp_decompress_tile (fitsfile *infptr,
     unsigned char *cbuf; /* compressed data */
     unsigned char charnull = 0;
     short snull = 0;
-    int blocksize, ntilebins, tilecol;
+    int blocksize, ntilebins, nslots, slot, oldest;
     float fnulval=0;
     float *tempfloat = 0;
     double dnulval=0;
     double bscale, bzero, actual_bzero, dummy = 0;    /* scaling parameters */
     long nelem = 0, offset = 0, tilesize;      /* number of bytes */
+    long pfnelem = 0, pfoffset = 0;  /* descriptor of a prefetched tile */
+    int pfstatus;
     int smooth, nx, ny, scale;  /* hcompress parameters */
 
     if (*status > 0)
@@ -5736,43 +5855,73 @@ int imcomp_decompress_tile (fitsfile *infptr,
      if ((infptr->Fptr)->znaxis[0]   != (infptr->Fptr)->tilesize[0] ||
         (infptr->Fptr)->tilesize[1] != 1 ) {   /* don't cache the tile if only single row of the image */
 
-        (infptr->Fptr)->tilerow = (int *) calloc (ntilebins, sizeof(int));
-        (infptr->Fptr)->tiledata = (void**) calloc (ntilebins, sizeof(void*));
-        (infptr->Fptr)->tilenullarray = (void **) calloc (ntilebins, sizeof(char*));
-        (infptr->Fptr)->tiledatasize = (long *) calloc (ntilebins, sizeof(long));
-        (infptr->Fptr)->tiletype = (int *) calloc (ntilebins, sizeof(int));
-        (infptr->Fptr)->tileanynull = (int *) calloc (ntilebins, sizeof(int));
+        /* by default there is one cache slot per tile column, which
+           reproduces the historical memory footprint; a byte budget set
+           with fits_set_tile_cache_size determines the slot count
+           instead, assuming the worst case of 8 bytes per pixel */
+        nslots = ntilebins;
+        if (tile_cache_budget > 0) {
+            nslots = (int) (tile_cache_budget /
+                            (((infptr->Fptr)->maxtilelen) * 8));
+            if (nslots < 1) nslots = 1;
+            if (nslots > 10000) nslots = 10000;
+        }
+
+        (infptr->Fptr)->tilerow = (int *) calloc (nslots, sizeof(int));
+        (infptr->Fptr)->tiledata = (void**) calloc (nslots, sizeof(void*));
+        (infptr->Fptr)->tilenullarray = (void **) calloc (nslots, sizeof(char*));
+        (infptr->Fptr)->tiledatasize = (long *) calloc (nslots, sizeof(long));
+        (infptr->Fptr)->tiletype = (int *) calloc (nslots, sizeof(int));
+        (infptr->Fptr)->tileanynull = (int *) calloc (nslots, sizeof(int));
+        (infptr->Fptr)->tileage = (int *) calloc (nslots, sizeof(int));
+        (infptr->Fptr)->tilenslots = nslots;
+        (infptr->Fptr)->tileclock = 0;
       }
     }
- 
+
     /* **************************************************************** */
     /* check if this tile was cached; if so, just copy it out */
     if ((infptr->Fptr)->tilerow)  {
-      /* calculate the column bin of the compressed tile */
-      tilecol = (nrow - 1) % ((long)(((infptr->Fptr)->znaxis[0] - 1) / ((infptr->Fptr)->tilesize[0])) + 1);
+      for (slot = 0; slot < (infptr->Fptr)->tilenslots; slot++) {
+       if (nrow == (infptr->Fptr)->tilerow[slot] && datatype == (infptr->Fptr)->tiletype[slot] ) {
 
-      if (nrow == (infptr->Fptr)->tilerow[tilecol] && datatype == (infptr->Fptr)->tiletype[tilecol] ) {
+         memcpy(buffer, ((infptr->Fptr)->tiledata)[slot], (infptr->Fptr)->tiledatasize[slot]);
 
-         memcpy(buffer, ((infptr->Fptr)->tiledata)[tilecol], (infptr->Fptr)->tiledatasize[tilecol]);
-	 
 	 if (nullcheck == 2)
-             memcpy(bnullarray, (infptr->Fptr)->tilenullarray[tilecol], tilelen);
+             memcpy(bnullarray, (infptr->Fptr)->tilenullarray[slot], tilelen);
 
-         *anynul = (infptr->Fptr)->tileanynull[tilecol];
+         *anynul = (infptr->Fptr)->tileanynull[slot];
+
+         (infptr->Fptr)->tileage[slot] = ++((infptr->Fptr)->tileclock);
 
          return(*status);
        }
+      }
     }
 
     /* **************************************************************** */
     /* get length of the compressed byte stream */
-    ffgdes (infptr, (infptr->Fptr)->cn_compressed, nrow, &nelem, &offset, 
+    ffgdes (infptr, (infptr->Fptr)->cn_compressed, nrow, &nelem, &offset,
             status);
 
     /* EOF error here indicates that this tile has not yet been written */
     if (*status == END_OF_FILE)
            return(*status = NO_COMPRESSED_TILE);
-      
+
+    /* hint the kernel to read ahead the compressed bytes of the next
+       tile(s), so the disk read overlaps with the decoding of this tile */
+    for (ii = 1; ii <= tile_prefetch_ntiles; ii++)
+    {
+        if (nrow + ii > (infptr->Fptr)->numrows)
+            break;
+
+        pfstatus = 0;
+        if (ffgdes (infptr, (infptr->Fptr)->cn_compressed, nrow + ii,
+                    &pfnelem, &pfoffset, &pfstatus) == 0 && pfnelem > 0)
+            fits_prefetch_hint(infptr, (infptr->Fptr)->datastart +
+                (infptr->Fptr)->heapstart + pfoffset, pfnelem);
+    }
+
     /* **************************************************************** */
     if (nelem == 0)  /* special case: tile was not compressed normally */
     {
@@ -6600,51 +6749,70 @@ int imcomp_decompress_tile (fitsfile *infptr,
      {
       tilesize = pixlen * tilelen;
 
+      /* choose the slot to store the tile in: a slot already holding
+         this row, else an empty slot, else the least recently used */
+      slot = 0;
+      oldest = (infptr->Fptr)->tileage[0];
+      for (ii = 0; ii < (infptr->Fptr)->tilenslots; ii++) {
+        if ((infptr->Fptr)->tilerow[ii] == nrow) {
+            slot = ii;
+            break;
+        }
+        if ((infptr->Fptr)->tilerow[ii] == 0) {
+            slot = ii;
+            oldest = 0;
+        } else if ((infptr->Fptr)->tileage[ii] < oldest) {
+            slot = ii;
+            oldest = (infptr->Fptr)->tileage[ii];
+        }
+      }
+
       /* check that tile size/type has not changed */
-      if (tilesize != (infptr->Fptr)->tiledatasize[tilecol] ||
-        datatype != (infptr->Fptr)->tiletype[tilecol] )  {
+      if (tilesize != (infptr->Fptr)->tiledatasize[slot] ||
+        datatype != (infptr->Fptr)->tiletype[slot] )  {
 
-        if (((infptr->Fptr)->tiledata)[tilecol]) {
-            free(((infptr->Fptr)->tiledata)[tilecol]);	    
+        if (((infptr->Fptr)->tiledata)[slot]) {
+            free(((infptr->Fptr)->tiledata)[slot]);
         }
-	
-        if (((infptr->Fptr)->tilenullarray)[tilecol]) {
-            free(((infptr->Fptr)->tilenullarray)[tilecol]);
+
+        if (((infptr->Fptr)->tilenullarray)[slot]) {
+            free(((infptr->Fptr)->tilenullarray)[slot]);
         }
-	
-        ((infptr->Fptr)->tilenullarray)[tilecol] = 0;
-        ((infptr->Fptr)->tilerow)[tilecol] = 0;
-        ((infptr->Fptr)->tiledatasize)[tilecol] = 0;
-        ((infptr->Fptr)->tiletype)[tilecol] = 0;
+
+        ((infptr->Fptr)->tilenullarray)[slot] = 0;
+        ((infptr->Fptr)->tilerow)[slot] = 0;
+        ((infptr->Fptr)->tiledatasize)[slot] = 0;
+        ((infptr->Fptr)->tiletype)[slot] = 0;
 
         /* allocate new array(s) */
-	((infptr->Fptr)->tiledata)[tilecol] = malloc(tilesize);
+	((infptr->Fptr)->tiledata)[slot] = malloc(tilesize);
 
-	if (((infptr->Fptr)->tiledata)[tilecol] == 0)
+	if (((infptr->Fptr)->tiledata)[slot] == 0)
 	   return (*status);
 
         if (nullcheck == 2) {  /* also need array of null pixel flags */
-	    (infptr->Fptr)->tilenullarray[tilecol] = malloc(tilelen);
-	    if ((infptr->Fptr)->tilenullarray[tilecol] == 0)
+	    (infptr->Fptr)->tilenullarray[slot] = malloc(tilelen);
+	    if ((infptr->Fptr)->tilenullarray[slot] == 0)
 	        return (*status);
         }
 
-        (infptr->Fptr)->tiledatasize[tilecol] = tilesize;
-        (infptr->Fptr)->tiletype[tilecol] = datatype;
+        (infptr->Fptr)->tiledatasize[slot] = tilesize;
+        (infptr->Fptr)->tiletype[slot] = datatype;
       }
 
       /* copy the tile array(s) into cache buffer */
-      memcpy((infptr->Fptr)->tiledata[tilecol], buffer, tilesize);
+      memcpy((infptr->Fptr)->tiledata[slot], buffer, tilesize);
 
       if (nullcheck == 2) {
 	    if ((infptr->Fptr)->tilenullarray == 0)  {
-       	      (infptr->Fptr)->tilenullarray[tilecol] = malloc(tilelen);
+       	      (infptr->Fptr)->tilenullarray[slot] = malloc(tilelen);
             }
-            memcpy((infptr->Fptr)->tilenullarray[tilecol], bnullarray, tilelen);
+            memcpy((infptr->Fptr)->tilenullarray[slot], bnullarray, tilelen);
       }
 
-      (infptr->Fptr)->tilerow[tilecol] = nrow;
-      (infptr->Fptr)->tileanynull[tilecol] = *anynul;
+      (infptr->Fptr)->tilerow[slot] = nrow;
+      (infptr->Fptr)->tileanynull[slot] = *anynul;
+      (infptr->Fptr)->tileage[slot] = ++((infptr->Fptr)->tileclock);
      }
     }
     return (*status);
@@ -7248,50 +7416,81 @@ static int unquantize_i1r4(long row, /* tile number = row number in table  */
 
     if (nullcheck == 0)     /* no null checking required */
     {
-             for (ii = 0; ii < ntodo; ii++)
-            {
-		if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		    output[ii] = 0.0;
-		else
+           /* process the tile in segments that lie within the random
+              number sequence, so the wrap-around logic (and the
+              dither-method test) stay out of the inner loop and the
+              compiler is free to vectorize the scaling arithmetic */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
+                    else
+                        output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
                     output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
     else        /* must check for null values */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
-                {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
+           /* segmented as above to keep the wrap-around logic out
+              of the inner loop */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
                     else
-                        nullarray[ii] = 1;
+                        output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
-                else
-                {
-		    if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		        output[ii] = 0.0;
-		    else
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else
                         output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
-                } 
-
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-	            nextrand = (int) (fits_rand_value[iseed] * 500);
                 }
-            }
-    }
+              }
 
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
+    }
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -7326,50 +7525,81 @@ static int unquantize_i2r4(long row, /* seed for random values  */
 
     if (nullcheck == 0)     /* no null checking required */
     {
-           for (ii = 0; ii < ntodo; ii++)
-            {
-		if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		    output[ii] = 0.0;
-		else
+           /* process the tile in segments that lie within the random
+              number sequence, so the wrap-around logic (and the
+              dither-method test) stay out of the inner loop and the
+              compiler is free to vectorize the scaling arithmetic */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
+                    else
+                        output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
                     output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
     else        /* must check for null values */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
-                {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
+           /* segmented as above to keep the wrap-around logic out
+              of the inner loop */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
                     else
-                        nullarray[ii] = 1;
+                        output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
-                else
-                {
-                    if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		        output[ii] = 0.0;
-		    else
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else
                         output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-             }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
-
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -7404,50 +7634,81 @@ static int unquantize_i4r4(long row, /* tile number = row number in table    */
 
     if (nullcheck == 0)     /* no null checking required */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		    output[ii] = 0.0;
-		else
+           /* process the tile in segments that lie within the random
+              number sequence, so the wrap-around logic (and the
+              dither-method test) stay out of the inner loop and the
+              compiler is free to vectorize the scaling arithmetic */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
+                    else
+                        output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
                     output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
     else        /* must check for null values */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
-                {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
+           /* segmented as above to keep the wrap-around logic out
+              of the inner loop */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
                     else
-                        nullarray[ii] = 1;
+                        output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
-                else
-                {
-                    if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		        output[ii] = 0.0;
-		    else
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else
                         output[ii] = (float) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
-
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -7482,50 +7743,81 @@ static int unquantize_i1r8(long row, /* tile number = row number in table  */
 
     if (nullcheck == 0)     /* no null checking required */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		    output[ii] = 0.0;
-		else
+           /* process the tile in segments that lie within the random
+              number sequence, so the wrap-around logic (and the
+              dither-method test) stay out of the inner loop and the
+              compiler is free to vectorize the scaling arithmetic */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
+                    else
+                        output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
                     output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
     else        /* must check for null values */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
-                {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
+           /* segmented as above to keep the wrap-around logic out
+              of the inner loop */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
                     else
-                        nullarray[ii] = 1;
+                        output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
-                else
-                {
-                    if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		        output[ii] = 0.0;
-		    else
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else
                         output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
-
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -7560,50 +7852,81 @@ static int unquantize_i2r8(long row, /* tile number = row number in table  */
 
     if (nullcheck == 0)     /* no null checking required */
     {
-           for (ii = 0; ii < ntodo; ii++)
-            {
-                if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		    output[ii] = 0.0;
-		else
+           /* process the tile in segments that lie within the random
+              number sequence, so the wrap-around logic (and the
+              dither-method test) stay out of the inner loop and the
+              compiler is free to vectorize the scaling arithmetic */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
+                    else
+                        output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
                     output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
     else        /* must check for null values */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
-                {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
+           /* segmented as above to keep the wrap-around logic out
+              of the inner loop */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
                     else
-                        nullarray[ii] = 1;
+                        output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
-                else
-                {
-                    if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		        output[ii] = 0.0;
-		    else
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else
                         output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
-
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -7638,50 +7961,81 @@ static int unquantize_i4r8(long row, /* tile number = row number in table    */
 
     if (nullcheck == 0)     /* no null checking required */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		    output[ii] = 0.0;
-		else
+           /* process the tile in segments that lie within the random
+              number sequence, so the wrap-around logic (and the
+              dither-method test) stay out of the inner loop and the
+              compiler is free to vectorize the scaling arithmetic */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
+                    else
+                        output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
                     output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
+                }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
     else        /* must check for null values */
     {
-            for (ii = 0; ii < ntodo; ii++)
-            {
-                if (input[ii] == tnull)
-                {
-                    *anynull = 1;
-                    if (nullcheck == 1)
-                        output[ii] = nullval;
+           /* segmented as above to keep the wrap-around logic out
+              of the inner loop */
+           ii = 0;
+           while (ii < ntodo) {
+              long iend = ii + (N_RANDOM - nextrand);
+              if (iend > ntodo) iend = ntodo;
+
+              if (dither_method == SUBTRACTIVE_DITHER_2) {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else if (input[ii] == ZERO_VALUE)
+                        output[ii] = 0.0;
                     else
-                        nullarray[ii] = 1;
+                        output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
-                else
-                {
-                    if (dither_method == SUBTRACTIVE_DITHER_2 && input[ii] == ZERO_VALUE)
-		        output[ii] = 0.0;
-		    else
+              } else {
+                for ( ; ii < iend;  ii++, nextrand++) {
+                    if (input[ii] == tnull)
+                    {
+                        *anynull = 1;
+                        if (nullcheck == 1)
+                            output[ii] = nullval;
+                        else
+                            nullarray[ii] = 1;
+                    }
+                    else
                         output[ii] = (double) (((double) input[ii] - fits_rand_value[nextrand] + 0.5) * scale + zero);
                 }
+              }
 
-	        nextrand++;
-	        if (nextrand == N_RANDOM) {
-	            iseed++;
-		    if (iseed == N_RANDOM) iseed = 0;
-		    nextrand = (int) (fits_rand_value[iseed] * 500);
-	        }
-            }
+              if (nextrand == N_RANDOM) {
+                  iseed++;
+                  if (iseed == N_RANDOM) iseed = 0;
+                  nextrand = (int) (fits_rand_value[iseed] * 500);
+              }
+           }
     }
-
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -48,9 +48,15 @@
 #include <stdlib.h>
 #include <stddef.h>  /* stddef.h is apparently needed to define size_t */
 #include <string.h>
+#include "fitsio2.h"  /* for the ffswap byte swapping kernels */
 
 #define FILE_NOT_OPENED 104
 
+/* Size of the buffer used to read the pixel file in whole physical lines
+   when the physical and image dimensions differ; one fread per line runs
+   far below disk speed on large images */
+#define IRAF_LINE_CHUNK 8388608
+
 /* Parameters from iraf/lib/imhdr.h for IRAF version 1 images */
 #define SZ_IMPIXFILE	 79		/* name of pixel storage file */
 #define SZ_IMHDRFILE	 79   		/* length of header storage file */
@@ -326,8 +332,9 @@ static int irafrdimage (
     int bitpix, bytepix, i;
     char *fitsheader, *image;
     int nbr, nbimage, nbaxis, nbl, nbdiff;
+    int nbphys, chunklines, nlines, nbcopy, j;
     char *pixheader;
-    char *linebuff;
+    char *linebuff, *chunkbuff;
     int imhver, lpixhead = 0;
     char pixname[SZ_IM2PIXFILE+1];
     char errmsg[81];
@@ -430,19 +437,54 @@ static int irafrdimage (
     if (npaxis1 == naxis1)
 	nbr = fread (image, 1, nbimage, fd);
 
-    /* Read IRAF image one line at a time if physical and image dimensions differ */
+    /* Read IRAF image in buffered chunks of whole physical lines if the
+       physical and image dimensions differ, stripping the line padding in
+       memory; this replaces one small read plus a seek per line */
     else {
 	nbdiff = (npaxis1 - naxis1) * bytepix;
 	nbaxis = naxis1 * bytepix;
+	nbphys = npaxis1 * bytepix;
 	linebuff = image;
 	nbr = 0;
 	if (naxis2 == 1 && naxis3 > 1)
 	    naxis2 = naxis3;
-	for (i = 0; i < naxis2; i++) {
-	    nbl = fread (linebuff, 1, nbaxis, fd);
-	    nbr = nbr + nbl;
-	    fseek (fd, nbdiff, 1);
-	    linebuff = linebuff + nbaxis;
+
+	chunklines = IRAF_LINE_CHUNK / nbphys;
+	if (chunklines < 1)
+	    chunklines = 1;
+	if (chunklines > naxis2)
+	    chunklines = naxis2;
+	chunkbuff = (char *) malloc ((size_t) chunklines * nbphys);
+
+	if (chunkbuff) {
+	    for (i = 0; i < naxis2; i += nlines) {
+		nlines = naxis2 - i;
+		if (nlines > chunklines)
+		    nlines = chunklines;
+		nbl = fread (chunkbuff, 1, (size_t) nlines * nbphys, fd);
+		for (j = 0; j < nlines; j++) {
+		    nbcopy = nbl - j * nbphys;
+		    if (nbcopy > nbaxis)
+			nbcopy = nbaxis;
+		    if (nbcopy > 0) {
+			memcpy (linebuff, chunkbuff + (size_t) j * nbphys,
+				nbcopy);
+			nbr = nbr + nbcopy;
+			}
+		    linebuff = linebuff + nbaxis;
+		    }
+		}
+	    free (chunkbuff);
+	    }
+	else {
+	    /* not enough memory for the line buffer, so fall back to
+	       reading one line at a time */
+	    for (i = 0; i < naxis2; i++) {
+		nbl = fread (linebuff, 1, nbaxis, fd);
+		nbr = nbr + nbl;
+		fseek (fd, nbdiff, 1);
+		linebuff = linebuff + nbaxis;
+		}
 	    }
 	}
     fclose (fd);
@@ -1180,16 +1222,8 @@ char *string,	/* Address of starting point of bytes to swap */
 int nbytes)	/* Number of bytes to swap */
 
 {
-    char *sbyte, temp, *slast;
-
-    slast = string + nbytes;
-    sbyte = string;
-    while (sbyte < slast) {
-	temp = sbyte[0];
-	sbyte[0] = sbyte[1];
-	sbyte[1] = temp;
-	sbyte= sbyte + 2;
-	}
+    /* delegate to the vectorized byte swapping kernel */
+    ffswap2 ((short *) string, nbytes / 2);
     return;
 }
 
@@ -1202,23 +1236,8 @@ char *string,	/* Address of Integer*4 or Real*4 vector */
 int nbytes)	/* Number of bytes to reverse */
 
 {
-    char *sbyte, *slast;
-    char temp0, temp1, temp2, temp3;
-
-    slast = string + nbytes;
-    sbyte = string;
-    while (sbyte < slast) {
-	temp3 = sbyte[0];
-	temp2 = sbyte[1];
-	temp1 = sbyte[2];
-	temp0 = sbyte[3];
-	sbyte[0] = temp0;
-	sbyte[1] = temp1;
-	sbyte[2] = temp2;
-	sbyte[3] = temp3;
-	sbyte = sbyte + 4;
-	}
-
+    /* delegate to the vectorized byte swapping kernel */
+    ffswap4 ((INT32BIT *) string, nbytes / 4);
     return;
 }
 
@@ -1231,30 +1250,8 @@ char *string,	/* Address of Real*8 vector */
 int nbytes)	/* Number of bytes to reverse */
 
 {
-    char *sbyte, *slast;
-    char temp[8];
-
-    slast = string + nbytes;
-    sbyte = string;
-    while (sbyte < slast) {
-	temp[7] = sbyte[0];
-	temp[6] = sbyte[1];
-	temp[5] = sbyte[2];
-	temp[4] = sbyte[3];
-	temp[3] = sbyte[4];
-	temp[2] = sbyte[5];
-	temp[1] = sbyte[6];
-	temp[0] = sbyte[7];
-	sbyte[0] = temp[0];
-	sbyte[1] = temp[1];
-	sbyte[2] = temp[2];
-	sbyte[3] = temp[3];
-	sbyte[4] = temp[4];
-	sbyte[5] = temp[5];
-	sbyte[6] = temp[6];
-	sbyte[7] = temp[7];
-	sbyte = sbyte + 8;
-	}
+    /* delegate to the vectorized byte swapping kernel */
+    ffswap8 ((double *) string, nbytes / 8);
     return;
 }
 
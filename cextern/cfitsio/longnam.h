@@ -13,6 +13,7 @@
 #define fits_parse_range    ffrwrg
 #define fits_parse_rangell    ffrwrgll
 #define fits_open_memfile   ffomem
+#define fits_open_borrowed_memfile   ffomemro
 
 /* 
    use the following special macro to test that the fitsio.h include file
@@ -68,6 +69,7 @@
 #define fits_get_col_display_width    ffgcdw
 
 #define fits_write_record       ffprec
+#define fits_write_records      ffprecn
 #define fits_write_key          ffpky
 #define fits_write_key_unit     ffpunt
 #define fits_write_comment      ffpcom
@@ -581,7 +583,8 @@
 #define fits_compact_group      ffgtcm 
 #define fits_verify_group       ffgtvf 
 #define fits_open_group         ffgtop 
-#define fits_add_group_member   ffgtam 
+#define fits_add_group_member   ffgtam
+#define fits_add_group_members  ffgtams
 #define fits_get_num_members    ffgtnm 
 
 #define fits_get_num_groups     ffgmng 
@@ -1572,6 +1572,8 @@ int ffikey(fitsfile *fptr,    /* I - FITS file pointer  */
     (fptr->Fptr)->headend += 80; /* increment the position of the END keyword */
     (fptr->Fptr)->nextkey += 80; /* increment the pointer to next keyword */
 
+    (fptr->Fptr)->keyindexvalid = 0;   /* keyword position index is stale */
+
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -1750,6 +1752,9 @@ int ffdrec(fitsfile *fptr,   /* I - FITS file pointer  */
     }
 
     (fptr->Fptr)->headend -= 80; /* decrement the position of the END keyword */
+
+    (fptr->Fptr)->keyindexvalid = 0;   /* keyword position index is stale */
+
     return(*status);
 }
 
@@ -1,5 +1,7 @@
 /* stdlib is needed for the abs function */
 #include <stdlib.h>
+/* string is needed for the memset function */
+#include <string.h>
 /*
    The following prototype code was provided by Doug Tody, NRAO, for
    performing conversion between pixel arrays and line lists.  The
@@ -23,6 +25,33 @@ int pl_l2pi (short *ll_src, int xs, int *px_dst, int npix);
 #define max(a,b)        (((a)>(b))?(a):(b))
 #endif
 
+/*
+ * PL_RUNSCAN -- Advance ip over the run of pixels whose (clipped) value
+ * equals pv, i.e. as long as max(0,px[ip+1]) == pv and ip < xe.  Mask
+ * images are dominated by long runs, and each run pixel would otherwise
+ * take a full trip through the encoder state machine below.  The
+ * comparisons are done in fixed-size blocks with a branch-free OR
+ * reduction so that the compiler can unroll and vectorize them; a scalar
+ * loop finishes the partial block at the run boundary.  px is the
+ * unit-offset pixel array used by pl_p2li.
+ */
+static int pl_runscan (int *px, int ip, int xe, int pv)
+{
+    int t, k;
+
+    while (ip + 8 <= xe) {
+        t = 0;
+        for (k = 1; k <= 8; ++k)
+            t |= (max(0, px[ip + k]) != pv);
+        if (t)
+            break;
+        ip += 8;
+    }
+    while (ip < xe && max(0, px[ip + 1]) == pv)
+        ++ip;
+    return ip;
+}
+
 int pl_p2li (int *pxsrc, int xs, short *lldst, int npix)
 /* int *pxsrc;                      input pixel array */
 /* int xs;                          starting index in pxsrc (?) */
@@ -65,6 +94,12 @@ L110:
         if (! (ip < xe)) {
             goto L130;
         }
+        /* skip ahead over the run of pixels equal to pv; the loop body
+           below is a no-op for every such pixel */
+        ip = pl_runscan(pxsrc, ip, xe, pv);
+        if (! (ip < xe)) {
+            goto L130;
+        }
 /* Computing MAX */
         i__2 = zero, i__3 = pxsrc[ip + 1];
         nv = max(i__2,i__3);
@@ -252,11 +287,9 @@ L160:
 /* L191: */
         goto L181;
 L180:
-        i__2 = otop;
-        for (i__ = op; i__ <= i__2; ++i__) {
-            px_dst[i__] = 0;
+        /* bulk zero fill (memset is much faster than the f2c loop) */
+        memset(&px_dst[op], 0, (otop - op + 1) * sizeof(int));
 /* L200: */
-        }
 /* L201: */
         if (! (opcode == 5 && i2 == x2)) {
             goto L210;
@@ -317,11 +350,11 @@ L130:
         ;
     }
 L131:
-    i__1 = npix;
-    for (i__ = op; i__ <= i__1; ++i__) {
-        px_dst[i__] = 0;
-/* L290: */
+    if (op <= npix) {
+        /* bulk zero fill of the pixels beyond the end of the list */
+        memset(&px_dst[op], 0, (npix - op + 1) * sizeof(int));
     }
+/* L290: */
 /* L291: */
     ret_val = npix;
     goto L100;
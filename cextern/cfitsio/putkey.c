@@ -324,6 +324,100 @@ int ffprec(fitsfile *fptr,     /* I - FITS file pointer        */
     if (*status <= 0)
        (fptr->Fptr)->headend += 80;    /* update end-of-header position */
 
+    (fptr->Fptr)->keyindexvalid = 0;   /* keyword position index is stale */
+
+    return(*status);
+}
+/*-------------------------------------------------------------------------*/
+int ffprecn(fitsfile *fptr,      /* I - FITS file pointer             */
+           const char *cards[],  /* I - array of strings to be written */
+           int ncards,           /* I - number of keyword records      */
+           int *status)          /* IO - error status                  */
+/*
+  write a set of keyword records to the end of the header.  This is
+  equivalent to calling ffprec once per card, except that any required
+  header blocks are inserted up front and all the cards are committed
+  with a single ffmbyt/ffpbyt sequence, which is much faster when
+  constructing a header from scratch.
+*/
+{
+    char tcard[FLEN_CARD], *buffer;
+    size_t len, ii;
+    int jj;
+    long nblocks;
+    LONGLONG freeslots;
+
+    if (*status > 0)           /* inherit input status value if > 0 */
+        return(*status);
+
+    if (ncards <= 0)
+        return(*status);
+
+    if (fptr->HDUposition != (fptr->Fptr)->curhdu)
+        ffmahd(fptr, (fptr->HDUposition) + 1, NULL, status);
+
+    /* if the data start has been defined, make sure there are enough */
+    /* empty card slots (excluding the END card slot), inserting all the */
+    /* required header blocks in one operation; if the header is still */
+    /* open-ended then the cards may simply extend the file */
+    if ((fptr->Fptr)->datastart != DATA_UNDEFINED)
+    {
+        freeslots = ((fptr->Fptr)->datastart - (fptr->Fptr)->headend - 80) / 80;
+
+        if (freeslots < ncards)  /* insert all the required blocks at once */
+        {
+            nblocks = (long) ((ncards - freeslots + 35) / 36);
+            if (ffiblk(fptr, nblocks, 0, status) > 0)
+                return(*status);
+        }
+    }
+
+    buffer = (char *) malloc(ncards * 80);
+    if (!buffer)
+    {
+        ffpmsg("Failed to allocate memory for card buffer (ffprecn)");
+        return(*status = MEMORY_ALLOCATION);
+    }
+
+    /* sanitize and test every card before writing any of them */
+    for (jj = 0; jj < ncards; jj++)
+    {
+        strncpy(tcard,cards[jj],80);
+        tcard[80] = '\0';
+
+        len = strlen(tcard);
+
+        /* silently replace any illegal characters with a space */
+        for (ii=0; ii < len; ii++)
+            if (tcard[ii] < ' ' || tcard[ii] > 126) tcard[ii] = ' ';
+
+        for (ii=len; ii < 80; ii++)    /* fill card with spaces if necessary */
+            tcard[ii] = ' ';
+
+        for (ii=0; ii < 8; ii++)       /* make sure keyword name is uppercase */
+            tcard[ii] = toupper(tcard[ii]);
+
+        fftkey(tcard, status);    /* test keyword name contains legal chars */
+
+        memcpy(buffer + (jj * 80), tcard, 80);
+    }
+
+    if (*status > 0)
+    {
+        free(buffer);
+        return(*status);
+    }
+
+    ffmbyt(fptr, (fptr->Fptr)->headend, IGNORE_EOF, status); /* move to end */
+
+    ffpbyt(fptr, ncards * 80, buffer, status);  /* write all the cards */
+
+    if (*status <= 0)
+       (fptr->Fptr)->headend += (ncards * 80); /* update end-of-header pos */
+
+    (fptr->Fptr)->keyindexvalid = 0;   /* keyword position index is stale */
+
+    free(buffer);
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
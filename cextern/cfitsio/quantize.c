@@ -30,6 +30,20 @@
 # define SIGMA_CLIP     5.
 # define NITER          3	/* number of sigma-clipping iterations */
 
+/* On most platforms the fits_img_stats routines can optionally spread
+   their work over several threads; see fits_img_stats_set_threads at
+   the end of this file */
+#if !defined(_WIN32)
+#define HAVE_STATS_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define STATS_MAX_THREADS 16
+#define STATS_THREAD_MIN_PIX 1000000L /* min image size worth threading */
+
+static int stats_nthreads = 1;  /* no. of threads to use for statistics */
+
 static int FnMeanSigma_short(short *array, long npix, int nullcheck, 
   short nullvalue, long *ngoodpix, double *mean, double *sigma, int *status);       
 static int FnMeanSigma_int(int *array, long npix, int nullcheck,
@@ -80,6 +94,34 @@ static int quick_select_int(int arr[], int n);
 static LONGLONG quick_select_longlong(LONGLONG arr[], int n);
 static double quick_select_double(double arr[], int n);
 
+static int FnNoise5Row_short(short *rowpix, long nx, int nullcheck,
+       short nullvalue, int do_range, int *differences2, int *differences3,
+       int *differences5, short *minvalp, short *maxvalp, long *ngoodpixp,
+       double *d2, double *d3, double *d5, int *got2);
+static int FnNoise5Row_int(int *rowpix, long nx, int nullcheck,
+       int nullvalue, int do_range, LONGLONG *differences2, LONGLONG *differences3,
+       LONGLONG *differences5, int *minvalp, int *maxvalp, long *ngoodpixp,
+       double *d2, double *d3, double *d5, int *got2);
+static int FnNoise5Row_float(float *rowpix, long nx, int nullcheck,
+       float nullvalue, int do_range, float *differences2, float *differences3,
+       float *differences5, float *minvalp, float *maxvalp, long *ngoodpixp,
+       double *d2, double *d3, double *d5, int *got2);
+
+#ifdef HAVE_STATS_THREADS
+static int fits_img_stats_threaded_short(short *array, long nx, long ny,
+       int nullcheck, short nullvalue, long *ngoodpix, short *minvalue,
+       short *maxvalue, double *mean, double *sigma, double *noise2,
+       double *noise3, double *noise5, int *status);
+static int fits_img_stats_threaded_int(int *array, long nx, long ny,
+       int nullcheck, int nullvalue, long *ngoodpix, int *minvalue,
+       int *maxvalue, double *mean, double *sigma, double *noise2,
+       double *noise3, double *noise5, int *status);
+static int fits_img_stats_threaded_float(float *array, long nx, long ny,
+       int nullcheck, float nullvalue, long *ngoodpix, float *minvalue,
+       float *maxvalue, double *mean, double *sigma, double *noise2,
+       double *noise3, double *noise5, int *status);
+#endif
+
 /*---------------------------------------------------------------------------*/
 int fits_quantize_float (long row, float fdata[], long nxpix, long nypix, int nullcheck, 
 	float in_null_value, float qlevel, int dither_method, int idata[], double *bscale,
@@ -200,15 +242,32 @@ If the function value is zero, the data were not copied to idata.
             }
 
             if (row > 0) {  /* dither the values when quantizing */
-              for (i = 0;  i < nx;  i++) {
-	    
-		if (dither_method == SUBTRACTIVE_DITHER_2 && fdata[i] == 0.0) {
-		   idata[i] = ZERO_VALUE;
-		} else {
-		   idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
-		}
+              /*
+               * process the tile in segments that lie within the random
+               * number sequence, so the wrap-around logic (and the
+               * dither-method test) stay out of the inner loop and the
+               * compiler is free to vectorize the scale-and-round
+               * arithmetic
+               */
+              i = 0;
+              while (i < nx) {
+                long iend = i + (N_RANDOM - nextrand);
+                if (iend > nx) iend = nx;
+
+                if (dither_method == SUBTRACTIVE_DITHER_2) {
+                  for ( ; i < iend;  i++, nextrand++) {
+		    if (fdata[i] == 0.0) {
+		       idata[i] = ZERO_VALUE;
+		    } else {
+		       idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+		    }
+                  }
+                } else {
+                  for ( ; i < iend;  i++, nextrand++) {
+		    idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+                  }
+                }
 
-                nextrand++;
 		if (nextrand == N_RANDOM) {
                     iseed++;
 		    if (iseed == N_RANDOM) iseed = 0;
@@ -220,7 +279,7 @@ If the function value is zero, the data were not copied to idata.
        	        for (i = 0;  i < nx;  i++) {
 	            idata[i] = NINT ((fdata[i] - zeropt) / delta);
                 }
-            } 
+            }
         }
         else {
             /* data contains null values; shift the range to be */
@@ -228,19 +287,33 @@ If the function value is zero, the data were not copied to idata.
             zeropt = minval - delta * (NULL_VALUE + N_RESERVED_VALUES);
 
             if (row > 0) {  /* dither the values */
-	      for (i = 0;  i < nx;  i++) {
-                if (fdata[i] != in_null_value) {
-		    if (dither_method == SUBTRACTIVE_DITHER_2 && fdata[i] == 0.0) {
-		       idata[i] = ZERO_VALUE;
-		    } else {
-		       idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
-		    }
+              /* segmented as above to keep the wrap-around logic out
+                 of the inner loop */
+              i = 0;
+              while (i < nx) {
+                long iend = i + (N_RANDOM - nextrand);
+                if (iend > nx) iend = nx;
+
+                if (dither_method == SUBTRACTIVE_DITHER_2) {
+                  for ( ; i < iend;  i++, nextrand++) {
+                    if (fdata[i] == in_null_value) {
+                        idata[i] = NULL_VALUE;
+                    } else if (fdata[i] == 0.0) {
+                        idata[i] = ZERO_VALUE;
+                    } else {
+                        idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+                    }
+                  }
                 } else {
-                    idata[i] = NULL_VALUE;
+                  for ( ; i < iend;  i++, nextrand++) {
+                    if (fdata[i] != in_null_value) {
+                        idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+                    } else {
+                        idata[i] = NULL_VALUE;
+                    }
+                  }
                 }
 
-                /* increment the random number index, regardless */
-                nextrand++;
 		if (nextrand == N_RANDOM) {
                       iseed++;
 		      if (iseed == N_RANDOM) iseed = 0;
@@ -249,10 +322,10 @@ If the function value is zero, the data were not copied to idata.
               }
             } else {  /* do not dither the values */
 	       for (i = 0;  i < nx;  i++) {
- 
+
                  if (fdata[i] != in_null_value) {
 		    idata[i] =  NINT((fdata[i] - zeropt) / delta);
-                 } else { 
+                 } else {
                     idata[i] = NULL_VALUE;
                  }
                }
@@ -388,15 +461,32 @@ If the function value is zero, the data were not copied to idata.
             }
 
             if (row > 0) {  /* dither the values when quantizing */
-       	      for (i = 0;  i < nx;  i++) {
-
-		if (dither_method == SUBTRACTIVE_DITHER_2 && fdata[i] == 0.0) {
-		   idata[i] = ZERO_VALUE;
-		} else {
-		   idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
-		}
+              /*
+               * process the tile in segments that lie within the random
+               * number sequence, so the wrap-around logic (and the
+               * dither-method test) stay out of the inner loop and the
+               * compiler is free to vectorize the scale-and-round
+               * arithmetic
+               */
+              i = 0;
+              while (i < nx) {
+                long iend = i + (N_RANDOM - nextrand);
+                if (iend > nx) iend = nx;
+
+                if (dither_method == SUBTRACTIVE_DITHER_2) {
+                  for ( ; i < iend;  i++, nextrand++) {
+		    if (fdata[i] == 0.0) {
+		       idata[i] = ZERO_VALUE;
+		    } else {
+		       idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+		    }
+                  }
+                } else {
+                  for ( ; i < iend;  i++, nextrand++) {
+		    idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+                  }
+                }
 
-                nextrand++;
 		if (nextrand == N_RANDOM) {
                     iseed++;
 	            nextrand = (int) (fits_rand_value[iseed] * 500);
@@ -407,7 +497,7 @@ If the function value is zero, the data were not copied to idata.
        	        for (i = 0;  i < nx;  i++) {
 	            idata[i] = NINT ((fdata[i] - zeropt) / delta);
                 }
-            } 
+            }
         }
         else {
             /* data contains null values; shift the range to be */
@@ -415,29 +505,43 @@ If the function value is zero, the data were not copied to idata.
             zeropt = minval - delta * (NULL_VALUE + N_RESERVED_VALUES);
 
             if (row > 0) {  /* dither the values */
-	      for (i = 0;  i < nx;  i++) {
-                if (fdata[i] != in_null_value) {
-		    if (dither_method == SUBTRACTIVE_DITHER_2 && fdata[i] == 0.0) {
-		       idata[i] = ZERO_VALUE;
-		    } else {
-		       idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
-		    }
+              /* segmented as above to keep the wrap-around logic out
+                 of the inner loop */
+              i = 0;
+              while (i < nx) {
+                long iend = i + (N_RANDOM - nextrand);
+                if (iend > nx) iend = nx;
+
+                if (dither_method == SUBTRACTIVE_DITHER_2) {
+                  for ( ; i < iend;  i++, nextrand++) {
+                    if (fdata[i] == in_null_value) {
+                        idata[i] = NULL_VALUE;
+                    } else if (fdata[i] == 0.0) {
+                        idata[i] = ZERO_VALUE;
+                    } else {
+                        idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+                    }
+                  }
                 } else {
-                    idata[i] = NULL_VALUE;
+                  for ( ; i < iend;  i++, nextrand++) {
+                    if (fdata[i] != in_null_value) {
+                        idata[i] =  NINT((((double) fdata[i] - zeropt) / delta) + fits_rand_value[nextrand] - 0.5);
+                    } else {
+                        idata[i] = NULL_VALUE;
+                    }
+                  }
                 }
 
-                /* increment the random number index, regardless */
-                nextrand++;
 		if (nextrand == N_RANDOM) {
                         iseed++;
 	                nextrand = (int) (fits_rand_value[iseed] * 500);
-                } 
+                }
               }
             } else {  /* do not dither the values */
 	       for (i = 0;  i < nx;  i++) {
                  if (fdata[i] != in_null_value)
 		    idata[i] =  NINT((fdata[i] - zeropt) / delta);
-                 else 
+                 else
                     idata[i] = NULL_VALUE;
                }
             }
@@ -483,6 +587,26 @@ int fits_img_stats_short(short *array, /*  2 dimensional array of image pixels *
 	short minval, maxval;
 	double xmean = 0., xsigma = 0., xnoise = 0., xnoise2 = 0., xnoise3 = 0., xnoise5 = 0.;
 
+#ifdef HAVE_STATS_THREADS
+	/* for large images, compute the mean/sigma sums and the per-row
+	   noise estimates in one fused pass over parallel row segments;
+	   falls through to the serial code if this is not possible */
+	if (stats_nthreads > 1 && nx >= 9 && ny >= 2 * stats_nthreads &&
+	    (nx * ny) >= STATS_THREAD_MIN_PIX &&
+	    fits_img_stats_threaded_short(array, nx, ny, nullcheck, nullvalue,
+		ngoodpix, minvalue, maxvalue, mean, sigma, noise2, noise3,
+		noise5, status) ) {
+
+		if (noise1) {
+			FnNoise1_short(array, nx, ny, nullcheck, nullvalue,
+			  &xnoise, status);
+
+			*noise1  = xnoise;
+		}
+		return(*status);
+	}
+#endif
+
 	/* need to calculate mean and/or sigma and/or limits? */
 	if (mean || sigma ) {
 		FnMeanSigma_short(array, nx * ny, nullcheck, nullvalue, 
@@ -542,6 +666,26 @@ int fits_img_stats_int(int *array, /*  2 dimensional array of image pixels */
 	int minval, maxval;
 	double xmean = 0., xsigma = 0., xnoise = 0., xnoise2 = 0., xnoise3 = 0., xnoise5 = 0.;
 
+#ifdef HAVE_STATS_THREADS
+	/* for large images, compute the mean/sigma sums and the per-row
+	   noise estimates in one fused pass over parallel row segments;
+	   falls through to the serial code if this is not possible */
+	if (stats_nthreads > 1 && nx >= 9 && ny >= 2 * stats_nthreads &&
+	    (nx * ny) >= STATS_THREAD_MIN_PIX &&
+	    fits_img_stats_threaded_int(array, nx, ny, nullcheck, nullvalue,
+		ngoodpix, minvalue, maxvalue, mean, sigma, noise2, noise3,
+		noise5, status) ) {
+
+		if (noise1) {
+			FnNoise1_int(array, nx, ny, nullcheck, nullvalue,
+			  &xnoise, status);
+
+			*noise1  = xnoise;
+		}
+		return(*status);
+	}
+#endif
+
 	/* need to calculate mean and/or sigma and/or limits? */
 	if (mean || sigma ) {
 		FnMeanSigma_int(array, nx * ny, nullcheck, nullvalue, 
@@ -601,6 +745,26 @@ int fits_img_stats_float(float *array, /*  2 dimensional array of image pixels *
 	float minval, maxval;
 	double xmean = 0., xsigma = 0., xnoise = 0., xnoise2 = 0., xnoise3 = 0., xnoise5 = 0.;
 
+#ifdef HAVE_STATS_THREADS
+	/* for large images, compute the mean/sigma sums and the per-row
+	   noise estimates in one fused pass over parallel row segments;
+	   falls through to the serial code if this is not possible */
+	if (stats_nthreads > 1 && nx >= 9 && ny >= 2 * stats_nthreads &&
+	    (nx * ny) >= STATS_THREAD_MIN_PIX &&
+	    fits_img_stats_threaded_float(array, nx, ny, nullcheck, nullvalue,
+		ngoodpix, minvalue, maxvalue, mean, sigma, noise2, noise3,
+		noise5, status) ) {
+
+		if (noise1) {
+			FnNoise1_float(array, nx, ny, nullcheck, nullvalue,
+			  &xnoise, status);
+
+			*noise1  = xnoise;
+		}
+		return(*status);
+	}
+#endif
+
 	/* need to calculate mean and/or sigma and/or limits? */
 	if (mean || sigma ) {
 		FnMeanSigma_float(array, nx * ny, nullcheck, nullvalue, 
@@ -864,6 +1028,216 @@ Compute mean and RMS sigma of the non-null pixels in the input array.
 	return(*status);
 }
 /*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+static int FnNoise5Row_short
+       (short *rowpix,      /* I - first pixel of the image row */
+        long nx,            /* I - number of pixels in the row */
+	int nullcheck,      /* I - check for null values, if true */
+	short nullvalue,    /* I - value of null pixels, if nullcheck is true */
+	int do_range,       /* I - update the running min and max, if true */
+	int *differences2,  /* I - scratch arrays, at least nx elements each */
+	int *differences3,
+	int *differences5,
+   /* returned parameters */
+	short *minvalp,     /* IO - running minimum non-null value */
+	short *maxvalp,     /* IO - running maximum non-null value */
+	long *ngoodpixp,    /* IO - running count of good pixels */
+	double *d2,         /* O - median 2nd order difference of the row */
+	double *d3,         /* O - median 3rd order difference of the row */
+	double *d5,         /* O - median 5th order difference of the row */
+	int *got2)          /* O - set to 1 if the row produced *d2 */
+
+/*
+Compute the median absolute 2nd, 3rd and 5th order differences along one
+image row; this is the per-row step of FnNoise5_short, split out so that
+the threaded statistics routines can process rows independently.
+Returns 1 if the row produced median difference values, or 0 if it
+contained too few valid pixels.
+*/
+{
+	long ii, nvals, nvals2;
+	short v1, v2, v3, v4, v5, v6, v7, v8, v9;
+
+	*got2 = 0;
+
+
+	/***** find the first valid pixel in row */
+	ii = 0;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v1 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v1 < *minvalp) *minvalp = v1;
+		if (v1 > *maxvalp) *maxvalp = v1;
+	}
+
+	/***** find the 2nd valid pixel in row (which we will skip over) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v2 = rowpix[ii];  /* store the good pixel value */
+	
+	if (do_range) {
+		if (v2 < *minvalp) *minvalp = v2;
+		if (v2 > *maxvalp) *maxvalp = v2;
+	}
+
+	/***** find the 3rd valid pixel in row */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v3 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v3 < *minvalp) *minvalp = v3;
+		if (v3 > *maxvalp) *maxvalp = v3;
+	}
+			
+	/* find the 4nd valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v4 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v4 < *minvalp) *minvalp = v4;
+		if (v4 > *maxvalp) *maxvalp = v4;
+	}
+		
+	/* find the 5th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v5 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v5 < *minvalp) *minvalp = v5;
+		if (v5 > *maxvalp) *maxvalp = v5;
+	}
+			
+	/* find the 6th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v6 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v6 < *minvalp) *minvalp = v6;
+		if (v6 > *maxvalp) *maxvalp = v6;
+	}
+			
+	/* find the 7th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v7 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v7 < *minvalp) *minvalp = v7;
+		if (v7 > *maxvalp) *maxvalp = v7;
+	}
+			
+	/* find the 8th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v8 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v8 < *minvalp) *minvalp = v8;
+		if (v8 > *maxvalp) *maxvalp = v8;
+	}
+	/* now populate the differences arrays */
+	/* for the remaining pixels in the row */
+	nvals = 0;
+	nvals2 = 0;
+	for (ii++; ii < nx; ii++) {
+
+	    /* find the next valid pixel in row */
+                    if (nullcheck)
+	        while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	     
+	    if (ii == nx) break;  /* hit end of row */
+	    v9 = rowpix[ii];  /* store the good pixel value */
+
+	    if (do_range) {
+		if (v9 < *minvalp) *minvalp = v9;
+		if (v9 > *maxvalp) *maxvalp = v9;
+	    }
+
+	    /* construct array of absolute differences */
+
+	    if (!(v5 == v6 && v6 == v7) ) {
+	        differences2[nvals2] =  abs((int) v5 - (int) v7);
+		nvals2++;
+	    }
+
+	    if (!(v3 == v4 && v4 == v5 && v5 == v6 && v6 == v7) ) {
+	        differences3[nvals] =  abs((2 * (int) v5) - (int) v3 - (int) v7);
+	        differences5[nvals] =  abs((6 * (int) v5) - (4 * (int) v3) - (4 * (int) v7) + (int) v1 + (int) v9);
+	        nvals++;  
+	    } else {
+	        /* ignore constant background regions */
+		(*ngoodpixp)++;
+	    }
+
+	    /* shift over 1 pixel */
+	    v1 = v2;
+	    v2 = v3;
+	    v3 = v4;
+	    v4 = v5;
+	    v5 = v6;
+	    v6 = v7;
+	    v7 = v8;
+	    v8 = v9;
+        }  /* end of loop over pixels in the row */
+
+	/* compute the median diffs */
+	/* Note that there are 8 more pixel values than there are diffs values. */
+	(*ngoodpixp) += (nvals + 8);
+
+	if (nvals == 0) {
+	    return(0);  /* cannot compute medians on this row */
+	} else if (nvals == 1) {
+	    if (nvals2 == 1) {
+	        *d2 = differences2[0];
+	        *got2 = 1;
+	    }
+	        
+	    *d3 = differences3[0];
+	    *d5 = differences5[0];
+	} else {
+                    /* quick_select returns the median MUCH faster than using qsort */
+	    if (nvals2 > 1) {
+                        *d2 = quick_select_int(differences2, nvals);
+                        *got2 = 1;
+	    }
+
+                    *d3 = quick_select_int(differences3, nvals);
+                    *d5 = quick_select_int(differences5, nvals);
+	}
+
+	return(1);
+
+}
+/*--------------------------------------------------------------------------*/
 static int FnNoise5_short
        (short *array,       /*  2 dimensional array of image pixels */
         long nx,            /* number of pixels in each row of the image */
@@ -893,9 +1267,8 @@ The returned estimates are the median of the values that are computed for each
 row of the image.
 */
 {
-	long ii, jj, nrows = 0, nrows2 = 0, nvals, nvals2, ngoodpix = 0;
+	long ii, jj, nrows = 0, nrows2 = 0, ngoodpix = 0;
 	int *differences2, *differences3, *differences5;
-	short *rowpix, v1, v2, v3, v4, v5, v6, v7, v8, v9;
 	short xminval = SHRT_MAX, xmaxval = SHRT_MIN;
 	int do_range = 0;
 	double *diffs2, *diffs3, *diffs5; 
@@ -984,222 +1357,288 @@ row of the image.
 	/* loop over each row of the image */
 	for (jj=0; jj < ny; jj++) {
 
-                rowpix = array + (jj * nx); /* point to first pixel in the row */
-
-		/***** find the first valid pixel in row */
-		ii = 0;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+		double d2, d3, d5;
+		int got2;
 
-		if (ii == nx) continue;  /* hit end of row */
-		v1 = rowpix[ii];  /* store the good pixel value */
+		if (!FnNoise5Row_short(array + (jj * nx), nx, nullcheck, nullvalue,
+			do_range, differences2, differences3, differences5,
+			&xminval, &xmaxval, &ngoodpix, &d2, &d3, &d5, &got2))
+			continue;  /* row had too few valid pixels */
 
-		if (do_range) {
-			if (v1 < xminval) xminval = v1;
-			if (v1 > xmaxval) xmaxval = v1;
+		if (got2) {
+			diffs2[nrows2] = d2;
+			nrows2++;
 		}
 
-		/***** find the 2nd valid pixel in row (which we will skip over) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+		diffs3[nrows] = d3;
+		diffs5[nrows] = d5;
+		nrows++;
+	}  /* end of loop over rows */
 
-		if (ii == nx) continue;  /* hit end of row */
-		v2 = rowpix[ii];  /* store the good pixel value */
-		
-		if (do_range) {
-			if (v2 < xminval) xminval = v2;
-			if (v2 > xmaxval) xmaxval = v2;
-		}
+	    /* compute median of the values for each row */
+	if (nrows == 0) { 
+	       xnoise3 = 0;
+	       xnoise5 = 0;
+	} else if (nrows == 1) {
+	       xnoise3 = diffs3[0];
+	       xnoise5 = diffs5[0];
+	} else {	    
+	       qsort(diffs3, nrows, sizeof(double), FnCompare_double);
+	       qsort(diffs5, nrows, sizeof(double), FnCompare_double);
+	       xnoise3 =  (diffs3[(nrows - 1)/2] + diffs3[nrows/2]) / 2.;
+	       xnoise5 =  (diffs5[(nrows - 1)/2] + diffs5[nrows/2]) / 2.;
+	}
 
-		/***** find the 3rd valid pixel in row */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	if (nrows2 == 0) { 
+	       xnoise2 = 0;
+	} else if (nrows2 == 1) {
+	       xnoise2 = diffs2[0];
+	} else {	    
+	       qsort(diffs2, nrows2, sizeof(double), FnCompare_double);
+	       xnoise2 =  (diffs2[(nrows2 - 1)/2] + diffs2[nrows2/2]) / 2.;
+	}
 
-		if (ii == nx) continue;  /* hit end of row */
-		v3 = rowpix[ii];  /* store the good pixel value */
+	if (ngood)  *ngood  = ngoodpix;
+	if (minval) *minval = xminval;
+	if (maxval) *maxval = xmaxval;
+	if (noise2)  *noise2  = 1.0483579 * xnoise2;
+	if (noise3)  *noise3  = 0.6052697 * xnoise3;
+	if (noise5)  *noise5  = 0.1772048 * xnoise5;
 
-		if (do_range) {
-			if (v3 < xminval) xminval = v3;
-			if (v3 > xmaxval) xmaxval = v3;
-		}
-				
-		/* find the 4nd valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	free(diffs5);
+	free(diffs3);
+	free(diffs2);
+	free(differences5);
+	free(differences3);
+	free(differences2);
 
-		if (ii == nx) continue;  /* hit end of row */
-		v4 = rowpix[ii];  /* store the good pixel value */
+	return(*status);
+}
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+static int FnNoise5Row_int
+       (int *rowpix,      /* I - first pixel of the image row */
+        long nx,            /* I - number of pixels in the row */
+	int nullcheck,      /* I - check for null values, if true */
+	int nullvalue,    /* I - value of null pixels, if nullcheck is true */
+	int do_range,       /* I - update the running min and max, if true */
+	LONGLONG *differences2,  /* I - scratch arrays, at least nx elements each */
+	LONGLONG *differences3,
+	LONGLONG *differences5,
+   /* returned parameters */
+	int *minvalp,     /* IO - running minimum non-null value */
+	int *maxvalp,     /* IO - running maximum non-null value */
+	long *ngoodpixp,    /* IO - running count of good pixels */
+	double *d2,         /* O - median 2nd order difference of the row */
+	double *d3,         /* O - median 3rd order difference of the row */
+	double *d5,         /* O - median 5th order difference of the row */
+	int *got2)          /* O - set to 1 if the row produced *d2 */
 
-		if (do_range) {
-			if (v4 < xminval) xminval = v4;
-			if (v4 > xmaxval) xmaxval = v4;
-		}
-			
-		/* find the 5th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+/*
+Compute the median absolute 2nd, 3rd and 5th order differences along one
+image row; this is the per-row step of FnNoise5_int, split out so that
+the threaded statistics routines can process rows independently.
+Returns 1 if the row produced median difference values, or 0 if it
+contained too few valid pixels.
+*/
+{
+	long ii, nvals, nvals2;
+	LONGLONG tdiff;
+	int v1, v2, v3, v4, v5, v6, v7, v8, v9;
 
-		if (ii == nx) continue;  /* hit end of row */
-		v5 = rowpix[ii];  /* store the good pixel value */
+	*got2 = 0;
 
-		if (do_range) {
-			if (v5 < xminval) xminval = v5;
-			if (v5 > xmaxval) xmaxval = v5;
-		}
-				
-		/* find the 6th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		if (ii == nx) continue;  /* hit end of row */
-		v6 = rowpix[ii];  /* store the good pixel value */
+	/***** find the first valid pixel in row */
+	ii = 0;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		if (do_range) {
-			if (v6 < xminval) xminval = v6;
-			if (v6 > xmaxval) xmaxval = v6;
-		}
-				
-		/* find the 7th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	if (ii == nx) return(0);  /* hit end of row */
+	v1 = rowpix[ii];  /* store the good pixel value */
 
-		if (ii == nx) continue;  /* hit end of row */
-		v7 = rowpix[ii];  /* store the good pixel value */
+	if (do_range) {
+		if (v1 < *minvalp) *minvalp = v1;
+		if (v1 > *maxvalp) *maxvalp = v1;
+	}
 
-		if (do_range) {
-			if (v7 < xminval) xminval = v7;
-			if (v7 > xmaxval) xmaxval = v7;
-		}
-				
-		/* find the 8th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	/***** find the 2nd valid pixel in row (which we will skip over) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		if (ii == nx) continue;  /* hit end of row */
-		v8 = rowpix[ii];  /* store the good pixel value */
+	if (ii == nx) return(0);  /* hit end of row */
+	v2 = rowpix[ii];  /* store the good pixel value */
+	
+	if (do_range) {
+		if (v2 < *minvalp) *minvalp = v2;
+		if (v2 > *maxvalp) *maxvalp = v2;
+	}
 
-		if (do_range) {
-			if (v8 < xminval) xminval = v8;
-			if (v8 > xmaxval) xmaxval = v8;
-		}
-		/* now populate the differences arrays */
-		/* for the remaining pixels in the row */
-		nvals = 0;
-		nvals2 = 0;
-		for (ii++; ii < nx; ii++) {
+	/***** find the 3rd valid pixel in row */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		    /* find the next valid pixel in row */
-                    if (nullcheck)
-		        while (ii < nx && rowpix[ii] == nullvalue) ii++;
-		     
-		    if (ii == nx) break;  /* hit end of row */
-		    v9 = rowpix[ii];  /* store the good pixel value */
+	if (ii == nx) return(0);  /* hit end of row */
+	v3 = rowpix[ii];  /* store the good pixel value */
 
-		    if (do_range) {
-			if (v9 < xminval) xminval = v9;
-			if (v9 > xmaxval) xmaxval = v9;
-		    }
+	if (do_range) {
+		if (v3 < *minvalp) *minvalp = v3;
+		if (v3 > *maxvalp) *maxvalp = v3;
+	}
+			
+	/* find the 4nd valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		    /* construct array of absolute differences */
+	if (ii == nx) return(0);  /* hit end of row */
+	v4 = rowpix[ii];  /* store the good pixel value */
 
-		    if (!(v5 == v6 && v6 == v7) ) {
-		        differences2[nvals2] =  abs((int) v5 - (int) v7);
-			nvals2++;
-		    }
+	if (do_range) {
+		if (v4 < *minvalp) *minvalp = v4;
+		if (v4 > *maxvalp) *maxvalp = v4;
+	}
+		
+	/* find the 5th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		    if (!(v3 == v4 && v4 == v5 && v5 == v6 && v6 == v7) ) {
-		        differences3[nvals] =  abs((2 * (int) v5) - (int) v3 - (int) v7);
-		        differences5[nvals] =  abs((6 * (int) v5) - (4 * (int) v3) - (4 * (int) v7) + (int) v1 + (int) v9);
-		        nvals++;  
-		    } else {
-		        /* ignore constant background regions */
-			ngoodpix++;
-		    }
+	if (ii == nx) return(0);  /* hit end of row */
+	v5 = rowpix[ii];  /* store the good pixel value */
 
-		    /* shift over 1 pixel */
-		    v1 = v2;
-		    v2 = v3;
-		    v3 = v4;
-		    v4 = v5;
-		    v5 = v6;
-		    v6 = v7;
-		    v7 = v8;
-		    v8 = v9;
-	        }  /* end of loop over pixels in the row */
+	if (do_range) {
+		if (v5 < *minvalp) *minvalp = v5;
+		if (v5 > *maxvalp) *maxvalp = v5;
+	}
+			
+	/* find the 6th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		/* compute the median diffs */
-		/* Note that there are 8 more pixel values than there are diffs values. */
-		ngoodpix += (nvals + 8);
+	if (ii == nx) return(0);  /* hit end of row */
+	v6 = rowpix[ii];  /* store the good pixel value */
 
-		if (nvals == 0) {
-		    continue;  /* cannot compute medians on this row */
-		} else if (nvals == 1) {
-		    if (nvals2 == 1) {
-		        diffs2[nrows2] = differences2[0];
-			nrows2++;
-		    }
-		        
-		    diffs3[nrows] = differences3[0];
-		    diffs5[nrows] = differences5[0];
-		} else {
-                    /* quick_select returns the median MUCH faster than using qsort */
-		    if (nvals2 > 1) {
-                        diffs2[nrows2] = quick_select_int(differences2, nvals);
-			nrows2++;
-		    }
-
-                    diffs3[nrows] = quick_select_int(differences3, nvals);
-                    diffs5[nrows] = quick_select_int(differences5, nvals);
-		}
+	if (do_range) {
+		if (v6 < *minvalp) *minvalp = v6;
+		if (v6 > *maxvalp) *maxvalp = v6;
+	}
+			
+	/* find the 7th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-		nrows++;
-	}  /* end of loop over rows */
+	if (ii == nx) return(0);  /* hit end of row */
+	v7 = rowpix[ii];  /* store the good pixel value */
 
-	    /* compute median of the values for each row */
-	if (nrows == 0) { 
-	       xnoise3 = 0;
-	       xnoise5 = 0;
-	} else if (nrows == 1) {
-	       xnoise3 = diffs3[0];
-	       xnoise5 = diffs5[0];
-	} else {	    
-	       qsort(diffs3, nrows, sizeof(double), FnCompare_double);
-	       qsort(diffs5, nrows, sizeof(double), FnCompare_double);
-	       xnoise3 =  (diffs3[(nrows - 1)/2] + diffs3[nrows/2]) / 2.;
-	       xnoise5 =  (diffs5[(nrows - 1)/2] + diffs5[nrows/2]) / 2.;
+	if (do_range) {
+		if (v7 < *minvalp) *minvalp = v7;
+		if (v7 > *maxvalp) *maxvalp = v7;
 	}
+			
+	/* find the 8th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
 
-	if (nrows2 == 0) { 
-	       xnoise2 = 0;
-	} else if (nrows2 == 1) {
-	       xnoise2 = diffs2[0];
-	} else {	    
-	       qsort(diffs2, nrows2, sizeof(double), FnCompare_double);
-	       xnoise2 =  (diffs2[(nrows2 - 1)/2] + diffs2[nrows2/2]) / 2.;
+	if (ii == nx) return(0);  /* hit end of row */
+	v8 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v8 < *minvalp) *minvalp = v8;
+		if (v8 > *maxvalp) *maxvalp = v8;
 	}
+	/* now populate the differences arrays */
+	/* for the remaining pixels in the row */
+	nvals = 0;
+	nvals2 = 0;
+	for (ii++; ii < nx; ii++) {
 
-	if (ngood)  *ngood  = ngoodpix;
-	if (minval) *minval = xminval;
-	if (maxval) *maxval = xmaxval;
-	if (noise2)  *noise2  = 1.0483579 * xnoise2;
-	if (noise3)  *noise3  = 0.6052697 * xnoise3;
-	if (noise5)  *noise5  = 0.1772048 * xnoise5;
+	    /* find the next valid pixel in row */
+                    if (nullcheck)
+	        while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	     
+	    if (ii == nx) break;  /* hit end of row */
+	    v9 = rowpix[ii];  /* store the good pixel value */
+
+	    if (do_range) {
+		if (v9 < *minvalp) *minvalp = v9;
+		if (v9 > *maxvalp) *maxvalp = v9;
+	    }
 
-	free(diffs5);
-	free(diffs3);
-	free(diffs2);
-	free(differences5);
-	free(differences3);
-	free(differences2);
+	    /* construct array of absolute differences */
+
+	    if (!(v5 == v6 && v6 == v7) ) {
+	        tdiff =  (LONGLONG) v5 - (LONGLONG) v7;
+		if (tdiff < 0)
+	            differences2[nvals2] =  -1 * tdiff;
+		else
+	            differences2[nvals2] =  tdiff;
+
+		nvals2++;
+	    }
+
+	    if (!(v3 == v4 && v4 == v5 && v5 == v6 && v6 == v7) ) {
+	        tdiff =  (2 * (LONGLONG) v5) - (LONGLONG) v3 - (LONGLONG) v7;
+		if (tdiff < 0)
+	            differences3[nvals] =  -1 * tdiff;
+		else
+	            differences3[nvals] =  tdiff;
+
+	        tdiff =  (6 * (LONGLONG) v5) - (4 * (LONGLONG) v3) - (4 * (LONGLONG) v7) + (LONGLONG) v1 + (LONGLONG) v9;
+		if (tdiff < 0)
+	            differences5[nvals] =  -1 * tdiff;
+		else
+	            differences5[nvals] =  tdiff;
+
+	        nvals++;  
+	    } else {
+	        /* ignore constant background regions */
+		(*ngoodpixp)++;
+	    }
+
+	    /* shift over 1 pixel */
+	    v1 = v2;
+	    v2 = v3;
+	    v3 = v4;
+	    v4 = v5;
+	    v5 = v6;
+	    v6 = v7;
+	    v7 = v8;
+	    v8 = v9;
+        }  /* end of loop over pixels in the row */
+
+	/* compute the median diffs */
+	/* Note that there are 8 more pixel values than there are diffs values. */
+	(*ngoodpixp) += (nvals + 8);
+
+	if (nvals == 0) {
+	    return(0);  /* cannot compute medians on this row */
+	} else if (nvals == 1) {
+	    if (nvals2 == 1) {
+	        *d2 = (double) differences2[0];
+	        *got2 = 1;
+	    }
+	        
+	    *d3 = (double) differences3[0];
+	    *d5 = (double) differences5[0];
+	} else {
+                    /* quick_select returns the median MUCH faster than using qsort */
+	    if (nvals2 > 1) {
+                        *d2 = (double) quick_select_longlong(differences2, nvals);
+                        *got2 = 1;
+	    }
+
+                    *d3 = (double) quick_select_longlong(differences3, nvals);
+                    *d5 = (double) quick_select_longlong(differences5, nvals);
+	}
+
+	return(1);
 
-	return(*status);
 }
 /*--------------------------------------------------------------------------*/
 static int FnNoise5_int
@@ -1231,9 +1670,8 @@ The returned estimates are the median of the values that are computed for each
 row of the image.
 */
 {
-	long ii, jj, nrows = 0, nrows2 = 0, nvals, nvals2, ngoodpix = 0;
-	LONGLONG *differences2, *differences3, *differences5, tdiff;
-	int *rowpix, v1, v2, v3, v4, v5, v6, v7, v8, v9;
+	long ii, jj, nrows = 0, nrows2 = 0, ngoodpix = 0;
+	LONGLONG *differences2, *differences3, *differences5;
 	int xminval = INT_MAX, xmaxval = INT_MIN;
 	int do_range = 0;
 	double *diffs2, *diffs3, *diffs5; 
@@ -1322,196 +1760,21 @@ row of the image.
 	/* loop over each row of the image */
 	for (jj=0; jj < ny; jj++) {
 
-                rowpix = array + (jj * nx); /* point to first pixel in the row */
-
-		/***** find the first valid pixel in row */
-		ii = 0;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v1 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v1 < xminval) xminval = v1;
-			if (v1 > xmaxval) xmaxval = v1;
-		}
-
-		/***** find the 2nd valid pixel in row (which we will skip over) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v2 = rowpix[ii];  /* store the good pixel value */
-		
-		if (do_range) {
-			if (v2 < xminval) xminval = v2;
-			if (v2 > xmaxval) xmaxval = v2;
-		}
-
-		/***** find the 3rd valid pixel in row */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v3 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v3 < xminval) xminval = v3;
-			if (v3 > xmaxval) xmaxval = v3;
-		}
-				
-		/* find the 4nd valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v4 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v4 < xminval) xminval = v4;
-			if (v4 > xmaxval) xmaxval = v4;
-		}
-			
-		/* find the 5th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v5 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v5 < xminval) xminval = v5;
-			if (v5 > xmaxval) xmaxval = v5;
-		}
-				
-		/* find the 6th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v6 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v6 < xminval) xminval = v6;
-			if (v6 > xmaxval) xmaxval = v6;
-		}
-				
-		/* find the 7th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v7 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v7 < xminval) xminval = v7;
-			if (v7 > xmaxval) xmaxval = v7;
-		}
-				
-		/* find the 8th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v8 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v8 < xminval) xminval = v8;
-			if (v8 > xmaxval) xmaxval = v8;
-		}
-		/* now populate the differences arrays */
-		/* for the remaining pixels in the row */
-		nvals = 0;
-		nvals2 = 0;
-		for (ii++; ii < nx; ii++) {
-
-		    /* find the next valid pixel in row */
-                    if (nullcheck)
-		        while (ii < nx && rowpix[ii] == nullvalue) ii++;
-		     
-		    if (ii == nx) break;  /* hit end of row */
-		    v9 = rowpix[ii];  /* store the good pixel value */
-
-		    if (do_range) {
-			if (v9 < xminval) xminval = v9;
-			if (v9 > xmaxval) xmaxval = v9;
-		    }
-
-		    /* construct array of absolute differences */
-
-		    if (!(v5 == v6 && v6 == v7) ) {
-		        tdiff =  (LONGLONG) v5 - (LONGLONG) v7;
-			if (tdiff < 0)
-		            differences2[nvals2] =  -1 * tdiff;
-			else
-		            differences2[nvals2] =  tdiff;
-
-			nvals2++;
-		    }
-
-		    if (!(v3 == v4 && v4 == v5 && v5 == v6 && v6 == v7) ) {
-		        tdiff =  (2 * (LONGLONG) v5) - (LONGLONG) v3 - (LONGLONG) v7;
-			if (tdiff < 0)
-		            differences3[nvals] =  -1 * tdiff;
-			else
-		            differences3[nvals] =  tdiff;
-
-		        tdiff =  (6 * (LONGLONG) v5) - (4 * (LONGLONG) v3) - (4 * (LONGLONG) v7) + (LONGLONG) v1 + (LONGLONG) v9;
-			if (tdiff < 0)
-		            differences5[nvals] =  -1 * tdiff;
-			else
-		            differences5[nvals] =  tdiff;
-
-		        nvals++;  
-		    } else {
-		        /* ignore constant background regions */
-			ngoodpix++;
-		    }
-
-		    /* shift over 1 pixel */
-		    v1 = v2;
-		    v2 = v3;
-		    v3 = v4;
-		    v4 = v5;
-		    v5 = v6;
-		    v6 = v7;
-		    v7 = v8;
-		    v8 = v9;
-	        }  /* end of loop over pixels in the row */
+		double d2, d3, d5;
+		int got2;
 
-		/* compute the median diffs */
-		/* Note that there are 8 more pixel values than there are diffs values. */
-		ngoodpix += (nvals + 8);
+		if (!FnNoise5Row_int(array + (jj * nx), nx, nullcheck, nullvalue,
+			do_range, differences2, differences3, differences5,
+			&xminval, &xmaxval, &ngoodpix, &d2, &d3, &d5, &got2))
+			continue;  /* row had too few valid pixels */
 
-		if (nvals == 0) {
-		    continue;  /* cannot compute medians on this row */
-		} else if (nvals == 1) {
-		    if (nvals2 == 1) {
-		        diffs2[nrows2] = (double) differences2[0];
-			nrows2++;
-		    }
-		        
-		    diffs3[nrows] = (double) differences3[0];
-		    diffs5[nrows] = (double) differences5[0];
-		} else {
-                    /* quick_select returns the median MUCH faster than using qsort */
-		    if (nvals2 > 1) {
-                        diffs2[nrows2] = (double) quick_select_longlong(differences2, nvals);
+		if (got2) {
+			diffs2[nrows2] = d2;
 			nrows2++;
-		    }
-
-                    diffs3[nrows] = (double) quick_select_longlong(differences3, nvals);
-                    diffs5[nrows] = (double) quick_select_longlong(differences5, nvals);
 		}
 
+		diffs3[nrows] = d3;
+		diffs5[nrows] = d5;
 		nrows++;
 	}  /* end of loop over rows */
 
@@ -1555,6 +1818,216 @@ row of the image.
 	return(*status);
 }
 /*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+static int FnNoise5Row_float
+       (float *rowpix,      /* I - first pixel of the image row */
+        long nx,            /* I - number of pixels in the row */
+	int nullcheck,      /* I - check for null values, if true */
+	float nullvalue,    /* I - value of null pixels, if nullcheck is true */
+	int do_range,       /* I - update the running min and max, if true */
+	float *differences2,  /* I - scratch arrays, at least nx elements each */
+	float *differences3,
+	float *differences5,
+   /* returned parameters */
+	float *minvalp,     /* IO - running minimum non-null value */
+	float *maxvalp,     /* IO - running maximum non-null value */
+	long *ngoodpixp,    /* IO - running count of good pixels */
+	double *d2,         /* O - median 2nd order difference of the row */
+	double *d3,         /* O - median 3rd order difference of the row */
+	double *d5,         /* O - median 5th order difference of the row */
+	int *got2)          /* O - set to 1 if the row produced *d2 */
+
+/*
+Compute the median absolute 2nd, 3rd and 5th order differences along one
+image row; this is the per-row step of FnNoise5_float, split out so that
+the threaded statistics routines can process rows independently.
+Returns 1 if the row produced median difference values, or 0 if it
+contained too few valid pixels.
+*/
+{
+	long ii, nvals, nvals2;
+	float v1, v2, v3, v4, v5, v6, v7, v8, v9;
+
+	*got2 = 0;
+
+
+	/***** find the first valid pixel in row */
+	ii = 0;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v1 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v1 < *minvalp) *minvalp = v1;
+		if (v1 > *maxvalp) *maxvalp = v1;
+	}
+
+	/***** find the 2nd valid pixel in row (which we will skip over) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v2 = rowpix[ii];  /* store the good pixel value */
+	
+	if (do_range) {
+		if (v2 < *minvalp) *minvalp = v2;
+		if (v2 > *maxvalp) *maxvalp = v2;
+	}
+
+	/***** find the 3rd valid pixel in row */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v3 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v3 < *minvalp) *minvalp = v3;
+		if (v3 > *maxvalp) *maxvalp = v3;
+	}
+			
+	/* find the 4nd valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v4 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v4 < *minvalp) *minvalp = v4;
+		if (v4 > *maxvalp) *maxvalp = v4;
+	}
+		
+	/* find the 5th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v5 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v5 < *minvalp) *minvalp = v5;
+		if (v5 > *maxvalp) *maxvalp = v5;
+	}
+			
+	/* find the 6th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v6 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v6 < *minvalp) *minvalp = v6;
+		if (v6 > *maxvalp) *maxvalp = v6;
+	}
+			
+	/* find the 7th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v7 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v7 < *minvalp) *minvalp = v7;
+		if (v7 > *maxvalp) *maxvalp = v7;
+	}
+			
+	/* find the 8th valid pixel in row (to be skipped) */
+	ii++;
+	if (nullcheck)
+	    while (ii < nx && rowpix[ii] == nullvalue) ii++;
+
+	if (ii == nx) return(0);  /* hit end of row */
+	v8 = rowpix[ii];  /* store the good pixel value */
+
+	if (do_range) {
+		if (v8 < *minvalp) *minvalp = v8;
+		if (v8 > *maxvalp) *maxvalp = v8;
+	}
+	/* now populate the differences arrays */
+	/* for the remaining pixels in the row */
+	nvals = 0;
+	nvals2 = 0;
+	for (ii++; ii < nx; ii++) {
+
+	    /* find the next valid pixel in row */
+                    if (nullcheck)
+	        while (ii < nx && rowpix[ii] == nullvalue) ii++;
+	     
+	    if (ii == nx) break;  /* hit end of row */
+	    v9 = rowpix[ii];  /* store the good pixel value */
+
+	    if (do_range) {
+		if (v9 < *minvalp) *minvalp = v9;
+		if (v9 > *maxvalp) *maxvalp = v9;
+	    }
+
+	    /* construct array of absolute differences */
+
+	    if (!(v5 == v6 && v6 == v7) ) {
+	        differences2[nvals2] = (float) fabs(v5 - v7);
+		nvals2++;
+	    }
+
+	    if (!(v3 == v4 && v4 == v5 && v5 == v6 && v6 == v7) ) {
+	        differences3[nvals] = (float) fabs((2 * v5) - v3 - v7);
+	        differences5[nvals] = (float) fabs((6 * v5) - (4 * v3) - (4 * v7) + v1 + v9);
+	        nvals++;  
+	    } else {
+	        /* ignore constant background regions */
+		(*ngoodpixp)++;
+	    }
+
+	    /* shift over 1 pixel */
+	    v1 = v2;
+	    v2 = v3;
+	    v3 = v4;
+	    v4 = v5;
+	    v5 = v6;
+	    v6 = v7;
+	    v7 = v8;
+	    v8 = v9;
+        }  /* end of loop over pixels in the row */
+
+	/* compute the median diffs */
+	/* Note that there are 8 more pixel values than there are diffs values. */
+	(*ngoodpixp) += (nvals + 8);
+
+	if (nvals == 0) {
+	    return(0);  /* cannot compute medians on this row */
+	} else if (nvals == 1) {
+	    if (nvals2 == 1) {
+	        *d2 = differences2[0];
+	        *got2 = 1;
+	    }
+	        
+	    *d3 = differences3[0];
+	    *d5 = differences5[0];
+	} else {
+                    /* quick_select returns the median MUCH faster than using qsort */
+	    if (nvals2 > 1) {
+                        *d2 = quick_select_float(differences2, nvals);
+                        *got2 = 1;
+	    }
+
+                    *d3 = quick_select_float(differences3, nvals);
+                    *d5 = quick_select_float(differences5, nvals);
+	}
+
+	return(1);
+
+}
+/*--------------------------------------------------------------------------*/
 static int FnNoise5_float
        (float *array,       /*  2 dimensional array of image pixels */
         long nx,            /* number of pixels in each row of the image */
@@ -1584,9 +2057,8 @@ The returned estimates are the median of the values that are computed for each
 row of the image.
 */
 {
-	long ii, jj, nrows = 0, nrows2 = 0, nvals, nvals2, ngoodpix = 0;
+	long ii, jj, nrows = 0, nrows2 = 0, ngoodpix = 0;
 	float *differences2, *differences3, *differences5;
-	float *rowpix, v1, v2, v3, v4, v5, v6, v7, v8, v9;
 	float xminval = FLT_MAX, xmaxval = -FLT_MAX;
 	int do_range = 0;
 	double *diffs2, *diffs3, *diffs5; 
@@ -1623,233 +2095,73 @@ row of the image.
 	if (minval || maxval) do_range = 1;
 	
         /* allocate arrays used to compute the median and noise estimates */
-	differences2 = calloc(nx, sizeof(float));
-	if (!differences2) {
-        	*status = MEMORY_ALLOCATION;
-		return(*status);
-	}
-	differences3 = calloc(nx, sizeof(float));
-	if (!differences3) {
-		free(differences2);
-        	*status = MEMORY_ALLOCATION;
-		return(*status);
-	}
-	differences5 = calloc(nx, sizeof(float));
-	if (!differences5) {
-		free(differences2);
-		free(differences3);
-        	*status = MEMORY_ALLOCATION;
-		return(*status);
-	}
-
-	diffs2 = calloc(ny, sizeof(double));
-	if (!diffs2) {
-		free(differences2);
-		free(differences3);
-		free(differences5);
-        	*status = MEMORY_ALLOCATION;
-		return(*status);
-	}
-
-	diffs3 = calloc(ny, sizeof(double));
-	if (!diffs3) {
-		free(differences2);
-		free(differences3);
-		free(differences5);
-		free(diffs2);
-        	*status = MEMORY_ALLOCATION;
-		return(*status);
-	}
-
-	diffs5 = calloc(ny, sizeof(double));
-	if (!diffs5) {
-		free(differences2);
-		free(differences3);
-		free(differences5);
-		free(diffs2);
-		free(diffs3);
-        	*status = MEMORY_ALLOCATION;
-		return(*status);
-	}
-
-	/* loop over each row of the image */
-	for (jj=0; jj < ny; jj++) {
-
-                rowpix = array + (jj * nx); /* point to first pixel in the row */
-
-		/***** find the first valid pixel in row */
-		ii = 0;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v1 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v1 < xminval) xminval = v1;
-			if (v1 > xmaxval) xmaxval = v1;
-		}
-
-		/***** find the 2nd valid pixel in row (which we will skip over) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v2 = rowpix[ii];  /* store the good pixel value */
-		
-		if (do_range) {
-			if (v2 < xminval) xminval = v2;
-			if (v2 > xmaxval) xmaxval = v2;
-		}
-
-		/***** find the 3rd valid pixel in row */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v3 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v3 < xminval) xminval = v3;
-			if (v3 > xmaxval) xmaxval = v3;
-		}
-				
-		/* find the 4nd valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v4 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v4 < xminval) xminval = v4;
-			if (v4 > xmaxval) xmaxval = v4;
-		}
-			
-		/* find the 5th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v5 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v5 < xminval) xminval = v5;
-			if (v5 > xmaxval) xmaxval = v5;
-		}
-				
-		/* find the 6th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v6 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v6 < xminval) xminval = v6;
-			if (v6 > xmaxval) xmaxval = v6;
-		}
-				
-		/* find the 7th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v7 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v7 < xminval) xminval = v7;
-			if (v7 > xmaxval) xmaxval = v7;
-		}
-				
-		/* find the 8th valid pixel in row (to be skipped) */
-		ii++;
-		if (nullcheck)
-		    while (ii < nx && rowpix[ii] == nullvalue) ii++;
-
-		if (ii == nx) continue;  /* hit end of row */
-		v8 = rowpix[ii];  /* store the good pixel value */
-
-		if (do_range) {
-			if (v8 < xminval) xminval = v8;
-			if (v8 > xmaxval) xmaxval = v8;
-		}
-		/* now populate the differences arrays */
-		/* for the remaining pixels in the row */
-		nvals = 0;
-		nvals2 = 0;
-		for (ii++; ii < nx; ii++) {
-
-		    /* find the next valid pixel in row */
-                    if (nullcheck)
-		        while (ii < nx && rowpix[ii] == nullvalue) ii++;
-		     
-		    if (ii == nx) break;  /* hit end of row */
-		    v9 = rowpix[ii];  /* store the good pixel value */
+	differences2 = calloc(nx, sizeof(float));
+	if (!differences2) {
+        	*status = MEMORY_ALLOCATION;
+		return(*status);
+	}
+	differences3 = calloc(nx, sizeof(float));
+	if (!differences3) {
+		free(differences2);
+        	*status = MEMORY_ALLOCATION;
+		return(*status);
+	}
+	differences5 = calloc(nx, sizeof(float));
+	if (!differences5) {
+		free(differences2);
+		free(differences3);
+        	*status = MEMORY_ALLOCATION;
+		return(*status);
+	}
 
-		    if (do_range) {
-			if (v9 < xminval) xminval = v9;
-			if (v9 > xmaxval) xmaxval = v9;
-		    }
+	diffs2 = calloc(ny, sizeof(double));
+	if (!diffs2) {
+		free(differences2);
+		free(differences3);
+		free(differences5);
+        	*status = MEMORY_ALLOCATION;
+		return(*status);
+	}
 
-		    /* construct array of absolute differences */
+	diffs3 = calloc(ny, sizeof(double));
+	if (!diffs3) {
+		free(differences2);
+		free(differences3);
+		free(differences5);
+		free(diffs2);
+        	*status = MEMORY_ALLOCATION;
+		return(*status);
+	}
 
-		    if (!(v5 == v6 && v6 == v7) ) {
-		        differences2[nvals2] = (float) fabs(v5 - v7);
-			nvals2++;
-		    }
+	diffs5 = calloc(ny, sizeof(double));
+	if (!diffs5) {
+		free(differences2);
+		free(differences3);
+		free(differences5);
+		free(diffs2);
+		free(diffs3);
+        	*status = MEMORY_ALLOCATION;
+		return(*status);
+	}
 
-		    if (!(v3 == v4 && v4 == v5 && v5 == v6 && v6 == v7) ) {
-		        differences3[nvals] = (float) fabs((2 * v5) - v3 - v7);
-		        differences5[nvals] = (float) fabs((6 * v5) - (4 * v3) - (4 * v7) + v1 + v9);
-		        nvals++;  
-		    } else {
-		        /* ignore constant background regions */
-			ngoodpix++;
-		    }
+	/* loop over each row of the image */
+	for (jj=0; jj < ny; jj++) {
 
-		    /* shift over 1 pixel */
-		    v1 = v2;
-		    v2 = v3;
-		    v3 = v4;
-		    v4 = v5;
-		    v5 = v6;
-		    v6 = v7;
-		    v7 = v8;
-		    v8 = v9;
-	        }  /* end of loop over pixels in the row */
+		double d2, d3, d5;
+		int got2;
 
-		/* compute the median diffs */
-		/* Note that there are 8 more pixel values than there are diffs values. */
-		ngoodpix += (nvals + 8);
+		if (!FnNoise5Row_float(array + (jj * nx), nx, nullcheck, nullvalue,
+			do_range, differences2, differences3, differences5,
+			&xminval, &xmaxval, &ngoodpix, &d2, &d3, &d5, &got2))
+			continue;  /* row had too few valid pixels */
 
-		if (nvals == 0) {
-		    continue;  /* cannot compute medians on this row */
-		} else if (nvals == 1) {
-		    if (nvals2 == 1) {
-		        diffs2[nrows2] = differences2[0];
-			nrows2++;
-		    }
-		        
-		    diffs3[nrows] = differences3[0];
-		    diffs5[nrows] = differences5[0];
-		} else {
-                    /* quick_select returns the median MUCH faster than using qsort */
-		    if (nvals2 > 1) {
-                        diffs2[nrows2] = quick_select_float(differences2, nvals);
+		if (got2) {
+			diffs2[nrows2] = d2;
 			nrows2++;
-		    }
-
-                    diffs3[nrows] = quick_select_float(differences3, nvals);
-                    diffs5[nrows] = quick_select_float(differences5, nvals);
 		}
 
+		diffs3[nrows] = d3;
+		diffs5[nrows] = d5;
 		nrows++;
 	}  /* end of loop over rows */
 
@@ -3917,4 +4229,836 @@ static double quick_select_double(double arr[], int n)
 
 #undef ELEM_SWAP
 
+#ifdef HAVE_STATS_THREADS
+/*--------------------------------------------------------------------------*/
+typedef struct {  /* fused statistics work for one segment of image rows */
+	short *array;       /* the whole image */
+	long nx;            /* length of each row */
+	long jfirst, jlast; /* range of rows covered by this slice */
+	int nullcheck;
+	short nullvalue;
+	int do_sums;        /* accumulate the mean/sigma sums? */
+	int do_noise;       /* compute the per-row noise differences? */
+	int *differences2, *differences3, *differences5;  /* private scratch */
+	double *diffs2, *diffs3, *diffs5;   /* shared per-row median differences */
+	char *has2, *has3;                  /* shared per-row validity flags */
+	long ngood_ms;      /* good pixels, as counted for mean and sigma */
+	double sum, sum2;
+	long ngood_n5;      /* good pixels, as counted by FnNoise5 */
+	short minval, maxval;
+} statsslice_short;
+
+static void *stats_run_short(void *arg)
+{
+	statsslice_short *slice = (statsslice_short *) arg;
+	short *rowpix;
+	long ii, jj;
+	double xtemp, d2, d3, d5;
+	int got2;
+
+	for (jj = slice->jfirst; jj < slice->jlast; jj++) {
+
+		rowpix = slice->array + (jj * slice->nx);
+
+		if (slice->do_sums) {
+		    if (slice->nullcheck) {
+			for (ii = 0; ii < slice->nx; ii++) {
+			    if (rowpix[ii] != slice->nullvalue) {
+				slice->ngood_ms++;
+				xtemp = (double) rowpix[ii];
+				slice->sum += xtemp;
+				slice->sum2 += (xtemp * xtemp);
+			    }
+			}
+		    } else {
+			slice->ngood_ms += slice->nx;
+			for (ii = 0; ii < slice->nx; ii++) {
+			    xtemp = (double) rowpix[ii];
+			    slice->sum += xtemp;
+			    slice->sum2 += (xtemp * xtemp);
+			}
+		    }
+		}
+
+		if (slice->do_noise) {
+		    if (FnNoise5Row_short(rowpix, slice->nx, slice->nullcheck,
+			slice->nullvalue, 1, slice->differences2,
+			slice->differences3, slice->differences5,
+			&slice->minval, &slice->maxval, &slice->ngood_n5,
+			&d2, &d3, &d5, &got2)) {
+
+			slice->diffs3[jj] = d3;
+			slice->diffs5[jj] = d5;
+			slice->has3[jj] = 1;
+			if (got2) {
+			    slice->diffs2[jj] = d2;
+			    slice->has2[jj] = 1;
+			}
+		    }
+		}
+	}
+	return(NULL);
+}
+/*--------------------------------------------------------------------------*/
+static int fits_img_stats_threaded_short(short *array, long nx, long ny,
+	int nullcheck, short nullvalue, long *ngoodpix, short *minvalue,
+	short *maxvalue, double *mean, double *sigma, double *noise2,
+	double *noise3, double *noise5, int *status)
+
+/*
+Compute the image statistics in one fused pass over parallel row
+segments: each thread accumulates the mean/sigma sums and the per-row
+noise differences for its rows, and the partial results are merged
+here.  The noise estimates, limits and good pixel counts are identical
+to the serial code; the mean and sigma may differ in the last bit
+because the sums are accumulated per segment.  Returns 1 if the
+statistics were computed, or 0 if the caller should fall back to the
+serial code (e.g. if a memory allocation failed).
+*/
+{
+	pthread_t threads[STATS_MAX_THREADS];
+	statsslice_short slice[STATS_MAX_THREADS];
+	double *diffs2 = 0, *diffs3 = 0, *diffs5 = 0;
+	char *has2 = 0, *has3 = 0;
+	double sum = 0., sum2 = 0., xtemp;
+	double xnoise2 = 0, xnoise3 = 0, xnoise5 = 0;
+	long jj, ngood_ms = 0, ngood_n5 = 0, nrows = 0, nrows2 = 0, perthread;
+	short minval = SHRT_MAX, maxval = SHRT_MIN;
+	int ii, idx, nthreads, ok = 1;
+	int do_sums, do_noise;
+
+	do_sums = (mean || sigma) ? 1 : 0;
+	do_noise = (minvalue || maxvalue || noise3) ? 1 : 0;
+
+	if (!do_sums && !do_noise)
+		return(0);  /* nothing here to compute */
+
+	nthreads = stats_nthreads;
+	if (nthreads > STATS_MAX_THREADS) nthreads = STATS_MAX_THREADS;
+	if (nthreads > ny) nthreads = (int) ny;
+
+	if (do_noise) {
+		diffs2 = calloc(ny, sizeof(double));
+		diffs3 = calloc(ny, sizeof(double));
+		diffs5 = calloc(ny, sizeof(double));
+		has2 = calloc(ny, 1);
+		has3 = calloc(ny, 1);
+		if (!diffs2 || !diffs3 || !diffs5 || !has2 || !has3) ok = 0;
+	}
+
+	for (ii = 0; ii < nthreads; ii++) {
+		slice[ii].differences2 = 0;
+		slice[ii].differences3 = 0;
+		slice[ii].differences5 = 0;
+	}
+
+	perthread = (ny + nthreads - 1) / nthreads;
+
+	for (ii = 0; ii < nthreads && ok; ii++) {
+		slice[ii].array = array;
+		slice[ii].nx = nx;
+		slice[ii].jfirst = ii * perthread;
+		if (slice[ii].jfirst > ny) slice[ii].jfirst = ny;
+		slice[ii].jlast = slice[ii].jfirst + perthread;
+		if (slice[ii].jlast > ny) slice[ii].jlast = ny;
+		slice[ii].nullcheck = nullcheck;
+		slice[ii].nullvalue = nullvalue;
+		slice[ii].do_sums = do_sums;
+		slice[ii].do_noise = do_noise;
+		slice[ii].diffs2 = diffs2;
+		slice[ii].diffs3 = diffs3;
+		slice[ii].diffs5 = diffs5;
+		slice[ii].has2 = has2;
+		slice[ii].has3 = has3;
+		slice[ii].ngood_ms = 0;
+		slice[ii].sum = 0.;
+		slice[ii].sum2 = 0.;
+		slice[ii].ngood_n5 = 0;
+		slice[ii].minval = SHRT_MAX;
+		slice[ii].maxval = SHRT_MIN;
+
+		if (do_noise) {
+			slice[ii].differences2 = calloc(nx, sizeof(int));
+			slice[ii].differences3 = calloc(nx, sizeof(int));
+			slice[ii].differences5 = calloc(nx, sizeof(int));
+			if (!slice[ii].differences2 || !slice[ii].differences3 ||
+			    !slice[ii].differences5) ok = 0;
+		}
+	}
+
+	if (ok) {
+		for (idx = 0; idx < nthreads; idx++) {
+			/* the last slice runs on the calling thread; if a
+			   worker cannot be created, run its slice here too */
+			if (idx == nthreads - 1 ||
+			    pthread_create(&threads[idx], NULL, stats_run_short,
+					   &slice[idx]) != 0) {
+				threads[idx] = pthread_self();
+				stats_run_short(&slice[idx]);
+			}
+		}
+
+		for (idx = 0; idx < nthreads; idx++) {
+			if (!pthread_equal(threads[idx], pthread_self()))
+				pthread_join(threads[idx], NULL);
+		}
+
+		/* merge the partial results, in slice order */
+		for (idx = 0; idx < nthreads; idx++) {
+			ngood_ms += slice[idx].ngood_ms;
+			sum += slice[idx].sum;
+			sum2 += slice[idx].sum2;
+			ngood_n5 += slice[idx].ngood_n5;
+			if (slice[idx].minval < minval) minval = slice[idx].minval;
+			if (slice[idx].maxval > maxval) maxval = slice[idx].maxval;
+		}
+	}
+
+	for (ii = 0; ii < nthreads; ii++) {
+		if (slice[ii].differences2) free(slice[ii].differences2);
+		if (slice[ii].differences3) free(slice[ii].differences3);
+		if (slice[ii].differences5) free(slice[ii].differences5);
+	}
+
+	if (!ok) {
+		if (diffs2) free(diffs2);
+		if (diffs3) free(diffs3);
+		if (diffs5) free(diffs5);
+		if (has2) free(has2);
+		if (has3) free(has3);
+		return(0);
+	}
+
+	if (do_sums) {
+		/* this duplicates the tail of FnMeanSigma_short */
+		if (ngood_ms > 1) {
+			if (ngoodpix) *ngoodpix = ngood_ms;
+			xtemp = sum / ngood_ms;
+			if (mean)     *mean = xtemp;
+			if (sigma)    *sigma = sqrt((sum2 / ngood_ms) - (xtemp * xtemp));
+		} else if (ngood_ms == 1){
+			if (ngoodpix) *ngoodpix = 1;
+			if (mean)     *mean = sum;
+			if (sigma)    *sigma = 0.0;
+		} else {
+			if (ngoodpix) *ngoodpix = 0;
+			if (mean)     *mean = 0.;
+			if (sigma)    *sigma = 0.;
+		}
+	}
+
+	if (do_noise) {
+		/* compact the per-row values, preserving row order */
+		for (jj = 0; jj < ny; jj++) {
+			if (has2[jj]) {
+				diffs2[nrows2] = diffs2[jj];
+				nrows2++;
+			}
+			if (has3[jj]) {
+				diffs3[nrows] = diffs3[jj];
+				diffs5[nrows] = diffs5[jj];
+				nrows++;
+			}
+		}
+
+		/* this duplicates the tail of FnNoise5_short */
+		if (nrows == 0) {
+		       xnoise3 = 0;
+		       xnoise5 = 0;
+		} else if (nrows == 1) {
+		       xnoise3 = diffs3[0];
+		       xnoise5 = diffs5[0];
+		} else {
+		       qsort(diffs3, nrows, sizeof(double), FnCompare_double);
+		       qsort(diffs5, nrows, sizeof(double), FnCompare_double);
+		       xnoise3 =  (diffs3[(nrows - 1)/2] + diffs3[nrows/2]) / 2.;
+		       xnoise5 =  (diffs5[(nrows - 1)/2] + diffs5[nrows/2]) / 2.;
+		}
+
+		if (nrows2 == 0) {
+		       xnoise2 = 0;
+		} else if (nrows2 == 1) {
+		       xnoise2 = diffs2[0];
+		} else {
+		       qsort(diffs2, nrows2, sizeof(double), FnCompare_double);
+		       xnoise2 =  (diffs2[(nrows2 - 1)/2] + diffs2[nrows2/2]) / 2.;
+		}
+
+		if (ngoodpix) *ngoodpix = ngood_n5;
+		if (minvalue) *minvalue = minval;
+		if (maxvalue) *maxvalue = maxval;
+		if (noise2)  *noise2  = 1.0483579 * xnoise2;
+		if (noise3)  *noise3  = 0.6052697 * xnoise3;
+		if (noise5)  *noise5  = 0.1772048 * xnoise5;
+	}
+
+	if (diffs2) free(diffs2);
+	if (diffs3) free(diffs3);
+	if (diffs5) free(diffs5);
+	if (has2) free(has2);
+	if (has3) free(has3);
+
+	return(1);
+}
+/*--------------------------------------------------------------------------*/
+typedef struct {  /* fused statistics work for one segment of image rows */
+	int *array;       /* the whole image */
+	long nx;            /* length of each row */
+	long jfirst, jlast; /* range of rows covered by this slice */
+	int nullcheck;
+	int nullvalue;
+	int do_sums;        /* accumulate the mean/sigma sums? */
+	int do_noise;       /* compute the per-row noise differences? */
+	LONGLONG *differences2, *differences3, *differences5;  /* private scratch */
+	double *diffs2, *diffs3, *diffs5;   /* shared per-row median differences */
+	char *has2, *has3;                  /* shared per-row validity flags */
+	long ngood_ms;      /* good pixels, as counted for mean and sigma */
+	double sum, sum2;
+	long ngood_n5;      /* good pixels, as counted by FnNoise5 */
+	int minval, maxval;
+} statsslice_int;
+
+static void *stats_run_int(void *arg)
+{
+	statsslice_int *slice = (statsslice_int *) arg;
+	int *rowpix;
+	long ii, jj;
+	double xtemp, d2, d3, d5;
+	int got2;
+
+	for (jj = slice->jfirst; jj < slice->jlast; jj++) {
+
+		rowpix = slice->array + (jj * slice->nx);
+
+		if (slice->do_sums) {
+		    if (slice->nullcheck) {
+			for (ii = 0; ii < slice->nx; ii++) {
+			    if (rowpix[ii] != slice->nullvalue) {
+				slice->ngood_ms++;
+				xtemp = (double) rowpix[ii];
+				slice->sum += xtemp;
+				slice->sum2 += (xtemp * xtemp);
+			    }
+			}
+		    } else {
+			slice->ngood_ms += slice->nx;
+			for (ii = 0; ii < slice->nx; ii++) {
+			    xtemp = (double) rowpix[ii];
+			    slice->sum += xtemp;
+			    slice->sum2 += (xtemp * xtemp);
+			}
+		    }
+		}
+
+		if (slice->do_noise) {
+		    if (FnNoise5Row_int(rowpix, slice->nx, slice->nullcheck,
+			slice->nullvalue, 1, slice->differences2,
+			slice->differences3, slice->differences5,
+			&slice->minval, &slice->maxval, &slice->ngood_n5,
+			&d2, &d3, &d5, &got2)) {
+
+			slice->diffs3[jj] = d3;
+			slice->diffs5[jj] = d5;
+			slice->has3[jj] = 1;
+			if (got2) {
+			    slice->diffs2[jj] = d2;
+			    slice->has2[jj] = 1;
+			}
+		    }
+		}
+	}
+	return(NULL);
+}
+/*--------------------------------------------------------------------------*/
+static int fits_img_stats_threaded_int(int *array, long nx, long ny,
+	int nullcheck, int nullvalue, long *ngoodpix, int *minvalue,
+	int *maxvalue, double *mean, double *sigma, double *noise2,
+	double *noise3, double *noise5, int *status)
+
+/*
+Compute the image statistics in one fused pass over parallel row
+segments: each thread accumulates the mean/sigma sums and the per-row
+noise differences for its rows, and the partial results are merged
+here.  The noise estimates, limits and good pixel counts are identical
+to the serial code; the mean and sigma may differ in the last bit
+because the sums are accumulated per segment.  Returns 1 if the
+statistics were computed, or 0 if the caller should fall back to the
+serial code (e.g. if a memory allocation failed).
+*/
+{
+	pthread_t threads[STATS_MAX_THREADS];
+	statsslice_int slice[STATS_MAX_THREADS];
+	double *diffs2 = 0, *diffs3 = 0, *diffs5 = 0;
+	char *has2 = 0, *has3 = 0;
+	double sum = 0., sum2 = 0., xtemp;
+	double xnoise2 = 0, xnoise3 = 0, xnoise5 = 0;
+	long jj, ngood_ms = 0, ngood_n5 = 0, nrows = 0, nrows2 = 0, perthread;
+	int minval = INT_MAX, maxval = INT_MIN;
+	int ii, idx, nthreads, ok = 1;
+	int do_sums, do_noise;
+
+	do_sums = (mean || sigma) ? 1 : 0;
+	do_noise = (minvalue || maxvalue || noise3) ? 1 : 0;
+
+	if (!do_sums && !do_noise)
+		return(0);  /* nothing here to compute */
+
+	nthreads = stats_nthreads;
+	if (nthreads > STATS_MAX_THREADS) nthreads = STATS_MAX_THREADS;
+	if (nthreads > ny) nthreads = (int) ny;
+
+	if (do_noise) {
+		diffs2 = calloc(ny, sizeof(double));
+		diffs3 = calloc(ny, sizeof(double));
+		diffs5 = calloc(ny, sizeof(double));
+		has2 = calloc(ny, 1);
+		has3 = calloc(ny, 1);
+		if (!diffs2 || !diffs3 || !diffs5 || !has2 || !has3) ok = 0;
+	}
+
+	for (ii = 0; ii < nthreads; ii++) {
+		slice[ii].differences2 = 0;
+		slice[ii].differences3 = 0;
+		slice[ii].differences5 = 0;
+	}
+
+	perthread = (ny + nthreads - 1) / nthreads;
+
+	for (ii = 0; ii < nthreads && ok; ii++) {
+		slice[ii].array = array;
+		slice[ii].nx = nx;
+		slice[ii].jfirst = ii * perthread;
+		if (slice[ii].jfirst > ny) slice[ii].jfirst = ny;
+		slice[ii].jlast = slice[ii].jfirst + perthread;
+		if (slice[ii].jlast > ny) slice[ii].jlast = ny;
+		slice[ii].nullcheck = nullcheck;
+		slice[ii].nullvalue = nullvalue;
+		slice[ii].do_sums = do_sums;
+		slice[ii].do_noise = do_noise;
+		slice[ii].diffs2 = diffs2;
+		slice[ii].diffs3 = diffs3;
+		slice[ii].diffs5 = diffs5;
+		slice[ii].has2 = has2;
+		slice[ii].has3 = has3;
+		slice[ii].ngood_ms = 0;
+		slice[ii].sum = 0.;
+		slice[ii].sum2 = 0.;
+		slice[ii].ngood_n5 = 0;
+		slice[ii].minval = INT_MAX;
+		slice[ii].maxval = INT_MIN;
+
+		if (do_noise) {
+			slice[ii].differences2 = calloc(nx, sizeof(LONGLONG));
+			slice[ii].differences3 = calloc(nx, sizeof(LONGLONG));
+			slice[ii].differences5 = calloc(nx, sizeof(LONGLONG));
+			if (!slice[ii].differences2 || !slice[ii].differences3 ||
+			    !slice[ii].differences5) ok = 0;
+		}
+	}
+
+	if (ok) {
+		for (idx = 0; idx < nthreads; idx++) {
+			/* the last slice runs on the calling thread; if a
+			   worker cannot be created, run its slice here too */
+			if (idx == nthreads - 1 ||
+			    pthread_create(&threads[idx], NULL, stats_run_int,
+					   &slice[idx]) != 0) {
+				threads[idx] = pthread_self();
+				stats_run_int(&slice[idx]);
+			}
+		}
+
+		for (idx = 0; idx < nthreads; idx++) {
+			if (!pthread_equal(threads[idx], pthread_self()))
+				pthread_join(threads[idx], NULL);
+		}
+
+		/* merge the partial results, in slice order */
+		for (idx = 0; idx < nthreads; idx++) {
+			ngood_ms += slice[idx].ngood_ms;
+			sum += slice[idx].sum;
+			sum2 += slice[idx].sum2;
+			ngood_n5 += slice[idx].ngood_n5;
+			if (slice[idx].minval < minval) minval = slice[idx].minval;
+			if (slice[idx].maxval > maxval) maxval = slice[idx].maxval;
+		}
+	}
+
+	for (ii = 0; ii < nthreads; ii++) {
+		if (slice[ii].differences2) free(slice[ii].differences2);
+		if (slice[ii].differences3) free(slice[ii].differences3);
+		if (slice[ii].differences5) free(slice[ii].differences5);
+	}
+
+	if (!ok) {
+		if (diffs2) free(diffs2);
+		if (diffs3) free(diffs3);
+		if (diffs5) free(diffs5);
+		if (has2) free(has2);
+		if (has3) free(has3);
+		return(0);
+	}
+
+	if (do_sums) {
+		/* this duplicates the tail of FnMeanSigma_int */
+		if (ngood_ms > 1) {
+			if (ngoodpix) *ngoodpix = ngood_ms;
+			xtemp = sum / ngood_ms;
+			if (mean)     *mean = xtemp;
+			if (sigma)    *sigma = sqrt((sum2 / ngood_ms) - (xtemp * xtemp));
+		} else if (ngood_ms == 1){
+			if (ngoodpix) *ngoodpix = 1;
+			if (mean)     *mean = sum;
+			if (sigma)    *sigma = 0.0;
+		} else {
+			if (ngoodpix) *ngoodpix = 0;
+			if (mean)     *mean = 0.;
+			if (sigma)    *sigma = 0.;
+		}
+	}
+
+	if (do_noise) {
+		/* compact the per-row values, preserving row order */
+		for (jj = 0; jj < ny; jj++) {
+			if (has2[jj]) {
+				diffs2[nrows2] = diffs2[jj];
+				nrows2++;
+			}
+			if (has3[jj]) {
+				diffs3[nrows] = diffs3[jj];
+				diffs5[nrows] = diffs5[jj];
+				nrows++;
+			}
+		}
+
+		/* this duplicates the tail of FnNoise5_int */
+		if (nrows == 0) {
+		       xnoise3 = 0;
+		       xnoise5 = 0;
+		} else if (nrows == 1) {
+		       xnoise3 = diffs3[0];
+		       xnoise5 = diffs5[0];
+		} else {
+		       qsort(diffs3, nrows, sizeof(double), FnCompare_double);
+		       qsort(diffs5, nrows, sizeof(double), FnCompare_double);
+		       xnoise3 =  (diffs3[(nrows - 1)/2] + diffs3[nrows/2]) / 2.;
+		       xnoise5 =  (diffs5[(nrows - 1)/2] + diffs5[nrows/2]) / 2.;
+		}
+
+		if (nrows2 == 0) {
+		       xnoise2 = 0;
+		} else if (nrows2 == 1) {
+		       xnoise2 = diffs2[0];
+		} else {
+		       qsort(diffs2, nrows2, sizeof(double), FnCompare_double);
+		       xnoise2 =  (diffs2[(nrows2 - 1)/2] + diffs2[nrows2/2]) / 2.;
+		}
+
+		if (ngoodpix) *ngoodpix = ngood_n5;
+		if (minvalue) *minvalue = minval;
+		if (maxvalue) *maxvalue = maxval;
+		if (noise2)  *noise2  = 1.0483579 * xnoise2;
+		if (noise3)  *noise3  = 0.6052697 * xnoise3;
+		if (noise5)  *noise5  = 0.1772048 * xnoise5;
+	}
+
+	if (diffs2) free(diffs2);
+	if (diffs3) free(diffs3);
+	if (diffs5) free(diffs5);
+	if (has2) free(has2);
+	if (has3) free(has3);
+
+	return(1);
+}
+/*--------------------------------------------------------------------------*/
+typedef struct {  /* fused statistics work for one segment of image rows */
+	float *array;       /* the whole image */
+	long nx;            /* length of each row */
+	long jfirst, jlast; /* range of rows covered by this slice */
+	int nullcheck;
+	float nullvalue;
+	int do_sums;        /* accumulate the mean/sigma sums? */
+	int do_noise;       /* compute the per-row noise differences? */
+	float *differences2, *differences3, *differences5;  /* private scratch */
+	double *diffs2, *diffs3, *diffs5;   /* shared per-row median differences */
+	char *has2, *has3;                  /* shared per-row validity flags */
+	long ngood_ms;      /* good pixels, as counted for mean and sigma */
+	double sum, sum2;
+	long ngood_n5;      /* good pixels, as counted by FnNoise5 */
+	float minval, maxval;
+} statsslice_float;
+
+static void *stats_run_float(void *arg)
+{
+	statsslice_float *slice = (statsslice_float *) arg;
+	float *rowpix;
+	long ii, jj;
+	double xtemp, d2, d3, d5;
+	int got2;
+
+	for (jj = slice->jfirst; jj < slice->jlast; jj++) {
+
+		rowpix = slice->array + (jj * slice->nx);
+
+		if (slice->do_sums) {
+		    if (slice->nullcheck) {
+			for (ii = 0; ii < slice->nx; ii++) {
+			    if (rowpix[ii] != slice->nullvalue) {
+				slice->ngood_ms++;
+				xtemp = (double) rowpix[ii];
+				slice->sum += xtemp;
+				slice->sum2 += (xtemp * xtemp);
+			    }
+			}
+		    } else {
+			slice->ngood_ms += slice->nx;
+			for (ii = 0; ii < slice->nx; ii++) {
+			    xtemp = (double) rowpix[ii];
+			    slice->sum += xtemp;
+			    slice->sum2 += (xtemp * xtemp);
+			}
+		    }
+		}
+
+		if (slice->do_noise) {
+		    if (FnNoise5Row_float(rowpix, slice->nx, slice->nullcheck,
+			slice->nullvalue, 1, slice->differences2,
+			slice->differences3, slice->differences5,
+			&slice->minval, &slice->maxval, &slice->ngood_n5,
+			&d2, &d3, &d5, &got2)) {
+
+			slice->diffs3[jj] = d3;
+			slice->diffs5[jj] = d5;
+			slice->has3[jj] = 1;
+			if (got2) {
+			    slice->diffs2[jj] = d2;
+			    slice->has2[jj] = 1;
+			}
+		    }
+		}
+	}
+	return(NULL);
+}
+/*--------------------------------------------------------------------------*/
+static int fits_img_stats_threaded_float(float *array, long nx, long ny,
+	int nullcheck, float nullvalue, long *ngoodpix, float *minvalue,
+	float *maxvalue, double *mean, double *sigma, double *noise2,
+	double *noise3, double *noise5, int *status)
+
+/*
+Compute the image statistics in one fused pass over parallel row
+segments: each thread accumulates the mean/sigma sums and the per-row
+noise differences for its rows, and the partial results are merged
+here.  The noise estimates, limits and good pixel counts are identical
+to the serial code; the mean and sigma may differ in the last bit
+because the sums are accumulated per segment.  Returns 1 if the
+statistics were computed, or 0 if the caller should fall back to the
+serial code (e.g. if a memory allocation failed).
+*/
+{
+	pthread_t threads[STATS_MAX_THREADS];
+	statsslice_float slice[STATS_MAX_THREADS];
+	double *diffs2 = 0, *diffs3 = 0, *diffs5 = 0;
+	char *has2 = 0, *has3 = 0;
+	double sum = 0., sum2 = 0., xtemp;
+	double xnoise2 = 0, xnoise3 = 0, xnoise5 = 0;
+	long jj, ngood_ms = 0, ngood_n5 = 0, nrows = 0, nrows2 = 0, perthread;
+	float minval = FLT_MAX, maxval = -FLT_MAX;
+	int ii, idx, nthreads, ok = 1;
+	int do_sums, do_noise;
+
+	do_sums = (mean || sigma) ? 1 : 0;
+	do_noise = (minvalue || maxvalue || noise3) ? 1 : 0;
+
+	if (!do_sums && !do_noise)
+		return(0);  /* nothing here to compute */
+
+	nthreads = stats_nthreads;
+	if (nthreads > STATS_MAX_THREADS) nthreads = STATS_MAX_THREADS;
+	if (nthreads > ny) nthreads = (int) ny;
+
+	if (do_noise) {
+		diffs2 = calloc(ny, sizeof(double));
+		diffs3 = calloc(ny, sizeof(double));
+		diffs5 = calloc(ny, sizeof(double));
+		has2 = calloc(ny, 1);
+		has3 = calloc(ny, 1);
+		if (!diffs2 || !diffs3 || !diffs5 || !has2 || !has3) ok = 0;
+	}
+
+	for (ii = 0; ii < nthreads; ii++) {
+		slice[ii].differences2 = 0;
+		slice[ii].differences3 = 0;
+		slice[ii].differences5 = 0;
+	}
+
+	perthread = (ny + nthreads - 1) / nthreads;
+
+	for (ii = 0; ii < nthreads && ok; ii++) {
+		slice[ii].array = array;
+		slice[ii].nx = nx;
+		slice[ii].jfirst = ii * perthread;
+		if (slice[ii].jfirst > ny) slice[ii].jfirst = ny;
+		slice[ii].jlast = slice[ii].jfirst + perthread;
+		if (slice[ii].jlast > ny) slice[ii].jlast = ny;
+		slice[ii].nullcheck = nullcheck;
+		slice[ii].nullvalue = nullvalue;
+		slice[ii].do_sums = do_sums;
+		slice[ii].do_noise = do_noise;
+		slice[ii].diffs2 = diffs2;
+		slice[ii].diffs3 = diffs3;
+		slice[ii].diffs5 = diffs5;
+		slice[ii].has2 = has2;
+		slice[ii].has3 = has3;
+		slice[ii].ngood_ms = 0;
+		slice[ii].sum = 0.;
+		slice[ii].sum2 = 0.;
+		slice[ii].ngood_n5 = 0;
+		slice[ii].minval = FLT_MAX;
+		slice[ii].maxval = -FLT_MAX;
+
+		if (do_noise) {
+			slice[ii].differences2 = calloc(nx, sizeof(float));
+			slice[ii].differences3 = calloc(nx, sizeof(float));
+			slice[ii].differences5 = calloc(nx, sizeof(float));
+			if (!slice[ii].differences2 || !slice[ii].differences3 ||
+			    !slice[ii].differences5) ok = 0;
+		}
+	}
+
+	if (ok) {
+		for (idx = 0; idx < nthreads; idx++) {
+			/* the last slice runs on the calling thread; if a
+			   worker cannot be created, run its slice here too */
+			if (idx == nthreads - 1 ||
+			    pthread_create(&threads[idx], NULL, stats_run_float,
+					   &slice[idx]) != 0) {
+				threads[idx] = pthread_self();
+				stats_run_float(&slice[idx]);
+			}
+		}
 
+		for (idx = 0; idx < nthreads; idx++) {
+			if (!pthread_equal(threads[idx], pthread_self()))
+				pthread_join(threads[idx], NULL);
+		}
+
+		/* merge the partial results, in slice order */
+		for (idx = 0; idx < nthreads; idx++) {
+			ngood_ms += slice[idx].ngood_ms;
+			sum += slice[idx].sum;
+			sum2 += slice[idx].sum2;
+			ngood_n5 += slice[idx].ngood_n5;
+			if (slice[idx].minval < minval) minval = slice[idx].minval;
+			if (slice[idx].maxval > maxval) maxval = slice[idx].maxval;
+		}
+	}
+
+	for (ii = 0; ii < nthreads; ii++) {
+		if (slice[ii].differences2) free(slice[ii].differences2);
+		if (slice[ii].differences3) free(slice[ii].differences3);
+		if (slice[ii].differences5) free(slice[ii].differences5);
+	}
+
+	if (!ok) {
+		if (diffs2) free(diffs2);
+		if (diffs3) free(diffs3);
+		if (diffs5) free(diffs5);
+		if (has2) free(has2);
+		if (has3) free(has3);
+		return(0);
+	}
+
+	if (do_sums) {
+		/* this duplicates the tail of FnMeanSigma_float */
+		if (ngood_ms > 1) {
+			if (ngoodpix) *ngoodpix = ngood_ms;
+			xtemp = sum / ngood_ms;
+			if (mean)     *mean = xtemp;
+			if (sigma)    *sigma = sqrt((sum2 / ngood_ms) - (xtemp * xtemp));
+		} else if (ngood_ms == 1){
+			if (ngoodpix) *ngoodpix = 1;
+			if (mean)     *mean = sum;
+			if (sigma)    *sigma = 0.0;
+		} else {
+			if (ngoodpix) *ngoodpix = 0;
+			if (mean)     *mean = 0.;
+			if (sigma)    *sigma = 0.;
+		}
+	}
+
+	if (do_noise) {
+		/* compact the per-row values, preserving row order */
+		for (jj = 0; jj < ny; jj++) {
+			if (has2[jj]) {
+				diffs2[nrows2] = diffs2[jj];
+				nrows2++;
+			}
+			if (has3[jj]) {
+				diffs3[nrows] = diffs3[jj];
+				diffs5[nrows] = diffs5[jj];
+				nrows++;
+			}
+		}
+
+		/* this duplicates the tail of FnNoise5_float */
+		if (nrows == 0) {
+		       xnoise3 = 0;
+		       xnoise5 = 0;
+		} else if (nrows == 1) {
+		       xnoise3 = diffs3[0];
+		       xnoise5 = diffs5[0];
+		} else {
+		       qsort(diffs3, nrows, sizeof(double), FnCompare_double);
+		       qsort(diffs5, nrows, sizeof(double), FnCompare_double);
+		       xnoise3 =  (diffs3[(nrows - 1)/2] + diffs3[nrows/2]) / 2.;
+		       xnoise5 =  (diffs5[(nrows - 1)/2] + diffs5[nrows/2]) / 2.;
+		}
+
+		if (nrows2 == 0) {
+		       xnoise2 = 0;
+		} else if (nrows2 == 1) {
+		       xnoise2 = diffs2[0];
+		} else {
+		       qsort(diffs2, nrows2, sizeof(double), FnCompare_double);
+		       xnoise2 =  (diffs2[(nrows2 - 1)/2] + diffs2[nrows2/2]) / 2.;
+		}
+
+		if (ngoodpix) *ngoodpix = ngood_n5;
+		if (minvalue) *minvalue = minval;
+		if (maxvalue) *maxvalue = maxval;
+		if (noise2)  *noise2  = 1.0483579 * xnoise2;
+		if (noise3)  *noise3  = 0.6052697 * xnoise3;
+		if (noise5)  *noise5  = 0.1772048 * xnoise5;
+	}
+
+	if (diffs2) free(diffs2);
+	if (diffs3) free(diffs3);
+	if (diffs5) free(diffs5);
+	if (has2) free(has2);
+	if (has3) free(has3);
+
+	return(1);
+}
+#endif  /* HAVE_STATS_THREADS */
+/*--------------------------------------------------------------------------*/
+int fits_img_stats_set_threads(int nthreads)
+/*
+   Set the number of threads used by the fits_img_stats routines to
+   compute the image statistics: 1 disables threading and 0 means one
+   thread per processor.  Returns the effective setting.
+*/
+{
+#ifdef HAVE_STATS_THREADS
+    if (nthreads < 0) nthreads = 1;
+    if (nthreads == 0) {
+	long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = (nproc > 0) ? (int) nproc : 1;
+    }
+    if (nthreads > STATS_MAX_THREADS) nthreads = STATS_MAX_THREADS;
+    stats_nthreads = nthreads;
+#else
+    stats_nthreads = 1;
+#endif
+    return(stats_nthreads);
+}
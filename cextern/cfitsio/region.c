@@ -640,77 +640,49 @@ error:
 }
 
 /*---------------------------------------------------------------------------*/
-int fits_in_region( double    X,
+static int fits_in_shape( double    X,
             double    Y,
-            SAORegion *Rgn )
-/*  Test if the given point is within the region described by Rgn.  X and    */
-/*  Y are in pixel coordinates.                                              */
+            RgnShape *Shapes )
+/*  Test if the given point is within the single shape pointed to by        */
+/*  Shapes, ignoring its include/exclude sign.  The shape must have been    */
+/*  through fits_setup_shape so that its derived quantities are valid.      */
 /*---------------------------------------------------------------------------*/
 {
    double x, y, dx, dy, xprime, yprime, r, th;
-   RgnShape *Shapes;
-   int i, cur_comp;
-   int result, comp_result;
+   int result;
 
-   Shapes = Rgn->Shapes;
+   result = 1;
 
-   result = 0;
-   comp_result = 0;
-   cur_comp = Rgn->Shapes[0].comp;
+   switch( Shapes->shape ) {
 
-   for( i=0; i<Rgn->nShapes; i++, Shapes++ ) {
+   case box_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
 
-     /* if this region has a different component number to the last one  */
-     /*	then replace the accumulated selection logical with the union of */
-     /*	the current logical and the total logical. Reinitialize the      */
-     /* temporary logical.                                               */
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
 
-     if ( i==0 || Shapes->comp != cur_comp ) {
-       result = result || comp_result;
-       cur_comp = Shapes->comp;
-       /* if an excluded region is given first, then implicitly   */
-       /* assume a previous shape that includes the entire image. */
-       comp_result = !Shapes->sign;
-     }
-
-    /* only need to test if  */
-    /*   the point is not already included and this is an include region, */
-    /* or the point is included and this is an excluded region */
-
-    if ( (!comp_result && Shapes->sign) || (comp_result && !Shapes->sign) ) { 
-
-      comp_result = 1;
-
-      switch( Shapes->shape ) {
-
-      case box_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
-
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
-
-         dx = 0.5 * Shapes->param.gen.p[2];
-         dy = 0.5 * Shapes->param.gen.p[3];
-         if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) )
-            comp_result = 0;
-         break;
+      dx = 0.5 * Shapes->param.gen.p[2];
+      dy = 0.5 * Shapes->param.gen.p[3];
+      if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) )
+         result = 0;
+      break;
 
-      case boxannulus_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
+   case boxannulus_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
 
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
 
-         dx = 0.5 * Shapes->param.gen.p[4];
-         dy = 0.5 * Shapes->param.gen.p[5];
-         if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) ) {
-	   comp_result = 0;
+      dx = 0.5 * Shapes->param.gen.p[4];
+      dy = 0.5 * Shapes->param.gen.p[5];
+      if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) ) {
+	   result = 0;
 	 } else {
 	   /* Repeat test for inner box */
 	   x =  xprime * Shapes->param.gen.b + yprime * Shapes->param.gen.a;
@@ -719,251 +691,295 @@ int fits_in_region( double    X,
 	   dx = 0.5 * Shapes->param.gen.p[2];
 	   dy = 0.5 * Shapes->param.gen.p[3];
 	   if( (x >= -dx) && (x <= dx) && (y >= -dy) && (y <= dy) )
-	     comp_result = 0;
+	     result = 0;
 	 }
-         break;
-
-      case rectangle_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[5];
-         yprime = Y - Shapes->param.gen.p[6];
-
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
-
-         dx = Shapes->param.gen.a;
-         dy = Shapes->param.gen.b;
-         if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) )
-            comp_result = 0;
-         break;
-
-      case diamond_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
-
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
-
-         dx = 0.5 * Shapes->param.gen.p[2];
-         dy = 0.5 * Shapes->param.gen.p[3];
-         r  = fabs(x/dx) + fabs(y/dy);
-         if( r > 1 )
-            comp_result = 0;
-         break;
-
-      case circle_rgn:
-         /*  Shift origin to center of region  */
-         x = X - Shapes->param.gen.p[0];
-         y = Y - Shapes->param.gen.p[1];
-
-         r  = x*x + y*y;
-         if ( r > Shapes->param.gen.a )
-            comp_result = 0;
-         break;
-
-      case annulus_rgn:
-         /*  Shift origin to center of region  */
-         x = X - Shapes->param.gen.p[0];
-         y = Y - Shapes->param.gen.p[1];
+      break;
 
-         r = x*x + y*y;
-         if ( r < Shapes->param.gen.a || r > Shapes->param.gen.b )
-            comp_result = 0;
-         break;
-
-      case sector_rgn:
-         /*  Shift origin to center of region  */
-         x = X - Shapes->param.gen.p[0];
-         y = Y - Shapes->param.gen.p[1];
-
-         if( x || y ) {
-            r = atan2( y, x ) * RadToDeg;
-            if( Shapes->param.gen.p[2] <= Shapes->param.gen.p[3] ) {
-               if( r < Shapes->param.gen.p[2] || r > Shapes->param.gen.p[3] )
-                  comp_result = 0;
-            } else {
-               if( r < Shapes->param.gen.p[2] && r > Shapes->param.gen.p[3] )
-                  comp_result = 0;
-            }
+   case rectangle_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[5];
+      yprime = Y - Shapes->param.gen.p[6];
+
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+
+      dx = Shapes->param.gen.a;
+      dy = Shapes->param.gen.b;
+      if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) )
+         result = 0;
+      break;
+
+   case diamond_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
+
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+
+      dx = 0.5 * Shapes->param.gen.p[2];
+      dy = 0.5 * Shapes->param.gen.p[3];
+      r  = fabs(x/dx) + fabs(y/dy);
+      if( r > 1 )
+         result = 0;
+      break;
+
+   case circle_rgn:
+      /*  Shift origin to center of region  */
+      x = X - Shapes->param.gen.p[0];
+      y = Y - Shapes->param.gen.p[1];
+
+      r  = x*x + y*y;
+      if ( r > Shapes->param.gen.a )
+         result = 0;
+      break;
+
+   case annulus_rgn:
+      /*  Shift origin to center of region  */
+      x = X - Shapes->param.gen.p[0];
+      y = Y - Shapes->param.gen.p[1];
+
+      r = x*x + y*y;
+      if ( r < Shapes->param.gen.a || r > Shapes->param.gen.b )
+         result = 0;
+      break;
+
+   case sector_rgn:
+      /*  Shift origin to center of region  */
+      x = X - Shapes->param.gen.p[0];
+      y = Y - Shapes->param.gen.p[1];
+
+      if( x || y ) {
+         r = atan2( y, x ) * RadToDeg;
+         if( Shapes->param.gen.p[2] <= Shapes->param.gen.p[3] ) {
+            if( r < Shapes->param.gen.p[2] || r > Shapes->param.gen.p[3] )
+               result = 0;
+         } else {
+            if( r < Shapes->param.gen.p[2] && r > Shapes->param.gen.p[3] )
+               result = 0;
          }
-         break;
+      }
+      break;
 
-      case ellipse_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
+   case ellipse_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
 
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+
+      x /= Shapes->param.gen.p[2];
+      y /= Shapes->param.gen.p[3];
+      r = x*x + y*y;
+      if( r>1.0 )
+         result = 0;
+      break;
+
+   case elliptannulus_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
+
+      /*  Rotate point to outer ellipse's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+
+      x /= Shapes->param.gen.p[4];
+      y /= Shapes->param.gen.p[5];
+      r = x*x + y*y;
+      if( r>1.0 )
+         result = 0;
+      else {
+         /*  Repeat test for inner ellipse  */
+         x =  xprime * Shapes->param.gen.b + yprime * Shapes->param.gen.a;
+         y = -xprime * Shapes->param.gen.a + yprime * Shapes->param.gen.b;
 
          x /= Shapes->param.gen.p[2];
          y /= Shapes->param.gen.p[3];
          r = x*x + y*y;
-         if( r>1.0 )
-            comp_result = 0;
-         break;
+         if( r<1.0 )
+            result = 0;
+      }
+      break;
 
-      case elliptannulus_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
+   case line_rgn:
+      /*  Shift origin to first point of line  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
 
-         /*  Rotate point to outer ellipse's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+      /*  Rotate point to line's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
 
-         x /= Shapes->param.gen.p[4];
-         y /= Shapes->param.gen.p[5];
-         r = x*x + y*y;
-         if( r>1.0 )
-            comp_result = 0;
-         else {
-            /*  Repeat test for inner ellipse  */
-            x =  xprime * Shapes->param.gen.b + yprime * Shapes->param.gen.a;
-            y = -xprime * Shapes->param.gen.a + yprime * Shapes->param.gen.b;
-
-            x /= Shapes->param.gen.p[2];
-            y /= Shapes->param.gen.p[3];
-            r = x*x + y*y;
-            if( r<1.0 )
-               comp_result = 0;
-         }
-         break;
-
-      case line_rgn:
-         /*  Shift origin to first point of line  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
-
-         /*  Rotate point to line's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
-
-         if( (y < -0.5) || (y >= 0.5) || (x < -0.5)
-             || (x >= Shapes->param.gen.a) )
-            comp_result = 0;
-         break;
-
-      case point_rgn:
-         /*  Shift origin to center of region  */
-         x = X - Shapes->param.gen.p[0];
-         y = Y - Shapes->param.gen.p[1];
-
-         if ( (x<-0.5) || (x>=0.5) || (y<-0.5) || (y>=0.5) )
-            comp_result = 0;
-         break;
-
-      case poly_rgn:
-         if( X<Shapes->xmin || X>Shapes->xmax
-             || Y<Shapes->ymin || Y>Shapes->ymax )
-            comp_result = 0;
-         else
-            comp_result = Pt_in_Poly( X, Y, Shapes->param.poly.nPts,
-                                       Shapes->param.poly.Pts );
-         break;
-
-      case panda_rgn:
-         /*  Shift origin to center of region  */
-         x = X - Shapes->param.gen.p[0];
-         y = Y - Shapes->param.gen.p[1];
+      if( (y < -0.5) || (y >= 0.5) || (x < -0.5)
+          || (x >= Shapes->param.gen.a) )
+         result = 0;
+      break;
 
-         r = x*x + y*y;
-         if ( r < Shapes->param.gen.a || r > Shapes->param.gen.b ) {
-	   comp_result = 0;
+   case point_rgn:
+      /*  Shift origin to center of region  */
+      x = X - Shapes->param.gen.p[0];
+      y = Y - Shapes->param.gen.p[1];
+
+      if ( (x<-0.5) || (x>=0.5) || (y<-0.5) || (y>=0.5) )
+         result = 0;
+      break;
+
+   case poly_rgn:
+      if( X<Shapes->xmin || X>Shapes->xmax
+          || Y<Shapes->ymin || Y>Shapes->ymax )
+         result = 0;
+      else
+         result = Pt_in_Poly( X, Y, Shapes->param.poly.nPts,
+                                    Shapes->param.poly.Pts );
+      break;
+
+   case panda_rgn:
+      /*  Shift origin to center of region  */
+      x = X - Shapes->param.gen.p[0];
+      y = Y - Shapes->param.gen.p[1];
+
+      r = x*x + y*y;
+      if ( r < Shapes->param.gen.a || r > Shapes->param.gen.b ) {
+	   result = 0;
 	 } else {
 	   if( x || y ) {
 	     th = atan2( y, x ) * RadToDeg;
 	     if( Shapes->param.gen.p[2] <= Shapes->param.gen.p[3] ) {
-               if( th < Shapes->param.gen.p[2] || th > Shapes->param.gen.p[3] )
-		 comp_result = 0;
+            if( th < Shapes->param.gen.p[2] || th > Shapes->param.gen.p[3] )
+		 result = 0;
 	     } else {
-               if( th < Shapes->param.gen.p[2] && th > Shapes->param.gen.p[3] )
-		 comp_result = 0;
+            if( th < Shapes->param.gen.p[2] && th > Shapes->param.gen.p[3] )
+		 result = 0;
 	     }
 	   }
-         }
-         break;
+      }
+      break;
 
-      case epanda_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
+   case epanda_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
 
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
 	 xprime = x;
 	 yprime = y;
 
 	 /* outer region test */
-         x = xprime/Shapes->param.gen.p[7];
-         y = yprime/Shapes->param.gen.p[8];
-         r = x*x + y*y;
+      x = xprime/Shapes->param.gen.p[7];
+      y = yprime/Shapes->param.gen.p[8];
+      r = x*x + y*y;
 	 if ( r>1.0 )
-	   comp_result = 0;
+	   result = 0;
 	 else {
 	   /* inner region test */
 	   x = xprime/Shapes->param.gen.p[5];
 	   y = yprime/Shapes->param.gen.p[6];
 	   r = x*x + y*y;
 	   if ( r<1.0 )
-	     comp_result = 0;
+	     result = 0;
 	   else {
 	     /* angle test */
 	     if( xprime || yprime ) {
 	       th = atan2( yprime, xprime ) * RadToDeg;
 	       if( Shapes->param.gen.p[2] <= Shapes->param.gen.p[3] ) {
 		 if( th < Shapes->param.gen.p[2] || th > Shapes->param.gen.p[3] )
-		   comp_result = 0;
+		   result = 0;
 	       } else {
 		 if( th < Shapes->param.gen.p[2] && th > Shapes->param.gen.p[3] )
-		   comp_result = 0;
+		   result = 0;
 	       }
 	     }
 	   }
 	 }
-         break;
+      break;
 
-      case bpanda_rgn:
-         /*  Shift origin to center of region  */
-         xprime = X - Shapes->param.gen.p[0];
-         yprime = Y - Shapes->param.gen.p[1];
+   case bpanda_rgn:
+      /*  Shift origin to center of region  */
+      xprime = X - Shapes->param.gen.p[0];
+      yprime = Y - Shapes->param.gen.p[1];
 
-         /*  Rotate point to region's orientation  */
-         x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
-         y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
+      /*  Rotate point to region's orientation  */
+      x =  xprime * Shapes->param.gen.cosT + yprime * Shapes->param.gen.sinT;
+      y = -xprime * Shapes->param.gen.sinT + yprime * Shapes->param.gen.cosT;
 
 	 /* outer box test */
-         dx = 0.5 * Shapes->param.gen.p[7];
-         dy = 0.5 * Shapes->param.gen.p[8];
-         if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) )
-	   comp_result = 0;
+      dx = 0.5 * Shapes->param.gen.p[7];
+      dy = 0.5 * Shapes->param.gen.p[8];
+      if( (x < -dx) || (x > dx) || (y < -dy) || (y > dy) )
+	   result = 0;
 	 else {
 	   /* inner box test */
 	   dx = 0.5 * Shapes->param.gen.p[5];
 	   dy = 0.5 * Shapes->param.gen.p[6];
 	   if( (x >= -dx) && (x <= dx) && (y >= -dy) && (y <= dy) )
-	     comp_result = 0;
+	     result = 0;
 	   else {
 	     /* angle test */
 	     if( x || y ) {
 	       th = atan2( y, x ) * RadToDeg;
 	       if( Shapes->param.gen.p[2] <= Shapes->param.gen.p[3] ) {
 		 if( th < Shapes->param.gen.p[2] || th > Shapes->param.gen.p[3] )
-		   comp_result = 0;
+		   result = 0;
 	       } else {
 		 if( th < Shapes->param.gen.p[2] && th > Shapes->param.gen.p[3] )
-		   comp_result = 0;
+		   result = 0;
 	       }
 	     }
 	   }
 	 }
-         break;
-      }
+      break;
+   }
+
+   return( result );
+}
+
+/*---------------------------------------------------------------------------*/
+int fits_in_region( double    X,
+            double    Y,
+            SAORegion *Rgn )
+/*  Test if the given point is within the region described by Rgn.  X and    */
+/*  Y are in pixel coordinates.                                              */
+/*---------------------------------------------------------------------------*/
+{
+   RgnShape *Shapes;
+   int i, cur_comp;
+   int result, comp_result;
+
+   Shapes = Rgn->Shapes;
+
+   result = 0;
+   comp_result = 0;
+   cur_comp = Rgn->Shapes[0].comp;
+
+   for( i=0; i<Rgn->nShapes; i++, Shapes++ ) {
+
+     /* if this region has a different component number to the last one  */
+     /*	then replace the accumulated selection logical with the union of */
+     /*	the current logical and the total logical. Reinitialize the      */
+     /* temporary logical.                                               */
+
+     if ( i==0 || Shapes->comp != cur_comp ) {
+       result = result || comp_result;
+       cur_comp = Shapes->comp;
+       /* if an excluded region is given first, then implicitly   */
+       /* assume a previous shape that includes the entire image. */
+       comp_result = !Shapes->sign;
+     }
+
+    /* only need to test if  */
+    /*   the point is not already included and this is an include region, */
+    /* or the point is included and this is an excluded region */
+
+    if ( (!comp_result && Shapes->sign) || (comp_result && !Shapes->sign) ) { 
+
+      comp_result = fits_in_shape( X, Y, Shapes );
 
       if( !Shapes->sign ) comp_result = !comp_result;
 
@@ -972,10 +988,255 @@ int fits_in_region( double    X,
    }
 
    result = result || comp_result;
-   
+
    return( result );
 }
 
+/*---------------------------------------------------------------------------*/
+void fits_in_region_array( long      nrows,
+            const double *X,
+            const double *Y,
+            char      *inRegion,
+            SAORegion *Rgn )
+/*  Test a whole column of points against the region described by Rgn.  X   */
+/*  and Y hold nrows pixel coordinates; on return inRegion[row] is 1 if     */
+/*  that row lies within the region and 0 otherwise.  This gives the same   */
+/*  answer as calling fits_in_region once per row but works on blocks of    */
+/*  rows small enough to stay cached and tests each shape against a whole   */
+/*  block at a time.  The purely algebraic shapes get straight-line inner   */
+/*  loops: since an include shape can only select rows (OR) and an exclude  */
+/*  shape can only deselect them (AND NOT), the selection logic needs no    */
+/*  per-point branches, and using bitwise instead of short-circuit          */
+/*  operators keeps the geometry tests free of data-dependent branches      */
+/*  while giving the same results (including for NaN coordinates).  The     */
+/*  shapes needing atan2 or the polygon walk fall back on fits_in_shape     */
+/*  per row, with each shape's precomputed bounding box checked first.      */
+/*---------------------------------------------------------------------------*/
+{
+#define REGION_BLOCK_ROWS 2048
+
+   RgnShape *Shapes;
+   char comp[REGION_BLOCK_ROWS];
+   const double *Xblk, *Yblk;
+   char *inBlk;
+   double x, y, xprime, yprime, xcen, ycen, sinT, cosT, a, b, dx, dy;
+   double p2, p3, xmin, xmax, ymin, ymax;
+   int i, cur_comp, sign, usebox;
+   long done, row, brows;
+   char in, skip;
+
+   for( done=0; done<nrows; done+=brows ) {
+
+      brows = nrows - done;
+      if( brows > REGION_BLOCK_ROWS ) brows = REGION_BLOCK_ROWS;
+
+      Xblk  = X + done;
+      Yblk  = Y + done;
+      inBlk = inRegion + done;
+
+      for( row=0; row<brows; row++ )
+         inBlk[row] = 0;
+
+      Shapes = Rgn->Shapes;
+      cur_comp = Rgn->Shapes[0].comp;
+
+      for( i=0; i<Rgn->nShapes; i++, Shapes++ ) {
+
+        /* if this shape starts a new component then fold the accumulated  */
+        /* component selections into the totals and reinitialize them,     */
+        /* exactly as fits_in_region does for a single point               */
+
+        if ( i==0 || Shapes->comp != cur_comp ) {
+          cur_comp = Shapes->comp;
+          /* if an excluded region is given first, then implicitly   */
+          /* assume a previous shape that includes the entire image. */
+          in = !Shapes->sign;
+          if ( i )
+             for( row=0; row<brows; row++ ) {
+                inBlk[row] = inBlk[row] || comp[row];
+                comp[row] = in;
+             }
+          else
+             for( row=0; row<brows; row++ )
+                comp[row] = in;
+        }
+
+        sign = Shapes->sign;
+        xcen = Shapes->param.gen.p[0];
+        ycen = Shapes->param.gen.p[1];
+        sinT = Shapes->param.gen.sinT;
+        cosT = Shapes->param.gen.cosT;
+        a    = Shapes->param.gen.a;
+        b    = Shapes->param.gen.b;
+
+        switch( Shapes->shape ) {
+
+        case circle_rgn:
+           for( row=0; row<brows; row++ ) {
+              x = Xblk[row] - xcen;
+              y = Yblk[row] - ycen;
+              in = !( x*x + y*y > a );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case annulus_rgn:
+           for( row=0; row<brows; row++ ) {
+              x = Xblk[row] - xcen;
+              y = Yblk[row] - ycen;
+              in = !( (x*x + y*y < a) | (x*x + y*y > b) );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case ellipse_rgn:
+           p2 = Shapes->param.gen.p[2];
+           p3 = Shapes->param.gen.p[3];
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x = ( xprime * cosT + yprime * sinT) / p2;
+              y = (-xprime * sinT + yprime * cosT) / p3;
+              in = !( x*x + y*y > 1.0 );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case elliptannulus_rgn:
+           dx = Shapes->param.gen.p[4];
+           dy = Shapes->param.gen.p[5];
+           p2 = Shapes->param.gen.p[2];
+           p3 = Shapes->param.gen.p[3];
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x = ( xprime * cosT + yprime * sinT) / dx;
+              y = (-xprime * sinT + yprime * cosT) / dy;
+              in = !( x*x + y*y > 1.0 );
+              if( in ) {
+                 x = ( xprime * b + yprime * a) / p2;
+                 y = (-xprime * a + yprime * b) / p3;
+                 in = !( x*x + y*y < 1.0 );
+              }
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case box_rgn:
+           dx = 0.5 * Shapes->param.gen.p[2];
+           dy = 0.5 * Shapes->param.gen.p[3];
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x =  xprime * cosT + yprime * sinT;
+              y = -xprime * sinT + yprime * cosT;
+              in = !( (x < -dx) | (x > dx) | (y < -dy) | (y > dy) );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case boxannulus_rgn:
+           dx = 0.5 * Shapes->param.gen.p[4];
+           dy = 0.5 * Shapes->param.gen.p[5];
+           p2 = 0.5 * Shapes->param.gen.p[2];
+           p3 = 0.5 * Shapes->param.gen.p[3];
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x =  xprime * cosT + yprime * sinT;
+              y = -xprime * sinT + yprime * cosT;
+              in = !( (x < -dx) | (x > dx) | (y < -dy) | (y > dy) );
+              if( in ) {
+                 x =  xprime * b + yprime * a;
+                 y = -xprime * a + yprime * b;
+                 in = !( (x >= -p2) & (x <= p2) & (y >= -p3) & (y <= p3) );
+              }
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case rectangle_rgn:
+           xcen = Shapes->param.gen.p[5];
+           ycen = Shapes->param.gen.p[6];
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x =  xprime * cosT + yprime * sinT;
+              y = -xprime * sinT + yprime * cosT;
+              in = !( (x < -a) | (x > a) | (y < -b) | (y > b) );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case diamond_rgn:
+           dx = 0.5 * Shapes->param.gen.p[2];
+           dy = 0.5 * Shapes->param.gen.p[3];
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x =  xprime * cosT + yprime * sinT;
+              y = -xprime * sinT + yprime * cosT;
+              in = !( fabs(x/dx) + fabs(y/dy) > 1 );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case point_rgn:
+           for( row=0; row<brows; row++ ) {
+              x = Xblk[row] - xcen;
+              y = Yblk[row] - ycen;
+              in = !( (x < -0.5) | (x >= 0.5) | (y < -0.5) | (y >= 0.5) );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        case line_rgn:
+           for( row=0; row<brows; row++ ) {
+              xprime = Xblk[row] - xcen;
+              yprime = Yblk[row] - ycen;
+              x =  xprime * cosT + yprime * sinT;
+              y = -xprime * sinT + yprime * cosT;
+              in = !( (y < -0.5) | (y >= 0.5) | (x < -0.5) | (x >= a) );
+              if( sign ) comp[row] |= in; else comp[row] &= !in;
+           }
+           break;
+
+        default:
+
+           /* sectors, pandas and polygons keep the row-at-a-time test:   */
+           /* an include shape can only select rows not already selected  */
+           /* and an exclude shape can only deselect rows already         */
+           /* selected, and rows outside the shape's precomputed          */
+           /* bounding box cannot change state either way (sectors flag   */
+           /* theirs as invalid with xmax < xmin)                         */
+
+           xmin = Shapes->xmin;
+           xmax = Shapes->xmax;
+           ymin = Shapes->ymin;
+           ymax = Shapes->ymax;
+           usebox = ( xmin <= xmax );
+           skip = sign ? 1 : 0;
+
+           for( row=0; row<brows; row++ ) {
+              if( comp[row] == skip )
+                 continue;
+              if( usebox && ( (Xblk[row]<xmin) | (Xblk[row]>xmax)
+                              | (Yblk[row]<ymin) | (Yblk[row]>ymax) ) )
+                 continue;
+              in = fits_in_shape( Xblk[row], Yblk[row], Shapes );
+              comp[row] = ( sign ? in : !in );
+           }
+           break;
+        }
+
+      }
+
+      for( row=0; row<brows; row++ )
+         inBlk[row] = inBlk[row] || comp[row];
+
+   }
+}
+
 /*---------------------------------------------------------------------------*/
 void fits_free_region( SAORegion *Rgn )
 /*   Free up memory allocated to hold the region data.                       */
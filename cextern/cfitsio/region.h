@@ -73,6 +73,8 @@ typedef struct {
 /*  SAO region file routines */
 int  fits_read_rgnfile( const char *filename, WCSdata *wcs, SAORegion **Rgn, int *status );
 int  fits_in_region( double X, double Y, SAORegion *Rgn );
+void fits_in_region_array( long nrows, const double *X, const double *Y,
+                           char *inRegion, SAORegion *Rgn );
 void fits_free_region( SAORegion *Rgn );
 void fits_set_region_components ( SAORegion *Rgn );
 void fits_setup_shape ( RgnShape *shape);
@@ -23,32 +23,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-/*
- * nonzero_count is lookup table giving number of bits in 8-bit values not including
- * leading zeros used in fits_rdecomp, fits_rdecomp_short and fits_rdecomp_byte
- */
-static const int nonzero_count[256] = {
-0, 
-1, 
-2, 2, 
-3, 3, 3, 3, 
-4, 4, 4, 4, 4, 4, 4, 4, 
-5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 
-6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 
-6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 
-7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
-7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
-7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
-7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
-8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8};
-
 typedef unsigned char Buffer_t;
 
 typedef struct {
@@ -61,6 +35,29 @@ typedef struct {
 
 #define putcbuf(c,mf) 	((*(mf->current)++ = c), 0)
 
+/*
+ * 64-bit staging register used by both the encoders and the decoders.
+ * The encoders append a whole Rice code (unary top bits plus the FS
+ * trailing bits) to the register in one shift/or and then drain full
+ * bytes, instead of shifting the output through the 8-bit bit buffer
+ * one value at a time.  The register always has room for 7 pending
+ * bits plus a 56-bit code.
+ */
+typedef unsigned long long rice_bitbuf_t;
+
+/* append the low n bits of val to the staging register and drain any
+   complete bytes to the output buffer; n plus the number of pending
+   bits must not exceed 64, and val must be clean above bit n */
+#define RICE_PUT_BITS(lbitbuf, lbitcnt, val, n, mf) \
+    do { \
+	lbitbuf = (lbitbuf << (n)) | (val); \
+	lbitcnt += (n); \
+	while (lbitcnt >= 8) { \
+	    lbitcnt -= 8; \
+	    putcbuf((lbitbuf >> lbitcnt) & 0xff, mf); \
+	} \
+    } while (0)
+
 #include "fitsio2.h"
 
 static void start_outputing_bits(Buffer *buffer);
@@ -92,9 +89,11 @@ Buffer bufmem, *buffer = &bufmem;
 int i, j, thisblock;
 int lastpix, nextpix, pdiff;
 int v, fs, fsmask, top, fsmax, fsbits, bbits;
-int lbitbuffer, lbits_to_go;
+rice_bitbuf_t lbitbuf;
+int lbitcnt;
 unsigned int psum;
-double pixelsum, dpsum;
+unsigned long long pixelsum;
+double dpsum;
 unsigned int *diff;
 
     /*
@@ -181,21 +180,28 @@ unsigned int *diff;
 	 * passed as an int.)
 	 *
 	 * compute sum of mapped pixel values at same time
-	 * use double precision for sum to allow 32-bit integer inputs
+	 * use a 64-bit sum, which is exact for 32-bit integer inputs
+	 *
+	 * the first difference of the block is taken against the last
+	 * pixel of the previous block; the rest of the loop has no
+	 * loop-carried dependence, so the compiler is free to
+	 * vectorize it
 	 */
-	pixelsum = 0.0;
-	for (j=0; j<thisblock; j++) {
-	    nextpix = a[i+j];
-	    pdiff = nextpix - lastpix;
+	nextpix = a[i];
+	pdiff = nextpix - lastpix;
+	diff[0] = (unsigned int) ((pdiff<0) ? ~(pdiff<<1) : (pdiff<<1));
+	pixelsum = diff[0];
+	for (j=1; j<thisblock; j++) {
+	    pdiff = a[i+j] - a[i+j-1];
 	    diff[j] = (unsigned int) ((pdiff<0) ? ~(pdiff<<1) : (pdiff<<1));
 	    pixelsum += diff[j];
-	    lastpix = nextpix;
 	}
+	lastpix = a[i+thisblock-1];
 
 	/*
 	 * compute number of bits to split from sum
 	 */
-	dpsum = (pixelsum - (thisblock/2) - 1)/thisblock;
+	dpsum = ((double) pixelsum - (thisblock/2) - 1)/thisblock;
 	if (dpsum < 0) dpsum = 0.0;
 	psum = ((unsigned int) dpsum ) >> 1;
 	for (fs = 0; psum>0; fs++) psum >>= 1;
@@ -213,13 +219,24 @@ unsigned int *diff;
                 free(diff);
 		return(-1);
 	    }
+	    /*
+	     * the block has a fixed size once FS is known, so the
+	     * output buffer can be checked once up front and the
+	     * values streamed through the staging register unchecked
+	     */
+	    lbitcnt = 8 - buffer->bits_to_go;
+	    lbitbuf = buffer->bitbuffer & (((rice_bitbuf_t) 1 << lbitcnt) - 1);
+	    if (buffer->current + (lbitcnt + thisblock*bbits)/8 > buffer->end) {
+                ffpmsg("rice_encode: end of buffer");
+                free(diff);
+		return(-1);
+	    }
 	    for (j=0; j<thisblock; j++) {
-		if (output_nbits(buffer, diff[j], bbits) == EOF) {
-                    ffpmsg("rice_encode: end of buffer");
-                    free(diff);
-		    return(-1);
-		}
+		RICE_PUT_BITS(lbitbuf, lbitcnt, (rice_bitbuf_t) diff[j], bbits,
+			      buffer);
 	    }
+	    buffer->bitbuffer = (int) lbitbuf;
+	    buffer->bits_to_go = 8 - lbitcnt;
 	} else if (fs == 0 && pixelsum == 0) {
 	    /*
 	     * special low entropy case when FS = 0 and pixelsum=0 (all
@@ -242,42 +259,30 @@ unsigned int *diff;
 	    /*
 	     * local copies of bit buffer to improve optimization
 	     */
-	    lbitbuffer = buffer->bitbuffer;
-	    lbits_to_go = buffer->bits_to_go;
+	    lbitcnt = 8 - buffer->bits_to_go;
+	    lbitbuf = buffer->bitbuffer & (((rice_bitbuf_t) 1 << lbitcnt) - 1);
 	    for (j=0; j<thisblock; j++) {
 		v = diff[j];
 		top = v >> fs;
 		/*
-		 * top is coded by top zeros + 1
+		 * top is coded by top zeros + 1, followed by the FS
+		 * trailing bits of v; a typical code word fits in the
+		 * staging register and is appended in one operation
 		 */
-		if (lbits_to_go >= top+1) {
-		    lbitbuffer <<= top+1;
-		    lbitbuffer |= 1;
-		    lbits_to_go -= top+1;
+		if (top + 1 + fs <= 56) {
+		    RICE_PUT_BITS(lbitbuf, lbitcnt,
+				  ((rice_bitbuf_t) 1 << fs) | (v & fsmask),
+				  top + 1 + fs, buffer);
 		} else {
-		    lbitbuffer <<= lbits_to_go;
-		    putcbuf(lbitbuffer & 0xff,buffer);
-
-		    for (top -= lbits_to_go; top>=8; top -= 8) {
-			putcbuf(0, buffer);
-		    }
-		    lbitbuffer = 1;
-		    lbits_to_go = 7-top;
-		}
-		/*
-		 * bottom FS bits are written without coding
-		 * code is output_nbits, moved into this routine to reduce overheads
-		 * This code potentially breaks if FS>24, so I am limiting
-		 * FS to 24 by choice of FSMAX above.
-		 */
-		if (fs > 0) {
-		    lbitbuffer <<= fs;
-		    lbitbuffer |= v & fsmask;
-		    lbits_to_go -= fs;
-		    while (lbits_to_go <= 0) {
-			putcbuf((lbitbuffer>>(-lbits_to_go)) & 0xff,buffer);
-			lbits_to_go += 8;
+		    /* pathological zero run: drain it in chunks */
+		    while (top + 1 + fs > 56) {
+			RICE_PUT_BITS(lbitbuf, lbitcnt, (rice_bitbuf_t) 0, 32,
+				      buffer);
+			top -= 32;
 		    }
+		    RICE_PUT_BITS(lbitbuf, lbitcnt,
+				  ((rice_bitbuf_t) 1 << fs) | (v & fsmask),
+				  top + 1 + fs, buffer);
 		}
 	    }
 
@@ -287,8 +292,8 @@ unsigned int *diff;
                  free(diff);
 		 return(-1);
 	    }
-	    buffer->bitbuffer = lbitbuffer;
-	    buffer->bits_to_go = lbits_to_go;
+	    buffer->bitbuffer = (int) lbitbuf;
+	    buffer->bits_to_go = 8 - lbitcnt;
 	}
     }
     done_outputing_bits(buffer);
@@ -317,12 +322,14 @@ but in fact the code runs faster (on 32-bit Linux at least) as 'int'
 */
 int lastpix, nextpix;
 /* int pdiff; */
-short pdiff; 
+short pdiff;
 int v, fs, fsmask, top, fsmax, fsbits, bbits;
-int lbitbuffer, lbits_to_go;
+rice_bitbuf_t lbitbuf;
+int lbitcnt;
 /* unsigned int psum; */
 unsigned short psum;
-double pixelsum, dpsum;
+unsigned long long pixelsum;
+double dpsum;
 unsigned int *diff;
 
     /*
@@ -409,20 +416,27 @@ unsigned int *diff;
 	 * passed as an int.)
 	 *
 	 * compute sum of mapped pixel values at same time
-	 * use double precision for sum to allow 32-bit integer inputs
+	 * use a 64-bit sum, which is exact for these inputs
+	 *
+	 * the first difference of the block is taken against the last
+	 * pixel of the previous block; the rest of the loop has no
+	 * loop-carried dependence, so the compiler is free to
+	 * vectorize it
 	 */
-	pixelsum = 0.0;
-	for (j=0; j<thisblock; j++) {
-	    nextpix = a[i+j];
-	    pdiff = nextpix - lastpix;
+	nextpix = a[i];
+	pdiff = nextpix - lastpix;
+	diff[0] = (unsigned int) ((pdiff<0) ? ~(pdiff<<1) : (pdiff<<1));
+	pixelsum = diff[0];
+	for (j=1; j<thisblock; j++) {
+	    pdiff = a[i+j] - a[i+j-1];
 	    diff[j] = (unsigned int) ((pdiff<0) ? ~(pdiff<<1) : (pdiff<<1));
 	    pixelsum += diff[j];
-	    lastpix = nextpix;
 	}
+	lastpix = a[i+thisblock-1];
 	/*
 	 * compute number of bits to split from sum
 	 */
-	dpsum = (pixelsum - (thisblock/2) - 1)/thisblock;
+	dpsum = ((double) pixelsum - (thisblock/2) - 1)/thisblock;
 	if (dpsum < 0) dpsum = 0.0;
 /*	psum = ((unsigned int) dpsum ) >> 1; */
 	psum = ((unsigned short) dpsum ) >> 1;
@@ -442,13 +456,24 @@ unsigned int *diff;
                 free(diff);
 		return(-1);
 	    }
+	    /*
+	     * the block has a fixed size once FS is known, so the
+	     * output buffer can be checked once up front and the
+	     * values streamed through the staging register unchecked
+	     */
+	    lbitcnt = 8 - buffer->bits_to_go;
+	    lbitbuf = buffer->bitbuffer & (((rice_bitbuf_t) 1 << lbitcnt) - 1);
+	    if (buffer->current + (lbitcnt + thisblock*bbits)/8 > buffer->end) {
+                ffpmsg("rice_encode: end of buffer");
+                free(diff);
+		return(-1);
+	    }
 	    for (j=0; j<thisblock; j++) {
-		if (output_nbits(buffer, diff[j], bbits) == EOF) {
-                    ffpmsg("rice_encode: end of buffer");
-                    free(diff);
-		    return(-1);
-		}
+		RICE_PUT_BITS(lbitbuf, lbitcnt, (rice_bitbuf_t) diff[j], bbits,
+			      buffer);
 	    }
+	    buffer->bitbuffer = (int) lbitbuf;
+	    buffer->bits_to_go = 8 - lbitcnt;
 	} else if (fs == 0 && pixelsum == 0) {
 /* case1++; */
 	    /*
@@ -473,41 +498,30 @@ unsigned int *diff;
 	    /*
 	     * local copies of bit buffer to improve optimization
 	     */
-	    lbitbuffer = buffer->bitbuffer;
-	    lbits_to_go = buffer->bits_to_go;
+	    lbitcnt = 8 - buffer->bits_to_go;
+	    lbitbuf = buffer->bitbuffer & (((rice_bitbuf_t) 1 << lbitcnt) - 1);
 	    for (j=0; j<thisblock; j++) {
 		v = diff[j];
 		top = v >> fs;
 		/*
-		 * top is coded by top zeros + 1
+		 * top is coded by top zeros + 1, followed by the FS
+		 * trailing bits of v; a typical code word fits in the
+		 * staging register and is appended in one operation
 		 */
-		if (lbits_to_go >= top+1) {
-		    lbitbuffer <<= top+1;
-		    lbitbuffer |= 1;
-		    lbits_to_go -= top+1;
+		if (top + 1 + fs <= 56) {
+		    RICE_PUT_BITS(lbitbuf, lbitcnt,
+				  ((rice_bitbuf_t) 1 << fs) | (v & fsmask),
+				  top + 1 + fs, buffer);
 		} else {
-		    lbitbuffer <<= lbits_to_go;
-		    putcbuf(lbitbuffer & 0xff,buffer);
-		    for (top -= lbits_to_go; top>=8; top -= 8) {
-			putcbuf(0, buffer);
-		    }
-		    lbitbuffer = 1;
-		    lbits_to_go = 7-top;
-		}
-		/*
-		 * bottom FS bits are written without coding
-		 * code is output_nbits, moved into this routine to reduce overheads
-		 * This code potentially breaks if FS>24, so I am limiting
-		 * FS to 24 by choice of FSMAX above.
-		 */
-		if (fs > 0) {
-		    lbitbuffer <<= fs;
-		    lbitbuffer |= v & fsmask;
-		    lbits_to_go -= fs;
-		    while (lbits_to_go <= 0) {
-			putcbuf((lbitbuffer>>(-lbits_to_go)) & 0xff,buffer);
-			lbits_to_go += 8;
+		    /* pathological zero run: drain it in chunks */
+		    while (top + 1 + fs > 56) {
+			RICE_PUT_BITS(lbitbuf, lbitcnt, (rice_bitbuf_t) 0, 32,
+				      buffer);
+			top -= 32;
 		    }
+		    RICE_PUT_BITS(lbitbuf, lbitcnt,
+				  ((rice_bitbuf_t) 1 << fs) | (v & fsmask),
+				  top + 1 + fs, buffer);
 		}
 	    }
 	    /* check if overflowed output buffer */
@@ -516,8 +530,8 @@ unsigned int *diff;
                  free(diff);
 		 return(-1);
 	    }
-	    buffer->bitbuffer = lbitbuffer;
-	    buffer->bits_to_go = lbits_to_go;
+	    buffer->bitbuffer = (int) lbitbuf;
+	    buffer->bits_to_go = 8 - lbitcnt;
 	}
     }
     done_outputing_bits(buffer);
@@ -546,12 +560,14 @@ but in fact the code runs faster (on 32-bit Linux at least) as 'int'
 */
 int lastpix, nextpix;
 /* int pdiff; */
-signed char pdiff; 
+signed char pdiff;
 int v, fs, fsmask, top, fsmax, fsbits, bbits;
-int lbitbuffer, lbits_to_go;
+rice_bitbuf_t lbitbuf;
+int lbitcnt;
 /* unsigned int psum; */
 unsigned char psum;
-double pixelsum, dpsum;
+unsigned long long pixelsum;
+double dpsum;
 unsigned int *diff;
 
     /*
@@ -637,20 +653,27 @@ unsigned int *diff;
 	 * passed as an int.)
 	 *
 	 * compute sum of mapped pixel values at same time
-	 * use double precision for sum to allow 32-bit integer inputs
+	 * use a 64-bit sum, which is exact for these inputs
+	 *
+	 * the first difference of the block is taken against the last
+	 * pixel of the previous block; the rest of the loop has no
+	 * loop-carried dependence, so the compiler is free to
+	 * vectorize it
 	 */
-	pixelsum = 0.0;
-	for (j=0; j<thisblock; j++) {
-	    nextpix = a[i+j];
-	    pdiff = nextpix - lastpix;
+	nextpix = a[i];
+	pdiff = nextpix - lastpix;
+	diff[0] = (unsigned int) ((pdiff<0) ? ~(pdiff<<1) : (pdiff<<1));
+	pixelsum = diff[0];
+	for (j=1; j<thisblock; j++) {
+	    pdiff = a[i+j] - a[i+j-1];
 	    diff[j] = (unsigned int) ((pdiff<0) ? ~(pdiff<<1) : (pdiff<<1));
 	    pixelsum += diff[j];
-	    lastpix = nextpix;
 	}
+	lastpix = a[i+thisblock-1];
 	/*
 	 * compute number of bits to split from sum
 	 */
-	dpsum = (pixelsum - (thisblock/2) - 1)/thisblock;
+	dpsum = ((double) pixelsum - (thisblock/2) - 1)/thisblock;
 	if (dpsum < 0) dpsum = 0.0;
 /*	psum = ((unsigned int) dpsum ) >> 1; */
 	psum = ((unsigned char) dpsum ) >> 1;
@@ -669,13 +692,24 @@ unsigned int *diff;
                 free(diff);
 		return(-1);
 	    }
+	    /*
+	     * the block has a fixed size once FS is known, so the
+	     * output buffer can be checked once up front and the
+	     * values streamed through the staging register unchecked
+	     */
+	    lbitcnt = 8 - buffer->bits_to_go;
+	    lbitbuf = buffer->bitbuffer & (((rice_bitbuf_t) 1 << lbitcnt) - 1);
+	    if (buffer->current + (lbitcnt + thisblock*bbits)/8 > buffer->end) {
+                ffpmsg("rice_encode: end of buffer");
+                free(diff);
+		return(-1);
+	    }
 	    for (j=0; j<thisblock; j++) {
-		if (output_nbits(buffer, diff[j], bbits) == EOF) {
-                    ffpmsg("rice_encode: end of buffer");
-                    free(diff);
-		    return(-1);
-		}
+		RICE_PUT_BITS(lbitbuf, lbitcnt, (rice_bitbuf_t) diff[j], bbits,
+			      buffer);
 	    }
+	    buffer->bitbuffer = (int) lbitbuf;
+	    buffer->bits_to_go = 8 - lbitcnt;
 	} else if (fs == 0 && pixelsum == 0) {
 	    /*
 	     * special low entropy case when FS = 0 and pixelsum=0 (all
@@ -698,41 +732,30 @@ unsigned int *diff;
 	    /*
 	     * local copies of bit buffer to improve optimization
 	     */
-	    lbitbuffer = buffer->bitbuffer;
-	    lbits_to_go = buffer->bits_to_go;
+	    lbitcnt = 8 - buffer->bits_to_go;
+	    lbitbuf = buffer->bitbuffer & (((rice_bitbuf_t) 1 << lbitcnt) - 1);
 	    for (j=0; j<thisblock; j++) {
 		v = diff[j];
 		top = v >> fs;
 		/*
-		 * top is coded by top zeros + 1
+		 * top is coded by top zeros + 1, followed by the FS
+		 * trailing bits of v; a typical code word fits in the
+		 * staging register and is appended in one operation
 		 */
-		if (lbits_to_go >= top+1) {
-		    lbitbuffer <<= top+1;
-		    lbitbuffer |= 1;
-		    lbits_to_go -= top+1;
+		if (top + 1 + fs <= 56) {
+		    RICE_PUT_BITS(lbitbuf, lbitcnt,
+				  ((rice_bitbuf_t) 1 << fs) | (v & fsmask),
+				  top + 1 + fs, buffer);
 		} else {
-		    lbitbuffer <<= lbits_to_go;
-		    putcbuf(lbitbuffer & 0xff,buffer);
-		    for (top -= lbits_to_go; top>=8; top -= 8) {
-			putcbuf(0, buffer);
-		    }
-		    lbitbuffer = 1;
-		    lbits_to_go = 7-top;
-		}
-		/*
-		 * bottom FS bits are written without coding
-		 * code is output_nbits, moved into this routine to reduce overheads
-		 * This code potentially breaks if FS>24, so I am limiting
-		 * FS to 24 by choice of FSMAX above.
-		 */
-		if (fs > 0) {
-		    lbitbuffer <<= fs;
-		    lbitbuffer |= v & fsmask;
-		    lbits_to_go -= fs;
-		    while (lbits_to_go <= 0) {
-			putcbuf((lbitbuffer>>(-lbits_to_go)) & 0xff,buffer);
-			lbits_to_go += 8;
+		    /* pathological zero run: drain it in chunks */
+		    while (top + 1 + fs > 56) {
+			RICE_PUT_BITS(lbitbuf, lbitcnt, (rice_bitbuf_t) 0, 32,
+				      buffer);
+			top -= 32;
 		    }
+		    RICE_PUT_BITS(lbitbuf, lbitcnt,
+				  ((rice_bitbuf_t) 1 << fs) | (v & fsmask),
+				  top + 1 + fs, buffer);
 		}
 	    }
 	    /* check if overflowed output buffer */
@@ -741,8 +764,8 @@ unsigned int *diff;
                  free(diff);
 		 return(-1);
 	    }
-	    buffer->bitbuffer = lbitbuffer;
-	    buffer->bits_to_go = lbits_to_go;
+	    buffer->bitbuffer = (int) lbitbuf;
+	    buffer->bits_to_go = 8 - lbitcnt;
 	}
     }
     done_outputing_bits(buffer);
@@ -854,6 +877,68 @@ static int done_outputing_bits(Buffer *buffer)
 #include <stdlib.h>
 */
 
+/*
+ * The decoders below keep the compressed bit stream in a 64-bit buffer
+ * that is topped up several bytes at a time, instead of the original
+ * 8-bit buffer that had to be refilled (with a branch) for nearly every
+ * code word.  The wide buffer always holds enough bits for a complete
+ * FS field plus a typical Rice code, so the inner loops only test for
+ * refills once per pixel, and leading zeros are counted in a single
+ * step rather than a byte at a time.  The decoded output is identical
+ * to that of the original byte-oriented implementation.
+ */
+
+/* top up the bit buffer so that it holds at least 57 valid bits, or
+   all remaining bits if the input buffer is nearly exhausted */
+#define RICE_REFILL(b, nbits, c, cend) \
+    while (nbits <= 56 && c < cend) { \
+	b = (b<<8) | (*c++); \
+	nbits += 8; \
+    }
+
+#if defined(__GNUC__) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4))
+/* 1-based position of the most significant set bit; v must be nonzero */
+#define RICE_MSB_POSITION(v) (64 - __builtin_clzll(v))
+#else
+/*
+ * nonzero_count is lookup table giving number of bits in 8-bit values not including
+ * leading zeros used in fits_rdecomp, fits_rdecomp_short and fits_rdecomp_byte
+ */
+static const int nonzero_count[256] = {
+0, 
+1, 
+2, 2, 
+3, 3, 3, 3, 
+4, 4, 4, 4, 4, 4, 4, 4, 
+5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 
+6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 
+6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 
+7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
+7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
+7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
+7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 
+8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8};
+
+static int rice_msb_position(rice_bitbuf_t v)
+{
+    int pos = 0;
+
+    while (v > 0xff) {
+	v >>= 8;
+	pos += 8;
+    }
+    return pos + nonzero_count[v];
+}
+#define RICE_MSB_POSITION(v) rice_msb_position(v)
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* this routine used to be called 'rdecomp'  (WDP)  */
 
@@ -867,9 +952,9 @@ int fits_rdecomp (unsigned char *c,		/* input buffer			*/
 int i, k, imax;
 int nbits, nzero, fs;
 unsigned char *cend, bytevalue;
-unsigned int b, diff, lastpix;
+unsigned int diff, lastpix;
+rice_bitbuf_t b;
 int fsmax, fsbits, bbits;
-extern const int nonzero_count[];
 
    /*
      * Original size of each pixel (bsize, bytes) and coding block
@@ -930,21 +1015,22 @@ extern const int nonzero_count[];
     bytevalue = c[3];
     lastpix = lastpix | bytevalue;
 
-    c += 4;  
+    c += 4;
     cend = c + clen - 4;
 
-    b = *c++;		    /* bit buffer			*/
-    nbits = 8;		    /* number of bits remaining in b	*/
+    b = 0;		    /* bit buffer			*/
+    nbits = 0;		    /* number of valid bits in b		*/
     for (i = 0; i<nx; ) {
 	/* get the FS value from first fsbits */
-	nbits -= fsbits;
-	while (nbits < 0) {
-	    b = (b<<8) | (*c++);
-	    nbits += 8;
+	RICE_REFILL(b, nbits, c, cend);
+	if (nbits < fsbits) {
+            ffpmsg("decompression error: hit end of compressed byte stream");
+	    return 1;
 	}
-	fs = (b >> nbits) - 1;
+	nbits -= fsbits;
+	fs = (int) (b >> nbits) - 1;
 
-	b &= (1<<nbits)-1;
+	b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 	/* loop over the next block */
 	imax = i + nblock;
 	if (imax > nx) imax = nx;
@@ -954,19 +1040,14 @@ extern const int nonzero_count[];
 	} else if (fs==fsmax) {
 	    /* high-entropy case, directly coded pixel values */
 	    for ( ; i<imax; i++) {
-		k = bbits - nbits;
-		diff = b<<k;
-		for (k -= 8; k >= 0; k -= 8) {
-		    b = *c++;
-		    diff |= b<<k;
-		}
-		if (nbits>0) {
-		    b = *c++;
-		    diff |= b>>(-k);
-		    b &= (1<<nbits)-1;
-		} else {
-		    b = 0;
+		RICE_REFILL(b, nbits, c, cend);
+		if (nbits < bbits) {
+		    ffpmsg("decompression error: hit end of compressed byte stream");
+		    return 1;
 		}
+		nbits -= bbits;
+		diff = (unsigned int) (b >> nbits);
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 		/*
 		 * undo mapping and differencing
 		 * Note that some of these operations will overflow the
@@ -984,23 +1065,34 @@ extern const int nonzero_count[];
 	} else {
 	    /* normal case, Rice coding */
 	    for ( ; i<imax; i++) {
+		RICE_REFILL(b, nbits, c, cend);
 		/* count number of leading zeros */
+		nzero = 0;
 		while (b == 0) {
-		    nbits += 8;
-		    b = *c++;
+		    nzero += nbits;
+		    nbits = 0;
+		    if (c >= cend) {
+			ffpmsg("decompression error: hit end of compressed byte stream");
+			return 1;
+		    }
+		    RICE_REFILL(b, nbits, c, cend);
 		}
-		nzero = nbits - nonzero_count[b];
-		nbits -= nzero+1;
-		/* flip the leading one-bit */
-		b ^= 1<<nbits;
+		k = RICE_MSB_POSITION(b);
+		nzero += nbits - k;
+		/* drop the leading zeros and the terminating one-bit */
+		nbits = k - 1;
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 		/* get the FS trailing bits */
-		nbits -= fs;
-		while (nbits < 0) {
-		    b = (b<<8) | (*c++);
-		    nbits += 8;
+		if (nbits < fs) {
+		    RICE_REFILL(b, nbits, c, cend);
+		    if (nbits < fs) {
+			ffpmsg("decompression error: hit end of compressed byte stream");
+			return 1;
+		    }
 		}
-		diff = (nzero<<fs) | (b>>nbits);
-		b &= (1<<nbits)-1;
+		nbits -= fs;
+		diff = ((unsigned int) nzero << fs) | (unsigned int) (b >> nbits);
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 
 		/* undo mapping and differencing */
 		if ((diff & 1) == 0) {
@@ -1012,12 +1104,8 @@ extern const int nonzero_count[];
 		lastpix = array[i];
 	    }
 	}
-	if (c > cend) {
-            ffpmsg("decompression error: hit end of compressed byte stream");
-	    return 1;
-	}
     }
-    if (c < cend) {
+    if (nbits + 8*(int)(cend - c) >= 8) {
         ffpmsg("decompression warning: unused bytes at end of compressed buffer");
     }
     return 0;
@@ -1036,9 +1124,9 @@ int i, imax;
 int k;
 int nbits, nzero, fs;
 unsigned char *cend, bytevalue;
-unsigned int b, diff, lastpix;
+unsigned int diff, lastpix;
+rice_bitbuf_t b;
 int fsmax, fsbits, bbits;
-extern const int nonzero_count[];
 
    /*
      * Original size of each pixel (bsize, bytes) and coding block
@@ -1096,21 +1184,22 @@ extern const int nonzero_count[];
     bytevalue = c[1];
     lastpix = lastpix | bytevalue;
 
-    c += 2;  
+    c += 2;
     cend = c + clen - 2;
 
-    b = *c++;		    /* bit buffer			*/
-    nbits = 8;		    /* number of bits remaining in b	*/
+    b = 0;		    /* bit buffer			*/
+    nbits = 0;		    /* number of valid bits in b		*/
     for (i = 0; i<nx; ) {
 	/* get the FS value from first fsbits */
-	nbits -= fsbits;
-	while (nbits < 0) {
-	    b = (b<<8) | (*c++);
-	    nbits += 8;
+	RICE_REFILL(b, nbits, c, cend);
+	if (nbits < fsbits) {
+            ffpmsg("decompression error: hit end of compressed byte stream");
+	    return 1;
 	}
-	fs = (b >> nbits) - 1;
+	nbits -= fsbits;
+	fs = (int) (b >> nbits) - 1;
 
-	b &= (1<<nbits)-1;
+	b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 	/* loop over the next block */
 	imax = i + nblock;
 	if (imax > nx) imax = nx;
@@ -1120,20 +1209,14 @@ extern const int nonzero_count[];
 	} else if (fs==fsmax) {
 	    /* high-entropy case, directly coded pixel values */
 	    for ( ; i<imax; i++) {
-		k = bbits - nbits;
-		diff = b<<k;
-		for (k -= 8; k >= 0; k -= 8) {
-		    b = *c++;
-		    diff |= b<<k;
+		RICE_REFILL(b, nbits, c, cend);
+		if (nbits < bbits) {
+		    ffpmsg("decompression error: hit end of compressed byte stream");
+		    return 1;
 		}
-		if (nbits>0) {
-		    b = *c++;
-		    diff |= b>>(-k);
-		    b &= (1<<nbits)-1;
-		} else {
-		    b = 0;
-		}
-   
+		nbits -= bbits;
+		diff = (unsigned int) (b >> nbits);
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 		/*
 		 * undo mapping and differencing
 		 * Note that some of these operations will overflow the
@@ -1151,23 +1234,34 @@ extern const int nonzero_count[];
 	} else {
 	    /* normal case, Rice coding */
 	    for ( ; i<imax; i++) {
+		RICE_REFILL(b, nbits, c, cend);
 		/* count number of leading zeros */
+		nzero = 0;
 		while (b == 0) {
-		    nbits += 8;
-		    b = *c++;
+		    nzero += nbits;
+		    nbits = 0;
+		    if (c >= cend) {
+			ffpmsg("decompression error: hit end of compressed byte stream");
+			return 1;
+		    }
+		    RICE_REFILL(b, nbits, c, cend);
 		}
-		nzero = nbits - nonzero_count[b];
-		nbits -= nzero+1;
-		/* flip the leading one-bit */
-		b ^= 1<<nbits;
+		k = RICE_MSB_POSITION(b);
+		nzero += nbits - k;
+		/* drop the leading zeros and the terminating one-bit */
+		nbits = k - 1;
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 		/* get the FS trailing bits */
-		nbits -= fs;
-		while (nbits < 0) {
-		    b = (b<<8) | (*c++);
-		    nbits += 8;
+		if (nbits < fs) {
+		    RICE_REFILL(b, nbits, c, cend);
+		    if (nbits < fs) {
+			ffpmsg("decompression error: hit end of compressed byte stream");
+			return 1;
+		    }
 		}
-		diff = (nzero<<fs) | (b>>nbits);
-		b &= (1<<nbits)-1;
+		nbits -= fs;
+		diff = ((unsigned int) nzero << fs) | (unsigned int) (b >> nbits);
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 
 		/* undo mapping and differencing */
 		if ((diff & 1) == 0) {
@@ -1179,12 +1273,8 @@ extern const int nonzero_count[];
 		lastpix = array[i];
 	    }
 	}
-	if (c > cend) {
-            ffpmsg("decompression error: hit end of compressed byte stream");
-	    return 1;
-	}
     }
-    if (c < cend) {
+    if (nbits + 8*(int)(cend - c) >= 8) {
         ffpmsg("decompression warning: unused bytes at end of compressed buffer");
     }
     return 0;
@@ -1203,9 +1293,9 @@ int i, imax;
 int k;
 int nbits, nzero, fs;
 unsigned char *cend;
-unsigned int b, diff, lastpix;
+unsigned int diff, lastpix;
+rice_bitbuf_t b;
 int fsmax, fsbits, bbits;
-extern const int nonzero_count[];
 
    /*
      * Original size of each pixel (bsize, bytes) and coding block
@@ -1258,21 +1348,22 @@ extern const int nonzero_count[];
     /* byte integer value, without any encoding */
     
     lastpix = c[0];
-    c += 1;  
+    c += 1;
     cend = c + clen - 1;
 
-    b = *c++;		    /* bit buffer			*/
-    nbits = 8;		    /* number of bits remaining in b	*/
+    b = 0;		    /* bit buffer			*/
+    nbits = 0;		    /* number of valid bits in b		*/
     for (i = 0; i<nx; ) {
 	/* get the FS value from first fsbits */
-	nbits -= fsbits;
-	while (nbits < 0) {
-	    b = (b<<8) | (*c++);
-	    nbits += 8;
+	RICE_REFILL(b, nbits, c, cend);
+	if (nbits < fsbits) {
+            ffpmsg("decompression error: hit end of compressed byte stream");
+	    return 1;
 	}
-	fs = (b >> nbits) - 1;
+	nbits -= fsbits;
+	fs = (int) (b >> nbits) - 1;
 
-	b &= (1<<nbits)-1;
+	b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 	/* loop over the next block */
 	imax = i + nblock;
 	if (imax > nx) imax = nx;
@@ -1282,20 +1373,14 @@ extern const int nonzero_count[];
 	} else if (fs==fsmax) {
 	    /* high-entropy case, directly coded pixel values */
 	    for ( ; i<imax; i++) {
-		k = bbits - nbits;
-		diff = b<<k;
-		for (k -= 8; k >= 0; k -= 8) {
-		    b = *c++;
-		    diff |= b<<k;
+		RICE_REFILL(b, nbits, c, cend);
+		if (nbits < bbits) {
+		    ffpmsg("decompression error: hit end of compressed byte stream");
+		    return 1;
 		}
-		if (nbits>0) {
-		    b = *c++;
-		    diff |= b>>(-k);
-		    b &= (1<<nbits)-1;
-		} else {
-		    b = 0;
-		}
-   
+		nbits -= bbits;
+		diff = (unsigned int) (b >> nbits);
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 		/*
 		 * undo mapping and differencing
 		 * Note that some of these operations will overflow the
@@ -1313,23 +1398,34 @@ extern const int nonzero_count[];
 	} else {
 	    /* normal case, Rice coding */
 	    for ( ; i<imax; i++) {
+		RICE_REFILL(b, nbits, c, cend);
 		/* count number of leading zeros */
+		nzero = 0;
 		while (b == 0) {
-		    nbits += 8;
-		    b = *c++;
+		    nzero += nbits;
+		    nbits = 0;
+		    if (c >= cend) {
+			ffpmsg("decompression error: hit end of compressed byte stream");
+			return 1;
+		    }
+		    RICE_REFILL(b, nbits, c, cend);
 		}
-		nzero = nbits - nonzero_count[b];
-		nbits -= nzero+1;
-		/* flip the leading one-bit */
-		b ^= 1<<nbits;
+		k = RICE_MSB_POSITION(b);
+		nzero += nbits - k;
+		/* drop the leading zeros and the terminating one-bit */
+		nbits = k - 1;
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 		/* get the FS trailing bits */
-		nbits -= fs;
-		while (nbits < 0) {
-		    b = (b<<8) | (*c++);
-		    nbits += 8;
+		if (nbits < fs) {
+		    RICE_REFILL(b, nbits, c, cend);
+		    if (nbits < fs) {
+			ffpmsg("decompression error: hit end of compressed byte stream");
+			return 1;
+		    }
 		}
-		diff = (nzero<<fs) | (b>>nbits);
-		b &= (1<<nbits)-1;
+		nbits -= fs;
+		diff = ((unsigned int) nzero << fs) | (unsigned int) (b >> nbits);
+		b &= ((rice_bitbuf_t) 1 << nbits) - 1;
 
 		/* undo mapping and differencing */
 		if ((diff & 1) == 0) {
@@ -1341,12 +1437,8 @@ extern const int nonzero_count[];
 		lastpix = array[i];
 	    }
 	}
-	if (c > cend) {
-            ffpmsg("decompression error: hit end of compressed byte stream");
-	    return 1;
-	}
     }
-    if (c < cend) {
+    if (nbits + 8*(int)(cend - c) >= 8) {
         ffpmsg("decompression warning: unused bytes at end of compressed buffer");
     }
     return 0;
@@ -16,6 +16,16 @@
 #define HAVE_BSWAP
 #endif
 
+/* When the compiler supports function-specific target options and CPU
+ * feature tests (GCC 5 and later, and clang), the SSSE3 pshufb kernels
+ * below can also be built in an ordinary (non -mssse3) compilation and
+ * selected at run time on processors that support them.  x86_64 always
+ * has SSE2, so ffswap2 needs no run-time path. */
+#if !defined(__SSSE3__) && defined(__x86_64__) && \
+    (__GNUC__ >= 5 || defined(__clang__))
+#define HAVE_SWAP_RUNTIME_SSSE3
+#endif
+
 #ifdef __SSSE3__
 #include <tmmintrin.h>
 /* swap 16 bytes according to mask, values must be 16 byte aligned */
@@ -54,6 +64,29 @@ static inline size_t get_peel(void * addr, size_t esize, size_t nvals,
 }
 #endif
 
+#ifdef HAVE_SWAP_RUNTIME_SSSE3
+#include <tmmintrin.h>
+
+static int have_ssse3 = -1;   /* -1 means not yet probed */
+
+static int swap_use_ssse3(void)
+{
+    if (have_ssse3 < 0)
+        have_ssse3 = __builtin_cpu_supports("ssse3");
+    return have_ssse3;
+}
+
+/* same kernel as swap_ssse3 above, compiled with SSSE3 enabled for just
+ * this function so the file as a whole needs no special flags */
+__attribute__((target("ssse3")))
+static inline void swap_ssse3_rt(char * values, __m128i mask)
+{
+    __m128i v = _mm_load_si128((__m128i *)values);
+    __m128i s = _mm_shuffle_epi8(v, mask);
+    _mm_store_si128((__m128i*)values, s);
+}
+#endif
+
 /*--------------------------------------------------------------------------*/
 static void ffswap2_slow(short *svalues, long nvals)
 {
@@ -159,12 +192,36 @@ void ffswap4(INT32BIT *ivalues,  /* IO - pointer to INT*4 to be swapped    */
     ffswap4_slow(&ivalues[ii], nvals - ii);
 }
 #else
+#ifdef HAVE_SWAP_RUNTIME_SSSE3
+__attribute__((target("ssse3")))
+static void ffswap4_ssse3(INT32BIT *ivalues, long nvals)
+{
+    long ii;
+    const __m128i cmask4 = _mm_set_epi8(12, 13, 14, 15,
+                                        8, 9, 10, 11,
+                                        4, 5, 6, 7,
+                                        0, 1, 2 ,3);
+    size_t peel = get_peel((void*)&ivalues[0], sizeof(ivalues[0]), nvals, 16);
+    ffswap4_slow(ivalues, peel);
+    for (ii = peel; ii < (nvals - peel - (nvals - peel) % 4); ii+=4) {
+        swap_ssse3_rt((char*)&ivalues[ii], cmask4);
+    }
+    ffswap4_slow(&ivalues[ii], nvals - ii);
+}
+#endif
+
 void ffswap4(INT32BIT *ivalues,  /* IO - pointer to INT*4 to be swapped    */
                  long nvals)     /* I  - number of floats to be swapped     */
 /*
   swap the bytes in the input 4-byte integer: ( 0 1 2 3 -> 3 2 1 0 )
 */
 {
+#ifdef HAVE_SWAP_RUNTIME_SSSE3
+    if ((long)ivalues % 4 == 0 && swap_use_ssse3()) {
+        ffswap4_ssse3(ivalues, nvals);
+        return;
+    }
+#endif
     ffswap4_slow(ivalues, nvals);
 }
 #endif
@@ -236,12 +293,34 @@ void ffswap8(double *dvalues,  /* IO - pointer to doubles to be swapped     */
     ffswap8_slow(&dvalues[ii], nvals - ii);
 }
 #else
+#ifdef HAVE_SWAP_RUNTIME_SSSE3
+__attribute__((target("ssse3")))
+static void ffswap8_ssse3(double *dvalues, long nvals)
+{
+    long ii;
+    const __m128i cmask8 = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,
+                                        0, 1, 2 ,3, 4, 5, 6, 7);
+    size_t peel = get_peel((void*)&dvalues[0], sizeof(dvalues[0]), nvals, 16);
+    ffswap8_slow(dvalues, peel);
+    for (ii = peel; ii < (nvals - peel - (nvals - peel) % 2); ii+=2) {
+        swap_ssse3_rt((char*)&dvalues[ii], cmask8);
+    }
+    ffswap8_slow(&dvalues[ii], nvals - ii);
+}
+#endif
+
 void ffswap8(double *dvalues,  /* IO - pointer to doubles to be swapped     */
              long nvals)       /* I  - number of doubles to be swapped      */
 /*
   swap the bytes in the input doubles: ( 01234567  -> 76543210 )
 */
 {
+#ifdef HAVE_SWAP_RUNTIME_SSSE3
+    if ((long)dvalues % 8 == 0 && swap_use_ssse3()) {
+        ffswap8_ssse3(dvalues, nvals);
+        return;
+    }
+#endif
     ffswap8_slow(dvalues, nvals);
 }
 #endif
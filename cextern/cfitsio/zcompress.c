@@ -7,6 +7,25 @@
 unsigned int GZBUFSIZE = 115200;  /* 40 FITS blocks */
 int BUFFINCR = 28800;  /* 10 FITS blocks */
 
+/* On most platforms the gzip compression can optionally be spread over
+   several threads: the input is split into large blocks that are deflated
+   independently and the resulting gzip members are simply concatenated,
+   which is the same technique (and produces the same kind of multi-member
+   file) as the pigz utility.  The decompression routines below accept such
+   concatenated members whether or not threading is available. */
+#if !defined(_WIN32)
+#define HAVE_GZIP_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define GZIP_MAX_THREADS 16
+#define GZIP_MEMBER_SIZE 4147200L  /* input bytes per gzip member (1440 FITS blocks) */
+
+static int gzip_nthreads = 1;  /* no. of threads to use when compressing */
+
+int fits_gzip_set_threads(int nthreads);
+
 /* prototype for the following functions */
 int uncompress2mem(char *filename, 
              FILE *diskfile, 
@@ -40,14 +59,206 @@ int compress2mem_from_mem(
              size_t *filesize,  
              int *status);
 
-int compress2file_from_mem(                                                
-             char *inmemptr,     
-             size_t inmemsize, 
-             FILE *outdiskfile, 
+int compress2file_from_mem(
+             char *inmemptr,
+             size_t inmemsize,
+             FILE *outdiskfile,
              size_t *filesize,   /* O - size of file, in bytes              */
              int *status);
 
+#ifdef HAVE_GZIP_THREADS
+
+typedef struct {  /* one independently compressed gzip member */
+    char *in;          /* input bytes belonging to this member     */
+    size_t insize;
+    char *out;         /* malloc'ed buffer holding the member      */
+    size_t outlen;     /* compressed length of the member          */
+    int err;
+} gzmember;
+
+typedef struct {  /* the contiguous range of members done by one thread */
+    gzmember *members;
+    int first;
+    int count;
+} gzrange;
+
+typedef struct {  /* state for the background file reader thread */
+    FILE *diskfile;
+    char *buff;
+    int len;
+    int err;
+} gzreader;
+
+static gzmember *gzip_parallel_deflate(char *inmemptr, size_t inmemsize,
+    int *nmembers);
+static void *gzip_member_run(void *arg);
+static void *gzip_read_run(void *arg);
+
+/*--------------------------------------------------------------------------*/
+static void *gzip_member_run(void *arg)
+/*
+   Thread start routine: deflate each input block in the assigned range
+   into an independent gzip member, using the same deflate parameters as
+   the single-stream code path.
+*/
+{
+    gzrange *range = (gzrange *) arg;
+    gzmember *member;
+    size_t outsize;
+    int ii, err;
+    z_stream c_stream;
+
+    for (ii = 0; ii < range->count; ii++)
+    {
+        member = range->members + range->first + ii;
+
+        c_stream.zalloc = (alloc_func)0;
+        c_stream.zfree = (free_func)0;
+        c_stream.opaque = (voidpf)0;
+
+        err = deflateInit2(&c_stream, Z_BEST_SPEED, Z_DEFLATED,
+                           (15+16), 8, Z_DEFAULT_STRATEGY);
+        if (err != Z_OK) {
+            member->err = 1;
+            continue;
+        }
+
+        /* deflateBound gives the worst case for a single deflate stream,
+           so the whole member always fits and no realloc loop is needed */
+        outsize = deflateBound(&c_stream, member->insize) + 32;
+        member->out = (char *) malloc(outsize);
+        if (!member->out) {
+            deflateEnd(&c_stream);
+            member->err = 1;
+            continue;
+        }
+
+        c_stream.next_in = (unsigned char *) member->in;
+        c_stream.avail_in = member->insize;
+        c_stream.next_out = (unsigned char *) member->out;
+        c_stream.avail_out = outsize;
+
+        err = deflate(&c_stream, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            deflateEnd(&c_stream);
+            member->err = 1;
+            continue;
+        }
+
+        member->outlen = c_stream.total_out;
+        if (deflateEnd(&c_stream) != Z_OK)
+            member->err = 1;
+    }
+    return(NULL);
+}
+/*--------------------------------------------------------------------------*/
+static gzmember *gzip_parallel_deflate(
+             char *inmemptr,     /* I - memory pointer to uncompressed bytes */
+             size_t inmemsize,   /* I - size of input uncompressed file      */
+             int *nmembers)      /* O - number of gzip members produced      */
+/*
+   Compress the input into a sequence of independent gzip members, one per
+   GZIP_MEMBER_SIZE bytes of input, spread over the worker threads.
+   Returns the malloc'ed member array (the caller writes out and then
+   frees the member buffers) or NULL if the parallel attempt failed, in
+   which case the caller falls back to the single-stream code path.
+*/
+{
+    pthread_t threads[GZIP_MAX_THREADS];
+    gzrange ranges[GZIP_MAX_THREADS];
+    gzmember *members;
+    int nmem, nthreads, perthread, idx, ii, bad = 0;
+
+    nmem = (int) ((inmemsize + GZIP_MEMBER_SIZE - 1) / GZIP_MEMBER_SIZE);
+
+    members = (gzmember *) calloc(nmem, sizeof(gzmember));
+    if (!members) return(NULL);
+
+    for (ii = 0; ii < nmem; ii++) {
+        members[ii].in = inmemptr + (size_t) ii * GZIP_MEMBER_SIZE;
+        members[ii].insize = GZIP_MEMBER_SIZE;
+    }
+    members[nmem - 1].insize =
+        inmemsize - (size_t) (nmem - 1) * GZIP_MEMBER_SIZE;
+
+    nthreads = gzip_nthreads;
+    if (nthreads > nmem) nthreads = nmem;
+    perthread = (nmem + nthreads - 1) / nthreads;
+
+    for (idx = 0; idx < nthreads; idx++)
+    {
+        ranges[idx].members = members;
+        ranges[idx].first = idx * perthread;
+        ranges[idx].count = nmem - ranges[idx].first;
+        if (ranges[idx].count > perthread) ranges[idx].count = perthread;
+        if (ranges[idx].count < 0) ranges[idx].count = 0;
+
+        /* the last range runs on the calling thread; if a worker thread
+           cannot be created, just run its range here as well */
+        if (idx == nthreads - 1 ||
+            pthread_create(&threads[idx], NULL, gzip_member_run,
+                           &ranges[idx]) != 0)
+        {
+            threads[idx] = pthread_self();
+            gzip_member_run(&ranges[idx]);
+        }
+    }
+
+    for (idx = 0; idx < nthreads; idx++) {
+        if (!pthread_equal(threads[idx], pthread_self()))
+            pthread_join(threads[idx], NULL);
+    }
+
+    for (ii = 0; ii < nmem; ii++)
+        if (members[ii].err) bad = 1;
+
+    if (bad) {
+        for (ii = 0; ii < nmem; ii++)
+            if (members[ii].out) free(members[ii].out);
+        free(members);
+        return(NULL);
+    }
 
+    *nmembers = nmem;
+    return(members);
+}
+/*--------------------------------------------------------------------------*/
+static void *gzip_read_run(void *arg)
+/*
+   Thread start routine: read the next buffer of compressed bytes from the
+   disk file while the calling thread inflates the previous one.
+*/
+{
+    gzreader *reader = (gzreader *) arg;
+
+    reader->len = fread(reader->buff, 1, GZBUFSIZE, reader->diskfile);
+    reader->err = ferror(reader->diskfile);
+    return(NULL);
+}
+#endif  /* HAVE_GZIP_THREADS */
+
+/*--------------------------------------------------------------------------*/
+int fits_gzip_set_threads(int nthreads)
+/*
+   Set the number of threads used to deflate the independent gzip members
+   of subsequent compress2mem_from_mem and compress2file_from_mem calls:
+   1 disables threading and 0 means one thread per processor.  Returns the
+   effective setting.
+*/
+{
+#ifdef HAVE_GZIP_THREADS
+    if (nthreads < 0) nthreads = 1;
+    if (nthreads == 0) {
+	long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = (nproc > 0) ? (int) nproc : 1;
+    }
+    if (nthreads > GZIP_MAX_THREADS) nthreads = GZIP_MAX_THREADS;
+    gzip_nthreads = nthreads;
+#else
+    gzip_nthreads = 1;
+#endif
+    return(gzip_nthreads);
+}
 /*--------------------------------------------------------------------------*/
 int uncompress2mem(char *filename,  /* name of input file                 */
              FILE *diskfile,     /* I - file pointer                        */
@@ -65,15 +276,31 @@ int uncompress2mem(char *filename,  /* name of input file                 */
 {
     int err, len;
     char *filebuff;
+    size_t prevtotal = 0;  /* bytes output by the completed gzip members */
+#ifdef HAVE_GZIP_THREADS
+    char *readbuff = 0, *swapbuff;
+    gzreader reader;
+    pthread_t readthread;
+    int reading = 0;
+#endif
     z_stream d_stream;   /* decompression stream */
 
-    if (*status > 0) 
-        return(*status); 
+    if (*status > 0)
+        return(*status);
 
     /* Allocate memory to hold compressed bytes read from the file. */
     filebuff = (char*)malloc(GZBUFSIZE);
     if (!filebuff) return(*status = 113); /* memory error */
 
+#ifdef HAVE_GZIP_THREADS
+    /* When threading is enabled, a second buffer lets the next chunk of
+       the file be read in the background while this thread inflates the
+       previous one.  If the malloc fails all the reads simply happen in
+       the foreground. */
+    if (gzip_nthreads > 1)
+        readbuff = (char*)malloc(GZBUFSIZE);
+#endif
+
     d_stream.zalloc = (alloc_func)0;
     d_stream.zfree = (free_func)0;
     d_stream.opaque = (voidpf)0;
@@ -89,15 +316,50 @@ int uncompress2mem(char *filename,  /* name of input file                 */
     /* loop through the file, reading a buffer and uncompressing it */
     for (;;)
     {
-        len = fread(filebuff, 1, GZBUFSIZE, diskfile);
-	if (ferror(diskfile)) {
-              inflateEnd(&d_stream);
-              free(filebuff);
-              return(*status = 414);
-	}
+#ifdef HAVE_GZIP_THREADS
+        if (reading) {
+            /* collect the chunk that was read in the background */
+            pthread_join(readthread, NULL);
+            reading = 0;
+
+            swapbuff = filebuff;
+            filebuff = readbuff;
+            readbuff = swapbuff;
+
+            len = reader.len;
+            if (reader.err) {
+                inflateEnd(&d_stream);
+                free(filebuff);
+                free(readbuff);
+                return(*status = 414);
+            }
+        } else
+#endif
+        {
+            len = fread(filebuff, 1, GZBUFSIZE, diskfile);
+	    if (ferror(diskfile)) {
+                  inflateEnd(&d_stream);
+                  free(filebuff);
+#ifdef HAVE_GZIP_THREADS
+                  if (readbuff) free(readbuff);
+#endif
+                  return(*status = 414);
+	    }
+        }
 
         if (len == 0) break;  /* no more data */
 
+#ifdef HAVE_GZIP_THREADS
+        if (readbuff && !feof(diskfile)) {
+            /* start reading the next chunk into the spare buffer; if the
+               thread cannot be created it is read in the foreground */
+            reader.diskfile = diskfile;
+            reader.buff = readbuff;
+            if (pthread_create(&readthread, NULL, gzip_read_run, &reader) == 0)
+                reading = 1;
+        }
+#endif
+
         d_stream.next_in = (unsigned char*)filebuff;
         d_stream.avail_in = len;
 
@@ -105,18 +367,46 @@ int uncompress2mem(char *filename,  /* name of input file                 */
             /* uncompress as much of the input as will fit in the output */
             err = inflate(&d_stream, Z_NO_FLUSH);
 
-            if (err == Z_STREAM_END ) { /* We reached the end of the input */
-	        break; 
-            } else if (err == Z_OK ) { 
+            if (err == Z_STREAM_END ) { /* reached the end of a gzip member */
+
+                /* The file may contain several concatenated gzip members
+                   (as written by the threaded compression routines below,
+                   or by utilities such as pigz), so keep inflating if
+                   another member follows; any other bytes after the end
+                   of the member are trailing padding to be ignored. */
+                if (d_stream.avail_in >= 2 &&
+                   (d_stream.next_in[0] != 0x1f || d_stream.next_in[1] != 0x8b)) {
+                    len = 0;  /* quit the outer read loop too */
+                    break;
+                }
+
+                prevtotal += d_stream.total_out;  /* reset clears total_out */
+                if (inflateReset(&d_stream) != Z_OK) {
+                    inflateEnd(&d_stream);
+                    free(filebuff);
+#ifdef HAVE_GZIP_THREADS
+                    if (reading) pthread_join(readthread, NULL);
+                    if (readbuff) free(readbuff);
+#endif
+                    return(*status = 414);
+                }
 
                 if (!d_stream.avail_in) break; /* need more input */
-		
+
+            } else if (err == Z_OK ) {
+
+                if (!d_stream.avail_in) break; /* need more input */
+
                 /* need more space in output buffer */
-                if (mem_realloc) {   
+                if (mem_realloc) {
                     *buffptr = mem_realloc(*buffptr,*buffsize + BUFFINCR);
                     if (*buffptr == NULL){
                         inflateEnd(&d_stream);
                         free(filebuff);
+#ifdef HAVE_GZIP_THREADS
+                        if (reading) pthread_join(readthread, NULL);
+                        if (readbuff) free(readbuff);
+#endif
                         return(*status = 414);  /* memory allocation failed */
                     }
 
@@ -126,29 +416,49 @@ int uncompress2mem(char *filename,  /* name of input file                 */
                 } else  { /* error: no realloc function available */
                     inflateEnd(&d_stream);
                     free(filebuff);
+#ifdef HAVE_GZIP_THREADS
+                    if (reading) pthread_join(readthread, NULL);
+                    if (readbuff) free(readbuff);
+#endif
                     return(*status = 414);
                 }
             } else {  /* some other error */
                 inflateEnd(&d_stream);
                 free(filebuff);
+#ifdef HAVE_GZIP_THREADS
+                if (reading) pthread_join(readthread, NULL);
+                if (readbuff) free(readbuff);
+#endif
                 return(*status = 414);
             }
         }
-	
+
+	if (len == 0) break;  /* hit trailing padding after a gzip member */
+
+#ifdef HAVE_GZIP_THREADS
+	if (feof(diskfile) && !reading)  break;
+#else
 	if (feof(diskfile))  break;
+#endif
 
-        d_stream.next_out = (unsigned char*) (*buffptr + d_stream.total_out);
-        d_stream.avail_out = *buffsize - d_stream.total_out;
+        d_stream.next_out = (unsigned char*)
+                            (*buffptr + prevtotal + d_stream.total_out);
+        d_stream.avail_out = *buffsize - (prevtotal + d_stream.total_out);
     }
 
     /* Set the output file size to be the total output data */
-    *filesize = d_stream.total_out;
-    
+    *filesize = prevtotal + d_stream.total_out;
+
     free(filebuff); /* free temporary output data buffer */
-    
+
+#ifdef HAVE_GZIP_THREADS
+    if (reading) pthread_join(readthread, NULL);  /* discard the last read */
+    if (readbuff) free(readbuff);
+#endif
+
     err = inflateEnd(&d_stream); /* End the decompression */
     if (err != Z_OK) return(*status = 414);
-  
+
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -167,11 +477,12 @@ int uncompress2mem_from_mem(
   input function, if necessary.
 */
 {
-    int err; 
+    int err;
+    size_t prevtotal = 0;  /* bytes output by the completed gzip members */
     z_stream d_stream;   /* decompression stream */
 
-    if (*status > 0) 
-        return(*status); 
+    if (*status > 0)
+        return(*status);
 
     d_stream.zalloc = (alloc_func)0;
     d_stream.zfree = (free_func)0;
@@ -192,8 +503,21 @@ int uncompress2mem_from_mem(
         /* uncompress as much of the input as will fit in the output */
         err = inflate(&d_stream, Z_NO_FLUSH);
 
-        if (err == Z_STREAM_END) { /* We reached the end of the input */
-	    break; 
+        if (err == Z_STREAM_END) { /* reached the end of a gzip member */
+
+            /* The input may contain several concatenated gzip members (as
+               written by the threaded compression routines below, or by
+               utilities such as pigz), so keep inflating if another member
+               follows; any other remaining bytes are trailing padding. */
+            if (d_stream.avail_in < 2 ||
+                d_stream.next_in[0] != 0x1f || d_stream.next_in[1] != 0x8b)
+	        break;
+
+            prevtotal += d_stream.total_out;  /* reset clears total_out */
+            if (inflateReset(&d_stream) != Z_OK) {
+                inflateEnd(&d_stream);
+                return(*status = 414);
+            }
         } else if (err == Z_OK ) { /* need more space in output buffer */
 
             if (mem_realloc) {   
@@ -218,13 +542,13 @@ int uncompress2mem_from_mem(
     }
 
     /* Set the output file size to be the total output data */
-    if (filesize) *filesize = d_stream.total_out;
+    if (filesize) *filesize = prevtotal + d_stream.total_out;
 
     /* End the decompression */
     err = inflateEnd(&d_stream);
 
     if (err != Z_OK) return(*status = 414);
-    
+
     return(*status);
 }
 /*--------------------------------------------------------------------------*/
@@ -238,6 +562,7 @@ int uncompress2file(char *filename,  /* name of input file                  */
 {
     int err, len;
     unsigned long bytes_out = 0;
+    size_t prevtotal = 0;  /* bytes output by the completed gzip members */
     char *infilebuff, *outfilebuff;
     z_stream d_stream;   /* decompression stream */
 
@@ -284,12 +609,33 @@ int uncompress2file(char *filename,  /* name of input file                  */
             /* uncompress as much of the input as will fit in the output */
             err = inflate(&d_stream, Z_NO_FLUSH);
 
-            if (err == Z_STREAM_END ) { /* We reached the end of the input */
-	        break; 
-            } else if (err == Z_OK ) { 
+            if (err == Z_STREAM_END ) { /* reached the end of a gzip member */
+
+                /* The file may contain several concatenated gzip members
+                   (as written by the threaded compression routines below,
+                   or by utilities such as pigz), so keep inflating if
+                   another member follows; any other bytes after the end
+                   of the member are trailing padding to be ignored. */
+                if (d_stream.avail_in >= 2 &&
+                   (d_stream.next_in[0] != 0x1f || d_stream.next_in[1] != 0x8b)) {
+                    len = 0;  /* quit the outer read loop too */
+                    break;
+                }
+
+                prevtotal += d_stream.total_out;  /* reset clears total_out */
+                if (inflateReset(&d_stream) != Z_OK) {
+                    inflateEnd(&d_stream);
+                    free(infilebuff);
+                    free(outfilebuff);
+                    return(*status = 414);
+                }
+
+                if (!d_stream.avail_in) break; /* need more input */
+
+            } else if (err == Z_OK ) {
 
                 if (!d_stream.avail_in) break; /* need more input */
-		
+
                 /* flush out the full output buffer */
                 if ((int)fwrite(outfilebuff, 1, GZBUFSIZE, outdiskfile) != GZBUFSIZE) {
                     inflateEnd(&d_stream);
@@ -308,14 +654,16 @@ int uncompress2file(char *filename,  /* name of input file                  */
                 return(*status = 414);
             }
         }
-	
+
+	if (len == 0) break;  /* hit trailing padding after a gzip member */
+
 	if (feof(indiskfile))  break;
     }
 
     /* write out any remaining bytes in the buffer */
-    if (d_stream.total_out > bytes_out) {
-        if ((int)fwrite(outfilebuff, 1, (d_stream.total_out - bytes_out), outdiskfile) 
-	    != (d_stream.total_out - bytes_out)) {
+    if (prevtotal + d_stream.total_out > bytes_out) {
+        if ((int)fwrite(outfilebuff, 1, (prevtotal + d_stream.total_out - bytes_out), outdiskfile)
+	    != (prevtotal + d_stream.total_out - bytes_out)) {
             inflateEnd(&d_stream);
             free(infilebuff);
             free(outfilebuff);
@@ -353,6 +701,50 @@ int compress2mem_from_mem(
     if (*status > 0)
         return(*status);
 
+#ifdef HAVE_GZIP_THREADS
+    /* If threading has been requested and the input is large enough to
+       split, compress independent blocks of the input in parallel and
+       concatenate the resulting gzip members.  If the parallel attempt
+       fails for any reason, fall through to the single-stream code. */
+    if (gzip_nthreads > 1 && inmemsize >= 2 * GZIP_MEMBER_SIZE)
+    {
+        gzmember *members;
+        size_t total = 0;
+        int nmem, ii;
+
+        members = gzip_parallel_deflate(inmemptr, inmemsize, &nmem);
+        if (members)
+        {
+            for (ii = 0; ii < nmem; ii++)
+                total += members[ii].outlen;
+
+            if (total > *buffsize) {
+                if (mem_realloc)
+                    *buffptr = mem_realloc(*buffptr, total);
+
+                if (!mem_realloc || *buffptr == NULL) {
+                    for (ii = 0; ii < nmem; ii++)
+                        free(members[ii].out);
+                    free(members);
+                    return(*status = 413);
+                }
+                *buffsize = total;
+            }
+
+            total = 0;
+            for (ii = 0; ii < nmem; ii++) {
+                memcpy(*buffptr + total, members[ii].out, members[ii].outlen);
+                total += members[ii].outlen;
+                free(members[ii].out);
+            }
+            free(members);
+
+            if (filesize) *filesize = total;
+            return(*status);
+        }
+    }
+#endif
+
     c_stream.zalloc = (alloc_func)0;
     c_stream.zfree = (free_func)0;
     c_stream.opaque = (voidpf)0;
@@ -431,6 +823,39 @@ int compress2file_from_mem(
     if (*status > 0)
         return(*status);
 
+#ifdef HAVE_GZIP_THREADS
+    /* If threading has been requested and the input is large enough to
+       split, compress independent blocks of the input in parallel and
+       write out the resulting gzip members one after the other.  If the
+       parallel attempt fails, fall through to the single-stream code. */
+    if (gzip_nthreads > 1 && inmemsize >= 2 * GZIP_MEMBER_SIZE)
+    {
+        gzmember *members;
+        size_t total = 0;
+        int nmem, ii, jj;
+
+        members = gzip_parallel_deflate(inmemptr, inmemsize, &nmem);
+        if (members)
+        {
+            for (ii = 0; ii < nmem; ii++) {
+                if (fwrite(members[ii].out, 1, members[ii].outlen, outdiskfile)
+                    != members[ii].outlen) {
+                    for (jj = ii; jj < nmem; jj++)
+                        free(members[jj].out);
+                    free(members);
+                    return(*status = 413);
+                }
+                total += members[ii].outlen;
+                free(members[ii].out);
+            }
+            free(members);
+
+            if (filesize) *filesize = total;
+            return(*status);
+        }
+    }
+#endif
+
     /* Allocate buffer to hold compressed bytes */
     outfilebuff = (char*)malloc(GZBUFSIZE);
     if (!outfilebuff) return(*status = 113); /* memory error */
@@ -0,0 +1,295 @@
+"""
+End-to-end benchmarks for the PyFITS hot paths.
+
+Run the full suite with::
+
+    python -m pyfits.benchmarks
+
+or write machine-readable results for regression tracking with::
+
+    python -m pyfits.benchmarks --output results.json
+
+Each benchmark builds its own synthetic input in a temporary directory,
+runs the timed operation several times, and reports the best time, so the
+numbers are reasonably stable across runs on an otherwise idle machine.
+Comparing the JSON output from two source revisions (for example with the
+``--baseline`` option) is the intended way to catch performance regressions
+before a release.
+"""
+
+
+from __future__ import division, with_statement
+
+
+import optparse
+import os
+import shutil
+import sys
+import tempfile
+import time
+
+try:
+    import json
+except ImportError:
+    json = None
+
+import numpy as np
+
+import pyfits
+from pyfits.extern.six.moves import range
+
+
+__all__ = ['run_benchmarks', 'main']
+
+
+if sys.platform == 'win32':
+    # On Windows time.clock has a much better resolution than time.time
+    _timer = time.clock
+else:
+    _timer = time.time
+
+_BENCHMARKS = []
+
+
+def _benchmark(func):
+    """Registers a function in the benchmark suite."""
+
+    _BENCHMARKS.append(func)
+    return func
+
+
+def _time(func, repeat=3):
+    """Returns the best wall-clock time of ``repeat`` runs of ``func``."""
+
+    best = None
+    for _ in range(repeat):
+        start = _timer()
+        func()
+        elapsed = _timer() - start
+        if best is None or elapsed < best:
+            best = elapsed
+    return best
+
+
+@_benchmark
+def header_fromfile(tmpdir):
+    """Parsing a many-card header from a file."""
+
+    header = pyfits.Header()
+    for idx in range(5000):
+        header['KEY%d' % idx] = (idx, 'comment for keyword %d' % idx)
+    filename = os.path.join(tmpdir, 'header.fits')
+    with open(filename, 'wb') as fileobj:
+        header.tofile(fileobj)
+
+    def parse():
+        with open(filename, 'rb') as fileobj:
+            pyfits.Header.fromfile(fileobj)
+
+    yield 'header_fromfile_5000_cards', _time(parse)
+
+
+@_benchmark
+def fits_rec_field(tmpdir):
+    """Reading and converting binary table columns via FITS_rec.field."""
+
+    nrows = 500000
+    columns = [
+        pyfits.Column(name='index', format='J',
+                      array=np.arange(nrows, dtype=np.int32)),
+        pyfits.Column(name='scaled', format='I', bscale=2.0, bzero=32768,
+                      array=np.zeros(nrows, dtype=np.int16)),
+        pyfits.Column(name='name', format='10A',
+                      array=np.resize(np.array(['row%06d' % idx
+                                                for idx in range(100)]),
+                                      nrows)),
+    ]
+    hdu = pyfits.BinTableHDU.from_columns(columns)
+    filename = os.path.join(tmpdir, 'table.fits')
+    hdu.writeto(filename)
+
+    def read_fields():
+        hdulist = pyfits.open(filename, memmap=False)
+        try:
+            data = hdulist[1].data
+            for name in ('index', 'scaled', 'name'):
+                data.field(name)
+        finally:
+            hdulist.close()
+
+    yield 'fits_rec_field_500k_rows', _time(read_fields)
+
+
+@_benchmark
+def section_reads(tmpdir):
+    """Reading rows and tiles of an image through the section interface."""
+
+    data = np.arange(2048 * 2048, dtype=np.float32).reshape((2048, 2048))
+    filename = os.path.join(tmpdir, 'image.fits')
+    pyfits.PrimaryHDU(data=data).writeto(filename)
+
+    def read_rows():
+        hdulist = pyfits.open(filename, memmap=False)
+        try:
+            for row in range(0, 2048, 64):
+                hdulist[0].section[row, :]
+        finally:
+            hdulist.close()
+
+    def read_tile():
+        hdulist = pyfits.open(filename, memmap=False)
+        try:
+            hdulist[0].section[768:1280, 768:1280]
+        finally:
+            hdulist.close()
+
+    yield 'section_read_rows', _time(read_rows)
+    yield 'section_read_tile_512', _time(read_tile)
+
+
+@_benchmark
+def hdulist_open_flush(tmpdir):
+    """Opening and flushing a file with many extensions."""
+
+    filename = os.path.join(tmpdir, 'manyext.fits')
+    hdus = [pyfits.PrimaryHDU()]
+    for idx in range(200):
+        hdus.append(pyfits.ImageHDU(data=np.arange(100, dtype=np.int32),
+                                    name='EXT%d' % idx))
+    pyfits.HDUList(hdus).writeto(filename)
+
+    def open_all():
+        hdulist = pyfits.open(filename)
+        try:
+            # Force every header to actually be read
+            for hdu in hdulist:
+                hdu.header
+        finally:
+            hdulist.close()
+
+    def flush_one_keyword():
+        hdulist = pyfits.open(filename, mode='update')
+        try:
+            hdulist[100].header['TOUCHED'] = True
+            hdulist.flush()
+        finally:
+            hdulist.close()
+
+    yield 'hdulist_open_200_ext', _time(open_all)
+    yield 'hdulist_flush_one_keyword', _time(flush_one_keyword)
+
+
+@_benchmark
+def compression(tmpdir):
+    """Tile compression and decompression per codec and tile size."""
+
+    try:
+        from pyfits import compression  # noqa
+    except ImportError:
+        # The compression module is an optional extension; report nothing
+        # rather than failing the whole suite
+        return
+
+    data = np.random.RandomState(42).poisson(
+        100, (1024, 1024)).astype(np.int32)
+
+    for codec in ('RICE_1', 'GZIP_1', 'PLIO_1', 'HCOMPRESS_1'):
+        for tile_size in (None, [64, 64]):
+            if codec == 'HCOMPRESS_1' and tile_size is None:
+                # HCOMPRESS requires two-dimensional tiles
+                continue
+            if tile_size is None:
+                label = 'row'
+            else:
+                label = '%dx%d' % tuple(tile_size)
+            filename = os.path.join(
+                tmpdir, 'comp_%s_%s.fits' % (codec, label))
+
+            def compress():
+                hdu = pyfits.CompImageHDU(data=data.copy(),
+                                          compression_type=codec,
+                                          tile_size=tile_size)
+                hdu.writeto(filename, clobber=True)
+
+            yield 'compress_%s_tile_%s' % (codec, label), _time(compress)
+
+            def decompress():
+                hdulist = pyfits.open(filename)
+                try:
+                    hdulist[1].data
+                finally:
+                    hdulist.close()
+
+            yield 'decompress_%s_tile_%s' % (codec, label), _time(decompress)
+
+
+def run_benchmarks(names=None):
+    """
+    Run the benchmark suite and return a list of ``(name, seconds)`` results.
+
+    If ``names`` is given, only benchmarks whose function name is in it are
+    run.
+    """
+
+    results = []
+    for func in _BENCHMARKS:
+        if names and func.__name__ not in names:
+            continue
+        tmpdir = tempfile.mkdtemp(prefix='pyfits-bench-')
+        try:
+            for name, seconds in func(tmpdir):
+                results.append((name, seconds))
+                sys.stdout.write('%-40s %10.4f s\n' % (name, seconds))
+                sys.stdout.flush()
+        finally:
+            shutil.rmtree(tmpdir, ignore_errors=True)
+    return results
+
+
+def main(args=None):
+    parser = optparse.OptionParser(
+        usage='%prog [options] [benchmark-name ...]',
+        description='Run the PyFITS performance benchmark suite.  With no '
+                    'arguments all benchmarks are run; otherwise only the '
+                    'named ones (choices: %s).' %
+                    ', '.join(func.__name__ for func in _BENCHMARKS))
+    parser.add_option('-o', '--output', metavar='FILE',
+                      help='write the results as JSON to FILE')
+    parser.add_option('-b', '--baseline', metavar='FILE',
+                      help='compare the results against a previous JSON '
+                           'output file and report the relative change')
+    opts, args = parser.parse_args(args)
+
+    if (opts.output or opts.baseline) and json is None:
+        parser.error('the json module is required for --output/--baseline')
+
+    results = run_benchmarks(args or None)
+
+    if opts.output:
+        output = {'version': pyfits.__version__,
+                  'results': dict(results)}
+        fileobj = open(opts.output, 'w')
+        try:
+            json.dump(output, fileobj, indent=2, sort_keys=True)
+            fileobj.write('\n')
+        finally:
+            fileobj.close()
+
+    if opts.baseline:
+        fileobj = open(opts.baseline, 'r')
+        try:
+            baseline = json.load(fileobj)['results']
+        finally:
+            fileobj.close()
+        sys.stdout.write('\nComparison against %s:\n' % opts.baseline)
+        for name, seconds in results:
+            if name not in baseline or not baseline[name]:
+                continue
+            change = (seconds / baseline[name] - 1.0) * 100
+            sys.stdout.write('%-40s %+8.1f%%\n' % (name, change))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
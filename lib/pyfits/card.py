@@ -403,6 +403,10 @@ class Card(_Verify):
 
     _commentary_keywords = set(['', 'COMMENT', 'HISTORY', 'END'])
 
+    # The characters that may appear in a fixed-format integer or floating
+    # point value; used by the fast value scanner in _parse_value_fast
+    _fast_number_chars = frozenset('+-.0123456789eE')
+
     # The default value indicator; may be changed if required by a convention
     # (namely HIERARCH cards)
     _value_indicator = VALUE_INDICATOR
@@ -992,19 +996,28 @@ class Card(_Verify):
             return self._value
 
         if len(self._image) > self.length:
-            values = []
-            for card in self._itersubcards():
-                value = card.value.rstrip().replace("''", "'")
-                if value and value[-1] == '&':
-                    value = value[:-1]
-                values.append(value)
-
-            value = ''.join(values)
-
+            value, comment = self._parse_long_card()
             self._valuestring = value
+            # Cache the comment as well, so that accessing it does not
+            # require a second pass over all the CONTINUE subcards
+            if self._comment is None:
+                self._comment = comment
             return value
 
-        m = self._value_NFSC_RE.match(self._split()[1])
+        valuecomment = self._split()[1]
+
+        # The fast scanner recognizes the simple fixed-format values
+        # (logicals, plain numbers, unescaped strings) that make up the vast
+        # majority of real-world headers without paying for the full value
+        # regex; anything it does not recognize falls through to the regex
+        fast = self._parse_value_fast(valuecomment)
+        if fast is not None:
+            value, valuestring = fast
+            if not self._valuestring:
+                self._valuestring = valuestring
+            return value
+
+        m = self._value_NFSC_RE.match(valuecomment)
 
         if m is None:
             raise VerifyError("Unparsable card (%s), fix it first with "
@@ -1047,6 +1060,75 @@ class Card(_Verify):
             self._valuestring = m.group('valu')
         return value
 
+    @classmethod
+    def _parse_value_fast(cls, valuecomment):
+        """
+        Attempt to parse the value/comment portion of a card image using
+        plain string operations, avoiding the (comparatively expensive)
+        `_value_NFSC_RE` regular expression for the common cases of logical,
+        simple numeric, and simple string values.
+
+        Returns a ``(value, valuestring)`` tuple on success, where
+        ``valuestring`` is exactly what the ``valu`` group of the regex would
+        have matched, or `None` if the value is not recognized, in which case
+        the caller should fall back on the full regex.
+        """
+
+        qidx = valuecomment.find("'")
+        if qidx >= 0:
+            # A quoted string value; only handle the simple case of a string
+            # with no escaped (doubled) quotes, followed by nothing but an
+            # optional comment
+            if valuecomment[:qidx].strip() or "''" in valuecomment:
+                return None
+            end = valuecomment.find("'", qidx + 1)
+            if end < 0:
+                return None
+            strg = valuecomment[qidx + 1:end]
+            if strg and not cls._ascii_text_re.match(strg):
+                return None
+            tail = valuecomment[end + 1:]
+            if tail and tail[0] not in ' /':
+                return None
+            tail = tail.lstrip()
+            if tail and tail[0] != '/':
+                return None
+            return strg, valuecomment[qidx:end + 1]
+
+        slash = valuecomment.find('/')
+        if slash >= 0:
+            value_part = valuecomment[:slash]
+        else:
+            value_part = valuecomment
+        stripped = value_part.strip()
+
+        if not stripped:
+            return UNDEFINED, None
+
+        if stripped in ('T', 'F'):
+            return stripped == 'T', stripped
+
+        # A simple number; the character check rules out anything (spaces
+        # within the number, D exponents, complex values, non-ASCII digits)
+        # that int()/float() would not handle identically to the regex
+        for char in stripped:
+            if char not in cls._fast_number_chars:
+                return None
+        if not any(char.isdigit() for char in stripped):
+            return None
+        try:
+            value = int(stripped)
+        except ValueError:
+            try:
+                value = float(stripped)
+            except ValueError:
+                return None
+        # The valu group keeps any spaces between the number and the comment,
+        # except after an exponent, where the regex stops at the last digit
+        if 'e' in stripped or 'E' in stripped:
+            return value, stripped
+        return value, value_part.lstrip()
+
     def _parse_comment(self):
         """Extract the keyword value from the card image."""
 
@@ -1056,14 +1138,15 @@ class Card(_Verify):
             return ''
 
         if len(self._image) > self.length:
-            comments = []
-            for card in self._itersubcards():
-                if card.comment:
-                    comments.append(card.comment)
-            comment = '/ ' + ' '.join(comments).rstrip()
-            m = self._value_NFSC_RE.match(comment)
-        else:
-            m = self._value_NFSC_RE.match(self._split()[1])
+            value, comment = self._parse_long_card()
+            # Cache the value as well, so that accessing it does not require
+            # a second pass over all the CONTINUE subcards
+            if self._value is None:
+                self._valuestring = value
+                self._value = value
+            return comment
+
+        m = self._value_NFSC_RE.match(self._split()[1])
 
         if m is not None:
             comment = m.group('comm')
@@ -1071,6 +1154,29 @@ class Card(_Verify):
                 return comment.rstrip()
         return ''
 
+    def _parse_long_card(self):
+        """
+        Parse the value and comment of a card whose image spans multiple
+        CONTINUE cards, and return them as a ``(value, comment)`` tuple.
+
+        Both are assembled in a single pass over the subcards, with the
+        segments collected through lists and joined once at the end, so that
+        reassembly stays linear in the number of CONTINUE cards.
+        """
+
+        values = []
+        comments = []
+        for card in self._itersubcards():
+            value = card.value.rstrip().replace("''", "'")
+            if value and value[-1] == '&':
+                value = value[:-1]
+            values.append(value)
+            comment = card.comment
+            if comment:
+                comments.append(comment)
+
+        return ''.join(values), ' '.join(comments).rstrip()
+
     def _split(self):
         """
         Split the card image between the keyword and the rest of the card.
@@ -1390,6 +1496,42 @@ class Card(_Verify):
 
         return errs
 
+    @classmethod
+    def _image_is_standard(cls, image):
+        """
+        Cheap single-pass check of a raw 80-character card image against the
+        checks performed by `_verify`; returns `True` only when `_verify` is
+        certain to find nothing to report, so that callers verifying a whole
+        header can skip the full per-card machinery for the (typical) case of
+        fully standard cards.
+
+        Anything unusual--HIERARCH and CONTINUE cards, long card images,
+        lowercase keywords--returns `False` and is left to the full
+        `Card._verify`.
+        """
+
+        if len(image) != cls.length:
+            return False
+
+        keyword = image[:KEYWORD_LENGTH]
+        if keyword in ('COMMENT ', 'HISTORY ', '        '):
+            # Commentary cards need only contain printable ASCII
+            return cls._ascii_text_re.match(image[KEYWORD_LENGTH:]) is not None
+
+        # The keyword must be a legal keyword charset, upper case, left
+        # justified, with the value indicator in the fixed-format position
+        stripped = keyword.rstrip()
+        if (keyword != stripped.ljust(KEYWORD_LENGTH) or
+                not cls._keywd_FSC_RE.match(stripped) or
+                image[KEYWORD_LENGTH:KEYWORD_LENGTH + 2] != '= '):
+            return False
+
+        # The remainder must be a standard fixed-format value/comment; this
+        # mirrors the value check in _verify (a full FSC match also implies
+        # the comment, if any, is printable ASCII)
+        valuecomment = image[KEYWORD_LENGTH + 2:].strip()
+        return cls._value_FSC_RE.match(valuecomment) is not None
+
     def _itersubcards(self):
         """
         If the card image is greater than 80 characters, it should consist of a
@@ -105,6 +105,24 @@ ASCIITNULL = 0          # value for ASCII table cell with value = TNULL
 # converting from binary to ASCII tables
 DEFAULT_ASCII_TNULL = '---'
 
+# Memo caches for TFORMn parsing; pipelines that open many tables with
+# identical column layouts would otherwise re-run the same regex parsing for
+# every column of every table.  The parsed results are immutable (tuples,
+# plain strings, or the str-subclass format containers, which are never
+# mutated after creation) so they can be shared freely between tables.  The
+# caches are simply emptied if an unusually varied workload fills them up.
+_PARSE_CACHE_SIZE = 1024
+_parse_tformat_cache = {}
+_parse_tdim_cache = {}
+_convert_format_cache = {}
+
+# Caches the verified column keywords (everything but the data) for a whole
+# table layout, keyed by the TTYPEn/TFORMn/etc. values from the header, so
+# that reopening a table with a previously seen layout skips the per-column
+# format parsing and keyword verification entirely
+_COLDEFS_CACHE_SIZE = 128
+_coldefs_keywords_cache = {}
+
 
 class Delayed(object):
     """Delayed file-reading data."""
@@ -1024,26 +1042,55 @@ class ColDefs(object):
                 if col <= nfields and col > 0:
                     idx = KEYWORD_NAMES.index(keyword)
                     attr = KEYWORD_ATTRIBUTES[idx]
-                    if attr == 'format':
-                        # Go ahead and convert the format value to the
-                        # appropriate ColumnFormat container now
-                        value = self._col_format_cls(value)
                     col_keywords[col - 1][attr] = value
 
-        # Verify the column keywords and display any warnings if necessary;
-        # we only want to pass on the valid keywords
-        for idx, kwargs in enumerate(col_keywords):
-            valid_kwargs, invalid_kwargs = Column._verify_keywords(**kwargs)
-            for val in invalid_kwargs.values():
-                warnings.warn(
-                    'Invalid keyword for column %d: %s' % (idx + 1, val[1]),
-                    VerifyWarning)
-            # Special cases for recformat and dim
-            # TODO: Try to eliminate the need for these special cases
-            del valid_kwargs['recformat']
-            if 'dim' in valid_kwargs:
-                valid_kwargs['dim'] = kwargs['dim']
-            col_keywords[idx] = valid_kwargs
+        # Tables from the same pipeline frequently share an identical layout;
+        # the verified keywords (everything except the data) only depend on
+        # the column definition keywords, so they can be reused wholesale for
+        # a layout that has been seen before
+        try:
+            cache_key = (self.__class__,
+                         tuple(tuple(sorted(kw.items()))
+                               for kw in col_keywords))
+        except TypeError:
+            # Unhashable keyword value; unexpected, but not worth failing for
+            cache_key = None
+
+        if cache_key is not None and cache_key in _coldefs_keywords_cache:
+            col_keywords = [dict(kw)
+                            for kw in _coldefs_keywords_cache[cache_key]]
+        else:
+            # Verify the column keywords and display any warnings if
+            # necessary; we only want to pass on the valid keywords
+            cacheable = cache_key is not None
+            for idx, kwargs in enumerate(col_keywords):
+                if 'format' in kwargs:
+                    # Go ahead and convert the format value to the
+                    # appropriate ColumnFormat container now
+                    kwargs['format'] = self._col_format_cls(kwargs['format'])
+                valid_kwargs, invalid_kwargs = \
+                    Column._verify_keywords(**kwargs)
+                for val in invalid_kwargs.values():
+                    warnings.warn(
+                        'Invalid keyword for column %d: %s' % (idx + 1,
+                                                               val[1]),
+                        VerifyWarning)
+                if invalid_kwargs:
+                    # Don't cache layouts with invalid keywords, so that the
+                    # warnings are issued again the next time around
+                    cacheable = False
+                # Special cases for recformat and dim
+                # TODO: Try to eliminate the need for these special cases
+                del valid_kwargs['recformat']
+                if 'dim' in valid_kwargs:
+                    valid_kwargs['dim'] = kwargs['dim']
+                col_keywords[idx] = valid_kwargs
+
+            if cacheable:
+                if len(_coldefs_keywords_cache) >= _COLDEFS_CACHE_SIZE:
+                    _coldefs_keywords_cache.clear()
+                _coldefs_keywords_cache[cache_key] = \
+                    [dict(kw) for kw in col_keywords]
 
         # data reading will be delayed
         for col in range(nfields):
@@ -1572,13 +1619,13 @@ def _unwrapx(input, output, repeat):
         number of bits
     """
 
-    pow2 = np.array([128, 64, 32, 16, 8, 4, 2, 1], dtype='uint8')
+    # np.unpackbits expands each byte most significant bit first, which is
+    # the FITS bit order; it only operates on flattened arrays, so go through
+    # a contiguous flattened view and restore the shape afterwards
     nbytes = ((repeat - 1) // 8) + 1
-    for i in range(nbytes):
-        _min = i * 8
-        _max = min((i + 1) * 8, repeat)
-        for j in range(_min, _max):
-            output[..., j] = np.bitwise_and(input[..., i], pow2[j - i * 8])
+    bits = np.unpackbits(np.ascontiguousarray(input).ravel())
+    bits = bits.reshape(input.shape[:-1] + (nbytes * 8,))
+    output[...] = bits[..., :repeat]
 
 
 def _wrapx(input, output, repeat):
@@ -1597,19 +1644,12 @@ def _wrapx(input, output, repeat):
         number of bits
     """
 
-    output[...] = 0  # reset the output
+    # Zero-pad the unused trailing bits of the last byte and pack most
+    # significant bit first, the FITS bit order
     nbytes = ((repeat - 1) // 8) + 1
-    unused = nbytes * 8 - repeat
-    for i in range(nbytes):
-        _min = i * 8
-        _max = min((i + 1) * 8, repeat)
-        for j in range(_min, _max):
-            if j != _min:
-                np.left_shift(output[..., i], 1, output[..., i])
-            np.add(output[..., i], input[..., j], output[..., i])
-
-    # shift the unused bits
-    np.left_shift(output[..., i], unused, output[..., i])
+    padded = np.zeros(input.shape[:-1] + (nbytes * 8,), dtype=np.uint8)
+    padded[..., :repeat] = input
+    output[...] = np.packbits(padded.ravel()).reshape(output.shape)
 
 
 def _makep(array, descr_output, format, nrows=None):
@@ -1680,6 +1720,11 @@ def _parse_tformat(tform):
     ``(repeat, format, option)`` tuple.
     """
 
+    try:
+        return _parse_tformat_cache[tform]
+    except KeyError:
+        pass
+
     try:
         (repeat, format, option) = TFORMAT_RE.match(tform.strip()).groups()
     except:
@@ -1693,7 +1738,11 @@ def _parse_tformat(tform):
     else:
         repeat = int(repeat)
 
-    return (repeat, format.upper(), option)
+    if len(_parse_tformat_cache) >= _PARSE_CACHE_SIZE:
+        _parse_tformat_cache.clear()
+    result = (repeat, format.upper(), option)
+    _parse_tformat_cache[tform] = result
+    return result
 
 
 def _parse_ascii_tformat(tform, strict=False):
@@ -1768,13 +1817,23 @@ def _parse_tdim(tdim):
     the value ``TDIM`` value is empty or invalid).
     """
 
+    try:
+        return _parse_tdim_cache[tdim]
+    except (KeyError, TypeError):
+        pass
+
     m = tdim and TDIM_RE.match(tdim)
     if m:
         dims = m.group('dims')
-        return tuple(int(d.strip()) for d in dims.split(','))[::-1]
+        result = tuple(int(d.strip()) for d in dims.split(','))[::-1]
+    else:
+        # Ignore any dim values that don't specify a multidimensional column
+        result = tuple()
 
-    # Ignore any dim values that don't specify a multidimensional column
-    return tuple()
+    if len(_parse_tdim_cache) >= _PARSE_CACHE_SIZE:
+        _parse_tdim_cache.clear()
+    _parse_tdim_cache[tdim] = result
+    return result
 
 
 def _scalar_to_format(value):
@@ -1931,10 +1990,26 @@ def _convert_format(format, reverse=False):
     reverse=True.
     """
 
+    # The format may also be a dtype object, which is hashable, but play it
+    # safe in case some caller passes something that is not
+    try:
+        key = (format, reverse)
+        return _convert_format_cache[key]
+    except KeyError:
+        pass
+    except TypeError:
+        key = None
+
     if reverse:
-        return _convert_record2fits(format)
+        result = _convert_record2fits(format)
     else:
-        return _convert_fits2record(format)
+        result = _convert_fits2record(format)
+
+    if key is not None:
+        if len(_convert_format_cache) >= _PARSE_CACHE_SIZE:
+            _convert_format_cache.clear()
+        _convert_format_cache[key] = result
+    return result
 
 
 def _convert_ascii_format(format, reverse=False):
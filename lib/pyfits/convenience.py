@@ -11,9 +11,10 @@ included directly in the 'pyfits' namespace so that they can be used like:
 These functions are primarily for convenience when working with FITS files in
 the command-line interpreter.  If performing several operations on the same
 file, such as in a script, it is better to *not* use these functions, as each
-one must open and re-parse the file.  In such cases it is better to use
-:func:`pyfits.open` and work directly with the :class:`pyfits.HDUList` object
-and underlying HDU objects.
+one must open and re-parse the file (though repeated *read-only* queries do
+reuse a bounded cache of open file handles; see :func:`close_caches`).  In
+such cases it is better to use :func:`pyfits.open` and work directly with the
+:class:`pyfits.HDUList` object and underlying HDU objects.
 
 Several of the convenience functions, such as `getheader` and `getdata` support
 special arguments for selecting which extension HDU to use when working with a
@@ -65,12 +66,25 @@ from .hdu.image import PrimaryHDU, ImageHDU
 from .hdu.table import BinTableHDU
 from .header import Header
 from .util import (deprecated, fileobj_closed, fileobj_name, fileobj_mode,
-                   fileobj_closed, _is_int)
+                   fileobj_closed, _is_int, BLOCK_SIZE)
 
 
-__all__ = ['getheader', 'getdata', 'getval', 'setval', 'delval', 'writeto',
-           'append', 'update', 'info', 'tdump', 'tcreate', 'tabledump',
-           'tableload']
+__all__ = ['getheader', 'getdata', 'getval', 'getvals', 'setval', 'delval',
+           'writeto', 'append', 'update', 'info', 'close_caches', 'tdump',
+           'tcreate', 'tabledump', 'tableload']
+
+
+# Sentinel distinguishing "no default given" from any user-supplied default
+# in getvals()
+_MISSING = object()
+
+
+# Maximum number of open read-only handles kept by the convenience functions;
+# see _open_cached() below
+_CACHE_MAXSIZE = 16
+
+_open_cache = {}
+_open_cache_lru = []
 
 
 def getheader(filename, *args, **kwargs):
@@ -93,13 +107,24 @@ def getheader(filename, *args, **kwargs):
     Returns
     -------
     header : `Header` object
+
+    Notes
+    -----
+    Repeated read-only calls on the same (unmodified) file reuse a cached
+    open file handle rather than reopening and re-parsing the file each
+    time; see `close_caches`.
     """
 
     mode, closed = _get_file_mode(filename)
-    hdulist, extidx = _getext(filename, mode, *args, **kwargs)
+    hdulist, extidx, cached = _getext(filename, mode, *args, **kwargs)
     hdu = hdulist[extidx]
-    header = hdu.header
-    hdulist.close(closed=closed)
+    if cached:
+        # Return a copy so that modifications made by the caller do not leak
+        # into later results served from the same cached handle
+        header = hdu.header.copy()
+    else:
+        header = hdu.header
+        hdulist.close(closed=closed)
     return header
 
 
@@ -179,7 +204,11 @@ def getdata(filename, *args, **kwargs):
     upper = kwargs.pop('upper', None)
     view = kwargs.pop('view', None)
 
-    hdulist, extidx = _getext(filename, mode, *args, **kwargs)
+    # Open without the read cache: this function returns the live data array
+    # and callers are free to modify it (the lower/upper options even rename
+    # its columns in place), which must not leak into a shared cached handle
+    hdulist, extidx, _cached = _getext(filename, mode, *args, cache=False,
+                                       **kwargs)
     hdu = hdulist[extidx]
     data = hdu.data
     if data is None and extidx == 0:
@@ -255,6 +284,82 @@ def getval(filename, keyword, *args, **kwargs):
     return hdr[keyword]
 
 
+def getvals(filenames, keywords, *args, **kwargs):
+    """
+    Get the values of several keywords from the headers of one or more FITS
+    files at once.
+
+    Each file is opened only once (reusing the cached open handles; see
+    `close_caches`) and all of the keywords are resolved against its header
+    in a single pass, so this is much more efficient than calling `getval`
+    once per file and keyword.
+
+    Parameters
+    ----------
+    filenames : file path or sequence of file paths
+        The FITS file or files to get keyword values from.
+
+    keywords : str or sequence of str
+        The keyword or keywords to look up in each header.
+
+    ext, extname, extver
+        The rest of the arguments are for extension specification.
+        See `getdata` for explanations/examples.  The same extension is used
+        for every file.
+
+    default : optional
+        If given, the value to use for keywords missing from a header;
+        otherwise a missing keyword raises a `KeyError` just as `getval`
+        does.
+
+    kwargs
+        Any additional keyword arguments to be passed to `pyfits.open`.
+        *Note:* This function automatically specifies ``do_not_scale_image_data
+        = True`` when opening the files so that values can be retrieved from
+        the unmodified headers.
+
+    Returns
+    -------
+    values : dict
+        A dictionary mapping each requested keyword to a list of its values,
+        one per file, in the order the files were given.
+    """
+
+    if 'do_not_scale_image_data' not in kwargs:
+        kwargs['do_not_scale_image_data'] = True
+
+    default = kwargs.pop('default', _MISSING)
+
+    if isinstance(filenames, string_types) or \
+            not isinstance(filenames, (list, tuple)):
+        filenames = [filenames]
+    if isinstance(keywords, string_types):
+        keywords = [keywords]
+    keywords = list(keywords)
+
+    values = dict((keyword, []) for keyword in keywords)
+
+    for filename in filenames:
+        mode, closed = _get_file_mode(filename)
+        # _getext pops the extension arguments from kwargs, so pass it a
+        # fresh copy for each file
+        hdulist, extidx, cached = _getext(filename, mode, *args,
+                                          **dict(kwargs))
+        try:
+            header = hdulist[extidx].header
+            for keyword in keywords:
+                if default is _MISSING:
+                    value = header[keyword]
+                else:
+                    value = header.get(keyword, default)
+                values[keyword].append(value)
+        finally:
+            if not cached:
+                hdulist.close(closed=closed)
+
+    return values
+
+
 def setval(filename, keyword, *args, **kwargs):
     """
     Set a keyword's value from a header in a FITS file.
@@ -319,7 +424,7 @@ def setval(filename, keyword, *args, **kwargs):
     after = kwargs.pop('after', None)
     savecomment = kwargs.pop('savecomment', False)
 
-    hdulist, extidx = _getext(filename, 'update', *args, **kwargs)
+    hdulist, extidx, _cached = _getext(filename, 'update', *args, **kwargs)
     if keyword in hdulist[extidx].header and savecomment:
         comment = None
     hdulist[extidx].header.set(keyword, value, comment, before, after)
@@ -355,7 +460,7 @@ def delval(filename, keyword, *args, **kwargs):
     if 'do_not_scale_image_data' not in kwargs:
         kwargs['do_not_scale_image_data'] = True
 
-    hdulist, extidx = _getext(filename, 'update', *args, **kwargs)
+    hdulist, extidx, _cached = _getext(filename, 'update', *args, **kwargs)
     del hdulist[extidx].header[keyword]
     hdulist.close()
 
@@ -434,6 +539,16 @@ def append(filename, data, header=None, checksum=False, verify=True, **kwargs):
 
     kwargs
         Any additional keyword arguments to be passed to `pyfits.open`.
+
+    Notes
+    -----
+    When appending to an ordinary uncompressed file on disk whose size is a
+    whole number of FITS blocks and which begins with a SIMPLE card (or which
+    is already known to be valid from the read cache used by `getheader` and
+    friends), the new HDU is written directly at the end of the file without
+    re-reading the existing HDUs, so appending takes constant time regardless
+    of the file's length.  Anything that fails these cheap checks is opened
+    and verified in full as before.
     """
 
     name, closed, noexist_or_empty = _stat_filename_or_fileobj(filename)
@@ -451,7 +566,16 @@ def append(filename, data, header=None, checksum=False, verify=True, **kwargs):
         if isinstance(hdu, PrimaryHDU):
             hdu = ImageHDU(data, header)
 
-        if verify or not closed:
+        if (verify and isinstance(filename, string_types) and
+                _append_fast_path_ok(name)):
+            # Constant-time append: the target is either known-good from the
+            # read cache or passed the cheap structural checks, so seek
+            # straight to EOF and write the new HDU there
+            f = _File(filename, mode='append')
+            hdu._output_checksum = checksum
+            hdu._writeto(f)
+            f.close()
+        elif verify or not closed:
             f = fitsopen(filename, mode='append')
             f.append(hdu)
 
@@ -517,7 +641,7 @@ def update(filename, data, *args, **kwargs):
 
     closed = fileobj_closed(filename)
 
-    hdulist, _ext = _getext(filename, 'update', *args, **kwargs)
+    hdulist, _ext, _cached = _getext(filename, 'update', *args, **kwargs)
     hdulist[_ext] = new_hdu
 
     hdulist.close(closed=closed)
@@ -560,6 +684,25 @@ def info(filename, output=None, **kwargs):
     return ret
 
 
+def close_caches():
+    """
+    Close all of the open file handles cached by the convenience functions.
+
+    The read-only convenience functions (`getheader`, `getval`, and
+    `getdata`) keep a bounded cache of open `HDUList` handles so that
+    repeated queries against the same file do not reopen and re-parse it
+    each time.  Cached handles for a given file are discarded automatically
+    when its modification time changes, but this function may be used to
+    release all of them explicitly, for example before deleting or
+    replacing files that were queried.
+    """
+
+    del _open_cache_lru[:]
+    while _open_cache:
+        _, hdulist = _open_cache.popitem()
+        hdulist.close()
+
+
 def tabledump(filename, datafile=None, cdfile=None, hfile=None, ext=1,
               clobber=False):
     """
@@ -739,9 +882,101 @@ def _getext(filename, mode, *args, **kwargs):
     elif extver and extname is None:
         raise TypeError('extver alone cannot specify an extension.')
 
+    hdulist, cached = _open_cached(filename, mode, **kwargs)
+
+    return hdulist, ext, cached
+
+
+def _open_cached(filename, mode, cache=True, **kwargs):
+    """
+    Open the input file, reusing a cached open handle when possible.
+
+    Returns a ``(hdulist, cached)`` tuple, where ``cached`` is `True` if the
+    handle came from (or was added to) the cache, in which case the caller
+    must not close it.  Only read-only access to named files is cached;
+    writeable modes and file objects are simply opened, as is everything
+    when ``cache=False`` (used by callers that hand out mutable views of
+    the file's contents).  The file's modification time is part of the
+    cache key, so a file that has been modified since it was cached is
+    reopened.  At most ``_CACHE_MAXSIZE`` handles are kept; the least
+    recently used handle is closed to make room for new ones.
+    """
+
+    if not cache or mode != 'readonly' or \
+            not isinstance(filename, string_types):
+        return fitsopen(filename, mode=mode, **kwargs), False
+
+    try:
+        name = os.path.realpath(filename)
+        key = (name, os.path.getmtime(name), mode,
+               tuple(sorted(kwargs.items())))
+        hash(key)
+    except (OSError, TypeError):
+        # The file does not exist (let fitsopen raise the appropriate error)
+        # or the keyword arguments are not hashable
+        return fitsopen(filename, mode=mode, **kwargs), False
+
+    if key in _open_cache:
+        _open_cache_lru.remove(key)
+        _open_cache_lru.append(key)
+        return _open_cache[key], True
+
     hdulist = fitsopen(filename, mode=mode, **kwargs)
+    _open_cache[key] = hdulist
+    _open_cache_lru.append(key)
+    while len(_open_cache_lru) > _CACHE_MAXSIZE:
+        oldest = _open_cache_lru.pop(0)
+        _open_cache.pop(oldest).close()
+
+    return hdulist, True
+
+
+def _append_fast_path_ok(name):
+    """
+    Decide whether `append` may write a new HDU directly at the end of the
+    named file without re-reading its existing HDUs.
+
+    A file for which the read cache holds a current handle was fully parsed
+    when it was cached and has not been modified since (its modification time
+    is part of the cache key), so it needs no further checking; anything else
+    gets the cheap structural checks in `_validate_append_target`.
+    """
 
-    return hdulist, ext
+    try:
+        realname = os.path.realpath(name)
+        mtime = os.path.getmtime(realname)
+    except OSError:
+        return False
+
+    for key in _open_cache_lru:
+        if key[0] == realname and key[1] == mtime:
+            return True
+
+    return _validate_append_target(name)
+
+
+def _validate_append_target(name):
+    """
+    Cheap structural check of an existing FITS file before appending to it
+    without re-parsing its HDUs: the file must begin with a SIMPLE card and
+    consist of a whole number of non-empty 2880-byte blocks.  Returns `False`
+    if anything looks off (including compressed files, which do not start
+    with a SIMPLE card), in which case the caller performs a full verified
+    append instead.
+    """
+
+    try:
+        size = os.path.getsize(name)
+        if size == 0 or size % BLOCK_SIZE != 0:
+            return False
+        with open(name, 'rb') as f:
+            if f.read(6) != b'SIMPLE':
+                return False
+            f.seek(size - BLOCK_SIZE)
+            block = f.read(BLOCK_SIZE)
+        return len(block) == BLOCK_SIZE
+    except (IOError, OSError):
+        return False
 
 
 def _makehdu(data, header):
@@ -70,6 +70,7 @@ GLOBALS = [
     # Variable name                       # Default
     ('ENABLE_RECORD_VALUED_KEYWORD_CARDS', True),
     ('EXTENSION_NAME_CASE_SENSITIVE',      False),
+    ('NATIVE_TABLE_BYTEORDER',             False),
     ('STRIP_HEADER_WHITESPACE',            True),
     ('USE_MEMMAP',                         True)
 ]
@@ -10,8 +10,10 @@ import difflib
 import fnmatch
 import functools
 import glob
+import hashlib
 import inspect
 import textwrap
+import threading
 import sys
 
 from collections import defaultdict
@@ -19,7 +21,7 @@ from itertools import islice
 
 import numpy as np
 
-from .extern.six import PY3, string_types, StringIO
+from .extern.six import PY3, string_types, reraise, StringIO
 from .extern.six.moves import zip, range, reduce
 
 import pyfits
@@ -43,6 +45,22 @@ _COL_ATTRS = [('unit', 'units'), ('null', 'null values'), ('bscale', 'bscales'),
 indent = functools.partial(indent, width=2)
 
 
+def _hash_data(data, blocksize=2 ** 24):
+    """
+    Returns a digest of the raw bytes of an array, computed a bounded-size
+    block at a time so that large (possibly memory-mapped) arrays are
+    streamed through rather than copied whole.
+    """
+
+    if not data.flags.contiguous:
+        data = np.ascontiguousarray(data)
+    data = data.ravel().view(np.uint8)
+    digest = hashlib.md5()
+    for start in range(0, data.size, blocksize):
+        digest.update(data[start:start + blocksize].tostring())
+    return digest.digest()
+
+
 class _BaseDiff(object):
     """
     Base class for all FITS diff objects.
@@ -185,7 +203,7 @@ class FITSDiff(_BaseDiff):
 
     def __init__(self, a, b, ignore_keywords=[], ignore_comments=[],
                  ignore_fields=[], numdiffs=10, tolerance=0.0,
-                 ignore_blanks=True, ignore_blank_cards=True):
+                 ignore_blanks=True, ignore_blank_cards=True, workers=1):
         """
         Parameters
         ----------
@@ -225,8 +243,20 @@ class FITSDiff(_BaseDiff):
             Ignore extra whitespace at the end of string values either in
             headers or data. Extra leading whitespace is not ignored
             (default: True).
+
+        workers : int, optional
+            The number of worker threads across which to spread the
+            comparison of HDU pairs; 0 means one worker per processor
+            (default: 1, i.e. compare the HDUs sequentially).  Parallel
+            comparison requires both ``a`` and ``b`` to be given by filename
+            so that each worker can open its own handles on the files; when
+            `HDUList` objects are passed in the HDUs are always compared
+            sequentially.
         """
 
+        self._filename_a = a if isinstance(a, string_types) else None
+        self._filename_b = b if isinstance(b, string_types) else None
+
         if isinstance(a, string_types):
             try:
                 a = fitsopen(a)
@@ -258,6 +288,7 @@ class FITSDiff(_BaseDiff):
         self.tolerance = tolerance
         self.ignore_blanks = ignore_blanks
         self.ignore_blank_cards = ignore_blank_cards
+        self.workers = workers
 
         self.diff_hdu_count = ()
         self.diff_hdus = []
@@ -274,16 +305,84 @@ class FITSDiff(_BaseDiff):
         if len(self.a) != len(self.b):
             self.diff_hdu_count = (len(self.a), len(self.b))
 
-        # For now, just compare the extensions one by one in order...might
-        # allow some more sophisticated types of diffing later...
+        ncompare = min(len(self.a), len(self.b))
+
+        workers = self.workers
+        if workers == 0:
+            try:
+                import multiprocessing
+                workers = multiprocessing.cpu_count()
+            except (ImportError, NotImplementedError):
+                workers = 1
+        workers = min(workers, ncompare)
+
+        # The extensions are compared one by one in order, or across a thread
+        # pool when workers > 1; the HDU pairs are independent of each other
         # TODO: Somehow or another simplify the passing around of diff
         # options--this will become important as the number of options grows
-        for idx in range(min(len(self.a), len(self.b))):
-            hdu_diff = HDUDiff.fromdiff(self, self.a[idx], self.b[idx])
+        if (workers > 1 and self._filename_a is not None and
+                self._filename_b is not None):
+            hdu_diffs = self._diff_hdus_parallel(ncompare, workers)
+        else:
+            hdu_diffs = [HDUDiff.fromdiff(self, self.a[idx], self.b[idx])
+                         for idx in range(ncompare)]
 
+        for idx, hdu_diff in enumerate(hdu_diffs):
             if not hdu_diff.identical:
                 self.diff_hdus.append((idx, hdu_diff))
 
+    def _diff_hdus_parallel(self, count, workers):
+        """
+        Compare the first ``count`` HDU pairs across ``workers`` threads and
+        return the resulting `HDUDiff` objects in HDU index order.
+
+        Each worker opens its own pair of handles on the two files so that
+        the threads never share a file position, and pulls the next
+        uncompared HDU index from a common counter until none remain.
+        """
+
+        results = [None] * count
+        errors = []
+        lock = threading.Lock()
+        counter = [0]
+
+        def next_index():
+            lock.acquire()
+            try:
+                idx = counter[0]
+                counter[0] += 1
+                return idx
+            finally:
+                lock.release()
+
+        def run():
+            hdulist_a = fitsopen(self._filename_a)
+            hdulist_b = fitsopen(self._filename_b)
+            try:
+                try:
+                    while not errors:
+                        idx = next_index()
+                        if idx >= count:
+                            break
+                        results[idx] = HDUDiff.fromdiff(self, hdulist_a[idx],
+                                                        hdulist_b[idx])
+                except Exception:
+                    errors.append(sys.exc_info())
+            finally:
+                hdulist_a.close()
+                hdulist_b.close()
+
+        threads = [threading.Thread(target=run) for _ in range(workers)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        if errors:
+            reraise(*errors[0])
+
+        return results
+
     def _report(self):
         wrapper = textwrap.TextWrapper(initial_indent='  ',
                                        subsequent_indent='  ')
@@ -414,7 +513,12 @@ class HDUDiff(_BaseDiff):
         self.diff_headers = HeaderDiff.fromdiff(self, self.a.header.copy(),
                                                 self.b.header.copy())
 
-        if self.a.data is None or self.b.data is None:
+        if self._datasums_match():
+            # Both HDUs carry a DATASUM that was verified against the file
+            # when it was opened, and the sums are equal, so the data units
+            # are taken to be identical without even reading them
+            pass
+        elif self.a.data is None or self.b.data is None:
             # TODO: Perhaps have some means of marking this case
             pass
         elif self.a.is_image and self.b.is_image:
@@ -431,6 +535,26 @@ class HDUDiff(_BaseDiff):
             self.diff_data = RawDataDiff.fromdiff(self, self.a.data,
                                                   self.b.data)
 
+    def _datasums_match(self):
+        """
+        `True` only if both HDUs carry a ``DATASUM`` keyword that was
+        verified against the data in the file when it was opened (i.e. the
+        file was opened with ``checksum=True``), the data has not since been
+        loaded or replaced, and the two sums are equal.  Equal sums of
+        verified, untouched data units of the same size are trusted to mean
+        identical data.
+        """
+
+        if self.a.size != self.b.size:
+            return False
+
+        for hdu in (self.a, self.b):
+            if (hdu._data_loaded or not hdu._datasum_verified or
+                    not hdu._datasum or int(hdu._datasum) == 0):
+                return False
+
+        return int(self.a._datasum) == int(self.b._datasum)
+
     def _report(self):
         if self.identical:
             self._writeln(" No differences found.")
@@ -773,6 +897,14 @@ class ImageDataDiff(_BaseDiff):
             # between the two images
             return
 
+        # Fast pre-pass: when the two arrays are byte-for-byte identical
+        # there is no need for an element-wise comparison; with equal dtypes,
+        # identical bytes imply identical values (including any NaNs, which
+        # where_not_allclose also treats as equal)
+        if (self.a.dtype == self.b.dtype and
+                _hash_data(self.a) == _hash_data(self.b)):
+            return
+
         # Find the indices where the values are not equal
         # If neither a nor b are floating point, ignore self.tolerance
         if not ((np.issubdtype(self.a.dtype, float) or
@@ -5,6 +5,7 @@ import mmap
 import os
 import sys
 import tempfile
+import threading
 import warnings
 import zipfile
 
@@ -14,6 +15,7 @@ from numpy import memmap as Memmap
 from .extern.six import b, string_types
 from .extern.six.moves import urllib, reduce
 
+from . import perf
 from .util import (isreadable, iswritable, isfile, fileobj_open, fileobj_name,
                    fileobj_closed, fileobj_mode, _array_from_file,
                    _array_to_file, _write_string, encode_ascii)
@@ -63,6 +65,110 @@ MEMMAP_MODES = {'readonly': 'c', 'copyonwrite': 'c', 'update': 'r+',
 GZIP_MAGIC = b('\x1f\x8b\x08')
 PKZIP_MAGIC = b('\x50\x4b\x03\x04')
 
+# Maps access intent names accepted by _File.advise to the corresponding
+# posix_fadvise advice values; built at import time so that on platforms
+# without os.posix_fadvise (or on Pythons too old to expose it) the advise
+# method degrades to a no-op
+if hasattr(os, 'posix_fadvise'):
+    ADVISE_MODES = {
+        'normal': os.POSIX_FADV_NORMAL,
+        'sequential': os.POSIX_FADV_SEQUENTIAL,
+        'random': os.POSIX_FADV_RANDOM,
+        'willneed': os.POSIX_FADV_WILLNEED,
+        'dontneed': os.POSIX_FADV_DONTNEED}
+else:
+    ADVISE_MODES = dict.fromkeys(['normal', 'sequential', 'random',
+                                  'willneed', 'dontneed'])
+
+# The corresponding madvise advice values for mmapped data, for platforms
+# where the mmap module exposes them; entries are None (a no-op) where it
+# does not
+MADVISE_MODES = {}
+for _mode, _flag in [('normal', 'MADV_NORMAL'),
+                     ('sequential', 'MADV_SEQUENTIAL'),
+                     ('random', 'MADV_RANDOM'),
+                     ('willneed', 'MADV_WILLNEED'),
+                     ('dontneed', 'MADV_DONTNEED')]:
+    MADVISE_MODES[_mode] = getattr(mmap, _flag, None)
+del _mode, _flag
+
+
+# Process-wide registry of shared read-only memory maps.  Opening the same
+# file many times in 'denywrite' mode (the only mode whose data mapping is
+# strictly read-only) reuses a single OS mapping instead of creating one per
+# open; each mapping is reference counted and unmapped only when the last
+# _File using it is closed.  The file's device and inode identify the file,
+# while its size and mtime act as a generation number so that a file that has
+# been replaced or modified since it was first mapped gets a fresh mapping.
+_shared_mmap_registry = {}
+_shared_mmap_lock = threading.Lock()
+
+
+class _SharedMmap(object):
+    """
+    A reference-counted read-only ``mmap.mmap`` shared between `_File`
+    instances open on the same file; see `_acquire_shared_mmap`.
+    """
+
+    def __init__(self, key, mm):
+        self.key = key
+        self.mmap = mm
+        self.refcount = 1
+
+
+def _acquire_shared_mmap(fileobj):
+    """
+    Return a `_SharedMmap` of the given open file, reusing an existing
+    mapping of the same file generation when one is registered, or None if
+    the file cannot be identified or mapped.
+    """
+
+    try:
+        fd = fileobj.fileno()
+        st = os.fstat(fd)
+    except (AttributeError, OSError, IOError, ValueError):
+        return None
+
+    if not st.st_ino or not st.st_size:
+        # Empty files cannot be mapped, and platforms without meaningful
+        # inode numbers cannot be safely keyed
+        return None
+
+    key = (st.st_dev, st.st_ino, st.st_size, st.st_mtime)
+
+    with _shared_mmap_lock:
+        shared = _shared_mmap_registry.get(key)
+        if shared is not None:
+            shared.refcount += 1
+            return shared
+        try:
+            mm = mmap.mmap(fd, 0, access=mmap.ACCESS_READ)
+        except (OSError, IOError, ValueError, mmap.error):
+            return None
+        shared = _SharedMmap(key, mm)
+        _shared_mmap_registry[key] = shared
+        return shared
+
+
+def _release_shared_mmap(shared):
+    """
+    Drop one reference to a shared mapping, unmapping it once no open
+    `_File` uses it any longer.
+    """
+
+    with _shared_mmap_lock:
+        shared.refcount -= 1
+        if shared.refcount > 0:
+            return
+        _shared_mmap_registry.pop(shared.key, None)
+        try:
+            shared.mmap.close()
+        except Exception:
+            # Arrays may still hold views of the mapping's buffer, in which
+            # case the mapping is freed when the last of them is garbage
+            # collected
+            pass
+
 
 class _File(object):
     """
@@ -72,7 +178,16 @@ class _File(object):
     # See self._test_mmap
     _mmap_available = None
 
-    def __init__(self, fileobj=None, mode=None, memmap=False, clobber=False):
+    # When True, writearray() compares with the existing file contents and
+    # rewrites only the chunks that differ; see _writearray_compare
+    _compare_writes = False
+
+    def __init__(self, fileobj=None, mode=None, memmap=False, clobber=False,
+                 cow=False):
+        self.cow = False
+
+        self._shared_mmap = None
+
         if fileobj is None:
             self.__file = None
             self.closed = False
@@ -177,6 +292,16 @@ class _File(object):
                 # https://github.com/astropy/astropy/issues/968
                 self.memmap = False
 
+        # In copy-on-write update mode the data is mmapped MAP_PRIVATE, so
+        # in-place modifications stay in memory until flush, which writes
+        # back only the ranges that actually changed (see HDUList.flush)
+        self.cow = bool(cow) and self.memmap and self.mode == 'update'
+
+        # Strictly read-only mappings are shared between opens of the same
+        # file; see _acquire_shared_mmap
+        if self.memmap and MEMMAP_MODES[self.mode] == 'r':
+            self._shared_mmap = _acquire_shared_mmap(self.__file)
+
     def __repr__(self):
         return '<%s.%s %s>' % (self.__module__, self.__class__.__name__,
                                self.__file)
@@ -197,7 +322,7 @@ class _File(object):
         if not hasattr(self.__file, 'read'):
             raise EOFError
         try:
-            return self.__file.read(size)
+            result = self.__file.read(size)
         except IOError:
             # On some versions of Python, it appears, GzipFile will raise an
             # IOError if you try to read past its end (as opposed to just
@@ -205,6 +330,10 @@ class _File(object):
             if self.compression == 'gzip':
                 return ''
             raise
+        if perf.enabled:
+            perf.count('file.read.calls')
+            perf.count('file.read.bytes', len(result))
+        return result
 
     def readarray(self, size=None, offset=0, dtype=np.uint8, shape=None):
         """
@@ -245,9 +374,27 @@ class _File(object):
                           'shape of (1,)')
             shape = (1,)
 
+        if perf.enabled:
+            perf.count('file.readarray.calls')
+            perf.count('file.readarray.bytes',
+                       reduce(lambda x, y: x * y, shape) * dtype.itemsize)
+
         if self.memmap:
+            if self.cow:
+                # Map the data MAP_PRIVATE; modifications are kept in the
+                # private pages and written back explicitly on flush
+                mmap_mode = 'c'
+            else:
+                mmap_mode = MEMMAP_MODES[self.mode]
+            if self._shared_mmap is not None and mmap_mode == 'r':
+                # View into the process-wide shared read-only mapping of
+                # this file rather than creating a new mapping per call; the
+                # resulting array is not writeable, just as with mode 'r'
+                return np.ndarray(shape=shape, dtype=dtype,
+                                  buffer=self._shared_mmap.mmap,
+                                  offset=offset)
             return Memmap(self.__file, offset=offset,
-                          mode=MEMMAP_MODES[self.mode], dtype=dtype,
+                          mode=mmap_mode, dtype=dtype,
                           shape=shape).view(np.ndarray)
         else:
             count = reduce(lambda x, y: x * y, shape)
@@ -258,6 +405,51 @@ class _File(object):
             self.__file.seek(pos)
             return data
 
+    def advise(self, mode, offset=0, length=None):
+        """
+        Advise the operating system of the expected access pattern for a
+        region of the file, using ``posix_fadvise`` where it is available.
+
+        Parameters
+        ----------
+        mode : str
+            The expected access pattern; one of ``'normal'``,
+            ``'sequential'``, ``'random'``, ``'willneed'`` (read the region
+            into the page cache ahead of use), or ``'dontneed'`` (the region
+            will not be needed again soon).
+
+        offset : int, optional
+            The start of the region the advice applies to (default: the
+            beginning of the file).
+
+        length : int, optional
+            The length of the region; if `None` the advice applies from
+            ``offset`` to the end of the file.
+
+        This is purely an optimization hint; on platforms or file-like
+        objects where the advice cannot be applied it is silently ignored.
+        """
+
+        if mode not in ADVISE_MODES:
+            raise ValueError(
+                'mode %r not one of %s' % (mode, sorted(ADVISE_MODES)))
+
+        advice = ADVISE_MODES[mode]
+        if advice is None or not hasattr(self.__file, 'fileno'):
+            return
+
+        if length is None:
+            # A length of 0 means "to the end of the file" to posix_fadvise
+            length = 0
+
+        try:
+            os.posix_fadvise(self.__file.fileno(), offset, length, advice)
+        except (AttributeError, IOError, OSError):
+            # The underlying "file" may not have a real file descriptor
+            # (StringIO, sockets, ...), or the OS may refuse the advice;
+            # either way it was only a hint
+            pass
+
     def writable(self):
         if self.readonly:
             return False
@@ -265,6 +457,9 @@ class _File(object):
 
     def write(self, string):
         if hasattr(self.__file, 'write'):
+            if perf.enabled:
+                perf.count('file.write.calls')
+                perf.count('file.write.bytes', len(string))
             _write_string(self.__file, string)
 
     def writearray(self, array):
@@ -276,8 +471,61 @@ class _File(object):
         """
 
         if hasattr(self.__file, 'write'):
+            if perf.enabled:
+                perf.count('file.writearray.calls')
+                perf.count('file.writearray.bytes', array.nbytes)
+            if self._compare_writes and self._writearray_compare(array):
+                return
             _array_to_file(array, self.__file)
 
+    def _writearray_compare(self, array, chunksize=1024 * 1024):
+        """
+        Write ``array`` at the current file position, but compare each chunk
+        with the bytes already in the file first and rewrite only the chunks
+        that differ.  The file is left positioned after the array, exactly as
+        with a plain writearray().
+
+        This is used when flushing in-place updates: when only a small part
+        of a large data array was modified this turns a full rewrite into a
+        (cheaper, page-cache friendly) read pass plus writes of just the
+        dirty ranges.  Returns `True` if the array was handled here, or
+        `False` if it cannot be (in which case the caller should fall back to
+        a plain write).
+        """
+
+        if array.dtype.hasobject or not array.flags['C_CONTIGUOUS']:
+            return False
+
+        try:
+            flat = array.reshape(-1).view(np.uint8)
+        except (AttributeError, ValueError):
+            return False
+
+        nbytes = len(flat)
+        written = 0
+        while written < nbytes:
+            count = min(chunksize, nbytes - written)
+            chunk = flat[written:written + count].tostring()
+            existing = self.__file.read(count)
+            if existing != chunk:
+                start, stop = 0, count
+                if len(existing) == count:
+                    # Narrow the write down to the span of bytes that
+                    # actually differ within this chunk
+                    changed = (flat[written:written + count] !=
+                               np.fromstring(existing, dtype=np.uint8))
+                    changed = changed.nonzero()[0]
+                    start = changed[0]
+                    stop = changed[-1] + 1
+                # If the file was too short the read above came up short and
+                # the write extends it
+                self.__file.seek(start - len(existing), 1)
+                self.__file.write(chunk[start:stop])
+                self.__file.seek(count - stop, 1)
+            written += count
+
+        return True
+
     def flush(self):
         if hasattr(self.__file, 'flush'):
             self.__file.flush()
@@ -318,6 +566,10 @@ class _File(object):
         Close the 'physical' FITS file.
         """
 
+        if self._shared_mmap is not None:
+            _release_shared_mmap(self._shared_mmap)
+            self._shared_mmap = None
+
         if hasattr(self.__file, 'close'):
             self.__file.close()
 
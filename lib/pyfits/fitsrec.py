@@ -11,11 +11,75 @@ from numpy import char as chararray
 from .extern.six import string_types
 from .extern.six.moves import range, reduce
 
+from . import perf
+
 from .column import (ASCIITNULL, FITS2NUMPY, ASCII2NUMPY, ASCII2STR, ColDefs,
                      _AsciiColDefs, _FormatX, _FormatP, _VLF, _get_index,
-                     _wrapx, _unwrapx, _makep, _convert_ascii_format, Delayed)
+                     _wrapx, _unwrapx, _convert_ascii_format, Delayed)
 from .util import (encode_ascii, decode_ascii, lazyproperty,
-                   PyfitsDeprecationWarning)
+                   _pseudo_unsigned_values, PyfitsDeprecationWarning)
+
+try:
+    from . import _asciitable
+except ImportError:
+    # The C ASCII table parser is an optional accelerator; everything works
+    # (more slowly) without it
+    _asciitable = None
+
+
+# Number of elements to process per block when scaling columns back to their
+# raw storage values at flush time; bounds the size of the temporaries
+SCALE_BACK_BLOCKSIZE = 2 ** 20
+
+
+def _columns_fill_all_cells(columns, nrows):
+    """
+    Determine whether the input arrays of the given `ColDefs` will write
+    every cell of a new table of ``nrows`` rows, in which case
+    `FITS_rec.from_columns` can skip pre-filling the raw buffer with the
+    padding byte.
+
+    This errs on the side of `False`; a column whose coverage cannot be
+    established cheaply just means the buffer is pre-filled as before.
+    """
+
+    if isinstance(columns, _AsciiColDefs):
+        # ASCII table cells are only written back from the converted arrays
+        # at write time, and the raw dtype may contain gaps between fields
+        return False
+
+    for idx in range(len(columns)):
+        if columns[idx]._phantom:
+            # Phantom columns store no data
+            continue
+
+        arr = columns._arrays[idx]
+        if not isinstance(arr, np.ndarray) or len(arr) < nrows:
+            return False
+
+        recformat = columns._recformats[idx]
+        if isinstance(recformat, _FormatP):
+            # The descriptor field is zeroed explicitly by from_columns
+            continue
+        elif isinstance(recformat, _FormatX):
+            if arr.ndim < 2 or arr.shape[-1] != recformat.repeat:
+                return False
+        elif recformat[-2:] == FITS2NUMPY['L']:
+            # A boolean input array resets the whole raw field up front; any
+            # other input takes the general copy whose coverage depends on
+            # its shape
+            if arr.dtype != bool:
+                return False
+        else:
+            fdtype = columns.dtype.fields[columns.names[idx]][0]
+            if fdtype.subdtype is not None:
+                fshape = fdtype.subdtype[1]
+            else:
+                fshape = ()
+            if arr.shape[1:] != fshape:
+                return False
+
+    return True
 
 
 class FITS_record(object):
@@ -180,6 +244,8 @@ class FITS_rec(np.recarray):
 
         self._nfields = len(self.dtype.names)
         self._convert = [None] * len(self.dtype.names)
+        self._convert_parent = None
+        self._convert_key = None
         self._heapoffset = 0
         self._heapsize = 0
         self._coldefs = None
@@ -236,6 +302,10 @@ class FITS_rec(np.recarray):
 
         if isinstance(obj, FITS_rec):
             self._convert = obj._convert
+            # Since the ._convert list itself is shared with obj, any parent
+            # to pull conversions from is shared as well
+            self._convert_parent = getattr(obj, '_convert_parent', None)
+            self._convert_key = getattr(obj, '_convert_key', None)
             self._heapoffset = obj._heapoffset
             self._heapsize = obj._heapsize
             self._coldefs = obj._coldefs
@@ -248,6 +318,8 @@ class FITS_rec(np.recarray):
             # just other FITS_rec objects
             self._nfields = len(obj.dtype.names)
             self._convert = [None] * len(obj.dtype.names)
+            self._convert_parent = None
+            self._convert_key = None
 
             self._heapoffset = getattr(obj, '_heapoffset', 0)
             self._heapsize = getattr(obj, '_heapsize', 0)
@@ -329,7 +401,12 @@ class FITS_rec(np.recarray):
                     nrows = dim
 
         raw_data = np.empty(columns.dtype.itemsize * nrows, dtype=np.uint8)
-        raw_data.fill(ord(columns._padding_byte))
+        if fill or not _columns_fill_all_cells(columns, nrows):
+            # Pre-fill the new buffer with the padding byte only if some
+            # cells will not be written from the input column arrays; for a
+            # fully populated table this saves a complete pass over the
+            # buffer
+            raw_data.fill(ord(columns._padding_byte))
         data = np.recarray(nrows, dtype=columns.dtype, buf=raw_data).view(cls)
 
         # Previously this assignment was made from hdu.columns, but that's a
@@ -388,8 +465,28 @@ class FITS_rec(np.recarray):
                     _wrapx(inarr, outarr, recformat.repeat)
                     continue
             elif isinstance(recformat, _FormatP):
-                data._convert[idx] = _makep(inarr, field, recformat,
-                                            nrows=nrows)
+                # Keep the variable length rows as the converted column and
+                # defer descriptor and heap construction to _scale_back at
+                # write time; input rows that are already arrays of the
+                # column's type are referenced rather than copied
+                field[:] = 0
+                vlf = _VLF([None] * nrows, dtype=recformat.dtype)
+                for jdx in range(n):
+                    row = inarr[jdx]
+                    if (recformat.dtype != 'a' and
+                            isinstance(row, np.ndarray) and
+                            row.dtype == recformat.dtype):
+                        np.ndarray.__setitem__(vlf, jdx, row)
+                        vlf.max = max(vlf.max, len(row))
+                    else:
+                        vlf[jdx] = row
+                if recformat.dtype == 'a':
+                    pad_row = ' ' * vlf.max
+                else:
+                    pad_row = [0] * vlf.max
+                for jdx in range(n, nrows):
+                    vlf[jdx] = pad_row
+                data._convert[idx] = vlf
                 continue
             # TODO: Find a better way of determining that the column is meant
             # to be FITS L formatted
@@ -495,14 +592,18 @@ class FITS_rec(np.recarray):
                 #
                 arrays.append(self._coldefs._arrays[idx][key])
 
-                # touch all fields to expand the original ._convert list
-                # so the sliced FITS_rec will view the same scaled columns as
-                # the original
-                dummy = self.field(idx)
+                # Columns that have already been converted are handed down
+                # as views of the converted arrays; columns that have not
+                # been accessed yet are left unconverted--field() will pull
+                # them from the parent array on demand (see
+                # _convert_from_parent) so that all views of the same data
+                # share a single converted copy of each column
                 if self._convert[idx] is not None:
                     out._convert[idx] = \
                         np.ndarray.__getitem__(self._convert[idx], key)
-            del dummy
+
+            out._convert_parent = weakref.ref(self)
+            out._convert_key = key
 
             out._coldefs._arrays = arrays
             out._coldefs._shape = len(arrays[0])
@@ -573,6 +674,11 @@ class FITS_rec(np.recarray):
             new = super(FITS_rec, self).copy()
 
         new.__dict__ = copy.deepcopy(self.__dict__)
+        # A copy should not pull converted columns from the original's
+        # parent, or the "copy" would end up holding views of the original
+        # data
+        new._convert_parent = None
+        new._convert_key = None
         return new
 
     @property
@@ -628,19 +734,62 @@ class FITS_rec(np.recarray):
         field = np.recarray.field(base, field_indx)
 
         if self._convert[field_indx] is None:
-            if isinstance(recformat, _FormatP):
-                # for P format
-                converted = self._convert_p(col_indx, field, recformat)
-            else:
-                # Handle all other column data types which are fixed-width
-                # fields
-                converted = self._convert_other(col_indx, field, recformat)
+            # If this array is a slice of another FITS_rec whose column has
+            # already been (or can be) converted, reuse that conversion
+            # rather than redoing it here
+            converted = self._convert_from_parent(col_indx, field_indx)
+
+            if converted is None:
+                if isinstance(recformat, _FormatP):
+                    # for P format
+                    converted = self._convert_p(col_indx, field, recformat)
+                else:
+                    # Handle all other column data types which are
+                    # fixed-width fields
+                    converted = self._convert_other(col_indx, field,
+                                                    recformat)
+
+            if perf.enabled:
+                perf.count('fitsrec.columns_converted')
 
             self._convert[field_indx] = converted
             return converted
 
         return self._convert[field_indx]
 
+    def _convert_from_parent(self, col_indx, field_indx):
+        """
+        If this array was created by slicing or indexing another `FITS_rec`,
+        return a view of the parent's converted (scaled) column instead of
+        converting the raw data again.
+
+        The conversion is requested *through* the parent, so it is performed
+        once on the parent's full column (recursively, all the way up to the
+        array the slices were originally taken from) and every view of the
+        same data shares it; for plain slices the result handed back down is
+        a zero-copy view.  Returns `None` if there is no parent to pull from,
+        in which case the caller converts this array's own raw data.
+        """
+
+        parent_ref = getattr(self, '_convert_parent', None)
+        if parent_ref is None:
+            return None
+
+        parent = parent_ref()
+        if parent is None:
+            # The parent array has been garbage collected; all we can do is
+            # convert our own data
+            return None
+
+        # This converts and caches the column on the parent if it has not
+        # been accessed there yet
+        parent.field(col_indx)
+        converted = parent._convert[field_indx]
+        if converted is None:
+            return None
+
+        return np.ndarray.__getitem__(converted, self._convert_key)
+
     def _convert_x(self, field, recformat):
         """Convert a raw table column to a bit array as specified by the
         FITS X format.
@@ -663,6 +812,12 @@ class FITS_rec(np.recarray):
                 "Could not find heap data for the %r variable-length "
                 "array column." % self.columns.names[indx])
 
+        if len(self):
+            converted = self._convert_p_fast(indx, field, recformat, raw_data,
+                                             dummy)
+            if converted is not None:
+                return converted
+
         for idx in range(len(self)):
             offset = field[idx, 1] + self._heapoffset
             count = field[idx, 0]
@@ -691,6 +846,55 @@ class FITS_rec(np.recarray):
 
         return dummy
 
+    def _convert_p_fast(self, indx, field, recformat, raw_data, dummy):
+        """Vectorized conversion of a P/Q format column whose arrays are
+        laid out back to back on the heap in row order--the layout PyFITS
+        itself always writes.
+
+        The descriptor column is read in one pass, the touched heap region
+        is viewed as the target type in a single step, and the per-row
+        arrays are produced as views into it with `numpy.split`, instead of
+        running an offset/view/byteorder/scale sequence in Python for every
+        row.  Returns `None` when the heap layout or the column type rules
+        this out, in which case the caller falls back to the row-by-row
+        conversion.
+        """
+
+        if recformat.dtype == 'a':
+            # Character arrays need a per-row itemsize and ASCII decoding;
+            # leave them to the row loop
+            return None
+
+        (_str, _bool, _number, _scale, _zero, bscale, bzero, dim) = \
+            self._get_scale_factors(indx)
+
+        # The same scale factors apply to every array in the column, so this
+        # check need only be made once; scaled (or boolean) columns still
+        # take the row loop through _convert_other
+        column = self._coldefs[indx]
+        if _bool or (_number and (_scale or _zero) and
+                     not column._physical_values):
+            return None
+
+        dt = np.dtype(recformat.dtype)
+        counts = np.array(field[:, 0], dtype=np.int64)
+        offsets = np.array(field[:, 1], dtype=np.int64) + self._heapoffset
+        ends = offsets + counts * dt.itemsize
+
+        if np.any(offsets[1:] != ends[:-1]):
+            # The arrays are not contiguous on the heap (gaps, sharing, or
+            # out-of-order descriptors)
+            return None
+
+        region = raw_data[offsets[0]:ends[-1]]
+        flat = region.view(dt.newbyteorder('>'))
+
+        arrays = np.split(flat, np.cumsum(counts)[:-1])
+        for idx in range(len(arrays)):
+            dummy[idx] = arrays[idx]
+
+        return dummy
+
     def _convert_ascii(self, indx, field):
         """Special handling for ASCII table columns to convert columns
         containing numeric types to actual numeric arrays from the string
@@ -704,6 +908,12 @@ class FITS_rec(np.recarray):
         if len(nullval) > format.width:
             nullval = nullval[:format.width]
 
+        if _asciitable is not None and field.dtype.kind == 'S':
+            converted = self._convert_ascii_fast(indx, field, recformat,
+                                                 nullval)
+            if converted is not None:
+                return converted
+
         dummy = np.char.ljust(field, format.width)
         dummy = np.char.replace(dummy, encode_ascii('D'), encode_ascii('E'))
         null_fill = encode_ascii(str(ASCIITNULL).rjust(format.width))
@@ -720,6 +930,33 @@ class FITS_rec(np.recarray):
 
         return dummy
 
+    def _convert_ascii_fast(self, indx, field, recformat, nullval):
+        """Convert a numeric ASCII table column using the C parsing kernel
+        in `pyfits._asciitable`.
+
+        The kernel parses all of the column's fixed-width cells in a single
+        pass, with the same null-string, 'D' exponent, and bad-value handling
+        as the pure Python conversion.  Returns `None` if the kernel declined
+        the column (for example a character format), in which case the caller
+        falls back to `_convert_ascii`.
+        """
+
+        try:
+            buf = _asciitable.parse_numeric_column(
+                field.tostring(), field.itemsize, recformat, nullval,
+                float(ASCIITNULL))
+        except ValueError:
+            exc = sys.exc_info()[1]
+            raise ValueError(
+                '%s; the header may be missing the necessary TNULL%d '
+                'keyword or the table contains invalid data' %
+                (exc, indx + 1))
+
+        if buf is None:
+            return None
+
+        return np.fromstring(buf, dtype=recformat)
+
     def _convert_other(self, indx, field, recformat):
         """Perform conversions on any other fixed-width column data types.
 
@@ -786,10 +1023,21 @@ class FITS_rec(np.recarray):
             # TODO: For now this only really works correctly for binary tables
             # Should it work for ASCII tables as well?
             if self._uint:
-                if bzero == 2**15 and 'I' in self._coldefs.formats[indx]:
-                    field = np.array(field, dtype=np.uint16)
-                elif bzero == 2**31 and 'J' in self._coldefs.formats[indx]:
-                    field = np.array(field, dtype=np.uint32)
+                if (field.dtype.kind == 'i' and field.dtype.itemsize == 2 and
+                        bzero == 2**15 and
+                        'I' in self._coldefs.formats[indx]):
+                    # Flip the sign bit in a single copy of the raw column
+                    # instead of casting to unsigned and then adding TZERO
+                    # with a second full-size temporary
+                    field = _pseudo_unsigned_values(field,
+                                                    np.dtype(np.uint16))
+                    _zero = False
+                elif (field.dtype.kind == 'i' and
+                        field.dtype.itemsize == 4 and bzero == 2**31 and
+                        'J' in self._coldefs.formats[indx]):
+                    field = _pseudo_unsigned_values(field,
+                                                    np.dtype(np.uint32))
+                    _zero = False
                 elif bzero == 2**63 and 'K' in self._coldefs.formats[indx]:
                     field = np.array(field, dtype=np.uint64)
                     bzero64 = np.uint64(2 ** 63)
@@ -973,6 +1221,13 @@ class FITS_rec(np.recarray):
             if _number or _str:
                 column = self._coldefs[indx]
                 if _number and (_scale or _zero) and column._physical_values:
+                    if not isinstance(self._coldefs, _AsciiColDefs):
+                        # Binary table columns are unscaled straight into the
+                        # raw field a block at a time, without materializing
+                        # an unscaled copy of the whole column
+                        self._scale_back_numeric(indx, field)
+                        column._physical_values = False
+                        continue
                     dummy = self._convert[indx].copy()
                     if _zero:
                         dummy -= bzero
@@ -1031,14 +1286,19 @@ class FITS_rec(np.recarray):
 
                     # not using numarray.strings's num2char because the
                     # result is not allowed to expand (as C/Python does).
-                    for jdx in range(len(dummy)):
-                        x = fmt % dummy[jdx]
-                        if len(x) > starts[indx + 1] - starts[indx]:
-                            raise ValueError(
-                                "Value %r does not fit into the output's "
-                                "itemsize of %s." % (x, spans[indx]))
-                        else:
-                            field[jdx] = x
+                    maxlen = starts[indx + 1] - starts[indx]
+                    if (_asciitable is None or
+                            not self._scale_back_ascii_fast(
+                                field, dummy, fmt, format, maxlen,
+                                spans[indx])):
+                        for jdx in range(len(dummy)):
+                            x = fmt % dummy[jdx]
+                            if len(x) > maxlen:
+                                raise ValueError(
+                                    "Value %r does not fit into the output's "
+                                    "itemsize of %s." % (x, spans[indx]))
+                            else:
+                                field[jdx] = x
                     # Replace exponent separator in floating point numbers
                     if 'D' in format:
                         field.replace(encode_ascii('E'), encode_ascii('D'))
@@ -1084,3 +1344,82 @@ class FITS_rec(np.recarray):
 
         # Store the updated heapsize
         self._heapsize = heapsize
+
+    def _scale_back_numeric(self, indx, field,
+                            blocksize=SCALE_BACK_BLOCKSIZE):
+        """
+        Undo the physical-value scaling of a binary table column, writing the
+        raw storage values directly into ``field`` a bounded-size block at a
+        time rather than materializing an unscaled (and possibly rounded)
+        copy of the whole column first.
+        """
+
+        _str, _bool, _number, _scale, _zero, bscale, bzero, _ = \
+            self._get_scale_factors(indx)
+        converted = self._convert[indx]
+        do_round = len(field) and isinstance(field[0], np.integer)
+
+        if field.shape != converted.shape:
+            # A TDIMn-reshaped column; rare enough that it is not worth
+            # complicating the block loop over
+            dummy = converted.copy()
+            if _zero:
+                dummy -= bzero
+            if _scale:
+                dummy /= bscale
+            if do_round:
+                dummy = np.around(dummy)
+            field[:] = dummy.ravel().view(field.dtype)
+            return
+
+        if converted.ndim > 1:
+            rowelems = int(np.product(converted.shape[1:]))
+        else:
+            rowelems = 1
+        blockrows = max(1, blocksize // max(1, rowelems))
+
+        for start in range(0, len(field), blockrows):
+            stop = min(start + blockrows, len(field))
+            block = converted[start:stop].copy()
+            if _zero:
+                block -= bzero
+            if _scale:
+                block /= bscale
+            if do_round:
+                block = np.around(block)
+            field[start:stop] = block
+
+    def _scale_back_ascii_fast(self, field, dummy, fmt, format, maxlen, span):
+        """
+        Format a numeric ASCII table column back into its fixed-width string
+        cells with the C formatter in `pyfits._asciitable`, a block of rows
+        at a time.
+
+        Returns `False` if the column or format cannot be handled by the
+        kernel, in which case the caller runs the per-row Python formatting
+        loop instead.
+        """
+
+        if format[0] in ('I', 'J'):
+            kind = 'i'
+            dtype = np.int64
+        elif format[0] in ('F', 'E', 'D'):
+            kind = 'f'
+            dtype = np.float64
+        else:
+            return False
+
+        itemsize = field.itemsize
+        celldtype = 'S%d' % itemsize
+        blockrows = max(1, SCALE_BACK_BLOCKSIZE // max(1, itemsize))
+
+        for start in range(0, len(field), blockrows):
+            stop = min(start + blockrows, len(field))
+            vals = np.array(dummy[start:stop], dtype=dtype).tostring()
+            buf = _asciitable.format_numeric_column(vals, kind, fmt, itemsize,
+                                                    maxlen, span)
+            if buf is None:
+                return False
+            field[start:stop] = np.fromstring(buf, dtype=celldtype)
+
+        return True
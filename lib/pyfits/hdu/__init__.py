@@ -4,9 +4,9 @@ from .groups import GroupsHDU, GroupData, Group
 from .hdulist import HDUList
 from .image import PrimaryHDU, ImageHDU
 from .nonstandard import FitsHDU
-from .streaming import StreamingHDU
+from .streaming import StreamingHDU, CompImageStreamingHDU
 from .table import TableHDU, BinTableHDU
 
 __all__ = ['HDUList', 'PrimaryHDU', 'ImageHDU', 'TableHDU', 'BinTableHDU',
            'GroupsHDU', 'GroupData', 'Group', 'CompImageHDU', 'FitsHDU',
-           'StreamingHDU', 'register_hdu', 'unregister_hdu', 'DELAYED']
+           'StreamingHDU', 'CompImageStreamingHDU', 'register_hdu', 'unregister_hdu', 'DELAYED']
@@ -12,6 +12,7 @@ from ..extern.six import string_types
 from ..extern.six.moves import range
 
 import pyfits
+from ..card import Card
 from ..file import _File
 from ..header import Header
 from ..util import (first, lazyproperty, _is_int, _is_pseudo_unsigned,
@@ -19,6 +20,13 @@ from ..util import (first, lazyproperty, _is_int, _is_pseudo_unsigned,
                     decode_ascii, deprecated, _get_array_mmap, _array_to_file)
 from ..verify import _Verify, _ErrList
 
+try:
+    # C implementation of the FITS checksum; when missing, the numpy
+    # implementation below is used instead
+    from .. import _checksum
+except ImportError:
+    _checksum = None
+
 
 class _Delayed(object):
     pass
@@ -33,6 +41,66 @@ class InvalidHDUException(Exception):
     """
 
 
+# Dispatch table resolving the common standard HDU classes directly from the
+# first card of a header plus a couple of structural keywords; built lazily by
+# _standard_hdu_class_from_header to avoid circular imports at load time
+_standard_hdu_dispatch = None
+
+
+def _standard_hdu_class_from_header(header):
+    """
+    Resolve the standard HDU class for a header from its first card and a
+    couple of structural keywords with a dict lookup; returns None if the
+    header is not one of the common standard types, in which case
+    `_hdu_class_from_header` falls back to trying ``match_header`` on every
+    registered `_BaseHDU` subclass.
+    """
+
+    global _standard_hdu_dispatch
+    if _standard_hdu_dispatch is None:
+        from .compressed import CompImageHDU
+        from .groups import GroupsHDU
+        from .image import PrimaryHDU, ImageHDU
+        from .table import TableHDU, BinTableHDU
+        _standard_hdu_dispatch = {
+            ('SIMPLE', 'GROUPS'): GroupsHDU,
+            ('SIMPLE', ''): PrimaryHDU,
+            ('XTENSION', 'IMAGE'): ImageHDU,
+            ('XTENSION', 'TABLE'): TableHDU,
+            ('XTENSION', 'BINTABLE'): BinTableHDU,
+            ('XTENSION', 'A3DTABLE'): BinTableHDU,
+            ('XTENSION', 'ZIMAGE'): CompImageHDU,
+        }
+
+    card = header.cards[0]
+    keyword = card.keyword
+
+    if keyword == 'SIMPLE':
+        if card.value != True:
+            # SIMPLE = F files are _NonstandardHDU; leave them to the walk
+            return None
+        if 'GROUPS' in header and header['GROUPS'] == True:
+            marker = 'GROUPS'
+        else:
+            marker = ''
+        return _standard_hdu_dispatch[('SIMPLE', marker)]
+    elif keyword == 'XTENSION':
+        xtension = card.value
+        if isinstance(xtension, string_types):
+            xtension = xtension.rstrip()
+        if (xtension in ('BINTABLE', 'A3DTABLE') and
+                'ZIMAGE' in header and header['ZIMAGE'] == True):
+            klass = _standard_hdu_dispatch[('XTENSION', 'ZIMAGE')]
+            # CompImageHDU.match_header performs the compression support
+            # checks (and associated warnings); if compression is unavailable
+            # such HDUs are handled as plain binary tables, as in the walk
+            if klass.match_header(header):
+                return klass
+        return _standard_hdu_dispatch.get(('XTENSION', xtension))
+
+    return None
+
+
 def _hdu_class_from_header(cls, header):
     """
     Used primarily by _BaseHDU.__new__ to find an appropriate HDU class to use
@@ -41,6 +109,19 @@ def _hdu_class_from_header(cls, header):
 
     klass = cls  # By default, if no subclasses are defined
     if header:
+        # Common standard HDU types are resolved directly; only nonstandard
+        # headers--or the presence of explicitly registered extension HDU
+        # classes, which may take precedence over the standard ones--require
+        # trying match_header on every subclass
+        if not cls._hdu_registry:
+            try:
+                standard = _standard_hdu_class_from_header(header)
+            except Exception:
+                # Fall through to the subclass walk, which produces the usual
+                # warnings and _CorruptedHDU handling for unparseable headers
+                standard = None
+            if standard is not None and issubclass(standard, cls):
+                return standard
         for c in reversed(list(itersubclasses(cls))):
             try:
                 # HDU classes built into pyfits are always considered, but
@@ -116,6 +197,12 @@ class _BaseHDU(object):
         self._data_needs_rescale = False
         self._new = True
         self._output_checksum = False
+        self._datasum_verified = False
+
+        # Dirty byte ranges and per-block partial sums for incremental
+        # DATASUM updates; only used once mark_data_updated has been called
+        self._datasum_dirty_ranges = None
+        self._datasum_block_sums = None
 
         if 'DATASUM' in self._header and 'CHECKSUM' not in self._header:
             self._output_checksum = 'datasum'
@@ -365,13 +452,18 @@ class _BaseHDU(object):
 
     @classmethod
     def _readfrom_internal(cls, data, header=None, checksum=False,
-                           ignore_missing_end=False, **kwargs):
+                           ignore_missing_end=False, offset=0, **kwargs):
         """
         Provides the bulk of the internal implementation for readfrom and
         fromstring.
 
         For some special cases, supports using a header that was already
         created, and just using the input data for the actual array data.
+
+        When constructing from an in-memory buffer, ``offset`` gives the
+        byte position in the buffer at which this HDU begins; the buffer is
+        kept as-is and referenced at an offset rather than sliced, so that
+        reading many HDUs out of one buffer does not copy it over and over.
         """
 
         hdu_buffer = None
@@ -403,7 +495,7 @@ class _BaseHDU(object):
 
             if header is None:
                 def block_iter(nbytes):
-                    idx = 0
+                    idx = offset
                     while idx < len(data):
                         yield data[idx:idx + nbytes]
                         idx += nbytes
@@ -411,13 +503,13 @@ class _BaseHDU(object):
                 header_str, header = Header._from_blocks(
                     block_iter, True, '', not ignore_missing_end, True)
 
-                if len(data) > len(header_str):
+                if len(data) > offset + len(header_str):
                     hdu_buffer = data
             elif data:
                 hdu_buffer = data
 
-            header_offset = 0
-            data_offset = len(header_str)
+            header_offset = offset
+            data_offset = offset + len(header_str)
 
         # Determine the appropriate arguments to pass to the constructor from
         # self._kwargs.  self._kwargs contains any number of optional arguments
@@ -661,6 +753,16 @@ class _BaseHDU(object):
         datsize = self._data_size
 
         if self._header._modified:
+            # If the header shrank within its original allocation on disk, pad
+            # it back out with blank cards so that the data following it does
+            # not have to move; the blank cards remain as slack space that
+            # future keyword insertions can consume (via the normal useblanks
+            # machinery) without growing the header
+            if not copy:
+                nbytes = len(str(self._header))
+                if nbytes < hdrsize:
+                    for _ in range((hdrsize - nbytes) // Card.length):
+                        self._header.append()
             # Seek to the original header location in the file
             self._file.seek(hdrloc)
             # This should update hdrloc with he header location in the new file
@@ -694,11 +796,22 @@ class _BaseHDU(object):
                 else:
                     array_mmap = _get_array_mmap(self.data)
 
-                if array_mmap is not None:
+                if array_mmap is not None and not self._file.cow:
                     array_mmap.flush()
                 else:
+                    # Either the data is a plain in-memory array, or it is a
+                    # copy-on-write mapping whose modifications exist only in
+                    # its private pages; in both cases write the data back,
+                    # comparing against the existing file contents for
+                    # in-place updates so that only the ranges that actually
+                    # changed are rewritten
                     self._file.seek(self._data_offset)
-                    datloc, datsize = self._writedata(fileobj)
+                    if not copy and fileobj is self._file:
+                        fileobj._compare_writes = True
+                    try:
+                        datloc, datsize = self._writedata(fileobj)
+                    finally:
+                        fileobj._compare_writes = False
         elif copy:
             datsize = self._writedata_direct_copy(fileobj)
 
@@ -844,9 +957,10 @@ class _NonstandardHDU(_BaseHDU, _Verify):
     def _verify(self, option='warn'):
         errs = _ErrList([], unit='Card')
 
-        # verify each card
-        for card in self._header.cards:
-            errs.append(card._verify(option))
+        # verify each card; standard cards are passed over quickly by the
+        # batched check in Header._verify_cards
+        for err in self._header._verify_cards(option):
+            errs.append(err)
 
         return errs
 
@@ -1100,9 +1214,10 @@ class _ValidHDU(_BaseHDU, _Verify):
                 errs.append(self.run_option(option, err_text=err_text,
                                             fix_text=fix_text, fix=fix))
 
-        # verify each card
-        for card in self._header.cards:
-            errs.append(card._verify(option))
+        # verify each card; standard cards are passed over quickly by the
+        # batched check in Header._verify_cards
+        for err in self._header._verify_cards(option):
+            errs.append(err)
 
         return errs
 
@@ -1226,6 +1341,99 @@ class _ValidHDU(_BaseHDU, _Verify):
 
         return errs
 
+    def mark_data_updated(self, start=0, stop=None):
+        """
+        Mark a byte range ``[start, stop)`` of this HDU's data unit as
+        modified in place.
+
+        When only parts of the data of an HDU from a file opened in update
+        mode have been modified, marking the modified ranges allows the
+        ``DATASUM`` recomputed at flush time to be updated incrementally:
+        the FITS 1's complement sum is linear, so only the 2880-byte blocks
+        overlapping a marked range are re-summed, with the contribution of
+        the remaining blocks taken from a cache of per-block partial sums
+        that is built lazily on the first recomputation.  For example, after
+        assigning to rows ``i:j`` of a binary table::
+
+            hdul[1].data[i:j] = newrows
+            hdul[1].mark_data_updated(i * rowsize, j * rowsize)
+            hdul.flush()
+
+        ``stop`` defaults to the end of the data unit.  Once an HDU has been
+        marked, only marked ranges are re-summed, so every in-place
+        modification must be marked or the checksum will be stale.  HDUs
+        whose data cannot be summed in place (replaced data, byte-swapped or
+        scaled arrays, variable-length array columns) are always summed in
+        full, whether or not they were marked.
+        """
+
+        if self._datasum_dirty_ranges is None:
+            self._datasum_dirty_ranges = []
+        self._datasum_dirty_ranges.append((start, stop))
+
+    def _datasum_raw_bytes(self):
+        """
+        The current contents of the data unit as a flat ubyte array in file
+        byte order, or `None` if the in-memory data is not laid out exactly
+        as it would be in the file, in which case incremental datasums do
+        not apply.  Subclasses for which an in-place layout is possible
+        override this.
+        """
+
+        return None
+
+    def _incremental_datasum(self, blocking):
+        """
+        Compute the ``DATASUM`` from the per-block partial sum cache,
+        re-summing only the blocks overlapping ranges marked with
+        `mark_data_updated`.  Returns `None` when incremental computation is
+        not possible, in which case the caller falls back to a full pass.
+        """
+
+        if (self._datasum_dirty_ranges is None or
+                blocking not in ('standard', 'either', True) or
+                not self._data_loaded or self.data is None or
+                self._data_replaced):
+            return None
+
+        raw = self._datasum_raw_bytes()
+        if raw is None:
+            return None
+
+        blocklen = 2880
+        nbytes = len(raw)
+        nblocks = (nbytes + blocklen - 1) // blocklen
+
+        if (self._datasum_block_sums is None or
+                len(self._datasum_block_sums) != nblocks):
+            # First computation (or the data unit changed size); sum every
+            # block to prime the cache
+            self._datasum_block_sums = [0] * nblocks
+            dirty = range(nblocks)
+        else:
+            dirty = set()
+            for start, stop in self._datasum_dirty_ranges:
+                if stop is None or stop > nbytes:
+                    stop = nbytes
+                start = max(0, start)
+                if start < stop:
+                    dirty.update(range(start // blocklen,
+                                       (stop + blocklen - 1) // blocklen))
+
+        sums = self._datasum_block_sums
+        for blk in dirty:
+            block = raw[blk * blocklen:(blk + 1) * blocklen]
+            sums[blk] = int(self._compute_checksum(block))
+
+        self._datasum_dirty_ranges = []
+
+        # The whole checksum is an end-around-carry sum, i.e. arithmetic
+        # modulo 2**32 - 1, so the per-block sums simply add up
+        total = sum(sums)
+        while total >> 32:
+            total = (total & 0xFFFFFFFF) + (total >> 32)
+        return np.uint32(total)
+
     def add_datasum(self, when=None, blocking='standard',
                     datasum_keyword='DATASUM'):
         """
@@ -1416,7 +1624,10 @@ class _ValidHDU(_BaseHDU, _Verify):
             self._datasum = self._header['DATASUM']
             self._datasum_comment = self._header.comments['DATASUM']
 
-            if not self.verify_datasum(blocking):
+            # Remember the result of the verification; a verified datasum can
+            # later be used as a proxy for the data itself (e.g. by FITSDiff)
+            self._datasum_verified = (self.verify_datasum(blocking) == 1)
+            if not self._datasum_verified:
                 warnings.warn('Datasum verification failed for HDU %s.\n' %
                               ((self.name, self.ver),))
         else:
@@ -1440,6 +1651,10 @@ class _ValidHDU(_BaseHDU, _Verify):
         Calculate the value for the ``DATASUM`` card in the HDU.
         """
 
+        datasum = self._incremental_datasum(blocking)
+        if datasum is not None:
+            return datasum
+
         if not self._data_loaded:
             # This is the case where the data has not been read from the file
             # yet.  We find the data in the file, read it, and calculate the
@@ -1510,6 +1725,12 @@ class _ValidHDU(_BaseHDU, _Verify):
                     'either': 2880,  # do standard first
                     True: 2880}[blocking]
 
+        if _checksum is not None and len(data) > 0:
+            if not data.flags.contiguous:
+                data = np.ascontiguousarray(data)
+            return np.uint32(
+                _checksum.compute_checksum(data, int(sum32), blocklen))
+
         sum32 = np.uint32(sum32)
         for i in range(0, len(data), blocklen):
             length = min(blocklen, len(data) - i)   # ????
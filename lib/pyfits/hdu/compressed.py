@@ -379,6 +379,12 @@ class CompImageHDU(BinTableHDU):
     responsibility).
     """
 
+    def _load_native_byteorder(self):
+        # The compression module operates directly on the raw big-endian
+        # table buffer, so never byteswap it at load regardless of the
+        # NATIVE_TABLE_BYTEORDER setting
+        return False
+
     def __init__(self, data=None, header=None, name=None,
                  compression_type=DEFAULT_COMPRESSION_TYPE,
                  tile_size=None,
@@ -408,7 +414,10 @@ class CompImageHDU(BinTableHDU):
         compression_type : str, optional
             Compression algorithm: one of
             ``'RICE_1'``, ``'RICE_ONE'``, ``'PLIO_1'``, ``'GZIP_1'``,
-            ``'GZIP_2'``, ``'HCOMPRESS_1'``
+            ``'GZIP_2'``, ``'HCOMPRESS_1'``; or ``'auto'`` to compress a
+            sample of the image with a few candidate algorithms and tile
+            sizes and pick the configuration giving the best trade-off of
+            compression ratio and speed
 
         tile_size : int, optional
             Compression tile sizes.  Default treats each row of image as a
@@ -623,6 +632,17 @@ class CompImageHDU(BinTableHDU):
             # Store the input image data
             self.data = data
 
+            # Resolve the 'auto' compression type by sampling candidate
+            # configurations on a subset of the image
+            if compression_type == 'auto':
+                if isinstance(data, np.ndarray):
+                    (compression_opts['compression_type'],
+                     compression_opts['tile_size']) = \
+                        self._auto_tune_compression(data, compression_opts)
+                else:
+                    compression_opts['compression_type'] = \
+                        DEFAULT_COMPRESSION_TYPE
+
             # Update the table header (_header) to the compressed
             # image format and to match the input data (if any);
             # Create the image header (_image_header) from the input
@@ -680,6 +700,88 @@ class CompImageHDU(BinTableHDU):
             # Compression is supported but disabled; just pass silently (#92)
             return False
 
+    # Tile heights (in image rows) tried by compression_type='auto'; each
+    # candidate tiles the image in full-width strips of this many rows
+    _AUTO_TILE_ROWS = [1, 16, 64]
+
+    # Maximum number of image rows compressed when sampling candidate
+    # configurations for compression_type='auto'
+    _AUTO_SAMPLE_ROWS = 256
+
+    def _auto_tune_compression(self, data, compression_opts):
+        """
+        Choose a compression type and tile size for ``data`` by compressing a
+        small sample of the image with a few candidate configurations and
+        comparing the resulting compressed sizes and times.
+
+        Returns a ``(compression_type, tile_size)`` tuple; among candidates
+        whose compressed size is within a few percent of the best one, the
+        fastest is chosen.
+        """
+
+        if data.dtype.kind == 'f':
+            codecs = ['RICE_1', 'GZIP_2']
+            if data.ndim == 2 and data.shape[0] >= 4 and data.shape[1] >= 4:
+                codecs.append('HCOMPRESS_1')
+        else:
+            codecs = ['RICE_1', 'GZIP_1']
+            # PLIO is only usable for positive integer (mask-like) data
+            if data.size and data.min() >= 0 and data.max() < 2 ** 24:
+                codecs.append('PLIO_1')
+
+        if data.ndim < 2:
+            sample = data
+        else:
+            # Sample a band of rows from the middle of the image, which is
+            # more likely to contain representative signal than the edges
+            nrows = min(len(data), self._AUTO_SAMPLE_ROWS)
+            start = (len(data) - nrows) // 2
+            sample = data[start:start + nrows]
+
+        trial_opts = dict(compression_opts)
+        results = []
+
+        for codec in codecs:
+            for rows in self._AUTO_TILE_ROWS:
+                if data.ndim < 2:
+                    if rows != self._AUTO_TILE_ROWS[0]:
+                        continue  # only one sensible geometry for 1-d data
+                    sample_tiles = full_tiles = None
+                else:
+                    if codec == 'HCOMPRESS_1' and rows < 4:
+                        continue  # HCOMPRESS needs at least 4x4 tiles
+                    sample_tiles = ([data.shape[-1],
+                                     min(rows, len(sample))] +
+                                    [1] * (data.ndim - 2))
+                    full_tiles = ([data.shape[-1], rows] +
+                                  [1] * (data.ndim - 2))
+
+                trial_opts['compression_type'] = codec
+                trial_opts['tile_size'] = sample_tiles
+
+                try:
+                    trial = self.__class__(data=sample, **trial_opts)
+                    begin = time.time()
+                    trial._update_compressed_data()
+                    elapsed = time.time() - begin
+                    size = trial.compressed_data._heapsize
+                except Exception:
+                    # candidate not applicable to this data; skip it
+                    continue
+
+                results.append((size, elapsed, codec, full_tiles))
+
+        if not results:
+            return DEFAULT_COMPRESSION_TYPE, None
+
+        # Among the candidates within 5% of the best compressed size, take
+        # the fastest one
+        best_size = min(result[0] for result in results)
+        close = [result for result in results
+                 if result[0] <= best_size * 1.05]
+        close.sort(key=lambda result: result[1])
+        return close[0][2], close[0][3]
+
     def _update_header_data(self, image_header,
                             name=None,
                             compression_type=None,
@@ -783,8 +885,8 @@ class CompImageHDU(BinTableHDU):
 
         # Set the compression type in the table header.
         if compression_type:
-            if compression_type not in ['RICE_1', 'GZIP_1', 'PLIO_1',
-                                        'HCOMPRESS_1']:
+            if compression_type not in ['RICE_1', 'GZIP_1', 'GZIP_2',
+                                        'PLIO_1', 'HCOMPRESS_1']:
                 warnings.warn('Unknown compression type provided.  Default '
                               '(%s) compression used.' %
                               DEFAULT_COMPRESSION_TYPE)
@@ -1439,6 +1541,17 @@ class CompImageHDU(BinTableHDU):
         # Determine from the values read from the header
         return tuple(reversed(self._axes))
 
+    @property
+    def section(self):
+        """
+        Access a section of the image array without decompressing the entire
+        image.  Like `ImageHDU.section`, slices of the returned object return
+        the appropriate slice of the image data, but here only the tiles
+        overlapping the requested section are decompressed.
+        """
+
+        return CompImageSection(self)
+
     @lazyproperty
     def header(self):
         # The header attribute is the header for the image data.  It
@@ -1920,3 +2033,109 @@ class CompImageHDU(BinTableHDU):
                     10000) + 1
         else:
             return seed
+
+
+class CompImageSection(object):
+    """
+    Image section for compressed image HDUs.
+
+    Slices of this object decompress only the tiles of the underlying
+    compressed image that overlap the requested section, making it practical
+    to read small cutouts out of large tile-compressed images.
+
+    Section slices cannot be assigned to, and modifications to a section are
+    not saved back to the underlying file.
+
+    Any BSCALE/BZERO factors that would be applied to the full ``.data``
+    array are also applied to the section, and pixels blanked via a ZBLANK
+    or BLANK header keyword are replaced with nans; pixels blanked through
+    a per-tile ZBLANK table column are not, as finding them would require
+    reading the entire compressed table.
+    """
+
+    def __init__(self, hdu):
+        self.hdu = hdu
+
+    def __getitem__(self, key):
+        if not isinstance(key, tuple):
+            key = (key,)
+
+        naxis = len(self.hdu.shape)
+        if len(key) > naxis:
+            raise IndexError('too many indices')
+        elif len(key) < naxis:
+            key = key + (slice(None),) * (naxis - len(key))
+
+        # Determine the first/last pixel (0-based, inclusive) covered by each
+        # index, along with any step to apply to the decompressed section and
+        # which axes were indexed by scalars (and so are dropped from the
+        # result, as with normal ndarray indexing)
+        firsts = []
+        lasts = []
+        steps = []
+        scalar_axes = []
+        for idx in range(naxis):
+            axis = self.hdu.shape[idx]
+            indx = key[idx]
+            if isinstance(indx, slice):
+                start, stop, step = indx.indices(axis)
+                if step < 1:
+                    raise IndexError('Negative slice steps are not supported')
+                npts = len(range(start, stop, step))
+                if npts == 0:
+                    raise IndexError('Slice is empty')
+                last = start + (npts - 1) * step
+            else:
+                indx = int(indx)
+                if indx < 0:
+                    indx += axis
+                if not 0 <= indx < axis:
+                    raise IndexError('index out of range')
+                start = last = indx
+                step = 1
+                scalar_axes.append(idx)
+
+            firsts.append(start)
+            lasts.append(last)
+            steps.append(step)
+
+        # CFITSIO takes the pixel ranges 1-based and in FITS axis order
+        # (fastest varying axis first)--the reverse of the numpy axis order
+        fpixel = [first + 1 for first in reversed(firsts)]
+        lpixel = [last + 1 for last in reversed(lasts)]
+
+        data = compression.decompress_section(self.hdu, fpixel, lpixel)
+
+        if any(step > 1 for step in steps):
+            data = data[tuple(slice(None, None, step) for step in steps)]
+
+        if scalar_axes:
+            data = data.reshape([dim for idx, dim in enumerate(data.shape)
+                                 if idx not in scalar_axes])
+
+        # Scale the data if necessary (same as the .data property, except
+        # that a per-tile ZBLANK column cannot be consulted, as that would
+        # require reading the whole compressed table)
+        if self.hdu._orig_bzero != 0 or self.hdu._orig_bscale != 1:
+            new_dtype = self.hdu._dtype_for_bitpix()
+            data = np.array(data, dtype=new_dtype)
+
+            zblank = None
+
+            if 'ZBLANK' in self.hdu._header:
+                zblank = np.array(self.hdu._header['ZBLANK'], dtype='int32')
+            elif 'BLANK' in self.hdu._header:
+                zblank = np.array(self.hdu._header['BLANK'], dtype='int32')
+
+            if zblank is not None:
+                blanks = (data == zblank)
+
+            if self.hdu._bscale != 1:
+                np.multiply(data, self.hdu._bscale, data)
+            if self.hdu._bzero != 0:
+                data += self.hdu._bzero
+
+            if zblank is not None:
+                data = np.where(blanks, np.nan, data)
+
+        return data
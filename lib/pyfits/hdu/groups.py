@@ -35,20 +35,11 @@ class Group(FITS_record):
         Get the group parameter value.
         """
 
-        if _is_int(parname):
-            result = self.array[self.row][parname]
-        else:
-            indx = self._unique[parname.upper()]
-            if len(indx) == 1:
-                result = self.array[self.row][indx[0]]
-
-            # if more than one group parameter have the same name
-            else:
-                result = self.array[self.row][indx[0]].astype('f8')
-                for i in indx[1:]:
-                    result += self.array[self.row][i]
-
-        return result
+        # Index into the full parameter vector computed (and, for duplicated
+        # parameter names, cached) by the parent array; this keeps row-by-row
+        # access in a loop over groups from redoing the name resolution and
+        # summing arithmetic for every group
+        return self.array.par(parname)[self.row]
 
     def setpar(self, parname, value):
         """
@@ -78,6 +69,10 @@ class Group(FITS_record):
                     raise ValueError('Parameter value must be a sequence '
                                      'with %d arrays/numbers.' % len(indx))
 
+        # Any summed parameter vectors cached on the parent array may now be
+        # stale
+        getattr(self.array, '_par_cache', {}).clear()
+
 
 class GroupData(FITS_rec):
     """
@@ -224,11 +219,21 @@ class GroupData(FITS_rec):
             if len(indx) == 1:
                 result = self.field(indx[0])
 
-            # if more than one group parameter have the same name
+            # if more than one group parameter have the same name their
+            # contributions are summed; cache the summed vector, since
+            # rebuilding it on every call is wasteful for large group counts
+            # (the cache is invalidated by Group.setpar)
             else:
-                result = self.field(indx[0]).astype('f8')
-                for i in indx[1:]:
-                    result += self.field(i)
+                cache = getattr(self, '_par_cache', None)
+                if cache is None:
+                    cache = self._par_cache = {}
+                name = parname.upper()
+                if name not in cache:
+                    result = self.field(indx[0]).astype('f8')
+                    for i in indx[1:]:
+                        result += self.field(i)
+                    cache[name] = result
+                result = cache[name]
 
         return result
 
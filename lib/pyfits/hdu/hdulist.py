@@ -2,9 +2,11 @@ import gzip
 import os
 import shutil
 import sys
+import threading
 import warnings
 
-from ..extern.six import print_
+from ..extern.six import print_, reraise, string_types
+from ..extern.six.moves import queue
 from ..file import _File
 from ..util import (_is_int, _tmp_name, _pad_length, ignore_sigint,
                     _get_array_mmap, indent, fileobj_closed)
@@ -13,6 +15,39 @@ from . import compressed
 from .base import _BaseHDU, _ValidHDU, _NonstandardHDU, ExtensionHDU
 from .groups import GroupsHDU
 from .image import PrimaryHDU, ImageHDU
+from ..header import Header
+
+
+# In-process cache of HDU offset indexes for previously opened files, so
+# that reopening an unchanged many-extension file can read each header
+# with a single exact-sized read instead of scanning for the END card
+# block by block.  Keyed by (absolute filename, size, mtime); each value
+# is a list of (header offset, data offset, data size) tuples.
+_hdu_offset_cache = {}
+_HDU_OFFSET_CACHE_MAXFILES = 32
+
+# Number of worker threads used by HDUList.writeto to run the _prewriteto
+# stage (including checksum computation) of upcoming HDUs while the current
+# HDU's bytes are being written out
+_WRITETO_PREPARE_WORKERS = 2
+
+
+def _hdu_offset_cache_key(ffo):
+    """
+    Return the cache key for an open `_File`, or `None` if the file is
+    not a plain uncompressed disk file that can be validated by its size
+    and modification time.
+    """
+
+    if (ffo.compression or not ffo.name or
+            not isinstance(ffo.name, string_types) or
+            not os.path.isfile(ffo.name)):
+        return None
+    try:
+        stat = os.stat(ffo.name)
+    except OSError:
+        return None
+    return (os.path.abspath(ffo.name), stat.st_size, stat.st_mtime)
 
 
 def fitsopen(name, mode='readonly', memmap=None, save_backup=False, **kwargs):
@@ -87,6 +122,17 @@ def fitsopen(name, mode='readonly', memmap=None, save_backup=False, **kwargs):
             if scaling back to integer values after performing floating point
             operations on the data.
 
+        - **cow** : bool
+
+            Only applies when opening with ``mode='update'`` and
+            ``memmap=True``.  If `True`, the data is mmapped copy-on-write
+            instead of shared: in-place modifications are held in memory
+            rather than hitting the file as soon as the kernel decides to
+            write the page back, and :meth:`HDUList.flush` writes back only
+            the byte ranges that actually changed.  This makes small updates
+            to very large files cheaper, at the cost of keeping the modified
+            pages in memory until the flush.
+
     Returns
     -------
         hdulist : an `HDUList` object
@@ -270,6 +316,33 @@ class HDUList(list, _Verify):
 
         return cls._readfrom(data=data, **kwargs)
 
+    @classmethod
+    def _read_from_hdu_index(cls, ffo, hdu_index, **kwargs):
+        """
+        Read all the HDUs of an open file whose layout is already known
+        from a previous read of the unchanged file.  ``hdu_index`` is a
+        list of ``(header offset, data offset, data size)`` tuples, one
+        per HDU.  Each header is read with a single exact-sized read and
+        the data is skipped with a direct seek, avoiding the block-by-
+        block search for the END card and the per-HDU size rediscovery
+        of a normal sequential read.
+        """
+
+        checksum = kwargs.get('checksum', False)
+        hdus = []
+        for header_offset, data_offset, data_size in hdu_index:
+            ffo.seek(header_offset)
+            header_str = ffo.read(data_offset - header_offset)
+            header = Header.fromstring(header_str)
+            hdu = _BaseHDU._readfrom_internal(ffo, header=header, **kwargs)
+            hdu._header_offset = header_offset
+            ffo.seek(hdu._data_offset + hdu._data_size, os.SEEK_SET)
+            hdu._new = False
+            if 'checksum' in kwargs:
+                hdu._output_checksum = checksum
+            hdus.append(hdu)
+        return hdus
+
     def fileinfo(self, index):
         """
         Returns a dictionary detailing information about the locations
@@ -646,15 +719,97 @@ class HDUList(list, _Verify):
         fileobj = _File(fileobj, mode='ostream', clobber=clobber)
         hdulist = self.fromfile(fileobj)
 
-        for hdu in self:
-            hdu._prewriteto(checksum=checksum)
-            try:
-                hdu._writeto(hdulist.__file)
-            finally:
-                hdu._postwriteto()
+        if len(self) > 1:
+            # Overlap preparation of upcoming HDUs (in particular their
+            # checksum computation) with writing out the current HDU
+            self._writeto_pipelined(hdulist.__file, checksum)
+        else:
+            for hdu in self:
+                hdu._prewriteto(checksum=checksum)
+                try:
+                    hdu._writeto(hdulist.__file)
+                finally:
+                    hdu._postwriteto()
 
         hdulist.close(output_verify=output_verify, closed=closed)
 
+    def _writeto_pipelined(self, fileobj, checksum):
+        """
+        Write all HDUs to the given `_File` in order, with the _prewriteto
+        stage of upcoming HDUs (checksum and scale keyword updates) running
+        on worker threads while the current HDU's bytes are being written.
+
+        The on-disk result is identical to the serial loop in `writeto`; only
+        the preparation work is overlapped.  The number of HDUs prepared
+        ahead of the writer is bounded so that at most a few HDUs at a time
+        carry the temporary header modifications made by _prewriteto.
+        """
+
+        nworkers = min(_WRITETO_PREPARE_WORKERS, len(self) - 1)
+        # Bounds how far preparation may run ahead of the writer
+        lookahead = threading.Semaphore(nworkers + 1)
+        prepared = [threading.Event() for hdu in self]
+        errors = [None] * len(self)
+        indices = queue.Queue()
+        for idx in range(len(self)):
+            indices.put(idx)
+
+        def prepare():
+            while True:
+                # Acquiring the lookahead slot before taking an index
+                # guarantees that every taken index is actively being
+                # prepared, so the writer can never deadlock waiting on an
+                # HDU whose worker is itself waiting for a slot
+                lookahead.acquire()
+                try:
+                    idx = indices.get_nowait()
+                except queue.Empty:
+                    return
+                try:
+                    self[idx]._prewriteto(checksum=checksum)
+                except Exception:
+                    errors[idx] = sys.exc_info()
+                prepared[idx].set()
+
+        workers = []
+        for _ in range(nworkers):
+            worker = threading.Thread(target=prepare)
+            worker.setDaemon(True)
+            worker.start()
+            workers.append(worker)
+
+        written = 0
+        try:
+            for idx, hdu in enumerate(self):
+                prepared[idx].wait()
+                if errors[idx] is not None:
+                    reraise(*errors[idx])
+                try:
+                    hdu._writeto(fileobj)
+                finally:
+                    hdu._postwriteto()
+                written += 1
+                lookahead.release()
+        finally:
+            # Retire the workers: drain any unstarted indices, then wake
+            # every worker blocked on the lookahead semaphore so that it can
+            # see the empty queue and exit
+            while True:
+                try:
+                    indices.get_nowait()
+                except queue.Empty:
+                    break
+            for _ in workers:
+                lookahead.release()
+            for worker in workers:
+                worker.join()
+            # Undo the _prewriteto header modifications on any HDU that was
+            # prepared but never written (only reachable when a write or
+            # preparation failed part way through)
+            for idx in range(written, len(self)):
+                if prepared[idx].isSet() and errors[idx] is None:
+                    self[idx]._postwriteto()
+
     def close(self, output_verify='exception', verbose=False, closed=True):
         """
         Close the associated FITS file and memmap object, if any.
@@ -752,10 +907,12 @@ class HDUList(list, _Verify):
         implementations are largely the same.
         """
 
+        cow = kwargs.pop('cow', False)
+
         if fileobj is not None:
             if not isinstance(fileobj, _File):
                 # instantiate a FITS file object (ffo)
-                ffo = _File(fileobj, mode=mode, memmap=memmap)
+                ffo = _File(fileobj, mode=mode, memmap=memmap, cow=cow)
             else:
                 ffo = fileobj
             # The pyfits mode is determined by the _File initializer if the
@@ -782,7 +939,30 @@ class HDUList(list, _Verify):
                 kwargs['disable_image_compression']):
                 compressed.COMPRESSION_ENABLED = False
 
+            cache_key = None
+            if fileobj is not None and mode in ('readonly', 'denywrite'):
+                cache_key = _hdu_offset_cache_key(ffo)
+
+            if cache_key is not None and cache_key in _hdu_offset_cache:
+                # This file was fully read before and has not changed, so
+                # every HDU's extent is already known; read each header
+                # with one exact-sized read and seek straight past the
+                # data, instead of rediscovering the layout.
+                try:
+                    hdus = cls._read_from_hdu_index(
+                        ffo, _hdu_offset_cache[cache_key], **kwargs)
+                except Exception:
+                    # Fall back to the normal HDU discovery below
+                    del _hdu_offset_cache[cache_key]
+                    ffo.seek(0)
+                else:
+                    hdulist.extend(hdus)
+                    hdulist._resize = False
+                    hdulist._truncate = False
+                    return hdulist
+
             # read all HDUs
+            data_pos = 0
             while True:
                 try:
                     if fileobj is not None:
@@ -801,10 +981,13 @@ class HDUList(list, _Verify):
                             else:
                                 raise
                     else:
-                        if not data:
+                        if data_pos >= len(data):
                             break
-                        hdu = _BaseHDU.fromstring(data)
-                        data = data[hdu._data_offset + hdu._data_size:]
+                        # Construct each HDU at its offset into the buffer;
+                        # slicing the buffer here would copy the entire
+                        # remainder for every HDU read out of it
+                        hdu = _BaseHDU.fromstring(data, offset=data_pos)
+                        data_pos = hdu._data_offset + hdu._data_size
                     hdulist.append(hdu)
                     hdu._new = False
                     if 'checksum' in kwargs:
@@ -827,6 +1010,13 @@ class HDUList(list, _Verify):
             if mode in ('readonly', 'denywrite') and len(hdulist) == 0:
                 raise IOError('Empty or corrupt FITS file')
 
+            if cache_key is not None and len(hdulist) > 1:
+                if len(_hdu_offset_cache) >= _HDU_OFFSET_CACHE_MAXFILES:
+                    _hdu_offset_cache.clear()
+                _hdu_offset_cache[cache_key] = [
+                    (hdu._header_offset, hdu._data_offset, hdu._data_size)
+                    for hdu in hdulist]
+
             # initialize/reset attributes to be used in "update/append" mode
             hdulist._resize = False
             hdulist._truncate = False
@@ -898,11 +1088,14 @@ class HDUList(list, _Verify):
             # if the HDUList is resized, need to write out the entire contents of
             # the hdulist to the file.
             if self._resize or self.__file.compression:
-                self._flush_resize()
+                if self.__file.compression or not self._flush_shift():
+                    self._flush_resize()
             else:
-                # if not resized, update in place
+                # if not resized, update in place, skipping any HDUs whose
+                # header and data were both untouched
                 for hdu in self:
-                    hdu._writeto(self.__file, inplace=True)
+                    if hdu._header._modified or hdu._data_loaded:
+                        hdu._writeto(self.__file, inplace=True)
 
             # reset the modification attributes after updating
             for hdu in self:
@@ -911,6 +1104,181 @@ class HDUList(list, _Verify):
             for hdu in self:
                 hdu._postwriteto()
 
+    # Number of bytes to move per chunk when shifting trailing HDUs in place
+    # after a structural change in update mode
+    _SHIFT_BLOCK_BYTES = 2 ** 24
+
+    def _flush_shift(self):
+        """
+        Attempt to flush a structural change (HDUs inserted, removed, or
+        replaced) by moving only the affected bytes of the file in place,
+        instead of rewriting the entire file as `_flush_resize` does.
+
+        This is possible when the change amounts to a single contiguous
+        edited region: the HDUs before it stay where they are, the HDUs after
+        it all shift by the same amount (performed as one large block move),
+        and the new or replaced HDUs are written into the gap.  Replacing an
+        HDU with one of exactly the same on-disk size rewrites nothing but
+        that extent.  Returns `True` if the flush was handled this way;
+        otherwise the caller falls back to the full rewrite.
+        """
+
+        ffo = self.__file
+
+        if ffo.file_like or ffo.compression or ffo.simulateonly:
+            return False
+
+        # Lay out the new file, classifying each HDU: clean HDUs keep their
+        # exact on-disk extent (possibly shifted as a whole), while everything
+        # else--new HDUs and HDUs whose header or data changed size--must be
+        # written out in full at its new offset
+        clean = []      # [hdu, old_start, old_end, delta]
+        dirty = []      # (hdu, new_offset)
+        deltas = []
+        pos = 0
+        prev_old_start = -1
+
+        for hdu in self:
+            is_clean = (not hdu._new and hdu._file is ffo and
+                        hdu._header_offset is not None and
+                        hdu._data_offset is not None and
+                        hdu._data_size is not None)
+            if is_clean and hdu._header._modified:
+                hdrsize = hdu._data_offset - hdu._header_offset
+                if len(str(hdu._header)) > hdrsize:
+                    is_clean = False
+            if is_clean and hdu._has_data:
+                # Locally loaded or replaced data may have changed size
+                nbytes = hdu.size
+                if nbytes + _pad_length(nbytes) != hdu._data_size:
+                    is_clean = False
+
+            if is_clean:
+                old_start = hdu._header_offset
+                if old_start <= prev_old_start:
+                    # The existing HDUs were reordered; leave that to the
+                    # full rewrite
+                    return False
+                prev_old_start = old_start
+                old_end = hdu._data_offset + hdu._data_size
+                delta = pos - old_start
+                if (delta != 0 and hdu._data_loaded and
+                        hdu.data is not None and
+                        _get_array_mmap(hdu.data) is not None):
+                    # An mmap'd array cannot be cheaply re-pointed at the
+                    # HDU's new offset
+                    return False
+                clean.append([hdu, old_start, old_end, delta])
+                deltas.append(delta)
+                pos += old_end - old_start
+            else:
+                if not (hdu._new or hdu._data_loaded):
+                    # Writing this HDU would copy its data out of a region
+                    # of the file this method may already have overwritten
+                    return False
+                if (hdu._data_loaded and hdu.data is not None and
+                        _get_array_mmap(hdu.data) is not None):
+                    return False
+                nbytes = hdu.size
+                dirty.append((hdu, pos))
+                pos += len(str(hdu._header)) + nbytes + _pad_length(nbytes)
+
+        # The clean HDUs must fall into an unmoved prefix followed by a tail
+        # that all shifts by the same amount; anything else would require
+        # multiple block moves
+        shift_delta = 0
+        for delta in deltas:
+            if shift_delta:
+                if delta != shift_delta:
+                    return False
+            elif delta != 0:
+                shift_delta = delta
+
+        # If the file is growing, record the new size up front so that the
+        # writes below that seek past the old EOF are not mistaken for reads
+        # of a truncated file
+        if pos > ffo.size:
+            ffo.size = pos
+
+        if shift_delta:
+            moved = [item for item in clean if item[3]]
+            src_lo = moved[0][1]
+            src_hi = moved[-1][2]
+            self._shift_file_block(src_lo, src_lo + shift_delta,
+                                   src_hi - src_lo)
+            for hdu, old_start, old_end, delta in moved:
+                hdu._header_offset += delta
+                hdu._data_offset += delta
+
+        for hdu, offset in dirty:
+            ffo.seek(offset)
+            was_new = hdu._new
+            # _writeto only records the new offsets on new HDUs
+            hdu._new = True
+            try:
+                hdu._writeto(ffo)
+            finally:
+                hdu._new = was_new
+
+        # Shrink the file if the new layout is shorter than the old one, and
+        # record the new size on the _File so that seeks past the old EOF of
+        # a grown file are not mistaken for truncation
+        ffo.seek(0, 2)
+        if pos < ffo.tell():
+            try:
+                ffo.truncate(pos)
+            except IOError:
+                return False
+        ffo.size = pos
+
+        # Flush any in-place header or data modifications of the clean HDUs,
+        # as in the non-resized branch of _flush_update
+        for hdu, old_start, old_end, delta in clean:
+            if hdu._header._modified or hdu._data_loaded:
+                hdu._writeto(ffo, inplace=True)
+
+        self._resize = False
+        self._truncate = False
+        for hdu in self:
+            hdu._header._modified = False
+            hdu._new = False
+            hdu._file = ffo
+
+        return True
+
+    def _shift_file_block(self, src, dst, nbytes):
+        """
+        Move a block of ``nbytes`` bytes within the open file from offset
+        ``src`` to offset ``dst`` in large chunks, handling overlapping
+        source and destination ranges like ``memmove``.
+        """
+
+        ffo = self.__file
+        chunk = self._SHIFT_BLOCK_BYTES
+
+        if dst < src:
+            # Copy front to back so an overlapping source is read before it
+            # is overwritten
+            moved = 0
+            while moved < nbytes:
+                count = min(chunk, nbytes - moved)
+                ffo.seek(src + moved)
+                data = ffo.read(count)
+                ffo.seek(dst + moved)
+                ffo.write(data)
+                moved += count
+        elif dst > src:
+            # Copy back to front for the same reason
+            remaining = nbytes
+            while remaining > 0:
+                count = min(chunk, remaining)
+                ffo.seek(src + remaining - count)
+                data = ffo.read(count)
+                ffo.seek(dst + remaining - count)
+                ffo.write(data)
+                remaining -= count
+        ffo.flush()
+
     def _flush_resize(self):
         """
         Implements flushing changes in update mode when parts of one or more HDU
@@ -1033,8 +1401,11 @@ class HDUList(list, _Verify):
             # determine if any of the HDU is resized
             for hdu in self:
                 # Header:
+                # A header that shrank within its original allocation does not
+                # force a resize; when flushed it is padded back out to its
+                # original size with blank cards (see _BaseHDU._writeto)
                 nbytes = len(str(hdu._header))
-                if nbytes != (hdu._data_offset - hdu._header_offset):
+                if nbytes > (hdu._data_offset - hdu._header_offset):
                     self._resize = True
                     self._truncate = False
                     if verbose:
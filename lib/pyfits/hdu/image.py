@@ -1,15 +1,25 @@
+import itertools
 import sys
+
 import numpy as np
 
 from ..extern.six import string_types
 from ..extern.six.moves import range
 
+from ..file import MADVISE_MODES
 from ..header import Header
-from ..util import (_is_pseudo_unsigned, _unsigned_zero, _is_int,
-                    _normalize_slice, lazyproperty)
+from ..util import (_is_pseudo_unsigned, _pseudo_unsigned_values,
+                    _unsigned_zero, _is_int, _normalize_slice, lazyproperty)
 from .base import DELAYED, _ValidHDU, ExtensionHDU
 
 
+# Default number of elements per block for blockwise scaling and conversion
+# of image data (see _ImageBaseHDU.scale); small enough that the temporaries
+# stay a fraction of the array size, large enough that per-block overhead is
+# negligible
+DEFAULT_SCALE_BLOCKSIZE = 2 ** 22
+
+
 class _ImageBaseHDU(_ValidHDU):
     """FITS image HDU base class.
 
@@ -255,6 +265,153 @@ class _ImageBaseHDU(_ValidHDU):
         # setting self.__dict__['data']
         return data
 
+    def advise(self, mode):
+        """
+        Advise the operating system of the expected access pattern for this
+        HDU's data.
+
+        Parameters
+        ----------
+        mode : str
+            The expected access pattern; one of ``'normal'``,
+            ``'sequential'`` (full scans of the data in storage order),
+            ``'random'`` (scattered section/tile access), ``'willneed'``
+            (prefetch the data into the page cache ahead of use), or
+            ``'dontneed'`` (the data will not be needed again soon).
+
+        The advice is applied to this HDU's region of the underlying file
+        with `_File.advise`, and, if the data has already been loaded as a
+        mmapped array, to the memory mapping itself with ``madvise``.  It is
+        purely an optimization hint and is silently ignored on platforms
+        that cannot apply it; it never changes the result of accessing the
+        data.
+        """
+
+        if mode not in MADVISE_MODES:
+            raise ValueError(
+                'mode %r not one of %s' % (mode, sorted(MADVISE_MODES)))
+
+        if self._file is not None and self._data_offset is not None:
+            self._file.advise(mode, self._data_offset, self._data_size)
+
+        advice = MADVISE_MODES[mode]
+        if advice is None:
+            return
+
+        # If the data was loaded as a mmapped array, find the mmap object
+        # underlying the array (it may be several views down the base chain)
+        # and advise the mapping as well
+        base = self.__dict__.get('data')
+        while isinstance(base, np.ndarray):
+            if isinstance(base, np.memmap):
+                mm = getattr(base, '_mmap', None)
+                if mm is not None and hasattr(mm, 'madvise'):
+                    try:
+                        mm.madvise(advice)
+                    except (ValueError, OSError):
+                        # Only a hint; the mapping may be in a state (such
+                        # as empty) where the advice cannot be applied
+                        pass
+                break
+            base = base.base
+
+    def iter_chunks(self, shape=None, overlap=None, readahead=True):
+        """
+        Iterate over the data in tiles without loading the full array.
+
+        Yields ``(slices, data)`` pairs in storage order, where ``slices``
+        is a tuple of slice objects giving the location of the tile in the
+        full array, and ``data`` is the tile's data with the same scaling
+        applied as for the `data` attribute.  Tiles are read through
+        `section`, so only one tile at a time is held in memory; this is
+        intended for streaming over images and cubes too large to load.
+
+        Parameters
+        ----------
+        shape : tuple of int, optional
+            The tile shape, in the same axis order as ``self.data.shape``.
+            If fewer entries than data axes are given the tile spans the
+            remaining axes completely.  The default is single elements of
+            the first axis--one image plane at a time for a cube.
+
+        overlap : int or tuple of int, optional
+            Extend each tile by this many elements on both sides along each
+            axis (clipped at the array edges), for algorithms that need
+            context around each tile.  Consecutive tiles then overlap; the
+            tile spacing itself is not affected.
+
+        readahead : bool, optional
+            If `True` (default), advise the operating system to read the
+            next tile's bytes into the page cache while the current tile is
+            being processed (only possible when tiles are contiguous in the
+            file, i.e. they span all but the first axis; see
+            `_File.advise`).
+        """
+
+        axes = self.shape
+        naxis = len(axes)
+        if naxis < 1:
+            return
+
+        if shape is None:
+            shape = (1,)
+        elif not isinstance(shape, tuple):
+            shape = (shape,)
+        if len(shape) > naxis:
+            raise ValueError('too many axes in tile shape %r' % (shape,))
+        shape = shape + axes[len(shape):]
+        if any(dim < 1 for dim in shape):
+            raise ValueError('tile dimensions must be positive: %r' %
+                             (shape,))
+
+        if overlap is None:
+            overlap = (0,) * naxis
+        elif not isinstance(overlap, tuple):
+            overlap = (overlap,) * naxis
+        if len(overlap) > naxis:
+            raise ValueError('too many axes in overlap %r' % (overlap,))
+        overlap = overlap + (0,) * (naxis - len(overlap))
+        if any(pad < 0 for pad in overlap):
+            raise ValueError('overlap must be non-negative: %r' % (overlap,))
+
+        # Tiles that span all but the first axis occupy a contiguous range of
+        # the file, which makes readahead of the next tile expressible
+        contiguous = shape[1:] == axes[1:] or naxis == 1
+        rowsize = abs(self._orig_bitpix) // 8
+        for axis in axes[1:]:
+            rowsize *= axis
+
+        def tile_slices(start):
+            return tuple(
+                slice(max(0, pos - pad), min(axis, pos + dim + pad))
+                for pos, dim, pad, axis in zip(start, shape, overlap, axes))
+
+        def advise_tile(start):
+            if (not readahead or not contiguous or self._file is None or
+                    self._data_offset is None):
+                return
+            first = tile_slices(start)[0]
+            self._file.advise('willneed',
+                              self._data_offset + first.start * rowsize,
+                              (first.stop - first.start) * rowsize)
+
+        starts = itertools.product(
+            *[range(0, axis, dim) for axis, dim in zip(axes, shape)])
+
+        prev = None
+        for start in starts:
+            if prev is not None:
+                # Hint the next tile into the page cache before handing the
+                # current one to the caller
+                advise_tile(start)
+                slices = tile_slices(prev)
+                yield slices, self.section[slices]
+            prev = start
+
+        if prev is not None:
+            slices = tile_slices(prev)
+            yield slices, self.section[slices]
+
     def update_header(self):
         """
         Update the header keywords to agree with the data.
@@ -351,7 +508,8 @@ class _ImageBaseHDU(_ValidHDU):
             self._bscale = 1
             self._bitpix = self._header['BITPIX']
 
-    def scale(self, type=None, option='old', bscale=1, bzero=0):
+    def scale(self, type=None, option='old', bscale=1, bzero=0,
+              blocksize=None):
         """
         Scale image data by using ``BSCALE``/``BZERO``.
 
@@ -376,6 +534,12 @@ class _ImageBaseHDU(_ValidHDU):
 
         bscale, bzero : int, optional
             User-specified ``BSCALE`` and ``BZERO`` values
+
+        blocksize : int, optional
+            Number of elements converted at a time when the data has to be
+            converted to a new type; the default keeps the conversion
+            temporaries to a small fraction of the array size, which matters
+            when scaling arrays close to the size of available memory
         """
 
         if self.data is None:
@@ -435,7 +599,23 @@ class _ImageBaseHDU(_ValidHDU):
                 pass
 
         if self.data.dtype.type != _type:
-            self.data = np.array(np.around(self.data), dtype=_type)
+            if blocksize is None:
+                blocksize = DEFAULT_SCALE_BLOCKSIZE
+            old_data = self.data
+            if old_data.flags['C_CONTIGUOUS']:
+                # Round and convert block by block; np.around over the whole
+                # array would create a full-size temporary on top of the
+                # destination array, which is what used to push large cubes
+                # out of memory
+                new_data = np.empty(old_data.shape, dtype=_type)
+                flat_in = old_data.reshape(-1)
+                flat_out = new_data.reshape(-1)
+                for start in range(0, flat_in.size, blocksize):
+                    stop = min(start + blocksize, flat_in.size)
+                    flat_out[start:stop] = np.around(flat_in[start:stop])
+                self.data = new_data
+            else:
+                self.data = np.array(np.around(old_data), dtype=_type)
 
         # Update the BITPIX Card to match the data
         self._bitpix = _ImageBaseHDU.ImgCode[self.data.dtype.name]
@@ -478,27 +658,36 @@ class _ImageBaseHDU(_ValidHDU):
                 swap_types = ('<',)
             # deal with unsigned integer 16, 32 and 64 data
             if _is_pseudo_unsigned(self.data.dtype):
-                # Convert the unsigned array to signed
-                output = np.array(
-                    self.data - _unsigned_zero(self.data.dtype),
-                    dtype='>i%d' % self.data.dtype.itemsize)
-                should_swap = False
+                # Convert the unsigned array to its signed storage values and
+                # write it out block by block, instead of materializing a
+                # converted copy of the whole array
+                dtype = '>i%d' % self.data.dtype.itemsize
+                zero = _unsigned_zero(self.data.dtype)
+                if not fileobj.simulateonly:
+                    flat = self.data.ravel()
+                    for start in range(0, flat.size,
+                                       DEFAULT_SCALE_BLOCKSIZE):
+                        block = flat[start:start + DEFAULT_SCALE_BLOCKSIZE]
+                        fileobj.writearray(np.array(block - zero,
+                                                    dtype=dtype))
+
+                size += self.data.size * self.data.itemsize
             else:
                 output = self.data
                 byteorder = output.dtype.str[0]
                 should_swap = (byteorder in swap_types)
 
-            if not fileobj.simulateonly:
-                if should_swap:
-                    output.byteswap(True)
-                    try:
-                        fileobj.writearray(output)
-                    finally:
+                if not fileobj.simulateonly:
+                    if should_swap:
                         output.byteswap(True)
-                else:
-                    fileobj.writearray(output)
+                        try:
+                            fileobj.writearray(output)
+                        finally:
+                            output.byteswap(True)
+                    else:
+                        fileobj.writearray(output)
 
-            size += output.size * output.itemsize
+                size += output.size * output.itemsize
 
         return size
 
@@ -537,15 +726,11 @@ class _ImageBaseHDU(_ValidHDU):
         # bool(dtype) is always False--have to explicitly compare to None; this
         # caused a fair amount of hair loss
         if dtype is not None and dtype.kind == 'u':
-            # Convert the input raw data into an unsigned integer array and
-            # then scale the data adjusting for the value of BZERO.  Note that
-            # we subtract the value of BZERO instead of adding because of the
-            # way numpy converts the raw signed array into an unsigned array.
-            bits = dtype.itemsize * 8
-            data = np.array(data, dtype=dtype)
-            data -= np.uint64(1 << (bits - 1))
-
-            return data
+            # Flip the sign bit of the raw data in place rather than casting
+            # to a signed intermediate and subtracting BZERO, so that reading
+            # uint data allocates at most one full-size buffer (and none at
+            # all when the raw array was freshly read from the file)
+            return _pseudo_unsigned_values(data, dtype)
 
     def _get_scaled_image_data(self, offset, shape):
         """
@@ -559,6 +744,15 @@ class _ImageBaseHDU(_ValidHDU):
         raw_data = self._get_raw_data(shape, code, offset)
         raw_data.dtype = raw_data.dtype.newbyteorder('>')
 
+        return self._scale_raw_data(raw_data)
+
+    def _scale_raw_data(self, raw_data):
+        """
+        Apply the BSCALE/BZERO/BLANK conversions from the header to raw data
+        already read from the file, returning the converted array (or the
+        input array itself if no conversion is necessary).
+        """
+
         if (self._orig_bzero == 0 and self._orig_bscale == 1 and
                 self._blank is None):
             # No further conversion of the data is necessary
@@ -632,12 +826,24 @@ class _ImageBaseHDU(_ValidHDU):
 
         return (self.name, class_name, len(self._header), shape, format, '')
 
+    def _datasum_raw_bytes(self):
+        # Pseudo-unsigned and byte-swapped data are not laid out in memory
+        # as they are in the file, so incremental datasums do not apply
+        if (_is_pseudo_unsigned(self.data.dtype) or
+                self.data.dtype.str[0] != '>'):
+            return None
+        return self.data.ravel().view(np.uint8)
+
     def _calculate_datasum(self, blocking):
         """
         Calculate the value for the ``DATASUM`` card in the HDU.
         """
 
         if self._has_data:
+            datasum = self._incremental_datasum(blocking)
+            if datasum is not None:
+                return datasum
+
             # We have the data to be used.
             d = self.data
 
@@ -746,56 +952,104 @@ class Section(object):
 
         return data
 
-    def _getdata(self, keys):
-        out = []
+    # How much file data a single gather read may span, and how large a gap
+    # between two needed extents may be coalesced into one read; see _getdata
+    _MAX_GATHER_BYTES = 4 * 1024 * 1024
 
-        # Determine the number of slices in the set of input keys.
-        # If there is only one slice then the result is a one dimensional
-        # array, otherwise the result will be a multidimensional array.
-        n_slices = 0
-        for idx, key in enumerate(keys):
-            if isinstance(key, slice):
-                n_slices = n_slices + 1
+    def _getdata(self, keys):
+        # A non-contiguous section: determine every contiguous extent of the
+        # file that contributes to the section up front, then service them
+        # with a few large coalesced reads and pick the needed bytes out in
+        # memory, rather than issuing one tiny read per line
+        shape = self.hdu.shape
+        naxis = len(shape)
 
+        dims = []
+        specs = []
         for idx, key in enumerate(keys):
+            axis = shape[idx]
             if isinstance(key, slice):
-                # OK, this element is a slice so see if we can get the data for
-                # each element of the slice.
-                axis = self.hdu.shape[idx]
                 ns = _normalize_slice(key, axis)
-
-                for k in range(ns.start, ns.stop):
-                    key1 = list(keys)
-                    key1[idx] = k
-                    key1 = tuple(key1)
-
-                    if n_slices > 1:
-                        # This is not the only slice in the list of keys so
-                        # we simply get the data for this section and append
-                        # it to the list that is output.  The out variable will
-                        # be a list of arrays.  When we are done we will pack
-                        # the list into a single multidimensional array.
-                        out.append(self[key1])
-                    else:
-                        # This is the only slice in the list of keys so if this
-                        # is the first element of the slice just set the output
-                        # to the array that is the data for the first slice.
-                        # If this is not the first element of the slice then
-                        # append the output for this slice element to the array
-                        # that is to be output.  The out variable is a single
-                        # dimensional array.
-                        if k == ns.start:
-                            out = self[key1]
-                        else:
-                            out = np.append(out, self[key1])
-
-                # We have the data so break out of the loop.
-                break
-
-        if isinstance(out, list):
-            out = np.array(out)
-
-        return out
+                npts = (ns.stop - ns.start + ns.step - 1) // ns.step
+                npts = max(0, npts)
+                dims.append(npts)
+                specs.append((ns.start, ns.stop, ns.step))
+            else:
+                if key < 0:
+                    key += axis
+                if not 0 <= key < axis:
+                    raise IndexError('index out of range')
+                # An integer key selects a single point and drops the axis
+                # from the result
+                specs.append((key, key + 1, 1))
+
+        # Element strides of each axis in the file
+        strides = [1] * naxis
+        for idx in range(naxis - 2, -1, -1):
+            strides[idx] = strides[idx + 1] * shape[idx + 1]
+
+        # Fold axes that are spanned completely, plus a final unit-step
+        # slice, into a single contiguous run of elements
+        runlen = 1
+        last = naxis - 1
+        while last >= 0 and specs[last] == (0, shape[last], 1):
+            runlen *= shape[last]
+            last -= 1
+        runbase = 0
+        if last >= 0 and specs[last][2] == 1:
+            start, stop, _ = specs[last]
+            runbase = start * strides[last]
+            runlen *= stop - start
+            last -= 1
+
+        code = _ImageBaseHDU.NumCode[self.hdu._orig_bitpix]
+        dtype = np.dtype(code).newbyteorder('>')
+        itemsize = dtype.itemsize
+
+        total = 1
+        for dim in dims:
+            total *= dim
+        output = np.empty((total,), dtype=dtype)
+
+        # Walking the remaining axes in row-major order yields the runs in
+        # file order, which is also the order they fill the output array
+        outer = [range(start, stop, step)
+                 for start, stop, step in specs[:last + 1]]
+        maxelem = max(runlen, self._MAX_GATHER_BYTES // itemsize)
+
+        pos = 0
+        win_start = win_stop = 0
+        win_runs = []
+
+        def read_window():
+            raw = self.hdu._get_raw_data((win_stop - win_start,), code,
+                                         self.hdu._data_offset +
+                                         win_start * itemsize)
+            raw.dtype = dtype
+            fill = pos
+            for off in win_runs:
+                output[fill:fill + runlen] = raw[off - win_start:
+                                                 off - win_start + runlen]
+                fill += runlen
+            return fill
+
+        for indices in itertools.product(*outer):
+            offset = runbase
+            for idx, stride in zip(indices, strides):
+                offset += idx * stride
+            if win_runs and offset + runlen - win_start > maxelem:
+                pos = read_window()
+                win_runs = []
+            if not win_runs:
+                win_start = offset
+            win_runs.append(offset)
+            win_stop = offset + runlen
+        if win_runs:
+            read_window()
+
+        output.shape = tuple(dims)
+
+        return self.hdu._scale_raw_data(output)
 
 
 class PrimaryHDU(_ImageBaseHDU):
@@ -23,17 +23,26 @@ class FitsHDU(NonstandardExtHDU):
 
     @lazyproperty
     def hdulist(self):
-        self._file.seek(self._data_offset)
-        fileobj = BytesIO()
-        # Read the data into a BytesIO--reading directly from the file
-        # won't work (at least for gzipped files) due to problems deep
-        # within the gzip module that make it difficult to read gzip files
-        # embedded in another file
-        fileobj.write(self._file.read(self.size))
-        fileobj.seek(0)
         if self._header['COMPRESS']:
+            # Read the compressed bytes (small next to the inflated file)
+            # into a BytesIO--reading directly from the file won't work due
+            # to problems deep within the gzip module that make it difficult
+            # to read gzip files embedded in another file.  The returned
+            # HDUList reads lazily through the GzipFile, so each embedded
+            # data unit is only inflated when it is actually accessed.
+            self._file.seek(self._data_offset)
+            fileobj = BytesIO()
+            fileobj.write(self._file.read(self.size))
+            fileobj.seek(0)
             fileobj = gzip.GzipFile(fileobj=fileobj)
-        return HDUList.fromfile(fileobj, mode='readonly')
+            return HDUList.fromfile(fileobj, mode='readonly')
+
+        # Stored uncompressed, so the embedded file can be parsed in place:
+        # the headers are read from the enclosing file's buffer and the
+        # embedded data units are views of it (zero-copy when the enclosing
+        # file is memory-mapped)
+        raw = self._get_raw_data(self.size, 'ubyte', self._data_offset)
+        return HDUList.fromstring(raw)
 
     @classmethod
     def fromfile(cls, filename, compress=False):
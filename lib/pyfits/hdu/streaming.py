@@ -1,5 +1,12 @@
 import gzip
 import os
+import sys
+import threading
+
+import numpy as np
+
+from ..extern.six import reraise
+from ..extern.six.moves import queue
 
 from ..file import _File
 from ..util import _pad_length, fileobj_name
@@ -28,7 +35,7 @@ class StreamingHDU(object):
         shdu.close()
     """
 
-    def __init__(self, name, header):
+    def __init__(self, name, header, async_writes=False, nbuffers=2):
         """
         Construct a `StreamingHDU` object given a file name and a header.
 
@@ -43,6 +50,21 @@ class StreamingHDU(object):
             The header object associated with the data to be written
             to the file.
 
+        async_writes : bool, optional
+            If `True`, `write` stages a copy of each chunk in an internal
+            buffer and returns immediately while a background thread drains
+            the buffers to the file in order, overlapping the caller's
+            computation with the disk I/O.  `write` only blocks when all the
+            staging buffers are full, and `close` blocks until everything
+            staged has been written out.  Note that in this mode data is only
+            guaranteed to be on disk after `close` returns.
+
+        nbuffers : int, optional
+            The maximum number of chunks that may be staged at once when
+            ``async_writes`` is `True` (default 2, for simple double
+            buffering); each buffer is the size of the chunk passed to
+            `write`.
+
         Notes
         -----
         The file will be opened and the header appended to the end of
@@ -126,6 +148,17 @@ class StreamingHDU(object):
         else:
             self.writecomplete = True
 
+        self._writer = None
+        if async_writes:
+            if nbuffers < 1:
+                raise ValueError('nbuffers must be at least 1.')
+            self._staged = queue.Queue(nbuffers)
+            self._staged_bytes = 0
+            self._write_exc = None
+            self._writer = threading.Thread(target=self._drain_buffers)
+            self._writer.setDaemon(True)
+            self._writer.start()
+
     # Support the 'with' statement
     def __enter__(self):
         return self
@@ -160,9 +193,22 @@ class StreamingHDU(object):
         raise an `IOError` exception.  If the dtype of the input data does not
         match what is expected by the header, a `TypeError` exception is
         raised.
+
+        When the HDU was created with ``async_writes=True``, this stages a
+        copy of the data and returns without waiting for it to reach the
+        file (unless all the staging buffers are in use); any error raised
+        by the background writer is re-raised by a subsequent `write` or by
+        `close`.
         """
 
-        size = self._ffo.tell() - self._data_offset
+        if self._writer is not None:
+            if self._write_exc is not None:
+                exc = self._write_exc
+                self._write_exc = None
+                reraise(*exc)
+            size = self._staged_bytes
+        else:
+            size = self._ffo.tell() - self._data_offset
 
         if self.writecomplete or size + data.nbytes > self._size:
             raise IOError('Attempt to write more data to the stream than the '
@@ -180,6 +226,19 @@ class StreamingHDU(object):
         else:
             output = data
 
+        if self._writer is not None:
+            if output is data:
+                # Stage a copy so that the caller is free to immediately
+                # reuse or modify its own array; the byteswapped case is
+                # already a copy
+                output = data.copy()
+            self._staged_bytes += output.nbytes
+            if self._staged_bytes == self._size:
+                self.writecomplete = True
+            # This blocks if all the staging buffers are currently in use
+            self._staged.put(output)
+            return self.writecomplete
+
         self._ffo.writearray(output)
 
         if self._ffo.tell() - self._data_offset == self._size:
@@ -193,6 +252,32 @@ class StreamingHDU(object):
 
         return self.writecomplete
 
+    def _drain_buffers(self):
+        """
+        Drains staged chunks to the file in order; this runs in a background
+        thread when the HDU was created with ``async_writes=True``.
+        """
+
+        try:
+            while True:
+                chunk = self._staged.get()
+                if chunk is None:
+                    break
+                self._ffo.writearray(chunk)
+                if self._ffo.tell() - self._data_offset == self._size:
+#
+#                   the stream is full so pad the data to the next FITS block
+#
+                    self._ffo.write(_pad_length(self._size) * '\0')
+                self._ffo.flush()
+        except Exception:
+            self._write_exc = sys.exc_info()
+            # Keep consuming (and discarding) staged chunks so that a
+            # producer blocked on a full queue does not deadlock; the
+            # exception is re-raised by write() or close()
+            while self._staged.get() is not None:
+                pass
+
     @property
     def size(self):
         """
@@ -223,7 +308,177 @@ class StreamingHDU(object):
 
     def close(self):
         """
-        Close the physical FITS file.
+        Close the physical FITS file; if asynchronous writes are enabled this
+        first waits for all staged data to be written out.
+        """
+
+        try:
+            if self._writer is not None:
+                self._staged.put(None)
+                self._writer.join()
+                self._writer = None
+                if self._write_exc is not None:
+                    exc = self._write_exc
+                    self._write_exc = None
+                    reraise(*exc)
+        finally:
+            self._ffo.close()
+
+
+class CompImageStreamingHDU(object):
+    """
+    A class that provides the capability to stream data to a tile-compressed
+    image HDU, compressing and writing tile-aligned batches of image rows as
+    they are produced instead of requiring the whole image in memory.
+
+    The following pseudocode illustrates its use::
+
+        header = pyfits.Header()
+
+        for all the cards you need in the header:
+            header[key] = (value, comment)
+
+        shdu = pyfits.CompImageStreamingHDU('filename.fits', header,
+                                            compression_type='RICE_1')
+
+        for each batch of image rows:
+            shdu.write(data)
+
+        shdu.close()
+
+    The header must fully describe the image (``BITPIX`` and ``NAXISn``), and
+    each batch passed to `write` must contain a whole number of tile rows;
+    with the default tiling (one image row per tile) any number of whole
+    image rows works.  Because each tile is compressed exactly once, peak
+    memory use is one batch plus its compressed form.
+    """
+
+    def __init__(self, name, header, **compression_options):
+        """
+        Construct a `CompImageStreamingHDU` object given a file name, a
+        header describing the *uncompressed* image, and optionally any of
+        the compression options accepted by `CompImageHDU` (such as
+        ``compression_type``, ``tile_size``, or ``quantize_level``).
+        """
+
+        if isinstance(name, gzip.GzipFile):
+            raise TypeError('CompImageStreamingHDU not supported for '
+                            'GzipFile objects.')
+
+        from .compressed import CompImageHDU
+
+        # Setting up a data-less CompImageHDU from the image header computes
+        # the full compressed table layout (column formats, tile geometry,
+        # table dims); only the final heap size remains unknown until close
+        self._hdu = CompImageHDU(header=header.copy(), **compression_options)
+
+        thdr = self._hdu._header
+        self._rowlen = thdr['NAXIS1']
+        self._nrows = thdr['NAXIS2']
+        self._theap = self._rowlen * self._nrows
+
+        zndim = thdr['ZNAXIS']
+        znaxis = [thdr['ZNAXIS%d' % (idx + 1)] for idx in range(zndim)]
+        ztile = [thdr['ZTILE%d' % (idx + 1)] for idx in range(zndim)]
+
+        # Pixels in one "tile row": the full extent of all the faster axes
+        # by one tile length of the slowest axis
+        self._slabpix = ztile[-1]
+        for axis in znaxis[:-1]:
+            self._slabpix *= axis
+        self._totalpix = 1
+        for axis in znaxis:
+            self._totalpix *= axis
+
+        self._nextpix = 0
+        self._heapsize = 0
+
+        filename = fileobj_name(name) or ''
+        newfile = False
+
+        if filename:
+            if not os.path.exists(filename) or os.path.getsize(filename) == 0:
+                newfile = True
+        elif (hasattr(name, 'len') and name.len == 0):
+            newfile = True
+
+        if newfile:
+            # A compressed image HDU is always an extension, so a new file
+            # needs a primary HDU in front of it
+            hdulist = HDUList([PrimaryHDU()])
+            hdulist.writeto(name, 'exception')
+
+        self._ffo = _File(name, 'append')
+
+        tmp_hdu = _BaseHDU()
+        tmp_hdu._header = thdr
+        self._header_offset = tmp_hdu._writeheader(self._ffo)[0]
+        self._data_offset = self._ffo.tell()
+
+        self.writecomplete = self._totalpix == 0
+
+    # Support the 'with' statement
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def write(self, data):
+        """
+        Compress the given batch of image data and append it to the stream.
+
+        The batch must be a whole number of tile rows and batches must be
+        supplied in order; returns `True` once the complete image has been
+        written.
+        """
+
+        from .. import compression
+
+        if self.writecomplete:
+            raise IOError('Attempt to write more data to the stream than '
+                          'the header specified.')
+
+        if _ImageBaseHDU.NumCode[self._hdu._header['ZBITPIX']] != \
+                data.dtype.name:
+            raise TypeError('Supplied data does not match the type specified '
+                            'in the header.')
+
+        if self._nextpix + data.size > self._totalpix:
+            raise IOError('Attempt to write more data to the stream than '
+                          'the header specified.')
+
+        if not data.dtype.isnative:
+            data = data.astype(data.dtype.newbyteorder('='))
+        data = np.ascontiguousarray(data)
+
+        firstrow, rowdata, heapdata = compression.compress_image_section(
+            self._hdu, data, self._nextpix + 1, self._heapsize)
+
+        self._ffo.seek(self._data_offset + firstrow * self._rowlen)
+        self._ffo.writearray(rowdata)
+        self._ffo.seek(self._data_offset + self._theap + self._heapsize)
+        self._ffo.writearray(heapdata)
+
+        self._nextpix += data.size
+        self._heapsize += heapdata.size
+
+        if self._nextpix == self._totalpix:
+            self._ffo.write(_pad_length(self._theap + self._heapsize) * '\0')
+            self.writecomplete = True
+
+        self._ffo.flush()
+
+        return self.writecomplete
+
+    def close(self):
+        """
+        Update the table header with the final heap size and close the
+        physical FITS file.
         """
 
-        self._ffo.close()
+        if not self._ffo.closed:
+            self._hdu._header['PCOUNT'] = self._heapsize
+            self._ffo.seek(self._header_offset)
+            self._ffo.write(self._hdu._header.tostring())
+            self._ffo.close()
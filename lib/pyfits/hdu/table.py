@@ -10,6 +10,8 @@ import warnings
 import numpy as np
 from numpy import char as chararray
 
+import pyfits
+
 from ..extern.six import string_types
 
 # This module may have many dependencies on pyfits.column, but pyfits.column
@@ -24,6 +26,11 @@ from ..header import Header
 from ..util import lazyproperty, _is_int, _str_to_num, _pad_length, deprecated
 from .base import DELAYED, _ValidHDU, ExtensionHDU
 
+try:
+    from pyfits import compression
+except ImportError:
+    compression = None
+
 
 class FITSTableDumpDialect(csv.excel):
     """
@@ -37,6 +44,12 @@ class FITSTableDumpDialect(csv.excel):
     skipinitialspace = True
 
 
+# Number of table rows formatted or parsed at a time by BinTableHDU.dump and
+# BinTableHDU.load; bounds the size of the intermediate text arrays so that
+# arbitrarily large tables can be processed in constant additional memory
+_DUMP_CHUNK_ROWS = 10000
+
+
 class _TableLikeHDU(_ValidHDU):
     """
     A class for HDUs that have table-like data.  This is used for both
@@ -147,7 +160,7 @@ class _TableLikeHDU(_ValidHDU):
                                           self._data_offset)
             data = raw_data.view(np.rec.recarray)
 
-        self._init_tbdata(data)
+        data = self._init_tbdata(data)
         return data.view(self._data_type)
 
     def _init_tbdata(self, data):
@@ -155,6 +168,15 @@ class _TableLikeHDU(_ValidHDU):
 
         data.dtype = data.dtype.newbyteorder('>')
 
+        if self._load_native_byteorder():
+            # Swap the whole table to native byte order once up front, so
+            # that later column access never pays foreign-endian penalties;
+            # this makes an in-memory copy detached from any mmap of the
+            # file, and the write paths swap back to big-endian as needed
+            # (see _binary_table_byte_swap)
+            data = data.byteswap().view(np.rec.recarray)
+            data.dtype = data.dtype.newbyteorder('=')
+
         # hack to enable pseudo-uint support
         data._uint = self._uint
 
@@ -176,6 +198,17 @@ class _TableLikeHDU(_ValidHDU):
         # new data placed in the column object above
         del columns._arrays
 
+        return data
+
+    def _load_native_byteorder(self):
+        """
+        Whether the table data should be byteswapped to native byte order
+        when it is loaded (see `BinTableHDU` for the supported case); by
+        default the raw big-endian layout from the file is kept.
+        """
+
+        return False
+
 
 class _TableBaseHDU(ExtensionHDU, _TableLikeHDU):
     """
@@ -603,7 +636,7 @@ class TableHDU(_TableBaseHDU):
 
         raw_data = self._get_raw_data(columns._shape, dtype, self._data_offset)
         data = raw_data.view(np.rec.recarray)
-        self._init_tbdata(data)
+        data = self._init_tbdata(data)
         return data.view(self._data_type)
 
     def _calculate_datasum(self, blocking):
@@ -651,6 +684,9 @@ class BinTableHDU(_TableBaseHDU):
     _extension = 'BINTABLE'
     _ext_comment = 'binary table extension'
 
+    # Number of bytes of raw rows to process per block when reading a subset
+    # of the table with read()
+    _READ_BLOCK_BYTES = 4 * 1024 * 1024
 
     @classmethod
     def match_header(cls, header):
@@ -661,6 +697,365 @@ class BinTableHDU(_TableBaseHDU):
         return (card.keyword == 'XTENSION' and
                 xtension in (cls._extension, 'A3DTABLE'))
 
+    def read(self, rows=None, columns=None):
+        """
+        Read a subset of the table's rows and/or columns without loading the
+        full table into memory.
+
+        Parameters
+        ----------
+        rows : slice or array, optional
+            A slice selecting the rows to read, an array of row indices, or
+            a boolean mask with one element per row; all rows by default.
+            Indexed rows are read in the order given, with runs of
+            consecutive indices coalesced into single reads.
+
+        columns : list, optional
+            A list of column names or indices selecting the columns to read,
+            in the requested order; all columns by default.
+
+        Returns
+        -------
+        data : FITS_rec
+            A new record array holding only the requested rows and columns.
+            As with any table data, columns are converted to their physical
+            values only when accessed.
+
+        Notes
+        -----
+        The byte extents of the selected columns and rows are computed from
+        the column definitions, and only those rows are read from the file,
+        a bounded-size block at a time, so a few columns of a very large
+        table can be extracted without the memory cost of the full table.
+        Variable-length array columns cannot be selected this way since
+        their data lives on the heap; use ``.data`` for those.
+
+        The values come from the underlying file (or buffer), so in-memory
+        modifications made through ``.data`` that have not been flushed are
+        not reflected in the result.
+        """
+
+        coldefs = self.columns
+        nrows = self._header.get('NAXIS2', 0)
+
+        if rows is None:
+            rows = slice(None)
+        if isinstance(rows, slice):
+            rowidx = None
+            start, stop, step = rows.indices(nrows)
+            if step > 0:
+                nout = max(0, (stop - start + step - 1) // step)
+            else:
+                nout = max(0, (stop - start + step + 1) // step)
+        else:
+            rowidx = np.asarray(rows)
+            if rowidx.dtype.kind == 'b':
+                if len(rowidx) != nrows:
+                    raise ValueError(
+                        'boolean row mask has %d elements; the table has %d '
+                        'rows' % (len(rowidx), nrows))
+                rowidx = np.flatnonzero(rowidx)
+            elif rowidx.dtype.kind in 'iu':
+                rowidx = rowidx.astype(np.int64)
+                rowidx = np.where(rowidx < 0, rowidx + nrows, rowidx)
+                if len(rowidx) and (rowidx.min() < 0 or
+                                    rowidx.max() >= nrows):
+                    raise IndexError('row index out of range for table with '
+                                     '%d rows' % nrows)
+            else:
+                raise TypeError('rows must be a slice, an array of row '
+                                'indices, or a boolean mask')
+            nout = len(rowidx)
+
+        if columns is None:
+            indices = list(range(len(coldefs)))
+        else:
+            indices = [_get_index(coldefs.names, col) for col in columns]
+
+        for idx in indices:
+            if isinstance(coldefs._recformats[idx], _FormatP):
+                raise TypeError(
+                    'Variable-length array column %r cannot be read with '
+                    'read(); its data lives on the heap' %
+                    coldefs.names[idx])
+
+        # Independent copies of the selected column definitions
+        selected = ColDefs([coldefs[idx] for idx in indices])
+
+        # Positions of the selected columns' fields within a raw table row;
+        # phantom columns have no field in the row
+        rowdtype = coldefs.dtype
+        nonphantom = [idx for idx in range(len(coldefs))
+                      if not coldefs[idx]._phantom]
+        fieldmap = dict(zip(nonphantom, range(len(nonphantom))))
+        names = [rowdtype.names[fieldmap[idx]] for idx in indices
+                 if not coldefs[idx]._phantom]
+        fields = rowdtype.fields
+
+        # A dtype describing a whole raw row but exposing only the selected
+        # fields, and the packed dtype of an output row
+        rowview = np.dtype({'names': names,
+                            'formats': [fields[name][0] for name in names],
+                            'offsets': [fields[name][1] for name in names],
+                            'itemsize': rowdtype.itemsize})
+        packed = np.dtype([(name, fields[name][0]) for name in names])
+
+        out = np.empty(nout, dtype=packed)
+
+        rowsize = rowdtype.itemsize
+        blockrows = max(1, self._READ_BLOCK_BYTES // rowsize)
+
+        def read_rows(opos, ocount, rstart, read_step):
+            rcount = (ocount - 1) * read_step + 1
+            raw = self._get_raw_data((rcount * rowsize,), np.uint8,
+                                     self._data_offset + rstart * rowsize)
+            if raw is None:
+                raise IOError('The HDU has no associated file or buffer to '
+                              'read table data from.')
+            block = raw.view(rowview)[::read_step]
+            for name in names:
+                out[name][opos:opos + ocount] = block[name]
+
+        if rowidx is None:
+            # A negative step reads the same rows in ascending file order;
+            # the output is reversed at the end
+            if step < 0:
+                first_row = start + (nout - 1) * step
+                read_step = -step
+            else:
+                first_row = start
+                read_step = step
+
+            for opos in range(0, nout, blockrows):
+                ocount = min(blockrows, nout - opos)
+                read_rows(opos, ocount, first_row + opos * read_step,
+                          read_step)
+
+            if step < 0:
+                out = out[::-1].copy()
+        else:
+            # Coalesce the requested rows into maximal runs of consecutive
+            # indices; each run is read with bounded-size bulk reads
+            if nout:
+                breaks = np.nonzero(np.diff(rowidx) != 1)[0] + 1
+                run_starts = np.concatenate(([0], breaks))
+                run_ends = np.concatenate((breaks, [nout]))
+            else:
+                run_starts = run_ends = []
+
+            for ostart, oend in zip(run_starts, run_ends):
+                first_row = rowidx[ostart]
+                for opos in range(ostart, oend, blockrows):
+                    ocount = min(blockrows, oend - opos)
+                    read_rows(opos, ocount, first_row + (opos - ostart), 1)
+
+        data = out.view(np.rec.recarray)
+        data.dtype = data.dtype.newbyteorder('>')
+        data._uint = self._uint
+        data = data.view(self._data_type)
+        data._coldefs = selected
+        data.formats = selected.formats
+
+        # Make the selected Column objects reference the new arrays, the
+        # same way _init_tbdata does
+        fidx = 0
+        for idx in range(len(selected)):
+            if not selected[idx]._phantom:
+                selected[idx].array = np.recarray.field(data, fidx)
+                fidx += 1
+        del selected._arrays
+
+        return data
+
+    def where(self, expression):
+        """
+        Evaluate a row selection expression against the table in the file and
+        return only the matching rows.
+
+        Parameters
+        ----------
+        expression : str
+            A boolean expression in the CFITSIO row filtering syntax, for
+            example ``'FLUX > 0 && OBJECT == "M101"'``.  Column names, header
+            keyword values, and the usual arithmetic, comparison, and boolean
+            operators may be used; see the "Row Filtering Specification"
+            section of the CFITSIO manual for the full syntax.
+
+        Returns
+        -------
+        data : FITS_rec
+            The matching rows, as returned by `read`.
+
+        Notes
+        -----
+        The expression is evaluated by the CFITSIO expression engine directly
+        against the table in the file, and only the matching rows are then
+        read into memory, so a selection matching a small fraction of a large
+        table reads only that fraction of the data.
+
+        This requires the `pyfits.compression` module (which embeds CFITSIO)
+        to be available, and the HDU must come from an ordinary uncompressed
+        file on disk.  As with `read`, in-memory modifications made through
+        ``.data`` that have not been flushed to the file are not reflected in
+        the result.
+        """
+
+        if compression is None:
+            raise RuntimeError(
+                'The pyfits.compression module is not available; it provides '
+                'the CFITSIO expression engine required by where()')
+
+        if self._file is None or self._file.compression:
+            raise TypeError(
+                'where() requires the HDU to come from an ordinary '
+                'uncompressed file on disk')
+
+        filename = self._file.name
+        if not isinstance(filename, string_types) or \
+                not os.path.exists(filename):
+            raise TypeError(
+                'where() requires the HDU to come from an ordinary '
+                'uncompressed file on disk')
+
+        mask = compression.filter_rows(filename, self._header_offset,
+                                       expression)
+        return self.read(rows=mask)
+
+    def build_index(self, column):
+        """
+        Build a sorted index for a column, to be used by `lookup`.
+
+        The index is a copy of the column values in sorted order along with
+        the row number each value came from, so that later lookups can use a
+        binary search instead of scanning the whole column.  It is kept on
+        the HDU and reused by `lookup` until it is rebuilt; it is *not*
+        updated automatically if the table data is modified.
+
+        Parameters
+        ----------
+        column : str or int
+            The name or 0-based number of the column to index.
+        """
+
+        name = self.columns.names[_get_index(self.columns.names, column)]
+        field = self.data.field(name)
+        rownums = np.argsort(field, kind='mergesort').astype('i8')
+        values = np.ascontiguousarray(field[rownums])
+        if not hasattr(self, '_column_indexes'):
+            self._column_indexes = {}
+        self._column_indexes[name] = (values, rownums)
+
+    def lookup(self, column, value, upper=None):
+        """
+        Return the numbers of the rows whose value in the given column equals
+        ``value``, or falls in the range ``[value, upper]`` if ``upper`` is
+        given.
+
+        The first lookup on a column builds a sorted index with `build_index`
+        (a one-time O(n log n) cost); subsequent lookups on the same column
+        are binary searches on the cached index.
+
+        Parameters
+        ----------
+        column : str or int
+            The name or 0-based number of the column to search.
+
+        value : scalar
+            The value to search for, or the inclusive lower bound of the
+            range when ``upper`` is also given.
+
+        upper : scalar, optional
+            The inclusive upper bound of the range to search for.
+
+        Returns
+        -------
+        rows : ndarray
+            The matching row numbers in ascending order; this can be passed
+            directly to the ``rows`` argument of `read`.
+        """
+
+        name = self.columns.names[_get_index(self.columns.names, column)]
+        if name not in getattr(self, '_column_indexes', {}):
+            self.build_index(name)
+        values, rownums = self._column_indexes[name]
+        if upper is None:
+            upper = value
+        left = np.searchsorted(values, value, side='left')
+        right = np.searchsorted(values, upper, side='right')
+        return np.sort(rownums[left:right])
+
+    def index_extension(self, column):
+        """
+        Return the sorted index for a column packaged as a `BinTableHDU`, so
+        that it can be appended to the file and restored with `load_index`
+        after reopening, skipping the rebuild pass over the table.
+
+        The returned HDU has ``EXTNAME = 'PYFITS_INDEX'`` and two columns,
+        ``VALUE`` and ``ROWNUM``, along with ``IDXCOL`` and ``IDXROWS``
+        keywords recording the indexed column and the number of rows the
+        index was built against.
+
+        Parameters
+        ----------
+        column : str or int
+            The name or 0-based number of the indexed column; the index is
+            built first if it does not already exist.
+        """
+
+        name = self.columns.names[_get_index(self.columns.names, column)]
+        if name not in getattr(self, '_column_indexes', {}):
+            self.build_index(name)
+        values, rownums = self._column_indexes[name]
+        columns = [Column(name='VALUE',
+                          format=_convert_format(values.dtype, reverse=True),
+                          array=values),
+                   Column(name='ROWNUM', format='K', array=rownums)]
+        hdu = BinTableHDU.from_columns(columns, name='PYFITS_INDEX')
+        hdu._header['IDXCOL'] = (name, 'column the index was built for')
+        hdu._header['IDXROWS'] = (len(rownums),
+                                  'table rows when the index was built')
+        return hdu
+
+    def load_index(self, index_hdu):
+        """
+        Restore a sorted index previously saved with `index_extension`,
+        making it available to `lookup` without rebuilding it.
+
+        Parameters
+        ----------
+        index_hdu : BinTableHDU
+            An index extension created by `index_extension` for a column of
+            this table.
+
+        Raises
+        ------
+        ValueError
+            If the extension does not look like an index extension, names a
+            column this table does not have, or was built against a
+            different number of rows than the table currently has.
+        """
+
+        header = index_hdu._header
+        if 'IDXCOL' not in header or 'IDXROWS' not in header:
+            raise ValueError(
+                'The given HDU is missing the IDXCOL/IDXROWS keywords and '
+                'does not appear to be an index extension.')
+        name = header['IDXCOL']
+        if name not in self.columns.names:
+            raise ValueError(
+                'The index extension is for a column %r that this table '
+                'does not have.' % name)
+        if header['IDXROWS'] != len(self.data):
+            raise ValueError(
+                'The index extension was built against %d rows but the '
+                'table has %d; rebuild the index with build_index().' %
+                (header['IDXROWS'], len(self.data)))
+        values = np.ascontiguousarray(index_hdu.data.field('VALUE'))
+        rownums = index_hdu.data.field('ROWNUM').astype('i8')
+        if not hasattr(self, '_column_indexes'):
+            self._column_indexes = {}
+        self._column_indexes[name] = (values, rownums)
+
     def _calculate_datasum_with_heap(self, blocking):
         """
         Calculate the value for the ``DATASUM`` card given the input data
@@ -690,12 +1085,30 @@ class BinTableHDU(_TableBaseHDU):
             for arr in swapped:
                 arr.byteswap(True)
 
+    def _datasum_raw_bytes(self):
+        # Variable length columns keep their data on the heap, and fields
+        # not in big-endian order would have to be byteswapped first; both
+        # rule out summing the record array in place
+        if any(isinstance(rf, _FormatP)
+               for rf in self.data.columns._recformats):
+            return None
+        for name in self.data.dtype.names:
+            if self.data.dtype.fields[name][0].str[0] not in ('>', '|'):
+                return None
+        # View down to a plain ndarray so that block slices taken from this
+        # do not go through the FITS_rec slicing machinery
+        return np.asarray(self.data.view(dtype='ubyte')).ravel()
+
     def _calculate_datasum(self, blocking):
         """
         Calculate the value for the ``DATASUM`` card in the HDU.
         """
 
         if self._has_data:
+            datasum = self._incremental_datasum(blocking)
+            if datasum is not None:
+                return datasum
+
             # This method calculates the datasum while incorporating any
             # heap data, which is obviously not handled from the base
             # _calculate_datasum
@@ -752,6 +1165,24 @@ class BinTableHDU(_TableBaseHDU):
 
         return size
 
+    def _load_native_byteorder(self):
+        """
+        When the opt-in `pyfits.NATIVE_TABLE_BYTEORDER` flag is set, binary
+        table data is byteswapped to native byte order once at load time (as
+        an in-memory copy), so that all subsequent column operations run at
+        native numpy speed; the write paths swap back to big-endian as
+        needed.  Variable length array columns are excluded since their heap
+        data is located through the table's base array, which the in-memory
+        copy would no longer be attached to.
+        """
+
+        if not pyfits.NATIVE_TABLE_BYTEORDER or sys.byteorder != 'little':
+            # On a big-endian host the raw FITS byte order already is the
+            # native order
+            return False
+        return not any(type(r) in (_FormatP, _FormatQ)
+                       for r in self.columns._recformats)
+
     def _binary_table_byte_swap(self):
         """Prepares data in the native FITS format and writes the raw bytes
         out to the given file object.  This handles byte swapping from native
@@ -1032,6 +1463,54 @@ class BinTableHDU(_TableBaseHDU):
                 # output floating point
                 return '%#21.15g' % val
 
+        def format_column(vals, format):
+            # Vectorized equivalent of format_value for a whole chunk of a
+            # column at once; must produce exactly the same text as
+            # format_value does for the individual values
+            if format[0] == 'S':
+                itemsize = int(format[1:])
+                return np.char.ljust(vals, itemsize)
+            elif format in np.typecodes['AllInteger']:
+                return np.char.mod('%21d', vals)
+            elif format in np.typecodes['Complex']:
+                return np.char.add(np.char.mod('%21.15g+', vals.real),
+                                   np.char.mod('%.15gj', vals.imag))
+            elif format in np.typecodes['Float']:
+                return np.char.mod('%#21.15g', vals)
+
+        if not any(isinstance(column.format.recformat, _FormatP)
+                   for column in self.columns):
+            # Without variable length arrays every row has the same layout,
+            # so whole columns can be formatted at once; work through the
+            # table in bounded chunks of rows so the formatted text arrays
+            # stay small no matter how many rows the table has
+            fields = []
+            for column in self.columns:
+                dtype = self.data.dtype.fields[column.name][0]
+                array_format = dtype.char
+                if array_format == 'V':
+                    array_format = dtype.base.char
+                if array_format == 'S':
+                    array_format += str(dtype.itemsize)
+                fields.append((self.data.field(column.name), array_format))
+
+            for chunk_start in range(0, len(self.data), _DUMP_CHUNK_ROWS):
+                chunk = slice(chunk_start, chunk_start + _DUMP_CHUNK_ROWS)
+                formatted = []
+                for coldata, array_format in fields:
+                    vals = coldata[chunk]
+                    if vals.ndim > 1:
+                        # Array column; one output field per element
+                        vals = vals.reshape(len(vals), -1)
+                    else:
+                        vals = vals.reshape(len(vals), 1)
+                    formatted.append(format_column(vals, array_format))
+                linewriter.writerows(np.hstack(formatted))
+
+            if close_file:
+                fileobj.close()
+            return
+
         for row in self.data:
             line = []   # the line for this row of the table
 
@@ -1201,36 +1680,65 @@ class BinTableHDU(_TableBaseHDU):
             else:
                 return val
 
-        # Jump back to the start of the data and create a new line reader
-        fileobj.seek(initialpos)
-        linereader = csv.reader(fileobj, dialect=FITSTableDumpDialect)
-        for row, line in enumerate(linereader):
-            col = 0
+        def compute_layout(line):
+            # Every row of the dump has the same sequence of tokens (the
+            # lengths of variable length arrays are fixed per column), so
+            # the offset into a line and the number of tokens belonging to
+            # each column can be worked out once from the first line
+            layout = []
             idx = 0
-            while idx < len(line):
-                if line[idx] == 'VLA_Length=':
-                    vla_len = vla_lengths[col]
-                    idx += 2
-                    slice_ = slice(idx, idx + vla_len)
-                    data[row][col][:] = line[idx:idx + vla_len]
-                    idx += vla_len
+            for col in range(len(dtype)):
+                if idx < len(line) and line[idx] == 'VLA_Length=':
+                    vla_len = int(line[idx + 1])
+                    layout.append((idx + 2, vla_len, True))
+                    idx += 2 + vla_len
                 elif dtype[col].shape:
                     # This is an array column
                     array_size = int(np.multiply.reduce(dtype[col].shape))
-                    slice_ = slice(idx, idx + array_size)
+                    layout.append((idx, array_size, False))
                     idx += array_size
                 else:
-                    slice_ = None
-
-                if slice_ is None:
-                    # This is a scalar row element
-                    data[row][col] = format_value(col, line[idx])
+                    layout.append((idx, 1, False))
                     idx += 1
+            return layout
+
+        def fill_block(block, row_start):
+            # Assign a block of parsed rows into the preallocated array one
+            # column at a time, so that each assignment converts many values
+            # in a single vectorized operation
+            row_end = row_start + len(block)
+            for col, (offset, ntokens, is_vla) in enumerate(layout):
+                field = data.field(col)
+                if is_vla:
+                    for row, line in enumerate(block):
+                        field[row_start + row][:] = line[offset:
+                                                         offset + ntokens]
+                elif ntokens > 1:
+                    field[row_start:row_end].flat[:] = \
+                        [format_value(col, val) for line in block
+                         for val in line[offset:offset + ntokens]]
                 else:
-                    data[row][col].flat[:] = [format_value(col, val)
-                                              for val in line[slice_]]
+                    field[row_start:row_end] = \
+                        [format_value(col, line[offset]) for line in block]
 
-                col += 1
+        # Jump back to the start of the data and create a new line reader;
+        # this time read the rows in bounded blocks rather than one at a time
+        fileobj.seek(initialpos)
+        linereader = csv.reader(fileobj, dialect=FITSTableDumpDialect)
+        layout = None
+        row_start = 0
+        block = []
+        for line in linereader:
+            if layout is None:
+                layout = compute_layout(line)
+            block.append(line)
+            if len(block) == _DUMP_CHUNK_ROWS:
+                fill_block(block, row_start)
+                row_start += len(block)
+                block = []
+
+        if block:
+            fill_block(block, row_start)
 
         if close_file:
             fileobj.close()
@@ -12,12 +12,20 @@ from collections import defaultdict
 from .extern.six import PY3, string_types, itervalues, iteritems, next
 from .extern.six.moves import zip, range, zip_longest
 
+from . import perf
 from .card import Card, CardList, KEYWORD_LENGTH, _pad
 from .file import _File
 from .util import (BLOCK_SIZE, deprecated, isiterable, encode_ascii,
                    decode_ascii, fileobj_is_binary, fileobj_closed,
                    _pad_length, PyfitsDeprecationWarning)
 
+try:
+    from . import _cardparse
+except ImportError:
+    # The C card parser is an optional accelerator; everything works (more
+    # slowly) without it
+    _cardparse = None
+
 
 # This regular expression can match a *valid* END card which just consists of
 # the the string 'END' followed by all spaces, or an *invalid* end card which
@@ -348,6 +356,40 @@ class Header(object):
 
         cards = []
 
+        if not sep and _cardparse is not None:
+            # The C parser handles the common case of raw header data with no
+            # card separator; it splits the data into card images in a single
+            # pass and determines the keywords of unambiguously standard cards
+            # so that they need not be parsed again in Python
+            parsed = _cardparse.parse_header(data)
+            if parsed is not None:
+                # Build the header's card list and keyword index directly;
+                # this is equivalent to appending each card with end=True but
+                # avoids the per-card bookkeeping in Header.append, and the
+                # cards whose keywords were determined by the C parser are
+                # never parsed at all unless their values are later accessed
+                header = cls()
+                header_cards = header._cards
+                keyword_indices = header._keyword_indices
+                rvkc_indices = header._rvkc_indices
+                for start, end, keyword in parsed:
+                    card = Card.fromstring(data[start:end])
+                    idx = len(header_cards)
+                    header_cards.append(card)
+                    if keyword is not None:
+                        card._keyword = keyword
+                    else:
+                        # An unusual card; parsing its keyword may also
+                        # identify it as a record-valued keyword card
+                        keyword = Card.normalize_keyword(card.keyword)
+                        if card.field_specifier is not None:
+                            rvkc_indices[card.rawkeyword].append(idx)
+                    keyword_indices[keyword].append(idx)
+                header._modified = False
+                if perf.enabled:
+                    perf.count('header.cards_parsed', len(parsed))
+                return header
+
         # If the card separator contains characters that may validly appear in
         # a card, the only way to unambiguously distinguish between cards is to
         # require that they be Card.length long.  However, if the separator
@@ -355,22 +397,23 @@ class Header(object):
         # immediately at the separator
         require_full_cardlength = set(sep).issubset(VALID_HEADER_CHARS)
 
-        # Split the header into individual cards
-        idx = 0
-        image = []
-
-        while idx < len(data):
-            if require_full_cardlength:
-                end_idx = idx + Card.length
-            else:
-                try:
-                    end_idx = data.index(sep, idx)
-                except ValueError:
-                    end_idx = len(data)
+        # Split the header into individual card images in one pass, rather
+        # than scanning for the separator one card at a time
+        if require_full_cardlength:
+            clen = Card.length + len(sep)
+            next_images = [data[idx:idx + Card.length]
+                           for idx in range(0, len(data), clen)]
+        else:
+            # A trailing separator does not start a new (empty) card
+            if data.endswith(sep):
+                data = data[:-len(sep)]
+            next_images = data.split(sep) if data else []
 
-            next_image = data[idx:end_idx]
-            idx = end_idx + len(sep)
+        # Group the images into logical cards, appending CONTINUE cards to
+        # the card they continue, and stop at the END card
+        image = []
 
+        for next_image in next_images:
             if image:
                 if next_image[:8] == 'CONTINUE':
                     image.append(next_image)
@@ -382,7 +425,7 @@ class Header(object):
                     image = []
                     break
             else:
-                if next_image.split(sep)[0].rstrip() == 'END':
+                if next_image.rstrip() == 'END':
                     image = []
                     break
 
@@ -392,6 +435,9 @@ class Header(object):
         if image:
             cards.append(Card.fromstring(''.join(image)))
 
+        if perf.enabled:
+            perf.count('header.cards_parsed', len(cards))
+
         return cls(cards)
 
     @classmethod
@@ -624,14 +670,33 @@ class Header(object):
             A string representing a FITS header.
         """
 
-        lines = []
-        for card in self._cards:
-            s = str(card)
-            # Cards with CONTINUE cards may be longer than 80 chars; so break
-            # them into multiple lines
-            while s:
-                lines.append(s[:Card.length])
-                s = s[Card.length:]
+        if not sep:
+            # Fast path for the common case of writing a raw FITS header:
+            # every card image is a multiple of Card.length long (cards with
+            # CONTINUE cards are already a sequence of 80 character lines), so
+            # with no separator the card images can be concatenated directly
+            # into a single buffer without splitting them into lines first
+            lines = [card.image for card in self._cards]
+            if endcard:
+                lines.append(_pad('END'))
+            if padding:
+                length = sum(len(line) for line in lines)
+                lines.append(' ' * _pad_length(length))
+            return ''.join(lines)
+
+        # In the typical case every card image is exactly one line, so the
+        # images are the lines and can be joined directly; only headers
+        # containing long-string cards need the line-splitting loop
+        lines = [str(card) for card in self._cards]
+        if any(len(line) > Card.length for line in lines):
+            images = lines
+            lines = []
+            for s in images:
+                # Cards with CONTINUE cards may be longer than 80 chars; so
+                # break them into multiple lines
+                while s:
+                    lines.append(s[:Card.length])
+                    s = s[Card.length:]
 
         s = sep.join(lines)
         if endcard:
@@ -1948,6 +2013,27 @@ class Header(object):
             except KeyError:
                 pass
 
+    def _verify_cards(self, option='warn'):
+        """
+        Verify all cards in the header, returning a list of the per-card
+        error lists from `Card._verify`.
+
+        Cards whose raw image passes the cheap `Card._image_is_standard`
+        check are known to be fully standard and are skipped (and marked
+        verified), so for the typical header of standard cards this is a
+        single fast pass rather than a full parse and regex battery per
+        card.
+        """
+
+        errs = []
+        for card in self._cards:
+            if (not card._modified and card._image is not None and
+                    Card._image_is_standard(card._image)):
+                card._verified = True
+                continue
+            errs.append(card._verify(option))
+        return errs
+
     def _add_commentary(self, key, value, before=None, after=None):
         """
         Add a commentary card.
@@ -0,0 +1,116 @@
+"""
+Lightweight opt-in runtime performance counters.
+
+When enabled, PyFITS accumulates counters at a few strategic points--bytes
+and calls through the `_File` layer, header cards parsed, table columns
+converted, and (when the optional compression extension is built) tiles
+compressed/decompressed with time spent per codec--so that pipeline stages
+can be instrumented without external profilers::
+
+    >>> import pyfits.perf
+    >>> pyfits.perf.enable()
+    >>> ... do some work ...
+    >>> pyfits.perf.counters()
+    {'file.read.calls': 12, 'file.read.bytes': 34560, ...}
+
+Counting is disabled by default; each instrumented call site only pays a
+single attribute test while disabled, so there is no measurable overhead in
+normal use.  The counters are process-global and not broken down per file;
+call `reset` (or `counters(reset=True)`) around the stage of interest to
+attribute costs to it.
+"""
+
+
+from collections import defaultdict
+
+
+__all__ = ['enable', 'disable', 'reset', 'counters']
+
+
+# Tested directly (``if perf.enabled:``) at the instrumented call sites;
+# keeping it a plain module attribute makes the disabled path as cheap as
+# possible
+enabled = False
+
+_counters = defaultdict(int)
+
+
+def count(name, value=1):
+    """
+    Adds ``value`` to the counter ``name``, creating it if necessary.
+
+    Call sites are expected to guard calls with ``if perf.enabled:`` rather
+    than leaving the check to this function, so that nothing at all is paid
+    while counting is disabled.
+    """
+
+    _counters[name] += value
+
+
+def enable():
+    """Turns on the performance counters (including the compression codec
+    statistics, if the compression extension is available)."""
+
+    global enabled
+    enabled = True
+    try:
+        from . import compression
+    except ImportError:
+        pass
+    else:
+        compression.enable_stats()
+
+
+def disable():
+    """Turns off the performance counters; their values are retained."""
+
+    global enabled
+    enabled = False
+    try:
+        from . import compression
+    except ImportError:
+        pass
+    else:
+        compression.disable_stats()
+
+
+def reset():
+    """Resets all counters to zero."""
+
+    _counters.clear()
+    try:
+        from . import compression
+    except ImportError:
+        pass
+    else:
+        compression.reset_stats()
+
+
+def counters(reset=False):
+    """
+    Returns a snapshot of all counters as a plain dict.
+
+    Counter names are dotted strings such as ``'file.read.bytes'``.  When
+    the compression extension is available and any codec has run, its
+    per-codec statistics are included under the ``'compression.compress'``
+    and ``'compression.decompress'`` keys as nested dicts.  With
+    ``reset=True`` the counters are zeroed after being read.
+    """
+
+    snapshot = dict(_counters)
+
+    try:
+        from . import compression
+    except ImportError:
+        pass
+    else:
+        stats = compression.get_stats()
+        if stats['compress']:
+            snapshot['compression.compress'] = stats['compress']
+        if stats['decompress']:
+            snapshot['compression.decompress'] = stats['decompress']
+
+    if reset:
+        globals()['reset']()
+
+    return snapshot
@@ -47,6 +47,7 @@ import logging
 import optparse
 import sys
 import textwrap
+import threading
 import warnings
 
 import pyfits
@@ -100,6 +101,22 @@ def handle_options(args):
         help='Ignore missing checksums.',
         default=False, action='store_true')
 
+    parser.add_option(
+        '-e', '--existing-only', dest='existing_only',
+        help='Verify only HDUs that already have CHECKSUM cards; HDUs '
+             'without them are skipped rather than reported as missing, and '
+             'files containing no CHECKSUM cards at all are noted as '
+             'skipped.',
+        default=False, action='store_true')
+
+    parser.add_option(
+        '-j', '--workers', dest='workers', type='int', default=1,
+        metavar='INTEGER',
+        help='Number of worker threads across which to spread the '
+             'verification of multiple files; use 0 for one worker per '
+             'processor.  Each worker holds at most one file open at a time '
+             'and results are reported in command line order.  Defaults 1.')
+
     parser.add_option(
         '-v', '--verbose', dest='verbose', help='Generate extra output.',
         default=False, action='store_true')
@@ -132,21 +149,28 @@ def verify_checksums(filename):
     errors = 0
     try:
         hdulist = pyfits.open(filename, checksum=OPTIONS.checksum_kind)
-    except UserWarning, w:
+    except UserWarning:
+        w = sys.exc_info()[1]
         remainder = '.. ' + ' '.join(str(w).split(' ')[1:]).strip()
         # if "Checksum" in str(w) or "Datasum" in str(w):
         log.warn('BAD %r %s' % (filename, remainder))
         return 1
-    if not OPTIONS.ignore_missing:
-        for i, hdu in enumerate(hdulist):
-            if not hdu._checksum:
-                log.warn('MISSING %r .. Checksum not found in HDU #%d' %
-                         (filename, i))
-                return 1
-            if not hdu._datasum:
-                log.warn('MISSING %r .. Datasum not found in HDU #%d' %
-                         (filename, i))
-                return 1
+    try:
+        if OPTIONS.existing_only:
+            if not any(hdu._checksum for hdu in hdulist):
+                log.info('SKIPPED %r .. no CHECKSUM cards found' % filename)
+        elif not OPTIONS.ignore_missing:
+            for i, hdu in enumerate(hdulist):
+                if not hdu._checksum:
+                    log.warn('MISSING %r .. Checksum not found in HDU #%d' %
+                             (filename, i))
+                    return 1
+                if not hdu._datasum:
+                    log.warn('MISSING %r .. Datasum not found in HDU #%d' %
+                             (filename, i))
+                    return 1
+    finally:
+        hdulist.close()
     if not errors:
         log.info('OK %r' % filename)
     return errors
@@ -161,8 +185,10 @@ def verify_compliance(filename):
     except pyfits.VerifyError:
         exc = sys.exc_info()[1]
         log.warn('NONCOMPLIANT %r .. %s' %
-                 (filename), str(exc).replace('\n', ' '))
+                 (filename, str(exc).replace('\n', ' ')))
         return 1
+    finally:
+        hdulist.close()
     return 0
 
 
@@ -205,17 +231,112 @@ def process_file(filename):
         return 1
 
 
+class _ThreadLogCollector(logging.Handler):
+    """
+    Buffers the log records emitted by each worker thread so that the output
+    of files processed in parallel can be re-emitted in command line order.
+    """
+
+    def __init__(self):
+        logging.Handler.__init__(self)
+        self._local = threading.local()
+
+    def start_file(self):
+        self._local.records = []
+
+    def emit(self, record):
+        self._local.records.append(record)
+
+    def finish_file(self):
+        records = getattr(self._local, 'records', [])
+        self._local.records = []
+        return records
+
+
+def process_files(fits_files):
+    """
+    Processes the given files serially or across a pool of worker threads,
+    returning a list of the error count for each file.  Output is logged in
+    command line order regardless of the number of workers.
+    """
+
+    workers = OPTIONS.workers
+    if workers == 0:
+        try:
+            import multiprocessing
+            workers = multiprocessing.cpu_count()
+        except (ImportError, NotImplementedError):
+            workers = 1
+    workers = min(workers, len(fits_files))
+
+    if workers <= 1:
+        return [process_file(filename) for filename in fits_files]
+
+    results = [None] * len(fits_files)
+    collector = _ThreadLogCollector()
+    lock = threading.Lock()
+    counter = [0]
+
+    def next_index():
+        lock.acquire()
+        try:
+            idx = counter[0]
+            counter[0] += 1
+            return idx
+        finally:
+            lock.release()
+
+    def run():
+        while True:
+            idx = next_index()
+            if idx >= len(fits_files):
+                break
+            collector.start_file()
+            errors = process_file(fits_files[idx])
+            results[idx] = (errors, collector.finish_file())
+
+    # Route all worker log output through the collector instead of the
+    # normal handlers; process_file turns any exception into a logged error,
+    # so every result slot gets filled
+    normal_handlers = log.handlers[:]
+    for handler in normal_handlers:
+        log.removeHandler(handler)
+    log.addHandler(collector)
+    try:
+        threads = [threading.Thread(target=run) for _ in range(workers)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+    finally:
+        log.removeHandler(collector)
+        for handler in normal_handlers:
+            log.addHandler(handler)
+
+    errors = []
+    for file_errors, records in results:
+        for record in records:
+            log.handle(record)
+        errors.append(file_errors)
+    return errors
+
+
 def main():
     """
     Processes command line parameters into options and files,  then checks
     or update FITS DATASUM and CHECKSUM keywords for the specified files.
     """
 
-    errors = 0
     fits_files = handle_options(sys.argv[1:])
     setup_logging()
-    for filename in fits_files:
-        errors += process_file(filename)
+    file_errors = process_files(fits_files)
+    errors = sum(file_errors)
     if errors:
         log.warn('%d errors' % errors)
+        failures = [filename for filename, count
+                    in zip(fits_files, file_errors) if count]
+        log.warn('%d of %d file(s) had errors:' %
+                 (len(failures), len(fits_files)))
+        for filename in failures:
+            log.warn('  %s' % filename)
     return int(bool(errors))
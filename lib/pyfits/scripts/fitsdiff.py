@@ -126,6 +126,13 @@ def handle_options(argv=None):
         help='Output results to this file; otherwise results are printed to '
              'stdout.')
 
+    parser.add_option(
+        '-j', '--workers', type='int', default=1, dest='workers',
+        metavar='INTEGER',
+        help='Number of worker threads across which to spread the comparison '
+             'of extensions; use 0 for one worker per processor '
+             '(default %default).')
+
     group = optparse.OptionGroup(parser, 'Header Comparison Options')
 
     group.add_option(
@@ -261,7 +268,8 @@ def main():
                 ignore_comments=opts.ignore_comments,
                 ignore_fields=opts.ignore_fields, numdiffs=opts.numdiffs,
                 tolerance=opts.tolerance, ignore_blanks=opts.ignore_blanks,
-                ignore_blank_cards=opts.ignore_blank_cards)
+                ignore_blank_cards=opts.ignore_blank_cards,
+                workers=opts.workers)
             diff.report(fileobj=out_file)
             identical.append(diff.identical)
 
@@ -1,30 +1,497 @@
 /* This script verifies .fits checksums using CFITSIO to demonstrate
-compatibility with PyFITS.   Since running it requires compiling and
-linking against cfitsio,  the script is included as a maintenance 
-asset but not automatically compiled and run.
+compatibility with PyFITS, and doubles as a correctness-and-throughput
+harness for the compression codecs bundled in cextern/cfitsio.  Since
+running it requires compiling and linking against cfitsio, the script is
+included as a maintenance asset but not automatically compiled and run.
 
-After installing cfitsio to ~/include and ~/lib,  I built cfitsio_verify
+After installing cfitsio to ~/include and ~/lib, I built cfitsio_verify
 like this:
 
 % gcc cfitsio_verify.c -I~/include -L~/lib -lcfitsio -lm -o cfitsio_verify
 
-Run cfitsio_verify like this:
+Run checksum verification like this:
 
 % cfitsio_verify tmp.fits
 
+Run the codec harness like this:
+
+% cfitsio_verify --codecs
+
+The codec harness round-trips the Rice (int/short/byte) and PLIO coders
+and the float/double quantizers over adversarial tile patterns (constant,
+ramp, random noise, alternating extremes, sparse spikes, nulls) at several
+tile sizes, checks the lossless codecs decode bit-exactly and the
+quantizers reconstruct within the quantization step, and reports per-codec
+encode/decode throughput in MB/s.  It exits nonzero on any correctness
+failure, and also if the CFITSIO_VERIFY_MIN_MBS environment variable is
+set and any measured throughput falls below it, so it can act as a
+performance gate before release.
+
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
 #include <fitsio.h>
+#include <fitsio2.h>
+
+#define QUANT_NULL_VALUE -2147483647  /* must match NULL_VALUE in quantize.c */
+
+static int nfailures = 0;
+static double min_mbs = 0.0;          /* optional throughput floor */
+
+static const int tile_sizes[] = { 16, 64, 100, 1024, 4096, 65536 };
+#define NTILESIZES (sizeof(tile_sizes) / sizeof(tile_sizes[0]))
+
+enum { PAT_CONSTANT, PAT_RAMP, PAT_NOISE, PAT_EXTREMES, PAT_SPIKES, NPATTERNS };
+
+static const char *pattern_names[NPATTERNS] =
+    { "constant", "ramp", "noise", "extremes", "spikes" };
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+static void fail(const char *codec, const char *pattern, int nx,
+		 const char *what)
+{
+	fprintf(stderr, "FAIL %s: pattern=%s nx=%d: %s\n",
+		codec, pattern, nx, what);
+	nfailures++;
+}
+
+static void check_rate(const char *codec, const char *direction,
+		       double nbytes, double seconds)
+{
+	double mbs;
+
+	if (seconds <= 0.)
+		seconds = 1.e-9;
+	mbs = nbytes / (1024. * 1024.) / seconds;
+	printf("%-16s %-6s %9.1f MB/s\n", codec, direction, mbs);
+	if (min_mbs > 0. && mbs < min_mbs) {
+		fprintf(stderr, "FAIL %s %s: %.1f MB/s below floor %.1f\n",
+			codec, direction, mbs, min_mbs);
+		nfailures++;
+	}
+}
+
+/* Fill an int tile with the requested adversarial pattern; the range limits
+   the magnitude of the generated values so the same generator serves the
+   narrower codecs */
+static void fill_pattern(int *a, int nx, int pattern, int minval, int maxval)
+{
+	int i;
+	unsigned int seed = 123456789u + nx + pattern;
+
+	switch (pattern) {
+	case PAT_CONSTANT:
+		for (i = 0; i < nx; i++)
+			a[i] = (minval + maxval) / 2;
+		break;
+	case PAT_RAMP:
+		for (i = 0; i < nx; i++)
+			a[i] = minval + (int)
+			    (((long long)(maxval - minval) * i) /
+			     (nx > 1 ? nx - 1 : 1));
+		break;
+	case PAT_NOISE:
+		for (i = 0; i < nx; i++) {
+			seed = seed * 1103515245u + 12345u;
+			a[i] = minval + (int)(seed % (unsigned int)
+					      ((long long)maxval - minval + 1));
+		}
+		break;
+	case PAT_EXTREMES:
+		for (i = 0; i < nx; i++)
+			a[i] = (i & 1) ? maxval : minval;
+		break;
+	case PAT_SPIKES:
+		for (i = 0; i < nx; i++)
+			a[i] = minval;
+		for (i = 0; i < nx; i += 97)
+			a[i] = maxval;
+		break;
+	}
+}
+
+/* ---------------- Rice codecs (lossless; must be bit-exact) -------------- */
+
+static void test_rice_int(void)
+{
+	int *orig;
+	unsigned int *out;
+	unsigned char *comp;
+	int nx, clen, csize, p, t, iter, niter;
+	double t0, tenc = 0., tdec = 0., nbytes = 0.;
+
+	for (t = 0; t < (int)NTILESIZES; t++) {
+		nx = tile_sizes[t];
+		clen = nx * 8 + 256;
+		orig = malloc(nx * sizeof(int));
+		out = malloc(nx * sizeof(unsigned int));
+		comp = malloc(clen);
+		niter = 4 * 1024 * 1024 / (nx * 4) + 1;
+
+		for (p = 0; p < NPATTERNS; p++) {
+			fill_pattern(orig, nx, p, -2000000000, 2000000000);
+
+			t0 = now_seconds();
+			for (iter = 0, csize = 0; iter < niter; iter++)
+				csize = fits_rcomp(orig, nx, comp, clen, 32);
+			tenc += now_seconds() - t0;
+			if (csize <= 0) {
+				fail("rice-int", pattern_names[p], nx,
+				     "encode failed");
+				continue;
+			}
+
+			t0 = now_seconds();
+			for (iter = 0; iter < niter; iter++) {
+				memset(out, 0, nx * sizeof(unsigned int));
+				fits_rdecomp(comp, csize, out, nx, 32);
+			}
+			tdec += now_seconds() - t0;
+
+			if (memcmp(orig, out, nx * sizeof(int)))
+				fail("rice-int", pattern_names[p], nx,
+				     "round trip not bit-exact");
+			nbytes += (double)niter * nx * 4;
+		}
+		free(orig); free(out); free(comp);
+	}
+	check_rate("rice-int", "encode", nbytes, tenc);
+	check_rate("rice-int", "decode", nbytes, tdec);
+}
+
+static void test_rice_short(void)
+{
+	int *pat;
+	short *orig;
+	unsigned short *out;
+	unsigned char *comp;
+	int nx, clen, csize, p, t, i, iter, niter;
+	double t0, tenc = 0., tdec = 0., nbytes = 0.;
+
+	for (t = 0; t < (int)NTILESIZES; t++) {
+		nx = tile_sizes[t];
+		clen = nx * 4 + 256;
+		pat = malloc(nx * sizeof(int));
+		orig = malloc(nx * sizeof(short));
+		out = malloc(nx * sizeof(unsigned short));
+		comp = malloc(clen);
+		niter = 4 * 1024 * 1024 / (nx * 2) + 1;
+
+		for (p = 0; p < NPATTERNS; p++) {
+			fill_pattern(pat, nx, p, -32000, 32000);
+			for (i = 0; i < nx; i++)
+				orig[i] = (short)pat[i];
+
+			t0 = now_seconds();
+			for (iter = 0, csize = 0; iter < niter; iter++)
+				csize = fits_rcomp_short(orig, nx, comp, clen,
+							 32);
+			tenc += now_seconds() - t0;
+			if (csize <= 0) {
+				fail("rice-short", pattern_names[p], nx,
+				     "encode failed");
+				continue;
+			}
+
+			t0 = now_seconds();
+			for (iter = 0; iter < niter; iter++) {
+				memset(out, 0, nx * sizeof(unsigned short));
+				fits_rdecomp_short(comp, csize, out, nx, 32);
+			}
+			tdec += now_seconds() - t0;
+
+			if (memcmp(orig, out, nx * sizeof(short)))
+				fail("rice-short", pattern_names[p], nx,
+				     "round trip not bit-exact");
+			nbytes += (double)niter * nx * 2;
+		}
+		free(pat); free(orig); free(out); free(comp);
+	}
+	check_rate("rice-short", "encode", nbytes, tenc);
+	check_rate("rice-short", "decode", nbytes, tdec);
+}
+
+static void test_rice_byte(void)
+{
+	int *pat;
+	signed char *orig;
+	unsigned char *out, *comp;
+	int nx, clen, csize, p, t, i, iter, niter;
+	double t0, tenc = 0., tdec = 0., nbytes = 0.;
+
+	for (t = 0; t < (int)NTILESIZES; t++) {
+		nx = tile_sizes[t];
+		clen = nx * 2 + 256;
+		pat = malloc(nx * sizeof(int));
+		orig = malloc(nx);
+		out = malloc(nx);
+		comp = malloc(clen);
+		niter = 4 * 1024 * 1024 / nx + 1;
+
+		for (p = 0; p < NPATTERNS; p++) {
+			fill_pattern(pat, nx, p, -120, 120);
+			for (i = 0; i < nx; i++)
+				orig[i] = (signed char)pat[i];
+
+			t0 = now_seconds();
+			for (iter = 0, csize = 0; iter < niter; iter++)
+				csize = fits_rcomp_byte(orig, nx, comp, clen,
+							32);
+			tenc += now_seconds() - t0;
+			if (csize <= 0) {
+				fail("rice-byte", pattern_names[p], nx,
+				     "encode failed");
+				continue;
+			}
+
+			t0 = now_seconds();
+			for (iter = 0; iter < niter; iter++) {
+				memset(out, 0, nx);
+				fits_rdecomp_byte(comp, csize, out, nx, 32);
+			}
+			tdec += now_seconds() - t0;
+
+			if (memcmp(orig, out, nx))
+				fail("rice-byte", pattern_names[p], nx,
+				     "round trip not bit-exact");
+			nbytes += (double)niter * nx;
+		}
+		free(pat); free(orig); free(out); free(comp);
+	}
+	check_rate("rice-byte", "encode", nbytes, tenc);
+	check_rate("rice-byte", "decode", nbytes, tdec);
+}
+
+/* -------------- PLIO (lossless for mask-like positive data) -------------- */
+
+static void test_plio(void)
+{
+	int *orig, *out;
+	short *ll;
+	int nx, p, t, llen, iter, niter;
+	double t0, tenc = 0., tdec = 0., nbytes = 0.;
+
+	for (t = 0; t < (int)NTILESIZES; t++) {
+		nx = tile_sizes[t];
+		orig = malloc(nx * sizeof(int));
+		out = malloc(nx * sizeof(int));
+		ll = malloc((2 * nx + 512) * sizeof(short));
+		niter = 4 * 1024 * 1024 / (nx * 4) + 1;
+
+		for (p = 0; p < NPATTERNS; p++) {
+			/* PLIO encodes positive mask-like values */
+			fill_pattern(orig, nx, p, 0, 4095);
+
+			t0 = now_seconds();
+			for (iter = 0, llen = 0; iter < niter; iter++)
+				llen = pl_p2li(orig, 1, ll, nx);
+			tenc += now_seconds() - t0;
+			if (llen <= 0) {
+				fail("plio", pattern_names[p], nx,
+				     "encode failed");
+				continue;
+			}
+
+			t0 = now_seconds();
+			for (iter = 0; iter < niter; iter++) {
+				memset(out, 0, nx * sizeof(int));
+				pl_l2pi(ll, 1, out, nx);
+			}
+			tdec += now_seconds() - t0;
+
+			if (memcmp(orig, out, nx * sizeof(int)))
+				fail("plio", pattern_names[p], nx,
+				     "round trip not bit-exact");
+			nbytes += (double)niter * nx * 4;
+		}
+		free(orig); free(out); free(ll);
+	}
+	check_rate("plio", "encode", nbytes, tenc);
+	check_rate("plio", "decode", nbytes, tdec);
+}
+
+/* --- quantizer (lossy; reconstruction must stay within the q step) ------- */
+
+static void test_quantize_float(void)
+{
+	int *pat, *idata;
+	float *fdata;
+	int nx, p, t, i, iter, niter, stat, imin, imax, mode;
+	long row;
+	double bscale, bzero, tol, diff;
+	double t0, tq = 0., nbytes = 0.;
+	const float nullval = -9999.f;
+
+	for (t = 0; t < (int)NTILESIZES; t++) {
+		nx = tile_sizes[t];
+		pat = malloc(nx * sizeof(int));
+		fdata = malloc(nx * sizeof(float));
+		idata = malloc(nx * sizeof(int));
+		niter = 4 * 1024 * 1024 / (nx * 4) + 1;
+
+		for (p = 0; p < NPATTERNS; p++) {
+		    for (mode = 0; mode < 2; mode++) {
+			/* mode 0: plain quantization (row = 0), error bound
+			   is half the q step; mode 1: subtractive dither
+			   (row > 0), the dither offset widens the plain
+			   reconstruction error bound to one full q step */
+			row = mode ? 1 : 0;
+
+			fill_pattern(pat, nx, p, -100000, 100000);
+			for (i = 0; i < nx; i++) {
+				fdata[i] = pat[i] / 32.f;
+				/* scatter in some undefined pixels */
+				if (i % 61 == 0 && p == PAT_NOISE)
+					fdata[i] = nullval;
+			}
+
+			t0 = now_seconds();
+			for (iter = 0, stat = 0; iter < niter; iter++)
+				stat = fits_quantize_float(row, fdata, nx, 1,
+					1, nullval, 4.,
+					mode ? SUBTRACTIVE_DITHER_1 : NO_DITHER,
+					idata, &bscale, &bzero, &imin, &imax);
+			tq += now_seconds() - t0;
+
+			if (!stat)    /* can't be quantized; not a failure */
+				continue;
+
+			tol = (mode ? bscale : bscale / 2.) * 1.0001;
+			for (i = 0; i < nx; i++) {
+				if (fdata[i] == nullval) {
+					if (idata[i] != QUANT_NULL_VALUE)
+						fail("quantize-float",
+						     pattern_names[p], nx,
+						     "null pixel not flagged");
+					continue;
+				}
+				diff = fabs(idata[i] * bscale + bzero
+					    - fdata[i]);
+				if (diff > tol) {
+					fail("quantize-float",
+					     pattern_names[p], nx,
+					     "reconstruction outside q step");
+					break;
+				}
+			}
+			nbytes += (double)niter * nx * 4;
+		    }
+		}
+		free(pat); free(fdata); free(idata);
+	}
+	check_rate("quantize-float", "encode", nbytes, tq);
+}
+
+static void test_quantize_double(void)
+{
+	int *pat, *idata;
+	double *fdata;
+	int nx, p, t, i, iter, niter, stat, imin, imax, mode;
+	long row;
+	double bscale, bzero, tol, diff;
+	double t0, tq = 0., nbytes = 0.;
+	const double nullval = -9999.;
+
+	for (t = 0; t < (int)NTILESIZES; t++) {
+		nx = tile_sizes[t];
+		pat = malloc(nx * sizeof(int));
+		fdata = malloc(nx * sizeof(double));
+		idata = malloc(nx * sizeof(int));
+		niter = 4 * 1024 * 1024 / (nx * 8) + 1;
+
+		for (p = 0; p < NPATTERNS; p++) {
+		    for (mode = 0; mode < 2; mode++) {
+			row = mode ? 1 : 0;
+
+			fill_pattern(pat, nx, p, -100000, 100000);
+			for (i = 0; i < nx; i++) {
+				fdata[i] = pat[i] / 32.;
+				if (i % 61 == 0 && p == PAT_NOISE)
+					fdata[i] = nullval;
+			}
+
+			t0 = now_seconds();
+			for (iter = 0, stat = 0; iter < niter; iter++)
+				stat = fits_quantize_double(row, fdata, nx, 1,
+					1, nullval, 4.,
+					mode ? SUBTRACTIVE_DITHER_1 : NO_DITHER,
+					idata, &bscale, &bzero, &imin, &imax);
+			tq += now_seconds() - t0;
+
+			if (!stat)
+				continue;
+
+			tol = (mode ? bscale : bscale / 2.) * 1.0001;
+			for (i = 0; i < nx; i++) {
+				if (fdata[i] == nullval) {
+					if (idata[i] != QUANT_NULL_VALUE)
+						fail("quantize-double",
+						     pattern_names[p], nx,
+						     "null pixel not flagged");
+					continue;
+				}
+				diff = fabs(idata[i] * bscale + bzero
+					    - fdata[i]);
+				if (diff > tol) {
+					fail("quantize-double",
+					     pattern_names[p], nx,
+					     "reconstruction outside q step");
+					break;
+				}
+			}
+			nbytes += (double)niter * nx * 8;
+		    }
+		}
+		free(pat); free(fdata); free(idata);
+	}
+	check_rate("quantize-double", "encode", nbytes, tq);
+}
+
+static int run_codec_harness(void)
+{
+	char *env = getenv("CFITSIO_VERIFY_MIN_MBS");
+
+	if (env)
+		min_mbs = atof(env);
+
+	test_rice_int();
+	test_rice_short();
+	test_rice_byte();
+	test_plio();
+	test_quantize_float();
+	test_quantize_double();
+
+	if (nfailures) {
+		fprintf(stderr, "%d codec check(s) FAILED\n", nfailures);
+		return 1;
+	}
+	printf("all codec checks passed\n");
+	return 0;
+}
+
+/* ------------------------ checksum verification -------------------------- */
 
 char * verify_status(int status)
 {
-	if (status == 1) { 
+	if (status == 1) {
 		return "ok";
 	} else if (status == 0) {
 		return "missing";
 	} else if (status == -1) {
 		return "error";
 	}
+	return "unknown";
 }
 
 int main(int argc, char *argv[])
@@ -33,31 +500,35 @@ int main(int argc, char *argv[])
 	int i, j, status, dataok, hduok, hdunum, hdutype;
 	char *hdustr, *datastr;
 
+	if (argc > 1 && !strcmp(argv[1], "--codecs")) {
+		return run_codec_harness();
+	}
+
 	for (i=1; i<argc; i++) {
 
 		fits_open_file(&fptr, argv[i], READONLY, &status);
-		if (status) { 
+		if (status) {
 			fits_report_error(stderr, status);
-			exit(-1); 
+			exit(-1);
 		}
 
 		fits_get_num_hdus(fptr, &hdunum, &status);
-		if (status) { 
-			fprintf(stderr, "Bad get_num_hdus status for '%s' = %d", 
+		if (status) {
+			fprintf(stderr, "Bad get_num_hdus status for '%s' = %d",
 				argv[i], status);
-			exit(-1); 
+			exit(-1);
 		}
 
 		for (j=0; j<hdunum; j++) {
 			fits_movabs_hdu(fptr, hdunum, &hdutype, &status);
-			if (status) { 
-				fprintf(stderr, "Bad movabs status for '%s[%d]' = %d.", 
+			if (status) {
+				fprintf(stderr, "Bad movabs status for '%s[%d]' = %d.",
 					argv[i], j, status);
 				exit(-1);
 			}
 			fits_verify_chksum(fptr, &dataok, &hduok, &status);
-			if (status) { 
-				fprintf(stderr, "Bad verify status for '%s[%d]' = %d.", 
+			if (status) {
+				fprintf(stderr, "Bad verify status for '%s[%d]' = %d.",
 					argv[i], j, status);
 				exit(-1);
 			}
@@ -67,5 +538,5 @@ int main(int argc, char *argv[])
 			       argv[i], j, datastr, hdustr);
 		}
 	}
+	return 0;
 }
-
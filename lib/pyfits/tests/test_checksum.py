@@ -336,6 +336,28 @@ class TestChecksumFunctions(PyfitsTestCase):
             assert (hasattr(hdul[0], '_checksum_comment') and
                     not hdul[0]._checksum_comment)
 
+    def test_incremental_datasum(self):
+        """
+        An in-place update whose byte range is declared with
+        mark_data_updated should produce the same DATASUM as a full
+        recomputation.
+        """
+
+        arr = np.arange(10000, dtype='>i4').reshape((100, 100))
+        hdu = fits.PrimaryHDU(data=arr)
+        hdu.writeto(self.temp('tmp.fits'), checksum=True)
+
+        with fits.open(self.temp('tmp.fits'), mode='update',
+                       checksum=True) as hdul:
+            hdul[0].data[5] = 42
+            hdul[0].mark_data_updated(5 * 400, 6 * 400)
+
+        with fits.open(self.temp('tmp.fits'), checksum=True) as hdul:
+            assert (hdul[0].data[5] == 42).all()
+            datasum = int(hdul[0].header['DATASUM'])
+            hdul[0]._datasum_dirty_ranges = None
+            assert hdul[0]._calculate_datasum('standard') == datasum
+
     def test_open_update_mode_preserve_checksum(self):
         """
         Regression test for https://aeon.stsci.edu/ssb/trac/pyfits/ticket/148 where
@@ -292,7 +292,7 @@ class TestCore(PyfitsTestCase):
         the convenience functions.
         """
 
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', 1)
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', 1)
         assert ext == 1
         assert_raises(ValueError, _getext, self.data('test0.fits'), 'readonly',
                       1, 2)
@@ -302,22 +302,22 @@ class TestCore(PyfitsTestCase):
                       'sci', 'sci')
         assert_raises(TypeError, _getext, self.data('test0.fits'), 'readonly',
                       1, 2, 3)
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', ext=1)
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', ext=1)
         assert ext == 1
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', ext=('sci', 2))
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', ext=('sci', 2))
         assert ext == ('sci', 2)
         assert_raises(TypeError, _getext, self.data('test0.fits'), 'readonly',
                       1, ext=('sci', 2), extver=3)
         assert_raises(TypeError, _getext, self.data('test0.fits'), 'readonly',
                       ext=('sci', 2), extver=3)
 
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', 'sci')
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', 'sci')
         assert ext == ('sci', 1)
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', 'sci', 1)
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', 'sci', 1)
         assert ext == ('sci', 1)
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', ('sci', 1))
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', ('sci', 1))
         assert ext == ('sci', 1)
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', 'sci',
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', 'sci',
                           extver=1, do_not_scale_image_data=True)
         assert ext == ('sci', 1)
         assert_raises(TypeError, _getext, self.data('test0.fits'), 'readonly',
@@ -325,9 +325,9 @@ class TestCore(PyfitsTestCase):
         assert_raises(TypeError, _getext, self.data('test0.fits'), 'readonly',
                       'sci', 1, extver=2)
 
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', extname='sci')
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', extname='sci')
         assert ext == ('sci', 1)
-        hl, ext = _getext(self.data('test0.fits'), 'readonly', extname='sci',
+        hl, ext, cached = _getext(self.data('test0.fits'), 'readonly', extname='sci',
                           extver=1)
         assert ext == ('sci', 1)
         assert_raises(TypeError, _getext, self.data('test0.fits'), 'readonly',
@@ -514,6 +514,33 @@ class TestCore(PyfitsTestCase):
                             assert np.all(hdu1.data == hdu2.data)
 
 
+    def test_perf_counters(self):
+        """Test the opt-in pyfits.perf performance counter surface."""
+
+        from .. import perf
+
+        hdu = fits.PrimaryHDU(data=np.arange(100, dtype=np.int32))
+        hdu.writeto(self.temp('test.fits'))
+
+        # Nothing is recorded while disabled
+        perf.reset()
+        with fits.open(self.temp('test.fits')) as hdul:
+            hdul[0].data
+        assert perf.counters() == {}
+
+        perf.enable()
+        try:
+            with fits.open(self.temp('test.fits'), memmap=False) as hdul:
+                hdul[0].data
+        finally:
+            perf.disable()
+
+        counters = perf.counters(reset=True)
+        assert counters['header.cards_parsed'] > 0
+        assert counters['file.readarray.bytes'] >= 400
+        assert perf.counters() == {}
+
+
 class TestConvenienceFunctions(PyfitsTestCase):
     def test_writeto(self):
         """
@@ -549,6 +576,73 @@ class TestConvenienceFunctions(PyfitsTestCase):
         assert hdul[0].header['CRPIX1'] == 1.0
 
 
+    def test_getvals(self):
+        """
+        Test batch retrieval of several keywords from several files with
+        getvals.
+        """
+
+        filenames = []
+        for idx in range(3):
+            hdu = fits.PrimaryHDU()
+            hdu.header['OBSID'] = idx
+            if idx != 1:
+                hdu.header['FILTER'] = 'F%d' % idx
+            filename = self.temp('test%d.fits' % idx)
+            hdu.writeto(filename)
+            filenames.append(filename)
+
+        values = fits.getvals(filenames, ['OBSID', 'FILTER'], default=None)
+        assert values['OBSID'] == [0, 1, 2]
+        assert values['FILTER'] == ['F0', None, 'F2']
+
+        # Without a default a missing keyword raises KeyError, as in getval
+        assert_raises(KeyError, fits.getvals, filenames, ['FILTER'])
+
+        # A single filename and keyword still give lists
+        assert fits.getvals(filenames[0], 'OBSID') == {'OBSID': [0]}
+
+        fits.close_caches()
+
+    def test_open_handle_cache(self):
+        """
+        Test that repeated read-only convenience function calls reuse a
+        cached open handle, that modifying the file invalidates the cached
+        handle, and that close_caches empties the cache.
+        """
+
+        from ..convenience import _open_cache
+
+        fits.close_caches()
+        hdu = fits.PrimaryHDU()
+        hdu.header['TESTKEY'] = 1
+        hdu.writeto(self.temp('test.fits'))
+
+        assert fits.getval(self.temp('test.fits'), 'TESTKEY') == 1
+        assert len(_open_cache) == 1
+        # A second identical query must reuse the cached handle rather than
+        # add a new one
+        assert fits.getval(self.temp('test.fits'), 'TESTKEY') == 1
+        assert len(_open_cache) == 1
+
+        # Modifying a header returned from the cache must not leak into
+        # later results
+        hdr = fits.getheader(self.temp('test.fits'))
+        hdr['TESTKEY'] = 99
+        assert fits.getheader(self.temp('test.fits'))['TESTKEY'] == 1
+
+        # Modifying the file invalidates the cached handles for it
+        fits.setval(self.temp('test.fits'), 'TESTKEY', value=2)
+        # Force an mtime change even on filesystems with coarse timestamp
+        # resolution
+        stat = os.stat(self.temp('test.fits'))
+        os.utime(self.temp('test.fits'), (stat.st_atime, stat.st_mtime + 1))
+        assert fits.getval(self.temp('test.fits'), 'TESTKEY') == 2
+
+        fits.close_caches()
+        assert len(_open_cache) == 0
+
+
 class TestFileFunctions(PyfitsTestCase):
     """
     Tests various basic I/O operations, specifically in the pyfits.file._File
@@ -609,6 +703,35 @@ class TestFileFunctions(PyfitsTestCase):
         with fits.open(self.temp('test.fits.gz')) as hdul:
             assert hdul[0].header == h.header
 
+    def test_append_fast_path(self):
+        """
+        fits.append seeks directly to EOF for well-formed files instead of
+        re-reading every HDU; the appended file must remain fully readable,
+        and files that fail the cheap structural checks must fall back to the
+        fully verified append.
+        """
+
+        data1 = np.arange(100)
+        data2 = np.arange(100, dtype=np.float32).reshape(10, 10)
+        fits.writeto(self.temp('test.fits'), data1)
+        fits.append(self.temp('test.fits'), data2)
+        fits.append(self.temp('test.fits'), data2, verify=False)
+
+        with fits.open(self.temp('test.fits')) as hdul:
+            assert len(hdul) == 3
+            assert (hdul[0].data == data1).all()
+            assert (hdul[1].data == data2).all()
+            assert (hdul[2].data == data2).all()
+
+        from ..convenience import _validate_append_target
+        assert _validate_append_target(self.temp('test.fits'))
+
+        # A file that is not a whole number of FITS blocks is left to the
+        # verified append path
+        with open(self.temp('test.fits'), 'ab') as f:
+            f.write(b'\x00' * 100)
+        assert not _validate_append_target(self.temp('test.fits'))
+
     def test_open_zipped(self):
         zf = self._make_zip_file()
 
@@ -800,6 +923,31 @@ class TestFileFunctions(PyfitsTestCase):
                 mmap.mmap = old_mmap
                 _File._mmap_available = None
 
+    def test_shared_mmap_denywrite(self):
+        """
+        Multiple 'denywrite' opens of the same file share a single read-only
+        memory mapping, which is only unmapped once the last open is closed.
+        """
+
+        from ..file import _shared_mmap_registry
+        from ..util import _get_array_mmap
+
+        h1 = fits.open(self.data('test0.fits'), mode='denywrite',
+                       memmap=True)
+        h2 = fits.open(self.data('test0.fits'), mode='denywrite',
+                       memmap=True)
+        try:
+            assert len(_shared_mmap_registry) == 1
+            m1 = _get_array_mmap(h1[1].data)
+            m2 = _get_array_mmap(h2[1].data)
+            assert m1 is not None and m1 is m2
+            assert (h1[1].data == h2[1].data).all()
+        finally:
+            h1.close()
+            assert len(_shared_mmap_registry) == 1
+            h2.close()
+        assert len(_shared_mmap_registry) == 0
+
     def test_uncloseable_file(self):
         """
         Regression test for https://github.com/astropy/astropy/issues/2356
@@ -902,6 +1050,32 @@ class TestStreamingFunctions(PyfitsTestCase):
         assert len(hdul) == 1
         assert (hdul[0].data == arr).all()
 
+    def test_streaming_hdu_async_writes(self):
+        """
+        Test that a StreamingHDU with asynchronous double-buffered writes
+        produces the same file as a synchronous one.
+        """
+
+        arr = np.arange(25, dtype=np.int32).reshape((5, 5))
+        shdu = self._make_streaming_hdu(self.temp('new.fits'),
+                                        async_writes=True)
+        for row in range(5):
+            complete = shdu.write(arr[row:row + 1])
+        assert complete
+        shdu.close()
+
+        with fits.open(self.temp('new.fits')) as hdul:
+            assert len(hdul) == 1
+            assert (hdul[0].data == arr).all()
+
+        # Overflowing the stream should still fail up front, before the data
+        # is staged
+        shdu = self._make_streaming_hdu(self.temp('new2.fits'),
+                                        async_writes=True)
+        assert shdu.write(arr)
+        assert_raises(IOError, shdu.write, arr)
+        shdu.close()
+
     def test_streaming_hdu_append_extension(self):
         arr = np.zeros((5, 5), dtype=np.int32)
         with open(self.temp('new.fits'), 'ab+') as f:
@@ -926,7 +1100,7 @@ class TestStreamingFunctions(PyfitsTestCase):
             assert hdul[1].name == '12345678'
             assert hdul[1].header['EXTNAME'] == '12345678'
 
-    def _make_streaming_hdu(self, fileobj):
+    def _make_streaming_hdu(self, fileobj, **kwargs):
         hd = fits.Header()
         hd['SIMPLE'] = (True, 'conforms to FITS standard')
         hd['BITPIX'] = (32, 'array data type')
@@ -934,4 +1108,4 @@ class TestStreamingFunctions(PyfitsTestCase):
         hd['NAXIS1'] = 5
         hd['NAXIS2'] = 5
         hd['EXTEND'] = True
-        return fits.StreamingHDU(fileobj, hd)
+        return fits.StreamingHDU(fileobj, hd, **kwargs)
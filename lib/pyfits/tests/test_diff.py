@@ -541,6 +541,65 @@ class TestDiff(PyfitsTestCase):
             assert 'Data differs at [%d, 1]' % (y + 1) in report
         assert '100 different pixels found (100.00% different)' in report
 
+    def test_identical_files_datasum_shortcut(self):
+        """
+        Two files opened with checksum verification and carrying equal
+        DATASUMs should compare identical without their data even being
+        loaded.
+        """
+
+        a = np.arange(100).reshape((10, 10))
+        hdu = PrimaryHDU(data=a)
+        hdu.writeto(self.temp('testa.fits'), checksum=True)
+        hdu.writeto(self.temp('testb.fits'), checksum=True)
+
+        hdula = fits.open(self.temp('testa.fits'), checksum=True)
+        hdulb = fits.open(self.temp('testb.fits'), checksum=True)
+        try:
+            # The checksum card comments carry timestamps, so the checksum
+            # keywords themselves are excluded from the header comparison
+            diff = FITSDiff(hdula, hdulb,
+                            ignore_keywords=['CHECKSUM', 'DATASUM'])
+            assert diff.identical
+            # The data should not have been touched
+            assert not hdula[0]._data_loaded
+            assert not hdulb[0]._data_loaded
+        finally:
+            hdula.close()
+            hdulb.close()
+
+    def test_parallel_diff(self):
+        """
+        Comparing two multi-extension files across a worker pool should find
+        the same differences as the sequential comparison.
+        """
+
+        a = np.arange(100).reshape((10, 10))
+        hdula = HDUList([PrimaryHDU()] +
+                        [ImageHDU(data=a) for idx in range(8)])
+        hdulb = HDUList([PrimaryHDU()] +
+                        [ImageHDU(data=(a + (idx % 2))) for idx in range(8)])
+        hdula.writeto(self.temp('testa.fits'))
+        hdulb.writeto(self.temp('testb.fits'))
+
+        diff = FITSDiff(self.temp('testa.fits'), self.temp('testb.fits'),
+                        workers=4)
+        assert not diff.identical
+        # Even-numbered image extensions (odd idx) differ by one everywhere
+        assert [idx for idx, hdu_diff in diff.diff_hdus] == [2, 4, 6, 8]
+        for idx, hdu_diff in diff.diff_hdus:
+            assert hdu_diff.diff_data.diff_ratio == 1.0
+
+        # workers=0 means one worker per processor
+        diff = FITSDiff(self.temp('testa.fits'), self.temp('testb.fits'),
+                        workers=0)
+        assert [idx for idx, hdu_diff in diff.diff_hdus] == [2, 4, 6, 8]
+
+        # HDUList inputs fall back to the sequential path regardless of
+        # workers
+        diff = FITSDiff(hdula, hdulb, workers=4)
+        assert [idx for idx, hdu_diff in diff.diff_hdus] == [2, 4, 6, 8]
+
     def test_diff_nans(self):
         """Regression test for https://aeon.stsci.edu/ssb/trac/pyfits/ticket/204"""
 
@@ -198,3 +198,28 @@ class TestGroupsFunctions(PyfitsTestCase):
             assert x.dtype.names == ('abc', 'xyz', '_abc', 'DATA')
             assert x.par('abc')[0] == 5
             assert (x.par('abc')[1:] == pdata1[1:] * 2).all()
+
+    def test_duplicate_parameter_vector_cached(self):
+        """
+        The summed vector for duplicated parameter names is computed once and
+        cached on the `GroupData`; `Group.par` indexes into it, and `setpar`
+        invalidates it.
+        """
+
+        imdata = np.arange(100.0)
+        imdata.shape = (10, 1, 1, 2, 5)
+        pdata1 = np.arange(10, dtype=np.float32) + 1
+        x = fits.hdu.groups.GroupData(imdata, parnames=['abc', 'xyz', 'abc'],
+                                      pardata=[pdata1, 42.0, pdata1],
+                                      bitpix=-32)
+
+        first = x.par('abc')
+        # Same object on repeated access, and shared by row-level access
+        assert x.par('abc') is first
+        assert x[3].par('abc') == first[3]
+
+        x[3].setpar('abc', (20, 30))
+        summed = x.par('abc')
+        assert summed is not first
+        assert summed[3] == 50
+        assert (summed[:3] == pdata1[:3] * 2).all()
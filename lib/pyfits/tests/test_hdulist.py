@@ -9,6 +9,7 @@ import numpy as np
 from ..extern.six import BytesIO
 
 import pyfits as fits
+from ..file import _File
 from ..verify import VerifyError
 from . import PyfitsTestCase
 from .util import catch_warnings, ignore_warnings
@@ -543,13 +544,21 @@ class TestHDUListFunctions(PyfitsTestCase):
             idx += 1
         orig_header = hdu.header.copy()
         hdu.writeto(self.temp('temp.fits'))
+        orig_size = os.path.getsize(self.temp('temp.fits'))
 
         with fits.open(self.temp('temp.fits'), mode='update') as hdul:
             while len(str(hdul[0].header)) > 2880:
                 del hdul[0].header[-1]
 
+        # The shrunken header is padded back out to its original size with
+        # blank cards so that the rest of the file does not have to be
+        # rewritten
+        assert os.path.getsize(self.temp('temp.fits')) == orig_size
+
         with fits.open(self.temp('temp.fits')) as hdul:
-            assert hdul[0].header == orig_header[:-1]
+            ncards = len(orig_header) - 1
+            assert hdul[0].header[:ncards] == orig_header[:-1]
+            assert all(card.is_blank for card in hdul[0].header.cards[ncards:])
             assert (hdul[0].data == data).all()
 
         with fits.open(self.temp('temp.fits'), mode='update') as hdul:
@@ -598,6 +607,82 @@ class TestHDUListFunctions(PyfitsTestCase):
             assert (hdul[1].data == data2).all()
             assert (hdul[2].data == data2).all()
 
+    def test_update_header_slack_reuse(self):
+        """
+        Test that blank cards at the end of a header act as slack space,
+        allowing new keywords to be added in update mode without resizing the
+        header or rewriting the rest of the file.
+        """
+
+        hdu = fits.PrimaryHDU(data=np.arange(100))
+        for _ in range(36):
+            hdu.header.append()
+        hdu.writeto(self.temp('temp.fits'))
+        orig_size = os.path.getsize(self.temp('temp.fits'))
+
+        with fits.open(self.temp('temp.fits'), mode='update') as hdul:
+            nblanks = hdul[0].header._countblanks()
+            hdul[0].header['TEST'] = 1
+            assert not hdul._wasresized()
+
+        assert os.path.getsize(self.temp('temp.fits')) == orig_size
+
+        with fits.open(self.temp('temp.fits')) as hdul:
+            assert hdul[0].header['TEST'] == 1
+            assert hdul[0].header._countblanks() == nblanks - 1
+
+    def test_update_structural_change_in_place(self):
+        """
+        Removing, inserting, or replacing an HDU in update mode shifts only
+        the trailing bytes of the file in place instead of rewriting the
+        whole file; the result must be identical to a full rewrite.
+        """
+
+        from ..hdu.hdulist import HDUList
+
+        datas = [np.arange(n, dtype=np.int32) for n in (1000, 2000, 3000)]
+        hdul = fits.HDUList([fits.PrimaryHDU()] +
+                            [fits.ImageHDU(data) for data in datas])
+        hdul.writeto(self.temp('temp.fits'))
+
+        # Make sure the full-rewrite fallback is not silently taken
+        def fail_resize(self):
+            raise AssertionError('_flush_resize should not have been called')
+
+        orig_resize = HDUList._flush_resize
+        HDUList._flush_resize = fail_resize
+        try:
+            with fits.open(self.temp('temp.fits'), mode='update',
+                           memmap=False) as hdul:
+                del hdul[1]
+
+            with fits.open(self.temp('temp.fits')) as hdul:
+                assert len(hdul) == 3
+                assert (hdul[1].data == datas[1]).all()
+                assert (hdul[2].data == datas[2]).all()
+
+            with fits.open(self.temp('temp.fits'), mode='update',
+                           memmap=False) as hdul:
+                hdul.insert(1, fits.ImageHDU(datas[0]))
+
+            with fits.open(self.temp('temp.fits')) as hdul:
+                assert len(hdul) == 4
+                assert (hdul[1].data == datas[0]).all()
+                assert (hdul[3].data == datas[2]).all()
+
+            # A same-size replacement moves nothing at all
+            orig_size = os.path.getsize(self.temp('temp.fits'))
+            with fits.open(self.temp('temp.fits'), mode='update',
+                           memmap=False) as hdul:
+                hdul[2] = fits.ImageHDU(datas[1][::-1].copy())
+
+            assert os.path.getsize(self.temp('temp.fits')) == orig_size
+            with fits.open(self.temp('temp.fits')) as hdul:
+                assert (hdul[2].data == datas[1][::-1]).all()
+                assert (hdul[3].data == datas[2]).all()
+        finally:
+            HDUList._flush_resize = orig_resize
+
     def test_hdul_fromstring(self):
         """
         Test creating the HDUList structure in memory from a string containing
@@ -642,6 +727,34 @@ class TestHDUListFunctions(PyfitsTestCase):
         # Test that creating an HDUList from something silly raises a TypeError
         assert_raises(TypeError, fits.HDUList.fromstring, ['a', 'b', 'c'])
 
+    def test_hdul_fromstring_zero_copy(self):
+        """
+        HDUList.fromstring should reference the caller's buffer directly
+        rather than copying the remainder of the buffer for each HDU read
+        out of it; the HDUs' data arrays are then lazy views into that
+        buffer.
+        """
+
+        with open(self.data('test0.fits'), 'rb') as f:
+            dat = f.read()
+
+        hdul = fits.HDUList.fromstring(dat)
+
+        prev_end = 0
+        for hdu in hdul:
+            # Each HDU should know its absolute offset into the original
+            # buffer, and the HDUs should tile the buffer contiguously
+            assert hdu._header_offset == prev_end
+            assert hdu._data_offset >= hdu._header_offset
+            prev_end = hdu._data_offset + hdu._data_size
+
+        # Every HDU with a data section should hold a reference to the
+        # original buffer, not a copy of some slice of it
+        for hdu in hdul[1:]:
+            assert hdu._buffer is dat
+            # The data array should be a view over that same buffer
+            assert hdu.data.base is not None
+
     def test_save_backup(self):
         """Test for https://aeon.stsci.edu/ssb/trac/pyfits/ticket/121
 
@@ -755,3 +868,57 @@ class TestHDUListFunctions(PyfitsTestCase):
 
             # Finally, without mmaping B
             test(True, False)
+
+    def test_writeto_pipelined_multi_hdu(self):
+        """
+        Writing a multi-extension HDUList goes through the pipelined write
+        path; the result must be identical to writing the HDUs serially,
+        including with checksums enabled, and preparation errors on worker
+        threads must propagate to the caller.
+        """
+
+        def build():
+            hdus = [fits.PrimaryHDU()]
+            for idx in range(10):
+                hdu = fits.ImageHDU(np.arange(100) + idx)
+                hdu.header['EXTIDX'] = idx
+                hdus.append(hdu)
+            return fits.HDUList(hdus)
+
+        build().writeto(self.temp('pipelined.fits'), checksum=True)
+
+        # Write the same HDUs through the serial loop for comparison
+        hdul = build()
+        ffo = _File(self.temp('serial.fits'), mode='ostream')
+        for hdu in hdul:
+            hdu._prewriteto(checksum=True)
+            try:
+                hdu._writeto(ffo)
+            finally:
+                hdu._postwriteto()
+        ffo.close()
+
+        with open(self.temp('pipelined.fits'), 'rb') as f1:
+            with open(self.temp('serial.fits'), 'rb') as f2:
+                assert f1.read() == f2.read()
+
+        with fits.open(self.temp('pipelined.fits'), checksum=True) as hdul:
+            assert len(hdul) == 11
+            for idx in range(10):
+                assert hdul[idx + 1].header['EXTIDX'] == idx
+                assert np.all(hdul[idx + 1].data == np.arange(100) + idx)
+
+        # An exception raised while preparing an HDU on a worker thread is
+        # re-raised from writeto
+        hdul = build()
+
+        def bad_prewriteto(checksum=False, inplace=False):
+            raise ValueError('preparation failed')
+
+        hdul[5]._prewriteto = bad_prewriteto
+        try:
+            hdul.writeto(self.temp('error.fits'))
+        except ValueError:
+            pass
+        else:
+            assert False, 'expected the preparation error to propagate'
@@ -274,6 +274,51 @@ class TestHeaderFunctions(PyfitsTestCase):
                 str(c) != "ABC     = (1.2345377437887E+088, 6.3247673647637E-015)                          "):
             assert str(c) == "ABC     = (1.23453774378878E+88, 6.32476736476374E-15)                          "
 
+    def test_fixed_format_value_fast_parse(self):
+        """
+        The fast scanner for fixed-format values must return the same value,
+        valuestring, and comment as the full value regex for representative
+        card images, and leave non-trivial values to the regex.
+        """
+
+        images = [
+            "SIMPLE  =                    T / conforms to FITS standard",
+            "BITPIX  =                    8 / array data type",
+            "BSCALE  =                  2.0",
+            "CRVAL1  =         -1.23456E-05 / wcs",
+            "EXPTIME =               0123.5 / leading zero",
+            "OBJECT  = 'NGC 1234'           / target name",
+            "INSTRUME= 'WFPC2   '",
+            "BLANKVAL=                      / undefined value",
+            "QUOTED  = 'it''s   '           / escaped quote",
+            "CPLX    = (1.0, 2.5)           / complex value",
+            "DEXP    =               1.5D03 / fortran exponent",
+        ]
+
+        def parse(image):
+            c = fits.Card.fromstring(image)
+            return (c.value, c._valuestring, c.comment)
+
+        fast_results = [parse(image) for image in images]
+        fast_parse = fits.Card._parse_value_fast.__func__
+        fits.Card._parse_value_fast = classmethod(lambda cls, vc: None)
+        try:
+            regex_results = [parse(image) for image in images]
+        finally:
+            fits.Card._parse_value_fast = classmethod(fast_parse)
+
+        assert fast_results == regex_results
+
+        # Values the fast scanner should decline (handled by the regex)
+        assert fits.Card._parse_value_fast('(1.0, 2.5) / cplx') is None
+        assert fits.Card._parse_value_fast("'it''s' / escaped") is None
+        assert fits.Card._parse_value_fast('1.5D03 / fortran exp') is None
+        # ...and a few it should handle directly
+        assert fits.Card._parse_value_fast('   T / flag') == (True, 'T')
+        assert fits.Card._parse_value_fast('  123 / num') == (123, '123 ')
+        assert (fits.Card._parse_value_fast("'abc  ' / str") ==
+                ('abc  ', "'abc  '"))
+
     def test_card_image_constructed_too_long(self):
         """Test that over-long cards truncate the comment"""
 
@@ -427,6 +472,38 @@ class TestHeaderFunctions(PyfitsTestCase):
             assert fix_text in str(w[1].message)
         assert str(c) == "ABC     = 'a6      '                                                            "
 
+    def test_batched_card_verification(self):
+        """
+        `Card._image_is_standard` must accept only card images that
+        `Card._verify` finds fully standard, and `Header._verify_cards` must
+        still report errors for cards the fast check rejects.
+        """
+
+        pad = lambda s: s + ' ' * (80 - len(s))
+        standard = [
+            pad("SIMPLE  =                    T / conforms to FITS standard"),
+            pad("OBJECT  = 'M101    '           / target"),
+            pad("EXPTIME =                 32.5"),
+            pad("COMMENT this is a comment"),
+            pad("        blank-keyword commentary"),
+        ]
+        nonstandard = [
+            pad("object  = 'M101    '"),        # lowercase keyword
+            pad("NAXIS=                      0"),  # equal sign at wrong column
+            pad("FOO     =  not_a_value"),
+        ]
+        for image in standard:
+            assert fits.Card._image_is_standard(image)
+            assert not fits.Card.fromstring(image)._verify('ignore')
+        for image in nonstandard:
+            assert not fits.Card._image_is_standard(image)
+
+        header = fits.Header.fromstring(''.join(standard + nonstandard[:1]))
+        errs = [e for e in header._verify_cards('ignore') if e]
+        assert len(errs) == 1
+        # The standard cards were marked verified by the fast pass
+        assert all(c._verified for c in header.cards)
+
     def test_long_string_value(self):
         # test long string value
         c = fits.Card('abc', 'long string value ' * 10, 'long comment ' * 10)
@@ -538,6 +615,31 @@ class TestHeaderFunctions(PyfitsTestCase):
                 "CONTINUE  'ampersand at the endcontinue must have string value (with quotes)&'  "
                 "CONTINUE  '&' / comments in line 1 comments with ''.                            ")
 
+    def test_continue_card_single_pass_parse(self):
+        """
+        The value and comment of a card spread over CONTINUE cards are
+        assembled in a single pass; accessing either one caches both, and the
+        result does not depend on which is accessed first.
+        """
+
+        image = (
+            _pad("STRKEY  = 'This is a very long value &'") +
+            _pad("CONTINUE  'spread over cards.&'") +
+            _pad("CONTINUE  '&' / first comment part") +
+            _pad("CONTINUE  '&' / second comment part"))
+
+        c = fits.Card.fromstring(image)
+        assert c.value == 'This is a very long value spread over cards.'
+        # The comment was cached by the value parse
+        assert c._comment == 'first comment part second comment part'
+        assert c.comment == c._comment
+
+        c = fits.Card.fromstring(image)
+        assert c.comment == 'first comment part second comment part'
+        # Likewise the value was cached by the comment parse
+        assert c._value == 'This is a very long value spread over cards.'
+        assert c.value == c._value
+
     def test_continue_card_with_equals_in_value(self):
         """
         Regression test for https://aeon.stsci.edu/ssb/trac/pyfits/ticket/117
@@ -1489,6 +1591,25 @@ class TestHeaderFunctions(PyfitsTestCase):
         assert 'END' not in new_header
         assert header == new_header
 
+    def test_header_fromstring_sep_continue_cards(self):
+        """
+        Parsing a separator-delimited header string must reassemble
+        long-string (CONTINUE) cards, with or without a trailing separator
+        or an END card.
+        """
+
+        header = fits.Header()
+        header['A'] = ('B', 'C')
+        header['LONG'] = 'calibration frame ' * 10
+        header['D'] = ('E', 'F')
+
+        hstr = header.tostring(sep='\n', endcard=False, padding=False)
+        for variant in (hstr, hstr + '\n', hstr + '\nEND', hstr + '\nEND\n'):
+            header2 = fits.Header.fromstring(variant, sep='\n')
+            assert 'END' not in header2
+            assert header == header2
+            assert header2['LONG'] == header['LONG']
+
     def test_append_end_card(self):
         """
         Regression test 2 for https://aeon.stsci.edu/ssb/trac/pyfits/ticket/154
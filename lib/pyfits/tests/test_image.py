@@ -812,6 +812,7 @@ class TestCompressedImage(PyfitsTestCase):
         argslist = [
             (np.zeros((2, 10, 10), dtype=np.float32), 'RICE_1', 16),
             (np.zeros((2, 10, 10), dtype=np.float32), 'GZIP_1', -0.01),
+            (np.zeros((2, 10, 10), dtype=np.float32), 'GZIP_2', -0.01),
             (np.zeros((100, 100)) + 1, 'HCOMPRESS_1', 16)
         ]
 
@@ -838,6 +839,56 @@ class TestCompressedImage(PyfitsTestCase):
             assert fd[1].header['NAXIS2'] == chdu.header['NAXIS2']
             assert fd[1].header['BITPIX'] == chdu.header['BITPIX']
 
+    def test_comp_image_auto_tuning(self):
+        """
+        Test that compression_type='auto' picks a concrete algorithm and
+        tile size and that the compressed image still round trips.
+        """
+
+        data = np.arange(40000, dtype=np.int16).reshape((200, 200))
+        chdu = fits.CompImageHDU(data, compression_type='auto')
+        assert chdu._header['ZCMPTYPE'] in ('RICE_1', 'GZIP_1', 'PLIO_1')
+        chdu.writeto(self.temp('test_auto.fits'))
+        with fits.open(self.temp('test_auto.fits')) as fd:
+            assert (fd[1].data == data).all()
+
+        # Floating point data selects from the float candidates
+        fdata = np.random.normal(size=(200, 200)).astype(np.float32)
+        chdu = fits.CompImageHDU(fdata, compression_type='auto')
+        assert chdu._header['ZCMPTYPE'] in ('RICE_1', 'GZIP_2',
+                                            'HCOMPRESS_1')
+
+    def test_comp_image_streaming(self):
+        data = np.arange(400, dtype=np.int16).reshape((20, 20))
+        header = fits.ImageHDU(data=data).header
+
+        shdu = fits.CompImageStreamingHDU(self.temp('test.fits'), header,
+                                          compression_type='RICE_1')
+        for idx in range(0, 20, 5):
+            complete = shdu.write(data[idx:idx + 5])
+        shdu.close()
+        assert complete
+
+        with fits.open(self.temp('test.fits')) as hdul:
+            assert isinstance(hdul[1], fits.CompImageHDU)
+            assert (hdul[1].data == data).all()
+
+    def test_comp_image_section(self):
+        cube = np.arange(300, dtype=np.int32).reshape((3, 10, 10))
+        hdu = fits.CompImageHDU(data=cube, name='SCI',
+                                compression_type='RICE_1', tile_size=[5, 2, 1])
+        hdu.writeto(self.temp('test.fits'))
+
+        with fits.open(self.temp('test.fits')) as hdul:
+            section = hdul[1].section
+            assert (section[:, :, :] == cube).all()
+            assert (section[1] == cube[1]).all()
+            assert (section[0, 3:9, 2:7] == cube[0, 3:9, 2:7]).all()
+            assert (section[:, ::2, ::3] == cube[:, ::2, ::3]).all()
+            assert section[2, 5, 5] == cube[2, 5, 5]
+            assert_raises(IndexError, lambda: section[0, 0, 0, 0])
+            assert_raises(IndexError, lambda: section[3])
+
     @ignore_warnings(PyfitsPendingDeprecationWarning)
     def test_comp_image_hcompression_1_invalid_data(self):
         """
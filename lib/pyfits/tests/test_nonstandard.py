@@ -63,3 +63,24 @@ class TestNonstandardHdus(PyfitsTestCase):
         assert (hdul[2].data == wrapped[2].data).all()
         assert (hdul[3].data == wrapped[3].data).all()
         assert (hdul[4].data == wrapped[4].data).all()
+
+    def test_fitshdu_uncompressed_parsed_in_place(self):
+        """
+        An uncompressed embedded FITS file is parsed from the enclosing
+        file's buffer rather than copied through a BytesIO; its data must
+        still round-trip exactly.
+        """
+
+        a = np.arange(100)
+        hdul = fits.HDUList([fits.PrimaryHDU(data=a),
+                             fits.ImageHDU(data=a + 1)])
+        hdul.writeto(self.temp('test.fits'))
+
+        fitshdu = fits.FitsHDU.fromfile(self.temp('test.fits'))
+        wrapped = fitshdu.hdulist
+        # Parsed from an in-memory buffer; there is no separate file object
+        # behind the embedded HDUs
+        assert wrapped[0]._file is None
+        assert wrapped[0]._buffer is not None
+        assert (wrapped[0].data == a).all()
+        assert (wrapped[1].data == a + 1).all()
@@ -1904,6 +1904,35 @@ class TestTableFunctions(PyfitsTestCase):
         assert comparerecords(tbhdu.data, new_tbhdu.data)
         assert str(tbhdu.header) == str(new_tbhdu.header)
 
+    def test_dump_load_chunked(self):
+        """
+        Test that the chunked dump/load paths give the same results when the
+        table spans multiple chunks; the chunk size is shrunk so that a small
+        table exercises the chunk boundaries.
+        """
+
+        from ..hdu import table as table_mod
+
+        data = np.rec.array([('a', [1, 2, 3, 4], 0.1),
+                             ('bcd', [5, 6, 7, 8], 0.2),
+                             ('e', [9, 10, 11, 12], 0.3),
+                             ('fg', [13, 14, 15, 16], 0.4),
+                             ('h', [17, 18, 19, 20], 0.5)],
+                            formats='a3,4i4,f8')
+        tbhdu = fits.BinTableHDU.from_columns(data)
+        datafile = self.temp('data.txt')
+        cdfile = self.temp('coldefs.txt')
+
+        old_chunk_rows = table_mod._DUMP_CHUNK_ROWS
+        table_mod._DUMP_CHUNK_ROWS = 2
+        try:
+            tbhdu.dump(datafile, cdfile)
+            new_tbhdu = fits.BinTableHDU.load(datafile, cdfile)
+        finally:
+            table_mod._DUMP_CHUNK_ROWS = old_chunk_rows
+
+        assert comparerecords(tbhdu.data, new_tbhdu.data)
+
     def test_load_guess_format(self):
         """
         Tests loading a table dump with no supplied coldefs or header, so that
@@ -2173,6 +2202,92 @@ class TestTableFunctions(PyfitsTestCase):
                 assert comparerecords(zwc_pl, zwc[2].data)
 
 
+    def test_native_table_byteorder_mode(self):
+        """
+        With `pyfits.NATIVE_TABLE_BYTEORDER` enabled, binary table data is
+        byteswapped to native byte order once at load; column values and
+        written files must be identical to the default big-endian mode.
+        """
+
+        counts = np.array([312, 334, 308, 317], dtype=np.int32)
+        names = np.array(['NGC1', 'NGC2', 'NGC3', 'NCG4'])
+        c1 = fits.Column(name='target', format='10A', array=names)
+        c2 = fits.Column(name='counts', format='J', unit='DN', array=counts)
+        c3 = fits.Column(name='flux', format='E',
+                         array=np.array(counts, dtype=np.float32) / 10)
+        tbhdu = fits.new_table([c1, c2, c3])
+        tbhdu.writeto(self.temp('table.fits'))
+
+        with fits.open(self.temp('table.fits')) as hdul:
+            default_data = hdul[1].data.copy()
+
+        fits.NATIVE_TABLE_BYTEORDER = True
+        try:
+            with fits.open(self.temp('table.fits')) as hdul:
+                data = hdul[1].data
+                if sys.byteorder == 'little':
+                    for name in ('counts', 'flux'):
+                        assert data[name].dtype.isnative
+                assert comparerecords(data, default_data)
+                hdul.writeto(self.temp('rewritten.fits'))
+
+            # The data written back out must still be big-endian FITS
+            with open(self.temp('table.fits'), 'rb') as f1:
+                with open(self.temp('rewritten.fits'), 'rb') as f2:
+                    assert f1.read() == f2.read()
+
+            # VLA columns are excluded from the native mode; reading such a
+            # table must still resolve the heap correctly
+            col = fits.Column(name='var', format='PJ()',
+                              array=[[45, 56], [11, 12, 13]])
+            fits.BinTableHDU.from_columns([col]).writeto(self.temp('vla.fits'))
+            with fits.open(self.temp('vla.fits')) as hdul:
+                assert list(hdul[1].data['var'][1]) == [11, 12, 13]
+        finally:
+            fits.NATIVE_TABLE_BYTEORDER = False
+
+    def test_column_index_lookup(self):
+        """
+        `BinTableHDU.build_index`/`lookup` must return the same rows as a
+        full scan, and an index persisted with `index_extension` must be
+        restorable with `load_index` after reopening the file.
+        """
+
+        counts = np.array([312, 334, 308, 317, 334], dtype=np.int32)
+        names = np.array(['NGC1', 'NGC2', 'NGC3', 'NCG4', 'NGC5'])
+        c1 = fits.Column(name='target', format='10A', array=names)
+        c2 = fits.Column(name='counts', format='J', array=counts)
+        tbhdu = fits.BinTableHDU.from_columns([c1, c2])
+
+        # Exact and range lookups against a brute-force scan
+        assert list(tbhdu.lookup('counts', 334)) == [1, 4]
+        assert list(tbhdu.lookup('counts', 999)) == []
+        expected = np.nonzero((counts >= 310) & (counts <= 320))[0]
+        assert list(tbhdu.lookup('counts', 310, 320)) == list(expected)
+        # Column number and string columns work too
+        assert list(tbhdu.lookup(0, 'NGC3')) == [2]
+
+        # Persist the index alongside the table and restore it on reopen
+        idxhdu = tbhdu.index_extension('counts')
+        assert idxhdu.header['IDXCOL'] == 'counts'
+        fits.HDUList([fits.PrimaryHDU(), tbhdu,
+                      idxhdu]).writeto(self.temp('indexed.fits'))
+
+        with fits.open(self.temp('indexed.fits')) as hdul:
+            table = hdul[1]
+            table.load_index(hdul['PYFITS_INDEX'])
+            assert 'counts' in table._column_indexes
+            assert list(table.lookup('counts', 334)) == [1, 4]
+            # A stale index (built against a different row count) is refused
+            hdul['PYFITS_INDEX'].header['IDXROWS'] = 3
+            try:
+                table.load_index(hdul['PYFITS_INDEX'])
+            except ValueError:
+                pass
+            else:
+                assert False, 'load_index accepted a stale index'
+
+
 class TestVLATables(PyfitsTestCase):
     """Tests specific to tables containing variable-length arrays."""
 
@@ -2434,6 +2549,48 @@ class TestColumnFunctions(PyfitsTestCase):
         c = fits.Column('TEST', 'D', ascii=True)
         assert c.format == 'D25.17'
 
+    def test_tform_parse_memoized(self):
+        """
+        Repeated TFORM parsing is served from the module-level memo caches,
+        and same-layout tables reuse verified column keywords; results must
+        be indistinguishable from uncached parsing.
+        """
+
+        from .. import column
+
+        column._parse_tformat_cache.clear()
+        column._convert_format_cache.clear()
+        assert column._parse_tformat('10A') == (10, 'A', '')
+        assert '10A' in column._parse_tformat_cache
+        assert (column._parse_tformat('10A') is
+                column._parse_tformat_cache['10A'])
+        assert column._convert_format('J') == 'i4'
+        assert ('J', False) in column._convert_format_cache
+        column._parse_tdim_cache.clear()
+        assert column._parse_tdim('(2,3)') == (3, 2)
+        assert (column._parse_tdim('(2,3)') is
+                column._parse_tdim_cache['(2,3)'])
+        # Invalid formats still raise and are not cached
+        assert_raises(VerifyError, column._parse_tformat, 'FOO')
+        assert 'FOO' not in column._parse_tformat_cache
+
+        counts = np.array([312, 334, 308], dtype=np.int32)
+        c1 = fits.Column(name='target', format='10A',
+                         array=np.array(['NGC1', 'NGC2', 'NGC3']))
+        c2 = fits.Column(name='counts', format='J', unit='DN', array=counts)
+        fits.BinTableHDU.from_columns([c1, c2]).writeto(self.temp('t.fits'))
+
+        column._coldefs_keywords_cache.clear()
+        with fits.open(self.temp('t.fits')) as hdul:
+            first = hdul[1].data.copy()
+        assert len(column._coldefs_keywords_cache) == 1
+        with fits.open(self.temp('t.fits')) as hdul:
+            # Second open of the same layout hits the cache
+            assert len(column._coldefs_keywords_cache) == 1
+            assert hdul[1].columns.names == ['target', 'counts']
+            assert hdul[1].columns[1].unit == 'DN'
+            assert comparerecords(hdul[1].data, first)
+
     def test_column_array_type_mismatch(self):
         """Regression test for https://aeon.stsci.edu/ssb/trac/pyfits/ticket/218"""
 
@@ -61,6 +61,35 @@ class TestUintFunctions(PyfitsTestCase):
                         assert sec.dtype.name == 'uint%s' % bits
                         assert (sec == d1[:1]).all()
 
+    def test_uint_conversion_no_aliasing(self):
+        """
+        Reading pseudo-unsigned data must not modify the underlying mmap'd
+        file or ``fromstring`` buffer, even though the conversion is done by
+        flipping the sign bit of the raw data in place where possible.
+        """
+
+        hdu = fits.PrimaryHDU(np.array([-3, -2, -1, 0, 1, 2, 3]))
+        hdu.scale('int16', '', bzero=2 ** 15)
+        with ignore_warnings():
+            hdu.writeto(self.temp('tempfile.fits'), clobber=True)
+
+        expected = np.array([2 ** 16 - 3, 2 ** 16 - 2, 2 ** 16 - 1,
+                             0, 1, 2, 3], dtype=np.uint16)
+
+        with fits.open(self.temp('tempfile.fits'), uint=True,
+                       memmap=True) as hdul:
+            assert (hdul[0].data == expected).all()
+
+        with open(self.temp('tempfile.fits'), 'rb') as f:
+            buf = f.read()
+
+        # Reading from the same buffer twice must give the same physical
+        # values; if the conversion clobbered the raw bytes the second read
+        # would come out shifted by BZERO
+        for _ in range(2):
+            hdul = fits.HDUList.fromstring(buf, uint=True)
+            assert (hdul[0].data == expected).all()
+
     def test_uint_columns(self):
         """Test basic functionality of tables with columns containing
         pseudo-unsigned integers.  See
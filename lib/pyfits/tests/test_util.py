@@ -8,12 +8,42 @@ import sys
 import nose
 from nose.tools import assert_raises
 
-from ..util import ignore_sigint
+import numpy as np
+
+from ..extern.six import BytesIO
+from ..util import ignore_sigint, _array_from_file
 from . import PyfitsTestCase
 from .util import catch_warnings
 
 
 class TestUtils(PyfitsTestCase):
+    def test_array_from_file_readinto(self):
+        """
+        Test that _array_from_file fills a preallocated array directly from
+        file-like objects that support readinto, with the same results as
+        the read + fromstring fallback.
+        """
+
+        raw = np.arange(100, dtype='>i4').tostring()
+        arr = _array_from_file(BytesIO(raw), np.dtype('>i4'), 100, '')
+        assert arr.dtype == np.dtype('>i4')
+        assert (arr == np.arange(100)).all()
+
+        # A file-like object without readinto takes the fallback path
+        class ReadOnly(object):
+            def __init__(self, buf):
+                self._buf = buf
+
+            def read(self, size=None):
+                return self._buf
+
+        arr2 = _array_from_file(ReadOnly(raw), np.dtype('>i4'), 100, '')
+        assert (arr2 == arr).all()
+
+        # Truncated input is an error, as with fromstring
+        assert_raises(ValueError, _array_from_file, BytesIO(raw[:-1]),
+                      np.dtype('>i4'), 100, '')
+
     def test_ignore_sigint(self):
         if sys.platform.startswith('win'):
             # Not available in some Python versions on Windows
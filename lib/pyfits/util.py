@@ -755,7 +755,31 @@ def _array_from_file(infile, dtype, count, sep):
         # treat as file-like object with "read" method; this includes gzip file
         # objects, because numpy.fromfile just reads the compressed bytes from
         # their underlying file object, instead of the decompresed bytes
-        read_size = np.dtype(dtype).itemsize * count
+        dtype = np.dtype(dtype)
+        read_size = dtype.itemsize * count
+        if not sep and hasattr(infile, 'readinto'):
+            # Allocate the destination array up front and let the file object
+            # fill it directly, avoiding the intermediate bytes object (a
+            # full extra copy of the data unit) that read + fromstring costs
+            data = np.empty(count, dtype=dtype)
+            buf = data.view(np.uint8)
+            nread = 0
+            try:
+                while nread < read_size:
+                    nbytes = infile.readinto(buf[nread:])
+                    if not nbytes:
+                        break
+                    nread += nbytes
+            except TypeError:
+                # This file object's readinto does not accept an ndarray as
+                # a buffer; fall back on read + fromstring below
+                if nread:
+                    raise
+            else:
+                if nread != read_size:
+                    raise ValueError('found %d bytes in the file where %d '
+                                     'were expected' % (nread, read_size))
+                return data
         s = infile.read(read_size)
         return np.fromstring(s, dtype=dtype, count=count, sep=sep)
 
@@ -852,6 +876,36 @@ def _is_pseudo_unsigned(dtype):
     return dtype.kind == 'u' and dtype.itemsize >= 2
 
 
+def _pseudo_unsigned_values(array, dtype):
+    """
+    Convert raw FITS signed integer data stored with
+    ``BZERO = 2 ** (bits - 1)`` to its unsigned physical values, as an array
+    of the given unsigned dtype.
+
+    For that value of BZERO the unsigned physical value differs from the raw
+    two's-complement bit pattern only in its most significant bit, so rather
+    than casting to a new unsigned array and then adding BZERO (which keeps
+    two full-size buffers alive at once) this reinterprets the raw bytes as
+    unsigned and flips the sign bit in place.  An array that owns its data is
+    converted without any new allocation; a view (e.g. of an mmap'd file or
+    an `HDUList.fromstring` buffer, which must not be modified) is copied
+    exactly once, combining the copy with the byte order conversion.
+    """
+
+    inplace = array.flags.owndata
+    array = array.view(dtype.newbyteorder(array.dtype.byteorder))
+    if inplace:
+        if not array.dtype.isnative:
+            array.byteswap(True)
+            array = array.view(array.dtype.newbyteorder('='))
+    else:
+        # np.array and not np.asarray, since on a big-endian host the raw
+        # byte order is already native and no copy would be made
+        array = np.array(array, dtype=dtype)
+    array ^= dtype.type(_unsigned_zero(dtype))
+    return array
+
+
 def _is_int(val):
     return isinstance(val, integer_types + (np.integer,))
 
@@ -0,0 +1,417 @@
+/* $Id$
+*/
+
+/* "asciitable" module */
+
+/*****************************************************************************/
+/*                                                                           */
+/* The asciitable module is a small C accelerator used by                    */
+/* pyfits.FITS_rec._convert_ascii when converting the numeric columns of an  */
+/* ASCII table from their fixed-width string representation to a numeric     */
+/* array.  The pure Python conversion goes through several full-column       */
+/* chararray passes (justification, 'D' exponent replacement, null value     */
+/* substitution) before numpy parses the strings, which dominates the time   */
+/* spent reading large ASCII tables.  This module parses every cell of a     */
+/* column in a single pass.                                                  */
+/*                                                                           */
+/* The function parse_numeric_column(data, itemsize, format, nullval,       */
+/* tnull) takes the raw bytes of the column (one fixed-width cell of         */
+/* itemsize bytes per row), the target format as one of the numpy type       */
+/* strings 'i4', 'i8', 'f4' or 'f8', the encoded TNULL string, and the       */
+/* numeric value to substitute for null cells.  It returns the parsed        */
+/* column as a string of native-order binary values for the caller to view   */
+/* with numpy.fromstring, or None for formats it does not handle, in which   */
+/* case the caller should fall back to the pure Python implementation.  The  */
+/* semantics deliberately match the Python path: cells are stripped of       */
+/* whitespace, cells equal to the stripped TNULL string become tnull, 'D'    */
+/* and 'd' exponent separators are accepted, and an unparseable cell raises  */
+/* ValueError.                                                               */
+/*                                                                           */
+/* The inverse function format_numeric_column(values, kind, fmt, cellsize,  */
+/* maxlen, span) is used by FITS_rec._scale_back to render a numeric column */
+/* back into its fixed-width string cells.  values holds native int64 or    */
+/* float64 binary values (kind 'i' or 'f'), fmt is the printf-style format  */
+/* built by _scale_back (including any trailing spaces), and each formatted */
+/* value is written into a cellsize-byte cell, padded with NULs exactly as  */
+/* assigning a short string to a numpy 'S' array would.  A value that       */
+/* formats longer than maxlen raises the same ValueError as the Python      */
+/* loop; a format string this module cannot validate returns None for       */
+/* fallback.                                                                */
+/*                                                                           */
+/*****************************************************************************/
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Python.h>
+
+#if PY_MAJOR_VERSION >= 3
+#define IS_PY3K
+#endif
+
+#ifdef IS_PY3K
+#define PyString_Check PyBytes_Check
+#define PyString_AS_STRING PyBytes_AS_STRING
+#define PyString_GET_SIZE PyBytes_GET_SIZE
+#define PyString_FromStringAndSize PyBytes_FromStringAndSize
+#endif
+
+#if defined(_MSC_VER) && (_MSC_VER < 1800)
+#define strtoll _strtoi64
+#endif
+
+/* Output element types, keyed by the numpy format strings this module
+   understands (see pyfits.column.ASCII2NUMPY). */
+typedef enum {
+    FMT_INT32,
+    FMT_INT64,
+    FMT_FLOAT32,
+    FMT_FLOAT64,
+    FMT_UNKNOWN
+} col_format;
+
+
+static col_format parse_format(const char* format)
+{
+    if (strcmp(format, "i4") == 0) {
+        return FMT_INT32;
+    } else if (strcmp(format, "i8") == 0) {
+        return FMT_INT64;
+    } else if (strcmp(format, "f4") == 0) {
+        return FMT_FLOAT32;
+    } else if (strcmp(format, "f8") == 0) {
+        return FMT_FLOAT64;
+    }
+    return FMT_UNKNOWN;
+}
+
+
+/* Strip leading and trailing whitespace from a cell in place (by adjusting
+   the start pointer and size); mirrors str.strip on the Python side. */
+static const char* strip_cell(const char* cell, Py_ssize_t* size)
+{
+    while (*size > 0 && isspace((unsigned char)cell[0])) {
+        cell++;
+        (*size)--;
+    }
+    while (*size > 0 && isspace((unsigned char)cell[*size - 1])) {
+        (*size)--;
+    }
+    return cell;
+}
+
+
+static PyObject* asciitable_parse_numeric_column(PyObject* self,
+                                                 PyObject* args)
+{
+    PyObject* dataobj;
+    PyObject* nullobj;
+    PyObject* result;
+    const char* data;
+    const char* nullval;
+    const char* cell;
+    char* buf;
+    char* out;
+    char* endptr;
+    Py_ssize_t datalen;
+    Py_ssize_t nulllen;
+    Py_ssize_t cellsize;
+    Py_ssize_t nrows;
+    Py_ssize_t row;
+    Py_ssize_t idx;
+    Py_ssize_t outsize;
+    int itemsize;
+    int isnull;
+    const char* format;
+    col_format fmt;
+    double tnull;
+    double fval;
+    long long ival;
+
+    if (!PyArg_ParseTuple(args, "OisOd:parse_numeric_column", &dataobj,
+                          &itemsize, &format, &nullobj, &tnull)) {
+        return NULL;
+    }
+
+    if (!PyString_Check(dataobj) || !PyString_Check(nullobj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "column data and null value must be byte strings");
+        return NULL;
+    }
+
+    fmt = parse_format(format);
+    if (fmt == FMT_UNKNOWN) {
+        /* Not a numeric format this module handles; let the Python
+           implementation take over. */
+        Py_RETURN_NONE;
+    }
+
+    data = PyString_AS_STRING(dataobj);
+    datalen = PyString_GET_SIZE(dataobj);
+    nullval = PyString_AS_STRING(nullobj);
+    nulllen = PyString_GET_SIZE(nullobj);
+
+    if (itemsize <= 0 || datalen % itemsize != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "column data size is not a multiple of the cell size");
+        return NULL;
+    }
+    nrows = datalen / itemsize;
+    outsize = (fmt == FMT_INT32 || fmt == FMT_FLOAT32) ? 4 : 8;
+
+    result = PyString_FromStringAndSize(NULL, nrows * outsize);
+    if (result == NULL) {
+        return NULL;
+    }
+    out = PyString_AS_STRING(result);
+
+    /* Scratch buffer for one NUL-terminated cell with 'D' exponents
+       rewritten for strtod/strtoll */
+    buf = PyMem_Malloc(itemsize + 1);
+    if (buf == NULL) {
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+
+    for (row = 0; row < nrows; row++) {
+        cellsize = itemsize;
+        cell = strip_cell(data + row * itemsize, &cellsize);
+
+        isnull = (cellsize == nulllen &&
+                  memcmp(cell, nullval, cellsize) == 0);
+
+        fval = 0.0;
+        ival = 0;
+        if (isnull) {
+            fval = tnull;
+            ival = (long long)tnull;
+        } else {
+            for (idx = 0; idx < cellsize; idx++) {
+                if (cell[idx] == 'D' || cell[idx] == 'd') {
+                    buf[idx] = 'E';
+                } else {
+                    buf[idx] = cell[idx];
+                }
+            }
+            buf[cellsize] = '\0';
+
+            /* Out-of-range integers are rejected like any other bad cell;
+               out-of-range floats are left to strtod's overflow-to-inf and
+               underflow-to-zero behavior, which is what the Python parser
+               produces as well. */
+            errno = 0;
+            if (fmt == FMT_INT32 || fmt == FMT_INT64) {
+                ival = strtoll(buf, &endptr, 10);
+                if (errno == ERANGE ||
+                        (fmt == FMT_INT32 &&
+                         (ival < -2147483647LL - 1 || ival > 2147483647LL))) {
+                    endptr = buf;
+                }
+            } else {
+                fval = strtod(buf, &endptr);
+            }
+
+            if (cellsize == 0 || endptr != buf + cellsize) {
+                PyErr_Format(PyExc_ValueError,
+                             "invalid literal %.80s for column element %ld",
+                             buf, (long)row);
+                PyMem_Free(buf);
+                Py_DECREF(result);
+                return NULL;
+            }
+        }
+
+        switch (fmt) {
+            case FMT_INT32:
+                *(int*)(out + row * outsize) = (int)ival;
+                break;
+            case FMT_INT64:
+                *(long long*)(out + row * outsize) = ival;
+                break;
+            case FMT_FLOAT32:
+                *(float*)(out + row * outsize) = (float)fval;
+                break;
+            default:
+                *(double*)(out + row * outsize) = fval;
+                break;
+        }
+    }
+
+    PyMem_Free(buf);
+    return result;
+}
+
+
+/* Check that fmt is a single printf conversion, optionally followed by
+   trailing spaces, and copy it to locfmt (a buffer of at least fmtlen + 3
+   characters) with "ll" inserted before a 'd' conversion so it can be used
+   with a long long argument.  Returns the conversion character, or 0 if the
+   format cannot be validated. */
+static char prepare_format(const char* fmt, char* locfmt)
+{
+    const char* p = fmt;
+    char* q = locfmt;
+    char conv;
+
+    if (*p != '%') {
+        return 0;
+    }
+    *q++ = *p++;
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '0' || *p == '#') {
+        *q++ = *p++;
+    }
+    while (isdigit((unsigned char)*p)) {
+        *q++ = *p++;
+    }
+    if (*p == '.') {
+        *q++ = *p++;
+        while (isdigit((unsigned char)*p)) {
+            *q++ = *p++;
+        }
+    }
+
+    conv = *p;
+    if (conv == 'd') {
+        *q++ = 'l';
+        *q++ = 'l';
+    } else if (conv != 'f' && conv != 'e' && conv != 'E' && conv != 'g' &&
+               conv != 'G') {
+        return 0;
+    }
+    *q++ = *p++;
+
+    /* Only trailing spaces (inter-column padding) may follow */
+    while (*p == ' ') {
+        *q++ = *p++;
+    }
+    if (*p != '\0') {
+        return 0;
+    }
+    *q = '\0';
+    return conv;
+}
+
+
+static PyObject* asciitable_format_numeric_column(PyObject* self,
+                                                  PyObject* args)
+{
+    PyObject* valsobj;
+    PyObject* result;
+    const char* vals;
+    const char* kind;
+    const char* fmt;
+    char* out;
+    char locfmt[128];
+    char buf[512];
+    Py_ssize_t valslen;
+    Py_ssize_t nrows;
+    Py_ssize_t row;
+    int cellsize;
+    int maxlen;
+    int span;
+    int len;
+    char conv;
+
+    if (!PyArg_ParseTuple(args, "Ossiii:format_numeric_column", &valsobj,
+                          &kind, &fmt, &cellsize, &maxlen, &span)) {
+        return NULL;
+    }
+
+    if (!PyString_Check(valsobj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "column values must be a byte string");
+        return NULL;
+    }
+    vals = PyString_AS_STRING(valsobj);
+    valslen = PyString_GET_SIZE(valsobj);
+
+    if ((kind[0] != 'i' && kind[0] != 'f') || valslen % 8 != 0 ||
+            cellsize <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "column values must be 8-byte elements of kind "
+                        "'i' or 'f'");
+        return NULL;
+    }
+
+    if (strlen(fmt) > sizeof(locfmt) - 4) {
+        Py_RETURN_NONE;
+    }
+    conv = prepare_format(fmt, locfmt);
+    if (conv == 0 || (kind[0] == 'i') != (conv == 'd')) {
+        /* Not a format this module handles; fall back to the Python loop */
+        Py_RETURN_NONE;
+    }
+
+    nrows = valslen / 8;
+    result = PyString_FromStringAndSize(NULL, nrows * cellsize);
+    if (result == NULL) {
+        return NULL;
+    }
+    out = PyString_AS_STRING(result);
+
+    for (row = 0; row < nrows; row++) {
+        if (kind[0] == 'i') {
+            long long iv;
+            memcpy(&iv, vals + row * 8, 8);
+            len = snprintf(buf, sizeof(buf), locfmt, iv);
+        } else {
+            double dv;
+            memcpy(&dv, vals + row * 8, 8);
+            len = snprintf(buf, sizeof(buf), locfmt, dv);
+        }
+
+        if (len < 0 || len > maxlen) {
+            PyErr_Format(PyExc_ValueError,
+                         "Value '%s' does not fit into the output's "
+                         "itemsize of %d.", buf, span);
+            Py_DECREF(result);
+            return NULL;
+        }
+
+        /* Pad with NULs to the cell size, the same as assigning a short
+           string to a numpy 'S' array; a value longer than the cell (but
+           within maxlen) is clipped, also like numpy assignment */
+        if (len > cellsize) {
+            len = cellsize;
+        }
+        memcpy(out + row * cellsize, buf, len);
+        memset(out + row * cellsize + len, 0, cellsize - len);
+    }
+
+    return result;
+}
+
+
+/* Method table mapping names to wrappers */
+static PyMethodDef asciitable_methods[] =
+{
+   {"parse_numeric_column", asciitable_parse_numeric_column, METH_VARARGS},
+   {"format_numeric_column", asciitable_format_numeric_column, METH_VARARGS},
+   {NULL, NULL}
+};
+
+#ifdef IS_PY3K
+static struct PyModuleDef asciitablemodule = {
+    PyModuleDef_HEAD_INIT,
+    "_asciitable",
+    "pyfits._asciitable module",
+    -1, /* No global state */
+    asciitable_methods
+};
+
+PyObject *
+PyInit__asciitable(void)
+{
+    return PyModule_Create(&asciitablemodule);
+}
+#else
+PyMODINIT_FUNC init_asciitable(void)
+{
+   Py_InitModule4("_asciitable", asciitable_methods,
+                  "pyfits._asciitable module",
+                  NULL, PYTHON_API_VERSION);
+}
+#endif
@@ -0,0 +1,311 @@
+/* $Id$
+*/
+
+/* "cardparse" module */
+
+/*****************************************************************************/
+/*                                                                           */
+/* The cardparse module is a small C accelerator used by pyfits.Header when  */
+/* reading headers from a file.  Given the raw header string it splits the   */
+/* string into individual card images in a single pass, joining CONTINUE     */
+/* card images onto the preceding card and stopping at the END card, exactly */
+/* as the pure Python loop in Header.fromstring does.  For each card it also */
+/* tries to determine the keyword up front; this saves a regular expression  */
+/* based parse per card when the Header is subsequently constructed, which   */
+/* dominates the time spent opening files with large headers.               */
+/*                                                                           */
+/* The keyword is only reported for cards that are unambiguously standard:   */
+/* a valid keyword in bytes 0-7 followed by the '= ' value indicator, or a   */
+/* commentary card (COMMENT, HISTORY, or blank).  Anything unusual--HIERARCH */
+/* cards, record-valued keyword cards, invalid keywords, or cards shorter    */
+/* than 80 characters--is passed back with a keyword of None so that the     */
+/* Python parser in pyfits.card handles it with full fidelity, including any */
+/* warnings it would normally issue.                                         */
+/*                                                                           */
+/* The single function parse_header(data) returns a list of                  */
+/* (start, end, keyword) tuples, one per card, where [start:end] is the      */
+/* card image within the input string, or None if the input cannot be        */
+/* handled here (for example non-ASCII data), in which case the caller       */
+/* should fall back to the pure Python implementation.                       */
+/*                                                                           */
+/*****************************************************************************/
+
+#include <ctype.h>
+#include <string.h>
+
+#include <Python.h>
+
+#if PY_MAJOR_VERSION >= 3
+#define IS_PY3K
+#endif
+
+#ifdef IS_PY3K
+#define PyString_Check PyBytes_Check
+#define PyString_AS_STRING PyBytes_AS_STRING
+#define PyString_GET_SIZE PyBytes_GET_SIZE
+#endif
+
+/* Must match Card.length and KEYWORD_LENGTH in pyfits.card */
+#define CARD_LENGTH 80
+#define KEYWORD_LENGTH 8
+
+
+/* Returns nonzero if c may appear in a standard FITS keyword; lowercase
+   letters are accepted here and upcased when the keyword is built, the same
+   way Card._parse_keyword upcases the keyword it returns. */
+static int keyword_char(char c)
+{
+    return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+            (c >= '0' && c <= '9') || c == '_' || c == '-');
+}
+
+
+/* Find the first occurrence of the '= ' value indicator in the card image;
+   returns the index or -1 if not present. */
+static Py_ssize_t find_value_indicator(const char* image, Py_ssize_t size)
+{
+    Py_ssize_t idx;
+
+    for (idx = 0; idx + 1 < size; idx++) {
+        if (image[idx] == '=' && image[idx + 1] == ' ') {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+
+/* Determine the keyword of a card image, mirroring Card._parse_keyword for
+   the easy cases.  The upcased keyword is written to keyword (a buffer of at
+   least KEYWORD_LENGTH + 1 characters) and its length returned.  A return
+   value of -1 means the card could not be classified with certainty and the
+   caller should leave the keyword to the Python parser. */
+static int classify_card(const char* image, Py_ssize_t size, char* keyword)
+{
+    Py_ssize_t val_ind;
+    Py_ssize_t idx;
+    const char* rest;
+    Py_ssize_t restsize;
+    int kwlen;
+
+    /* Cards shorter than 80 characters only arise from malformed input;
+       don't try to second-guess how Python will handle them. */
+    if (size < CARD_LENGTH) {
+        return -1;
+    }
+
+    kwlen = 0;
+    while (kwlen < KEYWORD_LENGTH && keyword_char(image[kwlen])) {
+        keyword[kwlen] = (char)toupper((unsigned char)image[kwlen]);
+        kwlen++;
+    }
+    keyword[kwlen] = '\0';
+
+    /* The remainder of the keyword field must be blank; an embedded space or
+       any other character makes the keyword non-standard. */
+    for (idx = kwlen; idx < KEYWORD_LENGTH; idx++) {
+        if (image[idx] != ' ') {
+            return -1;
+        }
+    }
+
+    val_ind = find_value_indicator(image, size);
+
+    if (val_ind >= 0 && val_ind <= KEYWORD_LENGTH) {
+        /* A standard value card--unless the value is a record-valued keyword
+           card.  Perform the same cheap test Card._check_if_rvkc_image uses
+           to rule those out; if the value merely looks like it might be one,
+           give up and let the full parser decide. */
+        if (val_ind < kwlen) {
+            return -1;
+        }
+        rest = image + val_ind + 2;
+        restsize = size - val_ind - 2;
+        while (restsize > 0 && *rest == ' ') {
+            rest++;
+            restsize--;
+        }
+        if (restsize > 0 && *rest == '\'') {
+            for (idx = 2; idx + 1 < restsize; idx++) {
+                if (rest[idx] == ':' && rest[idx + 1] == ' ') {
+                    return -1;
+                }
+            }
+        }
+        return kwlen;
+    }
+
+    /* No value indicator in the keyword field; only commentary cards are
+       safe to classify here.  CONTINUE, HIERARCH, and invalid keywords all
+       take special paths through Card._parse_keyword. */
+    if (kwlen == 0 || strcmp(keyword, "COMMENT") == 0 ||
+            strcmp(keyword, "HISTORY") == 0 || strcmp(keyword, "END") == 0) {
+        /* A '= ' later in the image would still send Python down the
+           record-valued keyword check; don't preempt it. */
+        if (val_ind >= 0) {
+            return -1;
+        }
+        return kwlen;
+    }
+
+    return -1;
+}
+
+
+/* Append a (start, end, keyword) tuple for one card image to the result
+   list; returns 0 on success, -1 on error with an exception set. */
+static int append_card(PyObject* result, const char* data, Py_ssize_t start,
+                       Py_ssize_t end)
+{
+    char keyword[KEYWORD_LENGTH + 1];
+    int kwlen;
+    PyObject* kwobj;
+    PyObject* card;
+    int status;
+
+    kwlen = classify_card(data + start, end - start, keyword);
+    if (kwlen < 0) {
+        kwobj = Py_None;
+        Py_INCREF(kwobj);
+    } else {
+#ifdef IS_PY3K
+        kwobj = PyUnicode_FromStringAndSize(keyword, kwlen);
+#else
+        kwobj = PyString_FromStringAndSize(keyword, kwlen);
+#endif
+        if (kwobj == NULL) {
+            return -1;
+        }
+    }
+
+    card = Py_BuildValue("(nnN)", start, end, kwobj);
+    if (card == NULL) {
+        return -1;
+    }
+    status = PyList_Append(result, card);
+    Py_DECREF(card);
+    return status;
+}
+
+
+static PyObject* cardparse_parse_header(PyObject* self, PyObject* args)
+{
+    PyObject* dataobj;
+    PyObject* databytes = NULL;
+    PyObject* result;
+    const char* data;
+    Py_ssize_t size;
+    Py_ssize_t idx;
+    Py_ssize_t end_idx;
+    Py_ssize_t image_start = 0;
+    Py_ssize_t image_end = 0;
+    int have_image = 0;
+
+    if (!PyArg_ParseTuple(args, "O:parse_header", &dataobj)) {
+        return NULL;
+    }
+
+    if (PyString_Check(dataobj)) {
+        Py_INCREF(dataobj);
+        databytes = dataobj;
+    } else if (PyUnicode_Check(dataobj)) {
+        databytes = PyUnicode_AsASCIIString(dataobj);
+        if (databytes == NULL) {
+            /* Non-ASCII header data; character and byte offsets would not
+               agree, so let the Python implementation deal with it. */
+            PyErr_Clear();
+            Py_RETURN_NONE;
+        }
+    } else {
+        PyErr_SetString(PyExc_TypeError,
+                        "header data must be a string of card images");
+        return NULL;
+    }
+
+    data = PyString_AS_STRING(databytes);
+    size = PyString_GET_SIZE(databytes);
+
+    result = PyList_New(0);
+    if (result == NULL) {
+        Py_DECREF(databytes);
+        return NULL;
+    }
+
+    /* This loop is a direct transcription of the card splitting loop in
+       Header.fromstring for the default case of no card separator. */
+    idx = 0;
+    while (idx < size) {
+        end_idx = idx + CARD_LENGTH;
+        if (end_idx > size) {
+            end_idx = size;
+        }
+
+        if (have_image) {
+            if (end_idx - idx >= 8 && strncmp(data + idx, "CONTINUE", 8) == 0) {
+                image_end = end_idx;
+                idx = end_idx;
+                continue;
+            }
+            if (append_card(result, data, image_start, image_end)) {
+                goto fail;
+            }
+            have_image = 0;
+        }
+
+        /* Stop at the END card: 'END' followed by 77 spaces */
+        if (end_idx - idx == CARD_LENGTH &&
+                strncmp(data + idx, "END", 3) == 0 &&
+                strspn(data + idx + 3, " ") >= CARD_LENGTH - 3) {
+            idx = end_idx;
+            break;
+        }
+
+        image_start = idx;
+        image_end = end_idx;
+        have_image = 1;
+        idx = end_idx;
+    }
+
+    if (have_image && append_card(result, data, image_start, image_end)) {
+        goto fail;
+    }
+
+    Py_DECREF(databytes);
+    return result;
+
+fail:
+    Py_DECREF(databytes);
+    Py_DECREF(result);
+    return NULL;
+}
+
+
+/* Method table mapping names to wrappers */
+static PyMethodDef cardparse_methods[] =
+{
+   {"parse_header", cardparse_parse_header, METH_VARARGS},
+   {NULL, NULL}
+};
+
+#ifdef IS_PY3K
+static struct PyModuleDef cardparsemodule = {
+    PyModuleDef_HEAD_INIT,
+    "_cardparse",
+    "pyfits._cardparse module",
+    -1, /* No global state */
+    cardparse_methods
+};
+
+PyObject *
+PyInit__cardparse(void)
+{
+    return PyModule_Create(&cardparsemodule);
+}
+#else
+PyMODINIT_FUNC init_cardparse(void)
+{
+   Py_InitModule4("_cardparse", cardparse_methods,
+                  "pyfits._cardparse module",
+                  NULL, PYTHON_API_VERSION);
+}
+#endif
@@ -0,0 +1,152 @@
+/* $Id$
+*/
+
+/* "checksum" module */
+
+/*****************************************************************************/
+/*                                                                           */
+/* The checksum module is a small C accelerator for computing the FITS 1's   */
+/* complement checksum used by the CHECKSUM and DATASUM keywords (Seaman,    */
+/* Pence & Rots, "FITS Checksum Proposal").  It implements the same          */
+/* algorithm as _ValidHDU._compute_checksum in pyfits.hdu.base, including    */
+/* the same blocking behavior: the buffer is summed a block at a time with   */
+/* the carries folded back in after each block, where the block length is    */
+/* the standard 2880 bytes, or the whole buffer length for the historical    */
+/* "nonstandard" checksums.  Sums of arbitrary (including odd) block         */
+/* lengths match the numpy implementation bit for bit, so the two paths are  */
+/* interchangeable.                                                          */
+/*                                                                           */
+/* The single function compute_checksum(data, sum32=0, blocklen=2880)        */
+/* accepts any object exporting a contiguous read buffer (bytes, a numpy    */
+/* array, an mmap...) and returns the updated 32-bit checksum.               */
+/*                                                                           */
+/*****************************************************************************/
+
+#include <Python.h>
+
+#if PY_MAJOR_VERSION >= 3
+#define IS_PY3K
+#endif
+
+
+/* Sum one block, starting from the folded 32-bit checksum sum32.  The
+   accumulators are 64-bit so that the historical whole-buffer "nonstandard"
+   blocking gives the same results as the numpy implementation, which
+   accumulates in 64-bit before folding the carries. */
+static unsigned int checksum_block(const unsigned char* data,
+                                   Py_ssize_t length, unsigned int sum32)
+{
+    unsigned PY_LONG_LONG hi = sum32 >> 16;
+    unsigned PY_LONG_LONG lo = sum32 & 0xFFFF;
+    unsigned PY_LONG_LONG hicarry, locarry;
+    Py_ssize_t nwords = length / 2;
+    Py_ssize_t widx;
+    unsigned int word;
+
+    /* Big-endian 16-bit words, alternating into the hi and lo sums */
+    for (widx = 0; widx < nwords; widx++) {
+        word = (data[2 * widx] << 8) | data[2 * widx + 1];
+        if (widx % 2 == 0) {
+            hi += word;
+        }
+        else {
+            lo += word;
+        }
+    }
+
+    /* An odd trailing byte is treated as the high byte of a zero-padded
+       word */
+    if (length % 2) {
+        word = data[length - 1] << 8;
+        if (nwords % 2) {
+            lo += word;
+        }
+        else {
+            hi += word;
+        }
+    }
+
+    hicarry = hi >> 16;
+    locarry = lo >> 16;
+
+    while (hicarry || locarry) {
+        hi = (hi & 0xFFFF) + locarry;
+        lo = (lo & 0xFFFF) + hicarry;
+        hicarry = hi >> 16;
+        locarry = lo >> 16;
+    }
+
+    return (unsigned int) ((hi << 16) + lo);
+}
+
+
+static PyObject* checksum_compute_checksum(PyObject* self, PyObject* args)
+{
+    PyObject* data;
+    unsigned long sum32 = 0;
+    long blocklen = 2880;
+    const void* buf;
+    const unsigned char* bytes;
+    Py_ssize_t length;
+    Py_ssize_t start;
+    Py_ssize_t count;
+
+    if (!PyArg_ParseTuple(args, "O|kl:_checksum.compute_checksum", &data,
+                          &sum32, &blocklen)) {
+        return NULL;
+    }
+
+    if (PyObject_AsReadBuffer(data, &buf, &length) != 0) {
+        return NULL;
+    }
+
+    if (blocklen <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "blocklen must be a positive integer");
+        return NULL;
+    }
+
+    bytes = (const unsigned char*) buf;
+
+    for (start = 0; start < length; start += blocklen) {
+        count = length - start;
+        if (count > blocklen) {
+            count = blocklen;
+        }
+        sum32 = checksum_block(bytes + start, count,
+                               (unsigned int) (sum32 & 0xFFFFFFFFUL));
+    }
+
+    return PyLong_FromUnsignedLong(sum32 & 0xFFFFFFFFUL);
+}
+
+
+/* Method table mapping names to wrappers */
+static PyMethodDef checksum_methods[] =
+{
+   {"compute_checksum", checksum_compute_checksum, METH_VARARGS},
+   {NULL, NULL}
+};
+
+#ifdef IS_PY3K
+static struct PyModuleDef checksummodule = {
+    PyModuleDef_HEAD_INIT,
+    "_checksum",
+    "pyfits._checksum module",
+    -1, /* No global state */
+    checksum_methods
+};
+
+PyObject *
+PyInit__checksum(void)
+{
+    return PyModule_Create(&checksummodule);
+}
+#else
+PyMODINIT_FUNC init_checksum(void)
+{
+   Py_InitModule4("_checksum", checksum_methods,
+                  "pyfits._checksum module",
+                  NULL, PYTHON_API_VERSION);
+}
+#endif
@@ -100,6 +100,23 @@
 
 #include "compressionmodule.h"
 
+#ifdef HAVE_COMPRESSION_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
+
+
+/* Number of worker threads to use for tile (de)compression; 1 disables
+   threading entirely and 0 means use one thread per processor.  Modified
+   from Python through the set_thread_count module function. */
+static int compression_thread_count = 1;
+
 
 /* Report any error based on the status returned from cfitsio. */
 void process_status_err(int status)
@@ -203,6 +220,14 @@ int compress_type_from_string(char* zcmptype) {
         return RICE_1;
     } else if (0 == strcmp(zcmptype, "GZIP_1")) {
         return GZIP_1;
+#ifdef GZIP_2
+    } else if (0 == strcmp(zcmptype, "GZIP_2")) {
+        // GZIP_2 applies a byte-shuffle transpose to each tile before
+        // deflating it, which groups the (typically similar) high-order
+        // bytes together and compresses both better and faster than plain
+        // GZIP_1 on most floating point and high dynamic range images
+        return GZIP_2;
+#endif
     } else if (0 == strcmp(zcmptype, "PLIO_1")) {
         return PLIO_1;
     } else if (0 == strcmp(zcmptype, "HCOMPRESS_1")) {
@@ -377,20 +402,151 @@ int get_header_longlong(PyObject* header, char* keyword, long long* val,
 }
 
 
-void* compression_realloc(void* ptr, size_t size) {
-    // This realloc()-like function actually just mallocs the requested
-    // size and copies from the original memory address into the new one, and
-    // returns the newly malloc'd address.
-    // This is generally less efficient than an actual realloc(), but the
-    // problem with using realloc in this case is that when it succeeds it will
-    // free() the original memory, which may still be in use by the ndarray
-    // using that memory as its data buffer.  This seems like the least hacky
-    // way around that for now.
-    // I'm open to other ideas though.
-    void* tmp;
-    tmp = malloc(size);
-    memcpy(tmp, ptr, size);
-    return tmp;
+/* Arena allocator for the compressed output buffer.  The arena is sized up
+   front from imcomp_calc_max_elem times the tile count (see
+   init_output_buffer), so in the common case the CFITSIO memfile driver
+   never needs to move the buffer as tiles are appended: growth requests
+   that still fit in the reserved capacity are satisfied in place.  A small
+   header ahead of the buffer records the capacity, and a magic value lets
+   the realloc callback tell arena pointers apart from plain malloc'd
+   buffers (such as the numpy-owned input buffer used for decompression). */
+
+#define COMPRESSION_ARENA_MAGIC ((size_t) 0x41524E41)  /* "ARNA" */
+
+typedef struct {
+    size_t capacity;  /* usable bytes following this header */
+    size_t magic;
+} compression_arena_header;
+
+
+static compression_arena_header* compression_arena_base(void* ptr) {
+    compression_arena_header* hdr = ((compression_arena_header*) ptr) - 1;
+
+    if (ptr == NULL || hdr->magic != COMPRESSION_ARENA_MAGIC) {
+        return NULL;
+    }
+    return hdr;
+}
+
+
+/* Pool of retired arena buffers recycled across compress_hdu/decompress_hdu
+   calls.  Repeated calls on same-sized tiles (the common case for an ingest
+   loop) would otherwise pay for a fresh calloc and its page faults on every
+   call.  All arena allocation and release happens on the thread holding the
+   GIL (the worker threads only ever see already-allocated buffers through
+   the realloc callback), so the pool needs no locking of its own; it can be
+   released explicitly from Python through compression.trim_buffers(). */
+
+#define ARENA_POOL_SLOTS MAX_COMPRESSION_THREADS
+
+static compression_arena_header* arena_pool[ARENA_POOL_SLOTS];
+static int arena_pool_count = 0;
+
+
+void compression_arena_pool_trim(void) {
+    while (arena_pool_count > 0) {
+        free(arena_pool[--arena_pool_count]);
+    }
+}
+
+
+void* compression_arena_alloc(size_t capacity) {
+    // Returns a zeroed buffer of the given capacity, preceded by the arena
+    // header; the returned pointer can be grown in place up to capacity
+    compression_arena_header* hdr;
+    int idx;
+    int best = -1;
+
+    /* Prefer recycling a retired buffer of similar size; reusing one more
+       than twice as large as requested would pin excess memory, so those
+       are skipped (and eventually released by pool pressure or
+       trim_buffers) */
+    for (idx = 0; idx < arena_pool_count; idx++) {
+        compression_arena_header* slot = arena_pool[idx];
+        if (slot->capacity >= capacity && slot->capacity / 2 <= capacity &&
+                (best < 0 || slot->capacity < arena_pool[best]->capacity)) {
+            best = idx;
+        }
+    }
+
+    if (best >= 0) {
+        hdr = arena_pool[best];
+        arena_pool[best] = arena_pool[--arena_pool_count];
+        capacity = hdr->capacity;
+        memset(hdr + 1, 0, capacity);
+    } else {
+        hdr = calloc(1, sizeof(compression_arena_header) + capacity);
+        if (hdr == NULL) {
+            return NULL;
+        }
+    }
+    hdr->capacity = capacity;
+    hdr->magic = COMPRESSION_ARENA_MAGIC;
+    return (void*) (hdr + 1);
+}
+
+
+void compression_arena_free(void* ptr) {
+    compression_arena_header* hdr = compression_arena_base(ptr);
+
+    if (hdr == NULL) {
+        free(ptr);
+        return;
+    }
+
+    if (arena_pool_count < ARENA_POOL_SLOTS) {
+        arena_pool[arena_pool_count++] = hdr;
+    } else {
+        free(hdr);
+    }
+}
+
+
+void* compression_arena_realloc(void* ptr, size_t size) {
+    // realloc()-compatible callback for fits_create_memfile; growth within
+    // the arena's reserved capacity is free, and anything else falls back
+    // to a real realloc of the whole arena (growing geometrically so that
+    // pathologically incompressible data does not realloc per tile)
+    compression_arena_header* hdr = compression_arena_base(ptr);
+    size_t newcap;
+
+    if (hdr == NULL) {
+        return realloc(ptr, size);
+    }
+
+    if (size <= hdr->capacity) {
+        return ptr;
+    }
+
+    newcap = hdr->capacity * 2;
+    if (newcap < size) {
+        newcap = size;
+    }
+
+    hdr = realloc(hdr, sizeof(compression_arena_header) + newcap);
+    if (hdr == NULL) {
+        return NULL;
+    }
+    hdr->capacity = newcap;
+    return (void*) (hdr + 1);
+}
+
+
+void* compression_arena_trim(void* ptr, size_t size) {
+    // Shrinks the arena to its final exact size, releasing the unused tail
+    // of the reservation; returns the (possibly moved) buffer pointer
+    compression_arena_header* hdr = compression_arena_base(ptr);
+
+    if (hdr == NULL) {
+        return realloc(ptr, size);
+    }
+
+    hdr = realloc(hdr, sizeof(compression_arena_header) + size);
+    if (hdr == NULL) {
+        return ptr;
+    }
+    hdr->capacity = size;
+    return (void*) (hdr + 1);
 }
 
 
@@ -749,7 +905,7 @@ void init_output_buffer(PyObject* hdu, void** buf, size_t* bufsize) {
         *bufsize += ((size_t) (IOBUFLEN - (*bufsize % IOBUFLEN)));
     }
 
-    *buf = calloc(*bufsize, sizeof(char));
+    *buf = compression_arena_alloc(*bufsize);
 fail:
     Py_XDECREF(header);
     return;
@@ -823,7 +979,8 @@ void open_from_hdu(fitsfile** fileptr, void** buf, size_t* bufsize,
     // to something else with THEAP
     get_header_longlong(header, "THEAP", &theap, 0);
 
-    fits_create_memfile(fileptr, buf, bufsize, 0, realloc, &status);
+    fits_create_memfile(fileptr, buf, bufsize, 0, compression_arena_realloc,
+                        &status);
 
     if (status != 0) {
         process_status_err(status);
@@ -866,215 +1023,1770 @@ fail:
 }
 
 
+/* Optional (opt-in) instrumentation of the compression codecs: accumulates
+   tile counts, uncompressed/compressed byte totals and wall time spent in
+   the codec runs, broken down by codec and by direction.  Enabled with
+   compression.enable_stats() and read back with compression.get_stats();
+   recording is skipped entirely while disabled. */
 
-PyObject* compression_compress_hdu(PyObject* self, PyObject* args)
-{
-    PyObject* hdu;
-    PyObject* retval = NULL;
-    tcolumn* columns = NULL;
+static int compression_stats_enabled = 0;
 
-    void* outbuf;
-    size_t outbufsize;
+typedef struct {
+    unsigned long long calls;
+    unsigned long long tiles;
+    unsigned long long raw_bytes;   /* uncompressed side of the codec */
+    unsigned long long comp_bytes;  /* compressed side of the codec */
+    double seconds;                 /* wall time inside the codec run */
+} codec_stats;
 
-    PyArrayObject* indata;
-    PyArrayObject* tmp;
-    npy_intp znaxis;
-    int datatype;
-    int npdatatype;
-    unsigned long long heapsize;
+/* One slot per recognized codec plus a catch-all */
+#define CODEC_STATS_SLOTS 5
 
-    fitsfile* fileptr;
-    FITSfile* Fptr;
-    int status = 0;
+static codec_stats compress_stats[CODEC_STATS_SLOTS];
+static codec_stats decompress_stats[CODEC_STATS_SLOTS];
 
-    if (!PyArg_ParseTuple(args, "O:compression.compress_hdu", &hdu))
-    {
-        PyErr_SetString(PyExc_TypeError, "Couldn't parse arguments");
-        return NULL;
-    }
+static const char* codec_stats_names[CODEC_STATS_SLOTS] = {
+    "RICE_1", "GZIP_1", "PLIO_1", "HCOMPRESS_1", "OTHER"
+};
 
-    // For HDU compression never use CFITSIO to write directly to the file;
-    // although there's nothing wrong with CFITSIO, right now that would cause
-    // too much confusion to PyFITS' internal book keeping.
-    // We just need to get the compressed bytes and PyFITS will handle the
-    // writing of them.
-    init_output_buffer(hdu, &outbuf, &outbufsize);
-    if (outbuf == NULL) {
-        return NULL;
-    }
 
-    open_from_hdu(&fileptr, &outbuf, &outbufsize, hdu, &columns);
-    if (PyErr_Occurred()) {
-        goto fail;
+static int codec_stats_slot(int compress_type) {
+    switch (compress_type) {
+        case RICE_1:
+            return 0;
+        case GZIP_1:
+            return 1;
+        case PLIO_1:
+            return 2;
+        case HCOMPRESS_1:
+            return 3;
+        default:
+            return CODEC_STATS_SLOTS - 1;
     }
+}
 
-    Fptr = fileptr->Fptr;
 
-    bitpix_to_datatypes(Fptr->zbitpix, &datatype, &npdatatype);
-    if (PyErr_Occurred()) {
-        goto fail;
-    }
+static double stats_walltime(void) {
+#ifdef _WIN32
+    return (double) clock() / CLOCKS_PER_SEC;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + 1.e-6 * (double) tv.tv_usec;
+#endif
+}
 
-    indata = (PyArrayObject*) PyObject_GetAttrString(hdu, "data");
 
-    fits_write_img(fileptr, datatype, 1, PyArray_SIZE(indata), indata->data,
-                   &status);
-    if (status != 0) {
-        process_status_err(status);
-        goto fail;
-    }
+static void stats_record(codec_stats* stats, int compress_type,
+                         unsigned long long tiles,
+                         unsigned long long raw_bytes,
+                         unsigned long long comp_bytes, double seconds) {
+    codec_stats* slot = stats + codec_stats_slot(compress_type);
 
-    fits_flush_buffer(fileptr, 1, &status);
-    if (status != 0) {
-        process_status_err(status);
-        goto fail;
-    }
+    slot->calls++;
+    slot->tiles += tiles;
+    slot->raw_bytes += raw_bytes;
+    slot->comp_bytes += comp_bytes;
+    slot->seconds += seconds;
+}
 
-    // Previously this used outbufsize as the size to use for the new Numpy
-    // byte array. However outbufsize is usually larger than necessary to
-    // store all the compressed data exactly; instead use the exact size
-    // of the compressed data from the heapsize plus the size of the table
-    // itself
-    heapsize = (unsigned long long) Fptr->heapsize;
-    znaxis = (npy_intp) (Fptr->heapstart + heapsize);
 
-    if (znaxis < outbufsize) {
-        // Go ahead and truncate to the size in znaxis to free the
-        // redundant allocation
-        // TODO: Add error handling
-        outbuf = realloc(outbuf, (size_t) znaxis);
-    }
+/* A per-HDU cache of the synthesized fitsfile handle, so that repeated
+   decompression calls on the same (unmodified) HDU--e.g. reading a large
+   compressed image section by section--do not re-parse the header keywords
+   and rebuild the table column structures every time.  The handle is stored
+   in a capsule attached to the HDU object itself, so its lifetime is bound
+   to the HDU's; it is only used while the HDU's header is unmodified and
+   its compressed data buffer is unchanged.  PyCapsule requires Python 2.7;
+   on older versions every call simply rebuilds the handle as before. */
 
-    tmp = (PyArrayObject*) PyArray_SimpleNewFromData(1, &znaxis, NPY_UBYTE,
-                                                     outbuf);
+#if PY_VERSION_HEX >= 0x02070000
+#define HAVE_FILEPTR_CACHE
+#endif
 
+#define FILEPTR_CACHE_ATTR "_compression_fileptr"
+#define FILEPTR_CACHE_CAPSULE "pyfits.compression.fitsfile"
 
-    // Leaves refcount of tmp untouched, so its refcount should remain as 1
-    retval = Py_BuildValue("KN", heapsize, tmp);
+#ifdef HAVE_FILEPTR_CACHE
 
-    goto cleanup;
+typedef struct {
+    fitsfile* fileptr;
+    tcolumn* columns;
+    void* inbuf;
+    size_t inbufsize;
+} cached_fitsfile;
 
-fail:
-    if (outbuf != NULL) {
-        // At this point outbuf should never not be NULL, but in principle
-        // buggy code somewhere in CFITSIO or Numpy could set it to NULL
-        free(outbuf);
-    }
-cleanup:
-    if (columns != NULL) {
-        PyMem_Free(columns);
-        Fptr->tableptr = NULL;
-    }
 
-    if (fileptr != NULL) {
-        status = 1; // Disable header-related errors
-        fits_close_file(fileptr, &status);
-        if (status != 1) {
-            process_status_err(status);
-            retval = NULL;
-        }
+static void cached_fitsfile_destructor(PyObject* capsule) {
+    cached_fitsfile* cache = (cached_fitsfile*)
+        PyCapsule_GetPointer(capsule, FILEPTR_CACHE_CAPSULE);
+    int status = 1;  /* Disable header-related errors */
+
+    if (cache == NULL) {
+        return;
     }
+    if (cache->columns != NULL) {
+        cache->fileptr->Fptr->tableptr = NULL;
+        PyMem_Free(cache->columns);
+    }
+    fits_close_file(cache->fileptr, &status);
+    free(cache);
+}
 
-    Py_XDECREF(indata);
 
-    // Clear any messages remaining in CFITSIO's error stack
-    fits_clear_errmsg();
+static int hdu_header_modified(PyObject* hdu) {
+    /* Returns 1 if the HDU's header has its _modified flag set (or if the
+       flag cannot be read), 0 otherwise */
+    PyObject* header;
+    PyObject* modified;
+    int retval = 1;
 
+    header = PyObject_GetAttrString(hdu, "_header");
+    if (header == NULL) {
+        PyErr_Clear();
+        return 1;
+    }
+    modified = PyObject_GetAttrString(header, "_modified");
+    if (modified != NULL) {
+        retval = PyObject_IsTrue(modified);
+        if (retval < 0) {
+            PyErr_Clear();
+            retval = 1;
+        }
+        Py_DECREF(modified);
+    }
+    else {
+        PyErr_Clear();
+    }
+    Py_DECREF(header);
     return retval;
 }
 
+#endif  /* HAVE_FILEPTR_CACHE */
 
-PyObject* compression_decompress_hdu(PyObject* self, PyObject* args)
-{
-    PyObject* hdu;
-    tcolumn* columns = NULL;
-
-    void* inbuf;
-    size_t inbufsize;
-
-    PyArrayObject* outdata;
-    int datatype;
-    int npdatatype;
-    npy_intp zndim;
-    npy_intp* znaxis;
-    long arrsize;
-    unsigned int idx;
 
-    fitsfile* fileptr;
-    int anynul = 0;
-    int status = 0;
+/* Drop-in replacement for open_from_hdu that reuses a cached handle when
+   the HDU is unchanged since the handle was built.  Sets *cached to true
+   when the returned handle is owned by the cache, in which case the caller
+   must not close the fitsfile or free the column array. */
+void open_from_hdu_cached(fitsfile** fileptr, void** buf, size_t* bufsize,
+                          PyObject* hdu, tcolumn** columns, int* cached) {
+    *cached = 0;
 
-    if (!PyArg_ParseTuple(args, "O:compression.decompress_hdu", &hdu))
+#ifdef HAVE_FILEPTR_CACHE
     {
-        PyErr_SetString(PyExc_TypeError, "Couldn't parse arguments");
-        return NULL;
-    }
+        PyObject* capsule;
+        cached_fitsfile* cache;
 
-    // Grab a pointer to the input data from the HDU's compressed_data
-    // attribute
-    get_hdu_data_base(hdu, &inbuf, &inbufsize);
-    if (PyErr_Occurred()) {
-        return NULL;
-    } else if (inbufsize == 0) {
-        // The compressed data buffer is empty (probably zero rows, for an
-        // empty "compressed" image.  Just return None in this case.
-        Py_INCREF(Py_None);
-        return Py_None;
+        capsule = PyObject_GetAttrString(hdu, FILEPTR_CACHE_ATTR);
+        if (capsule == NULL) {
+            PyErr_Clear();
+        }
+        else {
+            cache = (cached_fitsfile*)
+                PyCapsule_GetPointer(capsule, FILEPTR_CACHE_CAPSULE);
+            if (cache == NULL) {
+                PyErr_Clear();
+            }
+            else if (cache->inbuf == *buf && cache->inbufsize == *bufsize &&
+                     !hdu_header_modified(hdu)) {
+                *fileptr = cache->fileptr;
+                *columns = cache->columns;
+                *cached = 1;
+                Py_DECREF(capsule);
+                return;
+            }
+            Py_DECREF(capsule);
+            /* Stale handle; dropping the attribute closes it */
+            if (0 != PyObject_DelAttrString(hdu, FILEPTR_CACHE_ATTR)) {
+                PyErr_Clear();
+            }
+        }
     }
+#endif
 
-    open_from_hdu(&fileptr, &inbuf, &inbufsize, hdu, &columns);
+    open_from_hdu(fileptr, buf, bufsize, hdu, columns);
     if (PyErr_Occurred()) {
-        return NULL;
+        return;
     }
 
-    bitpix_to_datatypes(fileptr->Fptr->zbitpix, &datatype, &npdatatype);
-    if (PyErr_Occurred()) {
-        return NULL;
-    }
+#ifdef HAVE_FILEPTR_CACHE
+    /* Only cache when the header is pristine: the _modified flag is
+       monotonic, so a handle built from an already-modified header could
+       never be validated against later modifications */
+    if (!hdu_header_modified(hdu)) {
+        PyObject* capsule;
+        cached_fitsfile* cache;
 
-    zndim = (npy_intp)fileptr->Fptr->zndim;
-    znaxis = (npy_intp*) PyMem_Malloc(sizeof(npy_intp) * zndim);
-    arrsize = 1;
-    for (idx = 0; idx < zndim; idx++) {
-        znaxis[zndim - idx - 1] = fileptr->Fptr->znaxis[idx];
-        arrsize *= fileptr->Fptr->znaxis[idx];
+        cache = malloc(sizeof(cached_fitsfile));
+        if (cache == NULL) {
+            return;
+        }
+        cache->fileptr = *fileptr;
+        cache->columns = *columns;
+        cache->inbuf = *buf;
+        cache->inbufsize = *bufsize;
+
+        capsule = PyCapsule_New(cache, FILEPTR_CACHE_CAPSULE,
+                                cached_fitsfile_destructor);
+        if (capsule == NULL) {
+            PyErr_Clear();
+            free(cache);
+            return;
+        }
+        if (0 == PyObject_SetAttrString(hdu, FILEPTR_CACHE_ATTR, capsule)) {
+            *cached = 1;
+        }
+        else {
+            PyErr_Clear();
+            PyCapsule_SetDestructor(capsule, NULL);
+            free(cache);
+        }
+        Py_DECREF(capsule);
     }
+#endif
+}
 
-    /* Create and allocate a new array for the decompressed data */
-    outdata = (PyArrayObject*) PyArray_SimpleNew(zndim, znaxis, npdatatype);
 
-    fits_read_img(fileptr, datatype, 1, arrsize, NULL, outdata->data, &anynul,
-                  &status);
-    if (status != 0) {
-        process_status_err(status);
-        outdata = NULL;
-        goto fail;
+/* Returns the actual number of worker threads to use given the number of
+   independent work units (tile rows); collapses to 1 when threading is
+   disabled or unavailable. */
+static int resolve_thread_count(long long nunits) {
+    int nthreads = compression_thread_count;
+
+#ifdef HAVE_COMPRESSION_THREADS
+    if (nthreads == 0) {
+        nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads < 1) {
+            nthreads = 1;
+        }
+    }
+    if (nthreads > MAX_COMPRESSION_THREADS) {
+        nthreads = MAX_COMPRESSION_THREADS;
+    }
+    if (nunits < (long long) nthreads) {
+        nthreads = (int) nunits;
     }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    return nthreads;
+#else
+    return 1;
+#endif
+}
 
-fail:
-    if (columns != NULL) {
-        PyMem_Free(columns);
-        fileptr->Fptr->tableptr = NULL;
+
+/* Size in bytes of a single element of a variable length array column given
+   the (negated) CFITSIO type code stored in tcolumn.tdatatype */
+static int vla_elem_size(int tdatatype) {
+    switch (-tdatatype) {
+        case TBYTE:
+        case TSBYTE:
+        case TLOGICAL:
+            return 1;
+        case TSHORT:
+        case TUSHORT:
+            return 2;
+        case TINT:
+        case TUINT:
+        case TLONG:
+        case TULONG:
+        case TFLOAT:
+            return 4;
+        case TLONGLONG:
+        case TDOUBLE:
+            return 8;
+        default:
+            return 1;
     }
+}
 
-    if (fileptr != NULL) {
-        status = 1;// Disable header-related errors
-        fits_close_file(fileptr, &status);
-        if (status != 1) {
-            process_status_err(status);
-            outdata = NULL;
+
+/* Read/write the count and heap offset from a binary table variable length
+   array descriptor; descriptors are stored big-endian in the table, as a
+   pair of 32-bit ints for 'P' format columns or 64-bit for 'Q' format. */
+static void read_vla_descriptor(const unsigned char* ptr, int qformat,
+                                long long* count, long long* offset) {
+    unsigned long long vals[2];
+    int nbytes = qformat ? 8 : 4;
+    int idx;
+    int jdx;
+
+    for (idx = 0; idx < 2; idx++) {
+        vals[idx] = 0;
+        for (jdx = 0; jdx < nbytes; jdx++) {
+            vals[idx] = (vals[idx] << 8) | *ptr++;
         }
     }
 
-    PyMem_Free(znaxis);
+    *count = (long long) vals[0];
+    *offset = (long long) vals[1];
+}
+
+
+static void write_vla_descriptor(unsigned char* ptr, int qformat,
+                                 long long count, long long offset) {
+    unsigned long long vals[2];
+    int nbytes = qformat ? 8 : 4;
+    int idx;
+    int jdx;
+
+    vals[0] = (unsigned long long) count;
+    vals[1] = (unsigned long long) offset;
+
+    for (idx = 0; idx < 2; idx++) {
+        for (jdx = nbytes - 1; jdx >= 0; jdx--) {
+            *ptr++ = (unsigned char) ((vals[idx] >> (8 * jdx)) & 0xff);
+        }
+    }
+}
+
+
+/* Validates a caller-provided output array for decompress_hdu: it must be a
+   C-contiguous, writeable numpy array of the decompressed data's exact type
+   and total size.  Returns the validated array (borrowed reference) or NULL
+   with an exception set. */
+static PyArrayObject* check_output_array(PyObject* out, int npdatatype,
+                                         long long nelem) {
+    PyArrayObject* outarr;
+
+    if (!PyObject_TypeCheck(out, &PyArray_Type)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "output array must be a numpy.ndarray");
+        return NULL;
+    }
+
+    outarr = (PyArrayObject*) out;
+
+    if (!PyArray_ISCONTIGUOUS(outarr) ||
+            !(PyArray_FLAGS(outarr) & NPY_ARRAY_WRITEABLE)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "output array must be C-contiguous and writeable");
+        return NULL;
+    }
+
+    if (PyArray_TYPE(outarr) != npdatatype) {
+        PyErr_SetString(PyExc_ValueError,
+                        "output array has the wrong dtype for the "
+                        "decompressed data");
+        return NULL;
+    }
+
+    if ((long long) PyArray_SIZE(outarr) != nelem) {
+        PyErr_SetString(PyExc_ValueError,
+                        "output array has the wrong size for the "
+                        "decompressed data");
+        return NULL;
+    }
+
+    return outarr;
+}
+
+
+#ifdef HAVE_COMPRESSION_THREADS
+
+/* State for one worker in the tile compression pool; each worker owns a
+   private in-memory fitsfile over its own output buffer and compresses a
+   contiguous, tile-aligned range of the image pixels into it. */
+typedef struct {
+    fitsfile* fileptr;
+    int datatype;
+    void* data;            /* already offset to the chunk's first pixel */
+    long long firstelem;   /* 1-based first pixel of the chunk */
+    long long nelem;
+    long long firstrow;    /* 0-based first table row (tile) of the chunk */
+    long long nrows;
+    int status;
+} compress_chunk;
+
+
+static void* compress_chunk_run(void* arg) {
+    compress_chunk* chunk = (compress_chunk*) arg;
+
+    fits_write_img(chunk->fileptr, chunk->datatype, chunk->firstelem,
+                   chunk->nelem, chunk->data, &chunk->status);
+    if (chunk->status == 0) {
+        fits_flush_buffer(chunk->fileptr, 1, &chunk->status);
+    }
+    return NULL;
+}
+
+
+/* Compresses the tiles of the given HDU with a pool of nthreads workers.
+   Each worker compresses a tile-aligned slab of the image through its own
+   in-memory fitsfile, and the per-worker tables and heaps are then stitched
+   back together in tile order.  Returns the same (heapsize, byte array)
+   tuple as the single-threaded path. */
+static PyObject* compress_hdu_parallel(PyObject* hdu, int nthreads) {
+    PyObject* retval = NULL;
+
+    compress_chunk chunks[MAX_COMPRESSION_THREADS];
+    pthread_t threads[MAX_COMPRESSION_THREADS];
+    tcolumn* columns[MAX_COMPRESSION_THREADS];
+    void* outbufs[MAX_COMPRESSION_THREADS];
+    size_t outbufsizes[MAX_COMPRESSION_THREADS];
+
+    PyArrayObject* indata = NULL;
+    PyArrayObject* tmp;
+    FITSfile* Fptr;
+
+    int datatype;
+    int npdatatype;
+    int elemsize;
+    int idx;
+    int colidx;
+    int started = 0;
+
+    long long nslabs;
+    long long slabpix;
+    long long rows_per_slab;
+    long long slabs_per_chunk;
+    long long slab0;
+    long long nrows;
+    long long rowlen;
+    long long heapstart;
+    long long totalpix;
+    int zndim;
+
+    unsigned char* finalbuf = NULL;
+    unsigned long long heapsize;
+    npy_intp znaxis;
+    int status;
+    double stats_t0 = 0.0;
+
+    for (idx = 0; idx < nthreads; idx++) {
+        chunks[idx].fileptr = NULL;
+        chunks[idx].status = 0;
+        columns[idx] = NULL;
+        outbufs[idx] = NULL;
+    }
+
+    /* Each worker gets its own full-size output buffer and its own synthetic
+       fitsfile; all of the Python API use happens here, before the pool is
+       started */
+    for (idx = 0; idx < nthreads; idx++) {
+        init_output_buffer(hdu, &outbufs[idx], &outbufsizes[idx]);
+        if (outbufs[idx] == NULL) {
+            goto fail;
+        }
+
+        open_from_hdu(&chunks[idx].fileptr, &outbufs[idx], &outbufsizes[idx],
+                      hdu, &columns[idx]);
+        if (PyErr_Occurred()) {
+            goto fail;
+        }
+    }
+
+    Fptr = chunks[0].fileptr->Fptr;
+
+    bitpix_to_datatypes(Fptr->zbitpix, &datatype, &npdatatype);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    indata = (PyArrayObject*) PyObject_GetAttrString(hdu, "data");
+    if (indata == NULL) {
+        goto fail;
+    }
+
+    elemsize = abs(Fptr->zbitpix) / 8;
+    zndim = Fptr->zndim;
+    nrows = Fptr->numrows;
+    rowlen = Fptr->rowlength;
+    heapstart = Fptr->heapstart;
+
+    /* Partition the image into slabs along the slowest varying axis, where
+       one slab is the full extent of all faster axes by one tile length of
+       the slowest axis; a slab always contains only whole tiles, so the
+       workers never share a tile. */
+    slabpix = 1;
+    rows_per_slab = 1;
+    totalpix = 1;
+    for (idx = 0; idx < zndim; idx++) {
+        totalpix *= Fptr->znaxis[idx];
+        if (idx < zndim - 1) {
+            slabpix *= Fptr->znaxis[idx];
+            rows_per_slab *= (Fptr->znaxis[idx] + Fptr->tilesize[idx] - 1) /
+                             Fptr->tilesize[idx];
+        }
+    }
+    slabpix *= Fptr->tilesize[zndim - 1];
+    nslabs = (Fptr->znaxis[zndim - 1] + Fptr->tilesize[zndim - 1] - 1) /
+             Fptr->tilesize[zndim - 1];
+
+    slabs_per_chunk = (nslabs + nthreads - 1) / nthreads;
+    slab0 = 0;
+    for (idx = 0; idx < nthreads && slab0 < nslabs; idx++) {
+        long long chunkslabs = slabs_per_chunk;
+        if (slab0 + chunkslabs > nslabs) {
+            chunkslabs = nslabs - slab0;
+        }
+
+        chunks[idx].datatype = datatype;
+        chunks[idx].firstelem = slab0 * slabpix + 1;
+        chunks[idx].nelem = chunkslabs * slabpix;
+        if (chunks[idx].firstelem + chunks[idx].nelem - 1 > totalpix) {
+            /* The last slab may be a partial tile length */
+            chunks[idx].nelem = totalpix - chunks[idx].firstelem + 1;
+        }
+        chunks[idx].data = ((char*) PyArray_DATA(indata)) +
+                           (chunks[idx].firstelem - 1) * elemsize;
+        chunks[idx].firstrow = slab0 * rows_per_slab;
+        chunks[idx].nrows = chunkslabs * rows_per_slab;
+        if (chunks[idx].firstrow + chunks[idx].nrows > nrows) {
+            chunks[idx].nrows = nrows - chunks[idx].firstrow;
+        }
+
+        slab0 += chunkslabs;
+        started++;
+    }
+
+    if (compression_stats_enabled) {
+        stats_t0 = stats_walltime();
+    }
+
+    // The workers already provide tile-level parallelism, so keep the
+    // HCOMPRESS transform kernels serial within each worker
+    fits_hcompress_set_threads(1);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (idx = 0; idx < started; idx++) {
+        if (0 != pthread_create(&threads[idx], NULL, compress_chunk_run,
+                                &chunks[idx])) {
+            /* Run the chunk inline rather than losing its tiles */
+            compress_chunk_run(&chunks[idx]);
+            threads[idx] = pthread_self();
+        }
+    }
+    for (idx = 0; idx < started; idx++) {
+        if (!pthread_equal(threads[idx], pthread_self())) {
+            pthread_join(threads[idx], NULL);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    for (idx = 0; idx < started; idx++) {
+        if (chunks[idx].status != 0) {
+            process_status_err(chunks[idx].status);
+            goto fail;
+        }
+    }
+
+    /* Stitch the per-worker tables and heaps back together in tile order:
+       the fixed-width table row for each tile is copied verbatim from its
+       owning worker, and the heap blocks referenced by any variable length
+       array columns in that row are appended to the combined heap with
+       their descriptors rewritten for the new offsets. */
+    heapsize = 0;
+    for (idx = 0; idx < started; idx++) {
+        heapsize += (unsigned long long) chunks[idx].fileptr->Fptr->heapsize;
+    }
+
+    if (compression_stats_enabled) {
+        stats_record(compress_stats, Fptr->compress_type,
+                     (unsigned long long) nrows,
+                     (unsigned long long) PyArray_NBYTES(indata), heapsize,
+                     stats_walltime() - stats_t0);
+    }
+
+    finalbuf = calloc((size_t) (heapstart + heapsize), 1);
+    if (finalbuf == NULL) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+
+    heapsize = 0;
+    for (idx = 0; idx < started; idx++) {
+        FITSfile* chunk_fptr = chunks[idx].fileptr->Fptr;
+        unsigned char* chunkbuf = (unsigned char*) outbufs[idx];
+        long long row;
+
+        for (row = chunks[idx].firstrow;
+             row < chunks[idx].firstrow + chunks[idx].nrows; row++) {
+            unsigned char* rowptr = finalbuf + row * rowlen;
+
+            memcpy(rowptr, chunkbuf + row * rowlen, (size_t) rowlen);
+
+            for (colidx = 0; colidx < chunk_fptr->tfield; colidx++) {
+                tcolumn* column = columns[idx] + colidx;
+                unsigned char* descptr;
+                long long count;
+                long long offset;
+                long long nbytes;
+                int qformat;
+
+                if (column->tdatatype >= 0) {
+                    continue;
+                }
+
+                qformat = (NULL != strchr(column->tform, 'Q'));
+                descptr = rowptr + column->tbcol;
+                read_vla_descriptor(descptr, qformat, &count, &offset);
+                if (count == 0) {
+                    continue;
+                }
+
+                nbytes = count * vla_elem_size(column->tdatatype);
+                memcpy(finalbuf + heapstart + heapsize,
+                       chunkbuf + chunk_fptr->heapstart + offset,
+                       (size_t) nbytes);
+                write_vla_descriptor(descptr, qformat, count,
+                                     (long long) heapsize);
+                heapsize += nbytes;
+            }
+        }
+    }
+
+    znaxis = (npy_intp) (heapstart + heapsize);
+    tmp = (PyArrayObject*) PyArray_SimpleNewFromData(1, &znaxis, NPY_UBYTE,
+                                                     finalbuf);
+    if (tmp == NULL) {
+        goto fail;
+    }
+    finalbuf = NULL;  /* Now owned by the array */
+
+    retval = Py_BuildValue("KN", heapsize, tmp);
+    goto cleanup;
+
+fail:
+    free(finalbuf);
+cleanup:
+    for (idx = 0; idx < nthreads; idx++) {
+        if (columns[idx] != NULL) {
+            PyMem_Free(columns[idx]);
+            if (chunks[idx].fileptr != NULL) {
+                chunks[idx].fileptr->Fptr->tableptr = NULL;
+            }
+        }
+        if (chunks[idx].fileptr != NULL) {
+            status = 1;  /* Disable header-related errors */
+            fits_close_file(chunks[idx].fileptr, &status);
+        }
+        compression_arena_free(outbufs[idx]);
+    }
+
+    Py_XDECREF(indata);
+    fits_clear_errmsg();
+
+    return retval;
+}
+
+/* State for one worker in the tile decompression pool; each worker reads a
+   tile-aligned range of the image through its own synthetic fitsfile over
+   the shared (read-only) compressed data buffer, decompressing directly
+   into its disjoint slice of the output array. */
+typedef struct {
+    fitsfile* fileptr;
+    int datatype;
+    void* dest;            /* already offset to the chunk's first pixel */
+    long long firstelem;   /* 1-based first pixel of the chunk */
+    long long nelem;
+    int anynul;
+    int status;
+} decompress_chunk;
+
+
+static void* decompress_chunk_run(void* arg) {
+    decompress_chunk* chunk = (decompress_chunk*) arg;
+
+    fits_read_img(chunk->fileptr, chunk->datatype, chunk->firstelem,
+                  chunk->nelem, NULL, chunk->dest, &chunk->anynul,
+                  &chunk->status);
+    return NULL;
+}
+
+
+/* Decompresses the tiles of the given HDU with a pool of nthreads workers,
+   partitioning the image into tile-aligned slabs along the slowest axis so
+   that each worker's output region is disjoint.  Returns the same numpy
+   array as the single-threaded path (or the caller-provided out array). */
+static PyObject* decompress_hdu_parallel(PyObject* hdu, PyObject* out,
+                                         int nthreads) {
+    decompress_chunk chunks[MAX_COMPRESSION_THREADS];
+    pthread_t threads[MAX_COMPRESSION_THREADS];
+    tcolumn* columns[MAX_COMPRESSION_THREADS];
+    void* inbufs[MAX_COMPRESSION_THREADS];
+    size_t inbufsizes[MAX_COMPRESSION_THREADS];
+
+    PyArrayObject* outdata = NULL;
+    FITSfile* Fptr;
+
+    int datatype;
+    int npdatatype;
+    int elemsize;
+    int idx;
+    int started = 0;
+
+    long long nslabs;
+    long long slabpix;
+    long long slabs_per_chunk;
+    long long slab0;
+    long long totalpix;
+    int zndim_c;
+
+    npy_intp zndim;
+    npy_intp* znaxis = NULL;
+    int status;
+    double stats_t0 = 0.0;
+
+    void* inbuf;
+    size_t inbufsize;
+
+    for (idx = 0; idx < nthreads; idx++) {
+        chunks[idx].fileptr = NULL;
+        chunks[idx].status = 0;
+        chunks[idx].anynul = 0;
+        columns[idx] = NULL;
+    }
+
+    get_hdu_data_base(hdu, &inbuf, &inbufsize);
+    if (PyErr_Occurred()) {
+        return NULL;
+    } else if (inbufsize == 0) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    /* Each worker gets its own synthetic fitsfile (with its own CFITSIO I/O
+       buffers) over the shared compressed data; no worker ever writes to
+       the input buffer so sharing it is safe */
+    for (idx = 0; idx < nthreads; idx++) {
+        inbufs[idx] = inbuf;
+        inbufsizes[idx] = inbufsize;
+        open_from_hdu(&chunks[idx].fileptr, &inbufs[idx], &inbufsizes[idx],
+                      hdu, &columns[idx]);
+        if (PyErr_Occurred()) {
+            goto fail;
+        }
+    }
+
+    Fptr = chunks[0].fileptr->Fptr;
+
+    bitpix_to_datatypes(Fptr->zbitpix, &datatype, &npdatatype);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    elemsize = abs(Fptr->zbitpix) / 8;
+    zndim_c = Fptr->zndim;
+
+    zndim = (npy_intp) zndim_c;
+    znaxis = (npy_intp*) PyMem_Malloc(sizeof(npy_intp) * zndim);
+    if (znaxis == NULL) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+
+    slabpix = 1;
+    totalpix = 1;
+    for (idx = 0; idx < zndim_c; idx++) {
+        znaxis[zndim_c - idx - 1] = Fptr->znaxis[idx];
+        totalpix *= Fptr->znaxis[idx];
+        if (idx < zndim_c - 1) {
+            slabpix *= Fptr->znaxis[idx];
+        }
+    }
+    slabpix *= Fptr->tilesize[zndim_c - 1];
+    nslabs = (Fptr->znaxis[zndim_c - 1] + Fptr->tilesize[zndim_c - 1] - 1) /
+             Fptr->tilesize[zndim_c - 1];
+
+    if (out != NULL && out != Py_None) {
+        outdata = check_output_array(out, npdatatype, totalpix);
+        if (outdata == NULL) {
+            goto fail;
+        }
+        Py_INCREF(outdata);
+    } else {
+        outdata = (PyArrayObject*) PyArray_SimpleNew(zndim, znaxis,
+                                                     npdatatype);
+        if (outdata == NULL) {
+            goto fail;
+        }
+    }
+
+    slabs_per_chunk = (nslabs + nthreads - 1) / nthreads;
+    slab0 = 0;
+    for (idx = 0; idx < nthreads && slab0 < nslabs; idx++) {
+        long long chunkslabs = slabs_per_chunk;
+        if (slab0 + chunkslabs > nslabs) {
+            chunkslabs = nslabs - slab0;
+        }
+
+        chunks[idx].datatype = datatype;
+        chunks[idx].firstelem = slab0 * slabpix + 1;
+        chunks[idx].nelem = chunkslabs * slabpix;
+        if (chunks[idx].firstelem + chunks[idx].nelem - 1 > totalpix) {
+            chunks[idx].nelem = totalpix - chunks[idx].firstelem + 1;
+        }
+        chunks[idx].dest = ((char*) PyArray_DATA(outdata)) +
+                           (chunks[idx].firstelem - 1) * elemsize;
+
+        slab0 += chunkslabs;
+        started++;
+    }
+
+    if (compression_stats_enabled) {
+        stats_t0 = stats_walltime();
+    }
+
+    // The workers already provide tile-level parallelism, so keep the
+    // HCOMPRESS inverse-transform kernels serial within each worker
+    fits_hdecompress_set_threads(1);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (idx = 0; idx < started; idx++) {
+        if (0 != pthread_create(&threads[idx], NULL, decompress_chunk_run,
+                                &chunks[idx])) {
+            /* Run the chunk inline rather than losing its tiles */
+            decompress_chunk_run(&chunks[idx]);
+            threads[idx] = pthread_self();
+        }
+    }
+    for (idx = 0; idx < started; idx++) {
+        if (!pthread_equal(threads[idx], pthread_self())) {
+            pthread_join(threads[idx], NULL);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    for (idx = 0; idx < started; idx++) {
+        if (chunks[idx].status != 0) {
+            process_status_err(chunks[idx].status);
+            goto fail;
+        }
+    }
+
+    if (compression_stats_enabled) {
+        stats_record(decompress_stats, Fptr->compress_type,
+                     (unsigned long long) Fptr->numrows,
+                     (unsigned long long) PyArray_NBYTES(outdata),
+                     (unsigned long long) Fptr->heapsize,
+                     stats_walltime() - stats_t0);
+    }
+
+    goto cleanup;
+
+fail:
+    Py_XDECREF(outdata);
+    outdata = NULL;
+cleanup:
+    for (idx = 0; idx < nthreads; idx++) {
+        if (columns[idx] != NULL) {
+            PyMem_Free(columns[idx]);
+            if (chunks[idx].fileptr != NULL) {
+                chunks[idx].fileptr->Fptr->tableptr = NULL;
+            }
+        }
+        if (chunks[idx].fileptr != NULL) {
+            status = 1;  /* Disable header-related errors */
+            fits_close_file(chunks[idx].fileptr, &status);
+        }
+    }
+
+    PyMem_Free(znaxis);
+    fits_clear_errmsg();
+
+    return (PyObject*) outdata;
+}
+
+#endif  /* HAVE_COMPRESSION_THREADS */
+
+
+PyObject* compression_compress_hdu(PyObject* self, PyObject* args)
+{
+    PyObject* hdu;
+    PyObject* retval = NULL;
+    tcolumn* columns = NULL;
+
+    void* outbuf;
+    size_t outbufsize;
+
+    PyArrayObject* indata;
+    PyArrayObject* tmp;
+    npy_intp znaxis;
+    int datatype;
+    int npdatatype;
+    unsigned long long heapsize;
+
+    fitsfile* fileptr;
+    FITSfile* Fptr;
+    int status = 0;
+    double stats_t0 = 0.0;
+
+    if (!PyArg_ParseTuple(args, "O:compression.compress_hdu", &hdu))
+    {
+        PyErr_SetString(PyExc_TypeError, "Couldn't parse arguments");
+        return NULL;
+    }
+
+#ifdef HAVE_COMPRESSION_THREADS
+    if (compression_thread_count != 1) {
+        PyObject* header;
+        long long ntiles = 0;
+        int nthreads;
+
+        // Each row of the compressed binary table holds one tile
+        header = PyObject_GetAttrString(hdu, "_header");
+        if (header == NULL) {
+            return NULL;
+        }
+        get_header_longlong(header, "NAXIS2", &ntiles, 0);
+        Py_DECREF(header);
+
+        nthreads = resolve_thread_count(ntiles);
+        if (nthreads > 1) {
+            return compress_hdu_parallel(hdu, nthreads);
+        }
+    }
+#endif
+
+    // For HDU compression never use CFITSIO to write directly to the file;
+    // although there's nothing wrong with CFITSIO, right now that would cause
+    // too much confusion to PyFITS' internal book keeping.
+    // We just need to get the compressed bytes and PyFITS will handle the
+    // writing of them.
+    init_output_buffer(hdu, &outbuf, &outbufsize);
+    if (outbuf == NULL) {
+        return NULL;
+    }
+
+    open_from_hdu(&fileptr, &outbuf, &outbufsize, hdu, &columns);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    Fptr = fileptr->Fptr;
+
+    bitpix_to_datatypes(Fptr->zbitpix, &datatype, &npdatatype);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    indata = (PyArrayObject*) PyObject_GetAttrString(hdu, "data");
+
+    if (compression_stats_enabled) {
+        stats_t0 = stats_walltime();
+    }
+
+#ifdef HAVE_COMPRESSION_THREADS
+    // Tile-level parallelism is not in use on this path (typically because
+    // the image is a single whole-image tile), so let the HCOMPRESS
+    // transform kernels use the configured thread count instead
+    fits_hcompress_set_threads(
+        compression_thread_count == 1 ? 1 :
+        resolve_thread_count(MAX_COMPRESSION_THREADS));
+#endif
+
+    // The actual compression run is pure C on buffers we own, so it can
+    // safely release the GIL; the cfitsio status is simply carried back out
+    // of the block and converted to a Python exception afterwards
+    Py_BEGIN_ALLOW_THREADS
+    fits_write_img(fileptr, datatype, 1, PyArray_SIZE(indata), indata->data,
+                   &status);
+    if (status == 0) {
+        fits_flush_buffer(fileptr, 1, &status);
+    }
+    Py_END_ALLOW_THREADS
+    if (status != 0) {
+        process_status_err(status);
+        goto fail;
+    }
+
+    // Previously this used outbufsize as the size to use for the new Numpy
+    // byte array. However outbufsize is usually larger than necessary to
+    // store all the compressed data exactly; instead use the exact size
+    // of the compressed data from the heapsize plus the size of the table
+    // itself
+    heapsize = (unsigned long long) Fptr->heapsize;
+    znaxis = (npy_intp) (Fptr->heapstart + heapsize);
+
+    if (compression_stats_enabled) {
+        stats_record(compress_stats, Fptr->compress_type,
+                     (unsigned long long) Fptr->numrows,
+                     (unsigned long long) PyArray_NBYTES(indata), heapsize,
+                     stats_walltime() - stats_t0);
+    }
+
+    if (znaxis < outbufsize) {
+        // Go ahead and truncate to the size in znaxis to free the
+        // redundant arena reservation
+        outbuf = compression_arena_trim(outbuf, (size_t) znaxis);
+    }
+
+    tmp = (PyArrayObject*) PyArray_SimpleNewFromData(1, &znaxis, NPY_UBYTE,
+                                                     outbuf);
+
+
+    // Leaves refcount of tmp untouched, so its refcount should remain as 1
+    retval = Py_BuildValue("KN", heapsize, tmp);
+
+    goto cleanup;
+
+fail:
+    if (outbuf != NULL) {
+        // At this point outbuf should never not be NULL, but in principle
+        // buggy code somewhere in CFITSIO or Numpy could set it to NULL
+        compression_arena_free(outbuf);
+    }
+cleanup:
+    if (columns != NULL) {
+        PyMem_Free(columns);
+        Fptr->tableptr = NULL;
+    }
+
+    if (fileptr != NULL) {
+        status = 1; // Disable header-related errors
+        fits_close_file(fileptr, &status);
+        if (status != 1) {
+            process_status_err(status);
+            retval = NULL;
+        }
+    }
+
+    Py_XDECREF(indata);
+
+    // Clear any messages remaining in CFITSIO's error stack
+    fits_clear_errmsg();
+
+    return retval;
+}
+
+
+PyObject* compression_decompress_hdu(PyObject* self, PyObject* args)
+{
+    PyObject* hdu;
+    PyObject* out = NULL;
+    tcolumn* columns = NULL;
+    int cached = 0;
+
+    void* inbuf;
+    size_t inbufsize;
+
+    PyArrayObject* outdata = NULL;
+    int datatype;
+    int npdatatype;
+    npy_intp zndim;
+    npy_intp* znaxis;
+    long arrsize;
+    unsigned int idx;
+
+    fitsfile* fileptr;
+    int anynul = 0;
+    int status = 0;
+    double stats_t0 = 0.0;
+
+    if (!PyArg_ParseTuple(args, "O|O:compression.decompress_hdu", &hdu, &out))
+    {
+        PyErr_SetString(PyExc_TypeError, "Couldn't parse arguments");
+        return NULL;
+    }
+
+#ifdef HAVE_COMPRESSION_THREADS
+    if (compression_thread_count != 1) {
+        PyObject* header;
+        long long ntiles = 0;
+        int nthreads;
+
+        // Each row of the compressed binary table holds one tile
+        header = PyObject_GetAttrString(hdu, "_header");
+        if (header == NULL) {
+            return NULL;
+        }
+        get_header_longlong(header, "NAXIS2", &ntiles, 0);
+        Py_DECREF(header);
+
+        nthreads = resolve_thread_count(ntiles);
+        if (nthreads > 1) {
+            return decompress_hdu_parallel(hdu, out, nthreads);
+        }
+    }
+#endif
+
+    // Grab a pointer to the input data from the HDU's compressed_data
+    // attribute
+    get_hdu_data_base(hdu, &inbuf, &inbufsize);
+    if (PyErr_Occurred()) {
+        return NULL;
+    } else if (inbufsize == 0) {
+        // The compressed data buffer is empty (probably zero rows, for an
+        // empty "compressed" image.  Just return None in this case.
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    open_from_hdu_cached(&fileptr, &inbuf, &inbufsize, hdu, &columns,
+                         &cached);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+
+    bitpix_to_datatypes(fileptr->Fptr->zbitpix, &datatype, &npdatatype);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+
+    zndim = (npy_intp)fileptr->Fptr->zndim;
+    znaxis = (npy_intp*) PyMem_Malloc(sizeof(npy_intp) * zndim);
+    arrsize = 1;
+    for (idx = 0; idx < zndim; idx++) {
+        znaxis[zndim - idx - 1] = fileptr->Fptr->znaxis[idx];
+        arrsize *= fileptr->Fptr->znaxis[idx];
+    }
+
+    if (out != NULL && out != Py_None) {
+        /* Decompress directly into the caller-provided array, avoiding the
+           intermediate allocation and copy entirely */
+        outdata = check_output_array(out, npdatatype, (long long) arrsize);
+        if (outdata == NULL) {
+            goto fail;
+        }
+        Py_INCREF(outdata);
+    } else {
+        /* Create and allocate a new array for the decompressed data */
+        outdata = (PyArrayObject*) PyArray_SimpleNew(zndim, znaxis,
+                                                     npdatatype);
+    }
+
+    if (compression_stats_enabled) {
+        stats_t0 = stats_walltime();
+    }
+
+#ifdef HAVE_COMPRESSION_THREADS
+    // Tile-level parallelism is not in use on this path, so let the
+    // HCOMPRESS inverse-transform kernels use the configured thread count
+    fits_hdecompress_set_threads(
+        compression_thread_count == 1 ? 1 :
+        resolve_thread_count(MAX_COMPRESSION_THREADS));
+#endif
+
+    // As with compression, the decompression run itself does not touch any
+    // Python objects and can release the GIL for its duration
+    Py_BEGIN_ALLOW_THREADS
+    fits_read_img(fileptr, datatype, 1, arrsize, NULL, outdata->data, &anynul,
+                  &status);
+    Py_END_ALLOW_THREADS
+    if (status != 0) {
+        process_status_err(status);
+        Py_XDECREF(outdata);
+        outdata = NULL;
+        goto fail;
+    }
+
+    if (compression_stats_enabled) {
+        stats_record(decompress_stats, fileptr->Fptr->compress_type,
+                     (unsigned long long) fileptr->Fptr->numrows,
+                     (unsigned long long) PyArray_NBYTES(outdata),
+                     (unsigned long long) fileptr->Fptr->heapsize,
+                     stats_walltime() - stats_t0);
+    }
+
+fail:
+    if (!cached) {
+        if (columns != NULL) {
+            PyMem_Free(columns);
+            fileptr->Fptr->tableptr = NULL;
+        }
+
+        if (fileptr != NULL) {
+            status = 1;// Disable header-related errors
+            fits_close_file(fileptr, &status);
+            if (status != 1) {
+                process_status_err(status);
+                Py_XDECREF(outdata);
+                outdata = NULL;
+            }
+        }
+    }
+
+    PyMem_Free(znaxis);
+
+    // Clear any messages remaining in CFITSIO's error stack
+    fits_clear_errmsg();
+
+    return (PyObject*) outdata;
+}
+
+
+PyObject* compression_compress_image_section(PyObject* self, PyObject* args)
+{
+    // Compresses a tile-aligned batch of image pixels, for streaming
+    // creation of compressed images without the full array in memory.
+    // Returns (firstrow, rowdata, heapdata) where rowdata contains the
+    // binary table rows for the covered tiles (with their heap descriptors
+    // offset by heap_base) and heapdata the compressed bytes to append to
+    // the heap.
+
+    PyObject* hdu;
+    PyObject* retval = NULL;
+    PyArrayObject* data;
+    long long firstelem;
+    long long heap_base;
+    tcolumn* columns = NULL;
+
+    void* outbuf = NULL;
+    size_t outbufsize;
+
+    PyArrayObject* rowdata = NULL;
+    PyArrayObject* heapdata = NULL;
+    npy_intp arrdim;
+    int datatype;
+    int npdatatype;
+
+    long long slabpix;
+    long long rows_per_slab;
+    long long totalpix;
+    long long nelem;
+    long long slab0;
+    long long firstrow;
+    long long chunkrows;
+    long long rowlen;
+    long long heapsize;
+    long long row;
+    int colidx;
+    int idx;
+    int zndim;
+
+    fitsfile* fileptr = NULL;
+    FITSfile* Fptr;
+    int status = 0;
+
+    if (!PyArg_ParseTuple(args, "OO!LL:compression.compress_image_section",
+                          &hdu, &PyArray_Type, &data, &firstelem, &heap_base))
+    {
+        PyErr_SetString(PyExc_TypeError, "Couldn't parse arguments");
+        return NULL;
+    }
+
+    if (!PyArray_ISCONTIGUOUS(data)) {
+        PyErr_SetString(PyExc_ValueError, "data must be C-contiguous");
+        return NULL;
+    }
+
+    init_output_buffer(hdu, &outbuf, &outbufsize);
+    if (outbuf == NULL) {
+        return NULL;
+    }
+
+    open_from_hdu(&fileptr, &outbuf, &outbufsize, hdu, &columns);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    Fptr = fileptr->Fptr;
+
+    bitpix_to_datatypes(Fptr->zbitpix, &datatype, &npdatatype);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    zndim = Fptr->zndim;
+    rowlen = Fptr->rowlength;
+
+    /* A "slab" is one tile length of the slowest varying axis by the full
+       extent of all faster axes; batches must cover whole slabs so that no
+       tile is split across calls */
+    slabpix = 1;
+    rows_per_slab = 1;
+    totalpix = 1;
+    for (idx = 0; idx < zndim; idx++) {
+        totalpix *= Fptr->znaxis[idx];
+        if (idx < zndim - 1) {
+            slabpix *= Fptr->znaxis[idx];
+            rows_per_slab *= (Fptr->znaxis[idx] + Fptr->tilesize[idx] - 1) /
+                             Fptr->tilesize[idx];
+        }
+    }
+    slabpix *= Fptr->tilesize[zndim - 1];
+
+    nelem = (long long) PyArray_SIZE(data);
+
+    if ((firstelem - 1) % slabpix != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "batches must start on a tile row boundary");
+        goto fail;
+    }
+    if (firstelem - 1 + nelem > totalpix) {
+        PyErr_SetString(PyExc_ValueError,
+                        "batch extends past the end of the image");
+        goto fail;
+    }
+    if (nelem % slabpix != 0 && firstelem - 1 + nelem != totalpix) {
+        PyErr_SetString(PyExc_ValueError,
+                        "batches must contain a whole number of tile rows");
+        goto fail;
+    }
+
+    slab0 = (firstelem - 1) / slabpix;
+    firstrow = slab0 * rows_per_slab;
+    chunkrows = ((nelem + slabpix - 1) / slabpix) * rows_per_slab;
+    if (firstrow + chunkrows > Fptr->numrows) {
+        chunkrows = Fptr->numrows - firstrow;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    fits_write_img(fileptr, datatype, firstelem, nelem, PyArray_DATA(data),
+                   &status);
+    if (status == 0) {
+        fits_flush_buffer(fileptr, 1, &status);
+    }
+    Py_END_ALLOW_THREADS
+    if (status != 0) {
+        process_status_err(status);
+        goto fail;
+    }
+
+    arrdim = (npy_intp) (chunkrows * rowlen);
+    rowdata = (PyArrayObject*) PyArray_SimpleNew(1, &arrdim, NPY_UBYTE);
+    if (rowdata == NULL) {
+        goto fail;
+    }
+    memcpy(PyArray_DATA(rowdata),
+           (unsigned char*) outbuf + firstrow * rowlen,
+           (size_t) (chunkrows * rowlen));
+
+    heapsize = Fptr->heapsize;
+    arrdim = (npy_intp) heapsize;
+    heapdata = (PyArrayObject*) PyArray_SimpleNew(1, &arrdim, NPY_UBYTE);
+    if (heapdata == NULL) {
+        goto fail;
+    }
+    memcpy(PyArray_DATA(heapdata),
+           (unsigned char*) outbuf + Fptr->heapstart, (size_t) heapsize);
+
+    /* Shift the heap descriptors in the returned rows by the caller's
+       current heap size, so the rows can be written out as-is */
+    for (row = 0; row < chunkrows; row++) {
+        unsigned char* rowptr =
+            (unsigned char*) PyArray_DATA(rowdata) + row * rowlen;
+
+        for (colidx = 0; colidx < Fptr->tfield; colidx++) {
+            tcolumn* column = columns + colidx;
+            unsigned char* descptr;
+            long long count;
+            long long offset;
+            int qformat;
+
+            if (column->tdatatype >= 0) {
+                continue;
+            }
+
+            qformat = (NULL != strchr(column->tform, 'Q'));
+            descptr = rowptr + column->tbcol;
+            read_vla_descriptor(descptr, qformat, &count, &offset);
+            if (count == 0) {
+                continue;
+            }
+            write_vla_descriptor(descptr, qformat, count,
+                                 offset + heap_base);
+        }
+    }
+
+    retval = Py_BuildValue("LNN", firstrow, rowdata, heapdata);
+    rowdata = heapdata = NULL;  /* References stolen by Py_BuildValue */
+
+fail:
+    Py_XDECREF(rowdata);
+    Py_XDECREF(heapdata);
+
+    if (columns != NULL) {
+        PyMem_Free(columns);
+        if (fileptr != NULL) {
+            fileptr->Fptr->tableptr = NULL;
+        }
+    }
+
+    if (fileptr != NULL) {
+        status = 1;  // Disable header-related errors
+        fits_close_file(fileptr, &status);
+        if (status != 1) {
+            process_status_err(status);
+            Py_XDECREF(retval);
+            retval = NULL;
+        }
+    }
+
+    compression_arena_free(outbuf);
+    fits_clear_errmsg();
+
+    return retval;
+}
+
+
+PyObject* compression_decompress_section(PyObject* self, PyObject* args)
+{
+    PyObject* hdu;
+    PyObject* fpix_obj;
+    PyObject* lpix_obj;
+    PyObject* item;
+    tcolumn* columns = NULL;
+    int cached = 0;
+
+    void* inbuf;
+    size_t inbufsize;
+
+    PyArrayObject* outdata = NULL;
+    int datatype;
+    int npdatatype;
+    int zndim;
+    long fpixel[MAX_COMPRESS_DIM];
+    long lpixel[MAX_COMPRESS_DIM];
+    long inc[MAX_COMPRESS_DIM];
+    npy_intp secaxis[MAX_COMPRESS_DIM];
+    int idx;
+
+    fitsfile* fileptr = NULL;
+    int anynul = 0;
+    int status = 0;
+
+    if (!PyArg_ParseTuple(args, "OOO:compression.decompress_section", &hdu,
+                          &fpix_obj, &lpix_obj))
+    {
+        PyErr_SetString(PyExc_TypeError, "Couldn't parse arguments");
+        return NULL;
+    }
+
+    get_hdu_data_base(hdu, &inbuf, &inbufsize);
+    if (PyErr_Occurred()) {
+        return NULL;
+    } else if (inbufsize == 0) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    open_from_hdu_cached(&fileptr, &inbuf, &inbufsize, hdu, &columns,
+                         &cached);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+
+    bitpix_to_datatypes(fileptr->Fptr->zbitpix, &datatype, &npdatatype);
+    if (PyErr_Occurred()) {
+        goto fail;
+    }
+
+    zndim = fileptr->Fptr->zndim;
+
+    if (PySequence_Length(fpix_obj) != zndim ||
+            PySequence_Length(lpix_obj) != zndim) {
+        PyErr_SetString(PyExc_ValueError,
+                        "first/last pixel sequences must have one element "
+                        "per image axis");
+        goto fail;
+    }
+
+    /* The first/last pixel coordinates are given in FITS axis order (fastest
+       varying axis first) and are 1-based and inclusive, as in CFITSIO */
+    for (idx = 0; idx < zndim; idx++) {
+        item = PySequence_GetItem(fpix_obj, idx);
+        fpixel[idx] = PyInt_AsLong(item);
+        Py_XDECREF(item);
+        item = PySequence_GetItem(lpix_obj, idx);
+        lpixel[idx] = PyInt_AsLong(item);
+        Py_XDECREF(item);
+        if (PyErr_Occurred()) {
+            goto fail;
+        }
+
+        if (fpixel[idx] < 1 || lpixel[idx] < fpixel[idx] ||
+                lpixel[idx] > fileptr->Fptr->znaxis[idx]) {
+            PyErr_Format(PyExc_ValueError,
+                         "pixel range [%ld, %ld] out of bounds for axis %d",
+                         fpixel[idx], lpixel[idx], idx + 1);
+            goto fail;
+        }
+
+        inc[idx] = 1;
+        secaxis[zndim - idx - 1] = (npy_intp) (lpixel[idx] - fpixel[idx] + 1);
+    }
+
+    outdata = (PyArrayObject*) PyArray_SimpleNew(zndim, secaxis, npdatatype);
+    if (outdata == NULL) {
+        goto fail;
+    }
+
+    // Only the tiles overlapping the requested section are decompressed;
+    // CFITSIO's compressed image driver takes care of clipping each tile to
+    // the section boundaries
+    Py_BEGIN_ALLOW_THREADS
+    fits_read_subset(fileptr, datatype, fpixel, lpixel, inc, NULL,
+                     outdata->data, &anynul, &status);
+    Py_END_ALLOW_THREADS
+    if (status != 0) {
+        process_status_err(status);
+        Py_XDECREF(outdata);
+        outdata = NULL;
+        goto fail;
+    }
+
+fail:
+    if (!cached) {
+        if (columns != NULL) {
+            PyMem_Free(columns);
+            fileptr->Fptr->tableptr = NULL;
+        }
+
+        if (fileptr != NULL) {
+            status = 1;  // Disable header-related errors
+            fits_close_file(fileptr, &status);
+            if (status != 1) {
+                process_status_err(status);
+                Py_XDECREF(outdata);
+                outdata = NULL;
+            }
+        }
+    }
 
-    // Clear any messages remaining in CFITSIO's error stack
     fits_clear_errmsg();
 
     return (PyObject*) outdata;
 }
 
 
+/* Evaluate a row selection expression against a table HDU of a FITS file
+   using the CFITSIO expression evaluator (see the "Row Filtering
+   Specification" section of the CFITSIO manual), without reading the table
+   data into Python.  The HDU is identified by the byte offset of its header
+   within the file, which is how PyFITS itself keeps track of HDUs.  Returns
+   a boolean array with one element per table row, true for the rows on
+   which the expression is true. */
+PyObject* compression_filter_rows(PyObject* self, PyObject* args)
+{
+    char* filename;
+    char* expr;
+    PY_LONG_LONG header_offset;
+
+    fitsfile* fileptr = NULL;
+    PyArrayObject* mask = NULL;
+    LONGLONG headstart, datastart, dataend;
+    LONGLONG nrows = 0;
+    npy_intp dims[1];
+    long ngood = 0;
+    int numhdus = 0;
+    int hdutype = ANY_HDU;
+    int found = 0;
+    int idx;
+    int status = 0;
+
+    if (!PyArg_ParseTuple(args, "sLs:compression.filter_rows", &filename,
+                          &header_offset, &expr)) {
+        return NULL;
+    }
+
+    // fits_open_diskfile rather than fits_open_file so that the filename is
+    // not subject to CFITSIO's extended filename parsing
+    fits_open_diskfile(&fileptr, filename, READONLY, &status);
+    if (status != 0) {
+        process_status_err(status);
+        fits_clear_errmsg();
+        return NULL;
+    }
+
+    fits_get_num_hdus(fileptr, &numhdus, &status);
+
+    for (idx = 1; idx <= numhdus && status == 0; idx++) {
+        fits_movabs_hdu(fileptr, idx, &hdutype, &status);
+        fits_get_hduaddrll(fileptr, &headstart, &datastart, &dataend,
+                           &status);
+        if (status == 0 && headstart == (LONGLONG) header_offset) {
+            found = 1;
+            break;
+        }
+    }
+
+    if (status != 0) {
+        process_status_err(status);
+        goto fail;
+    }
+
+    if (!found) {
+        PyErr_Format(PyExc_ValueError,
+                     "no HDU found with a header starting at offset %lld",
+                     (long long) header_offset);
+        goto fail;
+    }
+
+    if (hdutype != BINARY_TBL && hdutype != ASCII_TBL) {
+        PyErr_SetString(PyExc_TypeError,
+                        "the HDU at the given offset is not a table");
+        goto fail;
+    }
+
+    fits_get_num_rowsll(fileptr, &nrows, &status);
+    if (status != 0) {
+        process_status_err(status);
+        goto fail;
+    }
+
+    dims[0] = (npy_intp) nrows;
+    mask = (PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_BOOL);
+    if (mask == NULL) {
+        goto fail;
+    }
+
+    if (nrows > 0) {
+        // The row_status values filled in by the evaluator are 0/1 chars,
+        // which is exactly the numpy bool representation
+        Py_BEGIN_ALLOW_THREADS
+        fffrow(fileptr, expr, 1, (long) nrows, &ngood,
+               (char*) PyArray_DATA(mask), &status);
+        Py_END_ALLOW_THREADS
+        if (status != 0) {
+            process_status_err(status);
+            Py_DECREF(mask);
+            mask = NULL;
+            goto fail;
+        }
+    }
+
+fail:
+    status = 0;
+    fits_close_file(fileptr, &status);
+    fits_clear_errmsg();
+
+    return (PyObject*) mask;
+}
+
+
+PyObject* compression_enable_stats(PyObject* self, PyObject* args)
+{
+    compression_stats_enabled = 1;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+PyObject* compression_disable_stats(PyObject* self, PyObject* args)
+{
+    compression_stats_enabled = 0;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+PyObject* compression_reset_stats(PyObject* self, PyObject* args)
+{
+    memset(compress_stats, 0, sizeof(compress_stats));
+    memset(decompress_stats, 0, sizeof(decompress_stats));
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+static PyObject* codec_stats_to_dict(codec_stats* stats) {
+    // Builds {codec name: {counter name: value}} for one direction,
+    // omitting codecs that were never used
+    PyObject* retval;
+    PyObject* entry;
+    codec_stats* slot;
+    int idx;
+    int err = 0;
+
+    retval = PyDict_New();
+    if (retval == NULL) {
+        return NULL;
+    }
+
+    for (idx = 0; idx < CODEC_STATS_SLOTS; idx++) {
+        slot = stats + idx;
+        if (slot->calls == 0) {
+            continue;
+        }
+        entry = Py_BuildValue("{s:K,s:K,s:K,s:K,s:d}",
+                              "calls", slot->calls,
+                              "tiles", slot->tiles,
+                              "raw_bytes", slot->raw_bytes,
+                              "comp_bytes", slot->comp_bytes,
+                              "seconds", slot->seconds);
+        if (entry == NULL) {
+            err = 1;
+            break;
+        }
+        err = PyDict_SetItemString(retval, codec_stats_names[idx], entry);
+        Py_DECREF(entry);
+        if (err) {
+            break;
+        }
+    }
+
+    if (err) {
+        Py_DECREF(retval);
+        return NULL;
+    }
+    return retval;
+}
+
+
+PyObject* compression_get_stats(PyObject* self, PyObject* args)
+{
+    PyObject* compress_dict;
+    PyObject* decompress_dict;
+    PyObject* retval;
+
+    compress_dict = codec_stats_to_dict(compress_stats);
+    if (compress_dict == NULL) {
+        return NULL;
+    }
+    decompress_dict = codec_stats_to_dict(decompress_stats);
+    if (decompress_dict == NULL) {
+        Py_DECREF(compress_dict);
+        return NULL;
+    }
+
+    retval = Py_BuildValue("{s:O,s:N,s:N}",
+                           "enabled",
+                           compression_stats_enabled ? Py_True : Py_False,
+                           "compress", compress_dict,
+                           "decompress", decompress_dict);
+    return retval;
+}
+
+
+PyObject* compression_trim_buffers(PyObject* self, PyObject* args)
+{
+    /* Releases the pool of scratch buffers recycled between compression
+       calls; useful after a batch of (de)compression work to return the
+       memory to the allocator */
+    compression_arena_pool_trim();
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+PyObject* compression_set_thread_count(PyObject* self, PyObject* args)
+{
+    int nthreads;
+
+    if (!PyArg_ParseTuple(args, "i:compression.set_thread_count", &nthreads))
+    {
+        return NULL;
+    }
+
+    if (nthreads < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "thread count must be a non-negative integer "
+                        "(0 means one thread per processor)");
+        return NULL;
+    }
+
+#ifndef HAVE_COMPRESSION_THREADS
+    /* Accept but clamp the setting so that code using this knob still runs
+       unmodified on platforms without thread support */
+    nthreads = 1;
+#endif
+
+    compression_thread_count = nthreads;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+PyObject* compression_get_thread_count(PyObject* self, PyObject* args)
+{
+    return PyInt_FromLong((long) compression_thread_count);
+}
+
+
 /* CFITSIO version float as returned by fits_get_version() */
 static double cfitsio_version;
 
@@ -1105,7 +2817,18 @@ void compression_module_init(PyObject* module) {
 static PyMethodDef compression_methods[] =
 {
    {"compress_hdu", compression_compress_hdu, METH_VARARGS},
+   {"compress_image_section", compression_compress_image_section,
+    METH_VARARGS},
    {"decompress_hdu", compression_decompress_hdu, METH_VARARGS},
+   {"decompress_section", compression_decompress_section, METH_VARARGS},
+   {"filter_rows", compression_filter_rows, METH_VARARGS},
+   {"set_thread_count", compression_set_thread_count, METH_VARARGS},
+   {"get_thread_count", compression_get_thread_count, METH_VARARGS},
+   {"enable_stats", compression_enable_stats, METH_NOARGS},
+   {"disable_stats", compression_disable_stats, METH_NOARGS},
+   {"reset_stats", compression_reset_stats, METH_NOARGS},
+   {"get_stats", compression_get_stats, METH_NOARGS},
+   {"trim_buffers", compression_trim_buffers, METH_NOARGS},
    {NULL, NULL}
 };
 
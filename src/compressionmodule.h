@@ -10,6 +10,7 @@
 #ifdef IS_PY3K
 #define PyString_FromString PyUnicode_FromString
 #define PyInt_AsLong PyLong_AsLong
+#define PyInt_FromLong PyLong_FromLong
 #endif
 
 
@@ -64,4 +65,15 @@
 /* This constant is defined by cfitsio in imcompress.c */
 #define NO_QUANTIZE 9999
 
+/* Multi-threaded tile compression is only supported on platforms with
+   POSIX threads; on other platforms the module silently falls back to the
+   single-threaded code paths. */
+#ifndef _WIN32
+#define HAVE_COMPRESSION_THREADS
+#endif
+
+/* Hard upper bound on the tile compression worker pool size; mostly a
+   sanity limit for bogus values passed to set_thread_count */
+#define MAX_COMPRESSION_THREADS 64
+
 #endif